@@ -0,0 +1,81 @@
+//
+//  ISApp.h
+//  Analytics Ingest Server
+//
+//  This is the root class for the ingest server. The server is a headless
+//  CUGL application, so it has no window or scenes. It simply starts the
+//  network layer and runs the ingest controller every frame.
+//
+//  Author: Kidus Zegeye
+//  Version: 1/15/25
+//
+#ifndef __IS_APP_H__
+#define __IS_APP_H__
+#include <cugl/core/cu_base.h>
+#include <cugl/netcode/cu_netcode.h>
+#include "ISIngestController.h"
+
+/**
+ * This class represents the application root for the ingest server.
+ */
+class IngestApp : public cugl::Application {
+protected:
+    /** The controller implementing the analytics protocol */
+    IngestController _ingest;
+
+public:
+    /**
+     * Creates, but does not initialize, a new application.
+     *
+     * This constructor is called by main.cpp. You will notice that, like
+     * most of the classes in CUGL, we do not do any initialization in the
+     * constructor. That is the purpose of the init() method. Separation
+     * of initialization from the constructor allows main.cpp to perform
+     * advanced configuration of the application before it starts.
+     */
+    IngestApp() : cugl::Application() {}
+
+    /**
+     * Disposes of this application, releasing all resources.
+     *
+     * This destructor is called by main.cpp when the application quits.
+     * It simply calls the dispose() method in Application. There is nothing
+     * special to do here.
+     */
+    ~IngestApp() { }
+
+    /**
+     * The method called after the application is initialized, but before running.
+     *
+     * This starts the network layer, reads the server settings and starts the
+     * ingest controller. If the server cannot start, the application quits.
+     *
+     * When overriding this method, you should call the parent method as the
+     * very last line. This ensures that the state will transition to FOREGROUND,
+     * causing the application to run.
+     */
+    virtual void onStartup() override;
+
+    /**
+     * The method called when the application is ready to quit.
+     *
+     * This stops the ingest controller (writing any buffered events) and
+     * shuts down the network layer.
+     *
+     * When overriding this method, you should call the parent method as the
+     * very last line. This ensures that the state will transition to NONE,
+     * causing the application to be deleted.
+     */
+    virtual void onShutdown() override;
+
+    /**
+     * The method called to update the application data.
+     *
+     * This handles every message received since the last frame.
+     *
+     * @param timestep  The amount of time (in seconds) since the last frame
+     */
+    virtual void update(float timestep) override;
+};
+
+#endif /* __IS_APP_H__ */
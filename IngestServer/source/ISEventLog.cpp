@@ -0,0 +1,191 @@
+//
+//  ISEventLog.cpp
+//  Analytics Ingest Server
+//
+//  This class is the storage layer of the ingest server. Events are buffered
+//  in memory, one vector per column, and written to disk in blocks. Writing a
+//  block is handed off to a background thread, so the network callbacks never
+//  wait on the disk. The log is append-only; a new file is started every time
+//  the server starts.
+//
+//  Author: Kidus Zegeye
+//  Version: 1/15/25
+//
+#include "ISEventLog.h"
+#include <chrono>
+
+using namespace cugl;
+
+/** The magic number at the start of a log file ('CUEL') */
+#define LOG_MAGIC   0x4355454C
+/** The version of the log format */
+#define LOG_VERSION 1
+/** The number of columns in every block */
+#define LOG_COLUMNS 8
+/** The magic number at the start of a block ('CUEB') */
+#define BLOCK_MAGIC 0x43554542
+/** The magic number at the end of a block ('CUEE') */
+#define BLOCK_END   0x43554545
+/** The buffer size of the log writer */
+#define WRITE_BUFFER 65536
+
+#pragma mark Constructors
+/**
+ * Creates an uninitialized event log.
+ *
+ * You must initialize this log before use.
+ *
+ * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate an object on
+ * the heap, use one of the static constructors instead.
+ */
+EventLog::EventLog() :
+_blockRows(0),
+_rows(0),
+_inflight(0) {
+}
+
+/**
+ * Disposes all of the resources used by this event log.
+ *
+ * Any partial block is written, and this method waits until every block
+ * is on disk before closing the file.
+ */
+void EventLog::dispose() {
+    if (_thread == nullptr) {
+        return;
+    }
+    flush();
+    {
+        // Stopping the pool discards queued tasks, so wait for them first
+        std::unique_lock<std::mutex> lock(_mutex);
+        _written.wait(lock, [this]() { return _inflight == 0; });
+    }
+    _thread->dispose();
+    _thread = nullptr;
+    _writer->close();
+    _writer = nullptr;
+    _block = nullptr;
+}
+
+/**
+ * Initializes a new event log at the given path.
+ *
+ * If a file already exists at the path, it is replaced.
+ *
+ * @param path      The path of the log file
+ * @param blockRows The number of rows in a full block
+ *
+ * @return true if initialization was successful
+ */
+bool EventLog::init(const std::string path, size_t blockRows) {
+    _writer = BinaryWriter::alloc(path,WRITE_BUFFER);
+    if (_writer == nullptr) {
+        return false;
+    }
+    _path = path;
+    _blockRows = blockRows > 0 ? blockRows : 1;
+    _writer->writeUint32(LOG_MAGIC);
+    _writer->writeUint32(LOG_VERSION);
+    _writer->writeUint32(LOG_COLUMNS);
+    _writer->flush();
+
+    _block = std::make_shared<Block>();
+    _thread = ThreadPool::alloc(1);
+    return _thread != nullptr;
+}
+
+#pragma mark -
+#pragma mark Logging
+/**
+ * Appends an event to the log.
+ *
+ * The event is timestamped with the current time. It is written to disk
+ * once its block is full, or when {@link flush} is called.
+ *
+ * @param session   The session id
+ * @param kind      The event kind
+ * @param task      The task name (or empty)
+ * @param attempt   The task attempt UUID (or empty)
+ * @param status    The task attempt status (or empty)
+ * @param failures  The number of failures (or 0)
+ * @param data      The JSON data (or empty)
+ */
+void EventLog::append(Uint64 session, Kind kind, const std::string& task, const std::string& attempt,
+                      const std::string& status, Sint32 failures, const std::string& data) {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    _block->time.push_back((Uint64)std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+    _block->session.push_back(session);
+    _block->kind.push_back(static_cast<Uint8>(kind));
+    _block->failures.push_back(failures);
+    _block->task.push(task);
+    _block->attempt.push(attempt);
+    _block->status.push(status);
+    _block->data.push(data);
+    _rows++;
+
+    if (_block->size() >= _blockRows) {
+        flush();
+    }
+}
+
+/**
+ * Seals the current block (if it is not empty) and sends it to disk.
+ *
+ * This method does not wait for the block to be written.
+ */
+void EventLog::flush() {
+    if (_block == nullptr || _block->size() == 0) {
+        return;
+    }
+    std::shared_ptr<Block> block = _block;
+    _block = std::make_shared<Block>();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _inflight++;
+    }
+    _thread->addTask([this,block]() {
+        write(*block);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _inflight--;
+        }
+        _written.notify_all();
+    });
+}
+
+#pragma mark -
+#pragma mark Internal Helpers
+/**
+ * Writes the given block to the log file.
+ *
+ * This method is only called on the writer thread.
+ *
+ * @param block The block to write
+ */
+void EventLog::write(const Block& block) {
+    size_t rows = block.size();
+    _writer->writeUint32(BLOCK_MAGIC);
+    _writer->writeUint32((Uint32)rows);
+    _writer->write(block.time.data(),rows);
+    _writer->write(block.session.data(),rows);
+    _writer->write(block.kind.data(),rows);
+    _writer->write(block.failures.data(),rows);
+    write(block.task);
+    write(block.attempt);
+    write(block.status);
+    write(block.data);
+    _writer->writeUint32(BLOCK_END);
+    _writer->flush();
+}
+
+/**
+ * Writes the given string column to the log file.
+ *
+ * This method is only called on the writer thread.
+ *
+ * @param column    The column to write
+ */
+void EventLog::write(const StringColumn& column) {
+    _writer->write(column.ends.data(),column.ends.size());
+    _writer->write(column.bytes.data(),column.bytes.size());
+}
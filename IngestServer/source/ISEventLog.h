@@ -0,0 +1,259 @@
+//
+//  ISEventLog.h
+//  Analytics Ingest Server
+//
+//  This class is the storage layer of the ingest server. Events are buffered
+//  in memory, one vector per column, and written to disk in blocks. Writing a
+//  block is handed off to a background thread, so the network callbacks never
+//  wait on the disk. The log is append-only; a new file is started every time
+//  the server starts.
+//
+//  Author: Kidus Zegeye
+//  Version: 1/15/25
+//
+#ifndef __IS_EVENT_LOG_H__
+#define __IS_EVENT_LOG_H__
+#include <cugl/core/cu_base.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * This class is an append-only, columnar log of analytics events.
+ *
+ * Every event is a row with the same eight columns: the time (in microseconds
+ * since the epoch), the session id, the event kind, the number of failures,
+ * the task name, the task attempt UUID, the status and a JSON data string.
+ * Columns that do not apply to an event are zero or empty.
+ *
+ * Rows are collected into blocks of a fixed size. A block stores each column
+ * contiguously, which makes the log cheap to write and fast to scan one column
+ * at a time. All values are in network (big-endian) order. A log file is
+ *
+ *      Uint32  LOG_MAGIC ('CUEL')
+ *      Uint32  version
+ *      Uint32  number of columns
+ *      block*
+ *
+ * and each block is
+ *
+ *      Uint32  BLOCK_MAGIC ('CUEB')
+ *      Uint32  rows
+ *      Uint64  time[rows]
+ *      Uint64  session[rows]
+ *      Uint8   kind[rows]
+ *      Sint32  failures[rows]
+ *      4 x (Uint32 end[rows], char bytes[end[rows-1]])  task, attempt, status, data
+ *      Uint32  BLOCK_END ('CUEE')
+ *
+ * A string column stores the end offset of each row followed by the
+ * concatenated bytes. A block is only complete if it ends with BLOCK_END, so
+ * a reader can safely ignore a block torn by a crash.
+ *
+ * This class is not thread-safe. It should only be used on the main thread.
+ */
+class EventLog {
+public:
+    /**
+     * The kind of an event (the kind column)
+     */
+    enum class Kind : Uint8 {
+        /** A session started with an init message (data holds the metadata) */
+        SESSION_START = 0,
+        /** A session ended because the client disconnected */
+        SESSION_END = 1,
+        /** A task message */
+        TASK = 2,
+        /** A task_attempt message */
+        TASK_ATTEMPT = 3,
+        /** A sync_task_attempt message (or a preempted attempt) */
+        SYNC_TASK_ATTEMPT = 4,
+        /** An action message (attempt holds a JSON array of UUIDs) */
+        ACTION = 5,
+        /** A sync_task_attempt message with a statistics patch (data holds the patch) */
+        PATCH_TASK_ATTEMPT = 6
+    };
+
+private:
+    /**
+     * A column of strings, stored as end offsets and concatenated bytes.
+     */
+    class StringColumn {
+    public:
+        /** The end offset of each row */
+        std::vector<Uint32> ends;
+        /** The concatenated bytes of every row */
+        std::string bytes;
+
+        /**
+         * Appends a row to this column.
+         *
+         * @param value The row value
+         */
+        void push(const std::string& value) {
+            bytes.append(value);
+            ends.push_back((Uint32)bytes.size());
+        }
+    };
+
+    /**
+     * A block of rows, stored one column at a time.
+     */
+    class Block {
+    public:
+        /** The time column */
+        std::vector<Uint64> time;
+        /** The session column */
+        std::vector<Uint64> session;
+        /** The kind column */
+        std::vector<Uint8> kind;
+        /** The failures column */
+        std::vector<Sint32> failures;
+        /** The task column */
+        StringColumn task;
+        /** The attempt column */
+        StringColumn attempt;
+        /** The status column */
+        StringColumn status;
+        /** The data column */
+        StringColumn data;
+
+        /**
+         * Returns the number of rows in this block.
+         *
+         * @return the number of rows in this block.
+         */
+        size_t size() const { return time.size(); }
+    };
+
+    /** The path of the log file */
+    std::string _path;
+    /** The writer for the log file (writer thread only) */
+    std::shared_ptr<cugl::BinaryWriter> _writer;
+    /** The background thread that writes sealed blocks */
+    std::shared_ptr<cugl::ThreadPool> _thread;
+    /** The block currently being filled */
+    std::shared_ptr<Block> _block;
+    /** The number of rows in a full block */
+    size_t _blockRows;
+    /** The number of rows appended so far */
+    Uint64 _rows;
+    /** The number of blocks handed to the writer thread but not yet written */
+    size_t _inflight;
+    /** A mutex to protect the in-flight count */
+    std::mutex _mutex;
+    /** A condition variable signalled whenever a block is written */
+    std::condition_variable _written;
+
+public:
+    /**
+     * Creates an uninitialized event log.
+     *
+     * You must initialize this log before use.
+     *
+     * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate an object on
+     * the heap, use one of the static constructors instead.
+     */
+    EventLog();
+
+    /**
+     * Deletes this event log, disposing all resources
+     */
+    ~EventLog() { dispose(); }
+
+    /**
+     * Disposes all of the resources used by this event log.
+     *
+     * Any partial block is written, and this method waits until every block
+     * is on disk before closing the file.
+     */
+    void dispose();
+
+    /**
+     * Initializes a new event log at the given path.
+     *
+     * If a file already exists at the path, it is replaced.
+     *
+     * @param path      The path of the log file
+     * @param blockRows The number of rows in a full block
+     *
+     * @return true if initialization was successful
+     */
+    bool init(const std::string path, size_t blockRows);
+
+    /**
+     * Returns a newly allocated event log at the given path.
+     *
+     * If a file already exists at the path, it is replaced.
+     *
+     * @param path      The path of the log file
+     * @param blockRows The number of rows in a full block
+     *
+     * @return a newly allocated event log at the given path.
+     */
+    static std::shared_ptr<EventLog> alloc(const std::string path, size_t blockRows=4096) {
+        std::shared_ptr<EventLog> result = std::make_shared<EventLog>();
+        return (result->init(path,blockRows) ? result : nullptr);
+    }
+
+    /**
+     * Returns the path of the log file.
+     *
+     * @return the path of the log file.
+     */
+    const std::string& getPath() const { return _path; }
+
+    /**
+     * Returns the number of rows appended so far.
+     *
+     * @return the number of rows appended so far.
+     */
+    Uint64 getRows() const { return _rows; }
+
+    /**
+     * Appends an event to the log.
+     *
+     * The event is timestamped with the current time. It is written to disk
+     * once its block is full, or when {@link flush} is called.
+     *
+     * @param session   The session id
+     * @param kind      The event kind
+     * @param task      The task name (or empty)
+     * @param attempt   The task attempt UUID (or empty)
+     * @param status    The task attempt status (or empty)
+     * @param failures  The number of failures (or 0)
+     * @param data      The JSON data (or empty)
+     */
+    void append(Uint64 session, Kind kind, const std::string& task, const std::string& attempt,
+                const std::string& status, Sint32 failures, const std::string& data);
+
+    /**
+     * Seals the current block (if it is not empty) and sends it to disk.
+     *
+     * This method does not wait for the block to be written.
+     */
+    void flush();
+
+private:
+    /**
+     * Writes the given block to the log file.
+     *
+     * This method is only called on the writer thread.
+     *
+     * @param block The block to write
+     */
+    void write(const Block& block);
+
+    /**
+     * Writes the given string column to the log file.
+     *
+     * This method is only called on the writer thread.
+     *
+     * @param column    The column to write
+     */
+    void write(const StringColumn& column);
+};
+
+#endif /* __IS_EVENT_LOG_H__ */
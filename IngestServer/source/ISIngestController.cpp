@@ -0,0 +1,631 @@
+//
+//  ISIngestController.cpp
+//  Analytics Ingest Server
+//
+//  This controller implements the analytics protocol on top of a CUGL
+//  WebSocketServer. It speaks exactly the same protocol as the Django
+//  consumer (init, task, task_attempt, sync_task_attempt, action and batch,
+//  in either JSON or the binary wire format), so any AnalyticsConnection can
+//  connect to it unchanged. However, instead of querying a database for every
+//  message, it keeps session state in memory and writes events to a columnar
+//  log in batches.
+//
+//  Author: Kidus Zegeye
+//  Version: 1/15/25
+//
+#include "ISIngestController.h"
+#include <chrono>
+
+using namespace cugl;
+using namespace cugl::netcode;
+using namespace cugl::netcode::analytics;
+
+/** The default number of messages buffered between updates */
+#define SERVER_BUFFER   8192
+/** The default number of rows in a log block */
+#define BLOCK_ROWS      4096
+/** The default time (in seconds) before a partial block is written */
+#define FLUSH_INTERVAL  1.0f
+/** The default directory of the event log */
+#define LOG_DIRECTORY   "ingest"
+
+#pragma mark Constructors
+/**
+ * Creates a new ingest controller with the default values.
+ *
+ * This constructor does not allocate any objects or start the server.
+ * This allows us to use the object without a heap pointer.
+ */
+IngestController::IngestController() :
+_nextSession(1),
+_acknowledge(true),
+_binary(true),
+_flushInterval(FLUSH_INTERVAL),
+_elapsed(0) {
+}
+
+/**
+ * Disposes of all (non-static) resources allocated to this controller.
+ *
+ * This stops the server, ends every session and closes the event log.
+ */
+void IngestController::dispose() {
+    if (_server != nullptr) {
+        _server->onDisconnect(nullptr);
+        _server->stop();
+        _server = nullptr;
+    }
+    if (_log != nullptr) {
+        std::vector<std::string> clients;
+        clients.reserve(_sessions.size());
+        for (auto it = _sessions.begin(); it != _sessions.end(); ++it) {
+            clients.push_back(it->first);
+        }
+        for (auto it = clients.begin(); it != clients.end(); ++it) {
+            endSession(*it);
+        }
+        _log->dispose();
+        _log = nullptr;
+    }
+    _sessions.clear();
+    _tasks.clear();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closed.clear();
+    }
+}
+
+/**
+ * Initializes the controller and starts the server.
+ *
+ * The JSON value should contain the websocket settings (see
+ * {@link cugl::netcode::WebSocketConfig}) together with the following
+ * optional ingest settings.
+ *
+ *      "log directory":  The directory of the event log (relative to the save directory)
+ *      "block rows":     The number of rows in a log block
+ *      "flush interval": The maximum time (in seconds) before a partial block is written
+ *      "acknowledge":    Whether to answer successful messages
+ *      "binary":         Whether to accept the binary wire format
+ *
+ * @param json  The server settings
+ *
+ * @return true if the controller was initialized successfully
+ */
+bool IngestController::init(const std::shared_ptr<JsonValue>& json) {
+    if (json == nullptr) {
+        CULogError("Missing ingest server settings");
+        return false;
+    }
+
+    WebSocketConfig config(json);
+    if (!json->has("buffer size")) {
+        // Messages are only polled once a frame, so we need a deep buffer
+        config.bufferSize = SERVER_BUFFER;
+    }
+    _acknowledge = json->getBool("acknowledge",true);
+    _binary = json->getBool("binary",true);
+    _flushInterval = json->getFloat("flush interval",FLUSH_INTERVAL);
+    int rows = json->getInt("block rows",BLOCK_ROWS);
+
+    std::string directory = json->getString("log directory",LOG_DIRECTORY);
+    directory = filetool::join_path({Application::get()->getSaveDirectory(),directory});
+    if (!filetool::file_exists(directory) && !filetool::dir_create(directory)) {
+        CULogError("Could not create log directory %s",directory.c_str());
+        return false;
+    }
+
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    Uint64 seconds = (Uint64)std::chrono::duration_cast<std::chrono::seconds>(now).count();
+    std::string path = filetool::join_path({directory,"events-"+std::to_string(seconds)+".col"});
+    _log = EventLog::alloc(path,rows > 0 ? rows : BLOCK_ROWS);
+    if (_log == nullptr) {
+        CULogError("Could not open event log %s",path.c_str());
+        return false;
+    }
+
+    _server = WebSocketServer::alloc(config);
+    if (_server == nullptr) {
+        CULogError("Could not create websocket server on port %d",config.port);
+        dispose();
+        return false;
+    }
+    _server->onDisconnect([this](const std::string client, const std::string path) {
+        onDisconnect(client,path);
+    });
+    _server->start();
+    CULog("Ingest server listening on port %d",config.port);
+    CULog("Logging events to %s",path.c_str());
+    return true;
+}
+
+#pragma mark -
+#pragma mark Gameplay Handling
+/**
+ * Updates the controller.
+ *
+ * This handles every message received since the last update, and then
+ * ends the sessions of any clients that disconnected. It also writes the
+ * current block of the event log if the flush interval has passed, so
+ * that events never wait long on a quiet server.
+ *
+ * @param timestep  The amount of time (in seconds) since the last frame
+ */
+void IngestController::update(float timestep) {
+    if (_server == nullptr) {
+        return;
+    }
+
+    // Take the disconnects first, so their last messages are handled below
+    std::vector<std::string> closed;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        closed.swap(_closed);
+    }
+    _server->receive([this](const std::string client, const std::vector<std::byte>& message, Uint64 time) {
+        onReceipt(client,message,time);
+    });
+    for (auto it = closed.begin(); it != closed.end(); ++it) {
+        endSession(*it);
+    }
+
+    _elapsed += timestep;
+    if (_elapsed >= _flushInterval) {
+        _log->flush();
+        _elapsed = 0;
+    }
+}
+
+#pragma mark -
+#pragma mark Callbacks
+/**
+ * Called when a client disconnects from the server.
+ *
+ * This callback may be invoked on the network thread. It only records the
+ * client, so that {@link update} can end the session after handling the
+ * last of its messages.
+ *
+ * @param client    The client address
+ * @param path      The connection path
+ */
+void IngestController::onDisconnect(const std::string client, const std::string) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _closed.push_back(client);
+}
+
+/**
+ * Ends the session of the given client.
+ *
+ * Any pending task attempts are preempted.
+ *
+ * @param client    The client address
+ */
+void IngestController::endSession(const std::string& client) {
+    auto it = _sessions.find(client);
+    if (it == _sessions.end()) {
+        return;
+    }
+
+    std::shared_ptr<Session> session = it->second;
+    for (auto jt = session->attempts.begin(); jt != session->attempts.end(); ++jt) {
+        if (jt->second == "pending") {
+            jt->second = "preempted";
+            _log->append(session->id, EventLog::Kind::SYNC_TASK_ATTEMPT, "", jt->first,
+                         jt->second, 0, "");
+        }
+    }
+    _log->append(session->id, EventLog::Kind::SESSION_END, "", "", "", 0, "");
+    _sessions.erase(it);
+}
+
+/**
+ * Called for each message received by the server.
+ *
+ * The session is created on the first message from a client.
+ *
+ * @param client    The client address
+ * @param message   The message bytes
+ * @param time      The time the message was received
+ */
+void IngestController::onReceipt(const std::string client, const std::vector<std::byte>& message,
+                                 Uint64) {
+    std::shared_ptr<Session> session;
+    auto it = _sessions.find(client);
+    if (it == _sessions.end()) {
+        session = std::make_shared<Session>(_nextSession++,client);
+        _sessions.emplace(client,session);
+    } else {
+        session = it->second;
+    }
+
+    std::shared_ptr<JsonValue> json = nullptr;
+    if (AnalyticsCodec::isBinary(message)) {
+        if (session->codec == nullptr) {
+            error(*session, "Invalid binary message: binary format was not requested. Not processing request.");
+            return;
+        } else if (session->codec->readDictionary(message)) {
+            // Dictionary updates have no response
+            return;
+        }
+
+        _transcoded.reset();
+        if (!session->codec->transcode(message,_transcoded)) {
+            error(*session, "Invalid binary message. Not processing request.");
+            return;
+        }
+        json = JsonValue::allocWithJson(_transcoded.toString());
+    } else {
+        std::string text(reinterpret_cast<const char*>(message.data()),message.size());
+        size_t pos = text.find_first_not_of(" \t\r\n");
+        if (pos != std::string::npos && text[pos] == '{') {
+            json = JsonValue::allocWithJson(text);
+        }
+    }
+
+    if (json == nullptr || !json->isObject()) {
+        error(*session, "Invalid message. Not processing request.");
+        return;
+    }
+    dispatch(*session,json,false);
+}
+
+#pragma mark -
+#pragma mark Message Handling
+/**
+ * Routes a single decoded message to the handler for its type.
+ *
+ * @param session   The client session
+ * @param message   The message with the message_type and message_payload fields
+ * @param nested    Whether this message is inside of a batch
+ */
+void IngestController::dispatch(Session& session, const std::shared_ptr<JsonValue>& message,
+                                bool nested) {
+    if (!checkFields(session, message, {"message_type", "message_payload"})) {
+        return;
+    }
+
+    std::string type = message->get("message_type")->asString();
+    std::shared_ptr<JsonValue> payload = message->get("message_payload");
+    if (type == "init") {
+        handleInit(session, payload);
+    } else if (type == "task") {
+        handleTask(session, payload);
+    } else if (type == "task_attempt") {
+        handleTaskAttempt(session, payload);
+    } else if (type == "sync_task_attempt") {
+        handleSyncTaskAttempt(session, payload);
+    } else if (type == "action") {
+        handleAction(session, payload);
+    } else if (type == "batch") {
+        if (nested) {
+            error(session, "Invalid batched message. Not processing message.");
+        } else {
+            handleBatch(session, payload);
+        }
+    }
+}
+
+/**
+ * Handles an `init` message, initializing the session.
+ *
+ * @param session   The client session
+ * @param payload   The message payload
+ */
+void IngestController::handleInit(Session& session, const std::shared_ptr<JsonValue>& payload) {
+    if (!checkFields(session, payload, {"organization_name", "game_name", "version_number",
+                                        "vendor_id", "platform"})) {
+        return;
+    }
+
+    session.organization = payload->getString("organization_name");
+    session.game = payload->getString("game_name");
+    session.version = payload->getString("version_number");
+    session.vendor = payload->getString("vendor_id");
+    session.platform = payload->getString("platform");
+    if (!session.initialized) {
+        session.initialized = true;
+        _log->append(session.id, EventLog::Kind::SESSION_START, "", "", "", 0,
+                     payload->toString(false));
+    }
+
+    // The response must be sent before binary messages can arrive
+    bool binary = _binary && payload->getBool("binary",false);
+    if (binary && session.codec == nullptr) {
+        session.codec = AnalyticsCodec::alloc();
+    }
+
+    beginResponse("Init recorded");
+    _response.writeKey("data");
+    _response.beginObject();
+    _response.writeKey("session");
+    _response.beginObject();
+    _response.writeKey("id");
+    _response.writeSint64((Sint64)session.id);
+    _response.endObject();
+    _response.endObject();
+    if (binary) {
+        _response.writeKey("binary");
+        _response.writeBool(true);
+    }
+    if (payload->getBool("delta",false)) {
+        _response.writeKey("delta");
+        _response.writeBool(true);
+    }
+    endResponse(session);
+}
+
+/**
+ * Handles a `task` message, adding the task to the game.
+ *
+ * @param session   The client session
+ * @param payload   The message payload
+ */
+void IngestController::handleTask(Session& session, const std::shared_ptr<JsonValue>& payload) {
+    if (!checkFields(session, payload, {"task_name"}) || !checkInitialized(session)) {
+        return;
+    }
+
+    std::string name = payload->getString("task_name");
+    if (_tasks[session.getGameKey()].insert(name).second) {
+        _log->append(session.id, EventLog::Kind::TASK, name, "", "", 0, "");
+    }
+    acknowledge(session, "Task recorded", "task_name", name);
+}
+
+/**
+ * Handles a `task_attempt` message, adding the task attempt to the session.
+ *
+ * @param session   The client session
+ * @param payload   The message payload
+ */
+void IngestController::handleTaskAttempt(Session& session, const std::shared_ptr<JsonValue>& payload) {
+    if (!checkFields(session, payload, {"task_name", "task_attempt_uuid", "status",
+                                        "statistics", "num_failures"}) ||
+        !checkInitialized(session)) {
+        return;
+    }
+
+    std::string name = payload->getString("task_name");
+    auto tasks = _tasks.find(session.getGameKey());
+    if (tasks == _tasks.end() || tasks->second.find(name) == tasks->second.end()) {
+        error(session, "Task does not exist: '"+name+"'. Not processing request.");
+        return;
+    }
+
+    std::string status = payload->getString("status");
+    if (!Session::isStatus(status)) {
+        error(session, "Invalid status: '"+status+"'. Not processing request.");
+        return;
+    }
+
+    std::string uuid = payload->getString("task_attempt_uuid");
+    session.attempts[uuid] = status;
+    session.versions[uuid] = 0;
+    _log->append(session.id, EventLog::Kind::TASK_ATTEMPT, name, uuid, status,
+                 payload->getInt("num_failures"), payload->get("statistics")->toString(false));
+    acknowledge(session, "Task Attempt recorded", "task_attempt_uuid", uuid);
+}
+
+/**
+ * Handles a `sync_task_attempt` message, updating an existing task attempt.
+ *
+ * A message with a `patch` instead of the full statistics must have the
+ * version following the last one received. Otherwise the client is asked
+ * to resend the full statistics.
+ *
+ * @param session   The client session
+ * @param payload   The message payload
+ */
+void IngestController::handleSyncTaskAttempt(Session& session, const std::shared_ptr<JsonValue>& payload) {
+    bool patch = payload->has("patch");
+    std::vector<std::string> fields = {"task_attempt_uuid", "status", "num_failures"};
+    if (patch) {
+        fields.push_back("patch");
+        fields.push_back("version");
+    } else {
+        fields.push_back("statistics");
+    }
+    if (!checkFields(session, payload, fields)) {
+        return;
+    }
+
+    std::string status = payload->getString("status");
+    if (!Session::isStatus(status)) {
+        error(session, "Invalid status: '"+status+"'. Not processing request.");
+        return;
+    }
+
+    std::string uuid = payload->getString("task_attempt_uuid");
+    auto it = session.attempts.find(uuid);
+    if (it == session.attempts.end()) {
+        error(session, "Task Attempt not found: "+uuid+". Not processing request.");
+        return;
+    } else if (Session::isTerminal(it->second) && it->second != status) {
+        error(session, "Can not change already ended Task Attempt status: "+it->second+
+                       " != "+status+". Not processing request.");
+        return;
+    }
+
+    Uint32& version = session.versions[uuid];
+    Uint32 next = (Uint32)payload->getLong("version",version);
+    if (patch && next != version+1) {
+        _response.reset();
+        _response.beginObject();
+        _response.writeKey("error");
+        _response.writeString("Task Attempt version gap: "+std::to_string(version)+" + 1 != "+
+                              std::to_string(next)+". Not processing request.");
+        _response.writeKey("resync");
+        _response.writeBool(true);
+        _response.writeKey("task_attempt_uuid");
+        _response.writeString(uuid);
+        _response.writeKey("version");
+        _response.writeSint64(next);
+        _response.endObject();
+        _server->sendTo(session.client, _response.serialize());
+        return;
+    }
+
+    it->second = status;
+    version = next;
+    if (patch) {
+        _log->append(session.id, EventLog::Kind::PATCH_TASK_ATTEMPT, "", uuid, status,
+                     payload->getInt("num_failures"), payload->get("patch")->toString(false));
+    } else {
+        _log->append(session.id, EventLog::Kind::SYNC_TASK_ATTEMPT, "", uuid, status,
+                     payload->getInt("num_failures"), payload->get("statistics")->toString(false));
+    }
+    acknowledge(session, "Task Attempt synced", "task_attempt_uuid", uuid);
+}
+
+/**
+ * Handles an `action` message, recording the action.
+ *
+ * @param session   The client session
+ * @param payload   The message payload
+ */
+void IngestController::handleAction(Session& session, const std::shared_ptr<JsonValue>& payload) {
+    if (!checkFields(session, payload, {"data", "task_attempt_uuids"}) || !checkInitialized(session)) {
+        return;
+    }
+
+    _log->append(session.id, EventLog::Kind::ACTION, "", payload->get("task_attempt_uuids")->toString(false),
+                 "", 0, payload->get("data")->toString(false));
+    acknowledge(session, "Action recorded", "session", std::to_string(session.id));
+}
+
+/**
+ * Handles a `batch` message, dispatching each message in order.
+ *
+ * @param session   The client session
+ * @param payload   The message payload
+ */
+void IngestController::handleBatch(Session& session, const std::shared_ptr<JsonValue>& payload) {
+    if (!checkFields(session, payload, {"messages"})) {
+        return;
+    }
+
+    std::shared_ptr<JsonValue> messages = payload->get("messages");
+    for (int ii = 0; ii < (int)messages->size(); ii++) {
+        std::shared_ptr<JsonValue> message = messages->get(ii);
+        if (!message->isObject()) {
+            error(session, "Invalid batched message. Not processing message.");
+            continue;
+        }
+        dispatch(session, message, true);
+    }
+}
+
+#pragma mark -
+#pragma mark Helpers
+/**
+ * Returns true if the payload has all of the given fields.
+ *
+ * Otherwise, this method sends an error to the client. As with the Django
+ * server, a field with a null value counts as missing.
+ *
+ * @param session   The client session
+ * @param payload   The message payload
+ * @param fields    The required fields
+ *
+ * @return true if the payload has all of the given fields.
+ */
+bool IngestController::checkFields(Session& session, const std::shared_ptr<JsonValue>& payload,
+                                   const std::vector<std::string>& fields) {
+    std::string missing;
+    for (auto it = fields.begin(); it != fields.end(); ++it) {
+        std::shared_ptr<JsonValue> value = payload->isObject() ? payload->get(*it) : nullptr;
+        if (value == nullptr || value->isNull()) {
+            if (!missing.empty()) {
+                missing.append(", ");
+            }
+            missing.append(*it);
+        }
+    }
+
+    if (!missing.empty()) {
+        error(session, "Missing fields: "+missing+". Not processing request.");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Returns true if the session has been initialized.
+ *
+ * Otherwise, this method sends an error to the client.
+ *
+ * @param session   The client session
+ *
+ * @return true if the session has been initialized.
+ */
+bool IngestController::checkInitialized(Session& session) {
+    if (!session.initialized) {
+        error(session, "Need to reinitialize connection");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Starts a response with the given message.
+ *
+ * This writes the message and leaves the response object open. The caller
+ * should write any other fields and then call {@link endResponse}.
+ *
+ * @param message   The response message
+ */
+void IngestController::beginResponse(const std::string& message) {
+    _response.reset();
+    _response.beginObject();
+    _response.writeKey("message");
+    _response.writeString(message);
+}
+
+/**
+ * Finishes the current response and sends it to the given session.
+ *
+ * @param session   The client session
+ */
+void IngestController::endResponse(Session& session) {
+    _response.endObject();
+    _server->sendTo(session.client, _response.serialize());
+}
+
+/**
+ * Sends an acknowledgement with a single data field.
+ *
+ * Nothing is sent unless acknowledgements are enabled.
+ *
+ * @param session   The client session
+ * @param message   The response message
+ * @param key       The data field
+ * @param value     The data value
+ */
+void IngestController::acknowledge(Session& session, const std::string& message,
+                                   const std::string& key, const std::string& value) {
+    if (!_acknowledge) {
+        return;
+    }
+    beginResponse(message);
+    _response.writeKey("data");
+    _response.beginObject();
+    _response.writeKey(key);
+    _response.writeString(value);
+    _response.endObject();
+    endResponse(session);
+}
+
+/**
+ * Sends an error response to the given session.
+ *
+ * @param session   The client session
+ * @param error     The error message
+ */
+void IngestController::error(Session& session, const std::string& error) {
+    _response.reset();
+    _response.beginObject();
+    _response.writeKey("error");
+    _response.writeString(error);
+    _response.endObject();
+    _server->sendTo(session.client, _response.serialize());
+}
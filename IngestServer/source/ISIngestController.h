@@ -0,0 +1,290 @@
+//
+//  ISIngestController.h
+//  Analytics Ingest Server
+//
+//  This controller implements the analytics protocol on top of a CUGL
+//  WebSocketServer. It speaks exactly the same protocol as the Django
+//  consumer (init, task, task_attempt, sync_task_attempt, action and batch,
+//  in either JSON or the binary wire format), so any AnalyticsConnection can
+//  connect to it unchanged. However, instead of querying a database for every
+//  message, it keeps session state in memory and writes events to a columnar
+//  log in batches.
+//
+//  Author: Kidus Zegeye
+//  Version: 1/15/25
+//
+#ifndef __IS_INGEST_CONTROLLER_H__
+#define __IS_INGEST_CONTROLLER_H__
+#include <cugl/core/cu_base.h>
+#include <cugl/netcode/cu_netcode.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "ISEventLog.h"
+#include "ISSession.h"
+
+/**
+ * This class is the analytics protocol handler of the ingest server.
+ *
+ * Messages are polled from the server in {@link update}, which preserves their
+ * order, and are handled on the main thread. Each message is validated exactly
+ * as the Django consumer does, answered with the same `message` (or `error`) response, and
+ * recorded as a row in the {@link EventLog}. Tasks are shared by every
+ * session of the same game, while task attempts belong to a single session.
+ */
+class IngestController {
+protected:
+    /** The websocket server */
+    std::shared_ptr<cugl::netcode::WebSocketServer> _server;
+    /** The event log */
+    std::shared_ptr<EventLog> _log;
+    /** The active sessions, indexed by client address */
+    std::unordered_map<std::string, std::shared_ptr<Session>> _sessions;
+    /** The clients that disconnected since the last update */
+    std::vector<std::string> _closed;
+    /** A mutex to protect the disconnected clients */
+    std::mutex _mutex;
+    /** The tasks of each game, indexed by game key */
+    std::unordered_map<std::string, std::unordered_set<std::string>> _tasks;
+    /** The id of the next session */
+    Uint64 _nextSession;
+    /** Whether to answer successful messages (errors are always answered) */
+    bool _acknowledge;
+    /** Whether to accept the binary wire format */
+    bool _binary;
+    /** The time (in seconds) between flushes of a partial block */
+    float _flushInterval;
+    /** The time (in seconds) since the last flush */
+    float _elapsed;
+    /** The reusable encoder for responses */
+    cugl::netcode::JsonSerializer _response;
+    /** The reusable encoder for transcoded binary messages */
+    cugl::netcode::JsonSerializer _transcoded;
+
+public:
+#pragma mark Constructors
+    /**
+     * Creates a new ingest controller with the default values.
+     *
+     * This constructor does not allocate any objects or start the server.
+     * This allows us to use the object without a heap pointer.
+     */
+    IngestController();
+
+    /**
+     * Disposes of all (non-static) resources allocated to this controller.
+     */
+    ~IngestController() { dispose(); }
+
+    /**
+     * Disposes of all (non-static) resources allocated to this controller.
+     *
+     * This stops the server, ends every session and closes the event log.
+     */
+    void dispose();
+
+    /**
+     * Initializes the controller and starts the server.
+     *
+     * The JSON value should contain the websocket settings (see
+     * {@link cugl::netcode::WebSocketConfig}) together with the following
+     * optional ingest settings.
+     *
+     *      "log directory":  The directory of the event log (relative to the save directory)
+     *      "block rows":     The number of rows in a log block
+     *      "flush interval": The maximum time (in seconds) before a partial block is written
+     *      "acknowledge":    Whether to answer successful messages
+     *      "binary":         Whether to accept the binary wire format
+     *
+     * @param json  The server settings
+     *
+     * @return true if the controller was initialized successfully
+     */
+    bool init(const std::shared_ptr<cugl::JsonValue>& json);
+
+#pragma mark Gameplay Handling
+    /**
+     * Updates the controller.
+     *
+     * This handles every message received since the last update, and then
+     * ends the sessions of any clients that disconnected. It also writes the
+     * current block of the event log if the flush interval has passed, so
+     * that events never wait long on a quiet server.
+     *
+     * @param timestep  The amount of time (in seconds) since the last frame
+     */
+    void update(float timestep);
+
+    /**
+     * Returns the number of active sessions.
+     *
+     * @return the number of active sessions.
+     */
+    size_t getSessionCount() const { return _sessions.size(); }
+
+private:
+#pragma mark Callbacks
+    /**
+     * Called when a client disconnects from the server.
+     *
+     * This callback may be invoked on the network thread. It only records the
+     * client, so that {@link update} can end the session after handling the
+     * last of its messages.
+     *
+     * @param client    The client address
+     * @param path      The connection path
+     */
+    void onDisconnect(const std::string client, const std::string path);
+
+    /**
+     * Ends the session of the given client.
+     *
+     * Any pending task attempts are preempted.
+     *
+     * @param client    The client address
+     */
+    void endSession(const std::string& client);
+
+    /**
+     * Called for each message received by the server.
+     *
+     * The session is created on the first message from a client.
+     *
+     * @param client    The client address
+     * @param message   The message bytes
+     * @param time      The time the message was received
+     */
+    void onReceipt(const std::string client, const std::vector<std::byte>& message, Uint64 time);
+
+#pragma mark Message Handling
+    /**
+     * Routes a single decoded message to the handler for its type.
+     *
+     * @param session   The client session
+     * @param message   The message with the message_type and message_payload fields
+     * @param nested    Whether this message is inside of a batch
+     */
+    void dispatch(Session& session, const std::shared_ptr<cugl::JsonValue>& message, bool nested);
+
+    /**
+     * Handles an `init` message, initializing the session.
+     *
+     * @param session   The client session
+     * @param payload   The message payload
+     */
+    void handleInit(Session& session, const std::shared_ptr<cugl::JsonValue>& payload);
+
+    /**
+     * Handles a `task` message, adding the task to the game.
+     *
+     * @param session   The client session
+     * @param payload   The message payload
+     */
+    void handleTask(Session& session, const std::shared_ptr<cugl::JsonValue>& payload);
+
+    /**
+     * Handles a `task_attempt` message, adding the task attempt to the session.
+     *
+     * @param session   The client session
+     * @param payload   The message payload
+     */
+    void handleTaskAttempt(Session& session, const std::shared_ptr<cugl::JsonValue>& payload);
+
+    /**
+     * Handles a `sync_task_attempt` message, updating an existing task attempt.
+     *
+     * A message with a `patch` instead of the full statistics must have the
+     * version following the last one received. Otherwise the client is asked
+     * to resend the full statistics.
+     *
+     * @param session   The client session
+     * @param payload   The message payload
+     */
+    void handleSyncTaskAttempt(Session& session, const std::shared_ptr<cugl::JsonValue>& payload);
+
+    /**
+     * Handles an `action` message, recording the action.
+     *
+     * @param session   The client session
+     * @param payload   The message payload
+     */
+    void handleAction(Session& session, const std::shared_ptr<cugl::JsonValue>& payload);
+
+    /**
+     * Handles a `batch` message, dispatching each message in order.
+     *
+     * @param session   The client session
+     * @param payload   The message payload
+     */
+    void handleBatch(Session& session, const std::shared_ptr<cugl::JsonValue>& payload);
+
+#pragma mark Helpers
+    /**
+     * Returns true if the payload has all of the given fields.
+     *
+     * Otherwise, this method sends an error to the client. As with the Django
+     * server, a field with a null value counts as missing.
+     *
+     * @param session   The client session
+     * @param payload   The message payload
+     * @param fields    The required fields
+     *
+     * @return true if the payload has all of the given fields.
+     */
+    bool checkFields(Session& session, const std::shared_ptr<cugl::JsonValue>& payload,
+                     const std::vector<std::string>& fields);
+
+    /**
+     * Returns true if the session has been initialized.
+     *
+     * Otherwise, this method sends an error to the client.
+     *
+     * @param session   The client session
+     *
+     * @return true if the session has been initialized.
+     */
+    bool checkInitialized(Session& session);
+
+    /**
+     * Starts a response with the given message.
+     *
+     * This writes the message and leaves the response object open. The caller
+     * should write any other fields and then call {@link endResponse}.
+     *
+     * @param message   The response message
+     */
+    void beginResponse(const std::string& message);
+
+    /**
+     * Finishes the current response and sends it to the given session.
+     *
+     * @param session   The client session
+     */
+    void endResponse(Session& session);
+
+    /**
+     * Sends an acknowledgement with a single data field.
+     *
+     * Nothing is sent unless acknowledgements are enabled.
+     *
+     * @param session   The client session
+     * @param message   The response message
+     * @param key       The data field
+     * @param value     The data value
+     */
+    void acknowledge(Session& session, const std::string& message,
+                     const std::string& key, const std::string& value);
+
+    /**
+     * Sends an error response to the given session.
+     *
+     * @param session   The client session
+     * @param error     The error message
+     */
+    void error(Session& session, const std::string& error);
+};
+
+#endif /* __IS_INGEST_CONTROLLER_H__ */
@@ -0,0 +1,102 @@
+//
+//  ISSession.h
+//  Analytics Ingest Server
+//
+//  This class holds the in-memory state of a single client connection. The
+//  Django server looks this information up in Postgres for every message.
+//  The ingest server keeps it in memory instead, and only writes events.
+//
+//  Author: Kidus Zegeye
+//  Version: 1/15/25
+//
+#ifndef __IS_SESSION_H__
+#define __IS_SESSION_H__
+#include <cugl/core/cu_base.h>
+#include <cugl/netcode/cu_netcode.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+/**
+ * This class represents the session of a single client connection.
+ *
+ * A session is created with the first message from a client, but it is not
+ * initialized until the client sends an `init` message. The session remembers the game
+ * metadata from that message, as well as the status of every task attempt
+ * added on this connection. When the client disconnects, any pending task
+ * attempts are preempted.
+ */
+class Session {
+public:
+    /** The unique id of this session (assigned by the server) */
+    Uint64 id;
+    /** The client address of this session */
+    std::string client;
+    /** Whether the client has sent an init message */
+    bool initialized;
+    /** The name of the game's organization */
+    std::string organization;
+    /** The name of the game */
+    std::string game;
+    /** The version number of the game */
+    std::string version;
+    /** The unique vendor id of the player's device */
+    std::string vendor;
+    /** The hardware platform of the player's device */
+    std::string platform;
+    /** The codec for binary messages (nullptr if the client did not ask for binary) */
+    std::shared_ptr<cugl::netcode::analytics::AnalyticsCodec> codec;
+    /** The status of each task attempt added on this connection, indexed by UUID */
+    std::unordered_map<std::string, std::string> attempts;
+    /** The statistics version of each task attempt added on this connection, indexed by UUID */
+    std::unordered_map<std::string, Uint32> versions;
+
+    /**
+     * Creates a new uninitialized session.
+     *
+     * @param id        The unique id of this session
+     * @param client    The client address of this session
+     */
+    Session(Uint64 id, const std::string& client) :
+    id(id),
+    client(client),
+    initialized(false),
+    codec(nullptr) {}
+
+    /**
+     * Returns the key identifying the game (and version) of this session.
+     *
+     * Tasks are shared by every session of the same game.
+     *
+     * @return the key identifying the game (and version) of this session.
+     */
+    std::string getGameKey() const {
+        return organization+"\n"+game+"\n"+version;
+    }
+
+    /**
+     * Returns true if the given status is a valid task attempt status.
+     *
+     * @param status    The task attempt status
+     *
+     * @return true if the given status is a valid task attempt status.
+     */
+    static bool isStatus(const std::string& status) {
+        return status == "not_started" || status == "pending" || isTerminal(status);
+    }
+
+    /**
+     * Returns true if the given status is a terminal task attempt status.
+     *
+     * Task attempts with a terminal status cannot change status afterwards.
+     *
+     * @param status    The task attempt status
+     *
+     * @return true if the given status is a terminal task attempt status.
+     */
+    static bool isTerminal(const std::string& status) {
+        return status == "succeeded" || status == "failed" || status == "preempted";
+    }
+};
+
+#endif /* __IS_SESSION_H__ */
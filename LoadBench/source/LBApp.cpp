@@ -0,0 +1,217 @@
+//
+//  LBApp.cpp
+//  Load Benchmark
+//
+//  This is the root class for the load benchmark. The benchmark is a headless
+//  CUGL application, so it has no window or scenes. It generates a synthetic
+//  asset directory, and then times how long the asset manager takes to load
+//  it with different numbers of worker threads.
+//
+//  Author: Kidus Zegeye
+//  Version: 3/9/25
+//
+#include "LBApp.h"
+#include <algorithm>
+
+using namespace cugl;
+
+/** The benchmark settings file (in the asset directory) */
+#define SETTINGS_FILE   "json/bench.json"
+/** The key of the benchmark settings in the settings file */
+#define SETTINGS_KEY    "load bench"
+/** The folder (in the asset directory) for the generated assets */
+#define BENCH_FOLDER    "bench"
+
+#pragma mark Benchmark
+/**
+ * Generates the synthetic asset directory.
+ *
+ * This writes the given number of JSON files (of about the given size) to
+ * the folder "bench" in the asset directory. The files are only written
+ * if they are missing, so later launches reuse them.
+ *
+ * @param files     The number of files
+ * @param kilobytes The approximate size of each file
+ *
+ * @return true if the asset directory was generated
+ */
+bool LoadApp::generate(size_t files, size_t kilobytes) {
+    std::string root = getAssetDirectory()+BENCH_FOLDER;
+    if (!filetool::is_dir(root) && !filetool::dir_create(root)) {
+        CULogError("Could not create the folder %s",root.c_str());
+        return false;
+    }
+
+    std::shared_ptr<JsonValue> category = JsonValue::allocObject();
+    _bytes = 0;
+    for(size_t ii = 0; ii < files; ii++) {
+        std::string key  = strtool::format("file%03zu",ii);
+        std::string path = std::string(BENCH_FOLDER)+"/"+key+".json";
+        std::string full = getAssetDirectory()+path;
+        category->appendValue(key,path);
+
+        if (!filetool::file_exists(full)) {
+            // A long array of small records, like a level or an animation
+            std::string text = "{\"entries\":[";
+            for(size_t jj = 0; text.size() < kilobytes*1024; jj++) {
+                text += strtool::format("%s{\"id\":%zu,\"name\":\"entry%zu\",\"position\":[%.3f,%.3f],"
+                                        "\"visible\":%s,\"tags\":[\"static\",\"layer%zu\"]}",
+                                        jj ? "," : "", jj, jj, jj*0.25f, ii*1.5f,
+                                        jj % 2 ? "true" : "false", jj % 8);
+            }
+            text += "]}";
+
+            std::shared_ptr<TextWriter> writer = TextWriter::alloc(full);
+            if (writer == nullptr) {
+                CULogError("Could not write %s",full.c_str());
+                return false;
+            }
+            writer->write(text);
+            writer->close();
+        }
+
+        SDL_RWops* rw = SDL_RWFromFile(full.c_str(), "rb");
+        if (rw != nullptr) {
+            _bytes += (size_t)SDL_RWsize(rw);
+            SDL_RWclose(rw);
+        }
+    }
+
+    _directory = JsonValue::allocObject();
+    _directory->appendChild("jsons",category);
+    return true;
+}
+
+/**
+ * Starts the next run of the benchmark.
+ *
+ * Synchronous runs finish immediately. Asynchronous runs finish in a later
+ * call to {@link update}. This method quits the application if there are
+ * no more runs.
+ */
+void LoadApp::startRun() {
+    if (_config >= _workers.size()) {
+        quit();
+        return;
+    }
+
+    Uint32 workers = _workers[_config];
+    _assets = (workers == 0 ? AssetManager::alloc() : AssetManager::alloc(workers));
+    _assets->attach<JsonValue>(JsonLoader::alloc()->getHook());
+    _assets->setFrameBudget(_budget);
+
+    _start.mark();
+    if (workers == 0) {
+        _assets->loadDirectory(_directory);
+        finishRun(Timestamp().ellapsedMicros(_start));
+    } else {
+        _assets->loadDirectoryAsync(_directory, nullptr);
+    }
+}
+
+/**
+ * Records the time of the current run.
+ *
+ * @param micros    The time of the run in microseconds
+ */
+void LoadApp::finishRun(Uint64 micros) {
+    _assets->dispose();
+    _assets = nullptr;
+
+    _times.push_back(micros);
+    if (_times.size() == _runs) {
+        std::sort(_times.begin(), _times.end());
+        Uint64 median = _times[_times.size()/2];
+        if (_baseline == 0) {
+            _baseline = median;
+        }
+
+        double millis = median/1000.0;
+        double mbytes = _bytes/(1024.0*1024.0);
+        std::string label = _workers[_config] == 0 ? "sync" : strtool::format("%u workers",_workers[_config]);
+        CULog("%-10s %9.2f ms %9.1f MB/s %6.2fx",label.c_str(), millis,
+              mbytes/(millis/1000.0), ((double)_baseline)/median);
+        _times.clear();
+        _config++;
+    }
+    startRun();
+}
+
+#pragma mark Application State
+/**
+ * The method called after the application is initialized, but before running.
+ *
+ * This reads the benchmark settings, generates the asset directory and
+ * starts the first run. If the assets cannot be generated, the application
+ * quits.
+ *
+ * When overriding this method, you should call the parent method as the
+ * very last line. This ensures that the state will transition to FOREGROUND,
+ * causing the application to run.
+ */
+void LoadApp::onStartup() {
+    std::shared_ptr<JsonValue> settings = nullptr;
+    std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(SETTINGS_FILE);
+    if (reader != nullptr) {
+        std::shared_ptr<JsonValue> json = reader->readJson();
+        settings = json == nullptr ? nullptr : json->get(SETTINGS_KEY);
+        reader->close();
+    }
+    if (settings == nullptr) {
+        settings = JsonValue::allocObject();
+    }
+
+    size_t files = settings->getInt("files",256);
+    size_t kilobytes = settings->getInt("kilobytes",64);
+    _runs   = std::max(1, settings->getInt("runs",3));
+    _budget = settings->getInt("frame budget",8);
+    _workers.clear();
+    std::shared_ptr<JsonValue> workers = settings->get("workers");
+    if (workers != nullptr) {
+        for(int ii = 0; ii < workers->size(); ii++) {
+            _workers.push_back(workers->get(ii)->asInt());
+        }
+    } else {
+        _workers = { 0, 1, 2, 4 };
+    }
+
+    if (generate(files, kilobytes)) {
+        CULog("Loading %zu files (%.1f MB), median of %zu runs",
+              files, _bytes/(1024.0*1024.0), _runs);
+        startRun();
+    } else {
+        quit();
+    }
+    Application::onStartup(); // YOU MUST END with call to parent
+}
+
+/**
+ * The method called when the application is ready to quit.
+ *
+ * This releases the asset manager of any unfinished run.
+ *
+ * When overriding this method, you should call the parent method as the
+ * very last line. This ensures that the state will transition to NONE,
+ * causing the application to be deleted.
+ */
+void LoadApp::onShutdown() {
+    if (_assets != nullptr) {
+        _assets->dispose();
+        _assets = nullptr;
+    }
+    _directory = nullptr;
+    Application::onShutdown();  // YOU MUST END with call to parent
+}
+
+/**
+ * The method called to update the application data.
+ *
+ * This finishes the current run once the asset manager is done.
+ *
+ * @param timestep  The amount of time (in seconds) since the last frame
+ */
+void LoadApp::update(float timestep) {
+    if (_assets != nullptr && _assets->progress() >= 1.0f) {
+        finishRun(Timestamp().ellapsedMicros(_start));
+    }
+}
@@ -0,0 +1,138 @@
+//
+//  LBApp.h
+//  Load Benchmark
+//
+//  This is the root class for the load benchmark. The benchmark is a headless
+//  CUGL application, so it has no window or scenes. It generates a synthetic
+//  asset directory, and then times how long the asset manager takes to load
+//  it with different numbers of worker threads.
+//
+//  Author: Kidus Zegeye
+//  Version: 3/9/25
+//
+#ifndef __LB_APP_H__
+#define __LB_APP_H__
+#include <cugl/core/cu_base.h>
+#include <vector>
+
+/**
+ * This class represents the application root for the load benchmark.
+ *
+ * The benchmark loads the same asset directory several times for each worker
+ * count in the settings. A worker count of 0 loads the directory synchronously
+ * with {@link cugl::AssetManager#loadDirectory}, which is the baseline. Any
+ * other count loads it with {@link cugl::AssetManager#loadDirectoryAsync}, and
+ * a run is finished once the manager progress reaches 1. The application quits
+ * once every run is done, after logging the median time of each worker count.
+ */
+class LoadApp : public cugl::Application {
+protected:
+    /** The generated asset directory */
+    std::shared_ptr<cugl::JsonValue> _directory;
+    /** The total bytes of the generated assets */
+    size_t _bytes;
+    /** The worker counts to measure (0 for synchronous loading) */
+    std::vector<Uint32> _workers;
+    /** The number of runs for each worker count */
+    size_t _runs;
+    /** The frame budget of the asset manager in milliseconds */
+    Uint32 _budget;
+
+    /** The index of the current worker count */
+    size_t _config;
+    /** The times (in microseconds) of the runs of the current worker count */
+    std::vector<Uint64> _times;
+    /** The median time of the baseline (0 if not measured yet) */
+    Uint64 _baseline;
+    /** The asset manager of the current run (nullptr if none) */
+    std::shared_ptr<cugl::AssetManager> _assets;
+    /** The start of the current run */
+    cugl::Timestamp _start;
+
+    /**
+     * Generates the synthetic asset directory.
+     *
+     * This writes the given number of JSON files (of about the given size) to
+     * the folder "bench" in the asset directory. The files are only written
+     * if they are missing, so later launches reuse them.
+     *
+     * @param files     The number of files
+     * @param kilobytes The approximate size of each file
+     *
+     * @return true if the asset directory was generated
+     */
+    bool generate(size_t files, size_t kilobytes);
+
+    /**
+     * Starts the next run of the benchmark.
+     *
+     * Synchronous runs finish immediately. Asynchronous runs finish in a later
+     * call to {@link update}. This method quits the application if there are
+     * no more runs.
+     */
+    void startRun();
+
+    /**
+     * Records the time of the current run.
+     *
+     * @param micros    The time of the run in microseconds
+     */
+    void finishRun(Uint64 micros);
+
+public:
+    /**
+     * Creates, but does not initialize, a new application.
+     *
+     * This constructor is called by main.cpp. You will notice that, like
+     * most of the classes in CUGL, we do not do any initialization in the
+     * constructor. That is the purpose of the init() method. Separation
+     * of initialization from the constructor allows main.cpp to perform
+     * advanced configuration of the application before it starts.
+     */
+    LoadApp() : cugl::Application(), _bytes(0), _runs(0), _budget(0),
+    _config(0), _baseline(0) {}
+
+    /**
+     * Disposes of this application, releasing all resources.
+     *
+     * This destructor is called by main.cpp when the application quits.
+     * It simply calls the dispose() method in Application. There is nothing
+     * special to do here.
+     */
+    ~LoadApp() { }
+
+    /**
+     * The method called after the application is initialized, but before running.
+     *
+     * This reads the benchmark settings, generates the asset directory and
+     * starts the first run. If the assets cannot be generated, the application
+     * quits.
+     *
+     * When overriding this method, you should call the parent method as the
+     * very last line. This ensures that the state will transition to FOREGROUND,
+     * causing the application to run.
+     */
+    virtual void onStartup() override;
+
+    /**
+     * The method called when the application is ready to quit.
+     *
+     * This releases the asset manager of any unfinished run.
+     *
+     * When overriding this method, you should call the parent method as the
+     * very last line. This ensures that the state will transition to NONE,
+     * causing the application to be deleted.
+     */
+    virtual void onShutdown() override;
+
+    /**
+     * The method called to update the application data.
+     *
+     * This finishes the current run once the asset manager is done.
+     *
+     * @param timestep  The amount of time (in seconds) since the last frame
+     */
+    virtual void update(float timestep) override;
+};
+
+#endif /* __LB_APP_H__ */
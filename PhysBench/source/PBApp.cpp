@@ -0,0 +1,158 @@
+//
+//  PBApp.cpp
+//  Physics Benchmark
+//
+//  This is the root class for the physics benchmark. The benchmark is a
+//  headless CUGL application, so it has no window or scenes. It measures the
+//  per-tick cost of the NetPhysicsController passes over a large world of
+//  shared obstacles, in which only a few obstacles move each tick.
+//
+//  Author: Kidus Zegeye
+//  Version: 3/9/25
+//
+#include "PBApp.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace cugl;
+using namespace cugl::physics2;
+using namespace cugl::physics2::distrib;
+
+/** The benchmark settings file (in the asset directory) */
+#define SETTINGS_FILE   "json/bench.json"
+/** The key of the benchmark settings in the settings file */
+#define SETTINGS_KEY    "phys bench"
+/** The distance between two boxes in the grid */
+#define BOX_SPACING     9.0f
+/** The length of the tick (the network tick rate is 60 Hz) */
+#define TICK_LENGTH     (1/60.0f)
+
+#pragma mark Benchmark
+/**
+ * Creates the world, the shared obstacles and the controller.
+ *
+ * The boxes are laid out in a square grid, far enough apart that they
+ * do not touch.
+ *
+ * @param bodies    The number of shared obstacles
+ */
+void PhysApp::build(size_t bodies) {
+    size_t columns = (size_t)std::ceil(std::sqrt((double)bodies));
+    float extent = columns*BOX_SPACING;
+    _world = NetWorld::alloc(Rect(0,0,extent,extent), Vec2::ZERO);
+    _world->setLockStep(true);
+
+    _boxes.clear();
+    for(size_t ii = 0; ii < bodies; ii++) {
+        Vec2 pos(5+(ii % columns)*BOX_SPACING, 5+(ii / columns)*BOX_SPACING);
+        std::shared_ptr<BoxObstacle> box = BoxObstacle::alloc(pos, Size(1,1));
+        box->setDensity(1.0f);
+        _world->initObstacle(box);
+        box->clearSharingDirtyBits();
+        _boxes.push_back(box);
+    }
+
+    _controller = NetPhysicsController::alloc(_world, 1, true);
+    _controller->ownAll();
+}
+
+/**
+ * Simulates and measures a single network tick.
+ */
+void PhysApp::tick() {
+    typedef std::chrono::steady_clock clock;
+    for(size_t ii = _tick % _stride; ii < _boxes.size(); ii += _stride) {
+        _boxes[ii]->setLinearVelocity(Vec2(1,0));
+    }
+    _world->update(TICK_LENGTH);
+
+    clock::time_point start = clock::now();
+    _controller->packPhysObj();
+    clock::time_point packed = clock::now();
+    _controller->packPhysSync(NetPhysicsController::SyncType::FULL_SYNC);
+    clock::time_point synced = clock::now();
+    _controller->updateSimulation();
+    clock::time_point finish = clock::now();
+
+    _objTime  += std::chrono::duration<double,std::micro>(packed-start).count();
+    _syncTime += std::chrono::duration<double,std::micro>(synced-packed).count();
+    _simTime  += std::chrono::duration<double,std::micro>(finish-synced).count();
+    _events += _controller->getOutEvents().size();
+    _controller->getOutEvents().clear();
+}
+
+#pragma mark Application State
+/**
+ * The method called after the application is initialized, but before running.
+ *
+ * This reads the benchmark settings and builds the world.
+ *
+ * When overriding this method, you should call the parent method as the
+ * very last line. This ensures that the state will transition to FOREGROUND,
+ * causing the application to run.
+ */
+void PhysApp::onStartup() {
+    std::shared_ptr<JsonValue> settings = nullptr;
+    std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(SETTINGS_FILE);
+    if (reader != nullptr) {
+        std::shared_ptr<JsonValue> json = reader->readJson();
+        settings = json == nullptr ? nullptr : json->get(SETTINGS_KEY);
+        reader->close();
+    }
+    if (settings == nullptr) {
+        settings = JsonValue::allocObject();
+    }
+
+    size_t bodies = std::max(1, settings->getInt("bodies",10000));
+    float moving  = settings->getFloat("moving",0.01f);
+    _ticks  = std::max(1, settings->getInt("ticks",300));
+    _stride = moving > 0 ? std::max((size_t)1, (size_t)std::round(1/moving)) : bodies+1;
+    _tick = 0;
+
+    build(bodies);
+    CULog("Simulating %zu shared bodies (%zu moving per tick) for %zu ticks",
+          bodies, (bodies+_stride-1)/_stride, _ticks);
+    Application::onStartup(); // YOU MUST END with call to parent
+}
+
+/**
+ * The method called when the application is ready to quit.
+ *
+ * This releases the world and the controller.
+ *
+ * When overriding this method, you should call the parent method as the
+ * very last line. This ensures that the state will transition to NONE,
+ * causing the application to be deleted.
+ */
+void PhysApp::onShutdown() {
+    _controller = nullptr;
+    _boxes.clear();
+    if (_world != nullptr) {
+        _world->dispose();
+        _world = nullptr;
+    }
+    Application::onShutdown();  // YOU MUST END with call to parent
+}
+
+/**
+ * The method called to update the application data.
+ *
+ * This measures the next tick, or logs the results and quits after the
+ * last one.
+ *
+ * @param timestep  The amount of time (in seconds) since the last frame
+ */
+void PhysApp::update(float timestep) {
+    if (_tick < _ticks) {
+        tick();
+        _tick++;
+    } else if (_tick == _ticks) {
+        _tick++;
+        CULog("packPhysObj       %9.1f us per tick",_objTime/_ticks);
+        CULog("packPhysSync      %9.1f us per tick",_syncTime/_ticks);
+        CULog("updateSimulation  %9.1f us per tick",_simTime/_ticks);
+        CULog("%zu events per tick",_events/_ticks);
+        quit();
+    }
+}
@@ -0,0 +1,126 @@
+//
+//  PBApp.h
+//  Physics Benchmark
+//
+//  This is the root class for the physics benchmark. The benchmark is a
+//  headless CUGL application, so it has no window or scenes. It measures the
+//  per-tick cost of the NetPhysicsController passes over a large world of
+//  shared obstacles, in which only a few obstacles move each tick.
+//
+//  Author: Kidus Zegeye
+//  Version: 3/9/25
+//
+#ifndef __PB_APP_H__
+#define __PB_APP_H__
+#include <cugl/core/cu_base.h>
+#include <cugl/physics2/cu_physics2.h>
+#include <cugl/physics2/distrib/cu_physics2_distrib.h>
+#include <vector>
+
+/**
+ * This class represents the application root for the physics benchmark.
+ *
+ * The benchmark creates a world of shared box obstacles, all owned by this
+ * controller. Each frame is one network tick. A small fraction of the boxes
+ * (a different set each tick) is given a velocity, the world is stepped,
+ * and the benchmark times {@link NetPhysicsController#packPhysObj},
+ * {@link NetPhysicsController#packPhysSync} (with a full sync) and
+ * {@link NetPhysicsController#updateSimulation}. The outgoing events are
+ * discarded. The application quits after the last tick, logging the average
+ * time of each pass.
+ */
+class PhysApp : public cugl::Application {
+protected:
+    /** The shared physics world */
+    std::shared_ptr<cugl::physics2::distrib::NetWorld> _world;
+    /** The physics controller of the world */
+    std::shared_ptr<cugl::physics2::distrib::NetPhysicsController> _controller;
+    /** The shared obstacles */
+    std::vector<std::shared_ptr<cugl::physics2::BoxObstacle>> _boxes;
+    /** The number of boxes between two moving boxes */
+    size_t _stride;
+    /** The number of ticks to measure */
+    size_t _ticks;
+
+    /** The current tick */
+    size_t _tick;
+    /** The total time (in microseconds) of packPhysObj */
+    double _objTime;
+    /** The total time (in microseconds) of packPhysSync */
+    double _syncTime;
+    /** The total time (in microseconds) of updateSimulation */
+    double _simTime;
+    /** The total number of outgoing events */
+    size_t _events;
+
+    /**
+     * Creates the world, the shared obstacles and the controller.
+     *
+     * The boxes are laid out in a square grid, far enough apart that they
+     * do not touch.
+     *
+     * @param bodies    The number of shared obstacles
+     */
+    void build(size_t bodies);
+
+    /**
+     * Simulates and measures a single network tick.
+     */
+    void tick();
+
+public:
+    /**
+     * Creates, but does not initialize, a new application.
+     *
+     * This constructor is called by main.cpp. You will notice that, like
+     * most of the classes in CUGL, we do not do any initialization in the
+     * constructor. That is the purpose of the init() method. Separation
+     * of initialization from the constructor allows main.cpp to perform
+     * advanced configuration of the application before it starts.
+     */
+    PhysApp() : cugl::Application(), _stride(1), _ticks(0), _tick(0),
+    _objTime(0), _syncTime(0), _simTime(0), _events(0) {}
+
+    /**
+     * Disposes of this application, releasing all resources.
+     *
+     * This destructor is called by main.cpp when the application quits.
+     * It simply calls the dispose() method in Application. There is nothing
+     * special to do here.
+     */
+    ~PhysApp() { }
+
+    /**
+     * The method called after the application is initialized, but before running.
+     *
+     * This reads the benchmark settings and builds the world.
+     *
+     * When overriding this method, you should call the parent method as the
+     * very last line. This ensures that the state will transition to FOREGROUND,
+     * causing the application to run.
+     */
+    virtual void onStartup() override;
+
+    /**
+     * The method called when the application is ready to quit.
+     *
+     * This releases the world and the controller.
+     *
+     * When overriding this method, you should call the parent method as the
+     * very last line. This ensures that the state will transition to NONE,
+     * causing the application to be deleted.
+     */
+    virtual void onShutdown() override;
+
+    /**
+     * The method called to update the application data.
+     *
+     * This measures the next tick, or logs the results and quits after the
+     * last one.
+     *
+     * @param timestep  The amount of time (in seconds) since the last frame
+     */
+    virtual void update(float timestep) override;
+};
+
+#endif /* __PB_APP_H__ */
@@ -0,0 +1,201 @@
+//
+//  RBApp.cpp
+//  Receive Benchmark
+//
+//  This is the root class for the receive benchmark. The benchmark is a
+//  headless CUGL application, so it has no window or scenes. It measures the
+//  receive path of a websocket: a producer thread appends messages at a fixed
+//  rate (like the network thread), while the application drains them once a
+//  frame (like a call to WebSocket::receive).
+//
+//  Author: Kidus Zegeye
+//  Version: 3/9/25
+//
+#include "RBApp.h"
+#include <algorithm>
+
+using namespace cugl;
+
+/** The benchmark settings file (in the asset directory) */
+#define SETTINGS_FILE   "json/bench.json"
+/** The key of the benchmark settings in the settings file */
+#define SETTINGS_KEY    "recv bench"
+
+#pragma mark Benchmark
+/**
+ * Appends the messages of the current run.
+ *
+ * This is the body of the producer thread. It sends the messages on a
+ * fixed schedule, so that a slow append does not lower the rate.
+ *
+ * @param count     The number of messages
+ * @param payload   The size of each message
+ */
+void RecvApp::produce(size_t count, size_t payload) {
+    bool lockfree = isLockFree();
+    double interval = 1000000.0/_rate;
+    Timestamp start;
+    for(size_t ii = 0; ii < count && !_cancel.load(); ii++) {
+        while (Timestamp().ellapsedMicros(start) < (Uint64)(ii*interval)) {
+            std::this_thread::yield();
+        }
+
+        // The network layer hands us a fresh buffer for each message
+        std::vector<std::byte> data(payload,(std::byte)ii);
+        Timestamp begin;
+        if (lockfree) {
+            Envelope env;
+            env.timestamp = ii;
+            env.message = std::move(data);
+            _ring.push(std::move(env));
+        } else {
+            _mutexRing.append(data, ii);
+        }
+        _latency.push_back(Timestamp().ellapsedNanos(begin));
+    }
+    _finished.store(true);
+}
+
+/**
+ * Drains the buffer of the current run.
+ */
+void RecvApp::drain() {
+    if (isLockFree()) {
+        Envelope env;
+        size_t limit = _ring.size();
+        for(size_t ii = 0; ii < limit && _ring.pop(env); ii++) {
+            _received++;
+        }
+    } else {
+        std::vector<Envelope> messages;
+        _mutexRing.drain(messages);
+        _received += messages.size();
+    }
+}
+
+/**
+ * Starts the next run of the benchmark.
+ *
+ * This method quits the application if there are no more runs.
+ */
+void RecvApp::startRun() {
+    if (_config >= 2*_payloads.size()) {
+        quit();
+        return;
+    }
+
+    size_t count = (size_t)(_rate*_seconds);
+    size_t payload = _payloads[_config/2];
+    if (isLockFree()) {
+        _ring.init(_capacity);
+    } else {
+        _mutexRing.init(_capacity);
+    }
+
+    _latency.clear();
+    _latency.reserve(count);
+    _received = 0;
+    _finished.store(false);
+    _producer = std::make_unique<std::thread>([this,count,payload] { produce(count,payload); });
+}
+
+/**
+ * Logs the results of the current run.
+ */
+void RecvApp::finishRun() {
+    _producer->join();
+    _producer = nullptr;
+
+    std::sort(_latency.begin(), _latency.end());
+    size_t size = _latency.size();
+    Uint64 p50 = size ? _latency[size/2] : 0;
+    Uint64 p99 = size ? _latency[std::min(size-1,size*99/100)] : 0;
+    Uint64 pmax = size ? _latency.back() : 0;
+    CULog("%6zu B  %-9s p50 %7llu ns  p99 %7llu ns  max %8llu ns  received %zu/%zu",
+          _payloads[_config/2], isLockFree() ? "ring" : "mutex",
+          (unsigned long long)p50, (unsigned long long)p99, (unsigned long long)pmax,
+          _received, size);
+
+    _config++;
+    startRun();
+}
+
+#pragma mark Application State
+/**
+ * The method called after the application is initialized, but before running.
+ *
+ * This reads the benchmark settings and starts the first run.
+ *
+ * When overriding this method, you should call the parent method as the
+ * very last line. This ensures that the state will transition to FOREGROUND,
+ * causing the application to run.
+ */
+void RecvApp::onStartup() {
+    std::shared_ptr<JsonValue> settings = nullptr;
+    std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(SETTINGS_FILE);
+    if (reader != nullptr) {
+        std::shared_ptr<JsonValue> json = reader->readJson();
+        settings = json == nullptr ? nullptr : json->get(SETTINGS_KEY);
+        reader->close();
+    }
+    if (settings == nullptr) {
+        settings = JsonValue::allocObject();
+    }
+
+    _rate     = std::max(1, settings->getInt("rate",10000));
+    _seconds  = settings->getFloat("seconds",2.0f);
+    _capacity = std::max(1, settings->getInt("capacity",1024));
+    _payloads.clear();
+    std::shared_ptr<JsonValue> payloads = settings->get("payloads");
+    if (payloads != nullptr) {
+        for(int ii = 0; ii < payloads->size(); ii++) {
+            _payloads.push_back(payloads->get(ii)->asInt());
+        }
+    } else {
+        _payloads = { 64, 1024, 16384 };
+    }
+
+    CULog("Appending %u msg/s for %.1f s, draining at %.0f Hz",
+          _rate, _seconds, getFPS());
+    startRun();
+    Application::onStartup(); // YOU MUST END with call to parent
+}
+
+/**
+ * The method called when the application is ready to quit.
+ *
+ * This stops the producer of any unfinished run.
+ *
+ * When overriding this method, you should call the parent method as the
+ * very last line. This ensures that the state will transition to NONE,
+ * causing the application to be deleted.
+ */
+void RecvApp::onShutdown() {
+    if (_producer != nullptr) {
+        _cancel.store(true);
+        _producer->join();
+        _producer = nullptr;
+    }
+    Application::onShutdown();  // YOU MUST END with call to parent
+}
+
+/**
+ * The method called to update the application data.
+ *
+ * This drains the buffer, and finishes the current run once the producer
+ * is done and every message is received.
+ *
+ * @param timestep  The amount of time (in seconds) since the last frame
+ */
+void RecvApp::update(float timestep) {
+    if (_producer == nullptr) {
+        return;
+    }
+
+    // Read the flag first, so the drain sees every message
+    bool finished = _finished.load();
+    drain();
+    if (finished) {
+        finishRun();
+    }
+}
@@ -0,0 +1,229 @@
+//
+//  RBApp.h
+//  Receive Benchmark
+//
+//  This is the root class for the receive benchmark. The benchmark is a
+//  headless CUGL application, so it has no window or scenes. It measures the
+//  receive path of a websocket: a producer thread appends messages at a fixed
+//  rate (like the network thread), while the application drains them once a
+//  frame (like a call to WebSocket::receive).
+//
+//  Author: Kidus Zegeye
+//  Version: 3/9/25
+//
+#ifndef __RB_APP_H__
+#define __RB_APP_H__
+#include <cugl/core/cu_base.h>
+#include <cugl/core/util/CURingBuffer.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A received message, together with its timestamp
+ *
+ * This is the same envelope as the one in {@link cugl::netcode::WebSocket}.
+ */
+typedef struct {
+    /** The message timestamp */
+    Uint64 timestamp;
+    /** The message data */
+    std::vector<std::byte> message;
+} Envelope;
+
+/**
+ * A mutex-guarded circular buffer of messages
+ *
+ * This is the receive buffer that {@link cugl::netcode::WebSocket} used before
+ * the lock-free ring. Both sides take the same mutex, and every message is
+ * copied into its slot. It drops the oldest message when full. It is kept
+ * here as the baseline of the benchmark.
+ */
+class MutexRing {
+private:
+    /** The mutex shared by the producer and the consumer */
+    std::mutex _mutex;
+    /** The message slots */
+    std::vector<Envelope> _buffer;
+    /** The number of messages in the buffer */
+    size_t _buffsize;
+    /** The position of the oldest message */
+    size_t _buffhead;
+    /** The next position to write */
+    size_t _bufftail;
+
+public:
+    /**
+     * Creates an empty buffer with the given capacity.
+     *
+     * @param capacity  The buffer capacity
+     */
+    void init(size_t capacity) {
+        _buffer.clear();
+        _buffer.resize(capacity);
+        _buffsize = _buffhead = _bufftail = 0;
+    }
+
+    /**
+     * Copies a message into the buffer, dropping the oldest if it is full.
+     *
+     * @param data      The message data
+     * @param timestamp The message timestamp
+     */
+    void append(const std::vector<std::byte>& data, Uint64 timestamp) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_buffsize == _buffer.size()) {
+            _buffhead = ((_buffhead + 1) % _buffer.size());
+            _buffsize--;
+        }
+        Envelope* env = &(_buffer[_bufftail]);
+        env->timestamp = timestamp;
+        env->message = data;
+        _bufftail = ((_bufftail + 1) % _buffer.size());
+        _buffsize++;
+    }
+
+    /**
+     * Moves every message in the buffer to the given vector.
+     *
+     * @param messages  The vector to store the messages
+     */
+    void drain(std::vector<Envelope>& messages) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for(; _buffsize > 0; _buffsize--) {
+            messages.emplace_back(std::move(_buffer[_buffhead]));
+            _buffhead = ((_buffhead + 1) % _buffer.size());
+        }
+    }
+};
+
+/**
+ * This class represents the application root for the receive benchmark.
+ *
+ * For each payload size in the settings, the benchmark runs twice: once with
+ * a {@link MutexRing} (the baseline) and once with a {@link cugl::RingBuffer}.
+ * In each run, a producer thread appends messages at the given rate, and
+ * times every append. The application drains the buffer once a frame. When
+ * a run is done, the application logs the latency percentiles of the appends.
+ * It quits once every run is done.
+ */
+class RecvApp : public cugl::Application {
+protected:
+    /** The messages per second of the producer */
+    Uint32 _rate;
+    /** The length of each run in seconds */
+    float _seconds;
+    /** The payload sizes to measure */
+    std::vector<size_t> _payloads;
+    /** The capacity of the buffers */
+    size_t _capacity;
+
+    /** The index of the current run (two for each payload) */
+    size_t _config;
+    /** The baseline buffer */
+    MutexRing _mutexRing;
+    /** The lock-free buffer */
+    cugl::RingBuffer<Envelope> _ring;
+    /** The producer thread of the current run (nullptr if none) */
+    std::unique_ptr<std::thread> _producer;
+    /** The append latencies (in nanoseconds) of the current run */
+    std::vector<Uint64> _latency;
+    /** The number of messages drained in the current run */
+    size_t _received;
+    /** Whether the producer has sent all of its messages */
+    std::atomic<bool> _finished;
+    /** Whether to stop the producer early */
+    std::atomic<bool> _cancel;
+
+    /**
+     * Returns true if the current run uses the lock-free ring.
+     *
+     * @return true if the current run uses the lock-free ring.
+     */
+    bool isLockFree() const { return _config % 2 == 1; }
+
+    /**
+     * Appends the messages of the current run.
+     *
+     * This is the body of the producer thread. It sends the messages on a
+     * fixed schedule, so that a slow append does not lower the rate.
+     *
+     * @param count     The number of messages
+     * @param payload   The size of each message
+     */
+    void produce(size_t count, size_t payload);
+
+    /**
+     * Drains the buffer of the current run.
+     */
+    void drain();
+
+    /**
+     * Starts the next run of the benchmark.
+     *
+     * This method quits the application if there are no more runs.
+     */
+    void startRun();
+
+    /**
+     * Logs the results of the current run.
+     */
+    void finishRun();
+
+public:
+    /**
+     * Creates, but does not initialize, a new application.
+     *
+     * This constructor is called by main.cpp. You will notice that, like
+     * most of the classes in CUGL, we do not do any initialization in the
+     * constructor. That is the purpose of the init() method. Separation
+     * of initialization from the constructor allows main.cpp to perform
+     * advanced configuration of the application before it starts.
+     */
+    RecvApp() : cugl::Application(), _rate(0), _seconds(0), _capacity(0),
+    _config(0), _received(0), _finished(false), _cancel(false) {}
+
+    /**
+     * Disposes of this application, releasing all resources.
+     *
+     * This destructor is called by main.cpp when the application quits.
+     * It simply calls the dispose() method in Application. There is nothing
+     * special to do here.
+     */
+    ~RecvApp() { }
+
+    /**
+     * The method called after the application is initialized, but before running.
+     *
+     * This reads the benchmark settings and starts the first run.
+     *
+     * When overriding this method, you should call the parent method as the
+     * very last line. This ensures that the state will transition to FOREGROUND,
+     * causing the application to run.
+     */
+    virtual void onStartup() override;
+
+    /**
+     * The method called when the application is ready to quit.
+     *
+     * This stops the producer of any unfinished run.
+     *
+     * When overriding this method, you should call the parent method as the
+     * very last line. This ensures that the state will transition to NONE,
+     * causing the application to be deleted.
+     */
+    virtual void onShutdown() override;
+
+    /**
+     * The method called to update the application data.
+     *
+     * This drains the buffer, and finishes the current run once the producer
+     * is done and every message is received.
+     *
+     * @param timestep  The amount of time (in seconds) since the last frame
+     */
+    virtual void update(float timestep) override;
+};
+
+#endif /* __RB_APP_H__ */
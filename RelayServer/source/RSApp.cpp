@@ -0,0 +1,77 @@
+//
+//  RSApp.cpp
+//  Relay Server
+//
+//  This is the root class for the relay server. The server is a headless
+//  CUGL application, so it has no window or scenes. It simply starts the
+//  network layer and runs the relay controller every frame.
+//
+//  Author: Kidus Zegeye
+//  Version: 3/2/25
+//
+#include "RSApp.h"
+
+using namespace cugl;
+using namespace cugl::netcode;
+
+/** The server settings file (in the asset directory) */
+#define SETTINGS_FILE   "json/server.json"
+/** The key of the relay settings in the settings file */
+#define SETTINGS_KEY    "relay server"
+
+#pragma mark Gameplay Control
+
+/**
+ * The method called after the application is initialized, but before running.
+ *
+ * This starts the network layer, reads the server settings and starts the
+ * relay controller. If the server cannot start, the application quits.
+ *
+ * When overriding this method, you should call the parent method as the
+ * very last line. This ensures that the state will transition to FOREGROUND,
+ * causing the application to run.
+ */
+void RelayApp::onStartup() {
+    NetworkLayer::start(NetworkLayer::Log::INFO);
+
+    std::shared_ptr<JsonValue> settings = nullptr;
+    std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(SETTINGS_FILE);
+    if (reader != nullptr) {
+        std::shared_ptr<JsonValue> json = reader->readJson();
+        settings = json == nullptr ? nullptr : json->get(SETTINGS_KEY);
+        reader->close();
+    }
+
+    if (!_relay.init(settings)) {
+        CULogError("Could not start the relay server");
+        quit();
+    }
+    Application::onStartup(); // YOU MUST END with call to parent
+}
+
+/**
+ * The method called when the application is ready to quit.
+ *
+ * This stops the relay controller (disconnecting every client) and
+ * shuts down the network layer.
+ *
+ * When overriding this method, you should call the parent method as the
+ * very last line. This ensures that the state will transition to NONE,
+ * causing the application to be deleted.
+ */
+void RelayApp::onShutdown() {
+    _relay.dispose();
+    NetworkLayer::stop();
+    Application::onShutdown();  // YOU MUST END with call to parent
+}
+
+/**
+ * The method called to update the application data.
+ *
+ * This relays every message received since the last frame.
+ *
+ * @param timestep  The amount of time (in seconds) since the last frame
+ */
+void RelayApp::update(float timestep) {
+    _relay.update(timestep);
+}
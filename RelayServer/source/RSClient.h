@@ -0,0 +1,145 @@
+//
+//  RSClient.h
+//  Relay Server
+//
+//  This class holds the state of a single relay client. Every client belongs
+//  to exactly one room (its websocket path), and has a small id within that
+//  room. The relay uses this state to decide which messages the client wants
+//  (its interest filter) and how fast it can take them (its rate limits).
+//
+//  Author: Kidus Zegeye
+//  Version: 3/2/25
+//
+#ifndef __RS_CLIENT_H__
+#define __RS_CLIENT_H__
+#include <cugl/core/cu_base.h>
+#include <string>
+
+/**
+ * This class is a token bucket.
+ *
+ * A bucket fills at a constant rate up to a maximum (the burst). Spending
+ * tokens fails if there are not enough in the bucket. A rate of 0 means that
+ * the bucket is unlimited, and spending always succeeds.
+ */
+class TokenBucket {
+public:
+    /** The number of tokens added per second (0 for unlimited) */
+    float rate;
+    /** The maximum number of tokens in the bucket */
+    float burst;
+    /** The number of tokens currently in the bucket */
+    float tokens;
+
+    /**
+     * Creates an unlimited token bucket.
+     */
+    TokenBucket() : rate(0), burst(0), tokens(0) {}
+
+    /**
+     * Resets this bucket to the given rate and burst.
+     *
+     * The bucket starts full.
+     *
+     * @param rate  The number of tokens added per second (0 for unlimited)
+     * @param burst The maximum number of tokens in the bucket
+     */
+    void reset(float rate, float burst) {
+        this->rate = rate;
+        this->burst = burst;
+        this->tokens = burst;
+    }
+
+    /**
+     * Refills this bucket for the given amount of time.
+     *
+     * @param timestep  The amount of time (in seconds) since the last refill
+     */
+    void refill(float timestep) {
+        if (rate > 0) {
+            tokens += rate*timestep;
+            if (tokens > burst) {
+                tokens = burst;
+            }
+        }
+    }
+
+    /**
+     * Returns true if the given number of tokens was spent.
+     *
+     * If the bucket does not have enough tokens, nothing is spent.
+     *
+     * @param amount    The number of tokens to spend
+     *
+     * @return true if the given number of tokens was spent.
+     */
+    bool spend(float amount) {
+        if (rate <= 0) {
+            return true;
+        } else if (tokens < amount) {
+            return false;
+        }
+        tokens -= amount;
+        return true;
+    }
+};
+
+/**
+ * This class represents a client connected to the relay.
+ *
+ * The interest filter is a bit mask of topics. A published message is only
+ * relayed to the clients whose mask includes its topic. A new client is
+ * interested in every topic until it subscribes.
+ *
+ * Each client has two rate limits. The publish bucket limits the messages
+ * per second the client may publish to its room, and the send bucket limits
+ * the bytes per second the relay sends to the client. Messages beyond either
+ * limit are dropped, as relayed state is always superseded by the next frame.
+ */
+class RelayClient {
+public:
+    /** The client address (assigned by the websocket server) */
+    std::string address;
+    /** The room of this client (its websocket path) */
+    std::string room;
+    /** The id of this client in its room */
+    Uint16 id;
+    /** The topics this client is interested in (one bit per topic) */
+    Uint64 interests;
+    /** The limit on messages published by this client */
+    TokenBucket publish;
+    /** The limit on bytes sent to this client */
+    TokenBucket send;
+    /** The number of messages from this client dropped by its publish limit */
+    Uint64 publishDrops;
+    /** The number of messages to this client dropped by its send limit */
+    Uint64 sendDrops;
+
+    /**
+     * Creates a new client in the given room.
+     *
+     * @param address   The client address
+     * @param room      The room of this client
+     * @param id        The id of this client in its room
+     */
+    RelayClient(const std::string& address, const std::string& room, Uint16 id) :
+    address(address),
+    room(room),
+    id(id),
+    interests(~(Uint64)0),
+    publishDrops(0),
+    sendDrops(0) {}
+
+    /**
+     * Returns true if this client is interested in the given topic.
+     *
+     * @param topic The message topic
+     *
+     * @return true if this client is interested in the given topic.
+     */
+    bool isInterested(Uint8 topic) const {
+        return topic < 64 && (interests & ((Uint64)1 << topic)) != 0;
+    }
+};
+
+#endif /* __RS_CLIENT_H__ */
@@ -0,0 +1,510 @@
+//
+//  RSRelayController.cpp
+//  Relay Server
+//
+//  This controller implements the relay protocol on top of a CUGL
+//  WebSocketServer. Clients connect to a room (the websocket path) and publish
+//  each message to the relay once. The relay then fans the message out to the
+//  rest of the room, subject to the interest filter and the rate limits of
+//  each recipient. This keeps the upload of every player constant, no matter
+//  how many players are in the room.
+//
+//  Author: Kidus Zegeye
+//  Version: 3/2/25
+//
+#include "RSRelayController.h"
+#include <algorithm>
+
+using namespace cugl;
+using namespace cugl::netcode;
+
+/** The default number of messages buffered between updates */
+#define SERVER_BUFFER   16384
+/** The default maximum number of clients in a room */
+#define ROOM_SIZE       64
+/** The default time (in seconds) between statistics reports */
+#define REPORT_INTERVAL 10.0f
+
+/** The number of header bytes in a DATA message */
+#define DATA_HEADER     4
+
+/**
+ * Writes a big-endian Uint16 to the given bytes.
+ *
+ * @param dst   The destination bytes
+ * @param value The value to write
+ */
+static void write16(std::byte* dst, Uint16 value) {
+    dst[0] = (std::byte)(value >> 8);
+    dst[1] = (std::byte)(value & 0xFF);
+}
+
+/**
+ * Returns the big-endian Uint16 at the start of the given bytes.
+ *
+ * @param src   The source bytes
+ *
+ * @return the big-endian Uint16 at the start of the given bytes.
+ */
+static Uint16 read16(const std::byte* src) {
+    return (Uint16)(((Uint16)src[0] << 8) | (Uint16)src[1]);
+}
+
+#pragma mark Constructors
+/**
+ * Creates a new relay controller with the default values.
+ *
+ * This constructor does not allocate any objects or start the server.
+ * This allows us to use the object without a heap pointer.
+ */
+RelayController::RelayController() :
+_roomLimit(ROOM_SIZE),
+_publishRate(0),
+_publishBurst(0),
+_sendRate(0),
+_sendBurst(0),
+_queueLimit(0),
+_relayed(0),
+_dropped(0),
+_reportInterval(REPORT_INTERVAL),
+_elapsed(0) {
+}
+
+/**
+ * Disposes of all (non-static) resources allocated to this controller.
+ *
+ * This stops the server and removes every client.
+ */
+void RelayController::dispose() {
+    if (_server != nullptr) {
+        _server->onConnect(nullptr);
+        _server->onDisconnect(nullptr);
+        _server->stop();
+        _server = nullptr;
+    }
+    _clients.clear();
+    _rooms.clear();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _opened.clear();
+        _closed.clear();
+    }
+}
+
+/**
+ * Initializes the controller and starts the server.
+ *
+ * The JSON value should contain the websocket settings (see
+ * {@link cugl::netcode::WebSocketConfig}) together with the following
+ * optional relay settings.
+ *
+ *      "room size":       The maximum number of clients in a room (0 for unlimited)
+ *      "publish rate":    The messages per second a client may publish (0 for unlimited)
+ *      "publish burst":   The maximum burst of published messages
+ *      "send rate":       The bytes per second sent to each client (0 for unlimited)
+ *      "send burst":      The maximum burst of bytes sent to each client
+ *      "queue limit":     The bytes queued for a client before messages are dropped
+ *      "report interval": The time (in seconds) between statistics reports (0 for never)
+ *
+ * @param json  The server settings
+ *
+ * @return true if the controller was initialized successfully
+ */
+bool RelayController::init(const std::shared_ptr<JsonValue>& json) {
+    if (json == nullptr) {
+        CULogError("Missing relay server settings");
+        return false;
+    }
+
+    WebSocketConfig config(json);
+    if (!json->has("buffer size")) {
+        // Messages are only polled once a frame, so we need a deep buffer
+        config.bufferSize = SERVER_BUFFER;
+    }
+    int limit = json->getInt("room size",ROOM_SIZE);
+    _roomLimit = limit > 0 ? limit : 0;
+    _publishRate  = json->getFloat("publish rate",0);
+    _publishBurst = json->getFloat("publish burst",_publishRate);
+    _sendRate  = json->getFloat("send rate",0);
+    _sendBurst = json->getFloat("send burst",_sendRate);
+    limit = json->getInt("queue limit",0);
+    _queueLimit = limit > 0 ? limit : 0;
+    _reportInterval = json->getFloat("report interval",REPORT_INTERVAL);
+
+    _server = WebSocketServer::alloc(config);
+    if (_server == nullptr) {
+        CULogError("Could not create websocket server on port %d",config.port);
+        return false;
+    }
+    _server->onConnect([this](const std::string client, const std::string path) {
+        onConnect(client,path);
+    });
+    _server->onDisconnect([this](const std::string client, const std::string path) {
+        onDisconnect(client,path);
+    });
+    _server->start();
+    CULog("Relay server listening on port %d",config.port);
+    return true;
+}
+
+#pragma mark -
+#pragma mark Gameplay Handling
+/**
+ * Updates the controller.
+ *
+ * This adds any clients that connected since the last update, relays every
+ * message received since then, and then removes any clients that
+ * disconnected. It also refills the rate limits of every client.
+ *
+ * @param timestep  The amount of time (in seconds) since the last frame
+ */
+void RelayController::update(float timestep) {
+    if (_server == nullptr) {
+        return;
+    }
+
+    for (auto it = _clients.begin(); it != _clients.end(); ++it) {
+        it->second->publish.refill(timestep);
+        it->second->send.refill(timestep);
+    }
+
+    // Take the disconnects first, so their last messages are relayed below
+    std::vector<std::string> closed;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        closed.swap(_closed);
+    }
+    acceptClients();
+    _server->receive([this](const std::string client, const std::vector<std::byte>& message, Uint64 time) {
+        onReceipt(client,message,time);
+    });
+    for (auto it = closed.begin(); it != closed.end(); ++it) {
+        removeClient(*it);
+    }
+
+    _elapsed += timestep;
+    if (_reportInterval > 0 && _elapsed >= _reportInterval) {
+        CULog("Relay: %zu clients in %zu rooms, %llu messages relayed, %llu dropped",
+              _clients.size(), _rooms.size(),
+              (unsigned long long)_relayed, (unsigned long long)_dropped);
+        _relayed = 0;
+        _dropped = 0;
+        _elapsed = 0;
+    }
+}
+
+#pragma mark -
+#pragma mark Callbacks
+/**
+ * Called when a client connects to the server.
+ *
+ * This callback may be invoked on the network thread. It only records the
+ * client, so that it can be added to its room on the main thread.
+ *
+ * @param client    The client address
+ * @param path      The connection path
+ */
+void RelayController::onConnect(const std::string client, const std::string path) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _opened.emplace_back(client,path);
+}
+
+/**
+ * Called when a client disconnects from the server.
+ *
+ * This callback may be invoked on the network thread. It only records the
+ * client, so that {@link update} can remove it after relaying the last of
+ * its messages.
+ *
+ * @param client    The client address
+ * @param path      The connection path
+ */
+void RelayController::onDisconnect(const std::string client, const std::string) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _closed.push_back(client);
+}
+
+/**
+ * Adds every client that connected since the last call to this method.
+ *
+ * This is called at the start of every update, and again whenever a
+ * message arrives from a client that has not been added yet.
+ */
+void RelayController::acceptClients() {
+    std::vector<std::pair<std::string,std::string>> opened;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        opened.swap(_opened);
+    }
+    for (auto it = opened.begin(); it != opened.end(); ++it) {
+        addClient(it->first,it->second);
+    }
+}
+
+/**
+ * Adds the given client to its room.
+ *
+ * The client is welcomed with its id and the ids of the rest of the room,
+ * and the rest of the room is told that it joined. If the room is full,
+ * the client is refused instead.
+ *
+ * @param client    The client address
+ * @param path      The connection path (and room)
+ */
+void RelayController::addClient(const std::string& client, const std::string& path) {
+    if (_clients.find(client) != _clients.end()) {
+        return;
+    }
+
+    Room& room = _rooms[path];
+    if (_roomLimit > 0 && room.members.size() >= _roomLimit) {
+        // A refused client keeps id 0, and its messages are ignored
+        _clients.emplace(client,std::make_shared<RelayClient>(client,path,0));
+        std::vector<std::byte> welcome(5,std::byte(0));
+        welcome[0] = (std::byte)WELCOME;
+        _server->sendTo(client,std::move(welcome));
+        return;
+    }
+
+    Uint16 id;
+    if (room.freeIds.empty()) {
+        id = room.nextId++;
+    } else {
+        id = room.freeIds.back();
+        room.freeIds.pop_back();
+    }
+
+    auto entry = std::make_shared<RelayClient>(client,path,id);
+    entry->publish.reset(_publishRate,_publishBurst);
+    entry->send.reset(_sendRate,_sendBurst);
+
+    std::vector<std::byte> welcome(5+2*room.members.size());
+    welcome[0] = (std::byte)WELCOME;
+    write16(welcome.data()+1,id);
+    write16(welcome.data()+3,(Uint16)room.members.size());
+    std::byte* pos = welcome.data()+5;
+    for (auto it = room.members.begin(); it != room.members.end(); ++it) {
+        write16(pos,(*it)->id);
+        pos += 2;
+    }
+    _server->sendTo(client,std::move(welcome));
+
+    if (!room.members.empty()) {
+        auto join = NetcodeMessage::alloc(announce(JOIN,id));
+        for (auto it = room.members.begin(); it != room.members.end(); ++it) {
+            _server->sendTo((*it)->address,join);
+        }
+    }
+    room.members.push_back(entry);
+    _clients.emplace(client,entry);
+}
+
+/**
+ * Removes the given client from its room.
+ *
+ * The rest of the room is told that it left.
+ *
+ * @param client    The client address
+ */
+void RelayController::removeClient(const std::string& client) {
+    auto it = _clients.find(client);
+    if (it == _clients.end()) {
+        return;
+    }
+
+    std::shared_ptr<RelayClient> entry = it->second;
+    _clients.erase(it);
+    if (entry->id == 0) {
+        return;
+    }
+
+    auto rt = _rooms.find(entry->room);
+    if (rt == _rooms.end()) {
+        return;
+    }
+
+    Room& room = rt->second;
+    for (auto jt = room.members.begin(); jt != room.members.end(); ++jt) {
+        if (*jt == entry) {
+            room.members.erase(jt);
+            break;
+        }
+    }
+    if (room.members.empty()) {
+        _rooms.erase(rt);
+        return;
+    }
+
+    room.freeIds.push_back(entry->id);
+    auto leave = NetcodeMessage::alloc(announce(LEAVE,entry->id));
+    for (auto jt = room.members.begin(); jt != room.members.end(); ++jt) {
+        _server->sendTo((*jt)->address,leave);
+    }
+}
+
+/**
+ * Called for each message received by the server.
+ *
+ * @param client    The client address
+ * @param message   The message bytes
+ * @param time      The time the message was received
+ */
+void RelayController::onReceipt(const std::string client, const std::vector<std::byte>& message,
+                                Uint64) {
+    auto it = _clients.find(client);
+    if (it == _clients.end()) {
+        // The client connected after this update started
+        acceptClients();
+        it = _clients.find(client);
+        if (it == _clients.end()) {
+            return;
+        }
+    }
+
+    RelayClient& source = *(it->second);
+    if (source.id == 0 || message.empty()) {
+        return;
+    }
+
+    const std::byte* data = message.data();
+    size_t size = message.size();
+    switch ((Uint8)data[0]) {
+        case SUBSCRIBE:
+            if (size >= 9) {
+                Uint64 mask = 0;
+                for (size_t ii = 1; ii < 9; ii++) {
+                    mask = (mask << 8) | (Uint64)data[ii];
+                }
+                source.interests = mask;
+            }
+            break;
+        case PUBLISH:
+            if (size >= 2) {
+                relay(source,(Uint8)data[1],data+2,size-2);
+            }
+            break;
+        case SEND:
+            if (size >= 3) {
+                forward(source,read16(data+1),data+3,size-3);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+#pragma mark -
+#pragma mark Message Handling
+/**
+ * Relays a published message to the interested clients in the room.
+ *
+ * @param source    The publishing client
+ * @param topic     The message topic
+ * @param payload   The start of the payload
+ * @param size      The number of payload bytes
+ */
+void RelayController::relay(RelayClient& source, Uint8 topic, const std::byte* payload, size_t size) {
+    if (!source.publish.spend(1)) {
+        source.publishDrops++;
+        _dropped++;
+        return;
+    }
+
+    auto rt = _rooms.find(source.room);
+    if (rt == _rooms.end()) {
+        return;
+    }
+
+    // Encode lazily, as nobody may be interested
+    std::shared_ptr<NetcodeMessage> message = nullptr;
+    auto& members = rt->second.members;
+    for (auto it = members.begin(); it != members.end(); ++it) {
+        RelayClient& target = *(*it);
+        if (&target == &source || !target.isInterested(topic)) {
+            continue;
+        }
+        if (message == nullptr) {
+            std::vector<std::byte> bytes(DATA_HEADER+size);
+            bytes[0] = (std::byte)DATA;
+            write16(bytes.data()+1,source.id);
+            bytes[3] = (std::byte)topic;
+            std::copy(payload,payload+size,bytes.data()+DATA_HEADER);
+            message = NetcodeMessage::alloc(std::move(bytes));
+        }
+        deliver(target,message);
+    }
+}
+
+/**
+ * Relays a direct message to one client in the room.
+ *
+ * @param source    The sending client
+ * @param target    The id of the receiving client
+ * @param payload   The start of the payload
+ * @param size      The number of payload bytes
+ */
+void RelayController::forward(RelayClient& source, Uint16 target, const std::byte* payload, size_t size) {
+    if (!source.publish.spend(1)) {
+        source.publishDrops++;
+        _dropped++;
+        return;
+    }
+
+    auto rt = _rooms.find(source.room);
+    if (rt == _rooms.end()) {
+        return;
+    }
+
+    auto& members = rt->second.members;
+    for (auto it = members.begin(); it != members.end(); ++it) {
+        if ((*it)->id == target) {
+            std::vector<std::byte> bytes(DATA_HEADER+size);
+            bytes[0] = (std::byte)DATA;
+            write16(bytes.data()+1,source.id);
+            bytes[3] = (std::byte)DIRECT;
+            std::copy(payload,payload+size,bytes.data()+DATA_HEADER);
+            deliver(*(*it),NetcodeMessage::alloc(std::move(bytes)));
+            return;
+        }
+    }
+}
+
+/**
+ * Returns true if the message was sent to the given client.
+ *
+ * The message is dropped if it would exceed the send limit of the client,
+ * or if the client already has too many bytes queued.
+ *
+ * @param client    The receiving client
+ * @param message   The message to send
+ *
+ * @return true if the message was sent to the given client.
+ */
+bool RelayController::deliver(RelayClient& client, const std::shared_ptr<NetcodeMessage>& message) {
+    if ((_queueLimit > 0 && _server->getQueuedBytes(client.address) > _queueLimit) ||
+        !client.send.spend((float)message->size())) {
+        client.sendDrops++;
+        _dropped++;
+        return false;
+    }
+    if (_server->sendTo(client.address,message)) {
+        _relayed++;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Returns a control message announcing the given client.
+ *
+ * @param opcode    The message opcode (JOIN or LEAVE)
+ * @param id        The client id
+ *
+ * @return a control message announcing the given client.
+ */
+std::vector<std::byte> RelayController::announce(Opcode opcode, Uint16 id) {
+    std::vector<std::byte> result(3);
+    result[0] = (std::byte)opcode;
+    write16(result.data()+1,id);
+    return result;
+}
@@ -0,0 +1,305 @@
+//
+//  RSRelayController.h
+//  Relay Server
+//
+//  This controller implements the relay protocol on top of a CUGL
+//  WebSocketServer. Clients connect to a room (the websocket path) and publish
+//  each message to the relay once. The relay then fans the message out to the
+//  rest of the room, subject to the interest filter and the rate limits of
+//  each recipient. This keeps the upload of every player constant, no matter
+//  how many players are in the room.
+//
+//  Author: Kidus Zegeye
+//  Version: 3/2/25
+//
+#ifndef __RS_RELAY_CONTROLLER_H__
+#define __RS_RELAY_CONTROLLER_H__
+#include <cugl/core/cu_base.h>
+#include <cugl/netcode/cu_netcode.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "RSClient.h"
+
+/**
+ * This class is the protocol handler of the relay server.
+ *
+ * Every message begins with a one byte opcode, and all numbers are big-endian.
+ * A client may send the following messages.
+ *
+ *      SUBSCRIBE   Uint64 mask                 Sets the topics of interest
+ *      PUBLISH     Uint8 topic, payload        Relays the payload to the room
+ *      SEND        Uint16 target, payload      Relays the payload to one client
+ *
+ * The relay sends the following messages to its clients.
+ *
+ *      WELCOME     Uint16 id, Uint16 count, Uint16 ids[count]
+ *      JOIN        Uint16 id
+ *      LEAVE       Uint16 id
+ *      DATA        Uint16 source, Uint8 topic, payload
+ *
+ * A client that joins a full room is welcomed with id 0 and an empty room,
+ * and its messages are ignored. It should disconnect.
+ *
+ * A relayed SEND has the topic {@link #DIRECT}. Direct messages ignore the
+ * interest filter, but not the rate limits. Control messages (WELCOME, JOIN
+ * and LEAVE) are never dropped.
+ *
+ * Messages are polled from the server in {@link update}, which preserves their
+ * order, and are handled on the main thread. A relayed message is encoded once,
+ * and the same bytes are shared by every recipient.
+ */
+class RelayController {
+public:
+    /** The opcodes of the relay protocol */
+    enum Opcode : Uint8 {
+        /** A client setting its topics of interest */
+        SUBSCRIBE = 0x01,
+        /** A client publishing a message to its room */
+        PUBLISH   = 0x02,
+        /** A client sending a message to one other client */
+        SEND      = 0x03,
+        /** The relay assigning an id to a new client */
+        WELCOME   = 0x81,
+        /** The relay announcing a new client in the room */
+        JOIN      = 0x82,
+        /** The relay announcing a client leaving the room */
+        LEAVE     = 0x83,
+        /** The relay forwarding a message */
+        DATA      = 0x84
+    };
+
+    /** The topic of a relayed SEND message */
+    static const Uint8 DIRECT = 0xFF;
+
+protected:
+    /**
+     * This class represents a single room of the relay.
+     */
+    class Room {
+    public:
+        /** The clients in this room, in order of arrival */
+        std::vector<std::shared_ptr<RelayClient>> members;
+        /** The ids released by clients that left */
+        std::vector<Uint16> freeIds;
+        /** The next unused id */
+        Uint16 nextId;
+
+        /** Creates an empty room */
+        Room() : nextId(1) {}
+    };
+
+    /** The websocket server */
+    std::shared_ptr<cugl::netcode::WebSocketServer> _server;
+    /** The connected clients, indexed by client address */
+    std::unordered_map<std::string, std::shared_ptr<RelayClient>> _clients;
+    /** The active rooms, indexed by path */
+    std::unordered_map<std::string, Room> _rooms;
+    /** The clients (and their paths) that connected since the last update */
+    std::vector<std::pair<std::string,std::string>> _opened;
+    /** The clients that disconnected since the last update */
+    std::vector<std::string> _closed;
+    /** A mutex to protect the connected and disconnected clients */
+    std::mutex _mutex;
+    /** The maximum number of clients in a room (0 for unlimited) */
+    size_t _roomLimit;
+    /** The messages per second a client may publish (0 for unlimited) */
+    float _publishRate;
+    /** The maximum burst of published messages */
+    float _publishBurst;
+    /** The bytes per second sent to each client (0 for unlimited) */
+    float _sendRate;
+    /** The maximum burst of bytes sent to each client */
+    float _sendBurst;
+    /** The maximum bytes queued for a client before messages are dropped (0 for unlimited) */
+    size_t _queueLimit;
+    /** The number of messages relayed to a client */
+    Uint64 _relayed;
+    /** The number of messages dropped by a rate limit */
+    Uint64 _dropped;
+    /** The time (in seconds) between statistics reports (0 for never) */
+    float _reportInterval;
+    /** The time (in seconds) since the last statistics report */
+    float _elapsed;
+
+public:
+#pragma mark Constructors
+    /**
+     * Creates a new relay controller with the default values.
+     *
+     * This constructor does not allocate any objects or start the server.
+     * This allows us to use the object without a heap pointer.
+     */
+    RelayController();
+
+    /**
+     * Disposes of all (non-static) resources allocated to this controller.
+     */
+    ~RelayController() { dispose(); }
+
+    /**
+     * Disposes of all (non-static) resources allocated to this controller.
+     *
+     * This stops the server and removes every client.
+     */
+    void dispose();
+
+    /**
+     * Initializes the controller and starts the server.
+     *
+     * The JSON value should contain the websocket settings (see
+     * {@link cugl::netcode::WebSocketConfig}) together with the following
+     * optional relay settings.
+     *
+     *      "room size":       The maximum number of clients in a room (0 for unlimited)
+     *      "publish rate":    The messages per second a client may publish (0 for unlimited)
+     *      "publish burst":   The maximum burst of published messages
+     *      "send rate":       The bytes per second sent to each client (0 for unlimited)
+     *      "send burst":      The maximum burst of bytes sent to each client
+     *      "queue limit":     The bytes queued for a client before messages are dropped
+     *      "report interval": The time (in seconds) between statistics reports (0 for never)
+     *
+     * @param json  The server settings
+     *
+     * @return true if the controller was initialized successfully
+     */
+    bool init(const std::shared_ptr<cugl::JsonValue>& json);
+
+#pragma mark Gameplay Handling
+    /**
+     * Updates the controller.
+     *
+     * This adds any clients that connected since the last update, relays every
+     * message received since then, and then removes any clients that
+     * disconnected. It also refills the rate limits of every client.
+     *
+     * @param timestep  The amount of time (in seconds) since the last frame
+     */
+    void update(float timestep);
+
+    /**
+     * Returns the number of connected clients.
+     *
+     * @return the number of connected clients.
+     */
+    size_t getClientCount() const { return _clients.size(); }
+
+    /**
+     * Returns the number of active rooms.
+     *
+     * @return the number of active rooms.
+     */
+    size_t getRoomCount() const { return _rooms.size(); }
+
+private:
+#pragma mark Callbacks
+    /**
+     * Called when a client connects to the server.
+     *
+     * This callback may be invoked on the network thread. It only records the
+     * client, so that it can be added to its room on the main thread.
+     *
+     * @param client    The client address
+     * @param path      The connection path
+     */
+    void onConnect(const std::string client, const std::string path);
+
+    /**
+     * Called when a client disconnects from the server.
+     *
+     * This callback may be invoked on the network thread. It only records the
+     * client, so that {@link update} can remove it after relaying the last of
+     * its messages.
+     *
+     * @param client    The client address
+     * @param path      The connection path
+     */
+    void onDisconnect(const std::string client, const std::string path);
+
+    /**
+     * Adds every client that connected since the last call to this method.
+     *
+     * This is called at the start of every update, and again whenever a
+     * message arrives from a client that has not been added yet.
+     */
+    void acceptClients();
+
+    /**
+     * Adds the given client to its room.
+     *
+     * The client is welcomed with its id and the ids of the rest of the room,
+     * and the rest of the room is told that it joined. If the room is full,
+     * the client is refused instead.
+     *
+     * @param client    The client address
+     * @param path      The connection path (and room)
+     */
+    void addClient(const std::string& client, const std::string& path);
+
+    /**
+     * Removes the given client from its room.
+     *
+     * The rest of the room is told that it left.
+     *
+     * @param client    The client address
+     */
+    void removeClient(const std::string& client);
+
+    /**
+     * Called for each message received by the server.
+     *
+     * @param client    The client address
+     * @param message   The message bytes
+     * @param time      The time the message was received
+     */
+    void onReceipt(const std::string client, const std::vector<std::byte>& message, Uint64 time);
+
+#pragma mark Message Handling
+    /**
+     * Relays a published message to the interested clients in the room.
+     *
+     * @param source    The publishing client
+     * @param topic     The message topic
+     * @param payload   The start of the payload
+     * @param size      The number of payload bytes
+     */
+    void relay(RelayClient& source, Uint8 topic, const std::byte* payload, size_t size);
+
+    /**
+     * Relays a direct message to one client in the room.
+     *
+     * @param source    The sending client
+     * @param target    The id of the receiving client
+     * @param payload   The start of the payload
+     * @param size      The number of payload bytes
+     */
+    void forward(RelayClient& source, Uint16 target, const std::byte* payload, size_t size);
+
+    /**
+     * Returns true if the message was sent to the given client.
+     *
+     * The message is dropped if it would exceed the send limit of the client,
+     * or if the client already has too many bytes queued.
+     *
+     * @param client    The receiving client
+     * @param message   The message to send
+     *
+     * @return true if the message was sent to the given client.
+     */
+    bool deliver(RelayClient& client, const std::shared_ptr<cugl::netcode::NetcodeMessage>& message);
+
+    /**
+     * Returns a control message announcing the given client.
+     *
+     * @param opcode    The message opcode (JOIN or LEAVE)
+     * @param id        The client id
+     *
+     * @return a control message announcing the given client.
+     */
+    static std::vector<std::byte> announce(Opcode opcode, Uint16 id);
+};
+
+#endif /* __RS_RELAY_CONTROLLER_H__ */
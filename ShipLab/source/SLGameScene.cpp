@@ -212,18 +212,14 @@ void GameScene::update(float timestep) {
 
         if (_collisions.resolveCollision(_photons, _asteroids)) {
             AudioEngine::get()->play("blast", _blast, false, _blast->getVolume(), true);
-            // sync the task Attempt here
-            std::shared_ptr<JsonValue> stats1 = taskAttempt1->getTaskStatistics();
-            std::shared_ptr<JsonValue> stats2 = taskAttempt2->getTaskStatistics();
-            long val = stats2->getLong("destroyed") + 1;
+            // sync the task Attempt here (only the changed statistic is sent)
+            long val = taskAttempt2->getStatistic("destroyed")->asLong() + 1;
             if (!taskAttempt1->hasEnded()) {
                 if (val == 5) {
                     taskAttempt1->setStatus(TaskAttempt::Status::SUCCEEDED);
                 }
-                stats1->get("destroyed")->set(val);
-                stats2->get("destroyed")->set(val);
-                taskAttempt1->setTaskStatistics(stats1);
-                taskAttempt2->setTaskStatistics(stats2);
+                taskAttempt1->setStatistic("destroyed", val);
+                taskAttempt2->setStatistic("destroyed", val);
                 _analyticsConn->syncTaskAttempt(taskAttempt1);
                 _analyticsConn->syncTaskAttempt(taskAttempt2);
             }
@@ -231,8 +227,7 @@ void GameScene::update(float timestep) {
                 if (val == 10) {
                     taskAttempt2->setStatus(TaskAttempt::Status::SUCCEEDED);
                 }
-                stats2->get("destroyed")->set(val);
-                taskAttempt2->setTaskStatistics(stats2);
+                taskAttempt2->setStatistic("destroyed", val);
                 _analyticsConn->syncTaskAttempt(taskAttempt2);
             }
 
@@ -0,0 +1,236 @@
+//
+//  UBApp.cpp
+//  UUID Benchmark
+//
+//  This is the root class for the UUID benchmark. The benchmark is a headless
+//  CUGL application, so it has no window or scenes. It compares the UUID
+//  functions in hashtool with the generator that they replaced, which seeded
+//  a new Mersenne Twister from std::random_device on every call.
+//
+//  Author: Kidus Zegeye
+//  Version: 3/9/25
+//
+#include "UBApp.h"
+#include <cugl/core/util/CUHashtools.h>
+#include <stduuid/uuid.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <random>
+#include <set>
+#include <thread>
+#include <unordered_set>
+
+using namespace cugl;
+using namespace cugl::hashtool;
+
+/** The benchmark settings file (in the asset directory) */
+#define SETTINGS_FILE   "json/bench.json"
+/** The key of the benchmark settings in the settings file */
+#define SETTINGS_KEY    "uuid bench"
+
+#pragma mark Baseline
+/**
+ * Returns a new UUID, generated the way generate_uuid used to.
+ *
+ * This seeds a new Mersenne Twister from std::random_device on every call.
+ * It is kept here as the baseline of the benchmark.
+ *
+ * @return a new UUID, generated the way generate_uuid used to.
+ */
+static std::string old_generate_uuid() {
+    std::random_device rd;
+    auto seed_data = std::array<int, std::mt19937::state_size> {};
+    std::generate(std::begin(seed_data), std::end(seed_data), std::ref(rd));
+    std::seed_seq seq(std::begin(seed_data), std::end(seed_data));
+    std::mt19937 generator(seq);
+    uuids::uuid_random_generator uuidgen{generator};
+    return uuids::to_string(uuidgen());
+}
+
+#pragma mark Benchmark
+/**
+ * Returns true if the generated UUIDs pass every check.
+ *
+ * The failed checks are logged.
+ *
+ * @param count     The number of UUIDs to generate for the uniqueness checks
+ * @param threads   The number of threads for the thread check
+ *
+ * @return true if the generated UUIDs pass every check.
+ */
+bool UUIDApp::check(size_t count, size_t threads) {
+    bool success = true;
+
+    // Parsing, formatting and bytes must round trip
+    BinaryUUID uuid = generate_uuid_v4();
+    std::string text = uuid.toString();
+    BinaryUUID copy;
+    if (uuid.getVersion() != 4 || !copy.parse(text,true) || copy != uuid) {
+        CULogError("Version 4 UUID %s does not round trip",text.c_str());
+        success = false;
+    }
+    std::byte bytes[16];
+    uuid.toBytes(bytes);
+    copy.fromBytes(bytes);
+    if (copy != uuid) {
+        CULogError("Version 4 UUID %s does not round trip as bytes",text.c_str());
+        success = false;
+    }
+
+    std::string upper = text;
+    std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+    if (copy.parse(upper,true) || !copy.parse(upper,false) || copy.parse("zz"+text.substr(2))) {
+        CULogError("Parsing %s does not respect the canonical flag",upper.c_str());
+        success = false;
+    }
+
+    std::optional<uuids::uuid> other = uuids::uuid::from_string(text);
+    if (!other.has_value() || other->variant() != uuids::uuid_variant::rfc) {
+        CULogError("Version 4 UUID %s is rejected by stduuid",text.c_str());
+        success = false;
+    }
+
+    // Version 4 must be unique
+    std::unordered_set<std::string> strings;
+    for(size_t ii = 0; ii < count; ii++) {
+        strings.insert(generate_uuid());
+    }
+    if (strings.size() != count) {
+        CULogError("Only %zu of %zu version 4 UUIDs are unique",strings.size(),count);
+        success = false;
+    }
+
+    // Version 7 must be unique and increasing
+    std::set<BinaryUUID> ordered;
+    BinaryUUID prev;
+    bool increasing = true;
+    for(size_t ii = 0; ii < count; ii++) {
+        BinaryUUID next = generate_uuid_v7();
+        increasing = increasing && prev < next;
+        ordered.insert(next);
+        prev = next;
+    }
+    if (!increasing || ordered.size() != count || prev.getVersion() != 7) {
+        CULogError("Version 7 UUIDs are not unique and increasing");
+        success = false;
+    }
+
+    // Each thread has its own generator
+    std::vector<std::thread> workers;
+    std::vector<std::string> results(threads);
+    for(size_t ii = 0; ii < threads; ii++) {
+        workers.emplace_back([&results,ii] { results[ii] = generate_uuid(); });
+    }
+    for(auto it = workers.begin(); it != workers.end(); ++it) {
+        it->join();
+    }
+    std::set<std::string> distinct(results.begin(), results.end());
+    if (distinct.size() != threads) {
+        CULogError("Only %zu of %zu threads generated distinct UUIDs",distinct.size(),threads);
+        success = false;
+    }
+
+    if (success) {
+        CULog("Checked %zu version 4 and %zu version 7 UUIDs on %zu threads",
+              count, count, threads);
+    }
+    return success;
+}
+
+/**
+ * Times the given benchmark and logs the result.
+ *
+ * @param bench     The benchmark to time
+ */
+void UUIDApp::measure(const Benchmark& bench) {
+    auto start = std::chrono::steady_clock::now();
+    for(size_t ii = 0; ii < bench.iterations; ii++) {
+        _sink += bench.function();
+    }
+    auto finish = std::chrono::steady_clock::now();
+    double nanos = std::chrono::duration<double,std::nano>(finish-start).count()/bench.iterations;
+    if (_baseline == 0) {
+        _baseline = nanos;
+    }
+    CULog("%-30s %10.1f ns/op %9.0fx",bench.name.c_str(),nanos,_baseline/nanos);
+}
+
+#pragma mark Application State
+/**
+ * The method called after the application is initialized, but before running.
+ *
+ * This reads the benchmark settings, checks the generated UUIDs, and sets
+ * up the benchmarks. If a check fails, the application quits.
+ *
+ * When overriding this method, you should call the parent method as the
+ * very last line. This ensures that the state will transition to FOREGROUND,
+ * causing the application to run.
+ */
+void UUIDApp::onStartup() {
+    std::shared_ptr<JsonValue> settings = nullptr;
+    std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(SETTINGS_FILE);
+    if (reader != nullptr) {
+        std::shared_ptr<JsonValue> json = reader->readJson();
+        settings = json == nullptr ? nullptr : json->get(SETTINGS_KEY);
+        reader->close();
+    }
+    if (settings == nullptr) {
+        settings = JsonValue::allocObject();
+    }
+
+    size_t iterations = std::max(1, settings->getInt("iterations",1000000));
+    size_t baseline = std::max(1, settings->getInt("old iterations",2000));
+    size_t checks = std::max(1, settings->getInt("checks",100000));
+    size_t threads = std::max(1, settings->getInt("threads",8));
+
+    if (!check(checks, threads)) {
+        quit();
+        Application::onStartup(); // YOU MUST END with call to parent
+        return;
+    }
+
+    // The parse and format inputs are fixed, so that only the call is timed
+    BinaryUUID uuid = generate_uuid_v4();
+    std::string text = uuid.toString();
+    uuids::uuid other = uuids::uuid::from_string(text).value();
+
+    _benchmarks.clear();
+    _benchmarks.push_back({"old generate_uuid (string)", baseline,
+                           [] { return old_generate_uuid().size(); }});
+    _benchmarks.push_back({"generate_uuid (string)", iterations,
+                           [] { return generate_uuid().size(); }});
+    _benchmarks.push_back({"generate_uuid_v4 (binary)", iterations,
+                           [] { return (size_t)generate_uuid_v4().low; }});
+    _benchmarks.push_back({"generate_uuid_v7 (binary)", iterations,
+                           [] { return (size_t)generate_uuid_v7().low; }});
+    _benchmarks.push_back({"stduuid from_string", iterations,
+                           [text] { return (size_t)uuids::uuid::from_string(text).has_value(); }});
+    _benchmarks.push_back({"BinaryUUID::parse", iterations,
+                           [text] { BinaryUUID result; return (size_t)result.parse(text)+(size_t)result.low; }});
+    _benchmarks.push_back({"stduuid to_string", iterations,
+                           [other] { return uuids::to_string(other).size(); }});
+    _benchmarks.push_back({"BinaryUUID::toString", iterations,
+                           [uuid] { return uuid.toString().size(); }});
+    _benchmarks.push_back({"BinaryUUID::format (no alloc)", iterations,
+                           [uuid] { char buffer[BinaryUUID::STRING_LENGTH]; uuid.format(buffer); return (size_t)buffer[7]; }});
+    _next = 0;
+
+    Application::onStartup(); // YOU MUST END with call to parent
+}
+
+/**
+ * The method called to update the application data.
+ *
+ * This times the next benchmark, or quits if there are none left.
+ *
+ * @param timestep  The amount of time (in seconds) since the last frame
+ */
+void UUIDApp::update(float timestep) {
+    if (_next < _benchmarks.size()) {
+        measure(_benchmarks[_next++]);
+    } else if (_next == _benchmarks.size()) {
+        _next++;
+        quit();
+    }
+}
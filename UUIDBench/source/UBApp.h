@@ -0,0 +1,118 @@
+//
+//  UBApp.h
+//  UUID Benchmark
+//
+//  This is the root class for the UUID benchmark. The benchmark is a headless
+//  CUGL application, so it has no window or scenes. It compares the UUID
+//  functions in hashtool with the generator that they replaced, which seeded
+//  a new Mersenne Twister from std::random_device on every call.
+//
+//  Author: Kidus Zegeye
+//  Version: 3/9/25
+//
+#ifndef __UB_APP_H__
+#define __UB_APP_H__
+#include <cugl/core/cu_base.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * This class represents the application root for the UUID benchmark.
+ *
+ * The benchmark first checks the generated UUIDs: they must be unique, the
+ * version 7 UUIDs must be increasing, parsing and formatting must round trip,
+ * and the stduuid library must accept them. It then times each UUID function,
+ * one per frame, and logs the nanoseconds per call. The first timing is the
+ * old generator, which is the baseline. The application quits once every
+ * benchmark is done.
+ */
+class UUIDApp : public cugl::Application {
+protected:
+    /**
+     * A single timed benchmark
+     *
+     * The function is called the given number of times. It returns a value
+     * derived from its result, so that the compiler cannot remove the call.
+     */
+    typedef struct {
+        /** The benchmark name */
+        std::string name;
+        /** The number of calls to time */
+        size_t iterations;
+        /** The function to time */
+        std::function<size_t()> function;
+    } Benchmark;
+
+    /** The benchmarks to time, in order */
+    std::vector<Benchmark> _benchmarks;
+    /** The index of the next benchmark */
+    size_t _next;
+    /** The time per call (in nanoseconds) of the baseline */
+    double _baseline;
+    /** The combined results of the timed calls */
+    size_t _sink;
+
+    /**
+     * Returns true if the generated UUIDs pass every check.
+     *
+     * The failed checks are logged.
+     *
+     * @param count     The number of UUIDs to generate for the uniqueness checks
+     * @param threads   The number of threads for the thread check
+     *
+     * @return true if the generated UUIDs pass every check.
+     */
+    bool check(size_t count, size_t threads);
+
+    /**
+     * Times the given benchmark and logs the result.
+     *
+     * @param bench     The benchmark to time
+     */
+    void measure(const Benchmark& bench);
+
+public:
+    /**
+     * Creates, but does not initialize, a new application.
+     *
+     * This constructor is called by main.cpp. You will notice that, like
+     * most of the classes in CUGL, we do not do any initialization in the
+     * constructor. That is the purpose of the init() method. Separation
+     * of initialization from the constructor allows main.cpp to perform
+     * advanced configuration of the application before it starts.
+     */
+    UUIDApp() : cugl::Application(), _next(0), _baseline(0), _sink(0) {}
+
+    /**
+     * Disposes of this application, releasing all resources.
+     *
+     * This destructor is called by main.cpp when the application quits.
+     * It simply calls the dispose() method in Application. There is nothing
+     * special to do here.
+     */
+    ~UUIDApp() { }
+
+    /**
+     * The method called after the application is initialized, but before running.
+     *
+     * This reads the benchmark settings, checks the generated UUIDs, and sets
+     * up the benchmarks. If a check fails, the application quits.
+     *
+     * When overriding this method, you should call the parent method as the
+     * very last line. This ensures that the state will transition to FOREGROUND,
+     * causing the application to run.
+     */
+    virtual void onStartup() override;
+
+    /**
+     * The method called to update the application data.
+     *
+     * This times the next benchmark, or quits if there are none left.
+     *
+     * @param timestep  The amount of time (in seconds) since the last frame
+     */
+    virtual void update(float timestep) override;
+};
+
+#endif /* __UB_APP_H__ */
@@ -50,6 +50,9 @@
 
 namespace cugl {
 
+/** Forward reference to an asset bundle */
+class AssetBundle;
+
     /**
      * The classes supporting sound playback and recording.
      *
@@ -155,6 +158,21 @@ public:
      */
     bool init(const std::string file, AudioType type);
     
+    /**
+     * Initializes a new decoder for a file in the given asset bundle.
+     *
+     * The decoder reads the file directly from the bundle. It does not need
+     * the bundle to remain loaded. If the audio type is not correct for this
+     * file, this initializer will fail and return false.
+     *
+     * @param bundle    the asset bundle with the source file
+     * @param file      the path of the source file in the bundle
+     * @param type      the codec type for this file
+     *
+     * @return true if the decoder was initialized successfully
+     */
+    bool init(const std::shared_ptr<AssetBundle>& bundle, const std::string file, AudioType type);
+    
     /**
      * Deletes the decoder resources and resets all attributes.
      *
@@ -197,6 +215,25 @@ public:
         return (result->init(file,type) ? result : nullptr);
     }
     
+    /**
+     * Creates a newly allocated decoder for a file in the given asset bundle.
+     *
+     * The decoder reads the file directly from the bundle. It does not need
+     * the bundle to remain loaded. If the audio type is not correct for this
+     * file, this allocator will fail and return nullptr.
+     *
+     * @param bundle    the asset bundle with the source file
+     * @param file      the path of the source file in the bundle
+     * @param type      the codec type for this file
+     *
+     * @return a newly allocated decoder for a file in the given asset bundle.
+     */
+    static std::shared_ptr<AudioDecoder> alloc(const std::shared_ptr<AssetBundle>& bundle,
+                                               const std::string file, AudioType type) {
+        std::shared_ptr<AudioDecoder> result = std::make_shared<AudioDecoder>();
+        return (result->init(bundle,file,type) ? result : nullptr);
+    }
+    
     
 #pragma mark Attributes
     /**
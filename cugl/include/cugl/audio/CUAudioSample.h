@@ -57,6 +57,9 @@
 
 namespace  cugl {
 
+/** Forward reference to an asset bundle */
+class AssetBundle;
+
     /**
      * The classes supporting sound playback and recording.
      *
@@ -101,6 +104,9 @@ protected:
     /** The in-memory sound buffer for this sound source (OPTIONAL) */
     float* _buffer;
     
+    /** The asset bundle with the source file (OPTIONAL) */
+    std::shared_ptr<AssetBundle> _bundle;
+    
 public:
 #pragma mark Constructors
     /**
@@ -130,6 +136,24 @@ public:
      */
     bool init(const std::string file, bool stream=false);
     
+    /**
+     * Initializes a new audio sample for a file in the given asset bundle.
+     *
+     * The choice of buffered or streaming is independent of the file type.
+     * If the file is streamed, it will not be loaded into memory.  Otherwise,
+     * this initializer will allocate memory to read the asset into memory.
+     *
+     * A streamed sample keeps a reference to the bundle, as each playback
+     * opens the file again.
+     *
+     * @param bundle    The asset bundle with the source file
+     * @param file      The path of the source file in the bundle
+     * @param stream    Wether to stream the audio from the file.
+     *
+     * @return true if the sound source was initialized successfully
+     */
+    bool init(const std::shared_ptr<AssetBundle>& bundle, const std::string file, bool stream=false);
+    
     /**
      * Initializes an empty audio sample of the given size.
      *
@@ -192,6 +216,28 @@ public:
         return (result->init(file,stream) ? result : nullptr);
     }
     
+    /**
+     * Returns a newly allocated audio sample for a file in the given asset bundle.
+     *
+     * The choice of buffered or streaming is independent of the file type.
+     * If the file is streamed, it will not be loaded into memory.  Otherwise,
+     * this initializer will allocate memory to read the asset into memory.
+     *
+     * A streamed sample keeps a reference to the bundle, as each playback
+     * opens the file again.
+     *
+     * @param bundle    The asset bundle with the source file
+     * @param file      The path of the source file in the bundle
+     * @param stream    Wether to stream the audio from the file.
+     *
+     * @return a newly allocated audio sample for a file in the given asset bundle.
+     */
+    static std::shared_ptr<AudioSample> alloc(const std::shared_ptr<AssetBundle>& bundle,
+                                              const std::string file, bool stream=false) {
+        std::shared_ptr<AudioSample> result = std::make_shared<AudioSample>();
+        return (result->init(bundle,file,stream) ? result : nullptr);
+    }
+    
     /**
      * Returns an empty audio sample of the given size.
      *
@@ -34,6 +34,7 @@
 #ifndef __CU_APPLICATION_H__
 #define __CU_APPLICATION_H__
 #include <cugl/core/util/CUTimestamp.h>
+#include <cugl/core/util/CUScheduler.h>
 #include <cugl/core/math/CUColor4.h>
 #include <cugl/core/math/CURect.h>
 #include <unordered_map>
@@ -43,29 +44,6 @@
 
 namespace cugl {
 
-/**
- * The storage type for all user-defined callbacks.
- *
- * The application API provides a way for the user to attach one-time or 
- * reoccuring callback functions.  This to allow the user to schedule 
- * activity in a future animation frame without having to create a separate
- * thread.  This is particularly important for functionality that accesses
- * the OpenGL context (or any of the low-level SDL subsystems), as that must 
- * be done in the main thread.
- *
- * To keep things simple, callbacks should never require arguments or
- * return a value.  If you wish to keep state, it should be done through
- * the appropriate closure.
- */
-typedef struct {
-    /** The callback function */
-    std::function<bool()> callback;
-    /** The reoccurrence period (0 if called every frame) */
-    Uint32 period;
-    /** The countdown until the next reoccurrence */
-    Uint32 timer;
-} scheduable;
-    
 /**
  * This class represents a basic CUGL application
  *
@@ -192,19 +170,15 @@ private:
     /** The time left over after the last call to fixed update */
     Uint32 _fixedRemainder;
     
-    /** Counter to assign unique keys to callbacks */
-    Uint32 _funcid;
-    
     /** Callback functions (processed at the start of every loop) */
-    std::unordered_map<Uint32, scheduable> _callbacks;
-    /** A mutex lock for the schedule queue */
-    std::mutex _queueMutex;
+    Scheduler _scheduler;
     /**
      * Processes all of the scheduled callback functions.
      *
      * This method wakes up any sleeping callbacks that should be executed.
      * If they are a one time callback, they are deleted.  If they are
-     * a reoccuring callback, the timer is reset.
+     * a reoccuring callback, the timer is reset. Callbacks with the same
+     * deadline are executed in the order that they were scheduled.
      *
      * @param millis    The number of milliseconds since last called
      */
@@ -486,6 +460,8 @@ public:
      * It will be executed after the input has been processed, but before
      * either {@link #update} or {@link #preUpdate} are invoked.
      *
+     * This method may be called from any thread, and it never blocks.
+     *
      * @param callback  The callback function
      * @param time      The number of milliseconds to delay the callback.
      *
@@ -514,6 +490,8 @@ public:
      * It will be executed after the input has been processed, but before
      * either {@link #update} or {@link #preUpdate} are invoked.
      *
+     * This method may be called from any thread, and it never blocks.
+     *
      * @param callback  The callback function
      * @param time      The number of milliseconds to delay the callback.
      * @param period	The delay until the callback is executed again.
@@ -534,6 +512,10 @@ public:
      * appropriate schedule function.  Hence this value should be saved if
      * you ever wish to unschedule a callback.
      *
+     * The callback is removed at the start of the next animation frame. So a
+     * callback that is unscheduled by another callback in the same frame may
+     * still be executed in that frame.
+     *
      * @param id    The callback identifier
      */
     void unschedule(Uint32 id);
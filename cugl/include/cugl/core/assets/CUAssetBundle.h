@@ -0,0 +1,339 @@
+//
+//  CUAssetBundle.h
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides support for asset bundles. A bundle is a single file
+//  that packs many asset files (textures, fonts, sounds, json and widgets)
+//  with an index. Opening one bundle replaces a file open for every asset,
+//  which is the dominant cost of loading many small assets on mobile storage.
+//
+//  Bundles are created with the packer in cugl/scripts/bundle.py. At runtime
+//  the bundle is memory mapped (where the platform allows it), and loaders
+//  read each asset as a view into that memory. Entries may optionally be
+//  compressed with the LZ4 block format, in which case they are decompressed
+//  when opened.
+//
+//  This class uses our standard shared-pointer architecture.
+//
+//  1. The constructor does not perform any initialization; it just sets all
+//     attributes to their defaults.
+//
+//  2. All initialization takes place via init methods, which can fail if an
+//     object is initialized more than once.
+//
+//  3. All allocation takes place via static constructors which return a shared
+//     pointer.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Kidus Zegeye
+//  Version: 3/9/25
+//
+#ifndef __CU_ASSET_BUNDLE_H__
+#define __CU_ASSET_BUNDLE_H__
+#include <cugl/core/CUBase.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+namespace cugl {
+
+/** Forward reference to the JSON value */
+class JsonValue;
+
+/**
+ * This class represents a read-only bundle of asset files.
+ *
+ * A bundle packs the files of an asset directory into a single archive. The
+ * files in a bundle are identified by their path relative to the asset
+ * directory, which is the same path used by the JSON directories passed to
+ * {@link AssetManager}. Hence a bundle can replace the loose files without
+ * changing the asset directory.
+ *
+ * The archive has the following (little-endian) layout. The header is 40
+ * bytes:
+ *
+ *      "CUBUNDLE"      The 8 byte magic number
+ *      Uint32          The format version (1)
+ *      Uint32          The alignment of each entry
+ *      Uint32          The number of entries
+ *      Uint32          Reserved flags (0)
+ *      Uint64          The offset of the index
+ *      Uint64          The size of the index
+ *
+ * The entry data follows the header, with each entry aligned to the given
+ * alignment. The index is a sequence of records, one per entry:
+ *
+ *      Uint64          The offset of the entry data
+ *      Uint64          The stored size of the entry
+ *      Uint64          The size of the entry once decompressed
+ *      Uint32          The compression scheme (see {@link Compression})
+ *      Uint16          The length of the path
+ *      char[]          The path (UTF-8, with / separators)
+ *
+ * On platforms with memory mapping (everything but Android), the archive is
+ * mapped rather than read. Uncompressed entries are never copied. Both
+ * {@link data} and {@link open} provide views into the mapped memory.
+ *
+ * Once initialized, a bundle is immutable. Hence all of the read methods are
+ * safe to call from any thread, including the worker threads of an asset
+ * manager.
+ */
+class AssetBundle {
+public:
+    /**
+     * The compression schemes for a bundle entry.
+     */
+    enum class Compression : Uint32 {
+        /** The entry is stored as is */
+        NONE = 0,
+        /** The entry is a single block in the LZ4 block format */
+        LZ4  = 1
+    };
+
+    /** The bundle format version supported by this class */
+    static const Uint32 VERSION = 1;
+
+private:
+    /** This macro disables the copy constructor (not allowed on assets) */
+    CU_DISALLOW_COPY_AND_ASSIGN(AssetBundle);
+
+    /**
+     * The location of a single file in the bundle.
+     */
+    class Entry {
+    public:
+        /** The offset of the entry data in the archive */
+        Uint64 offset;
+        /** The number of bytes stored in the archive */
+        Uint64 stored;
+        /** The number of bytes once decompressed */
+        Uint64 length;
+        /** The compression scheme of this entry */
+        Compression compression;
+    };
+
+    /** The archive contents, either mapped or read into memory */
+    class Region;
+
+    /** The path to the bundle archive */
+    std::string _file;
+    /** The archive contents (shared with any open streams) */
+    std::shared_ptr<Region> _region;
+    /** The entries of this bundle, by path */
+    std::unordered_map<std::string, Entry> _entries;
+
+    /**
+     * Returns the entry for the given path (or nullptr if there is none)
+     *
+     * @param path  The path relative to the asset directory
+     *
+     * @return the entry for the given path (or nullptr if there is none)
+     */
+    const Entry* find(const std::string path) const;
+
+    /**
+     * Returns a newly allocated buffer with the decompressed entry.
+     *
+     * The buffer should be freed with SDL_free. This method returns nullptr
+     * if the entry data is corrupt.
+     *
+     * @param entry The entry to decompress
+     *
+     * @return a newly allocated buffer with the decompressed entry.
+     */
+    Uint8* decompress(const Entry* entry) const;
+
+public:
+#pragma mark Constructors
+    /**
+     * Creates an uninitialized asset bundle.
+     *
+     * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a bundle on
+     * the heap, use one of the static constructors instead.
+     */
+    AssetBundle() {}
+
+    /**
+     * Deletes this asset bundle, disposing all resources.
+     */
+    ~AssetBundle() { dispose(); }
+
+    /**
+     * Disposes all of the resources used by this asset bundle.
+     *
+     * The archive is unmapped once every stream from {@link open} is closed.
+     * A disposed bundle can be safely reinitialized.
+     */
+    void dispose();
+
+    /**
+     * Initializes an asset bundle from the given archive.
+     *
+     * A relative path is interpreted as relative to the asset directory. This
+     * method reads the index of the archive, but not the entries. It fails if
+     * the archive is missing, corrupt, or has an unsupported version.
+     *
+     * @param file  The path to the bundle archive
+     *
+     * @return true if the bundle was initialized successfully
+     */
+    bool init(const std::string file);
+
+    /**
+     * Returns a newly allocated asset bundle from the given archive.
+     *
+     * A relative path is interpreted as relative to the asset directory. This
+     * method reads the index of the archive, but not the entries. It fails if
+     * the archive is missing, corrupt, or has an unsupported version.
+     *
+     * @param file  The path to the bundle archive
+     *
+     * @return a newly allocated asset bundle from the given archive.
+     */
+    static std::shared_ptr<AssetBundle> alloc(const std::string file) {
+        std::shared_ptr<AssetBundle> result = std::make_shared<AssetBundle>();
+        return (result->init(file) ? result : nullptr);
+    }
+
+#pragma mark Attributes
+    /**
+     * Returns the path to the bundle archive
+     *
+     * @return the path to the bundle archive
+     */
+    const std::string getFile() const { return _file; }
+
+    /**
+     * Returns the number of files in this bundle
+     *
+     * @return the number of files in this bundle
+     */
+    size_t size() const { return _entries.size(); }
+
+    /**
+     * Returns true if the archive is memory mapped.
+     *
+     * If this value is false, the archive was read into memory instead.
+     *
+     * @return true if the archive is memory mapped.
+     */
+    bool isMapped() const;
+
+    /**
+     * Returns the paths of the files in this bundle
+     *
+     * @return the paths of the files in this bundle
+     */
+    std::vector<std::string> paths() const;
+
+#pragma mark File Access
+    /**
+     * Returns true if this bundle has a file with the given path.
+     *
+     * Paths are relative to the asset directory, as in a JSON directory.
+     *
+     * @param path  The path relative to the asset directory
+     *
+     * @return true if this bundle has a file with the given path.
+     */
+    bool contains(const std::string path) const {
+        return find(path) != nullptr;
+    }
+
+    /**
+     * Returns true if the given file is compressed in this bundle.
+     *
+     * @param path  The path relative to the asset directory
+     *
+     * @return true if the given file is compressed in this bundle.
+     */
+    bool isCompressed(const std::string path) const;
+
+    /**
+     * Returns the size in bytes of the given file (0 if it is not present)
+     *
+     * This is the size of the file once decompressed.
+     *
+     * @param path  The path relative to the asset directory
+     *
+     * @return the size in bytes of the given file (0 if it is not present)
+     */
+    size_t length(const std::string path) const;
+
+    /**
+     * Returns a view of the contents of the given file.
+     *
+     * This view is a pointer into the archive, and is valid until the bundle
+     * is disposed. It is nullptr if the file is not present, or if the file
+     * is compressed (in which case you should use {@link open} instead).
+     *
+     * @param path  The path relative to the asset directory
+     *
+     * @return a view of the contents of the given file.
+     */
+    const Uint8* data(const std::string path) const;
+
+    /**
+     * Returns a read-only stream for the given file.
+     *
+     * For an uncompressed file, the stream is a view into the archive and
+     * does not copy the file. A compressed file is decompressed into a buffer
+     * owned by the stream. Either way, the stream keeps the archive alive
+     * until it is closed, so it may outlive this bundle.
+     *
+     * The stream should be closed with SDL_RWclose (or passed to an SDL
+     * function that takes ownership of it). This method returns nullptr if
+     * the file is not present or is corrupt.
+     *
+     * @param path  The path relative to the asset directory
+     *
+     * @return a read-only stream for the given file.
+     */
+    SDL_RWops* open(const std::string path) const;
+
+    /**
+     * Returns the contents of the given file as a string.
+     *
+     * The string is empty if the file is not present or is corrupt.
+     *
+     * @param path  The path relative to the asset directory
+     *
+     * @return the contents of the given file as a string.
+     */
+    std::string readText(const std::string path) const;
+
+    /**
+     * Returns the contents of the given file as a JSON value.
+     *
+     * This method returns nullptr if the file is not present or if it is
+     * not a valid JSON file.
+     *
+     * @param path  The path relative to the asset directory
+     *
+     * @return the contents of the given file as a JSON value.
+     */
+    std::shared_ptr<JsonValue> readJson(const std::string path) const;
+};
+
+}
+
+#endif /* __CU_ASSET_BUNDLE_H__ */
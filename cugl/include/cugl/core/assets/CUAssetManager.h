@@ -49,8 +49,14 @@
 #include <cugl/core/util/CUThreadPool.h>
 #include <cugl/core/util/CUDebug.h>
 #include <cugl/core/assets/CULoader.h>
+#include <cugl/core/assets/CUAssetBundle.h>
 #include <typeinfo>
 #include <future>
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <vector>
 
 
 namespace cugl {
@@ -92,11 +98,74 @@ protected:
     std::unordered_map<std::string,size_t> _jsonKeys;
     /** The priorities for each JSON key */
     std::unordered_map<std::string,Uint32> _priority;
-    /** The central thread for managing all of the loaders */
+    /** The worker threads shared by all of the loaders */
     std::shared_ptr<ThreadPool> _workers;
 
     /** State variable to manage reading JSON directories */
     bool _preload;
+
+    /**
+     * An asset directory that is loading asynchronously.
+     *
+     * The categories of the directory are grouped by loader priority. Each
+     * group is only started once every asset of the previous group has been
+     * materialized.
+     */
+    class Directory {
+    public:
+        /** A category of the directory, with the size of each asset */
+        class Category {
+        public:
+            /** The hash of the asset type */
+            size_t hash;
+            /** The child of asset directory with these assets */
+            std::shared_ptr<JsonValue> json;
+            /** The size in bytes of each asset (0 if it is already loaded) */
+            std::vector<size_t> bytes;
+        };
+
+        /** The categories of each priority, from highest to lowest priority */
+        std::vector<std::vector<Category>> tiers;
+        /** The current priority group */
+        size_t current;
+        /** The bytes of every started priority group */
+        size_t expected;
+        /** The bytes of the assets that have finished */
+        size_t loaded;
+        /** An optional callback after each asset is loaded */
+        LoaderCallback callback;
+
+        /** Creates an empty directory */
+        Directory() : current(0), expected(0), loaded(0) {}
+    };
+
+    /** The asset directories loading asynchronously */
+    std::vector<std::shared_ptr<Directory>> _directories;
+    /** The total bytes of the asset directories loading asynchronously */
+    size_t _totalBytes;
+    /** The bytes of the asset directories that have finished */
+    size_t _loadedBytes;
+
+    /** The default milliseconds allowed for materialization each frame */
+    static const Uint32 DEFAULT_BUDGET = 8;
+    /** The milliseconds allowed for materialization each frame (0 for unlimited) */
+    Uint32 _budget;
+    /** The materialization tasks waiting for the main thread */
+    std::deque<std::function<void()>> _deferred;
+    /** The mutex protecting the materialization tasks */
+    std::mutex _deferMutex;
+    /** Whether this manager is updated every animation frame */
+    bool _updating;
+    /** The identifier of the scheduled update */
+    Uint32 _updateKey;
+
+    /** The mounted asset bundles, most recently mounted first */
+    std::vector<std::shared_ptr<AssetBundle>> _bundles;
+    /** The mutex protecting the mounted bundles */
+    mutable std::mutex _bundleMutex;
+
+    /** Loaders defer their materialization tasks to this manager */
+    friend class BaseLoader;
     
     /**
      * Synchronously reads an asset category from a JSON file
@@ -125,38 +194,18 @@ protected:
     /**
      * Asynchronously reads an asset category from a JSON file
      *
-     * JSON directories provide a robust way for us to load a collection of
-     * assets. Instead of having to define parameters like asset key, font
-     * size, or texture wrap in the code, we can specify them in a JSON file.
-     * This JSON file (called the asset directory) is read by the asset manager,
-     * and directs the various loaders to load in assets.
-     *
-     * Currently JSON loading supports five types of assets, with the following
-     * names: "textures", "fonts", "music", "soundfx", and "jsons".  See the
-     * method {@link BaseLoader#read} in each of the individual loaders for a
-     * description of the suported JSON format. A loader must still be attached
-     * for the asset manager to read that type of asset.  If the asset directory
-     * contains an asset for which there is no attached asset manager, those
-     * specific assets will not be loaded.
-     *
-     * As an asynchronous read, all asset loading will take place outside of
-     * the main thread.  However, assets such as fonts and textures will need
-     * the OpenGL context to complete, so part of their asset loading may take
-     * place in the main thread via the {@link Application#schedule} interface.
-     * You may either poll this interface to determine when the assets are 
-     * loaded or use optional callbacks.
-     *
-     * The optional callback function will be called each time an individual
-     * asset loads or fails to load.  However, if the entire category fails
-     * to load, the callback function will be given the asset category name 
-     * (e.g. "soundfx") as the asset key.
+     * This method is used by {@link loadDirectoryAsync} to start the assets
+     * of a category. The assets are preloaded on the worker threads, and
+     * materialized in the main thread. The callback of the directory is
+     * called each time an individual asset loads or fails to load. However,
+     * if there is no loader for the category, the callback function will be
+     * given the asset category name (e.g. "soundfx") as the asset key.
      *
-     * @param hash      The hash of the asset type
-     * @param json      The child of asset directory with these assets
-     * @param callback  An optional callback after each asset is loaded
+     * @param directory The asset directory loading this category
+     * @param category  The category to read
      */
-    void readCategory(size_t hash, const std::shared_ptr<JsonValue>& json,
-                      LoaderCallback callback);
+    void readCategory(const std::shared_ptr<Directory>& directory,
+                      const Directory::Category& category);
     
     /**
      * Immediately removes an asset category previously loaded from the JSON file
@@ -173,14 +222,44 @@ protected:
     bool purgeCategory(size_t hash, const std::shared_ptr<JsonValue>& json);
 
     /**
-     * Synchronizes the asset manager to wait until all assets have finished.
+     * Starts the next priority group of the given asset directory.
+     *
+     * This returns false if the directory has no more groups.
      *
-     * This method is necessary for assets whose construction depends on
-     * previously loaded assets (e.g. scene graphs). In the current
-     * architecture, this method is only correct if the asset manager loads
-     * assets in a single thread.
+     * @param directory The asset directory to advance
+     *
+     * @return true if a priority group was started
      */
-    void sync();
+    bool advance(const std::shared_ptr<Directory>& directory);
+
+    /**
+     * Adds a materialization task for the main thread.
+     *
+     * Tasks are executed in the order they are added, as part of the update
+     * of this manager. This method is safe to call from any thread.
+     *
+     * @param task  The task to execute in the main thread
+     */
+    void defer(std::function<void()> task);
+
+    /**
+     * Ensures that this manager is updated every animation frame.
+     *
+     * The update is scheduled with {@link Application#schedule}, and it stops
+     * itself once there is nothing left to do.
+     */
+    void wake();
+
+    /**
+     * Performs the asynchronous work of this manager for one frame.
+     *
+     * This executes the deferred materialization tasks (within the frame
+     * budget), and then starts the next priority group of any asset directory
+     * whose current group is complete.
+     *
+     * @return true if there is still work for later frames
+     */
+    bool update();
     
 #pragma mark -
 #pragma mark Constructors
@@ -191,7 +270,8 @@ public:
      * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate an asset 
      * manager on the heap, use one of the static constructors instead.
      */
-    AssetManager() : _preload(false) {}
+    AssetManager() : _preload(false), _totalBytes(0), _loadedBytes(0),
+    _budget(DEFAULT_BUDGET), _updating(false), _updateKey(0) {}
     
     /**
      * Deletes this asset manager, disposing of all resources.
@@ -210,10 +290,10 @@ public:
     /**
      * Initializes a new asset manager.
      *
-     * The asset manager has a single thread, as some of the asset loading
-     * operations (particularly fonts) cannot be run in multiple threads
-     * simultaneously. However, it will run in a distinct thread from the
-     * main application.
+     * The asset manager has one worker thread for each core beyond the main
+     * thread (and at least one). Loaders that are not thread-safe (see
+     * {@link BaseLoader#isConcurrent}) still load one asset at a time, but
+     * they can run alongside the other loaders.
      *
      * This initializer does not attach any loaders.  It simply creates an 
      * object that is ready to accept loader objects.
@@ -222,17 +302,32 @@ public:
      */
     bool init();
 
+    /**
+     * Initializes a new asset manager with the given number of threads.
+     *
+     * Loaders that are not thread-safe (see {@link BaseLoader#isConcurrent})
+     * still load one asset at a time, but they can run alongside the other
+     * loaders.
+     *
+     * This initializer does not attach any loaders.  It simply creates an
+     * object that is ready to accept loader objects.
+     *
+     * @param threads   The number of worker threads
+     *
+     * @return true if the asset manager was initialized successfully
+     */
+    bool init(Uint32 threads);
+
     
 #pragma mark -
 #pragma mark Static Constructors
     /**
      * Returns a newly allocated asset manager.
      *
-     * The asset manager has a single thread, as some of the asset loading
-     * operations (particularly fonts) cannot be run in multiple threads
-     * simultaneously. However, it will run in a distinct thread from the
-     * main application. In addition, confining to one thread allows us to
-     * handle dependencies between loaders.
+     * The asset manager has one worker thread for each core beyond the main
+     * thread (and at least one). Loaders that are not thread-safe (see
+     * {@link BaseLoader#isConcurrent}) still load one asset at a time, but
+     * they can run alongside the other loaders.
      *
      * This constructor does not attach any loaders.  It simply creates an
      * object that is ready to accept loader objects.
@@ -244,6 +339,25 @@ public:
         return (result->init() ? result : nullptr);
     }
 
+    /**
+     * Returns a newly allocated asset manager with the given number of threads.
+     *
+     * Loaders that are not thread-safe (see {@link BaseLoader#isConcurrent})
+     * still load one asset at a time, but they can run alongside the other
+     * loaders.
+     *
+     * This constructor does not attach any loaders.  It simply creates an
+     * object that is ready to accept loader objects.
+     *
+     * @param threads   The number of worker threads
+     *
+     * @return a newly allocated asset manager with the given number of threads.
+     */
+    static std::shared_ptr<AssetManager> alloc(Uint32 threads) {
+        std::shared_ptr<AssetManager> result = std::make_shared<AssetManager>();
+        return (result->init(threads) ? result : nullptr);
+    }
+
 #pragma mark -
 #pragma mark Loader Management
     /**
@@ -341,6 +455,8 @@ public:
      */
     void detachAll() {
         for(auto it = _handlers.begin(); it != _handlers.end(); ++it) {
+            it->second->setThreadPool(nullptr);
+            it->second->setManager(nullptr);
             it->second = nullptr;
         }
         _handlers.clear();
@@ -418,13 +534,123 @@ public:
      * loaded asynchronously and have not completed loading. It is not safe to 
      * use asynchronously loaded assets until all loading is complete.
      *
+     * While an asset directory is loading asynchronously, the progress is
+     * measured in bytes (see {@link loadedBytes}). Otherwise, every asset
+     * counts equally. In either case, the progress never reaches 1 while
+     * any asset (or priority group of a directory) is still pending.
+     *
      * @return the loader progress as a percentage.
      */
     float progress() const  {
+        if (_totalBytes > 0) {
+            float result = std::min(1.0f, ((float)_loadedBytes)/_totalBytes);
+            if (result >= 1.0f && (!_directories.empty() || waitCount() > 0)) {
+                result = std::nextafter(1.0f, 0.0f);
+            }
+            return result;
+        }
         size_t size = loadCount()+waitCount();
         return (size == 0 ? 0.0f : ((float)loadCount())/size);
     }
 
+    /**
+     * Returns the bytes loaded by the asset directories loading asynchronously.
+     *
+     * The size of an asset is the size of its file. An asset counts once it
+     * has been materialized (or failed to load). The value resets to 0 once
+     * every asset directory is done.
+     *
+     * @return the bytes loaded by the asset directories loading asynchronously.
+     */
+    size_t loadedBytes() const { return _loadedBytes; }
+
+    /**
+     * Returns the total bytes of the asset directories loading asynchronously.
+     *
+     * The size of an asset is the size of its file, or of its JSON entry if
+     * it has no file. Assets that are already loaded are not counted. The
+     * value resets to 0 once every asset directory is done.
+     *
+     * @return the total bytes of the asset directories loading asynchronously.
+     */
+    size_t totalBytes() const { return _totalBytes; }
+
+#pragma mark -
+#pragma mark Threading
+    /**
+     * Returns the number of worker threads of this manager.
+     *
+     * @return the number of worker threads of this manager.
+     */
+    size_t getThreadCount() const {
+        return _workers == nullptr ? 0 : _workers->getThreadCount();
+    }
+
+    /**
+     * Returns the milliseconds allowed for materialization each frame.
+     *
+     * Materialization (such as creating OpenGL textures) must take place in
+     * the main thread. When assets load asynchronously, this manager stops
+     * materializing assets for the current frame once this much time has
+     * passed. It always materializes at least one asset each frame. A value
+     * of 0 means that every pending asset is materialized in the same frame.
+     *
+     * @return the milliseconds allowed for materialization each frame.
+     */
+    Uint32 getFrameBudget() const { return _budget; }
+
+    /**
+     * Sets the milliseconds allowed for materialization each frame.
+     *
+     * Materialization (such as creating OpenGL textures) must take place in
+     * the main thread. When assets load asynchronously, this manager stops
+     * materializing assets for the current frame once this much time has
+     * passed. It always materializes at least one asset each frame. A value
+     * of 0 means that every pending asset is materialized in the same frame.
+     *
+     * @param millis    The milliseconds allowed for materialization each frame
+     */
+    void setFrameBudget(Uint32 millis) { _budget = millis; }
+
+#pragma mark -
+#pragma mark Asset Bundles
+    /**
+     * Mounts the given asset bundle on this manager.
+     *
+     * Once a bundle is mounted, the attached loaders read any asset in the
+     * bundle from the bundle instead of the asset directory. This includes
+     * the asset directories passed to {@link loadDirectory}. If an asset is
+     * in more than one mounted bundle, the most recently mounted bundle wins.
+     *
+     * Bundles are typically mounted by {@link BundleLoader}, so that they are
+     * mounted when loaded and unmounted when unloaded. Mounting a bundle
+     * twice has no effect.
+     *
+     * @param bundle    The bundle to mount
+     */
+    void mount(const std::shared_ptr<AssetBundle>& bundle);
+
+    /**
+     * Unmounts the given asset bundle from this manager.
+     *
+     * Assets that were already loaded from the bundle are unaffected.
+     *
+     * @param bundle    The bundle to unmount
+     */
+    void unmount(const std::shared_ptr<AssetBundle>& bundle);
+
+    /**
+     * Returns the mounted bundle with the given asset (or nullptr if none)
+     *
+     * The path is relative to the asset directory, as in a JSON directory.
+     * This method is safe to call from any thread.
+     *
+     * @param path  The path to the asset
+     *
+     * @return the mounted bundle with the given asset (or nullptr if none)
+     */
+    std::shared_ptr<AssetBundle> findBundle(const std::string path) const;
+
     
 #pragma mark -
 #pragma mark Loading/Unloading
@@ -661,6 +887,11 @@ public:
      * You may either poll this interface to determine when the assets are
      * loaded or use optional callbacks.
      *
+     * Assets are preloaded by all of the worker threads at once, and a lower
+     * priority does not start until every asset of the higher priorities has
+     * been materialized. Materialization in the main thread is limited to
+     * {@link getFrameBudget} milliseconds each frame.
+     *
      * The optional callback function will be called each time an individual
      * asset loads or fails to load.  However, if the entire category fails
      * to load, the callback function will be given the asset category name
@@ -702,6 +933,11 @@ public:
      * You may either poll this interface to determine when the assets are
      * loaded or use optional callbacks.
      *
+     * Assets are preloaded by all of the worker threads at once, and a lower
+     * priority does not start until every asset of the higher priorities has
+     * been materialized. Materialization in the main thread is limited to
+     * {@link getFrameBudget} milliseconds each frame.
+     *
      * The optional callback function will be called each time an individual
      * asset loads or fails to load.  However, if the entire category fails
      * to load, the callback function will be given the asset category name
@@ -0,0 +1,230 @@
+//
+//  CUBundleLoader.h
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides a specific implementation of the Loader class to load
+//  asset bundles. A bundle packs many asset files into a single archive. When
+//  this loader is attached to an asset manager, every bundle it loads is
+//  mounted on that manager, so the other loaders read their assets from the
+//  bundle instead of the asset directory.
+//
+//  As with all of our loaders, this loader is designed to be attached to an
+//  asset manager. In addition, this class uses our standard shared-pointer
+//  architecture.
+//
+//  1. The constructor does not perform any initialization; it just sets all
+//     attributes to their defaults.
+//
+//  2. All initialization takes place via init methods, which can fail if an
+//     object is initialized more than once.
+//
+//  3. All allocation takes place via static constructors which return a shared
+//     pointer.
+//
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty. In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Kidus Zegeye
+//  Version: 3/9/25
+//
+#ifndef __CU_BUNDLE_LOADER_H__
+#define __CU_BUNDLE_LOADER_H__
+#include <cugl/core/assets/CULoader.h>
+#include <cugl/core/assets/CUAssetBundle.h>
+
+namespace cugl {
+
+/**
+ * This class is a implementation of Loader<AssetBundle>
+ *
+ * This asset loader allows us to allocate asset bundles. If the loader is
+ * attached to an {@link AssetManager}, each bundle is mounted on the manager
+ * once it is loaded, and unmounted when it is unloaded. While a bundle is
+ * mounted, the other loaders read any asset in the bundle from the bundle.
+ *
+ * A bundle must be mounted before the assets in it are loaded. The simplest
+ * way to do that is to load the bundle synchronously before loading the
+ * asset directory (which may itself be in the bundle):
+ *
+ *      assets->attach<AssetBundle>(BundleLoader::alloc()->getHook());
+ *      assets->load<AssetBundle>("main","main.bundle");
+ *      assets->loadDirectoryAsync("json/assets.json",callback);
+ *
+ * Bundles may also appear in a JSON directory under the key "bundles". Each
+ * entry is a key with a string value for the path to the bundle. In that
+ * case, the bundle only serves directories loaded after it is finished.
+ *
+ * As with all of our loaders, this loader is designed to be attached to an
+ * asset manager. Use the method {@link getHook()} to get the appropriate
+ * pointer for attaching the loader.
+ */
+class BundleLoader : public Loader<AssetBundle> {
+private:
+    /** This macro disables the copy constructor (not allowed on assets) */
+    CU_DISALLOW_COPY_AND_ASSIGN(BundleLoader);
+
+protected:
+    /**
+     * Finishes loading the bundle, cleaning up the wait queues.
+     *
+     * Reading the bundle index can be done safely in a separate thread.
+     * This method mounts the bundle on the asset manager (if any), which
+     * must take place in the main thread.
+     *
+     * This method supports an optional callback function which reports whether
+     * the asset was successfully materialized.
+     *
+     * @param key       The key to access the asset after loading
+     * @param bundle    The bundle asset fully loaded
+     * @param callback  An optional callback for asynchronous loading
+     */
+    void materialize(const std::string key, const std::shared_ptr<AssetBundle>& bundle,
+                     LoaderCallback callback);
+
+    /**
+     * Internal method to support asset loading.
+     *
+     * This method supports either synchronous or asynchronous loading, as
+     * specified by the given parameter. If the loading is asynchronous,
+     * the user may specify an optional callback function.
+     *
+     * This method will split the loading across the {@link AssetBundle#alloc}
+     * and the internal {@link materialize} method. This ensures that
+     * asynchronous loading is safe.
+     *
+     * @param key       The key to access the asset after loading
+     * @param source    The pathname to the asset
+     * @param callback  An optional callback for asynchronous loading
+     * @param async     Whether the asset was loaded asynchronously
+     *
+     * @return true if the asset was successfully loaded
+     */
+    virtual bool read(const std::string key, const std::string source,
+                      LoaderCallback callback, bool async) override;
+
+    /**
+     * Internal method to support asset loading.
+     *
+     * This method supports either synchronous or asynchronous loading, as
+     * specified by the given parameter. If the loading is asynchronous,
+     * the user may specify an optional callback function.
+     *
+     * This method will split the loading across the {@link AssetBundle#alloc}
+     * and the internal {@link materialize} method. This ensures that
+     * asynchronous loading is safe.
+     *
+     * This version of read provides support for JSON directories. A bundle
+     * directory entry is just a key with a string value for the path to the
+     * asset.
+     *
+     * @param json      The directory entry for the asset
+     * @param callback  An optional callback for asynchronous loading
+     * @param async     Whether the asset was loaded asynchronously
+     *
+     * @return true if the asset was successfully loaded
+     */
+    virtual bool read(const std::shared_ptr<JsonValue>& json,
+                      LoaderCallback callback, bool async) override;
+
+    /**
+     * Unloads the asset for the given key
+     *
+     * The bundle is also unmounted from the asset manager. Assets already
+     * read from the bundle are unaffected.
+     *
+     * @param key   The key associated with the asset
+     *
+     * @return true if the asset was successfully unloaded
+     */
+    bool purgeKey(const std::string key) override;
+
+public:
+#pragma mark -
+#pragma mark Constructors
+    /**
+     * Creates a new, uninitialized bundle loader
+     *
+     * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a loader on
+     * the heap, use one of the static constructors instead.
+     */
+    BundleLoader() { _jsonKey = "bundles"; _priority = 0; _concurrent = true; }
+
+    /**
+     * Disposes all resources and assets of this loader
+     *
+     * Any assets loaded by this object will be immediately released by the
+     * loader, and unmounted from the asset manager. However, a bundle may
+     * still be available if referenced by another smart pointer.
+     *
+     * Once the loader is disposed, any attempts to load a new asset will
+     * fail. You must reinitialize the loader to begin loading assets again.
+     */
+    void dispose() override {
+        unloadAll();
+        _loader = nullptr;
+    }
+
+    /**
+     * Returns a newly allocated bundle loader.
+     *
+     * This method bootstraps the loader with any initial resources that it
+     * needs to load assets.
+     *
+     * This loader will have no associated threads. That means any asynchronous
+     * loading will fail until a thread is provided via {@link setThreadPool}.
+     *
+     * @return a newly allocated bundle loader.
+     */
+    static std::shared_ptr<BundleLoader> alloc() {
+        std::shared_ptr<BundleLoader> result = std::make_shared<BundleLoader>();
+        return (result->init() ? result : nullptr);
+    }
+
+    /**
+     * Returns a newly allocated bundle loader.
+     *
+     * This method bootstraps the loader with any initial resources that it
+     * needs to load assets.
+     *
+     * This loader will have no associated threads. That means any asynchronous
+     * loading will fail until a thread is provided via {@link setThreadPool}.
+     *
+     * @param threads   The thread pool for asynchronous loading
+     *
+     * @return a newly allocated bundle loader.
+     */
+    static std::shared_ptr<BundleLoader> alloc(const std::shared_ptr<ThreadPool>& threads) {
+        std::shared_ptr<BundleLoader> result = std::make_shared<BundleLoader>();
+        return (result->init(threads) ? result : nullptr);
+    }
+
+#pragma mark Asset Loading
+    /**
+     * Unloads all assets present in this loader.
+     *
+     * Every bundle is also unmounted from the asset manager. Assets already
+     * read from the bundles are unaffected.
+     */
+    void unloadAll() override;
+};
+
+}
+
+#endif /* __CU_BUNDLE_LOADER_H__ */
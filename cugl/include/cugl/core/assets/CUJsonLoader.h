@@ -134,7 +134,7 @@ public:
      * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a loader on
      * the heap, use one of the static constructors instead.
      */
-    JsonLoader() { _jsonKey = "jsons"; _priority = 0; }
+    JsonLoader() { _jsonKey = "jsons"; _priority = 0; _concurrent = true; }
     
     /**
      * Disposes all resources and assets of this loader
@@ -19,8 +19,9 @@
 //  loading functionality.
 //
 //  This module implements the first two layers. As they are both a template
-//  and a pure polymorphic class, only a header file is necessary. There is no
-//  associated CPP file with this header.
+//  and a pure polymorphic class, only a header file is necessary. The one
+//  exception is BaseLoader::defer, which needs the full AssetManager and so is
+//  implemented with that class.
 //
 //
 //  CUGL MIT License:
@@ -48,7 +49,9 @@
 #ifndef __CU_LOADER_H__
 #define __CU_LOADER_H__
 #include <string>
+#include <deque>
 #include <functional>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <cugl/core/assets/CUJsonValue.h>
@@ -58,6 +61,8 @@ namespace cugl {
 
 /** Forward reference to the asset manager */
 class AssetManager;
+/** Forward reference to an asset bundle */
+class AssetBundle;
 
 /**
  * @typedef LoaderCallback
@@ -118,6 +123,91 @@ protected:
      */
     AssetManager* _manager;
     
+    /**
+     * Whether this loader may preload several assets at once
+     *
+     * Loaders that are not concurrent (the default) run their tasks one at a
+     * time, even when the thread pool has several threads. This is necessary
+     * for libraries like FreeType that are not thread-safe.
+     */
+    bool _concurrent;
+    /** The tasks waiting for this loader (if it is not concurrent) */
+    std::deque<std::function<void()>> _serial;
+    /** Whether a task of this loader is running (if it is not concurrent) */
+    bool _running;
+    /** The mutex protecting the waiting tasks */
+    std::mutex _serialMutex;
+    
+    /**
+     * Adds a preloading task to the thread pool.
+     *
+     * If this loader is concurrent, the task is added to the thread pool
+     * directly. Otherwise, it waits until the previous tasks of this loader
+     * have finished. Tasks of other loaders may still run at the same time.
+     *
+     * @param task  The task to add
+     */
+    void addTask(std::function<void()> task) {
+        if (_concurrent) {
+            _loader->addTask(std::move(task));
+            return;
+        }
+        
+        {
+            std::unique_lock<std::mutex> lk(_serialMutex);
+            _serial.push_back(std::move(task));
+            if (_running) {
+                return;
+            }
+            _running = true;
+        }
+        _loader->addTask([this] {
+            while (true) {
+                std::function<void()> next;
+                {
+                    std::unique_lock<std::mutex> lk(_serialMutex);
+                    if (_serial.empty()) {
+                        _running = false;
+                        return;
+                    }
+                    next = std::move(_serial.front());
+                    _serial.pop_front();
+                }
+                next();
+            }
+        });
+    }
+    
+    /**
+     * Defers a materialization task to the main thread.
+     *
+     * If this loader is attached to an {@link AssetManager}, the task joins
+     * the materialization queue of the manager, which respects the frame
+     * budget of that manager. Otherwise, the task is scheduled with
+     * {@link Application#schedule}.
+     *
+     * This method is safe to call from any thread.
+     *
+     * @param task  The task to defer
+     */
+    void defer(std::function<void()> task);
+    
+    /**
+     * Returns the mounted bundle with the given asset (or nullptr if none)
+     *
+     * Bundles are mounted on the {@link AssetManager} for this loader, so
+     * this method returns nullptr if the loader is not attached. Loaders
+     * should read the asset from the bundle if there is one, and otherwise
+     * fall back to the file in the asset directory.
+     *
+     * This method is safe to call from any thread.
+     *
+     * @param source    The pathname to the asset
+     *
+     * @return the mounted bundle with the given asset (or nullptr if none)
+     */
+    std::shared_ptr<AssetBundle> findBundle(const std::string source) const;
+    
     /**
      * Internal method to support asset loading.
      *
@@ -226,7 +316,8 @@ public:
      * NEVER CALL THIS CONSTRUCTOR. As this is an abstract class, you should 
      * call one of the static constructors of the appropriate child class.
      */
-    BaseLoader() : _jsonKey(""), _priority(0), _reserved(0) { }
+    BaseLoader() : _jsonKey(""), _priority(0), _reserved(0), _manager(nullptr),
+    _concurrent(false), _running(false) { }
     
     /**
      * Deletes this asset loader, disposing of all resources.
@@ -332,6 +423,17 @@ public:
         _loader = threads;
     }
     
+    /**
+     * Returns true if this loader may preload several assets at once
+     *
+     * A loader that is not concurrent runs its preloading tasks one at a time,
+     * even if its thread pool has several threads. Other loaders may still
+     * use the remaining threads.
+     *
+     * @return true if this loader may preload several assets at once
+     */
+    bool isConcurrent() const { return _concurrent; }
+    
     /**
      * Sets the asset manager for this loader.
      *
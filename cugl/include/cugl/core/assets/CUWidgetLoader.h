@@ -136,7 +136,7 @@ public:
      * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a loader on
      * the heap, use one of the static constructors instead.
      */
-    WidgetLoader() { _jsonKey = "widgets"; _priority = 0; }
+    WidgetLoader() { _jsonKey = "widgets"; _priority = 0; _concurrent = true; }
     
     /**
      * Disposes all resources and assets of this loader
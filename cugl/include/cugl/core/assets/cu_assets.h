@@ -32,7 +32,9 @@
 #include "CUJsonValue.h"
 #include "CUWidgetValue.h"
 #include "CUAssetManager.h"
+#include "CUAssetBundle.h"
 #include "CUJsonLoader.h"
+#include "CUBundleLoader.h"
 #include "CUWidgetLoader.h"
 #include "CUGenericLoader.h"
 
@@ -0,0 +1,273 @@
+//
+//  CUBoundedQueue.h
+//  Cornell University Game Library (CUGL)
+//
+//  This header provides a template for a fixed capacity, lock-free queue. It
+//  is designed for handing work off from the game thread to a background
+//  thread (or vice versa) without ever blocking. Pushing into a full queue
+//  fails immediately instead of waiting for space, which lets the caller
+//  decide what to drop.
+//
+//  The implementation is the classic bounded MPMC queue by Dmitry Vyukov. Each
+//  slot carries a sequence number that tells producers and consumers whether
+//  the slot is ready for them. There are no locks and no allocations after
+//  the queue is initialized.
+//
+//  This is not a class. It is a class template. Templates do not have cpp
+//  files. They only have a header file.  When you include the header, it
+//  compiles the specific template used by your program. Hence all of the code
+//  for this templated class is in this header.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Kidus Zegeye
+//  Version: 1/15/25
+//
+#ifndef __CU_BOUNDED_QUEUE_H__
+#define __CU_BOUNDED_QUEUE_H__
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cugl/core/util/CUDebug.h>
+
+namespace cugl {
+
+#pragma mark -
+#pragma mark BoundedQueue Template
+
+/**
+ * This is a template for a fixed capacity, lock-free queue.
+ *
+ * This queue may be safely used by any number of producer and consumer
+ * threads at once. Neither {@link push} nor {@link pop} ever block. If the
+ * queue is full, {@link push} returns false and leaves the value untouched.
+ * If the queue is empty, {@link pop} returns false.
+ *
+ * The capacity is always rounded up to a power of two, as this allows us to
+ * replace the modulus with a mask. All of the storage is allocated at
+ * initialization. Values are moved into and out of the queue, so the type T
+ * must be default constructible and move assignable.
+ *
+ * The method {@link size} is only a snapshot. Other threads may change the
+ * queue before the caller can act on the result, so it should only be used
+ * for heuristics (such as deciding when to wake up a consumer).
+ */
+template <class T>
+class BoundedQueue {
+private:
+    /** A single slot in the queue */
+    struct Cell {
+        /** The sequence number guarding this slot */
+        std::atomic<size_t> sequence;
+        /** The value stored in this slot */
+        T value;
+    };
+
+    /** The storage for the queue */
+    std::unique_ptr<Cell[]> _cells;
+    /** The capacity minus one (capacity is a power of two) */
+    size_t _mask;
+    /** The next position to write (padded to avoid false sharing) */
+    alignas(64) std::atomic<size_t> _tail;
+    /** The next position to read (padded to avoid false sharing) */
+    alignas(64) std::atomic<size_t> _head;
+
+public:
+#pragma mark Constructors
+    /**
+     * Creates a new queue with no capacity.
+     *
+     * You must initialize this queue before use.
+     *
+     * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a queue on
+     * the heap, use the static constructor instead.
+     */
+    BoundedQueue() : _mask(0), _tail(0), _head(0) {}
+
+    /**
+     * Deletes this queue, releasing all memory.
+     */
+    ~BoundedQueue() { dispose(); }
+
+    /**
+     * Disposes this queue, releasing all memory.
+     *
+     * This method is not thread-safe. No other thread may be using the queue
+     * when it is disposed.
+     */
+    void dispose() {
+        _cells = nullptr;
+        _mask = 0;
+        _tail = 0;
+        _head = 0;
+    }
+
+    /**
+     * Initializes a queue with the given capacity.
+     *
+     * The capacity will be rounded up to the next power of two. It must be
+     * at least 2.
+     *
+     * @param capacity  The minimum number of elements the queue can hold
+     *
+     * @return true if initialization was successful.
+     */
+    bool init(size_t capacity) {
+        CUAssertLog(capacity >= 2, "The queue capacity must be at least 2");
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        _cells.reset(new Cell[size]);
+        for(size_t ii = 0; ii < size; ii++) {
+            _cells[ii].sequence.store(ii, std::memory_order_relaxed);
+        }
+        _mask = size-1;
+        _tail.store(0, std::memory_order_relaxed);
+        _head.store(0, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * Returns a newly allocated queue with the given capacity.
+     *
+     * The capacity will be rounded up to the next power of two. It must be
+     * at least 2.
+     *
+     * @param capacity  The minimum number of elements the queue can hold
+     *
+     * @return a newly allocated queue with the given capacity.
+     */
+    static std::shared_ptr<BoundedQueue<T>> alloc(size_t capacity) {
+        std::shared_ptr<BoundedQueue<T>> result = std::make_shared<BoundedQueue<T>>();
+        return (result->init(capacity) ? result : nullptr);
+    }
+
+#pragma mark Accessors
+    /**
+     * Returns the maximum number of elements in this queue.
+     *
+     * @return the maximum number of elements in this queue.
+     */
+    size_t capacity() const { return _cells ? _mask+1 : 0; }
+
+    /**
+     * Returns the approximate number of elements in this queue.
+     *
+     * This value is only a snapshot, and may be out of date as soon as it is
+     * returned.
+     *
+     * @return the approximate number of elements in this queue.
+     */
+    size_t size() const {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        size_t head = _head.load(std::memory_order_relaxed);
+        return tail > head ? tail-head : 0;
+    }
+
+    /**
+     * Returns true if this queue is (approximately) empty.
+     *
+     * @return true if this queue is (approximately) empty.
+     */
+    bool empty() const { return size() == 0; }
+
+#pragma mark Queue Operations
+    /**
+     * Returns true if the value was added to the back of the queue.
+     *
+     * If the queue is full, this method returns false immediately and the
+     * value is not moved.
+     *
+     * @param value The value to add
+     *
+     * @return true if the value was added to the back of the queue.
+     */
+    bool push(T&& value) {
+        Cell* cell;
+        size_t pos = _tail.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (_tail.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos+1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Returns true if a copy of the value was added to the back of the queue.
+     *
+     * If the queue is full, this method returns false immediately.
+     *
+     * @param value The value to add
+     *
+     * @return true if a copy of the value was added to the back of the queue.
+     */
+    bool push(const T& value) {
+        T copy = value;
+        return push(std::move(copy));
+    }
+
+    /**
+     * Returns true if a value was removed from the front of the queue.
+     *
+     * The value is moved into the given reference. If the queue is empty,
+     * this method returns false immediately and the reference is unchanged.
+     *
+     * @param value The reference to store the result
+     *
+     * @return true if a value was removed from the front of the queue.
+     */
+    bool pop(T& value) {
+        Cell* cell;
+        size_t pos = _head.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos+1);
+            if (diff == 0) {
+                if (_head.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _head.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->value);
+        cell->sequence.store(pos+_mask+1, std::memory_order_release);
+        return true;
+    }
+};
+
+}
+#endif /* __CU_BOUNDED_QUEUE_H__ */
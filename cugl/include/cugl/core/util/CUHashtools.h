@@ -34,6 +34,8 @@
 #include <vector>
 #include <memory>
 #include <cstddef>
+#include <functional>
+#include <SDL.h>
 
 namespace cugl {
     /**
@@ -149,18 +151,182 @@ std::vector<std::byte> b64_decode(const std::string data);
  */
 std::string b64_tostring(const std::string data);
 
+/**
+ * This class is a UUID stored as 16 raw bytes.
+ *
+ * The string form of a UUID is 36 characters, and formatting or parsing it
+ * is far more expensive than copying or comparing two 64 bit integers. This
+ * class allows a UUID to be generated, hashed and compared without ever
+ * creating a string. It should only be formatted when it is needed as text
+ * (such as in a JSON message).
+ *
+ * The UUID is stored big-endian, so {@link high} holds the first 8 bytes and
+ * {@link low} holds the last 8 bytes. Comparing two UUIDs compares their
+ * bytes in order, which sorts Version 7 UUIDs by time.
+ */
+class BinaryUUID {
+public:
+    /** The first 8 bytes of the UUID (big-endian) */
+    Uint64 high;
+    /** The last 8 bytes of the UUID (big-endian) */
+    Uint64 low;
+
+    /** The number of characters in the string form of a UUID */
+    static const size_t STRING_LENGTH = 36;
+
+    /**
+     * Creates the nil UUID (all zeros)
+     */
+    BinaryUUID() : high(0), low(0) {}
+
+    /**
+     * Creates a UUID with the given bytes.
+     *
+     * @param high  The first 8 bytes of the UUID (big-endian)
+     * @param low   The last 8 bytes of the UUID (big-endian)
+     */
+    BinaryUUID(Uint64 high, Uint64 low) : high(high), low(low) {}
+
+    /**
+     * Returns true if this is the nil UUID (all zeros)
+     *
+     * @return true if this is the nil UUID (all zeros)
+     */
+    bool isNil() const { return high == 0 && low == 0; }
+
+    /**
+     * Returns the version of this UUID
+     *
+     * @return the version of this UUID
+     */
+    int getVersion() const { return (int)((high >> 12) & 0xf); }
+
+    /**
+     * Returns true if the string was parsed as a UUID.
+     *
+     * The string must be 32 hexadecimal digits with dashes separating them into
+     * groups of 8-4-4-4-12. If canonical is true, the digits must also be
+     * lowercase, so that {@link toString} gives back exactly the same string.
+     * If the string cannot be parsed, this UUID is unchanged.
+     *
+     * @param str       The string to parse
+     * @param canonical Whether to only accept lowercase digits
+     *
+     * @return true if the string was parsed as a UUID.
+     */
+    bool parse(const std::string& str, bool canonical=false);
+
+    /**
+     * Writes the string form of this UUID to the given buffer.
+     *
+     * The buffer must have room for {@link STRING_LENGTH} characters. No
+     * null terminator is written.
+     *
+     * @param buffer    The buffer to write to
+     */
+    void format(char* buffer) const;
+
+    /**
+     * Returns the string form of this UUID.
+     *
+     * This is 32 lowercase hexadecimal digits with dashes separating them into
+     * groups of 8-4-4-4-12.
+     *
+     * @return the string form of this UUID.
+     */
+    std::string toString() const;
+
+    /**
+     * Writes the 16 bytes of this UUID to the given buffer (in order)
+     *
+     * @param buffer    The buffer to write to
+     */
+    void toBytes(std::byte* buffer) const;
+
+    /**
+     * Sets this UUID to the 16 bytes in the given buffer (in order)
+     *
+     * @param buffer    The buffer to read from
+     */
+    void fromBytes(const std::byte* buffer);
+
+    /**
+     * Returns true if this UUID is equal to the given one.
+     *
+     * @param other The UUID to compare
+     *
+     * @return true if this UUID is equal to the given one.
+     */
+    bool operator==(const BinaryUUID& other) const {
+        return high == other.high && low == other.low;
+    }
+
+    /**
+     * Returns true if this UUID is not equal to the given one.
+     *
+     * @param other The UUID to compare
+     *
+     * @return true if this UUID is not equal to the given one.
+     */
+    bool operator!=(const BinaryUUID& other) const {
+        return high != other.high || low != other.low;
+    }
+
+    /**
+     * Returns true if the bytes of this UUID sort before the given one.
+     *
+     * @param other The UUID to compare
+     *
+     * @return true if the bytes of this UUID sort before the given one.
+     */
+    bool operator<(const BinaryUUID& other) const {
+        return high < other.high || (high == other.high && low < other.low);
+    }
+};
+
 /**
  * Returns a new randomly generated UUID
  *
- * This creates a Version 4 UUID generated by a fresh std::random_device. It
- * will be a 32 character hexadecimal string with dashes separating the
- * characters into groups of 8-4-4-4-12 (as well as supporting Version 4
- * markers).
+ * This creates a Version 4 UUID. It will be a 32 character hexadecimal string
+ * with dashes separating the characters into groups of 8-4-4-4-12 (as well as
+ * supporting Version 4 markers).
+ *
+ * This function is a formatted version of {@link generate_uuid_v4}, and it is
+ * safe to call from any thread.
  *
  * @return a new randomly generated UUID
  */
 std::string generate_uuid();
 
+/**
+ * Returns a new randomly generated Version 4 UUID
+ *
+ * The random bits come from a generator local to the calling thread. The
+ * generator is seeded from std::random_device the first time a thread calls
+ * this function (or {@link generate_uuid_v7}), and never again. So this
+ * function is safe to call from any thread, and does not block on the system
+ * entropy source.
+ *
+ * @return a new randomly generated Version 4 UUID
+ */
+BinaryUUID generate_uuid_v4();
+
+/**
+ * Returns a new time-ordered Version 7 UUID
+ *
+ * A Version 7 UUID starts with the Unix time in milliseconds, followed by
+ * random bits. Hence they sort by creation time, which makes them much
+ * better keys for logs and databases than Version 4 UUIDs. UUIDs generated
+ * by the same thread in the same millisecond use a counter in place of the
+ * first 12 random bits, so they are strictly increasing.
+ *
+ * This function shares its generator with {@link generate_uuid_v4}, and is
+ * safe to call from any thread.
+ *
+ * @return a new time-ordered Version 7 UUID
+ */
+BinaryUUID generate_uuid_v7();
+
 
 /**
  * Returns true if this device has a unique system UUID.
@@ -202,4 +368,20 @@ std::string create_uuid(const std::string seed);
     }
 }
 
+/**
+ * The hash function for a binary UUID.
+ *
+ * This allows a {@link cugl::hashtool::BinaryUUID} to be used as a key in
+ * unordered maps and sets. The bits of a UUID are (mostly) random already,
+ * so the hash just folds the two halves together.
+ */
+namespace std {
+    template <>
+    struct hash<cugl::hashtool::BinaryUUID> {
+        size_t operator()(const cugl::hashtool::BinaryUUID& uuid) const {
+            return (size_t)(uuid.high ^ (uuid.low * 0x9e3779b97f4a7c15ULL));
+        }
+    };
+}
+
 #endif /* __CU_HASHTOOLS_H__ */
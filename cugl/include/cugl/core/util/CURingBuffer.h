@@ -0,0 +1,234 @@
+//
+//  CURingBuffer.h
+//  Cornell University Game Library (CUGL)
+//
+//  This header provides a template for a fixed capacity, lock-free ring buffer
+//  with exactly one producer thread and one consumer thread. It is designed
+//  for handing incoming network messages from the network thread to the game
+//  thread. Unlike BoundedQueue, there are no compare-and-swap loops. Each side
+//  owns one index, and only reads the other index when its cached copy says
+//  the buffer might be full (or empty).
+//
+//  This is not a class. It is a class template. Templates do not have cpp
+//  files. They only have a header file.  When you include the header, it
+//  compiles the specific template used by your program. Hence all of the code
+//  for this templated class is in this header.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Kidus Zegeye
+//  Version: 1/15/25
+//
+#ifndef __CU_RING_BUFFER_H__
+#define __CU_RING_BUFFER_H__
+#include <atomic>
+#include <memory>
+#include <cugl/core/util/CUDebug.h>
+
+namespace cugl {
+
+#pragma mark -
+#pragma mark RingBuffer Template
+
+/**
+ * This is a template for a fixed capacity, single-producer single-consumer ring.
+ *
+ * At any time, only one thread may call {@link push} and only one (other)
+ * thread may call {@link pop}. With that restriction, neither method ever
+ * blocks or allocates. If the ring is full, {@link push} returns false and
+ * leaves the value untouched. If the ring is empty, {@link pop} returns false.
+ *
+ * The capacity is always rounded up to a power of two, as this allows us to
+ * replace the modulus with a mask. All of the storage is allocated at
+ * initialization. Values are moved into and out of the ring, so the type T
+ * must be default constructible and move assignable. Moving means that a
+ * large value (such as a message buffer) is handed over without a copy.
+ *
+ * The method {@link size} is only a snapshot. It is exact when called by the
+ * consumer, in the sense that at least that many values can be popped.
+ */
+template <class T>
+class RingBuffer {
+private:
+    /** The storage for the ring */
+    std::unique_ptr<T[]> _slots;
+    /** The capacity minus one (capacity is a power of two) */
+    size_t _mask;
+    /** The next position to write (written by the producer only) */
+    alignas(64) std::atomic<size_t> _tail;
+    /** The producer copy of the read position */
+    size_t _headCache;
+    /** The next position to read (written by the consumer only) */
+    alignas(64) std::atomic<size_t> _head;
+    /** The consumer copy of the write position */
+    size_t _tailCache;
+
+public:
+#pragma mark Constructors
+    /**
+     * Creates a new ring buffer with no capacity.
+     *
+     * You must initialize this ring buffer before use.
+     *
+     * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a ring buffer
+     * on the heap, use the static constructor instead.
+     */
+    RingBuffer() : _mask(0), _tail(0), _headCache(0), _head(0), _tailCache(0) {}
+
+    /**
+     * Deletes this ring buffer, releasing all memory.
+     */
+    ~RingBuffer() { dispose(); }
+
+    /**
+     * Disposes this ring buffer, releasing all memory.
+     *
+     * This method is not thread-safe. Neither the producer nor the consumer
+     * may be using the ring buffer when it is disposed.
+     */
+    void dispose() {
+        _slots = nullptr;
+        _mask = 0;
+        _tail = 0;
+        _head = 0;
+        _headCache = 0;
+        _tailCache = 0;
+    }
+
+    /**
+     * Initializes a ring buffer with the given capacity.
+     *
+     * The capacity will be rounded up to the next power of two. It must be
+     * at least 2.
+     *
+     * @param capacity  The minimum number of elements the ring can hold
+     *
+     * @return true if initialization was successful.
+     */
+    bool init(size_t capacity) {
+        CUAssertLog(capacity >= 2, "The ring capacity must be at least 2");
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        _slots.reset(new T[size]);
+        _mask = size-1;
+        _tail.store(0, std::memory_order_relaxed);
+        _head.store(0, std::memory_order_relaxed);
+        _headCache = 0;
+        _tailCache = 0;
+        return true;
+    }
+
+    /**
+     * Returns a newly allocated ring buffer with the given capacity.
+     *
+     * The capacity will be rounded up to the next power of two. It must be
+     * at least 2.
+     *
+     * @param capacity  The minimum number of elements the ring can hold
+     *
+     * @return a newly allocated ring buffer with the given capacity.
+     */
+    static std::shared_ptr<RingBuffer<T>> alloc(size_t capacity) {
+        std::shared_ptr<RingBuffer<T>> result = std::make_shared<RingBuffer<T>>();
+        return (result->init(capacity) ? result : nullptr);
+    }
+
+#pragma mark Accessors
+    /**
+     * Returns the maximum number of elements in this ring buffer.
+     *
+     * @return the maximum number of elements in this ring buffer.
+     */
+    size_t capacity() const { return _slots ? _mask+1 : 0; }
+
+    /**
+     * Returns the approximate number of elements in this ring buffer.
+     *
+     * This value is only a snapshot, and may be out of date as soon as it is
+     * returned.
+     *
+     * @return the approximate number of elements in this ring buffer.
+     */
+    size_t size() const {
+        size_t head = _head.load(std::memory_order_acquire);
+        size_t tail = _tail.load(std::memory_order_acquire);
+        return tail > head ? tail-head : 0;
+    }
+
+    /**
+     * Returns true if this ring buffer is (approximately) empty.
+     *
+     * @return true if this ring buffer is (approximately) empty.
+     */
+    bool empty() const { return size() == 0; }
+
+#pragma mark Ring Operations
+    /**
+     * Returns true if the value was added to the back of the ring.
+     *
+     * This method may only be called by the producer thread. If the ring is
+     * full, this method returns false immediately and the value is not moved.
+     *
+     * @param value The value to add
+     *
+     * @return true if the value was added to the back of the ring.
+     */
+    bool push(T&& value) {
+        size_t pos = _tail.load(std::memory_order_relaxed);
+        if (pos-_headCache > _mask) {
+            _headCache = _head.load(std::memory_order_acquire);
+            if (pos-_headCache > _mask) {
+                return false;
+            }
+        }
+        _slots[pos & _mask] = std::move(value);
+        _tail.store(pos+1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Returns true if a value was removed from the front of the ring.
+     *
+     * This method may only be called by the consumer thread. The value is
+     * moved into the given reference. If the ring is empty, this method
+     * returns false immediately and the reference is unchanged.
+     *
+     * @param value The reference to store the result
+     *
+     * @return true if a value was removed from the front of the ring.
+     */
+    bool pop(T& value) {
+        size_t pos = _head.load(std::memory_order_relaxed);
+        if (pos == _tailCache) {
+            _tailCache = _tail.load(std::memory_order_acquire);
+            if (pos == _tailCache) {
+                return false;
+            }
+        }
+        value = std::move(_slots[pos & _mask]);
+        _head.store(pos+1, std::memory_order_release);
+        return true;
+    }
+};
+
+}
+#endif /* __CU_RING_BUFFER_H__ */
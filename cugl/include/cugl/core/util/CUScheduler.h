@@ -0,0 +1,341 @@
+//
+//  CUScheduler.h
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides the scheduler behind Application::schedule. It stores
+//  callbacks that should be executed in a future animation frame, possibly on
+//  a regular basis. Callbacks may be scheduled (or unscheduled) from any
+//  thread, but they are always executed on the thread that updates the
+//  scheduler, which is the main thread for the application.
+//
+//  Callbacks are split between three queues. Immediate callbacks run in the
+//  next frame, periodic callbacks run every frame, and delayed callbacks are
+//  stored in a hierarchical timer wheel. Requests from other threads arrive
+//  in a lock-free inbox, so scheduling a callback never blocks.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Kidus Zegeye
+//  Version: 3/9/25
+//
+#ifndef __CU_SCHEDULER_H__
+#define __CU_SCHEDULER_H__
+#include <SDL.h>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+namespace cugl {
+
+/**
+ * This class stores callbacks to be executed in future animation frames.
+ *
+ * A callback is scheduled with a delay and a period (both in milliseconds).
+ * It is executed in the first frame that ends more than delay milliseconds
+ * after it was scheduled. If the callback returns true, it is executed again
+ * period milliseconds later (or every frame if the period is 0). If it
+ * returns false, it is removed from the scheduler.
+ *
+ * The methods {@link schedule} and {@link unschedule} are thread safe and
+ * never block. Requests are pushed to a lock-free inbox, and the inbox is
+ * drained at the start of each {@link update}. Hence a callback scheduled
+ * during an update is not executed until the next update. All other methods
+ * must be called on the thread that updates the scheduler.
+ *
+ * Callbacks that are due in the same frame are executed in order of their
+ * deadlines. Callbacks with the same deadline are executed in the order they
+ * were scheduled (or rescheduled, for a reoccuring callback).
+ *
+ * Delayed callbacks are stored in a hierarchical timer wheel with a one
+ * millisecond resolution. Scheduling and cancelling a callback are both
+ * constant time, and an update only touches the callbacks that are due (plus
+ * the occasional cascade of a coarser level of the wheel).
+ */
+class Scheduler {
+private:
+    /** The number of slots in the finest level of the wheel */
+    static const Uint32 WHEEL_SLOTS = 256;
+    /** The number of slots in each coarser level of the wheel */
+    static const Uint32 LEVEL_SLOTS = 64;
+    /** The number of coarser levels of the wheel */
+    static const Uint32 LEVEL_COUNT = 4;
+
+    class Entry;
+
+    /**
+     * An intrusive, doubly-linked list of entries.
+     *
+     * Entries are appended at the end, so every list is in FIFO order.
+     */
+    class List {
+    public:
+        /** The first entry in the list */
+        Entry* head;
+        /** The last entry in the list */
+        Entry* tail;
+
+        /** Creates an empty list */
+        List() : head(nullptr), tail(nullptr) {}
+    };
+
+    /**
+     * A single scheduled callback.
+     *
+     * Entries also carry cancellation requests through the inbox. A request
+     * to cancel a callback is an entry with no callback.
+     */
+    class Entry {
+    public:
+        /** The callback function */
+        std::function<bool()> callback;
+        /** The time (in milliseconds) that the callback is next due */
+        Uint64 deadline;
+        /** The callback identifier */
+        Uint32 id;
+        /** The delay before the first call */
+        Uint32 delay;
+        /** The reoccurrence period (0 if called every frame) */
+        Uint32 period;
+        /** The level of the wheel holding this entry (-1 if not in the wheel) */
+        Sint32 level;
+        /** The list holding this entry (nullptr if none) */
+        List* owner;
+        /** The previous entry in the owning list */
+        Entry* prev;
+        /** The next entry in the owning list */
+        Entry* next;
+        /** The next entry in the inbox */
+        Entry* inbox;
+
+        /** Creates an empty entry */
+        Entry() : deadline(0), id(0), delay(0), period(0), level(-1),
+        owner(nullptr), prev(nullptr), next(nullptr), inbox(nullptr) {}
+    };
+
+    /** The inbox of requests from {@link schedule} and {@link unschedule} */
+    std::atomic<Entry*> _inbox;
+    /** The counter to assign unique identifiers to callbacks */
+    std::atomic<Uint32> _funcid;
+
+    /** The current time in milliseconds */
+    Uint64 _tick;
+    /** The scheduled callbacks, as an open addressing table on the identifier */
+    std::vector<Entry*> _table;
+    /** The number of scheduled callbacks */
+    size_t _count;
+    /** The callbacks to execute in the next frame */
+    List _immediate;
+    /** The callbacks to execute every frame */
+    List _periodic;
+    /** The finest level of the wheel (one slot per millisecond) */
+    List _wheel[WHEEL_SLOTS];
+    /** The coarser levels of the wheel */
+    List _levels[LEVEL_COUNT][LEVEL_SLOTS];
+    /** The callbacks too far in the future for the wheel */
+    List _overflow;
+    /** The number of entries in each level of the wheel (plus the overflow) */
+    size_t _sizes[LEVEL_COUNT+2];
+    /** The callbacks that are due in the current frame */
+    std::vector<Entry*> _due;
+
+#pragma mark Internal Helpers
+    /**
+     * Pushes the given entry onto the inbox.
+     *
+     * @param entry The entry to push
+     */
+    void post(Entry* entry);
+
+    /**
+     * Processes every request in the inbox, in the order they were posted.
+     */
+    void drain();
+
+    /**
+     * Appends the given entry to the given list.
+     *
+     * @param list  The list to append to
+     * @param entry The entry to append
+     */
+    static void append(List& list, Entry* entry);
+
+    /**
+     * Removes the given entry from its owning list.
+     *
+     * @param entry The entry to remove
+     */
+    void unlink(Entry* entry);
+
+    /**
+     * Adds the given entry to the wheel according to its deadline.
+     *
+     * The deadline must be in the future.
+     *
+     * @param entry The entry to add
+     */
+    void insert(Entry* entry);
+
+    /**
+     * Moves every entry in the given list back into the wheel.
+     *
+     * This is how entries work their way down to finer levels of the wheel.
+     *
+     * @param list  The list to redistribute
+     * @param level The level of the list
+     */
+    void redistribute(List& list, Sint32 level);
+
+    /**
+     * Cascades the coarser levels of the wheel for the current time.
+     *
+     * This must be called whenever the time lands on a slot boundary of the
+     * finest level.
+     */
+    void cascade();
+
+    /**
+     * Advances the wheel to the given time.
+     *
+     * Every entry in the wheel that is due before that time is removed from
+     * the wheel and appended to {@link #_due}, in order of deadline.
+     *
+     * @param time  The time to advance to
+     */
+    void advance(Uint64 time);
+
+    /**
+     * Executes the given entry, and reschedules it if it returns true.
+     *
+     * The entry should not be in any list. If it is called every frame, it is
+     * appended to the given list instead of being rescheduled right away.
+     *
+     * @param entry     The entry to execute
+     * @param periodic  The list for callbacks called every frame
+     */
+    void execute(Entry* entry, List& periodic);
+
+    /**
+     * Records the identifier of the given entry.
+     *
+     * @param entry The entry to record
+     */
+    void track(Entry* entry);
+
+    /**
+     * Returns the scheduled entry for the given identifier.
+     *
+     * @param id    The callback identifier
+     *
+     * @return the scheduled entry for the given identifier (nullptr if none).
+     */
+    Entry* lookup(Uint32 id) const;
+
+    /**
+     * Forgets the given identifier.
+     *
+     * @param id    The callback identifier
+     */
+    void forget(Uint32 id);
+
+    /**
+     * Deletes the given entry and forgets its identifier.
+     *
+     * @param entry The entry to delete
+     */
+    void release(Entry* entry);
+
+public:
+#pragma mark Constructors
+    /**
+     * Creates an empty scheduler.
+     */
+    Scheduler();
+
+    /**
+     * Deletes this scheduler, disposing all resources.
+     */
+    ~Scheduler() { clear(); }
+
+    /**
+     * Removes every callback from this scheduler.
+     *
+     * This includes any requests still in the inbox. It must not be called
+     * while another thread may schedule a callback.
+     */
+    void clear();
+
+#pragma mark Scheduling
+    /**
+     * Schedules a reoccuring callback function time milliseconds in the future.
+     *
+     * If time is 0, the callback will be called in the next update. Otherwise,
+     * it will be called in the first update that ends more than time
+     * milliseconds in the future. If the callback returns true, it will be
+     * called again period milliseconds later (or every update if period is 0).
+     * The callback is removed once it returns false.
+     *
+     * This method is thread safe and does not block.
+     *
+     * @param callback  The callback function
+     * @param time      The number of milliseconds to delay the callback
+     * @param period    The delay until the callback is executed again
+     *
+     * @return a unique identifier for the schedule callback
+     */
+    Uint32 schedule(std::function<bool()> callback, Uint32 time, Uint32 period);
+
+    /**
+     * Stops a callback function from being executed.
+     *
+     * The callback is removed at the start of the next update, so it will not
+     * be called again unless it is currently executing. Unknown identifiers
+     * (such as those of callbacks that are already removed) are ignored.
+     *
+     * This method is thread safe and does not block.
+     *
+     * @param id    The callback identifier
+     */
+    void unschedule(Uint32 id);
+
+    /**
+     * Executes every callback that is due.
+     *
+     * This method first processes every {@link schedule} and {@link unschedule}
+     * request since the last update. It then advances the time by the given
+     * number of milliseconds, and executes every callback that was due before
+     * the new time. If no time passed, no callbacks are executed.
+     *
+     * @param millis    The number of milliseconds since last called
+     */
+    void update(Uint32 millis);
+
+    /**
+     * Returns the number of scheduled callbacks.
+     *
+     * This does not include requests that are still in the inbox.
+     *
+     * @return the number of scheduled callbacks.
+     */
+    size_t size() const { return _count; }
+};
+
+}
+
+#endif /* __CU_SCHEDULER_H__ */
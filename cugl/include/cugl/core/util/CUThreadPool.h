@@ -6,6 +6,11 @@
 //  task is specified by a void function.  There are no guarantees about thread
 //  safety; that is responsibility of the author of each task.
 //
+//  The pool is a work-stealing scheduler. Each worker has its own task deque,
+//  and tasks added from outside the pool go to a shared injection queue. Idle
+//  workers steal from the other deques. Tasks can also return a future, and
+//  can be grouped together so that one thread can wait on all of them.
+//
 //  This code is largely inspired from the Cocos2d file AudioEngine.cpp, from
 //  the code for asynchronous asset loading. We generalized that class added
 //  some notable safety changes.
@@ -38,7 +43,15 @@
 #include <condition_variable>
 #include <functional>
 #include <stdio.h>
-#include <queue>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
 #include <vector>
 #include <thread>
 
@@ -55,9 +68,23 @@ namespace cugl {
 /**
  *  Class to providing a collection of worker threads.
  *
- *  This is a general purpose class for performing tasks asynchronously.  There 
- *  is no notification process for when a task is complete.  Instead, your task 
- *  should either set a flag, or execute a callback when it is done.
+ *  This is a general purpose class for performing tasks asynchronously. A task
+ *  added with {@link #addTask} has no notification process for when it is
+ *  complete. Instead, your task should either set a flag, or execute a
+ *  callback when it is done. Alternatively, {@link #submit} returns a future
+ *  for the result of the task, and a {@link TaskGroup} can wait on several
+ *  tasks at once.
+ *
+ *  The pool is a work-stealing scheduler. Every worker has its own deque of
+ *  tasks. A task added by a worker (such as a task that splits itself into
+ *  smaller tasks) goes to the back of that worker's deque, and the worker
+ *  takes its own tasks from the back. Tasks added by any other thread go to
+ *  a shared injection queue. A worker with nothing to do takes from the
+ *  injection queue, and then steals from the front of the other deques. This
+ *  keeps all of the workers busy without contending on a single queue.
+ *
+ *  Tasks are stored with a small buffer (see {@link Task}), so adding a task
+ *  does not allocate as long as its captures are small.
  *
  *  There are some important safety considerations for using this class over
  *  direct thread objects. For example, stopping a thread pool does not shut it 
@@ -73,35 +100,225 @@ namespace cugl {
  *  pool.
  */
 class ThreadPool {
+public:
+    /**
+     * This class is a move-only task function with a small buffer.
+     *
+     * A std::function must be copyable, so it cannot hold move-only values
+     * such as a std::packaged_task. It may also allocate on the heap when it
+     * is created or copied. This class stores any callable of at most
+     * {@link BUFFER_SIZE} bytes in place, and only allocates for larger ones.
+     * Moving a task never copies the callable. Note that the task queues are
+     * still std::deque objects, which allocate storage in blocks as they grow.
+     */
+    class Task {
+    public:
+        /** The size of the inline buffer */
+        static const size_t BUFFER_SIZE = 48;
+
+    private:
+        /** The operations for a stored callable type */
+        struct Operations {
+            /** Calls the callable */
+            void (*invoke)(void* callable);
+            /** Moves the callable to the given buffer, returning its new address */
+            void* (*move)(void* callable, void* buffer);
+            /** Destroys the callable */
+            void (*destroy)(void* callable);
+        };
+
+        /**
+         * The operations for a callable stored in the inline buffer
+         */
+        template <typename T>
+        struct Inline {
+            static void invoke(void* callable) { (*static_cast<T*>(callable))(); }
+            static void* move(void* callable, void* buffer) {
+                T* result = new (buffer) T(std::move(*static_cast<T*>(callable)));
+                static_cast<T*>(callable)->~T();
+                return result;
+            }
+            static void destroy(void* callable) { static_cast<T*>(callable)->~T(); }
+            static constexpr Operations ops = { invoke, move, destroy };
+        };
+
+        /**
+         * The operations for a callable stored on the heap
+         */
+        template <typename T>
+        struct Heap {
+            static void invoke(void* callable) { (*static_cast<T*>(callable))(); }
+            static void* move(void* callable, void*) { return callable; }
+            static void destroy(void* callable) { delete static_cast<T*>(callable); }
+            static constexpr Operations ops = { invoke, move, destroy };
+        };
+
+        /** The inline storage for small callables */
+        alignas(std::max_align_t) unsigned char _buffer[BUFFER_SIZE];
+        /** The stored callable (in the buffer or on the heap) */
+        void* _callable;
+        /** The operations for the stored callable (nullptr if empty) */
+        const Operations* _ops;
+
+    public:
+        /**
+         * Creates an empty task
+         */
+        Task() : _callable(nullptr), _ops(nullptr) {}
+
+        /**
+         * Creates a task for the given callable.
+         *
+         * The callable is moved (or copied) into the task. It is stored in
+         * place if it fits in the buffer, and on the heap otherwise.
+         *
+         * @param func  The callable to store
+         */
+        template <typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, Task>::value>>
+        Task(F&& func) {
+            typedef std::decay_t<F> T;
+            if constexpr (sizeof(T) <= BUFFER_SIZE && alignof(T) <= alignof(std::max_align_t) &&
+                          std::is_nothrow_move_constructible<T>::value) {
+                _callable = new (_buffer) T(std::forward<F>(func));
+                _ops = &Inline<T>::ops;
+            } else {
+                _callable = new T(std::forward<F>(func));
+                _ops = &Heap<T>::ops;
+            }
+        }
+
+        /**
+         * Creates a task with the callable of the given one.
+         *
+         * The original task is empty afterwards.
+         *
+         * @param task  The task to acquire
+         */
+        Task(Task&& task) noexcept : _callable(nullptr), _ops(task._ops) {
+            if (_ops) {
+                _callable = _ops->move(task._callable, _buffer);
+                task._ops = nullptr;
+                task._callable = nullptr;
+            }
+        }
+
+        /**
+         * Deletes this task, destroying its callable
+         */
+        ~Task() { reset(); }
+
+        /**
+         * Acquires the callable of the given task.
+         *
+         * The original task is empty afterwards.
+         *
+         * @param task  The task to acquire
+         *
+         * @return a reference to this task
+         */
+        Task& operator=(Task&& task) noexcept {
+            if (this != &task) {
+                reset();
+                _ops = task._ops;
+                if (_ops) {
+                    _callable = _ops->move(task._callable, _buffer);
+                    task._ops = nullptr;
+                    task._callable = nullptr;
+                }
+            }
+            return *this;
+        }
+
+        /**
+         * Destroys the callable, making this task empty
+         */
+        void reset() {
+            if (_ops) {
+                _ops->destroy(_callable);
+                _ops = nullptr;
+                _callable = nullptr;
+            }
+        }
+
+        /**
+         * Returns true if this task has a callable
+         *
+         * @return true if this task has a callable
+         */
+        explicit operator bool() const { return _ops != nullptr; }
+
+        /**
+         * Calls the stored callable
+         */
+        void operator()() { _ops->invoke(_callable); }
+
+        /** Tasks cannot be copied */
+        Task(const Task&) = delete;
+        /** Tasks cannot be copied */
+        Task& operator=(const Task&) = delete;
+    };
+
 private:
+    /**
+     * This class is the state of a single worker thread.
+     */
+    class Worker {
+    public:
+        /** The pool owning this worker */
+        ThreadPool* pool;
+        /** The index of this worker in the pool */
+        size_t index;
+        /** The tasks of this worker (the worker uses the back, thieves the front) */
+        std::deque<Task> tasks;
+        /** A mutex lock for the task deque */
+        std::mutex mutex;
+
+        /**
+         * Creates the state for a worker of the given pool
+         *
+         * @param pool  The pool owning this worker
+         * @param index The index of this worker in the pool
+         */
+        Worker(ThreadPool* pool, size_t index) : pool(pool), index(index) {}
+    };
+
     /** The individual worker threads for this thread pool */
 #ifdef CU_SDL_THREADS
     std::vector<SDL_Thread*> _workers;
 #else
     std::vector<std::thread> _workers;
 #endif
+    /** The state of each worker thread */
+    std::vector<std::unique_ptr<Worker>> _states;
     
-    /** Tasks waiting to be assigned to a thread */
-    std::queue< std::function<void()> > _taskQueue;
+    /** Tasks added from outside the pool, waiting to be assigned to a thread */
+    std::deque<Task> _taskQueue;
     
     /** A mutex lock for the task queue */
     std::mutex _queueMutex;
+    /** A mutex lock for idle workers */
+    std::mutex _sleepMutex;
     /** A condition variable to manage tasks waiting for a worker */
     std::condition_variable _taskCondition;
+    /** The number of tasks waiting in any queue */
+    std::atomic<size_t> _pending;
+    /** The number of workers waiting for a task */
+    std::atomic<size_t> _sleeping;
     
     /** Whether or not the thread pool has been marked for shutdown */
-    bool _stop;
+    std::atomic<bool> _stop;
     /** The number of child threads that are completed */
-    int _complete;
+    std::atomic<size_t> _complete;
     
     /**
      * The body function of a single thread.
      *
-     * This function pulls tasks from the task queue.  
+     * This function pulls tasks from the worker deque, the task queue, and
+     * the deques of the other workers (in that order).
      *
-     * This implementation is safe to use with std::thread.
+     * @param worker    The state of this worker
      */
-    void threadFunc();
+    void threadFunc(Worker* worker);
 
     /**
      * The body function of a single thread.
@@ -113,6 +330,29 @@ private:
      */
     static int sdlThreadFunc(void* ptr);
     
+    /**
+     * Adds a task to the thread pool.
+     *
+     * If the calling thread is a worker of this pool, the task goes to the
+     * back of its deque. Otherwise, it goes to the task queue.
+     *
+     * @param task  the task to add
+     */
+    void push(Task&& task);
+    
+    /**
+     * Returns true if a task was removed for the given worker.
+     *
+     * The worker takes from the back of its own deque first, then from the
+     * task queue, and finally steals from the front of the other deques. If
+     * the worker is nullptr, only the last two are tried.
+     *
+     * @param worker    The worker taking the task (or nullptr)
+     * @param task      The task to store the result
+     *
+     * @return true if a task was removed for the given worker.
+     */
+    bool acquire(Worker* worker, Task& task);
 
 #pragma mark Constructors
 public:
@@ -124,7 +364,7 @@ public:
      * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a thread pool 
      * on the heap, use one of the static constructors instead.
      */
-    ThreadPool() :_stop(false), _complete(0) { }
+    ThreadPool() : _pending(0), _sleeping(0), _stop(false), _complete(0) { }
     
     /**
      * Deletes this thread pool, destroying all resources.
@@ -187,16 +427,86 @@ public:
      * will not be executed immediately, but must wait for the first available 
      * worker.
      *
+     * The task is moved (or copied) into the pool. Small tasks are stored
+     * without allocating any memory.
+     *
+     * @param  task     the task function to add to the thread pool
+     */
+    template <typename F>
+    void addTask(F&& task) {
+        push(Task(std::forward<F>(task)));
+    }
+    
+    /**
+     * Adds a task to the thread pool, returning a future for its result.
+     *
+     * A task is a function with no parameters, but it may return a value.
+     * The future can be used to wait on the task, and to get its result (or
+     * any exception that it threw).
+     *
+     * Be careful when waiting on a future from inside another task. The
+     * waiting worker is blocked, and cannot run other tasks in the meantime.
+     * Use a {@link TaskGroup} instead if this is a problem.
+     *
      * @param  task     the task function to add to the thread pool
+     *
+     * @return a future for the result of the task
+     */
+    template <typename F>
+    auto submit(F&& task) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        typedef std::invoke_result_t<std::decay_t<F>> R;
+        std::packaged_task<R()> packaged(std::forward<F>(task));
+        std::future<R> result = packaged.get_future();
+        push(Task(std::move(packaged)));
+        return result;
+    }
+    
+    /**
+     * Runs the given function on every index in the range [begin,end).
+     *
+     * The range is split into chunks of (at least) the given grain size, and
+     * each chunk is a separate task. The calling thread runs the first chunk,
+     * and then helps with the others until they are all done. So it is safe
+     * to call this method from inside another task. If the grain is 0, the
+     * range is split into about 4 chunks per worker.
+     *
+     * The function is called as body(index), and must be safe to call from
+     * several threads at once.
+     *
+     * @param begin The first index of the range
+     * @param end   The index after the last index of the range
+     * @param body  The function to call for each index
+     * @param grain The minimum number of indices in a chunk
+     */
+    template <typename F>
+    void parallelFor(size_t begin, size_t end, const F& body, size_t grain = 0);
+    
+    /**
+     * Returns true if a waiting task was run by the calling thread.
+     *
+     * This method allows a thread waiting on other tasks to help with them,
+     * instead of blocking. If the calling thread is a worker of this pool, it
+     * looks at its own deque first. It then looks at the task queue, and
+     * finally steals from the workers.
+     *
+     * @return true if a waiting task was run by the calling thread.
+     */
+    bool runPending();
+    
+    /**
+     * Returns the number of worker threads in this pool.
+     *
+     * @return the number of worker threads in this pool.
      */
-    void addTask(const std::function<void()> &task);
+    size_t getThreadCount() const { return _states.size(); }
     
     /**
      * Stops the thread pool, marking it for shut down.
      *
      * A stopped thread pool is marked for shutdown, but it shutdown has not 
      * necessarily completed.  Shutdown will be complete when the current child 
-     * threads have finished with their tasks.
+     * threads have finished with their tasks. It is safe to call this method
+     * more than once.
      */
     void stop();
     
@@ -236,6 +546,162 @@ private:
     CU_DISALLOW_COPY_AND_ASSIGN(ThreadPool);
 };
 
+#pragma mark -
+#pragma mark Task Group
+/**
+ * Class to wait on a collection of tasks.
+ *
+ * A task group adds tasks to a thread pool, and keeps count of the ones that
+ * have not finished. The method {@link #wait} blocks until they have all
+ * finished. While it waits, the calling thread runs waiting tasks from the
+ * pool. Hence a task may safely create a group, add subtasks to it, and then
+ * wait on them (fan-out/fan-in), even on a pool with a single worker.
+ *
+ * A task group is meant to be used on the stack, and it waits on its tasks
+ * when it is deleted. The thread pool must outlive the group.
+ */
+class TaskGroup {
+private:
+    /** The thread pool running the tasks */
+    ThreadPool* _pool;
+    /** The number of tasks that have not finished */
+    std::atomic<size_t> _count;
+    /** A mutex lock for the condition variable */
+    std::mutex _mutex;
+    /** A condition variable to signal that all tasks finished */
+    std::condition_variable _done;
+    /** The first exception thrown by a task (nullptr if none) */
+    std::exception_ptr _error;
+
+    /**
+     * Marks one task of this group as finished.
+     *
+     * The count is decremented under the mutex, so that a waiting thread
+     * cannot see it reach 0 (and delete the group) while this method is
+     * still using the group.
+     *
+     * @param error The exception thrown by the task (nullptr if none)
+     */
+    void finish(std::exception_ptr error);
+
+    /**
+     * Blocks until every task in this group has finished.
+     *
+     * Unlike {@link #wait}, this method does not rethrow task exceptions.
+     */
+    void join();
+
+public:
+    /**
+     * Creates an empty task group for the given thread pool.
+     *
+     * @param pool  The thread pool to run the tasks
+     */
+    TaskGroup(ThreadPool& pool) : _pool(&pool), _count(0) {}
+
+    /**
+     * Deletes this task group, waiting on any unfinished tasks.
+     *
+     * Any exception thrown by a task that was not rethrown by {@link #wait}
+     * is discarded.
+     */
+    ~TaskGroup() { join(); }
+
+    /**
+     * Adds a task to this group.
+     *
+     * The task is added to the thread pool immediately. If the task throws
+     * an exception, it is caught and rethrown by {@link #wait}.
+     *
+     * @param task  The task function to add
+     */
+    template <typename F>
+    void run(F&& task) {
+        _count++;
+        _pool->addTask([this, func = std::forward<F>(task)]() mutable {
+            std::exception_ptr error;
+            try {
+                func();
+            } catch (...) {
+                error = std::current_exception();
+            }
+            finish(error);
+        });
+    }
+
+    /**
+     * Blocks until every task in this group has finished.
+     *
+     * The calling thread runs waiting tasks from the pool (which may or may not
+     * belong to this group) while it waits. If any task threw an exception,
+     * this method rethrows the first one once every task has finished.
+     */
+    void wait();
+
+    /**
+     * Returns the number of tasks in this group that have not finished.
+     *
+     * @return the number of tasks in this group that have not finished.
+     */
+    size_t getPending() const { return _count; }
+
+    /** Task groups cannot be copied */
+    TaskGroup(const TaskGroup&) = delete;
+    /** Task groups cannot be copied */
+    TaskGroup& operator=(const TaskGroup&) = delete;
+};
+
+#pragma mark -
+#pragma mark Template Methods
+/**
+ * Runs the given function on every index in the range [begin,end).
+ *
+ * The range is split into chunks of (at least) the given grain size, and
+ * each chunk is a separate task. The calling thread runs the first chunk,
+ * and then helps with the others until they are all done. So it is safe
+ * to call this method from inside another task. If the grain is 0, the
+ * range is split into about 4 chunks per worker.
+ *
+ * The function is called as body(index), and must be safe to call from
+ * several threads at once.
+ *
+ * @param begin The first index of the range
+ * @param end   The index after the last index of the range
+ * @param body  The function to call for each index
+ * @param grain The minimum number of indices in a chunk
+ */
+template <typename F>
+void ThreadPool::parallelFor(size_t begin, size_t end, const F& body, size_t grain) {
+    if (end <= begin) {
+        return;
+    }
+    size_t total = end-begin;
+    if (grain == 0) {
+        size_t chunks = 4*(_states.empty() ? 1 : _states.size());
+        grain = (total+chunks-1)/chunks;
+    }
+    if (grain >= total || _states.empty()) {
+        for(size_t ii = begin; ii < end; ii++) {
+            body(ii);
+        }
+        return;
+    }
+
+    TaskGroup group(*this);
+    for(size_t start = begin+grain; start < end; start += grain) {
+        size_t stop = (end-start > grain) ? start+grain : end;
+        group.run([&body, start, stop]() {
+            for(size_t ii = start; ii < stop; ii++) {
+                body(ii);
+            }
+        });
+    }
+    for(size_t ii = begin; ii < begin+grain; ii++) {
+        body(ii);
+    }
+    group.wait();
+}
+
 }
 
 #endif /* __CU_THREAD_POOL_H__ */
@@ -35,9 +35,12 @@
 #include "CUStringTools.h"
 #include "CUTimestamp.h"
 #include "CUFreeList.h"
+#include "CUBoundedQueue.h"
+#include "CURingBuffer.h"
 #include "CUGreedyFreeList.h"
 #include "CULogger.h"
 #include "CUThreadPool.h"
+#include "CUScheduler.h"
 #include "CUHashtools.h"
 #include "CURandom.h"
 
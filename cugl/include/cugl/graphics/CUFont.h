@@ -61,6 +61,9 @@
 
 namespace cugl {
 
+/** Forward reference to an asset bundle */
+class AssetBundle;
+
     /**
      * The classes and functions needed to construct a graphics pipeline.
      *
@@ -520,6 +523,46 @@ public:
         return (result->init(file,size) ? result : nullptr);
     }
     
+    /**
+     * Initializes a font of the given size from a file in the asset bundle.
+     *
+     * The font size is fixed on initialization.  It cannot be changed without
+     * disposing of the entire font.  However, all other attributes may be
+     * changed.
+     *
+     * The font reads the file directly from the bundle. It does not need the
+     * bundle to remain loaded.
+     *
+     * @param bundle    The asset bundle with the font file
+     * @param file      The path of the font file in the bundle
+     * @param size      The font size in points
+     *
+     * @return true if initialization is successful.
+     */
+    bool init(const std::shared_ptr<AssetBundle>& bundle, const std::string file, Uint32 size);
+    
+    /**
+     * Returns a newly allocated font of the given size from a file in the asset bundle.
+     *
+     * The font size is fixed on creation.  It cannot be changed without
+     * creating a new font asset.  However, all other attributes may be
+     * changed.
+     *
+     * The font reads the file directly from the bundle. It does not need the
+     * bundle to remain loaded.
+     *
+     * @param bundle    The asset bundle with the font file
+     * @param file      The path of the font file in the bundle
+     * @param size      The font size in points
+     *
+     * @return a newly allocated font of the given size from a file in the asset bundle.
+     */
+    static std::shared_ptr<Font> alloc(const std::shared_ptr<AssetBundle>& bundle,
+                                       const std::string file, Uint32 size) {
+        std::shared_ptr<Font> result = std::make_shared<Font>();
+        return (result->init(bundle,file,size) ? result : nullptr);
+    }
+    
 #pragma mark -
 #pragma mark Attributes
     /**
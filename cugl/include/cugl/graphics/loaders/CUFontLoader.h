@@ -99,6 +99,9 @@ protected:
      * Hence this method does the maximum amount of work that can be done in
      * asynchronous font loading.
      *
+     * If the asset is in a mounted {@link AssetBundle}, it is read from the
+     * bundle instead of the asset directory.
+     *
      * @param source    The pathname to the asset
      * @param charset   The atlas character set
      * @param size      The font size
@@ -128,6 +131,9 @@ protected:
      *      "underline":    Whether to underline the font
      *      "strike":    	Whether to strikethrough the font
      *
+     * If the asset is in a mounted {@link AssetBundle}, it is read from the
+     * bundle instead of the asset directory.
+     *
      * @param json      The directory entry for the asset
      *
      * @return the font asset with no generated atlas
@@ -123,6 +123,9 @@ protected:
      * we need to create an OpenGL texture.  Hence this method does the maximum
      * amount of work that can be done in asynchronous texture loading.
      *
+     * If the asset is in a mounted {@link AssetBundle}, it is read from the
+     * bundle instead of the asset directory.
+     *
      * @param source    The pathname to the asset
      *
      * @return the SDL_Surface with the texture information
@@ -0,0 +1,446 @@
+//
+//  CUAnalyticsAggregator.h
+//  Cornell University Game Library (CUGL)
+//
+//  This class provides client-side sampling and aggregation for high
+//  frequency analytics actions. Games register an action "kind" with a rule,
+//  and the aggregator decides which events reach the analytics connection.
+//  Sampled events carry a weight so that totals can be estimated, while
+//  numeric events can be rolled up into a single counter or histogram action
+//  per interval. Every message is an ordinary action, so the server schema
+//  does not change.
+//
+//  This class uses our standard shared-pointer architecture.
+//
+//  1. The constructor does not perform any initialization; it just sets all
+//     attributes to their defaults.
+//
+//  2. All initialization takes place via init methods, which can fail if an
+//     object is initialized more than once.
+//
+//  3. All allocation takes place via static constructors which return a shared
+//     pointer.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Kidus Zegeye
+//  Version: 1/15/25
+//
+#ifndef __CU_ANALYTICS_AGGREGATOR_H__
+#define __CU_ANALYTICS_AGGREGATOR_H__
+#include <cugl/core/CUBase.h>
+#include <cugl/netcode/CUAnalyticsConnection.h>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cugl {
+    namespace netcode {
+        namespace analytics {
+
+/**
+ * This class samples and aggregates high frequency actions.
+ *
+ * Calling {@link AnalyticsConnection#recordAction} for every input event is
+ * expensive, as every call encodes a message and (without batching) sends a
+ * websocket frame. This class sits in front of the connection. Each kind of
+ * action is registered with a {@link Rule}, and the events of that kind are
+ * either sampled or rolled up before they reach the connection.
+ *
+ * There are four rules.
+ *
+ *  - {@link Mode#EVERY_NTH} forwards the first of every N events immediately.
+ *  - {@link Mode#RESERVOIR} keeps a uniform random sample of at most K events
+ *    per interval, and forwards them when the interval ends.
+ *  - {@link Mode#COUNTER} rolls up numeric values into a count, sum, minimum
+ *    and maximum, sent once per interval.
+ *  - {@link Mode#HISTOGRAM} is a counter that also counts the values in each
+ *    bucket of a fixed histogram.
+ *
+ * A sampled event is sent as the action
+ *
+ *      {"kind": <name>, "weight": <events represented>, "data": <event data>}
+ *
+ * where the weight is the number of events that the sample stands for. The
+ * sum of the weights is an unbiased estimate of the number of events (and
+ * weighting any statistic by it gives an unbiased estimate of its total).
+ * A rollup is sent as the action
+ *
+ *      {"kind": <name>, "rollup": "counter" | "histogram", "interval": <ms>,
+ *       "count": <n>, "sum": <sum>, "min": <min>, "max": <max>,
+ *       "bounds": [<b0>, ...], "counts": [<c0>, ...]}
+ *
+ * where the bounds and counts are only present for histograms.
+ *
+ * To avoid building event data that is never sent, check {@link willSample}
+ * first, and pass nullptr as the data if it returns false. The event is still
+ * counted.
+ *
+ * This class is not thread-safe. It should only be used on the main thread,
+ * which is where the interval timer runs.
+ */
+class AnalyticsAggregator : public std::enable_shared_from_this<AnalyticsAggregator> {
+public:
+    /**
+     * The aggregation mode of an action kind.
+     */
+    enum class Mode {
+        /** Forward the first of every N events, with weight N */
+        EVERY_NTH,
+        /** Keep a uniform sample of at most K events per interval */
+        RESERVOIR,
+        /** Roll up numeric values into a count, sum, min and max */
+        COUNTER,
+        /** Roll up numeric values into a counter and a histogram */
+        HISTOGRAM
+    };
+
+    /**
+     * The aggregation rule for an action kind.
+     *
+     * Rules should be created with the static constructors.
+     */
+    class Rule {
+    public:
+        /** The aggregation mode */
+        Mode mode;
+        /** The sampling rate N (EVERY_NTH) or reservoir size K (RESERVOIR) */
+        Uint32 size;
+        /** The upper bounds of the histogram buckets, in increasing order (HISTOGRAM) */
+        std::vector<double> bounds;
+
+        /**
+         * Creates a rule that forwards every event.
+         */
+        Rule() : mode(Mode::EVERY_NTH), size(1) {}
+
+        /**
+         * Returns a rule that forwards the first of every n events.
+         *
+         * @param n The sampling rate
+         *
+         * @return a rule that forwards the first of every n events.
+         */
+        static Rule everyNth(Uint32 n) {
+            Rule result;
+            result.mode = Mode::EVERY_NTH;
+            result.size = n > 0 ? n : 1;
+            return result;
+        }
+
+        /**
+         * Returns a rule that keeps a uniform sample of events per interval.
+         *
+         * @param size  The maximum number of events kept per interval
+         *
+         * @return a rule that keeps a uniform sample of events per interval.
+         */
+        static Rule reservoir(Uint32 size) {
+            Rule result;
+            result.mode = Mode::RESERVOIR;
+            result.size = size > 0 ? size : 1;
+            return result;
+        }
+
+        /**
+         * Returns a rule that rolls up values into a counter.
+         *
+         * @return a rule that rolls up values into a counter.
+         */
+        static Rule counter() {
+            Rule result;
+            result.mode = Mode::COUNTER;
+            return result;
+        }
+
+        /**
+         * Returns a rule that rolls up values into a histogram.
+         *
+         * A value v is counted in the first bucket i with v <= bounds[i]. There
+         * is one more bucket than there are bounds, for values above the last
+         * bound.
+         *
+         * @param bounds    The upper bounds of the buckets, in increasing order
+         *
+         * @return a rule that rolls up values into a histogram.
+         */
+        static Rule histogram(const std::vector<double>& bounds) {
+            Rule result;
+            result.mode = Mode::HISTOGRAM;
+            result.bounds = bounds;
+            return result;
+        }
+    };
+
+    /** The kind identifier returned when a kind cannot be registered */
+    static const Uint32 INVALID_KIND = (Uint32)-1;
+
+private:
+    /**
+     * A sampled event waiting for the end of the interval.
+     */
+    class Sample {
+    public:
+        /** A copy of the event data */
+        std::shared_ptr<JsonValue> data;
+        /** The related task attempts */
+        std::vector<std::shared_ptr<TaskAttempt>> attempts;
+    };
+
+    /**
+     * The state of a single action kind.
+     */
+    class Kind {
+    public:
+        /** The name of this kind */
+        std::string name;
+        /** The aggregation rule */
+        Rule rule;
+        /** The number of events seen (this interval for RESERVOIR) */
+        Uint64 seen;
+        /** The reservoir slot for the next event (-1 to drop, -2 if not drawn) */
+        Sint64 slot;
+        /** The reservoir of sampled events */
+        std::vector<Sample> samples;
+        /** The number of values rolled up this interval */
+        Uint64 count;
+        /** The sum of the values rolled up this interval */
+        double sum;
+        /** The minimum value rolled up this interval */
+        double min;
+        /** The maximum value rolled up this interval */
+        double max;
+        /** The number of values in each histogram bucket */
+        std::vector<Uint64> counts;
+    };
+
+    /** The connection receiving the actions */
+    std::shared_ptr<AnalyticsConnection> _connection;
+    /** The registered kinds, indexed by identifier */
+    std::vector<Kind> _kinds;
+    /** The identifier of each kind, indexed by name */
+    std::unordered_map<std::string, Uint32> _names;
+    /** The flush interval in milliseconds (0 if flushes are manual) */
+    Uint32 _interval;
+    /** The key of the interval timer */
+    Uint32 _timerKey;
+    /** Whether the interval timer is active */
+    bool _timerActive;
+    /** The start of the current interval */
+    std::chrono::steady_clock::time_point _start;
+    /** The random number generator for reservoir sampling */
+    std::minstd_rand _random;
+    /** The number of events recorded */
+    Uint64 _recorded;
+    /** The number of actions sent to the connection */
+    Uint64 _forwarded;
+
+#pragma mark Internal Helpers
+    /**
+     * Returns the reservoir slot for the next event of the given kind.
+     *
+     * The slot is drawn once per event, so that {@link willSample} and
+     * {@link record} agree. A slot of -1 means the event is dropped.
+     *
+     * @param kind  The reservoir kind
+     *
+     * @return the reservoir slot for the next event of the given kind.
+     */
+    Sint64 drawSlot(Kind& kind);
+
+    /**
+     * Sends a sampled event to the connection.
+     *
+     * @param kind      The action kind
+     * @param weight    The number of events the sample represents
+     * @param data      The event data (which is not modified)
+     * @param attempts  The related task attempts
+     *
+     * @return true if the action was accepted by the connection
+     */
+    bool forward(const Kind& kind, double weight, const std::shared_ptr<JsonValue>& data,
+                 const std::vector<std::shared_ptr<TaskAttempt>>& attempts);
+
+    /**
+     * Sends the rollup of the given kind, and resets it.
+     *
+     * @param kind      The counter or histogram kind
+     * @param interval  The length of the interval in milliseconds
+     */
+    void rollup(Kind& kind, Uint64 interval);
+
+public:
+#pragma mark Constructors
+    /**
+     * Creates a new, uninitialized aggregator.
+     *
+     * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate an object on
+     * the heap, use one of the static constructors instead.
+     */
+    AnalyticsAggregator();
+
+    /**
+     * Deletes this aggregator, disposing all resources
+     */
+    ~AnalyticsAggregator() { dispose(); }
+
+    /**
+     * Disposes all of the resources used by this aggregator.
+     *
+     * Any pending samples and rollups are flushed to the connection first.
+     */
+    void dispose();
+
+    /**
+     * Initializes an aggregator for the given connection.
+     *
+     * If the interval is positive, the aggregator flushes reservoirs and
+     * rollups every interval milliseconds on the main thread. Otherwise,
+     * the application must call {@link flush} itself.
+     *
+     * @param connection    The analytics connection
+     * @param interval      The flush interval in milliseconds
+     *
+     * @return true if initialization was successful
+     */
+    bool init(const std::shared_ptr<AnalyticsConnection>& connection, Uint32 interval);
+
+    /**
+     * Returns a newly allocated aggregator for the given connection.
+     *
+     * If the interval is positive, the aggregator flushes reservoirs and
+     * rollups every interval milliseconds on the main thread. Otherwise,
+     * the application must call {@link flush} itself.
+     *
+     * @param connection    The analytics connection
+     * @param interval      The flush interval in milliseconds
+     *
+     * @return a newly allocated aggregator for the given connection.
+     */
+    static std::shared_ptr<AnalyticsAggregator> alloc(const std::shared_ptr<AnalyticsConnection>& connection,
+                                                      Uint32 interval=5000) {
+        std::shared_ptr<AnalyticsAggregator> result = std::make_shared<AnalyticsAggregator>();
+        return (result->init(connection,interval) ? result : nullptr);
+    }
+
+#pragma mark Kinds
+    /**
+     * Registers an action kind with the given rule.
+     *
+     * The identifier returned should be used to record events, as it avoids
+     * looking up the name on every event. This method returns
+     * {@link INVALID_KIND} if the name is already registered.
+     *
+     * @param name  The name of the kind
+     * @param rule  The aggregation rule
+     *
+     * @return the identifier of the new kind
+     */
+    Uint32 addKind(const std::string& name, const Rule& rule);
+
+    /**
+     * Returns the identifier of the given kind.
+     *
+     * This method returns {@link INVALID_KIND} if the name is not registered.
+     *
+     * @param name  The name of the kind
+     *
+     * @return the identifier of the given kind.
+     */
+    Uint32 getKind(const std::string& name) const;
+
+    /**
+     * Returns true if the next event of the given kind will be sent.
+     *
+     * This is always false for rollups. For sampled kinds, the application
+     * can use this to skip building the event data, passing nullptr to
+     * {@link record} instead.
+     *
+     * @param kind  The kind identifier
+     *
+     * @return true if the next event of the given kind will be sent.
+     */
+    bool willSample(Uint32 kind);
+
+#pragma mark Recording
+    /**
+     * Records an event of a sampled kind.
+     *
+     * The event is always counted, but only sampled events are sent. The
+     * data is copied if the event is kept for a reservoir, so the caller is
+     * free to reuse it. The data may be nullptr if {@link willSample} was
+     * false.
+     *
+     * @param kind      The kind identifier
+     * @param data      The event data
+     * @param attempts  The related task attempts
+     *
+     * @return true if the event was recorded
+     */
+    bool record(Uint32 kind, const std::shared_ptr<JsonValue>& data,
+                const std::vector<std::shared_ptr<TaskAttempt>>& attempts = std::vector<std::shared_ptr<TaskAttempt>>());
+
+    /**
+     * Records a value of a counter or histogram kind.
+     *
+     * This method does not allocate any memory.
+     *
+     * @param kind  The kind identifier
+     * @param value The value to roll up
+     *
+     * @return true if the value was recorded
+     */
+    bool record(Uint32 kind, double value);
+
+    /**
+     * Sends all pending reservoirs and rollups to the connection.
+     *
+     * This starts a new interval. It is called automatically if the
+     * aggregator has a flush interval.
+     */
+    void flush();
+
+#pragma mark Statistics
+    /**
+     * Returns the number of events recorded.
+     *
+     * @return the number of events recorded.
+     */
+    Uint64 getRecordedCount() const { return _recorded; }
+
+    /**
+     * Returns the number of actions sent to the connection.
+     *
+     * Comparing this to {@link getRecordedCount} gives the reduction in
+     * messages.
+     *
+     * @return the number of actions sent to the connection.
+     */
+    Uint64 getForwardedCount() const { return _forwarded; }
+};
+
+        }
+    }
+}
+
+#endif /* __CU_ANALYTICS_AGGREGATOR_H__ */
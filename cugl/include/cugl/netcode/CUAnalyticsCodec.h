@@ -0,0 +1,353 @@
+//
+//  CUAnalyticsCodec.h
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides the compact binary wire format for analytics messages.
+//  Binary messages are written with NetcodeSerializer. Repeated strings (such
+//  as task names, status values and task attempt UUIDs) are interned into a
+//  per-session dictionary, so that each message only carries a small integer
+//  reference. UUIDs are stored as 16 raw bytes instead of 36 characters.
+//
+//  The binary format is optional. It is only used once the server has agreed
+//  to it in response to the init message. The codec can translate any binary
+//  message back into JSON, which is how messages are delivered to servers
+//  that only accept JSON (and how they are stored in the offline spool).
+//
+//  This class uses our standard shared-pointer architecture.
+//
+//  1. The constructor does not perform any initialization; it just sets all
+//     attributes to their defaults.
+//
+//  2. All initialization takes place via init methods, which can fail if an
+//     object is initialized more than once.
+//
+//  3. All allocation takes place via static constructors which return a shared
+//     pointer.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Kidus Zegeye
+//  Version: 1/15/25
+//
+#ifndef __CU_ANALYTICS_CODEC_H__
+#define __CU_ANALYTICS_CODEC_H__
+#include <cugl/core/CUBase.h>
+#include <cugl/netcode/CUNetcodeSerializer.h>
+#include <cugl/netcode/CUJsonSerializer.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cugl {
+    namespace netcode {
+        namespace analytics {
+
+/**
+ * This class encodes and decodes the binary analytics wire format.
+ *
+ * Every binary message is a sequence of {@link NetcodeSerializer} values. The
+ * first value is a Uint32 {@link Code} identifying the message. Strings that
+ * are likely to repeat are written as a "slot", which is one of
+ *
+ *  - a Uint32 reference into the session dictionary
+ *  - a string literal (only when the dictionary is full)
+ *  - two Uint64 values holding the 16 bytes of a UUID literal
+ *
+ * The dictionary is never sent inline with a message. Instead, before a binary
+ * frame is sent, the client calls {@link writeDictionary} to produce a
+ * `DICTIONARY` message containing every entry the server has not seen yet on
+ * this connection. This means that a message may be encoded long before it is
+ * sent (or sent on a later connection) and still be decoded correctly.
+ *
+ * The dictionary only ever grows (up to a fixed limit), so any message encoded
+ * by this codec can be translated back into JSON with {@link transcode}.
+ *
+ * Encoding methods should only be called by a single thread, but all of the
+ * methods are safe to call while another thread is decoding or writing the
+ * dictionary.
+ */
+class AnalyticsCodec {
+public:
+    /**
+     * The message codes of the binary wire format.
+     *
+     * These values are part of the protocol, and must match the server.
+     */
+    enum class Code : Uint32 {
+        /** A task message */
+        TASK = 1,
+        /** A task_attempt message */
+        TASK_ATTEMPT = 2,
+        /** A sync_task_attempt message */
+        SYNC_TASK_ATTEMPT = 3,
+        /** An action message */
+        ACTION = 4,
+        /** A batch of binary messages */
+        BATCH = 5,
+        /** New entries for the session dictionary */
+        DICTIONARY = 6,
+        /** A JSON message carried inside a binary batch */
+        JSON = 7,
+        /** A versioned sync_task_attempt message (full statistics or a patch) */
+        SYNC_TASK_PATCH = 8
+    };
+
+private:
+    /** The dictionary ids, indexed by string */
+    std::unordered_map<std::string, Uint32> _ids;
+    /** The dictionary entries, indexed by id */
+    std::vector<std::string> _strings;
+    /** Whether each dictionary entry is a UUID */
+    std::vector<bool> _uuids;
+    /** The maximum number of dictionary entries */
+    size_t _limit;
+    /** A mutex to protect the dictionary */
+    mutable std::mutex _mutex;
+
+#pragma mark Constructors
+public:
+    /**
+     * Creates a degenerate codec.
+     *
+     * This object has not been initialized and cannot be used.
+     *
+     * You should NEVER USE THIS CONSTRUCTOR. All codecs should be created by
+     * the static constructor {@link alloc} instead.
+     */
+    AnalyticsCodec() : _limit(0) {}
+
+    /**
+     * Deletes this codec, disposing all resources
+     */
+    ~AnalyticsCodec() { dispose(); }
+
+    /**
+     * Disposes all of the resources used by this codec.
+     *
+     * This clears the dictionary. Any message encoded before the dictionary
+     * was cleared can no longer be sent or decoded.
+     */
+    void dispose();
+
+    /**
+     * Initializes a codec with an empty dictionary.
+     *
+     * Once the dictionary reaches the given limit, new strings are written
+     * as literals instead of being interned.
+     *
+     * @param limit The maximum number of dictionary entries
+     *
+     * @return true if initialization was successful
+     */
+    bool init(size_t limit);
+
+    /**
+     * Returns a newly allocated codec with an empty dictionary.
+     *
+     * Once the dictionary reaches the given limit, new strings are written
+     * as literals instead of being interned.
+     *
+     * @param limit The maximum number of dictionary entries
+     *
+     * @return a newly allocated codec with an empty dictionary.
+     */
+    static std::shared_ptr<AnalyticsCodec> alloc(size_t limit=65536) {
+        std::shared_ptr<AnalyticsCodec> result = std::make_shared<AnalyticsCodec>();
+        return (result->init(limit) ? result : nullptr);
+    }
+
+#pragma mark Accessors
+    /**
+     * Returns the number of entries in the dictionary.
+     *
+     * @return the number of entries in the dictionary.
+     */
+    size_t size() const;
+
+    /**
+     * Returns true if the given bytes are a binary message.
+     *
+     * JSON messages always start with an open brace, while binary messages
+     * always start with the type tag of their message code.
+     *
+     * @param data  The message bytes
+     * @param size  The number of bytes
+     *
+     * @return true if the given bytes are a binary message.
+     */
+    static bool isBinary(const std::byte* data, size_t size) {
+        return size > 0 && static_cast<Uint8>(data[0]) == NetcodeType::UInt32Type;
+    }
+
+    /**
+     * Returns true if the given bytes are a binary message.
+     *
+     * JSON messages always start with an open brace, while binary messages
+     * always start with the type tag of their message code.
+     *
+     * @param message   The message bytes
+     *
+     * @return true if the given bytes are a binary message.
+     */
+    static bool isBinary(const std::vector<std::byte>& message) {
+        return isBinary(message.data(), message.size());
+    }
+
+#pragma mark Encoding
+    /**
+     * Writes the code that starts a binary message.
+     *
+     * @param out   The serializer for the message
+     * @param code  The message code
+     */
+    static void writeCode(NetcodeSerializer& out, Code code) {
+        out.writeUint32(static_cast<Uint32>(code));
+    }
+
+    /**
+     * Writes a string slot, interning the string if possible.
+     *
+     * @param out   The serializer for the message
+     * @param s     The string to write
+     */
+    void writeString(NetcodeSerializer& out, const std::string& s) {
+        writeSlot(out, s, false);
+    }
+
+    /**
+     * Writes a UUID slot, interning the UUID if possible.
+     *
+     * A UUID is stored in the dictionary as 16 raw bytes. If the string is not
+     * a lowercase, hyphenated UUID, it is treated as an ordinary string.
+     *
+     * @param out   The serializer for the message
+     * @param uuid  The UUID to write
+     */
+    void writeUUID(NetcodeSerializer& out, const std::string& uuid) {
+        writeSlot(out, uuid, true);
+    }
+
+    /**
+     * Writes a DICTIONARY message with the entries from the given id onwards.
+     *
+     * This method returns the new number of entries known to the receiver.
+     * If there are no entries at or after first, nothing is written.
+     *
+     * @param out   The serializer for the message
+     * @param first The first dictionary id to write
+     *
+     * @return the new number of entries known to the receiver
+     */
+    size_t writeDictionary(NetcodeSerializer& out, size_t first) const;
+
+    /**
+     * Writes a BATCH frame containing the given messages.
+     *
+     * Binary messages are copied into the frame as is. JSON messages are
+     * wrapped in a `JSON` message.
+     *
+     * @param messages  The messages to batch
+     * @param frame     The vector to store the frame
+     */
+    void writeBatch(const std::vector<std::string>& messages, std::vector<std::byte>& frame) const;
+
+#pragma mark Decoding
+    /**
+     * Writes the JSON form of the given binary message.
+     *
+     * A BATCH message becomes a JSON batch message. The JSON value is written
+     * to the given serializer (which may be in the middle of another value).
+     * This method returns false if the message is corrupt.
+     *
+     * @param message   The binary message
+     * @param out       The serializer for the JSON value
+     *
+     * @return true if the message was successfully transcoded.
+     */
+    bool transcode(const std::vector<std::byte>& message, JsonSerializer& out) const;
+
+    /**
+     * Returns true if the given DICTIONARY message was added to the dictionary.
+     *
+     * This is the receiving half of {@link writeDictionary}, used by servers
+     * that decode binary messages. Entries are stored at the ids given in the
+     * message, so that later messages can be transcoded with {@link transcode}.
+     * This method returns false if the message is not a valid DICTIONARY
+     * message, or if it would exceed the dictionary limit.
+     *
+     * @param message   The binary message
+     *
+     * @return true if the given DICTIONARY message was added to the dictionary.
+     */
+    bool readDictionary(const std::vector<std::byte>& message);
+
+private:
+#pragma mark Internal Helpers
+    /**
+     * Writes a slot for the given string, interning it if possible.
+     *
+     * @param out   The serializer for the message
+     * @param s     The string to write
+     * @param uuid  Whether the string should be stored as a UUID
+     */
+    void writeSlot(NetcodeSerializer& out, const std::string& s, bool uuid);
+
+    /**
+     * Writes the given string as a literal.
+     *
+     * @param out   The serializer for the message
+     * @param s     The string to write
+     * @param uuid  Whether the string should be stored as a UUID
+     */
+    static void writeLiteral(NetcodeSerializer& out, const std::string& s, bool uuid);
+
+    /**
+     * Returns true if the next slot was read into the given string.
+     *
+     * The mutex must be held when this method is called.
+     *
+     * @param in        The deserializer for the message
+     * @param result    The string to store the slot value
+     *
+     * @return true if the next slot was read into the given string.
+     */
+    bool readSlot(NetcodeDeserializer& in, std::string& result) const;
+
+    /**
+     * Returns true if the next message was transcoded to JSON.
+     *
+     * The mutex must be held when this method is called.
+     *
+     * @param in        The deserializer for the message
+     * @param out       The serializer for the JSON value
+     * @param nested    Whether this message is inside of a batch
+     *
+     * @return true if the next message was transcoded to JSON.
+     */
+    bool transcodeMessage(NetcodeDeserializer& in, JsonSerializer& out, bool nested) const;
+};
+
+        }
+    }
+}
+
+#endif /* __CU_ANALYTICS_CODEC_H__ */
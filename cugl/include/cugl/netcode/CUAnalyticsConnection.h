@@ -52,9 +52,22 @@
 #include <string>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <random>
 #include <cugl/netcode/CUWebSocket.h>
+#include <cugl/netcode/CUJsonSerializer.h>
+#include <cugl/netcode/CUAnalyticsSpool.h>
+#include <cugl/netcode/CUAnalyticsCodec.h>
+#include <cugl/netcode/CUNetcodeSerializer.h>
 #include <cugl/core/util/CUHashtools.h>
+#include <cugl/core/util/CUBoundedQueue.h>
+#include <cugl/core/util/CUThreadPool.h>
 #include <cugl/netcode/CUWebSocketConfig.h>
 
 namespace cugl
@@ -151,6 +164,15 @@ namespace cugl
     * on the status of a task, the number of failures, start/completion time, and 
     * miscellaneous data. TaskAttempts are defined in the analytics server's database by using
     * {@link addTaskAttempt}, and then updated via {@link syncTaskAttempt}.
+    *
+    * A TaskAttempt remembers the statistics last sent to the server. If the
+    * server supports it, a sync only sends the top-level statistics that have
+    * changed since then, as a JSON merge patch (RFC 7396). Statistics changed
+    * with {@link setStatistic} or {@link removeStatistic} are tracked by key,
+    * so nothing else has to be compared. Statistics changed in place through
+    * {@link getTaskStatistics} are found by comparing every statistic against
+    * the last synced copy. Because a merge patch uses null to remove a key,
+    * a statistic with a null value is removed on the server.
     */
     class TaskAttempt
     {
@@ -189,6 +211,21 @@ namespace cugl
         int _numFailures;
         /** The current status of a TaskAttempt */
         Status _status;
+        /** A copy of the statistics last sent to the server */
+        std::shared_ptr<JsonValue> _syncedStatistics;
+        /** The top-level statistics changed by the setters since the last sync */
+        std::unordered_set<std::string> _dirtyKeys;
+        /** Whether the statistics may have been modified in place since the last sync */
+        mutable bool _untracked;
+        /** The statistics version last sent to the server */
+        Uint32 _version;
+        /** The version of the last sync with the full statistics */
+        Uint32 _fullVersion;
+        /** Whether the next sync must send the full statistics */
+        bool _resync;
+
+        /** The connection needs the sync state of each attempt */
+        friend class AnalyticsConnection;
 
     public:
         /**
@@ -204,7 +241,12 @@ namespace cugl
                         _uuid(""),
                         _taskStatistics(nullptr),
                         _numFailures(0),
-                        _status(Status::NOT_STARTED) {}
+                        _status(Status::NOT_STARTED),
+                        _syncedStatistics(nullptr),
+                        _untracked(false),
+                        _version(0),
+                        _fullVersion(0),
+                        _resync(false) {}
     
         /**
         * Deletes this TaskAttempt, disposing all resources
@@ -221,6 +263,12 @@ namespace cugl
             _taskStatistics = nullptr;
             _numFailures = 0;
             _status = Status::NOT_STARTED;
+            _syncedStatistics = nullptr;
+            _dirtyKeys.clear();
+            _untracked = false;
+            _version = 0;
+            _fullVersion = 0;
+            _resync = false;
         };
 
         /**
@@ -241,6 +289,39 @@ namespace cugl
             _status = status;
             return true;
         };
+
+        /**
+        * Marks the current statistics as synchronized with the server.
+        *
+        * This copies the statistics, so that the next sync can send only the
+        * statistics that changed.
+        */
+        void markSynced();
+
+        /**
+        * Returns a merge patch from the last synced statistics to the current ones.
+        *
+        * The patch contains the changed keys of the dirty statistics (or of
+        * every statistic, if they may have been modified in place). Nested
+        * objects are patched recursively. The synced copy is updated to match,
+        * so the patch is only ever returned once.
+        *
+        * @return a merge patch from the last synced statistics to the current ones.
+        */
+        std::shared_ptr<JsonValue> diffStatistics();
+
+        /**
+        * Returns true if the statistics can be sent as a merge patch.
+        *
+        * This is only possible if both the current and the synced statistics
+        * are JSON objects.
+        *
+        * @return true if the statistics can be sent as a merge patch.
+        */
+        bool canPatch() const {
+            return !_resync && _taskStatistics != nullptr && _taskStatistics->isObject() &&
+                    _syncedStatistics != nullptr && _syncedStatistics->isObject();
+        }
         
     public:
         /**
@@ -326,9 +407,16 @@ namespace cugl
         /**
         * Returns the task statistics of this TaskAttempt
         *
+        * The statistics may be modified in place. However, this means that the
+        * next sync must compare every statistic with the last synced copy to
+        * find the changes. Use {@link setStatistic} to avoid this comparison.
+        *
         * @return the task statistics of this TaskAttempt
         */
-        std::shared_ptr<JsonValue> getTaskStatistics() const { return _taskStatistics; }
+        std::shared_ptr<JsonValue> getTaskStatistics() const {
+            _untracked = true;
+            return _taskStatistics;
+        }
 
 
         /**
@@ -336,7 +424,104 @@ namespace cugl
         *
         * @param taskStatistics the new task statistics of this TaskAttempt
         */
-        void setTaskStatistics(std::shared_ptr<JsonValue> taskStatistics) { _taskStatistics = taskStatistics; }
+        void setTaskStatistics(std::shared_ptr<JsonValue> taskStatistics) {
+            _taskStatistics = taskStatistics;
+            _untracked = true;
+        }
+
+        /**
+        * Returns a top-level statistic of this TaskAttempt
+        *
+        * Unlike {@link getTaskStatistics}, this does not force the next sync
+        * to compare every statistic. If you modify the value in place, call
+        * {@link markDirty} so that the change is sent.
+        *
+        * @param key    The statistic name
+        *
+        * @return a top-level statistic of this TaskAttempt (or nullptr if absent)
+        */
+        const std::shared_ptr<JsonValue> getStatistic(const std::string key) const {
+            return _taskStatistics == nullptr ? nullptr : _taskStatistics->get(key);
+        }
+
+        /**
+        * Sets a top-level statistic of this TaskAttempt
+        *
+        * Only the statistics changed since the last sync are sent to the server.
+        *
+        * @param key    The statistic name
+        * @param value  The statistic value
+        */
+        void setStatistic(const std::string key, long value);
+
+        /**
+        * Sets a top-level statistic of this TaskAttempt
+        *
+        * Only the statistics changed since the last sync are sent to the server.
+        *
+        * @param key    The statistic name
+        * @param value  The statistic value
+        */
+        void setStatistic(const std::string key, double value);
+
+        /**
+        * Sets a top-level statistic of this TaskAttempt
+        *
+        * Only the statistics changed since the last sync are sent to the server.
+        *
+        * @param key    The statistic name
+        * @param value  The statistic value
+        */
+        void setStatistic(const std::string key, bool value);
+
+        /**
+        * Sets a top-level statistic of this TaskAttempt
+        *
+        * Only the statistics changed since the last sync are sent to the server.
+        *
+        * @param key    The statistic name
+        * @param value  The statistic value
+        */
+        void setStatistic(const std::string key, const std::string value);
+
+        /**
+        * Sets a top-level statistic of this TaskAttempt
+        *
+        * The value must not have a parent, as it is added to the statistics.
+        * Only the statistics changed since the last sync are sent to the server.
+        *
+        * @param key    The statistic name
+        * @param value  The statistic value
+        */
+        void setStatistic(const std::string key, const std::shared_ptr<JsonValue>& value);
+
+        /**
+        * Removes a top-level statistic of this TaskAttempt
+        *
+        * @param key    The statistic name
+        */
+        void removeStatistic(const std::string key);
+
+        /**
+        * Marks a top-level statistic as changed since the last sync.
+        *
+        * Call this after modifying a statistic in place, if you did not get it
+        * from {@link getTaskStatistics}.
+        *
+        * @param key    The statistic name
+        */
+        void markDirty(const std::string key) { _dirtyKeys.insert(key); }
+
+        /**
+        * Returns the statistics version last sent to the server.
+        *
+        * The version is incremented by every sync. The server rejects a patch
+        * whose version does not follow the one it has, and the connection then
+        * resends the full statistics.
+        *
+        * @return the statistics version last sent to the server.
+        */
+        Uint32 getVersion() const { return _version; }
     };
 
 /**
@@ -357,8 +542,56 @@ namespace cugl
 * create uninitialized connections). You are forced to go through the static
 * allocator {@link alloc} to create instances of this class.
 */
-class AnalyticsConnection
+class AnalyticsConnection : public std::enable_shared_from_this<AnalyticsConnection>
+{
+public:
+/**
+ * An enum representing the lifecycle of the connection to the analytics server.
+ *
+ * The connection never blocks the calling thread. Instead, it moves between
+ * these states in response to {@link WebSocket} state changes and timers on
+ * the main thread. Use {@link onStatusChange} to be notified of each change.
+ */
+enum class Status
+{
+    /** The connection is not open, and will not reconnect on its own */
+    DISCONNECTED,
+    /** The websocket handshake is in progress */
+    CONNECTING,
+    /** The websocket is open and messages are being delivered */
+    CONNECTED,
+    /** The last attempt failed, and the connection is waiting to retry */
+    BACKOFF
+};
+
+/**
+ * @typedef StatusCallback
+ *
+ * This type represents a callback for connection status changes.
+ *
+ * This callback is always invoked on the main thread, at the start of an
+ * animation frame. The function type is equivalent to
+ *
+ *      std::function<void(Status status)>
+ *
+ * @param status    The new connection status
+ */
+typedef std::function<void(Status status)> StatusCallback;
+
+/**
+ * An enum representing what to do when the asynchronous send queue is full.
+ *
+ * The queue is only used when batching is active (see {@link startBatching}).
+ * Neither policy ever blocks the calling thread.
+ */
+enum class DropPolicy
 {
+    /** Reject the new event, keeping everything already queued */
+    DROP_NEWEST,
+    /** Evict the oldest queued event to make room for the new one */
+    DROP_OLDEST
+};
+
 private:
 /** The websocket connection used to communicate with an external analytics server */
 std::shared_ptr<WebSocket> _webSocket;
@@ -374,10 +607,100 @@ std::string _version_number;
 std::string _vendor_id;
 /** The hardware platform of the player's device */
 std::string _platform;       
-/** Indicates if the initialization data has been sent to the server already. */
-bool _init_data_sent;   
+/** Indicates if the initialization data has been sent on the current connection. */
+std::atomic<bool> _init_data_sent;
 /** The tasks added to the analytics connection. Indexed by task name. */
 std::unordered_map<std::string, std::shared_ptr<Task>> _tasks;
+/** The task attempts added to the analytics connection. Indexed by UUID. */
+std::unordered_map<std::string, std::weak_ptr<TaskAttempt>> _attempts;
+/** The number of task attempts at which to remove expired attempts */
+size_t _attemptLimit;
+/** The reusable encoder for outgoing messages (calling thread only) */
+JsonSerializer _encoder;
+
+// Connection lifecycle
+/** The current status of the connection */
+std::atomic<Status> _status;
+/** The listener for status changes (main thread only) */
+StatusCallback _onStatus;
+/** A counter to invalidate timers and events from earlier connection attempts */
+std::atomic<Uint32> _generation;
+/** The application callback key of the pending timeout or reconnect */
+Uint32 _timerKey;
+/** Whether a timeout or reconnect is currently scheduled */
+bool _timerActive;
+/** Whether to reconnect automatically when the connection fails */
+bool _reconnect;
+/** The time (in milliseconds) to wait for the websocket handshake */
+Uint32 _connectTimeout;
+/** The delay (in milliseconds) before the first reconnect attempt */
+Uint32 _backoffMin;
+/** The maximum delay (in milliseconds) between reconnect attempts */
+Uint32 _backoffMax;
+/** The number of consecutive failed connection attempts */
+Uint32 _failures;
+/** The random generator for the reconnect jitter */
+std::minstd_rand _random;
+/** The messages recorded while disconnected (when spooling is disabled) */
+std::deque<std::vector<std::byte>> _backlog;
+/** The number of messages in the backlog (readable from any thread) */
+std::atomic<size_t> _backlogSize;
+/** A mutex to protect the backlog */
+mutable std::mutex _backlogMutex;
+
+// Binary wire format
+/** The codec for the binary wire format (nullptr if binary was not requested) */
+std::shared_ptr<AnalyticsCodec> _codec;
+/** The reusable encoder for outgoing binary messages (calling thread only) */
+NetcodeSerializer _binaryEncoder;
+/** Whether the server accepted the binary wire format on this connection */
+std::atomic<bool> _binaryReady;
+/** The number of dictionary entries the server has received on this connection */
+std::atomic<size_t> _dictionarySent;
+
+// Delta synchronization
+/** Whether the server accepted statistics patches on this connection */
+std::atomic<bool> _deltaReady;
+
+// Asynchronous batching
+/** The queue of encoded messages waiting for the flusher thread */
+std::shared_ptr<BoundedQueue<std::string>> _queue;
+/** The messages removed from the queue but not yet sent (flusher thread only) */
+std::vector<std::string> _outgoing;
+/** The number of messages in _outgoing (readable from any thread) */
+std::atomic<size_t> _held;
+/** The reusable encoder for batch frames (flusher thread only) */
+JsonSerializer _batchEncoder;
+/** The reusable encoder for transcoded messages (flusher thread only) */
+JsonSerializer _scratchEncoder;
+/** The reusable buffer for batch frames (flusher thread only) */
+std::vector<std::byte> _frame;
+/** The (single) background thread that coalesces and sends queued messages */
+std::shared_ptr<ThreadPool> _flusher;
+/** Whether the flusher thread is currently active */
+std::atomic<bool> _batching;
+/** The maximum number of messages coalesced into a single frame */
+size_t _batchSize;
+/** The maximum time (in milliseconds) a message may wait before a flush */
+Uint32 _batchInterval;
+/** The policy for handling a full queue */
+DropPolicy _dropPolicy;
+/** The number of messages dropped because the queue was full */
+std::atomic<Uint64> _dropped;
+/** The mutex for waking up the flusher thread */
+std::mutex _flushMutex;
+/** The condition variable for waking up the flusher thread */
+std::condition_variable _flushCond;
+
+// Offline spooling
+/** The durable spool for messages that could not be sent (nullptr if disabled) */
+std::shared_ptr<AnalyticsSpool> _spool;
+/** The maximum number of spooled messages to replay per second */
+Uint32 _replayRate;
+/** Whether a replay of the spool is scheduled */
+std::atomic<bool> _replaying;
+/** The application callback key of the scheduled replay */
+std::atomic<Uint32> _replayKey;
 
 #pragma mark Constructors
 public:
@@ -399,23 +722,29 @@ AnalyticsConnection();
 private:
 /**
  * Initializes the AnalyticsConnection with the given websocket configuration along
- * with the game MetaData. Opens the connection in order to send intialization data to the
- * analytics server.
+ * with the game MetaData. Starts opening the connection in order to send intialization
+ * data to the analytics server.
+ *
+ * This method does not wait for the connection to open. The initialization
+ * data is sent as soon as the websocket opens, and any messages recorded in
+ * the meantime are delivered after it.
  *
  * @param config The WebSocket configuration.
  * @param organization_name The name of the organization.
  * @param game_name The name of the game.
  * @param version_number The version number of the game.
  * @param debug  Whether to log debug messages from the connection
+ * @param binary Whether to offer the binary wire format to the server
  * @return true if initialization was successful, false otherwise.
  */
-bool init(const WebSocketConfig &config, const std::string &organization_name, const std::string &game_name, const std::string &version_number, const bool &debug);
+bool init(const WebSocketConfig &config, const std::string &organization_name, const std::string &game_name, const std::string &version_number, const bool &debug, bool binary);
 
 
 /**
  * Disposes of the AnalyticsConnection resources.
  *
  * Closes the WebSocket and resets member variables to their default values.
+ * This method does not wait for the WebSocket to finish closing.
  */
 void dispose();
 
@@ -423,28 +752,235 @@ void dispose();
 public:
 
 /**
- * Opens the WebSocket connection.
+ * Starts opening the WebSocket connection.
+ *
+ * This method does not block. It starts the websocket handshake (unless it
+ * is already in progress) and returns immediately. If the handshake does not
+ * complete within the connect timeout, or the connection later fails, the
+ * connection retries with exponential backoff (see {@link setBackoff}).
+ * Use {@link getStatus} or {@link onStatusChange} to learn when the
+ * connection is open.
+ *
+ * Messages recorded before the connection opens are not lost. They are
+ * spooled (if spooling is enabled) or held in memory, and are sent after the
+ * initialization data once the connection opens.
  *
- * @return true if the connection was successfully opened.
+ * This method must be called on the main thread.
+ *
+ * @return true if a connection attempt is in progress.
  */
 bool open();
 
 /**
- * Closes the WebSocket connection.
+ * Starts closing the WebSocket connection.
+ *
+ * This method does not block. It cancels any pending reconnect, and the
+ * connection will not reopen until {@link open} is called again.
  *
- * @return true if the connection was successfully closed.
+ * This method must be called on the main thread.
+ *
+ * @return true if the connection is closing (or was already closed).
  */
 bool close();
 
 private:
+/**
+ * Starts a new connection attempt and arms the connect timeout.
+ */
+void connect();
+
+/**
+ * Handles a failed connection attempt or a lost connection.
+ *
+ * If automatic reconnects are enabled, this schedules the next attempt after
+ * an exponential backoff delay. Otherwise the connection is disconnected.
+ */
+void retry();
+
+/**
+ * Cancels the pending connect timeout or reconnect (if any).
+ */
+void cancelTimer();
+
+/**
+ * Sets the connection status, notifying the listener if it changed.
+ *
+ * @param status    The new connection status
+ */
+void setStatus(Status status);
+
+/**
+ * Advances the connection lifecycle in response to a websocket state change.
+ *
+ * This is the main thread half of {@link onStateChangeCallback}. Events from
+ * an earlier connection attempt are ignored.
+ *
+ * @param state         The new websocket state
+ * @param generation    The connection attempt at the time of the event
+ */
+void advance(WebSocket::State state, Uint32 generation);
+
+
+/**
+ * Starts encoding a new message of the given type.
+ *
+ * This writes the message envelope into the reusable encoder, leaving the
+ * `message_payload` object open. The caller should write the payload fields
+ * and then call {@link endMessage}.
+ *
+ * @param type  The message type
+ */
+void beginMessage(const std::string &type);
+
+/**
+ * Finishes encoding the current message and sends it.
+ *
+ * @return true if the message was successfully sent (or queued), false otherwise.
+ */
+bool endMessage();
+
+/**
+ * Sends an encoded message to the WebSocket server.
+ *
+ * If batching is active, the message is queued instead. If the message
+ * cannot be sent because the connection is not open, it is deferred until
+ * the connection opens (see {@link defer}).
+ *
+ * @param message The encoded JSON message.
+ * @return true if the data was successfully sent (or deferred), false otherwise.
+ */
+bool send(const std::vector<std::byte> &message); // This is the helper function to send data
+
+/**
+ * Writes the given encoded message to the websocket.
+ *
+ * This method is shared by the synchronous path and the flusher thread. It
+ * does not consult the batching queue.
+ *
+ * A binary message is preceded by any dictionary entries the server has not
+ * seen yet. If the server has not accepted the binary format on this
+ * connection, the message is transcoded to JSON instead.
+ *
+ * @param message   The encoded (JSON or binary) message
+ * @return true if the message was successfully sent, false otherwise.
+ */
+bool transmit(const std::vector<std::byte> &message);
+
+/**
+ * Sends any dictionary entries the server has not seen on this connection.
+ *
+ * @return true if the server has every dictionary entry
+ */
+bool syncDictionary();
+
+/**
+ * Returns true if the next message should be encoded in binary.
+ *
+ * If so, this method also resets the binary encoder and writes the given
+ * message code.
+ *
+ * @param code  The binary message code
+ * @return true if the next message should be encoded in binary.
+ */
+bool beginBinary(AnalyticsCodec::Code code);
+
+/**
+ * Resends the full statistics of a task attempt the server could not patch.
+ *
+ * The server rejects a patch whose version does not follow the last version
+ * it received. This happens when an earlier sync was lost (for example, when
+ * the backlog overflowed). Errors for patches sent before the last full sync
+ * are ignored, as that sync already repaired the statistics.
+ *
+ * @param response  The error response from the server
+ */
+void resync(const std::shared_ptr<JsonValue>& response);
+
+/**
+ * Stores the given encoded message in the spool for a later replay.
+ *
+ * @param data  The encoded JSON message
+ * @param size  The number of bytes in the message
+ * @return true if the message was spooled, false if spooling is disabled or failed.
+ */
+bool store(const std::byte* data, size_t size);
+
+/**
+ * Holds the given encoded message until the connection opens.
+ *
+ * If spooling is enabled, the message is spooled. Otherwise it is added to
+ * an in-memory backlog, which discards its oldest message when full.
+ *
+ * @param data  The encoded message
+ * @param size  The number of bytes in the message
+ * @return true if the message was deferred, false if it could not be stored.
+ */
+bool defer(const std::byte* data, size_t size);
+
+/**
+ * Returns true if new messages must be deferred to preserve their order.
+ *
+ * This is the case while earlier messages are still waiting in the spool
+ * or the backlog.
+ *
+ * @return true if new messages must be deferred to preserve their order.
+ */
+bool mustDefer() const;
+
+/**
+ * Schedules a replay of the deferred messages on the main thread.
+ *
+ * This is called when the websocket opens. The replay resends the
+ * initialization data (if necessary) before any deferred messages.
+ */
+void scheduleReplay();
+
+/**
+ * Replays a single slice of the deferred messages.
+ *
+ * This is the scheduled callback started by {@link scheduleReplay}. It sends
+ * at most the replay rate worth of messages, spooled messages first, and
+ * returns true if it needs to run again.
+ *
+ * @return true if there are deferred messages remaining
+ */
+bool replay();
+
+/**
+ * Adds the given encoded message to the asynchronous send queue.
+ *
+ * If the queue is full, the message is handled according to the current
+ * {@link DropPolicy}. This method never blocks.
+ *
+ * @param text  The encoded JSON message
+ * @return true if the message was queued, false if it was dropped.
+ */
+bool enqueue(std::string &&text);
+
+/**
+ * Sends all messages that have been queued so far.
+ *
+ * Messages are coalesced into a single `batch` frame of at most the batch
+ * size. Messages that cannot be sent (because the socket is closed) are
+ * spooled if spooling is enabled, and are otherwise kept for the next flush.
+ * This method is only called on the flusher thread.
+ */
+void flush();
+
+/**
+ * Moves all messages held by the flusher thread into the spool.
+ *
+ * If spooling is disabled, the messages are kept for the next flush.
+ */
+void spoolOutgoing();
 
 /**
- * Sends data to the WebSocket server.
+ * The main loop of the flusher thread.
  *
- * @param data The JSON data to send.
- * @return true if the data was successfully sent, false otherwise.
+ * This thread wakes up every batch interval, or sooner if the queue reaches
+ * the batch size, and flushes the queue.
  */
-bool send(std::shared_ptr<JsonValue> &data); // This is the helper function to send data
+void runFlusher();
 
 #pragma mark Callbacks
 
@@ -457,7 +993,11 @@ bool send(std::shared_ptr<JsonValue> &data); // This is the helper function to s
 void onReceiptCallback(const std::vector<std::byte> &message, Uint64 time);
 
 /**
- * Callback function that logs state changes in the websocket connection
+ * Callback function that tracks state changes in the websocket connection
+ *
+ * This callback may be invoked on the network thread. It resets the session
+ * state immediately, and forwards the event to {@link advance} on the main
+ * thread.
  *
  * @param state The new websocket state
  */
@@ -469,20 +1009,30 @@ public:
 
 /**
  * Allocates a new  AnalyticsConnection with the given websocket configuration along
- * with the game MetaData. Opens the connection in order to send intialization data to the
- * analytics server.
+ * with the game MetaData. Starts opening the connection in order to send intialization
+ * data to the analytics server.
+ *
+ * This method never waits on the analytics server. The connection opens in
+ * the background, and messages recorded before it opens are delivered (in
+ * order) once it does. Use {@link onStatusChange} to monitor the connection.
+ *
+ * If binary is true, the connection offers the compact binary wire format
+ * (see {@link AnalyticsCodec}) in its init message. The binary format is
+ * only used if the server accepts it. Otherwise, all messages are sent as
+ * JSON, exactly as if binary were false.
  *
  * @param config The WebSocket configuration.
  * @param organization_name The name of the organization.
  * @param game_name The name of the game.
  * @param version_number The version number of the game.
  * @param debug  Whether to log debug messages from the connection.
+ * @param binary Whether to offer the binary wire format to the server
  * @return a newly allocated analytics connection
  */
-static std::shared_ptr<AnalyticsConnection> alloc(const WebSocketConfig &config, const std::string &organization_name, const std::string &game_name, const std::string &version_number, const bool &debug=false)
+static std::shared_ptr<AnalyticsConnection> alloc(const WebSocketConfig &config, const std::string &organization_name, const std::string &game_name, const std::string &version_number, const bool &debug=false, bool binary=false)
 {
     std::shared_ptr<AnalyticsConnection> result = std::make_shared<AnalyticsConnection>();
-    return (result->init(config, organization_name, game_name, version_number, debug) ? result : nullptr);
+    return (result->init(config, organization_name, game_name, version_number, debug, binary) ? result : nullptr);
 }
 
 #pragma mark Accessors
@@ -505,6 +1055,90 @@ std::unordered_map<std::string, std::shared_ptr<Task>> getTasks(){
     return _tasks;
 }
 
+/**
+* Returns the current status of the connection.
+*
+* This method is safe to call from any thread.
+*
+* @return the current status of the connection.
+*/
+Status getStatus() const { return _status; }
+
+/**
+* Returns true if the connection to the analytics server is open.
+*
+* @return true if the connection to the analytics server is open.
+*/
+bool isConnected() const { return _status == Status::CONNECTED; }
+
+/**
+* Sets a callback function to invoke on connection status changes.
+*
+* The callback is always invoked on the main thread. It is not invoked for the
+* current status, only for later changes.
+*
+* @param callback  The status change callback
+*/
+void onStatusChange(StatusCallback callback) { _onStatus = callback; }
+
+/**
+* Sets the time to wait for the websocket handshake.
+*
+* If the handshake does not complete in this time, the attempt is abandoned
+* and treated as a failed connection. The new value applies to the next
+* connection attempt.
+*
+* @param millis    The connect timeout in milliseconds
+*/
+void setConnectTimeout(Uint32 millis) { _connectTimeout = millis; }
+
+/**
+* Returns the time to wait for the websocket handshake.
+*
+* @return the connect timeout in milliseconds
+*/
+Uint32 getConnectTimeout() const { return _connectTimeout; }
+
+/**
+* Sets the delays between reconnect attempts.
+*
+* The first reconnect waits about minDelay milliseconds, and every failed
+* attempt doubles the delay, up to maxDelay. Each delay is randomized
+* between half and all of its value so that many clients do not reconnect
+* in lockstep after a server restart.
+*
+* @param minDelay  The delay (in milliseconds) before the first reconnect
+* @param maxDelay  The maximum delay (in milliseconds) between reconnects
+*/
+void setBackoff(Uint32 minDelay, Uint32 maxDelay);
+
+/**
+* Sets whether to reconnect automatically when the connection fails.
+*
+* This is true by default. If it is false, a failed connection becomes
+* DISCONNECTED, and is only reopened by an explicit call to {@link open}.
+*
+* @param flag  Whether to reconnect automatically
+*/
+void setAutoReconnect(bool flag) { _reconnect = flag; }
+
+/**
+* Returns true if the connection reconnects automatically when it fails.
+*
+* @return true if the connection reconnects automatically when it fails.
+*/
+bool getAutoReconnect() const { return _reconnect; }
+
+/**
+* Returns true if messages are currently sent in the binary wire format.
+*
+* This is only true if binary was requested when the connection was allocated,
+* and the server accepted it on the current connection.
+*
+* @return true if messages are currently sent in the binary wire format.
+*/
+bool isBinary() const { return _binaryReady; }
+
 /**
 * Toggles the debugging status of this connection.
 *
@@ -523,11 +1157,139 @@ void setDebug(bool flag);
 */
 bool getDebug();
 
+#pragma mark Batching
+
+/**
+ * Starts sending analytics asynchronously in batches.
+ *
+ * Once batching starts, methods such as {@link addTaskAttempt} and
+ * {@link recordAction} no longer touch the websocket. Instead they encode
+ * the message and push it on a lock-free queue, returning immediately. A
+ * background thread coalesces the queued messages into a single `batch`
+ * frame whenever either `batchSize` messages are waiting or `interval`
+ * milliseconds have passed.
+ *
+ * If the queue is full, new messages are handled according to `policy`.
+ * In either case the method recording the message will never block. It
+ * returns false if the message was dropped.
+ *
+ * This method does nothing (and returns false) if batching is already active.
+ *
+ * @param capacity  The maximum number of queued messages
+ * @param batchSize The maximum number of messages in a single frame
+ * @param interval  The maximum time (in milliseconds) between flushes
+ * @param policy    The policy for handling a full queue
+ * @return true if batching was started
+ */
+bool startBatching(size_t capacity=1024, size_t batchSize=32, Uint32 interval=250,
+                   DropPolicy policy=DropPolicy::DROP_NEWEST);
+
+/**
+ * Stops sending analytics asynchronously.
+ *
+ * This method makes one last attempt to flush the queue before stopping the
+ * background thread. Any messages that still cannot be sent are discarded,
+ * unless spooling is enabled.
+ * Afterwards, all messages are sent synchronously again.
+ */
+void stopBatching();
+
+/**
+ * Returns true if analytics are being sent asynchronously in batches.
+ *
+ * @return true if analytics are being sent asynchronously in batches.
+ */
+bool isBatching() const { return _batching; }
+
+/**
+ * Returns the (approximate) number of messages waiting to be sent.
+ *
+ * This includes messages in the queue as well as any messages that are
+ * held in memory because the socket is not open. It does not include
+ * spooled messages.
+ *
+ * @return the (approximate) number of messages waiting to be sent.
+ */
+size_t getPendingCount() const;
+
+/**
+ * Returns the number of messages dropped because the queue was full.
+ *
+ * This also counts messages discarded from the in-memory backlog of a
+ * connection that has not opened yet.
+ *
+ * @return the number of messages dropped because the queue was full.
+ */
+Uint64 getDroppedCount() const { return _dropped; }
+
+/**
+ * Returns true if the send queue is at least three quarters full.
+ *
+ * Games may use this to throttle optional analytics before messages start
+ * being dropped.
+ *
+ * @return true if the send queue is at least three quarters full.
+ */
+bool isBackpressured() const;
+
+#pragma mark Offline Spooling
+
+/**
+ * Enables durable spooling of messages that cannot be sent.
+ *
+ * Once spooling is enabled, a message that cannot be delivered because the
+ * analytics server is unreachable is appended to a spool on disk instead of
+ * being lost. This includes messages held by the batching thread. The spool
+ * survives application restarts, and is replayed in order (after the
+ * initialization data) whenever the websocket opens. To avoid flooding the
+ * server after a long outage, at most `replayRate` messages are replayed per
+ * second. Messages recorded while a replay is in progress are added to the
+ * end of the spool so that the server still receives them in order. Any
+ * messages already held in memory while waiting for the connection are
+ * moved to the spool.
+ *
+ * The spool directory is relative to the application save directory unless
+ * it is an absolute path. When the spool reaches `capacity` bytes, the oldest
+ * messages are discarded.
+ *
+ * This method must be called while batching is inactive. It returns false if
+ * spooling is already enabled.
+ *
+ * @param directory     The spool directory
+ * @param capacity      The maximum number of bytes on disk
+ * @param replayRate    The maximum number of messages replayed per second
+ * @return true if spooling was enabled
+ */
+bool enableSpool(const std::string &directory="analytics", size_t capacity=4194304, Uint32 replayRate=50);
+
+/**
+ * Disables durable spooling of messages.
+ *
+ * Any messages already spooled remain on disk, and will be replayed the next
+ * time spooling is enabled with the same directory. This method must be called
+ * while batching is inactive.
+ */
+void disableSpool();
+
+/**
+ * Returns the durable spool for messages that could not be sent.
+ *
+ * This value is nullptr if spooling is disabled.
+ *
+ * @return the durable spool for messages that could not be sent.
+ */
+std::shared_ptr<AnalyticsSpool> getSpool() const { return _spool; }
+
 #pragma mark AnalyticsData
 
 /**
 * Sends initialization data to the analytics server.
 *
+* The initialization data is never batched or spooled, as the server expects
+* it at the start of every connection. It is sent automatically whenever the
+* connection opens, so there is rarely any need to call this method. This
+* method does not open the connection.
+*
 * @return true if initialization data has been sent successfully 
 */
 bool sendInitialData();
@@ -568,6 +1330,12 @@ bool addTaskAttempts(const std::vector<std::shared_ptr<TaskAttempt>> &taskAttemp
  * Synchronizes a TaskAttempt with the analytics database. This updates the
  * data of a specific taskAttempt on the analytics server
  *
+ * If the server supports it, only the statistics changed since the last sync
+ * are sent, as a versioned merge patch. If the server reports that a patch
+ * does not follow the version it has, the full statistics are sent again
+ * automatically. The TaskAttempt must have been added with
+ * {@link addTaskAttempt} on this connection for that recovery to happen.
+ *
  * @param taskAttempt The TaskAttempt to synchronize.
  * @return true if the synchronization was successful, false otherwise.
  */
@@ -0,0 +1,341 @@
+//
+//  CUAnalyticsSpool.h
+//  Cornell University Game Library (CUGL)
+//
+//  This class provides durable, on-disk storage for analytics messages that
+//  could not be sent because the analytics server was unreachable. Messages
+//  are appended to a sequence of segment files in the save directory, and
+//  are replayed in order once the connection is restored.
+//
+//  Every record has a sequence number and a checksum. Each record is flushed
+//  to disk as soon as it is written, so a crash can only ever damage the last
+//  record of the newest segment. That torn record is detected (and ignored)
+//  the next time the spool is opened.
+//
+//  This class uses our standard shared-pointer architecture.
+//
+//  1. The constructor does not perform any initialization; it just sets all
+//     attributes to their defaults.
+//
+//  2. All initialization takes place via init methods, which can fail if an
+//     object is initialized more than once.
+//
+//  3. All allocation takes place via static constructors which return a shared
+//     pointer.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Kidus Zegeye
+//  Version: 1/15/25
+//
+#ifndef __CU_ANALYTICS_SPOOL_H__
+#define __CU_ANALYTICS_SPOOL_H__
+#include <cugl/core/CUBase.h>
+#include <cugl/core/io/CUBinaryWriter.h>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cugl {
+    namespace netcode {
+        namespace analytics {
+
+/**
+ * This class is a durable, append-only queue of analytics messages.
+ *
+ * The spool lives in a directory of segment files. New messages are always
+ * appended to the newest segment, and a new segment is started once the
+ * current one reaches the segment size. Messages are read back (in order)
+ * from the oldest segment, and a segment is deleted as soon as every record
+ * in it has been consumed. This means that the spool never rewrites a file.
+ *
+ * Each record stores a sequence number, the message length and a checksum.
+ * When the spool is opened, every segment is scanned, and scanning stops at
+ * the first record that is incomplete or fails its checksum. This recovers
+ * from a crash in the middle of a write. The sequence number of the last
+ * consumed record is stored in a separate cursor file (see {@link commit}),
+ * so records consumed before a crash are not replayed again.
+ *
+ * The total size of the spool is capped. When a new message would exceed the
+ * cap, the oldest segment is discarded. If the newest segment alone exceeds
+ * the cap, the new message is discarded instead. Discarded messages are
+ * counted by {@link getDropped}.
+ *
+ * All methods are thread-safe.
+ */
+class AnalyticsSpool {
+public:
+    /**
+     * A single message read back from the spool.
+     */
+    class Record {
+    public:
+        /** The sequence number of this record */
+        Uint64 sequence;
+        /** The encoded message */
+        std::vector<std::byte> message;
+    };
+
+private:
+    /**
+     * The metadata of a single segment file.
+     */
+    class Segment {
+    public:
+        /** The absolute path of the segment file */
+        std::string path;
+        /** The number of bytes in the segment */
+        size_t bytes;
+        /** The number of unconsumed records in the segment */
+        size_t records;
+    };
+
+    /** The absolute path of the spool directory */
+    std::string _directory;
+    /** The maximum number of bytes on disk */
+    size_t _capacity;
+    /** The number of bytes at which a new segment is started */
+    size_t _segmentSize;
+    /** The segments, from oldest to newest */
+    std::deque<Segment> _segments;
+    /** The writer for the newest segment (nullptr if it is closed) */
+    std::shared_ptr<BinaryWriter> _writer;
+    /** The records loaded from the oldest segment, waiting to be consumed */
+    std::deque<Record> _pending;
+    /** Whether _pending holds the contents of the oldest segment */
+    bool _loaded;
+    /** The sequence number for the next record */
+    Uint64 _nextSeq;
+    /** The sequence number of the last consumed record */
+    Uint64 _cursor;
+    /** The sequence number last written to the cursor file */
+    Uint64 _committed;
+    /** The number of bytes on disk */
+    size_t _bytes;
+    /** The number of unconsumed records */
+    size_t _count;
+    /** The number of records discarded because of the size cap */
+    Uint64 _dropped;
+    /** A mutex to support locking. This class does not need a recursive one. */
+    mutable std::mutex _mutex;
+
+#pragma mark Constructors
+public:
+    /**
+     * Creates a degenerate spool.
+     *
+     * This object has not been initialized with a directory and cannot be used.
+     *
+     * You should NEVER USE THIS CONSTRUCTOR. All spools should be created by
+     * the static constructor {@link alloc} instead.
+     */
+    AnalyticsSpool();
+
+    /**
+     * Deletes this spool, disposing all resources
+     */
+    ~AnalyticsSpool() { dispose(); }
+
+    /**
+     * Disposes all of the resources used by this spool.
+     *
+     * The cursor is committed and the newest segment is closed. The files
+     * remain on disk, and will be recovered the next time a spool is opened
+     * in the same directory.
+     */
+    void dispose();
+
+    /**
+     * Initializes a spool in the given directory.
+     *
+     * If the directory is a relative path, it is relative to the application
+     * save directory. The directory is created if it does not exist. Any
+     * segments already in the directory are recovered.
+     *
+     * @param directory     The spool directory
+     * @param capacity      The maximum number of bytes on disk
+     * @param segmentSize   The number of bytes at which a new segment is started
+     *
+     * @return true if initialization was successful
+     */
+    bool init(const std::string directory, size_t capacity, size_t segmentSize);
+
+    /**
+     * Returns a newly allocated spool in the given directory.
+     *
+     * If the directory is a relative path, it is relative to the application
+     * save directory. The directory is created if it does not exist. Any
+     * segments already in the directory are recovered.
+     *
+     * @param directory     The spool directory
+     * @param capacity      The maximum number of bytes on disk
+     * @param segmentSize   The number of bytes at which a new segment is started
+     *
+     * @return a newly allocated spool in the given directory.
+     */
+    static std::shared_ptr<AnalyticsSpool> alloc(const std::string directory,
+                                                 size_t capacity=4194304,
+                                                 size_t segmentSize=262144) {
+        std::shared_ptr<AnalyticsSpool> result = std::make_shared<AnalyticsSpool>();
+        return (result->init(directory,capacity,segmentSize) ? result : nullptr);
+    }
+
+#pragma mark Accessors
+    /**
+     * Returns the absolute path of the spool directory.
+     *
+     * @return the absolute path of the spool directory.
+     */
+    const std::string getDirectory() const { return _directory; }
+
+    /**
+     * Returns the number of messages waiting to be consumed.
+     *
+     * @return the number of messages waiting to be consumed.
+     */
+    size_t size() const;
+
+    /**
+     * Returns true if there are no messages waiting to be consumed.
+     *
+     * @return true if there are no messages waiting to be consumed.
+     */
+    bool empty() const { return size() == 0; }
+
+    /**
+     * Returns the number of bytes currently on disk.
+     *
+     * @return the number of bytes currently on disk.
+     */
+    size_t getBytes() const;
+
+    /**
+     * Returns the number of messages discarded because of the size cap.
+     *
+     * @return the number of messages discarded because of the size cap.
+     */
+    Uint64 getDropped() const;
+
+#pragma mark Spooling
+    /**
+     * Appends a message to the end of the spool.
+     *
+     * The message is flushed to disk before this method returns.
+     *
+     * @param data  The message bytes
+     * @param size  The number of bytes
+     *
+     * @return true if the message was stored, false if it was dropped
+     */
+    bool append(const std::byte* data, size_t size);
+
+    /**
+     * Appends a message to the end of the spool.
+     *
+     * The message is flushed to disk before this method returns.
+     *
+     * @param message   The encoded message
+     *
+     * @return true if the message was stored, false if it was dropped
+     */
+    bool append(const std::vector<std::byte>& message) {
+        return append(message.data(), message.size());
+    }
+
+    /**
+     * Appends a message to the end of the spool.
+     *
+     * The message is flushed to disk before this method returns.
+     *
+     * @param message   The encoded message
+     *
+     * @return true if the message was stored, false if it was dropped
+     */
+    bool append(const std::string& message) {
+        return append(reinterpret_cast<const std::byte*>(message.data()), message.size());
+    }
+
+    /**
+     * Returns true if the oldest message was copied into the given record.
+     *
+     * The message is not consumed. Call {@link pop} once the message has been
+     * delivered.
+     *
+     * @param record    The record to store the message
+     *
+     * @return true if the oldest message was copied into the given record.
+     */
+    bool peek(Record& record);
+
+    /**
+     * Consumes the oldest message.
+     *
+     * The segment containing the message is deleted once all of its messages
+     * are consumed. The new cursor is not saved until {@link commit} is called.
+     */
+    void pop();
+
+    /**
+     * Saves the sequence number of the last consumed message.
+     *
+     * If the application crashes before this method is called, any messages
+     * consumed since the last commit will be replayed the next time the spool
+     * is opened.
+     */
+    void commit();
+
+private:
+#pragma mark Internal Helpers
+    /**
+     * Scans the given segment, returning the valid records after the cursor.
+     *
+     * Scanning stops at the first incomplete or corrupt record.
+     *
+     * @param path      The segment path
+     * @param records   The vector to store the records (may be nullptr)
+     * @param last      The sequence number of the last valid record (output)
+     *
+     * @return the number of valid records after the cursor
+     */
+    size_t scan(const std::string& path, std::deque<Record>* records, Uint64& last) const;
+
+    /**
+     * Closes the newest segment so that no more records are written to it.
+     */
+    void closeSegment();
+
+    /**
+     * Deletes the oldest segment, discarding any unconsumed records.
+     */
+    void dropSegment();
+
+    /**
+     * Writes the cursor file.
+     */
+    void writeCursor();
+};
+
+        }
+    }
+}
+
+#endif /* __CU_ANALYTICS_SPOOL_H__ */
@@ -0,0 +1,276 @@
+//
+//  CUJsonSerializer.h
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides support for encoding JSON text directly into a byte
+//  buffer for network transit. Unlike JsonValue::toString, it does not build
+//  an intermediate tree, and the buffer is reused from message to message.
+//  This makes it suitable for high frequency messages such as analytics.
+//
+//  This class does not QUITE use our standard shared-pointer architecture. That
+//  is because there is no non-trivial constructor patterns and so an init method
+//  is not necessary. However, we do still include an alloc method for creating
+//  shared pointers.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Kidus Zegeye
+//  Version: 1/15/25
+//
+#ifndef __CU_JSON_SERIALIZER_H__
+#define __CU_JSON_SERIALIZER_H__
+#include <cugl/core/CUBase.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cugl {
+
+/** Forward reference to the JsonValue class */
+class JsonValue;
+
+    /**
+     * The classes to support CUGL networking.
+     *
+     * Currently CUGL supports ad-hoc game lobbies using web-sockets. The
+     * sockets must connect connect to a CUGL game lobby server. However,
+     * the actual network layer is supported by high speed WebRTC. See
+     *
+     *     https://libdatachannel.org
+     *
+     * for an explanation of our networking layer.
+     */
+    namespace netcode {
+
+#pragma mark -
+#pragma mark JsonSerializer
+/**
+ * A class to encode JSON text directly into a byte array.
+ *
+ * This class is a streaming writer. Values are appended to the buffer as soon
+ * as they are written, and objects and arrays are opened and closed explicitly.
+ * Commas and colons are inserted automatically. The output is always compact
+ * (no whitespace), and strings are escaped according to RFC 8259, so any
+ * std::string (such as a task name containing a quote) is safe to write.
+ *
+ * The buffer is not released by {@link reset}. Hence a single serializer can
+ * encode many messages without allocating once its buffer has grown to the
+ * size of the largest message.
+ *
+ * Unlike {@link NetcodeSerializer}, the result is plain JSON text. It can be
+ * read by any JSON parser, including {@link JsonValue#allocWithJson}.
+ */
+class JsonSerializer {
+private:
+    /** The encoded JSON text */
+    std::vector<std::byte> _data;
+    /** For each open object/array, whether it has at least one element */
+    std::vector<bool> _nonempty;
+    /** Whether the last item written was an object key */
+    bool _afterKey;
+
+    /**
+     * Appends a separating comma if one is needed before the next value.
+     */
+    void separate();
+
+    /**
+     * Appends the given characters to the buffer without any processing.
+     *
+     * @param s     The characters to append
+     * @param len   The number of characters
+     */
+    void append(const char* s, size_t len) {
+        const std::byte* bytes = reinterpret_cast<const std::byte*>(s);
+        _data.insert(_data.end(), bytes, bytes+len);
+    }
+
+    /**
+     * Appends the given character to the buffer without any processing.
+     *
+     * @param c     The character to append
+     */
+    void append(char c) {
+        _data.push_back(static_cast<std::byte>(c));
+    }
+
+    /**
+     * Appends the given string to the buffer as a quoted, escaped literal.
+     *
+     * @param s     The string to append
+     */
+    void appendQuoted(const std::string& s);
+
+public:
+    /**
+     * Creates a new JSON serializer on the stack.
+     *
+     * JSON serializers do not have any nontrivial state and so it is unnecessary
+     * to use an init method. However, we do include a static {@link #alloc} method
+     * for creating shared pointers.
+     */
+    JsonSerializer() : _afterKey(false) {}
+
+    /**
+     * Returns a newly created JSON serializer.
+     *
+     * This method is solely include for convenience purposes.
+     *
+     * @return a newly created JSON serializer.
+     */
+    static std::shared_ptr<JsonSerializer> alloc() {
+        return std::make_shared<JsonSerializer>();
+    }
+
+#pragma mark Structure
+    /**
+     * Opens a new JSON object.
+     *
+     * All values written until the matching call to {@link #endObject} must
+     * be preceded by a call to {@link #writeKey}.
+     */
+    void beginObject();
+
+    /**
+     * Closes the current JSON object.
+     */
+    void endObject();
+
+    /**
+     * Opens a new JSON array.
+     */
+    void beginArray();
+
+    /**
+     * Closes the current JSON array.
+     */
+    void endArray();
+
+    /**
+     * Writes the key for the next value of the current object.
+     *
+     * @param key   The object key
+     */
+    void writeKey(const std::string& key);
+
+#pragma mark Values
+    /**
+     * Writes a null value.
+     */
+    void writeNull();
+
+    /**
+     * Writes a boolean value.
+     *
+     * @param b The value to write
+     */
+    void writeBool(bool b);
+
+    /**
+     * Writes an integer value.
+     *
+     * @param i The value to write
+     */
+    void writeSint64(Sint64 i);
+
+    /**
+     * Writes a floating point value.
+     *
+     * Integral values are written without a decimal point. NaN and infinite
+     * values are not representable in JSON and are written as null.
+     *
+     * @param d The value to write
+     */
+    void writeDouble(double d);
+
+    /**
+     * Writes a string value, escaping it as necessary.
+     *
+     * @param s The value to write
+     */
+    void writeString(const std::string& s);
+
+    /**
+     * Writes the given JSON tree.
+     *
+     * The tree is encoded directly from its nodes. No intermediate string is
+     * created. A nullptr is written as null.
+     *
+     * @param j The value to write
+     */
+    void writeJson(const std::shared_ptr<JsonValue>& j);
+
+    /**
+     * Writes a value that has already been encoded as JSON text.
+     *
+     * The text is copied as is. It is the responsibility of the caller to
+     * ensure it is a single valid JSON value.
+     *
+     * @param json  The encoded value to write
+     */
+    void writeRaw(const std::string& json);
+
+#pragma mark Output
+    /**
+     * Returns the JSON text written so far.
+     *
+     * This provides a vector for network transit. Unlike {@link NetcodeSerializer},
+     * the contents are plain (UTF-8) JSON text. The reference is only valid until
+     * the next write or {@link #reset}.
+     *
+     * You MUST call reset() after this method to clear the buffer. Otherwise,
+     * the next call to this method will still contain all the contents written
+     * in this call.
+     *
+     * @return the JSON text written so far.
+     */
+    const std::vector<std::byte>& serialize() const { return _data; }
+
+    /**
+     * Returns the JSON text written so far as a string.
+     *
+     * This method copies the buffer. Use {@link #serialize} when possible.
+     *
+     * @return the JSON text written so far as a string.
+     */
+    std::string toString() const {
+        return std::string(reinterpret_cast<const char*>(_data.data()), _data.size());
+    }
+
+    /**
+     * Returns the number of bytes written so far.
+     *
+     * @return the number of bytes written so far.
+     */
+    size_t size() const { return _data.size(); }
+
+    /**
+     * Clears the buffer.
+     *
+     * The buffer capacity is retained so that the next message can be written
+     * without allocating.
+     */
+    void reset();
+};
+
+    }
+}
+
+#endif /* __CU_JSON_SERIALIZER_H__ */
@@ -52,6 +52,7 @@
 #ifndef __CU_NETCODE_CHANNEL_H__
 #define __CU_NETCODE_CHANNEL_H__
 #include <cugl/core/CUBase.h>
+#include <cugl/netcode/CUNetcodeMessage.h>
 
 #include <rtc/rtc.hpp>
 #include <future>
@@ -161,13 +162,16 @@ private:
      * Initializes a new RTC data channel for the given label.
      *
      * This initializer assumes the peer is the offerer of the data channel.
+     * The channel is reliable and ordered unless another reliability is given.
      *
-     * @param parent    The parent RTC peer connection
-     * @param label     The unique label for this data channel
+     * @param parent        The parent RTC peer connection
+     * @param label         The unique label for this data channel
+     * @param reliability   The delivery guarantees of this data channel
      *
      * @return true if initialization was successful
      */
-    bool init(const std::weak_ptr<NetcodePeer>& parent, std::string label);
+    bool init(const std::weak_ptr<NetcodePeer>& parent, std::string label,
+              const rtc::Reliability& reliability = rtc::Reliability());
 
     /**
      * Initializes a new netcode wrapper for the given RTC data channel.
@@ -185,15 +189,18 @@ private:
      * Returns a newly allocated RTC data channel for the given label.
      *
      * This initializer assumes the peer is the offerer of the data channel.
+     * The channel is reliable and ordered unless another reliability is given.
      *
-     * @param parent    The parent RTC peer connection
-     * @param label     The unique label for this data channel
+     * @param parent        The parent RTC peer connection
+     * @param label         The unique label for this data channel
+     * @param reliability   The delivery guarantees of this data channel
      *
      * @return a newly allocated RTC data channel for the given label.
      */
-    static std::shared_ptr<NetcodeChannel> alloc(const std::weak_ptr<NetcodePeer>& parent, std::string label) {
+    static std::shared_ptr<NetcodeChannel> alloc(const std::weak_ptr<NetcodePeer>& parent, std::string label,
+                                                 const rtc::Reliability& reliability = rtc::Reliability()) {
         std::shared_ptr<NetcodeChannel> result = std::make_shared<NetcodeChannel>();
-        return (result->init(parent,label) ? result : nullptr);
+        return (result->init(parent,label,reliability) ? result : nullptr);
     }
 
     /**
@@ -297,6 +304,32 @@ public:
      */
     bool send(const std::vector<std::byte>& data);
 
+    /**
+     * Sends a shared message along this data channel to its recipient
+     *
+     * Most users should never need  to access this method. All communication
+     * should take place using the associated {@link NetcodeConnection}. It is
+     * provided for debugging purposes only.
+     *
+     * @param message   The message to send
+     *
+     * @return true if transmission was (apparently) successful
+     */
+    bool send(const std::shared_ptr<NetcodeMessage>& message);
+
+    /**
+     * Returns the number of bytes queued to send on this data channel.
+     *
+     * These are bytes that have been sent by this channel, but that are still
+     * waiting to be sent over the network. This number grows when the
+     * recipient (or the network to it) cannot keep up.
+     *
+     * This method is not const because it requires a lock.
+     *
+     * @return the number of bytes queued to send on this data channel.
+     */
+    size_t getQueuedBytes();
+
 #pragma mark Debugging
     /**
      * Toggles the debugging status of this channel.
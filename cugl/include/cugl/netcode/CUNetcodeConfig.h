@@ -84,6 +84,36 @@ class JsonValue;
  */
 class NetcodeConfig {
 public:
+    /**
+     * The delivery class of a peer data channel.
+     *
+     * Each class corresponds to a separate data channel between two peers,
+     * mapped onto the libdatachannel reliability settings. Messages on one
+     * channel are never delayed by losses on another channel.
+     */
+    enum class ChannelClass : int {
+        /**
+         * Every message arrives, in the order sent.
+         *
+         * This is the "public" channel, which is always open.
+         */
+        RELIABLE = 0,
+        /**
+         * Messages are sent once, and may be lost or arrive out of order.
+         *
+         * This is appropriate for state that is resent every frame, as a
+         * lost message never blocks the ones after it.
+         */
+        UNRELIABLE = 1,
+        /**
+         * Messages are retransmitted a limited number of times.
+         *
+         * Messages may still be lost, and may arrive out of order. The limit
+         * is given by {@link #maxRetransmits}.
+         */
+        RETRANSMIT = 2
+    };
+    
     /** Whether the lobby requires an SSL connection */
     bool secure;
     
@@ -128,6 +158,19 @@ public:
     /** The maximum number of players allowed (default 2) */
     uint16_t maxPlayers;
     
+    /**
+     * The additional channel classes to open (default none)
+     *
+     * Every peer connection has a {@link ChannelClass#RELIABLE} channel. Any
+     * other class listed here is opened once that channel is established.
+     * Messages sent on a class that is not open fall back to the reliable
+     * channel.
+     */
+    std::vector<ChannelClass> channels;
+    
+    /** The retransmit limit for {@link ChannelClass#RETRANSMIT} (default 2) */
+    uint32_t maxRetransmits;
+    
     /**
      * The UUID seed (default "" for random)
      *
@@ -194,6 +237,8 @@ public:
      *      "buffer size":  An int respresenting the size of the message buffer
      *      "max message":  An int respresenting the maximum transmission size
      *      "max players":  An int respresenting the maximum number of players
+     *      "channels":     A list of extra channel classes ("unreliable", "retransmit")
+     *      "max retransmits": An int representing the retransmit limit
      *      "UUID seed":    A string providing a potential UUID seed
      *      "API version":  An int respresenting the API version
      *
@@ -278,6 +323,8 @@ public:
      *      "buffer size":  An int respresenting the size of the message buffer
      *      "max message":  An int respresenting the maximum transmission size
      *      "max players":  An int respresenting the maximum number of players
+     *      "channels":     A list of extra channel classes ("unreliable", "retransmit")
+     *      "max retransmits": An int representing the retransmit limit
      *      "UUID seed":    A string providing a potential UUID seed
      *      "API version":  An int respresenting the API version
      *
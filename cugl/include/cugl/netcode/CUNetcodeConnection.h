@@ -63,6 +63,7 @@
 #ifndef __CU_NETCODE_CONNECTION_H__
 #define __CU_NETCODE_CONNECTION_H__
 #include <cugl/netcode/CUNetcodeConfig.h>
+#include <cugl/netcode/CUNetcodeMessage.h>
 
 #include <rtc/rtc.hpp>
 #include <unordered_map>
@@ -320,6 +321,10 @@ private:
      * As messages come from many different peers, it is helpful to know the
      * sender of each. This information is stored with the message in the ring
      * buffer
+     *
+     * Messages received from peers are owned by the envelope. Messages this
+     * connection sent to itself (such as the loopback of a broadcast) are
+     * shared with the other recipients instead.
      */
     class Envelope {
     public:
@@ -327,6 +332,8 @@ private:
         std::string source;
         /** The message (as a byte vector) */
         std::vector<std::byte> message;
+        /** The shared message (if not nullptr, this replaces message) */
+        std::shared_ptr<NetcodeMessage> shared;
 
         /** Creates an empty message envelope */
         Envelope() {}
@@ -339,6 +346,7 @@ private:
         Envelope(const Envelope& env) {
             source  = env.source;
             message = env.message;
+            shared  = env.shared;
         }
 
         /**
@@ -346,9 +354,10 @@ private:
          *
          * @param env the message envelope to acquire
          */
-        Envelope(Envelope&& env) {
+        Envelope(Envelope&& env) noexcept {
             source  = std::move(env.source);
             message = std::move(env.message);
+            shared  = std::move(env.shared);
          }
 
         /**
@@ -359,6 +368,7 @@ private:
         Envelope& operator=(const Envelope& env) {
             source  = env.source;
             message = env.message;
+            shared  = env.shared;
             return *this;
         }
 
@@ -367,11 +377,21 @@ private:
          *
          * @param env the message envelope to acquire
          */
-        Envelope& operator=(Envelope&& env) {
+        Envelope& operator=(Envelope&& env) noexcept {
             source  = std::move(env.source);
             message = std::move(env.message);
+            shared  = std::move(env.shared);
             return *this;
         }
+
+        /**
+         * Returns the bytes of the message in this envelope
+         *
+         * @return the bytes of the message in this envelope
+         */
+        const std::vector<std::byte>& bytes() const {
+            return shared ? shared->bytes() : message;
+        }
     };
 
     /** The configuration of this connection */
@@ -413,6 +433,10 @@ private:
     PromotionCallback _onPromotion;
     /** Alternatively make the dispatcher a callback */
     Dispatcher _onReceipt;
+    /** Whether a dispatcher callback is set (so {@link #receive} does nothing) */
+    std::atomic<bool> _dispatching;
+    /** Whether the per-frame dispatch task is scheduled with the application */
+    bool _pumping;
     /** A counter to indicate when host migration is complete */
     size_t _migration;
 
@@ -426,7 +450,10 @@ private:
      * before a read. This buffer stores this messages.
      *
      * This is a classic ring buffer. It it fills up (because the application
-     * is too slow to read), then the oldest messages are deleted first.
+     * is too slow to read), then the oldest messages are deleted first. The
+     * exception is when a dispatcher callback is set. The callback must see
+     * every message, so the buffer grows instead, and it shrinks back to its
+     * capacity once it is drained.
      */
     std::vector<Envelope> _buffer;
     /** The number of messages in the data ring buffer */
@@ -437,6 +464,16 @@ private:
     size_t _buffhead;
     /** The tail of the data ring buffer */
     size_t _bufftail;
+    /** Whether a message was dropped since the buffer was last drained */
+    bool _dropping;
+    /**
+     * The messages taken from the ring buffer for dispatch
+     *
+     * Messages are moved here (under the lock) so that they can be dispatched
+     * without holding the lock. The vector is reused so that dispatch does
+     * not allocate each frame.
+     */
+    std::vector<Envelope> _inbox;
 
     // To prevent race conditions
     /** Whether this websocket connection prints out debugging information */
@@ -566,6 +603,34 @@ private:
     void onPeerClosed(const std::string uuid);
 
 #pragma mark Internal Communication
+    /**
+     * Returns the data channel label for the given channel class.
+     *
+     * The reliable class always uses the "public" channel.
+     *
+     * @param cls   The channel class
+     *
+     * @return the data channel label for the given channel class.
+     */
+    static std::string getChannelLabel(NetcodeConfig::ChannelClass cls);
+
+    /**
+     * Returns true if there is another channel to open after the given one.
+     *
+     * The offerer of a peer connection opens the channels one at a time,
+     * starting with the "public" channel, and then each class in
+     * {@link NetcodeConfig#channels}. If this method returns true, the
+     * label and reliability of the next channel are stored in the given
+     * references.
+     *
+     * @param label         The label of the channel that just opened
+     * @param next          The label of the next channel to open
+     * @param reliability   The reliability of the next channel to open
+     *
+     * @return true if there is another channel to open after the given one.
+     */
+    bool nextChannel(const std::string& label, std::string& next, rtc::Reliability& reliability);
+
     /**
      * Offers a peer connection to the host with the given UUID
      *
@@ -626,13 +691,80 @@ private:
      * Appends the given data to the ring buffer.
      *
      * This method is used to store an incoming message for later consumption.
+     * It takes ownership of the message data. Messages are buffered even if
+     * a dispatcher callback is set, as that callback is invoked on the whole
+     * batch once per frame.
      *
      * @param source    The message source
      * @param data      The message data
      *
      * @return if the message was successfully added to the buffer.
      */
-    bool append(const std::string source, const std::vector<std::byte>& data);
+    bool append(const std::string& source, std::vector<std::byte>&& data);
+    
+    /**
+     * Appends the given shared message to the ring buffer.
+     *
+     * This method is the same as {@link #append}, except that the envelope
+     * holds a reference to the message instead of the message data. It is
+     * used when this connection sends a message to itself.
+     *
+     * @param source    The message source
+     * @param message   The shared message
+     *
+     * @return if the message was successfully added to the buffer.
+     */
+    bool append(const std::string& source, const std::shared_ptr<NetcodeMessage>& message);
+    
+    /**
+     * Returns the data channel to the given peer for the given label
+     *
+     * If the peer does not have a channel with this label, this method
+     * returns the "public" channel instead. It returns nullptr if there is
+     * no route to the peer at all.
+     *
+     * This method assumes that the connection lock is held.
+     *
+     * @param dst   The UUID of the peer
+     * @param label The channel label
+     *
+     * @return the data channel to the given peer for the given label
+     */
+    std::shared_ptr<NetcodeChannel> findChannel(const std::string& dst, const std::string& label);
+    
+    /**
+     * Makes room in the ring buffer for one more message.
+     *
+     * If the ring buffer is full and a dispatcher callback is set, the buffer
+     * doubles in size, as the dispatcher must see every message. Otherwise the
+     * oldest message is dropped (and the first drop is logged).
+     *
+     * This method assumes that the lock is held.
+     */
+    void makeRoom();
+
+    /**
+     * Hands all of the buffered messages to the given dispatcher.
+     *
+     * The messages are moved out of the ring buffer while holding the lock,
+     * and are then dispatched with the lock released. If the buffer grew to
+     * hold a burst of messages, it shrinks back to its capacity.
+     *
+     * @param dispatcher    The function to process received data
+     */
+    void drain(const Dispatcher& dispatcher);
+    
+    /**
+     * Dispatches this frame's messages to the {@link #onReceipt} callback.
+     *
+     * This method is scheduled with the {@link Application} as a recurring
+     * task when the callback is set, and so it is called once per frame on
+     * the main thread. It returns false (ending the task) once the callback
+     * is removed.
+     *
+     * @return true if the task should be invoked again next frame
+     */
+    bool pump();
 
     /** Allow access to the other netcode classes */
     friend class NetcodeManager;
@@ -922,6 +1054,55 @@ public:
      */
     bool sendTo(const std::string dst, const std::vector<std::byte>& data);
 
+    /**
+     * Sends a byte array to the specified connection on the given channel class.
+     *
+     * This method is the same as {@link #sendTo}, except that the message is
+     * sent on the data channel for the given class. Only messages on the
+     * {@link NetcodeConfig::ChannelClass#RELIABLE} channel are guaranteed to
+     * arrive, or to arrive in order. If the channel class is not open to the
+     * destination (see {@link NetcodeConfig#channels}), the message is sent
+     * on the reliable channel instead.
+     *
+     * @param dst   The UUID of the peer to receive the message
+     * @param data  The byte array to send.
+     * @param cls   The channel class to send on
+     *
+     * @return true if the message was (apparently) sent
+     */
+    bool sendTo(const std::string dst, const std::vector<std::byte>& data,
+                NetcodeConfig::ChannelClass cls);
+
+    /**
+     * Sends a shared message to the specified connection.
+     *
+     * This method is the same as {@link #sendTo}, except that the message is
+     * not copied. This makes it possible to send the same encoded message to
+     * many (but not all) players without a copy for each one.
+     *
+     * @param dst       The UUID of the peer to receive the message
+     * @param message   The message to send.
+     *
+     * @return true if the message was (apparently) sent
+     */
+    bool sendTo(const std::string dst, const std::shared_ptr<NetcodeMessage>& message);
+
+    /**
+     * Sends a shared message to the specified connection on the given channel class.
+     *
+     * This method is the same as {@link #sendTo}, except that the message is
+     * not copied. This makes it possible to send the same encoded message to
+     * many (but not all) players without a copy for each one.
+     *
+     * @param dst       The UUID of the peer to receive the message
+     * @param message   The message to send.
+     * @param cls       The channel class to send on
+     *
+     * @return true if the message was (apparently) sent
+     */
+    bool sendTo(const std::string dst, const std::shared_ptr<NetcodeMessage>& message,
+                NetcodeConfig::ChannelClass cls);
+
     /**
      * Sends a byte array to the host player.
      *
@@ -947,6 +1128,23 @@ public:
      */
     bool sendToHost(const std::vector<std::byte>& data);
 
+    /**
+     * Sends a byte array to the host player on the given channel class.
+     *
+     * This method is the same as {@link #sendToHost}, except that the message
+     * is sent on the data channel for the given class. Only messages on the
+     * {@link NetcodeConfig::ChannelClass#RELIABLE} channel are guaranteed to
+     * arrive, or to arrive in order. If the channel class is not open to the
+     * host (see {@link NetcodeConfig#channels}), the message is sent on the
+     * reliable channel instead.
+     *
+     * @param data  The byte array to send.
+     * @param cls   The channel class to send on
+     *
+     * @return true if the message was (apparently) sent
+     */
+    bool sendToHost(const std::vector<std::byte>& data, NetcodeConfig::ChannelClass cls);
+
     /**
      * Sends a byte array to all other players.
      *
@@ -975,6 +1173,67 @@ public:
      */
     bool broadcast(const std::vector<std::byte>& data);
 
+    /**
+     * Sends a byte array to all other players on the given channel class.
+     *
+     * This method is the same as {@link #broadcast}, except that the message
+     * is sent on the data channel for the given class. Only messages on the
+     * {@link NetcodeConfig::ChannelClass#RELIABLE} channel are guaranteed to
+     * arrive, or to arrive in order. Any player that does not have the channel
+     * class open (see {@link NetcodeConfig#channels}) is sent the message on
+     * the reliable channel instead.
+     *
+     * @param data  The byte array to send.
+     * @param cls   The channel class to send on
+     *
+     * @return true if the message was (apparently) sent
+     */
+    bool broadcast(const std::vector<std::byte>& data, NetcodeConfig::ChannelClass cls);
+
+    /**
+     * Sends a shared message to all other players.
+     *
+     * This method is the same as {@link #broadcast}, except that the message
+     * is not copied for each player. In particular, the copy this player
+     * receives references the same bytes.
+     *
+     * @param message   The message to send.
+     *
+     * @return true if the message was (apparently) sent
+     */
+    bool broadcast(const std::shared_ptr<NetcodeMessage>& message);
+
+    /**
+     * Sends a shared message to all other players on the given channel class.
+     *
+     * This method is the same as {@link #broadcast}, except that the message
+     * is not copied for each player. In particular, the copy this player
+     * receives references the same bytes.
+     *
+     * @param message   The message to send.
+     * @param cls       The channel class to send on
+     *
+     * @return true if the message was (apparently) sent
+     */
+    bool broadcast(const std::shared_ptr<NetcodeMessage>& message, NetcodeConfig::ChannelClass cls);
+
+    /**
+     * Returns the number of bytes queued to send to the given player.
+     *
+     * This is the total over all data channels to that player. It is the
+     * data that has been sent but is still waiting for the network, and so
+     * it grows when that player cannot keep up. A host can use this to shed
+     * load, by skipping messages that will be superseded (such as state
+     * snapshots) for that player until the queue drains.
+     *
+     * This method returns 0 for this player, or for any unknown player.
+     *
+     * @param peer  The UUID of the player
+     *
+     * @return the number of bytes queued to send to the given player.
+     */
+    size_t getQueuedBytes(const std::string& peer);
+
     /**
      * Receives incoming network messages.
      *
@@ -987,8 +1246,8 @@ public:
      * render frame, or even not at all.
      *
      * If a dispatcher callback has been registered with {@link #onReceipt},
-     * this method will never do anything. In that case, messages are not
-     * buffered and are processed as soon as they are received. However, this
+     * this method will never do anything. In that case, messages are handed
+     * to that callback at the start of each animation frame. However, this
      * method has the advantage that it can be read on a separate thread.
      *
      * @param dispatcher    The function to process received data
@@ -1019,8 +1278,9 @@ public:
      * Sets a callback function to invoke on message receipt
      *
      * This callback is alternative to the method {@link #receive}. Instead of
-     * buffering messages and calling that method each frame, this callback
-     * function will be invoked as soon as the message is received.
+     * calling that method each frame, the application will call this function
+     * on every message received since the previous frame. The messages are
+     * delivered as a single batch, with no per-message scheduling.
      *
      * All callback functions are guaranteed to be called on the main thread.
      * They are called at the start of an animation frame, before the method
@@ -0,0 +1,191 @@
+//
+//  CUNetcodeMessage.h
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides an immutable message buffer that can be shared by
+//  many recipients. When a host fans out the same message to every player,
+//  the message is encoded once, and each recipient (including the loopback
+//  to the host itself) holds a reference to the same bytes rather than its
+//  own copy.
+//
+//  This class uses our standard shared-pointer architecture.
+//
+//  1. The constructor does not perform any initialization; it just sets all
+//     attributes to their defaults.
+//
+//  2. All initialization takes place via init methods, which can fail if an
+//     object is initialized more than once.
+//
+//  3. All allocation takes place via static constructors which return a shared
+//     pointer
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Walker White
+//  Version: 7/3/24 (CUGL 3.0 reorganization)
+//
+#ifndef __CU_NETCODE_MESSAGE_H__
+#define __CU_NETCODE_MESSAGE_H__
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace cugl {
+
+    /**
+     * The classes to support CUGL networking.
+     *
+     * Currently CUGL supports ad-hoc game lobbies using web-sockets. The
+     * sockets must connect connect to a CUGL game lobby server. However,
+     * the actual network layer is supported by high speed WebRTC. See
+     *
+     *     https://libdatachannel.org
+     *
+     * for an explanation of our networking layer.
+     */
+    namespace netcode {
+
+/**
+ * This class is an immutable network message.
+ *
+ * A message is always handled by shared pointer, and its bytes can never
+ * change once it is initialized. This makes it safe to hand the same message
+ * to any number of connections, on any thread, without copying it. The
+ * message is released when the last connection is done with it.
+ *
+ * Note that the underlying transport (libdatachannel) still makes its own
+ * copy of the bytes for each data channel or websocket, as each of those
+ * has its own send buffer. What a shared message saves is every copy before
+ * that point: the per-recipient vectors, and the loopback copy a broadcast
+ * delivers to its own sender.
+ */
+class NetcodeMessage {
+private:
+    /** The message bytes */
+    std::vector<std::byte> _data;
+
+public:
+#pragma mark Constructors
+    /**
+     * Creates an empty message.
+     *
+     * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate a message on
+     * the heap, use one of the static constructors instead.
+     */
+    NetcodeMessage() {}
+
+    /**
+     * Deletes this message, releasing all resources.
+     */
+    ~NetcodeMessage() {}
+
+    /**
+     * Initializes this message with the given bytes.
+     *
+     * The message takes ownership of the bytes, so they are not copied.
+     *
+     * @param data  The message bytes
+     *
+     * @return true if initialization was successful
+     */
+    bool init(std::vector<std::byte>&& data) {
+        _data = std::move(data);
+        return true;
+    }
+
+    /**
+     * Initializes this message with a copy of the given bytes.
+     *
+     * @param data  The start of the message bytes
+     * @param size  The number of bytes
+     *
+     * @return true if initialization was successful
+     */
+    bool init(const std::byte* data, size_t size) {
+        _data.assign(data, data+size);
+        return true;
+    }
+
+    /**
+     * Returns a newly allocated message with the given bytes.
+     *
+     * The message takes ownership of the bytes, so they are not copied.
+     *
+     * @param data  The message bytes
+     *
+     * @return a newly allocated message with the given bytes.
+     */
+    static std::shared_ptr<NetcodeMessage> alloc(std::vector<std::byte>&& data) {
+        std::shared_ptr<NetcodeMessage> result = std::make_shared<NetcodeMessage>();
+        return (result->init(std::move(data)) ? result : nullptr);
+    }
+
+    /**
+     * Returns a newly allocated message with a copy of the given bytes.
+     *
+     * @param data  The message bytes
+     *
+     * @return a newly allocated message with a copy of the given bytes.
+     */
+    static std::shared_ptr<NetcodeMessage> alloc(const std::vector<std::byte>& data) {
+        std::shared_ptr<NetcodeMessage> result = std::make_shared<NetcodeMessage>();
+        return (result->init(data.data(),data.size()) ? result : nullptr);
+    }
+
+    /**
+     * Returns a newly allocated message with a copy of the given bytes.
+     *
+     * @param data  The start of the message bytes
+     * @param size  The number of bytes
+     *
+     * @return a newly allocated message with a copy of the given bytes.
+     */
+    static std::shared_ptr<NetcodeMessage> alloc(const std::byte* data, size_t size) {
+        std::shared_ptr<NetcodeMessage> result = std::make_shared<NetcodeMessage>();
+        return (result->init(data,size) ? result : nullptr);
+    }
+
+#pragma mark Accessors
+    /**
+     * Returns the start of the message bytes.
+     *
+     * @return the start of the message bytes.
+     */
+    const std::byte* data() const { return _data.data(); }
+
+    /**
+     * Returns the number of bytes in this message.
+     *
+     * @return the number of bytes in this message.
+     */
+    size_t size() const { return _data.size(); }
+
+    /**
+     * Returns the message bytes.
+     *
+     * @return the message bytes.
+     */
+    const std::vector<std::byte>& bytes() const { return _data; }
+};
+
+    }
+}
+
+#endif /* __CU_NETCODE_MESSAGE_H__ */
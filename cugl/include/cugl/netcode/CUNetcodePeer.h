@@ -266,11 +266,16 @@ private:
     /**
      * Creates a data channel with the given label
      *
-     * There can only be one data channel of any label.
+     * There can only be one data channel of any label. The channel is
+     * reliable and ordered unless another reliability is given.
+     *
+     * @param label         The data channel label
+     * @param reliability   The delivery guarantees of the data channel
      *
      * @return true if creation was successful.
      */
-    bool createChannel(const std::string label);
+    bool createChannel(const std::string label,
+                       const rtc::Reliability& reliability = rtc::Reliability());
 
     /** Allow access to the other netcode classes */
     friend class NetcodeChannel;
@@ -49,6 +49,7 @@
 #define __CU_WEBSOCKET_H__
 #include <cugl/core/CUBase.h>
 #include <cugl/netcode/CUInetAddress.h>
+#include <cugl/core/util/CURingBuffer.h>
 #include <functional>
 #include <rtc/rtc.hpp>
 
@@ -267,6 +268,10 @@ private:
     StateCallback _onStateChange;
     /** Alternatively make the dispatcher a callback */
     Dispatcher _onReceipt;
+    /** Whether a dispatcher callback is set (so {@link #receive} does nothing) */
+    std::atomic<bool> _dispatching;
+    /** Whether the per-frame dispatch task is scheduled with the application */
+    bool _pumping;
     
     /**
      * A data ring buffer for incoming messages
@@ -277,18 +282,37 @@ private:
      * it is possible to receive multiple network messages before a read. This buffer
      * stores this messages.
      *
-     * This is a classic ring buffer. It it fills up (because the application is too
-     * slow to read), then the oldest messages are deleted first.
+     * The network thread is the only producer and {@link #receive} is the only
+     * consumer, so this is a lock-free single-producer single-consumer ring.
+     * Messages are moved into and out of the ring without copying. If it fills
+     * up (because the application is too slow to read), new messages are
+     * dropped until there is room again. The exception is when a dispatcher
+     * callback is set, in which case extra messages go to {@link #_overflow}.
+     *
+     * The ring is only reallocated by {@link #open}, after the message callback
+     * of the previous socket is detached (which waits for any message still
+     * being delivered).
      */
-    std::vector<Envelope> _buffer;
-    /** The number of messages in the data ring buffer */
-    std::atomic<size_t> _buffsize;
-    /** The capacity of the data ring buffer */
+    RingBuffer<Envelope> _buffer;
+    /** The requested capacity of the data ring buffer */
     size_t _bufflimit;
-    /** The head of the data ring buffer */
-    size_t _buffhead;
-    /** The tail of the data ring buffer */
-    size_t _bufftail;
+    /** The number of messages dropped because the ring buffer was full */
+    std::atomic<Uint64> _dropped;
+    /** Whether a message was dropped since the last successful append */
+    bool _dropping;
+    /**
+     * The messages that did not fit in the ring buffer
+     *
+     * A dispatcher callback must see every message. So if the ring is full
+     * while a callback is set, messages go to this (unbounded) list instead.
+     * Once a message is in this list, all later messages follow it until the
+     * list is drained, which preserves the order.
+     */
+    std::vector<Envelope> _overflow;
+    /** Whether {@link #_overflow} has messages */
+    std::atomic<bool> _overflowing;
+    /** A mutex for the overflow list (the ring itself is lock-free) */
+    std::mutex _overflowMutex;
     
     // To prevent race conditions
     /** Whether this websocket connection prints out debugging information */
@@ -407,13 +431,43 @@ private:
      * Appends the given data to the ring buffer.
      *
      * This method is used to store an incoming message for later consumption.
+     * It is only ever called by the network thread, and takes ownership of
+     * the message data. It does not acquire any locks unless the ring is full.
+     *
+     * If the ring is full and a dispatcher callback is set, the message is
+     * added to the overflow list instead, so that no message is lost. If the
+     * ring is full and there is no callback, the message is dropped (and the
+     * first drop is logged).
      *
      * @param data      The message data
      * @param timestamp The number of microseconds since {@link NetcodeLayer#start}
      *
      * @return if the message was successfully added to the buffer.
      */
-    bool append(const std::vector<std::byte>& data, Uint64 timestamp);
+    bool append(std::vector<std::byte>&& data, Uint64 timestamp);
+    
+    /**
+     * Hands all of the buffered messages to the given dispatcher.
+     *
+     * Only the messages present at the start of this method are consumed, so
+     * a busy network cannot stall the frame. If there are messages in the
+     * overflow list, the ring is emptied and then the list is consumed.
+     *
+     * @param dispatcher    The function to process received data
+     */
+    void drain(const Dispatcher& dispatcher);
+    
+    /**
+     * Dispatches this frame's messages to the {@link #onReceipt} callback.
+     *
+     * This method is scheduled with the {@link Application} as a recurring
+     * task when the callback is set, and so it is called once per frame on
+     * the main thread. It returns false (ending the task) once the callback
+     * is removed.
+     *
+     * @return true if the task should be invoked again next frame
+     */
+    bool pump();
     
 public:
 #pragma mark Static Allocators
@@ -525,7 +579,7 @@ public:
      * It is possible for this connection to receive several messages over the
      * network before it has a chance to all {@link #receive}. This buffer
      * stores those messages to be read later. The capacity indicates the number
-     * of messages that can be stored.
+     * of messages that can be stored. It is always a power of two.
      *
      * This method is not const because it requires a lock.
      *
@@ -539,12 +593,27 @@ public:
      * It is possible for this connection to recieve several messages over the
      * network before it has a chance to all {@link #receive}. This buffer stores
      * those messages to be read later. The capacity indicates the number of
-     * messages that can be stored.
+     * messages that can be stored. It is rounded up to a power of two.
+     *
+     * The buffer is lock-free, so it cannot be resized while the network
+     * thread is writing to it. If this connection is active, the new capacity
+     * takes effect the next time it is opened.
      *
      * @param capacity  The new message buffer capacity.
      */
     void setCapacity(size_t capacity);
     
+    /**
+     * Returns the number of messages dropped because the buffer was full.
+     *
+     * Messages are only dropped when {@link #receive} is not called often
+     * enough to keep up with the network. They are never dropped while a
+     * dispatcher callback is set with {@link #onReceipt}.
+     *
+     * @return the number of messages dropped because the buffer was full.
+     */
+    Uint64 getDropped() const { return _dropped.load(); }
+    
     
 #pragma mark Communication
     /**
@@ -625,8 +694,11 @@ public:
      * frame, or even not at all.
      *
      * If a dispatcher callback has been registered with {@link #onReceipt},
-     * this method will never do anything. In that case, messages are not
-     * buffered and are processed as soon as they are received.
+     * this method will never do anything. In that case, messages are handed
+     * to that callback at the start of each animation frame.
+     *
+     * Messages are held in a buffer of {@link #getCapacity} messages between
+     * calls. If it is full, new messages are dropped (see {@link #getDropped}).
      *
      * @param dispatcher    The function to process received data
      */
@@ -637,8 +709,11 @@ public:
      * Sets a callback function to invoke on message receipt
      *
      * This callback is alternative to the method {@link #receive}. Instead of
-     * buffering messages and calling that method each frame, this callback
-     * function will be invoked as soon as the message is received.
+     * calling that method each frame, the application will call this function
+     * on every message received since the previous frame. The messages are
+     * delivered as a single batch, with no per-message scheduling. No message
+     * is ever dropped, even if more arrive in one frame than the buffer
+     * capacity (see {@link #getCapacity}).
      *
      * All callback functions are guaranteed to be called on the main thread.
      * They are called at the start of an animation frame, before the method
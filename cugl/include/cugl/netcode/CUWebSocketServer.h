@@ -48,6 +48,7 @@
 #ifndef __CU_WEBSOCKET_SERVER_H__
 #define __CU_WEBSOCKET_SERVER_H__
 #include <cugl/netcode/CUWebSocketConfig.h>
+#include <cugl/netcode/CUNetcodeMessage.h>
 #include <cugl/core/CUBase.h>
 #include <rtc/rtc.hpp>
 #include <unordered_map>
@@ -211,7 +212,7 @@ private:
          *
          * @param env the message envelope to acquire
          */
-        Envelope(Envelope&& env) {
+        Envelope(Envelope&& env) noexcept {
             timestamp = env.timestamp;
             client  = std::move(env.client);
             message = std::move(env.message);
@@ -234,7 +235,7 @@ private:
          *
          * @param env the message envelope to acquire
          */
-        Envelope& operator=(Envelope&& env) {
+        Envelope& operator=(Envelope&& env) noexcept {
             timestamp = env.timestamp;
             client  = std::move(env.client);
             message = std::move(env.message);
@@ -262,6 +263,10 @@ private:
     ConnectionCallback _onDisconnect;
     /** Alternatively make the dispatcher a callback */
     Dispatcher _onReceipt;
+    /** Whether a dispatcher callback is set (so {@link #receive} does nothing) */
+    std::atomic<bool> _dispatching;
+    /** Whether the per-frame dispatch task is scheduled with the application */
+    bool _pumping;
 
     /**
      * A data ring buffer for incoming messages
@@ -273,7 +278,10 @@ private:
      * before a read. This buffer stores this messages.
      *
      * This is a classic ring buffer. It it fills up (because the application
-     * is too slow to read), then the oldest messages are deleted first.
+     * is too slow to read), then the oldest messages are deleted first. The
+     * exception is when a dispatcher callback is set. The callback must see
+     * every message, so the buffer grows instead, and it shrinks back to its
+     * capacity once it is drained.
      */
     std::vector<Envelope> _buffer;
     /** The number of messages in the data ring buffer */
@@ -284,6 +292,16 @@ private:
     size_t _buffhead;
     /** The tail of the data ring buffer */
     size_t _bufftail;
+    /** Whether a message was dropped since the buffer was last drained */
+    bool _dropping;
+    /**
+     * The messages taken from the ring buffer for dispatch
+     *
+     * Messages are moved here (under the lock) so that they can be dispatched
+     * without holding the lock. The vector is reused so that dispatch does
+     * not allocate each frame.
+     */
+    std::vector<Envelope> _inbox;
     
     // To prevent race conditions
     /** Whether this websocket connection prints out debugging information */
@@ -412,6 +430,9 @@ private:
      * Appends the given data to the ring buffer.
      *
      * This method is used to store an incoming message for later consumption.
+     * It takes ownership of the message data. Messages are buffered even if
+     * a dispatcher callback is set, as that callback is invoked on the whole
+     * batch once per frame.
      *
      * @param client    The message client
      * @param data      The message data
@@ -419,7 +440,41 @@ private:
      *
      * @return if the message was successfully added to the buffer.
      */
-    bool append(const std::string client, const std::vector<std::byte>& data, Uint64 timestamp);
+    bool append(const std::string& client, std::vector<std::byte>&& data, Uint64 timestamp);
+    
+    /**
+     * Makes room in the ring buffer for one more message.
+     *
+     * If the ring buffer is full and a dispatcher callback is set, the buffer
+     * doubles in size, as the dispatcher must see every message. Otherwise the
+     * oldest message is dropped (and the first drop is logged).
+     *
+     * This method assumes that the lock is held.
+     */
+    void makeRoom();
+
+    /**
+     * Hands all of the buffered messages to the given dispatcher.
+     *
+     * The messages are moved out of the ring buffer while holding the lock,
+     * and are then dispatched with the lock released. If the buffer grew to
+     * hold a burst of messages, it shrinks back to its capacity.
+     *
+     * @param dispatcher    The function to process received data
+     */
+    void drain(const Dispatcher& dispatcher);
+    
+    /**
+     * Dispatches this frame's messages to the {@link #onReceipt} callback.
+     *
+     * This method is scheduled with the {@link Application} as a recurring
+     * task when the callback is set, and so it is called once per frame on
+     * the main thread. It returns false (ending the task) once the callback
+     * is removed.
+     *
+     * @return true if the task should be invoked again next frame
+     */
+    bool pump();
     
 public:
 #pragma mark Static Allocators
@@ -687,6 +742,59 @@ public:
      */
     bool broadcast(const std::vector<std::byte>& data);
 
+    /**
+     * Sends a shared message to the specified connection.
+     *
+     * This method is the same as {@link #sendTo}, except that the message is
+     * not copied before it is handed to the socket. This makes it possible
+     * to send the same encoded message to many clients with one encoding.
+     *
+     * @param dst       The identifier of the client to send to
+     * @param message   The message to send.
+     *
+     * @return true if the message was (apparently) sent
+     */
+    bool sendTo(const std::string dst, const std::shared_ptr<NetcodeMessage>& message);
+
+    /**
+     * Sends a shared message to all other connections on the given path.
+     *
+     * This method is the same as {@link #broadcast}, except that the message
+     * is not copied before it is handed to each socket.
+     *
+     * @param path      The path to broadcast to
+     * @param message   The message to send.
+     *
+     * @return true if the message was (apparently) sent
+     */
+    bool broadcast(const std::string path, const std::shared_ptr<NetcodeMessage>& message);
+
+    /**
+     * Sends a shared message to all connections.
+     *
+     * This method is the same as {@link #broadcast}, except that the message
+     * is not copied before it is handed to each socket.
+     *
+     * @param message   The message to send.
+     *
+     * @return true if the message was (apparently) sent
+     */
+    bool broadcast(const std::shared_ptr<NetcodeMessage>& message);
+
+    /**
+     * Returns the number of bytes queued to send to the specified connection.
+     *
+     * These are bytes that have been sent to the client, but that are still
+     * waiting for the network. This number grows when the client (or the
+     * network to it) cannot keep up, and so it can be used to shed load for
+     * that client. This method returns 0 if the client is not connected.
+     *
+     * @param dst   The identifier of the client
+     *
+     * @return the number of bytes queued to send to the specified connection.
+     */
+    size_t getQueuedBytes(const std::string dst);
+
     /**
      * Receives incoming network messages.
      *
@@ -699,8 +807,8 @@ public:
      * frame, or even not at all.
      *
      * If a dispatcher callback has been registered with {@link #onReceipt},
-     * this method will never do anything. In that case, messages are not
-     * buffered and are processed as soon as they are received. However, this
+     * this method will never do anything. In that case, messages are handed
+     * to that callback at the start of each animation frame. However, this
      * method has the advantage that it can be read on a separate thread.
      *
      * @param dispatcher    The function to process received data
@@ -711,9 +819,10 @@ public:
     /**
      * Sets a callback function to invoke on message receipt
      *
-     * This callback is alternative to the method {@link #receive}. Instead of 
-     * buffering messages and calling that method each frame, this callback
-     * function will be invoked as soon as the message is received.
+     * This callback is alternative to the method {@link #receive}. Instead of
+     * calling that method each frame, the application will call this function
+     * on every message received since the previous frame. The messages are
+     * delivered as a single batch, with no per-message scheduling.
      *
      * All callback functions are guaranteed to be called on the main thread. 
      * They are called at the start of an animation frame, before the method
@@ -30,14 +30,19 @@
 #ifndef __CU_NETCODE_PKG_H__
 #define __CU_NETCODE_PKG_H__
 
+#include "CUAnalyticsAggregator.h"
+#include "CUAnalyticsCodec.h"
 #include "CUAnalyticsConnection.h"
+#include "CUAnalyticsSpool.h"
 #include "CUInetAddress.h"
 #include "CUICEAddress.h"
+#include "CUJsonSerializer.h"
 #include "CUNetworkLayer.h"
 #include "CUNetcodeConfig.h"
 #include "CUNetcodeConnection.h"
 #include "CUNetcodePeer.h"
 #include "CUNetcodeChannel.h"
+#include "CUNetcodeMessage.h"
 #include "CUNetcodeSerializer.h"
 #include "CUWebSocket.h"
 #include "CUWebSocketConfig.h"
@@ -1115,7 +1115,20 @@ public:
         _hasDirtyBool = false;
         _hasDirtyFloat = false;
     }
-    
+
+    /**
+     * Returns true if any of the bits tracking the shared state are set
+     *
+     * This allows a synchronization pass to skip unchanged obstacles with a
+     * single test.
+     *
+     * @return true if any of the bits tracking the shared state are set
+     */
+    bool hasDirtySharing() const {
+        return _typeDirty || _posDirty || _velDirty || _angleDirty ||
+               _angleVelDirty || _hasDirtyBool || _hasDirtyFloat;
+    }
+
     /**
      * Returns true if the body type of this obstacle is dirty
      *
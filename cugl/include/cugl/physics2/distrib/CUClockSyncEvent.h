@@ -0,0 +1,242 @@
+//
+//  CUClockSyncEvent.h
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides an event for synchronizing game clocks between peers.
+//  It is an NTP-style ping/pong exchange, and is handled by the
+//  NetEventController internally.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Barry Lyu
+//  Version: 7/3/24 (CUGL 3.0 reorganization)
+//
+#ifndef __CU_CLOCK_SYNC_EVENT_H__
+#define __CU_CLOCK_SYNC_EVENT_H__
+
+#include <cugl/physics2/distrib/CUNetEvent.h>
+#include <cugl/core/util/CUDebug.h>
+
+namespace cugl {
+
+    /**
+     * The classes to represent 2-d physics.
+     *
+     * For 2-d physics, CUGL uses the venerable box2d. For the most part, we
+     * do not need anything more than that. However, box2d does involve a lot
+     * of boilerplate code in setting up bodies and fixtures. Students have
+     * found that they like the "training wheel" classes in this package.
+     */
+    namespace physics2 {
+
+        /**
+         * The classes to implement distributed box2d physics.
+         *
+         * This namespace represents an extension of our 2-d physics engine
+         * to support networking. This package provides automatic synchronization
+         * of physics objects across devices.
+         */
+        namespace distrib {
+
+/**
+ * This class represents a clock synchronization message between two peers.
+ *
+ * Clock synchronization follows NTP. A peer sends a ping stamped with its
+ * own game clock (the origin time). The recipient answers with a pong that
+ * echoes the origin time, together with the time it received the ping and
+ * the time it sent the pong, both in its own game clock. When the pong
+ * arrives, the four times give both the round trip time and the offset
+ * between the two game clocks.
+ *
+ * All times are game clock times in microseconds, as measured from the
+ * start of the game on each device.
+ */
+class ClockSyncEvent : public NetEvent {
+public:
+    /** Enum for the type of the event. */
+    enum class EventType : int  {
+        /** A request for the clock of the recipient */
+        PING = 0,
+        /** A response to a ping */
+        PONG = 1
+    };
+
+protected:
+    /** The type of the clock message */
+    EventType _type;
+    /** The time the ping was sent (in the clock of the pinging peer) */
+    Uint64 _origin;
+    /** The time the ping was received (in the clock of the ponging peer) */
+    Uint64 _receive;
+    /** The time the pong was sent (in the clock of the ponging peer) */
+    Uint64 _transmit;
+
+#pragma mark Constructors
+public:
+    /**
+     *  Constructs an event with default values.
+     */
+    ClockSyncEvent() : _type(EventType::PING), _origin(0), _receive(0), _transmit(0) {}
+
+    /**
+     * Returns a newly allocated event of this type.
+     *
+     * This method is used by the NetEventController to create a new event with
+     * this type as a reference.
+
+     * Note that this method is not static, unlike the alloc method present
+     * in most of CUGL. That is because we need this factory method to be
+     * polymorphic. All custom subclasses must implement this method.
+     *
+     * @return a newly allocated event of this type.
+     */
+    std::shared_ptr<NetEvent> newEvent() override {
+        return std::make_shared<ClockSyncEvent>();
+    }
+
+    /**
+     * Returns a newly allocated event of this type.
+     *
+     * This is a static version of {@link #newEvent}.
+     *
+     * @return a newly allocated event of this type.
+     */
+    static std::shared_ptr<ClockSyncEvent> alloc() {
+        return std::make_shared<ClockSyncEvent>();
+    }
+
+    /**
+     * Returns a newly allocated ping with the given origin time.
+     *
+     * @param origin    The game clock of the sender (in microseconds)
+     *
+     * @return a newly allocated ping with the given origin time.
+     */
+    static std::shared_ptr<NetEvent> allocPing(Uint64 origin) {
+        std::shared_ptr<ClockSyncEvent> ptr = std::make_shared<ClockSyncEvent>();
+        ptr->_type = EventType::PING;
+        ptr->_origin = origin;
+        return ptr;
+    }
+
+    /**
+     * Returns a newly allocated pong answering the given ping.
+     *
+     * This event is sent to the pinging peer only. It is not meant to be
+     * broadcasted.
+     *
+     * @param origin    The origin time of the ping
+     * @param receive   The game clock when the ping was received
+     * @param transmit  The game clock when this pong is sent
+     *
+     * @return a newly allocated pong answering the given ping.
+     */
+    static std::shared_ptr<NetEvent> allocPong(Uint64 origin, Uint64 receive, Uint64 transmit) {
+        std::shared_ptr<ClockSyncEvent> ptr = std::make_shared<ClockSyncEvent>();
+        ptr->_type = EventType::PONG;
+        ptr->_origin = origin;
+        ptr->_receive = receive;
+        ptr->_transmit = transmit;
+        return ptr;
+    }
+
+#pragma mark Event Attributes
+    /**
+     * Returns the event type
+     *
+     * @return the event type
+     */
+    EventType getType() const { return _type; }
+
+    /**
+     * Returns the time the ping was sent.
+     *
+     * This time is in the game clock of the pinging peer.
+     *
+     * @return the time the ping was sent.
+     */
+    Uint64 getOrigin() const { return _origin; }
+
+    /**
+     * Returns the time the ping was received.
+     *
+     * This time is in the game clock of the ponging peer. It is 0 for a ping.
+     *
+     * @return the time the ping was received.
+     */
+    Uint64 getReceive() const { return _receive; }
+
+    /**
+     * Returns the time the pong was sent.
+     *
+     * This time is in the game clock of the ponging peer. It is 0 for a ping.
+     *
+     * @return the time the pong was sent.
+     */
+    Uint64 getTransmit() const { return _transmit; }
+
+#pragma mark Serialization/Deserialization
+    /**
+     * Returns a byte vector serializing this event
+     *
+     * @return a byte vector serializing this event
+     */
+    std::vector<std::byte> serialize() override;
+
+    /**
+     * Serializes this event to the end of the given serializer.
+     *
+     * This writes the event in place, without an intermediate vector.
+     *
+     * @param out   the serializer to write to
+     */
+    void serializeTo(LWSerializer& out) override;
+
+    /**
+     * Returns true if this event was reset so that it can be reused.
+     *
+     * @return true if this event was reset so that it can be reused.
+     */
+    bool recycle() override;
+
+    /**
+     * Deserializes this event from a byte vector.
+     *
+     * This method will set the type of the event and all relevant fields.
+     */
+    void deserialize(const std::vector<std::byte>& data) override;
+
+    /**
+     * Deserializes this event from a range of bytes.
+     *
+     * This method will set the type of the event and all relevant fields.
+     * It reads the bytes in place, without copying them.
+     *
+     * @param data  the start of the serialized bytes
+     * @param size  the number of serialized bytes
+     */
+    void deserializeBytes(const std::byte* data, size_t size) override;
+
+};
+        }
+    }
+}
+
+#endif /* __CU_CLOCK_SYNC_EVENT_H__ */
@@ -207,6 +207,22 @@ public:
      */
     std::vector<std::byte> serialize() override;
     
+    /**
+     * Serializes this event to the end of the given serializer.
+     *
+     * This writes the event in place, without an intermediate vector.
+     *
+     * @param out   the serializer to write to
+     */
+    void serializeTo(LWSerializer& out) override;
+    
+    /**
+     * Returns true if this event was reset so that it can be reused.
+     *
+     * @return true if this event was reset so that it can be reused.
+     */
+    bool recycle() override;
+    
     /**
      * Deserializes this event from a byte vector.
      *
@@ -214,6 +230,17 @@ public:
      */
     void deserialize(const std::vector<std::byte>& data) override;
     
+    /**
+     * Deserializes this event from a range of bytes.
+     *
+     * This method will set the type of the event and all relevant fields.
+     * It reads the bytes in place, without copying them.
+     *
+     * @param data  the start of the serialized bytes
+     * @param size  the number of serialized bytes
+     */
+    void deserializeBytes(const std::byte* data, size_t size) override;
+    
 };
         }
     }
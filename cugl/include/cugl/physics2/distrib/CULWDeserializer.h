@@ -33,6 +33,7 @@
 #define __CU_LW_DESERIALIZER_H__
 
 #include <vector>
+#include <cstring>
 #include <SDL_stdinc.h>
 
 namespace cugl {
@@ -68,11 +69,35 @@ namespace cugl {
  */
 class LWDeserializer{
 private:
-    /** Currently loaded data */
+    /** A copy of the loaded data (if the message was not loaded as a view) */
     std::vector<std::byte> _data;
+    /** The data currently being read (either _data or an external view) */
+    const std::byte* _view;
+    /** The number of bytes in the data being read */
+    size_t _size;
     /** Position in the data of next byte to read */
     size_t _pos;
     
+    /**
+     * Returns the next value of type T from the loaded data.
+     *
+     * The method advances the read position. If there are not enough bytes
+     * remaining for the value, this method returns 0 and reads nothing.
+     *
+     * @return the next value of type T from the loaded data.
+     */
+    template <typename T>
+    T readValue() {
+        if (_pos+sizeof(T) > _size) {
+            _pos = _size;
+            return T(0);
+        }
+        T value;
+        std::memcpy(&value, _view+_pos, sizeof(T));
+        _pos += sizeof(T);
+        return marshall(value);
+    }
+    
 public:
     /**
      * Creates a new Deserializer on the stack.
@@ -81,7 +106,7 @@ public:
      * to use an init method. However, we do include a static {@link #alloc}
      * method for creating shared pointers.
      */
-    LWDeserializer() : _pos(0) {}
+    LWDeserializer() : _view(nullptr), _size(0), _pos(0) {}
     
     /**
      * Returns a newly allocated LWDeserializer.
@@ -109,9 +134,43 @@ public:
      */
     void receive(const std::vector<std::byte>& msg){
         _data = msg;
+        _view = _data.data();
+        _size = _data.size();
         _pos = 0;
     }
     
+    /**
+     * Loads a new message to be read, without copying it.
+     *
+     * This version of receive reads the bytes in place. It is useful for
+     * reading a slice of a larger message, such as a single event inside of
+     * a batched frame. The bytes must remain valid (and unmodified) until
+     * the message is reset or another message is loaded.
+     *
+     * @param data  The start of the bytes serialized by {@link LWSerializer}
+     * @param size  The number of bytes to read
+     */
+    void receive(const std::byte* data, size_t size){
+        _data.clear();
+        _view = data;
+        _size = size;
+        _pos = 0;
+    }
+    
+    /**
+     * Returns true if there is still data to read.
+     *
+     * @return true if there is still data to read.
+     */
+    bool available() const { return _pos < _size; }
+    
+    /**
+     * Returns the number of bytes read so far.
+     *
+     * @return the number of bytes read so far.
+     */
+    size_t position() const { return _pos; }
+    
     /**
      * Returns a boolean read from the loaded byte vector.
      *
@@ -121,10 +180,10 @@ public:
      * @return a boolean read from the loaded byte vector.
      */
     bool readBool(){
-        if (_pos >= _data.size()) {
+        if (_pos >= _size) {
             return false;
         }
-        uint8_t value = static_cast<uint8_t>(_data[_pos++]);
+        uint8_t value = static_cast<uint8_t>(_view[_pos++]);
         return value == 1;
     }
     
@@ -137,11 +196,10 @@ public:
      * @return a byte from the loaded byte vector.
      */
     std::byte readByte(){
-        if (_pos >= _data.size()) {
+        if (_pos >= _size) {
             return std::byte(0);
         }
-        const std::byte b = _data[_pos++];
-        return b;
+        return _view[_pos++];
     }
     
     /**
@@ -153,12 +211,7 @@ public:
      * @return a float from the loaded byte vector.
      */
     float readFloat(){
-        if (_pos >= _data.size()) {
-            return 0.0f;
-        }
-        const float* r = reinterpret_cast<const float*>(_data.data() + _pos);
-        _pos += sizeof(float);
-        return marshall(*r);
+        return readValue<float>();
     }
     
     /**
@@ -170,12 +223,7 @@ public:
      * @return a signed (32 bit) int from the loaded byte vector.
      */
     Sint32 readSint32(){
-        if (_pos >= _data.size()) {
-            return 0;
-        }
-        const Sint32* r = reinterpret_cast<const Sint32*>(_data.data() + _pos);
-        _pos += sizeof(Sint32);
-        return marshall(*r);
+        return readValue<Sint32>();
     }
     
     /**
@@ -187,12 +235,7 @@ public:
      * @return an unsigned short from the loaded byte vector.
      */
     Uint16 readUint16(){
-        if (_pos >= _data.size()) {
-            return 0;
-        }
-        const Uint16* r = reinterpret_cast<const Uint16*>(_data.data() + _pos);
-        _pos += sizeof(Uint16);
-        return marshall(*r);
+        return readValue<Uint16>();
     }
     
     /**
@@ -204,12 +247,7 @@ public:
      * @return an unsigned (32 bit) int from the loaded byte vector.
      */
     Uint32 readUint32(){
-        if (_pos >= _data.size()) {
-            return 0;
-        }
-        const Uint32* r = reinterpret_cast<const Uint32*>(_data.data() + _pos);
-        _pos += sizeof(Uint32);
-        return marshall(*r);
+        return readValue<Uint32>();
     }
     
     /**
@@ -221,12 +259,32 @@ public:
      * @return an unsigned (64 bit) long from the loaded byte vector.
      */
     Uint64 readUint64(){
-        if (_pos >= _data.size()) {
-            return 0;
+        return readValue<Uint64>();
+    }
+    
+    /**
+     * Returns an unsigned varint from the loaded byte vector.
+     *
+     * Varints use seven bits per byte (least significant group first), with
+     * the high bit set on every byte but the last. This is the counterpart
+     * of {@link LWSerializer#writeVarint}. If the data ends before the varint
+     * is complete, this method returns 0.
+     *
+     * @return an unsigned varint from the loaded byte vector.
+     */
+    Uint64 readVarint(){
+        Uint64 result = 0;
+        for(int shift = 0; shift < 64; shift += 7) {
+            if (_pos >= _size) {
+                return 0;
+            }
+            Uint8 b = (Uint8)_view[_pos++];
+            result |= ((Uint64)(b & 0x7f)) << shift;
+            if ((b & 0x80) == 0) {
+                return result;
+            }
         }
-        const Uint64* r = reinterpret_cast<const Uint64*>(_data.data() + _pos);
-        _pos += sizeof(Uint64);
-        return marshall(*r);
+        return result;
     }
     
     /**
@@ -234,6 +292,8 @@ public:
      */
     void reset(){
         _pos = 0;
+        _size = 0;
+        _view = nullptr;
         _data.clear();
     }
     
@@ -198,6 +198,26 @@ public:
         }
     }
     
+    /**
+     * Writes an unsigned varint to the buffer.
+     *
+     * Varints use seven bits per byte (least significant group first), with
+     * the high bit set on every byte but the last. Values less than 128 take
+     * a single byte, which makes this ideal for lengths and small counts.
+     *
+     * Values will be deserialized on other machines in the same order they were
+     * written in.
+     *
+     * @param i the unsigned value to write
+     */
+    void writeVarint(Uint64 i){
+        while (i >= 0x80) {
+            _data.push_back(std::byte((i & 0x7f) | 0x80));
+            i >>= 7;
+        }
+        _data.push_back(std::byte(i));
+    }
+    
     /**
      * Writes a byte vector to the buffer.
      *
@@ -236,6 +256,15 @@ public:
         return _data;
     }
     
+    /**
+     * Returns the number of bytes written so far.
+     *
+     * @return the number of bytes written so far.
+     */
+    size_t size() const {
+        return _data.size();
+    }
+    
     /**
      * Clears the input buffer.
      *
@@ -97,7 +97,7 @@ private:
      * @param receiveTimeStamp  the timestamp when the event was received
      * @param sourceID          the ID of the sender
      */
-    void setMetaData(Uint64 eventTimeStamp, Uint64 receiveTimeStamp, const std::string sourceID) {
+    void setMetaData(Uint64 eventTimeStamp, Uint64 receiveTimeStamp, const std::string& sourceID) {
         _eventTimeStamp = eventTimeStamp;
         _receiveTimeStamp = receiveTimeStamp;
         _sourceID = sourceID;
@@ -130,6 +130,23 @@ public:
     virtual std::vector<std::byte> serialize() {
         return std::vector<std::byte>();
     }
+    
+    /**
+     * Serializes this event to the end of the given serializer.
+     *
+     * This is the method called by {@link NetEventController}, as outgoing
+     * events are written in place into a larger (batched) network frame.
+     *
+     * The default implementation calls {@link #serialize} and appends the
+     * result, so custom events only need to implement that method. Events
+     * that are sent frequently should override this method instead to avoid
+     * the intermediate vector.
+     *
+     * @param out   the serializer to write to
+     */
+    virtual void serializeTo(LWSerializer& out) {
+        out.writeByteVector(serialize());
+    }
     /**
      * Deserializes a vector of bytes and set the corresponding parameters.
      *
@@ -141,6 +158,41 @@ public:
      */
     virtual void deserialize(const std::vector<std::byte>& data) { }
     
+    /**
+     * Deserializes a range of bytes and set the corresponding parameters.
+     *
+     * This is the method called by {@link NetEventController}, as incoming
+     * events are read in place from a larger (batched) network frame. The
+     * bytes are only valid for the duration of this call.
+     *
+     * The default implementation copies the bytes into a vector and calls
+     * {@link #deserialize}, so custom events only need to implement that
+     * method. Events that are sent frequently should override this method
+     * instead to avoid the copy.
+     *
+     * @param data  the start of the serialized bytes
+     * @param size  the number of serialized bytes
+     */
+    virtual void deserializeBytes(const std::byte* data, size_t size) {
+        deserialize(std::vector<std::byte>(data, data+size));
+    }
+    
+    /**
+     * Returns true if this event was reset so that it can be reused.
+     *
+     * The {@link NetEventController} keeps a pool of events for each type,
+     * and reuses an event once no one else holds a reference to it. Before
+     * reuse, this method is called to clear any state that deserialization
+     * does not overwrite (such as lists that are appended to).
+     *
+     * The default implementation returns false, which means that events of
+     * this type are never pooled. Custom events may override this method to
+     * opt into pooling.
+     *
+     * @return true if this event was reset so that it can be reused.
+     */
+    virtual bool recycle() { return false; }
+    
     /**
      * Returns the timestamp of the event set by the sender.
      *
@@ -166,7 +218,7 @@ public:
      *
      * @return the ID of the sender.
      */
-    const std::string getSourceId() const { return _sourceID; }
+    const std::string& getSourceId() const { return _sourceID; }
 };
 
         }
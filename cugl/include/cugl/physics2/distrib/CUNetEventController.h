@@ -49,6 +49,8 @@
 // TODO: Some of these can be removed with forward declarations
 #include <cugl/physics2/distrib/CUNetWorld.h>
 #include <cugl/physics2/distrib/CUNetEvent.h>
+#include <cugl/physics2/distrib/CUNetEventPool.h>
+#include <cugl/physics2/distrib/CUClockSyncEvent.h>
 #include <cugl/physics2/distrib/CUNetPhysicsController.h>
 #include <cugl/core/assets/CUAssetManager.h>
 #include <cugl/physics2/CUObstacle.h>
@@ -60,6 +62,7 @@
 #include <typeindex>
 #include <vector>
 #include <queue>
+#include <deque>
 #include <memory>
 
 namespace cugl {
@@ -105,9 +108,16 @@ namespace cugl {
  * created to handle physics synchronization. For fine-tuning and more info,
  * see {@link NetPhysicsController}.
  *
- * There are three built-in event types: {@link GameStateEvent},
- * {@link PhysSyncEvent}, and {@link PhysObstEvent}. See the {@link NetEvent}
- * class and {@link #attachEventType} for how to add and setup custom events.
+ * Once the game starts, peers periodically exchange {@link ClockSyncEvent}
+ * pings to estimate the offset between their game clocks, the round trip
+ * time and the network jitter (see {@link #getClockOffset}). These estimates
+ * drive an optional jitter buffer for physics synchronization events (see
+ * {@link #setJitterBuffered}).
+ *
+ * There are four built-in event types: {@link GameStateEvent},
+ * {@link ClockSyncEvent}, {@link PhysSyncEvent}, and {@link PhysObstEvent}.
+ * See the {@link NetEvent} class and {@link #attachEventType} for how to add
+ * and setup custom events.
  */
 class NetEventController {
 public:
@@ -130,8 +140,64 @@ public:
     };
     
 protected:
+    /**
+     * The clock synchronization state for a single peer.
+     *
+     * The clock offset is estimated NTP-style, by picking the sample with the
+     * smallest round trip among the most recent pings. The jitter is the
+     * interarrival jitter of RFC 3550, and the playout delay is the smoothed
+     * one-way delay plus a multiple of the jitter.
+     *
+     * The transit times are measured against the sender timestamp without
+     * the offset correction. That way a new offset estimate does not disturb
+     * the playout schedule; the offset is only needed to report the actual
+     * one-way delay.
+     *
+     * All times are in microseconds.
+     */
+    class PeerClock {
+    public:
+        /** The recent (offset, round trip) samples, oldest first */
+        std::deque<std::pair<Sint64,Sint64>> samples;
+        /** The estimated offset of the peer game clock from ours */
+        Sint64 offset;
+        /** The smoothed round trip time */
+        double rtt;
+        /** The interarrival jitter */
+        double jitter;
+        /** The smoothed transit time of received messages */
+        double delay;
+        /** The transit time of the last received message */
+        Sint64 transit;
+        /** Whether a message has been received from this peer */
+        bool received;
+        /** The number of synchronization events dropped for being late */
+        Uint64 lateDrops;
+        /** The timestamp of the last released synchronization event */
+        Uint64 played;
+        /** Whether a synchronization event has been released */
+        bool hasPlayed;
+        /** The buffered synchronization events with their playout times */
+        std::deque<std::pair<Uint64,std::shared_ptr<PhysSyncEvent>>> pending;
+
+        /**
+         * Creates a clock with no samples.
+         */
+        PeerClock() : offset(0), rtt(0), jitter(0), delay(0), transit(0),
+        received(false), lateDrops(0), played(0), hasPlayed(false) {}
+
+        /**
+         * Returns the current playout delay.
+         *
+         * @return the current playout delay.
+         */
+        Uint64 getPlayoutDelay() const;
+    };
+
     /** The App fixed-time stamp when the game starts */
     Uint64 _startGameTimeStamp;
+    /** The App time (in microseconds) when the game starts */
+    Uint64 _startGameMicros;
     
     /** The network configuration */
     cugl::netcode::NetcodeConfig _config;
@@ -151,6 +217,8 @@ protected:
     std::unordered_map<std::type_index, Uint8> _eventTypeMap;
     /** Vector of NetEvents instances for constructing new events */
     std::vector<std::shared_ptr<NetEvent>> _newEventVector;
+    /** The pools of recycled inbound events, one for each event type */
+    std::vector<NetEventPool<NetEvent>> _eventPools;
     
     /** Queue for all received custom events. Preserved across updates.*/
     std::queue<std::shared_ptr<NetEvent>> _inEventQueue;
@@ -159,12 +227,40 @@ protected:
     /** Queue for all outbound events. Cleared every update */
     std::vector<std::shared_ptr<NetEvent>> _outEventQueue;
     
+    /** Whether to pack all outbound events of a tick into shared frames */
+    bool _batching;
+    /** The target maximum size (in bytes) of a batched frame */
+    size_t _frameLimit;
+    /** The serializer for building batched frames (reused each tick) */
+    LWSerializer _frame;
+    /** The serializer for a single outbound event (reused each tick) */
+    LWSerializer _payload;
+    /** The events unwrapped from a single message (reused each tick) */
+    std::vector<std::shared_ptr<NetEvent>> _unwrapped;
+    
     /** Short user id assigned by the host during session */
     Uint32 _shortUID;
     /** Whether physics is enabled. */
     bool _physEnabled;
     /** The physics synchronization controller */
     std::shared_ptr<NetPhysicsController> _physController;
+    /** The type of physics synchronization to perform each tick */
+    NetPhysicsController::SyncType _syncType;
+    /** The channel class for physics synchronization events */
+    netcode::NetcodeConfig::ChannelClass _syncChannel;
+    /** The queued bytes above which a peer is skipped for synchronization */
+    size_t _syncQueueLimit;
+    /** The number of synchronization frames skipped for slow peers */
+    Uint64 _shedFrames;
+    
+    /** The clock synchronization state of each peer */
+    std::unordered_map<std::string, PeerClock> _clocks;
+    /** The number of game ticks between clock pings */
+    Uint32 _clockInterval;
+    /** The game tick of the next clock ping */
+    Uint64 _nextPing;
+    /** Whether synchronization events go through the jitter buffer */
+    bool _jitterBuffered;
     
     /*
      * =================== Note for clarification ===================
@@ -174,17 +270,40 @@ protected:
     
 #pragma mark Networking Internals
     /**
-     * Unwraps the a byte vector data into a NetEvent.
+     * Unwraps the a byte vector data into one or more NetEvents.
      *
-     * The controller automatically detects the type of event, spawns a new
+     * The message may either be a single wrapped event, or a batched frame
+     * of several events (see {@link #setBatching}). For each event, the
+     * controller automatically detects the type of event, spawns a new
      * empty instance of that event, and calls the event's
-     * {@link NetEvent#deserialize} method. This method is only called on
-     * outbound events.
+     * {@link NetEvent#deserializeBytes} method on the bytes in place. This
+     * method is only called on inbound events.
      *
      * @param data      The message received
      * @param source    The UUID of the sender
+     * @param events    The vector to append the events to
      */
-    std::shared_ptr<NetEvent> unwrap(const std::vector<std::byte>& data,std::string source);
+    void unwrap(const std::vector<std::byte>& data, const std::string& source,
+                std::vector<std::shared_ptr<NetEvent>>& events);
+    
+    /**
+     * Returns a NetEvent for the given serialized bytes.
+     *
+     * The bytes are read in place and are not copied. The event is taken
+     * from the pool for its type, so it is only allocated if every pooled
+     * event of that type is still in use.
+     *
+     * @param type      The event type id
+     * @param stamp     The timestamp of the event from the sender
+     * @param data      The start of the serialized event
+     * @param size      The number of serialized bytes
+     * @param source    The UUID of the sender
+     *
+     * @return a NetEvent for the given serialized bytes.
+     */
+    std::shared_ptr<NetEvent> unwrapEvent(Uint8 type, Uint64 stamp,
+                                          const std::byte* data, size_t size,
+                                          const std::string& source);
     
     /**
      * Wraps a NetEvent into a byte vector.
@@ -215,6 +334,60 @@ protected:
      */
     void processReceivedEvent(const std::shared_ptr<NetEvent>& e);
     
+    /**
+     * Processes a ClockSyncEvent.
+     *
+     * This method answers pings and updates the clock offset and round trip
+     * estimates from pongs. If physics is enabled, the new offset is passed
+     * on to the physics controller (see {@link NetPhysicsController#setClockOffset}).
+     *
+     * @param e The received event
+     */
+    void processClockSyncEvent(const std::shared_ptr<ClockSyncEvent>& e);
+    
+    /**
+     * Updates the delay and jitter estimates for a received message.
+     *
+     * @param source    The UUID of the sender
+     * @param stamp     The timestamp of the message from the sender
+     */
+    void updateTransit(const std::string& source, Uint64 stamp);
+    
+    /**
+     * Adds a synchronization event to the jitter buffer of its sender.
+     *
+     * The event is dropped (as late) if a more recent event from the same
+     * sender has already been released.
+     *
+     * @param e The received event
+     */
+    void bufferSyncEvent(const std::shared_ptr<PhysSyncEvent>& e);
+    
+    /**
+     * Releases all buffered synchronization events whose playout time has
+     * passed to the physics controller.
+     */
+    void releaseSyncEvents();
+    
+    /**
+     * Broadcasts a clock ping if the ping interval has passed.
+     */
+    void pingClocks();
+    
+    /**
+     * Returns true if the source is a remote peer.
+     *
+     * Broadcast messages are also delivered back to the sender. Those
+     * messages should not affect the clock estimates.
+     *
+     * @param source    The UUID of the sender
+     *
+     * @return true if the source is a remote peer.
+     */
+    bool isRemote(const std::string& source) const {
+        return !source.empty() && source != _network->getUUID();
+    }
+    
     /**
      * Processes a GameStateEvent.
      *
@@ -235,9 +408,47 @@ protected:
     
     /**
      * Broadcasts all queued outbound events.
+     *
+     * If batching is enabled, the events are packed into as few frames as
+     * possible, each of which is no larger than {@link #getFrameLimit} (unless
+     * a single event is larger than that). Otherwise each event is sent as its
+     * own message.
      */
     void sendQueuedOutData();
     
+    /**
+     * Broadcasts the current batched frame (if it has any events).
+     *
+     * @param header    The size of the frame header
+     * @param cls       The channel class to broadcast on
+     * @param sync      Whether the frame only has synchronization events
+     */
+    void flushFrame(size_t header, netcode::NetcodeConfig::ChannelClass cls, bool sync);
+    
+    /**
+     * Broadcasts a message of synchronization events.
+     *
+     * If there is a synchronization queue limit, the message is encoded
+     * once and sent to each peer whose send queue is within the limit. All
+     * other peers are skipped. Otherwise, the message is simply broadcast.
+     *
+     * @param data  The message to send
+     * @param cls   The channel class to send on
+     */
+    void sendSync(const std::vector<std::byte>& data, netcode::NetcodeConfig::ChannelClass cls);
+    
+    /**
+     * Returns true if synchronization events are sent in their own frames.
+     *
+     * This is the case if they have their own channel class, or if they may
+     * be skipped for slow peers.
+     *
+     * @return true if synchronization events are sent in their own frames.
+     */
+    bool isSyncSplit() const {
+        return _syncChannel != netcode::NetcodeConfig::ChannelClass::RELIABLE || _syncQueueLimit > 0;
+    }
+    
     /**
      * Returns the type id of a NetEvent.
      *
@@ -445,6 +656,252 @@ public:
      */
     void disablePhysics();
     
+    /**
+     * Returns the type of physics synchronization performed each tick.
+     *
+     * By default, this is {@link NetPhysicsController::SyncType#FULL_SYNC},
+     * which sends every owned obstacle that has changed.
+     *
+     * @return the type of physics synchronization performed each tick.
+     */
+    NetPhysicsController::SyncType getSyncType() const { return _syncType; }
+    
+    /**
+     * Sets the type of physics synchronization performed each tick.
+     *
+     * Use {@link NetPhysicsController::SyncType#PRIO_SYNC} to only send the
+     * obstacles of highest priority within a byte budget. This can be tuned
+     * per peer with {@link #setPeerInterest} and {@link #setPeerSyncBudget}.
+     *
+     * @param type  The type of physics synchronization performed each tick
+     */
+    void setSyncType(NetPhysicsController::SyncType type) { _syncType = type; }
+    
+    /**
+     * Returns the channel class for physics synchronization events.
+     *
+     * By default, this is {@link netcode::NetcodeConfig::ChannelClass#RELIABLE},
+     * which sends synchronization events with all other events.
+     *
+     * @return the channel class for physics synchronization events.
+     */
+    netcode::NetcodeConfig::ChannelClass getSyncChannel() const { return _syncChannel; }
+    
+    /**
+     * Sets the channel class for physics synchronization events.
+     *
+     * Synchronization events are superseded by the next one, so there is
+     * no need to retransmit them when they are lost. Sending them on an
+     * unreliable channel keeps a lost packet from stalling every event
+     * behind it. All other events are still sent reliably. The channel class
+     * must be listed in the {@link netcode::NetcodeConfig#channels} of every
+     * player; otherwise the reliable channel is used for that player.
+     *
+     * As deltas cannot be decoded if a snapshot is lost, any class other
+     * than the reliable one encodes snapshots as absolute values (see
+     * {@link NetPhysicsController#setAbsoluteSync}).
+     *
+     * @param cls   The channel class for physics synchronization events
+     */
+    void setSyncChannel(netcode::NetcodeConfig::ChannelClass cls);
+    
+    /**
+     * Returns the queued bytes above which a peer is skipped for synchronization.
+     *
+     * If this value is 0 (the default), synchronization events are always
+     * sent to every peer. See {@link #setSyncQueueLimit}.
+     *
+     * @return the queued bytes above which a peer is skipped for synchronization.
+     */
+    size_t getSyncQueueLimit() const { return _syncQueueLimit; }
+    
+    /**
+     * Sets the queued bytes above which a peer is skipped for synchronization.
+     *
+     * When a peer falls behind, the data sent to it piles up in its send
+     * queue (see {@link netcode::NetcodeConnection#getQueuedBytes}). As every
+     * synchronization event is superseded by the next, there is no point in
+     * adding more of them to that queue. With a limit, synchronization frames
+     * are skipped for any peer with more than this many bytes queued, until
+     * its queue drains. All other events are still sent to every peer.
+     *
+     * As skipped snapshots break delta encoding, a non-zero limit encodes
+     * snapshots as absolute values (see
+     * {@link NetPhysicsController#setAbsoluteSync}).
+     *
+     * @param limit The queued bytes above which a peer is skipped (0 for none)
+     */
+    void setSyncQueueLimit(size_t limit);
+    
+    /**
+     * Returns the number of synchronization frames skipped for slow peers.
+     *
+     * Each frame skipped for each peer is counted separately. This value is
+     * always 0 if there is no synchronization queue limit.
+     *
+     * @return the number of synchronization frames skipped for slow peers.
+     */
+    Uint64 getShedFrames() const { return _shedFrames; }
+    
+    /**
+     * Sets the area of interest for the given peer.
+     *
+     * Priority synchronization favors obstacles near the area of interest of
+     * some peer, such as the region around its avatar. This setting has no
+     * effect on other synchronization types. Physics must be enabled.
+     *
+     * @param peer      The peer UUID
+     * @param center    The center of the area of interest
+     * @param radius    The radius of the area of interest
+     */
+    void setPeerInterest(const std::string& peer, const Vec2& center, float radius);
+    
+    /**
+     * Sets the physics synchronization byte budget for the given peer.
+     *
+     * Priority synchronization sends at most this many bytes of obstacle
+     * snapshots per tick. As snapshots are broadcast, the smallest budget
+     * among all peers applies. This setting has no effect on other
+     * synchronization types. Physics must be enabled.
+     *
+     * @param peer      The peer UUID
+     * @param budget    The maximum bytes per tick (0 for no limit)
+     */
+    void setPeerSyncBudget(const std::string& peer, size_t budget);
+    
+#pragma mark Clock Synchronization
+    /**
+     * Returns the game clock in microseconds.
+     *
+     * This is the time since the game started on this device. Unlike
+     * {@link #getGameTick}, it is not quantized to the simulation timestep.
+     * It is the clock used for all clock synchronization estimates.
+     *
+     * @return the game clock in microseconds.
+     */
+    Uint64 getGameMicros() const;
+    
+    /**
+     * Returns the number of game ticks between clock pings.
+     *
+     * Each ping updates the clock offset and round trip estimates of every
+     * peer. The default is one ping a second at 60 ticks per second.
+     *
+     * @return the number of game ticks between clock pings.
+     */
+    Uint32 getClockInterval() const { return _clockInterval; }
+    
+    /**
+     * Sets the number of game ticks between clock pings.
+     *
+     * Each ping updates the clock offset and round trip estimates of every
+     * peer. The default is one ping a second at 60 ticks per second. A value
+     * of 0 disables clock pings.
+     *
+     * @param ticks The number of game ticks between clock pings
+     */
+    void setClockInterval(Uint32 ticks) { _clockInterval = ticks; }
+    
+    /**
+     * Returns the offset of the peer game clock from this one.
+     *
+     * The value is in microseconds, and is positive if the game started
+     * earlier on the peer (so its clock is ahead). Adding the offset to
+     * {@link #getGameMicros} gives the current game clock of the peer. The
+     * value is 0 until the first pong is received from that peer.
+     *
+     * @param peer  The peer UUID
+     *
+     * @return the offset of the peer game clock from this one.
+     */
+    Sint64 getClockOffset(const std::string& peer) const;
+    
+    /**
+     * Returns the smoothed round trip time to the given peer.
+     *
+     * The value is in microseconds, and does not include the time the peer
+     * took to answer the ping. It is 0 until the first pong is received from
+     * that peer.
+     *
+     * @param peer  The peer UUID
+     *
+     * @return the smoothed round trip time to the given peer.
+     */
+    Uint64 getRoundTripTime(const std::string& peer) const;
+    
+    /**
+     * Returns the network jitter of messages from the given peer.
+     *
+     * The value is in microseconds. It is the interarrival jitter of RFC 3550,
+     * a smoothed average of the variation in one-way delay between messages.
+     *
+     * @param peer  The peer UUID
+     *
+     * @return the network jitter of messages from the given peer.
+     */
+    Uint64 getJitter(const std::string& peer) const;
+    
+    /**
+     * Returns the playout delay of the jitter buffer for the given peer.
+     *
+     * The value is in microseconds. It is the smoothed one-way delay of
+     * messages from that peer plus four times the jitter, so that nearly all
+     * messages arrive before they are played out. It adapts as the network
+     * conditions change.
+     *
+     * @param peer  The peer UUID
+     *
+     * @return the playout delay of the jitter buffer for the given peer.
+     */
+    Uint64 getPlayoutDelay(const std::string& peer) const;
+    
+    /**
+     * Returns the number of synchronization events from the peer dropped as late.
+     *
+     * An event is late if it arrives after a more recent event from the same
+     * peer has been released by the jitter buffer. This value is always 0 if
+     * the jitter buffer is disabled.
+     *
+     * @param peer  The peer UUID
+     *
+     * @return the number of synchronization events from the peer dropped as late.
+     */
+    Uint64 getLateDrops(const std::string& peer) const;
+    
+    /**
+     * Returns true if physics synchronization events are jitter buffered.
+     *
+     * When jitter buffering is enabled, synchronization events are not
+     * applied as soon as they arrive. Instead, each event is held until its
+     * send time (translated to the local game clock) plus the playout delay
+     * (see {@link #getPlayoutDelay}). This releases snapshots at a steady
+     * pace despite variations in network delay, at the cost of a little
+     * latency. Events that arrive after a more recent one was released are
+     * dropped.
+     *
+     * Jitter buffering is disabled by default.
+     *
+     * @return true if physics synchronization events are jitter buffered.
+     */
+    bool isJitterBuffered() const { return _jitterBuffered; }
+    
+    /**
+     * Sets whether physics synchronization events are jitter buffered.
+     *
+     * When jitter buffering is enabled, synchronization events are not
+     * applied as soon as they arrive. Instead, each event is held until its
+     * send time (translated to the local game clock) plus the playout delay
+     * (see {@link #getPlayoutDelay}). This releases snapshots at a steady
+     * pace despite variations in network delay, at the cost of a little
+     * latency. Events that arrive after a more recent one was released are
+     * dropped.
+     *
+     * Jitter buffering is disabled by default.
+     *
+     * @param value Whether physics synchronization events are jitter buffered
+     */
+    void setJitterBuffered(bool value);
+    
 #pragma mark Event Management
     /**
      * Attaches a new NetEvent type to the controller.
@@ -457,8 +914,11 @@ public:
     template <typename T>
     void attachEventType() {
         if (!_eventTypeMap.count(std::type_index(typeid(T)))) {
+            // The last type id is reserved for batched frames
+            CUAssertLog(_newEventVector.size() < 0xFF, "Too many event types attached");
             _eventTypeMap.insert(std::make_pair(std::type_index(typeid(T)), _newEventVector.size()));
             _newEventVector.push_back(std::make_shared<T>());
+            _eventPools.emplace_back();
         }
     }
     
@@ -493,6 +953,74 @@ public:
      */
     void pushOutEvent(const std::shared_ptr<NetEvent>& e);
     
+    /**
+     * Returns true if outbound events are batched into shared frames.
+     *
+     * When batching is enabled, all of the events sent in a single call to
+     * {@link #updateNet} are packed into one (or a few) frames. A frame has a
+     * single timestamp, and each event only adds a type byte and a compact
+     * length to its payload. This is much cheaper than sending each event as
+     * a separate message when physics synchronization produces many events
+     * per tick. Inbound messages are understood in either format.
+     *
+     * Batching is enabled by default.
+     *
+     * @return true if outbound events are batched into shared frames.
+     */
+    bool isBatching() const { return _batching; }
+    
+    /**
+     * Sets whether outbound events are batched into shared frames.
+     *
+     * When batching is enabled, all of the events sent in a single call to
+     * {@link #updateNet} are packed into one (or a few) frames. A frame has a
+     * single timestamp, and each event only adds a type byte and a compact
+     * length to its payload. This is much cheaper than sending each event as
+     * a separate message when physics synchronization produces many events
+     * per tick. Inbound messages are understood in either format.
+     *
+     * Batching is enabled by default.
+     *
+     * @param value Whether outbound events are batched into shared frames.
+     */
+    void setBatching(bool value) { _batching = value; }
+    
+    /**
+     * Returns the target maximum size (in bytes) of a batched frame.
+     *
+     * When the events of a tick do not fit in a single frame, they are split
+     * across several frames. The default is chosen to fit in a single network
+     * packet. A single event that exceeds this limit is sent in its own frame.
+     *
+     * @return the target maximum size (in bytes) of a batched frame.
+     */
+    size_t getFrameLimit() const { return _frameLimit; }
+    
+    /**
+     * Sets the target maximum size (in bytes) of a batched frame.
+     *
+     * When the events of a tick do not fit in a single frame, they are split
+     * across several frames. The default is chosen to fit in a single network
+     * packet. A single event that exceeds this limit is sent in its own frame.
+     *
+     * @param limit The target maximum size (in bytes) of a batched frame.
+     */
+    void setFrameLimit(size_t limit) { _frameLimit = limit; }
+    
+    /**
+     * Returns the number of events allocated by the network pipeline.
+     *
+     * This includes inbound events of every type, and the physics events
+     * generated by the physics controller (if physics is enabled). Events are
+     * recycled once no one holds a reference to them, so this number stops
+     * growing once the pools cover the events in flight. A count that keeps
+     * growing in a steady-state game means that events are being leaked (or
+     * held onto) somewhere.
+     *
+     * @return the number of events allocated by the network pipeline.
+     */
+    Uint64 getEventAllocations() const;
+    
     /**
      * Updates the network controller.
      *
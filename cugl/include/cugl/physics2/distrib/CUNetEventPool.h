@@ -0,0 +1,250 @@
+//
+//  CUNetEventPool.h
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides a pool for recycling network events. Events are sent
+//  and received every tick, and allocating a new shared pointer for each one
+//  puts the heap on the critical path of networking. With a pool, steady-state
+//  networking reuses the same event objects over and over.
+//
+//  This is not a class. It is a class template. Templates do not have cpp
+//  files. They only have a header file.  When you include the header, it
+//  compiles the specific template used by your program. Hence all of the code
+//  for this templated class is in this header.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Barry Lyu
+//  Version: 7/3/24 (CUGL 3.0 reorganization)
+//
+#ifndef __CU_NET_EVENT_POOL_H__
+#define __CU_NET_EVENT_POOL_H__
+#include <SDL_stdinc.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace cugl {
+
+    /**
+     * The classes to represent 2-d physics.
+     *
+     * For 2-d physics, CUGL uses the venerable box2d. For the most part, we
+     * do not need anything more than that. However, box2d does involve a lot
+     * of boilerplate code in setting up bodies and fixtures. Students have
+     * found that they like the "training wheel" classes in this package.
+     */
+    namespace physics2 {
+
+        /**
+         * The classes to implement distributed box2d physics.
+         *
+         * This namespace represents an extension of our 2-d physics engine
+         * to support networking. This package provides automatic synchronization
+         * of physics objects across devices.
+         */
+        namespace distrib {
+
+/** The number of pooled events that acquire checks before allocating */
+#define NET_EVENT_POOL_PROBES   8
+/** The minimum number of free events that a trim keeps */
+#define NET_EVENT_POOL_MINIMUM  16
+/** The default maximum number of pooled events */
+#define NET_EVENT_POOL_CAPACITY 1024
+
+/**
+ * This is a template for a pool of recyclable network events.
+ *
+ * The pool keeps a shared pointer to every event it has handed out. An
+ * event is free again once the pool holds the only reference to it, and
+ * the event agrees to be recycled (see {@link NetEvent#recycle}). Events
+ * that refuse to be recycled are never pooled, so custom events that do not
+ * support recycling are simply allocated as before.
+ *
+ * The pool cannot be told when an event is released, so it looks for free
+ * events with a cursor that cycles through the pool. Events are usually
+ * released in the order they were acquired, so the event at the cursor is
+ * almost always free. To keep {@link #acquire} constant time, it only checks
+ * a few events (NET_EVENT_POOL_PROBES) before it allocates a new one.
+ *
+ * The pool never holds more than its capacity. In addition, every time the
+ * cursor wraps around, the pool counts the events still in use and releases
+ * free events beyond twice that number. This is a linear pass, but it only
+ * happens once every {@link #size} acquires. So the pool shrinks back after
+ * a burst, and the cost of each acquire stays constant on average.
+ *
+ * The pool counts every event that it had to allocate. Once the pool has
+ * grown to the number of events in flight, this count stops increasing.
+ * This makes it possible to verify that steady-state networking does not
+ * allocate events.
+ *
+ * This class is not thread-safe.
+ */
+template <class T>
+class NetEventPool {
+private:
+    /** The events handed out by this pool */
+    std::vector<std::shared_ptr<T>> _events;
+    /** The position to start searching for a free event */
+    size_t _next;
+    /** The maximum number of pooled events */
+    size_t _capacity;
+    /** The number of events allocated by this pool */
+    Uint64 _allocs;
+
+    /**
+     * Returns true if the given event is free and ready for reuse.
+     *
+     * @param event The pooled event
+     *
+     * @return true if the given event is free and ready for reuse.
+     */
+    static bool isFree(const std::shared_ptr<T>& event) {
+        return event.use_count() == 1 && event->recycle();
+    }
+
+    /**
+     * Releases the free events beyond twice the number in use.
+     *
+     * That is, the pool keeps as many free events as there are events in
+     * use (but at least NET_EVENT_POOL_MINIMUM). This method also resets the
+     * cursor to the start of the pool.
+     */
+    void trim() {
+        size_t used = 0;
+        for(auto it = _events.begin(); it != _events.end(); ++it) {
+            if (it->use_count() > 1) {
+                used++;
+            }
+        }
+
+        size_t spare = std::max((size_t)NET_EVENT_POOL_MINIMUM, used);
+        size_t pos = 0;
+        for(size_t ii = 0; ii < _events.size(); ii++) {
+            bool busy = _events[ii].use_count() > 1;
+            if (busy || spare > 0) {
+                spare -= (busy ? 0 : 1);
+                if (pos != ii) {
+                    _events[pos] = std::move(_events[ii]);
+                }
+                pos++;
+            }
+        }
+        _events.resize(pos);
+        _next = 0;
+    }
+
+public:
+    /**
+     * Creates a new, empty event pool.
+     */
+    NetEventPool() : _next(0), _capacity(NET_EVENT_POOL_CAPACITY), _allocs(0) {}
+
+    /**
+     * Returns a recycled event, or a new one if there are none free.
+     *
+     * The factory is only called if none of the pooled events checked is
+     * free. It must return a newly allocated event (as a shared pointer to T).
+     * The new event is added to the pool, unless the pool is at capacity.
+     *
+     * @param factory   The function to allocate a new event
+     *
+     * @return a recycled event, or a new one if there are none free.
+     */
+    template <class Factory>
+    std::shared_ptr<T> acquire(Factory factory) {
+        size_t size = _events.size();
+        size_t probes = std::min(size,(size_t)NET_EVENT_POOL_PROBES);
+        for(size_t ii = 0; ii < probes; ii++) {
+            size_t pos = _next;
+            _next = (_next+1 < size ? _next+1 : 0);
+            if (isFree(_events[pos])) {
+                std::shared_ptr<T> result = _events[pos];
+                if (_next == 0) {
+                    trim();
+                }
+                return result;
+            }
+        }
+
+        std::shared_ptr<T> result = factory();
+        _allocs++;
+        if (_events.size() < _capacity && result->recycle()) {
+            _events.push_back(result);
+        }
+        return result;
+    }
+
+    /**
+     * Returns the number of events allocated by this pool.
+     *
+     * @return the number of events allocated by this pool.
+     */
+    Uint64 getAllocations() const { return _allocs; }
+
+    /**
+     * Returns the number of events held by this pool.
+     *
+     * @return the number of events held by this pool.
+     */
+    size_t size() const { return _events.size(); }
+
+    /**
+     * Returns the maximum number of events held by this pool.
+     *
+     * Events allocated when the pool is full are not pooled. They are
+     * deleted once they are no longer used.
+     *
+     * @return the maximum number of events held by this pool.
+     */
+    size_t getCapacity() const { return _capacity; }
+
+    /**
+     * Sets the maximum number of events held by this pool.
+     *
+     * If the pool holds more events than the new capacity, the extra events
+     * are released (events in use elsewhere are unaffected).
+     *
+     * @param capacity  The maximum number of events held by this pool
+     */
+    void setCapacity(size_t capacity) {
+        _capacity = capacity;
+        if (_events.size() > _capacity) {
+            _events.resize(_capacity);
+            _next = 0;
+        }
+    }
+
+    /**
+     * Releases all pooled events.
+     *
+     * Events still in use elsewhere are unaffected. The allocation count is
+     * not reset.
+     */
+    void clear() {
+        _events.clear();
+        _next = 0;
+    }
+};
+
+        }
+    }
+}
+#endif /* __CU_NET_EVENT_POOL_H__ */
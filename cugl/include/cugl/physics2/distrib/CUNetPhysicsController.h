@@ -44,6 +44,7 @@
 
 // TODO: Some of these can be removed with forward declarations
 #include <cugl/physics2/distrib/CUNetEvent.h>
+#include <cugl/physics2/distrib/CUNetEventPool.h>
 #include <cugl/physics2/distrib/CUPhysObstEvent.h>
 #include <cugl/physics2/distrib/CUPhysSyncEvent.h>
 #include <cugl/physics2/distrib/CUGameStateEvent.h>
@@ -140,10 +141,92 @@ public:
         OVERRIDE_FULL_SYNC,
         /** Synchronize all shared objects in the world */
         FULL_SYNC,
-        /** Prioritize syncing volatile objects */
+        /**
+         * Synchronize the owned objects of highest priority.
+         *
+         * Every object accrues priority each tick from its speed, scaled by
+         * its distance to the peer areas of interest. The objects of highest
+         * priority are sent until the byte budget is filled, and their
+         * priority is reset. Objects that are not sent keep accruing, so
+         * every object is eventually sent.
+         */
         PRIO_SYNC
     };
     
+    /**
+     * The synchronization settings for a single peer.
+     *
+     * These settings are used by {@link SyncType#PRIO_SYNC} to decide which
+     * objects to send each tick.
+     */
+    class PeerSync {
+    public:
+        /** The center of the area of interest */
+        Vec2 center;
+        /** The radius of the area of interest (0 if there is none) */
+        float radius;
+        /** The maximum bytes per tick for this peer (0 if unlimited) */
+        size_t budget;
+        
+        /** Creates a peer with no area of interest and no budget */
+        PeerSync() : radius(0), budget(0) {}
+    };
+    
+    /**
+     * A single tick in the prediction history of an obstacle.
+     *
+     * This records both the input applied to the obstacle during the tick
+     * and the state of the obstacle at the end of it.
+     */
+    class HistoryFrame {
+    public:
+        /** The game tick of this frame */
+        Uint64 tick;
+        /** Whether this frame has been recorded */
+        bool valid;
+        /** The force applied during this tick */
+        Vec2 force;
+        /** The torque applied during this tick */
+        float torque;
+        /** The position at the end of this tick */
+        Vec2 position;
+        /** The linear velocity at the end of this tick */
+        Vec2 velocity;
+        /** The angle at the end of this tick */
+        float angle;
+        /** The angular velocity at the end of this tick */
+        float angularVelocity;
+        
+        /** Creates an empty history frame */
+        HistoryFrame() : tick(0), valid(false), torque(0), angle(0), angularVelocity(0) {}
+    };
+    
+    /**
+     * The prediction state of a single obstacle.
+     *
+     * The history is a ring buffer indexed by the game tick modulo its size.
+     * A snapshot that disagrees with the history is held until the next
+     * update, when all such snapshots are reconciled in a single rollback.
+     */
+    class Prediction {
+    public:
+        /** The history of this obstacle */
+        std::vector<HistoryFrame> history;
+        /** The force applied since the last recorded tick */
+        Vec2 force;
+        /** The torque applied since the last recorded tick */
+        float torque;
+        /** Whether there is a snapshot waiting to be reconciled */
+        bool pending;
+        /** The game tick of the pending snapshot */
+        Uint64 targetTick;
+        /** The pending snapshot */
+        PhysSyncEvent::Parameters target;
+        
+        /** Creates a prediction with no history */
+        Prediction() : torque(0), pending(false), targetTick(0) {}
+    };
+    
     
 #pragma mark PhysicsController Stats
 protected:
@@ -157,6 +240,18 @@ protected:
     long _ovrdCount;
     /** Total number of steps interpolated */
     long _stepSum;
+    /** Total number of rollbacks performed */
+    long _rollbackCount;
+    /** Total number of steps resimulated by rollbacks */
+    long _rollbackSteps;
+    /** The largest number of steps resimulated by a single rollback */
+    Uint64 _rollbackMax;
+    /** Total number of snapshots compared against the prediction history */
+    long _correctionCount;
+    /** Total position error of all snapshots compared against the history */
+    double _correctionSum;
+    /** The largest position error of a snapshot compared against the history */
+    float _correctionMax;
     /** Whether this instance acts as host. */
     bool _isHost;
     
@@ -164,10 +259,10 @@ protected:
     Uint64 _objRotation;
     /** The physics world instance */
     std::shared_ptr<NetWorld> _world;
-    /** Cache of all on-ogoing interpolations */
-    std::unordered_map<std::shared_ptr<physics2::Obstacle>,std::shared_ptr<TargetParams>> _cache;
-    /** Temporary cache for removal after traversal */
-    std::vector<std::shared_ptr<physics2::Obstacle>> _deleteCache;
+    /** Cache of all on-going interpolations, indexed by obstacle slot */
+    std::vector<std::shared_ptr<TargetParams>> _cache;
+    /** The obstacle slots with an on-going interpolation */
+    std::vector<Uint32> _itprSlots;
     
     /** Vector of attached obstacle factories for obstacle creation */
     std::vector<std::shared_ptr<ObstacleFactory>> _obstacleFacts;
@@ -179,6 +274,40 @@ protected:
     
     /** Vector of generated events to be sent */
     std::vector<std::shared_ptr<NetEvent>> _outEvents;
+    /** The synchronization settings for each peer */
+    std::unordered_map<std::string,PeerSync> _peers;
+    /** The accrued sync priority of each owned obstacle, indexed by slot */
+    std::vector<float> _priority;
+    /** The candidates for a priority sync (reused each tick) */
+    std::vector<std::pair<float,Uint32>> _candidates;
+    /** The default byte budget for a priority sync */
+    size_t _syncBudget;
+    /** The pool of recycled obstacle events */
+    NetEventPool<PhysObstEvent> _obstPool;
+    /** The pool of recycled synchronization events */
+    NetEventPool<PhysSyncEvent> _syncPool;
+    /** The codec for encoding outgoing snapshots */
+    PhysSyncEvent::Codec _encoder;
+    /** The codecs for decoding incoming snapshots, keyed by source */
+    std::unordered_map<std::string,PhysSyncEvent::Codec> _decoders;
+    /** The timestamp of the last snapshot applied to each obstacle, keyed by source */
+    std::unordered_map<std::string,std::unordered_map<Uint64,Uint64>> _syncStamps;
+    /** The current game tick */
+    Uint64 _tick;
+    /** The prediction state of each predicted obstacle */
+    std::unordered_map<std::shared_ptr<physics2::Obstacle>,Prediction> _predicted;
+    /** The number of ticks of history kept for each predicted obstacle */
+    Uint32 _historySize;
+    /** The position error that triggers a rollback */
+    float _reconcileThreshold;
+    /** The obstacles held in place during a rollback (reused each rollback) */
+    std::vector<std::pair<std::shared_ptr<physics2::Obstacle>,HistoryFrame>> _frozen;
+    /** The offset (in ticks) of the game clock of each peer from ours */
+    std::unordered_map<std::string,Sint64> _clockOffsets;
+    /** The tick of the last input applied to each owned obstacle, keyed by source */
+    std::unordered_map<std::string,std::unordered_map<Uint64,Uint64>> _inputStamps;
+    /** Whether a rollback is resimulating the world */
+    bool _replaying;
     
     /**
      * Returns the result of linear object interpolation.
@@ -189,6 +318,91 @@ protected:
      */
     float interpolate(int stepsLeft, float target, float source);
     
+    /**
+     * Returns a recycled obstacle event, appended to the outbound events.
+     *
+     * The event must be initialized by the caller.
+     *
+     * @return a recycled obstacle event, appended to the outbound events.
+     */
+    std::shared_ptr<PhysObstEvent> queueObstEvent();
+    
+    /**
+     * Returns the priority an obstacle accrues in a single tick.
+     *
+     * This is the speed of the obstacle (plus one), scaled by the nearest
+     * peer area of interest.
+     *
+     * @param obj   The obstacle
+     *
+     * @return the priority an obstacle accrues in a single tick.
+     */
+    float accruePriority(const std::shared_ptr<physics2::Obstacle>& obj) const;
+    
+    /**
+     * Clears the interpolation and priority state of the given slot.
+     *
+     * This should be called when an obstacle leaves the world (as the slot
+     * will be reused by the next obstacle added), or when it should no longer
+     * be interpolated.
+     *
+     * @param slot  The obstacle slot (ignored if negative)
+     */
+    void releaseSlot(Sint32 slot);
+    
+    /**
+     * Starts interpolating the obstacle towards the given snapshot.
+     *
+     * @param obj   The obstacle to interpolate
+     * @param param The snapshot to interpolate towards
+     */
+    void interpolateTo(const std::shared_ptr<physics2::Obstacle>& obj,
+                       const PhysSyncEvent::Parameters& param);
+    
+    /**
+     * Returns the history frame for the given tick, or nullptr if there is none.
+     *
+     * @param pred  The prediction state
+     * @param tick  The game tick
+     *
+     * @return the history frame for the given tick, or nullptr if there is none.
+     */
+    HistoryFrame* getFrame(Prediction& pred, Uint64 tick);
+    
+    /**
+     * Returns the local game tick for a timestamp from the given peer.
+     *
+     * The timestamp is converted with the clock offset of the peer (see
+     * {@link #setClockOffset}). The result is never less than 0.
+     *
+     * @param peer  The peer UUID
+     * @param stamp The game tick of the peer
+     *
+     * @return the local game tick for a timestamp from the given peer.
+     */
+    Uint64 toLocalTick(const std::string& peer, Uint64 stamp) const;
+    
+    /**
+     * Records the current tick in the history of every predicted obstacle.
+     *
+     * The input of this tick is also sent to the owner of each predicted
+     * obstacle that this controller does not own.
+     */
+    void recordHistory();
+    
+    /**
+     * Reconciles the pending snapshots of all predicted obstacles.
+     *
+     * Each pending snapshot is compared against the history at its tick.
+     * If any of them are off by more than the reconcile threshold, the
+     * predicted obstacles are rewound to the earliest such tick and the
+     * world is resimulated up to the current tick. All other obstacles are
+     * held in place during the resimulation: their state is restored after
+     * every step, so they act as fixed obstacles. Contact callbacks still
+     * fire during the resimulation, with {@link #isReplaying} set.
+     */
+    void reconcile();
+    
     
 #pragma mark Constructors
 public:
@@ -349,7 +563,8 @@ public:
      * @return true if the given obstacle is being interpolated.
      */
     bool isInSync(std::shared_ptr<physics2::Obstacle> obs) {
-        return _cache.count(obs) > 0;
+        Sint32 slot = _world->getObstacleSlot(obs);
+        return slot >= 0 && slot < (Sint32)_cache.size() && _cache[slot] != nullptr;
     }
     
     /**
@@ -363,6 +578,273 @@ public:
     void addSyncObject(std::shared_ptr<physics2::Obstacle> obj,
                        const std::shared_ptr<TargetParams>& param);
     
+#pragma mark Priority Synchronization
+    /**
+     * Returns the default byte budget for a priority sync.
+     *
+     * This budget is used when no peer has a budget of its own.
+     *
+     * @return the default byte budget for a priority sync.
+     */
+    size_t getSyncBudget() const { return _syncBudget; }
+    
+    /**
+     * Sets the default byte budget for a priority sync.
+     *
+     * This budget is used when no peer has a budget of its own.
+     *
+     * @param budget    The default byte budget for a priority sync
+     */
+    void setSyncBudget(size_t budget) { _syncBudget = budget; }
+    
+    /**
+     * Returns true if outgoing snapshots are encoded as absolute values.
+     *
+     * By default, snapshots are encoded as deltas against the last snapshot
+     * sent. This requires that every snapshot arrive, in order. If the
+     * snapshots are sent on an unreliable channel, they should be encoded
+     * as absolute values instead. Snapshots older than the last one applied
+     * to an obstacle are always ignored.
+     *
+     * @return true if outgoing snapshots are encoded as absolute values.
+     */
+    bool isAbsoluteSync() const { return _encoder.isAbsolute(); }
+    
+    /**
+     * Sets whether outgoing snapshots are encoded as absolute values.
+     *
+     * By default, snapshots are encoded as deltas against the last snapshot
+     * sent. This requires that every snapshot arrive, in order. If the
+     * snapshots are sent on an unreliable channel, they should be encoded
+     * as absolute values instead. Snapshots older than the last one applied
+     * to an obstacle are always ignored.
+     *
+     * @param value Whether to encode outgoing snapshots as absolute values
+     */
+    void setAbsoluteSync(bool value) { _encoder.setAbsolute(value); }
+    
+    /**
+     * Sets the area of interest for the given peer.
+     *
+     * A priority sync favors obstacles near the area of interest of some
+     * peer. Obstacles inside the area accrue priority at the full rate, while
+     * those outside fall off with the distance.
+     *
+     * @param peer      The peer UUID
+     * @param center    The center of the area of interest
+     * @param radius    The radius of the area of interest
+     */
+    void setPeerInterest(const std::string& peer, const Vec2& center, float radius);
+    
+    /**
+     * Sets the byte budget for the given peer.
+     *
+     * Synchronization is broadcast, so every peer receives the same stream.
+     * Hence a priority sync uses the smallest budget among all peers. A
+     * budget of 0 means the peer has no limit of its own.
+     *
+     * @param peer      The peer UUID
+     * @param budget    The maximum bytes per tick for this peer
+     */
+    void setPeerBudget(const std::string& peer, size_t budget);
+    
+    /**
+     * Removes all synchronization settings for the given peer.
+     *
+     * @param peer      The peer UUID
+     */
+    void removePeer(const std::string& peer) {
+        _peers.erase(peer);
+        _clockOffsets.erase(peer);
+    }
+    
+#pragma mark Prediction
+    /**
+     * Returns the current game tick.
+     *
+     * This is the tick used to key the prediction history. It is set
+     * automatically by {@link NetEventController}.
+     *
+     * @return the current game tick.
+     */
+    Uint64 getGameTick() const { return _tick; }
+    
+    /**
+     * Sets the current game tick.
+     *
+     * This is the tick used to key the prediction history. It is set
+     * automatically by {@link NetEventController}.
+     *
+     * @param tick  The current game tick
+     */
+    void setGameTick(Uint64 tick) { _tick = tick; }
+    
+    /**
+     * Sets the offset of the game clock of the given peer from this one.
+     *
+     * The offset is in game ticks, and is positive if the clock of the peer
+     * is ahead. It is used to convert the timestamps of snapshots from the
+     * peer to local ticks before comparing them with the prediction history.
+     * It is set automatically by {@link NetEventController} whenever its
+     * clock estimate changes.
+     *
+     * @param peer  The peer UUID
+     * @param ticks The offset of the peer clock in game ticks
+     */
+    void setClockOffset(const std::string& peer, Sint64 ticks) {
+        _clockOffsets[peer] = ticks;
+    }
+    
+    /**
+     * Returns true if a rollback is currently resimulating the world.
+     *
+     * A rollback steps the box2d world directly, once for each replayed
+     * tick. So the contact callbacks of the world (see
+     * {@link ObstacleWorld#onBeginContact}) are called again for contacts
+     * that the game has already seen. Callbacks with side effects should
+     * check this method and ignore contacts while it is true.
+     *
+     * During a rollback only the predicted obstacles move. The state of all
+     * other obstacles is restored after every step.
+     *
+     * @return true if a rollback is currently resimulating the world.
+     */
+    bool isReplaying() const { return _replaying; }
+    
+    /**
+     * Sets whether the given obstacle is predicted.
+     *
+     * A predicted obstacle is one that this client simulates ahead of its
+     * owner, typically an avatar driven by local input. Snapshots from the
+     * owner are not interpolated. Instead they are compared against the
+     * history of the obstacle at the same tick (converted to the local
+     * clock with {@link #setClockOffset}). If the prediction was off, the
+     * obstacle is rewound to the snapshot and resimulated (with the
+     * recorded inputs) up to the current tick.
+     *
+     * Predicted obstacles should be driven with {@link #applyInput} so that
+     * their inputs can be replayed, and sent to the owner. The resimulation
+     * steps the box2d world directly, so contact callbacks fire again for
+     * the replayed ticks. Callbacks with side effects (e.g. scoring) should
+     * check {@link #isReplaying} and ignore those contacts.
+     *
+     * @param obs   The obstacle
+     * @param value Whether the obstacle is predicted
+     */
+    void setPredicted(const std::shared_ptr<physics2::Obstacle>& obs, bool value);
+    
+    /**
+     * Returns true if the given obstacle is predicted.
+     *
+     * @param obs   The obstacle
+     *
+     * @return true if the given obstacle is predicted.
+     */
+    bool isPredicted(const std::shared_ptr<physics2::Obstacle>& obs) const {
+        return _predicted.count(obs) > 0;
+    }
+    
+    /**
+     * Applies a force and torque to the given obstacle for this tick.
+     *
+     * If the obstacle is predicted, the input is recorded so that it can
+     * be replayed by a rollback. If this controller does not own the
+     * obstacle, the total input of the tick is also sent to the owner, who
+     * applies it when it arrives. Inputs should be applied before the world
+     * is updated, and {@link NetEventController#updateNet} should be called
+     * after the world is updated.
+     *
+     * @param obs       The obstacle
+     * @param force     The force to apply to the center of the obstacle
+     * @param torque    The torque to apply to the obstacle
+     */
+    void applyInput(const std::shared_ptr<physics2::Obstacle>& obs,
+                    const Vec2& force, float torque=0);
+    
+    /**
+     * Returns the number of ticks of history kept for each predicted obstacle.
+     *
+     * Snapshots older than this cannot be reconciled, and are interpolated
+     * instead. This should cover the round trip time to the owner.
+     *
+     * @return the number of ticks of history kept for each predicted obstacle.
+     */
+    Uint32 getHistorySize() const { return _historySize; }
+    
+    /**
+     * Sets the number of ticks of history kept for each predicted obstacle.
+     *
+     * Snapshots older than this cannot be reconciled, and are interpolated
+     * instead. This should cover the round trip time to the owner. Changing
+     * this value erases all history.
+     *
+     * @param size  The number of ticks of history kept for each predicted obstacle
+     */
+    void setHistorySize(Uint32 size);
+    
+    /**
+     * Returns the position error that triggers a rollback.
+     *
+     * Snapshots that are within this distance of the history are ignored.
+     *
+     * @return the position error that triggers a rollback.
+     */
+    float getReconcileThreshold() const { return _reconcileThreshold; }
+    
+    /**
+     * Sets the position error that triggers a rollback.
+     *
+     * Snapshots that are within this distance of the history are ignored.
+     *
+     * @param value The position error that triggers a rollback
+     */
+    void setReconcileThreshold(float value) { _reconcileThreshold = value; }
+    
+    /**
+     * Returns the number of rollbacks performed.
+     *
+     * @return the number of rollbacks performed.
+     */
+    long getRollbackCount() const { return _rollbackCount; }
+    
+    /**
+     * Returns the average number of steps resimulated by a rollback.
+     *
+     * @return the average number of steps resimulated by a rollback.
+     */
+    float getAverageRollbackDepth() const {
+        return _rollbackCount ? ((float)_rollbackSteps)/_rollbackCount : 0;
+    }
+    
+    /**
+     * Returns the largest number of steps resimulated by a single rollback.
+     *
+     * @return the largest number of steps resimulated by a single rollback.
+     */
+    Uint64 getMaxRollbackDepth() const { return _rollbackMax; }
+    
+    /**
+     * Returns the average position error of the predicted obstacles.
+     *
+     * This is measured for every snapshot compared against the history,
+     * whether or not it triggered a rollback.
+     *
+     * @return the average position error of the predicted obstacles.
+     */
+    float getAverageCorrection() const {
+        return _correctionCount ? (float)(_correctionSum/_correctionCount) : 0;
+    }
+    
+    /**
+     * Returns the largest position error of the predicted obstacles.
+     *
+     * This is measured for every snapshot compared against the history,
+     * whether or not it triggered a rollback.
+     *
+     * @return the largest position error of the predicted obstacles.
+     */
+    float getMaxCorrection() const { return _correctionMax; }
+    
 #pragma mark World Synchronization
     /**
      * Returns the vector of generated events to be sent.
@@ -373,8 +855,24 @@ public:
         return _outEvents;
     }
     
+    /**
+     * Returns the number of physics events allocated by this controller.
+     *
+     * Outbound events are recycled once they have been sent, so this number
+     * stops growing once the pools cover the events generated in a tick.
+     *
+     * @return the number of physics events allocated by this controller.
+     */
+    Uint64 getEventAllocations() const {
+        return _obstPool.getAllocations()+_syncPool.getAllocations();
+    }
+    
     /**
      * Updates the physics controller.
+     *
+     * This records the current tick in the prediction history, reconciles
+     * any pending snapshots of predicted obstacles, and then advances all
+     * ongoing interpolations.
      */
     void updateSimulation();
     
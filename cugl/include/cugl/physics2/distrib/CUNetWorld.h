@@ -46,6 +46,7 @@
 #include <cugl/physics2/CUJoint.h>
 #include <cugl/physics2/CUObstacleWorld.h>
 #include <unordered_map>
+#include <vector>
 
 namespace cugl {
 
@@ -83,14 +84,22 @@ protected:
     /** A shortened version of the identifer for this session */
     Uint32 _shortUID;
     
-    /** Map from obstacle pointers to ids (for pointer swizzling) */
-    std::unordered_map<std::shared_ptr<physics2::Obstacle>,Uint64>  _obsToId;
-    /** Map from ids to obstacle pointers (for pointer swizzling) */
-    std::unordered_map<Uint64, std::shared_ptr<physics2::Obstacle>> _idToObs;
-    /** A reference counter to the number of obstacle owners */
-    std::unordered_map<std::shared_ptr<physics2::Obstacle>,Uint64> _ownedObs;
-    /** An iterator to keep track of obstacles for queueing purposes */
-    std::unordered_set<std::shared_ptr<physics2::Obstacle>>::iterator _nextObstacle;
+    /** The obstacle in each slot (nullptr if the slot is free) */
+    std::vector<std::shared_ptr<physics2::Obstacle>> _slots;
+    /** The obstacle id in each slot */
+    std::vector<Uint64> _slotIds;
+    /** Whether this world owns the obstacle in each slot */
+    std::vector<Uint8> _slotOwned;
+    /** The remaining ownership duration in each slot (0 is permanent) */
+    std::vector<Uint64> _slotDuration;
+    /** The free slots, to be reused before growing the table */
+    std::vector<Uint32> _freeSlots;
+    /** Map from obstacle ids to slots (for pointer swizzling) */
+    std::unordered_map<Uint64,Uint32> _idToSlot;
+    /** Map from obstacle pointers to slots (for pointer swizzling) */
+    std::unordered_map<const physics2::Obstacle*,Uint32> _obsToSlot;
+    /** The next slot to check for queueing purposes */
+    Uint32 _nextSlot;
     
     /** Map from joint pointers to ids (for pointer swizzling) */
     std::unordered_map<std::shared_ptr<physics2::Joint>,Uint64>  _jntToId;
@@ -449,7 +458,9 @@ public:
     /**
      * Returns the next obstacle for synchronization
      *
-     * This goes around the obstacle set in a round-robin fashion.
+     * This goes around the obstacle table in a round-robin fashion. It
+     * returns nullptr once it reaches the end of the table, and starts over
+     * on the next call.
      *
      * @return the next obstacle for synchronization
      */
@@ -458,14 +469,15 @@ public:
     /**
      * Returns the obstacle for the given id.
      *
-     * This method returns nullptr if there is no such joint.
+     * This method returns nullptr if there is no such obstacle.
      *
      * @param oid   The obstacle id
      *
      * @return the obstacle for the given id.
      */
-    std::shared_ptr<Obstacle> getObstacle(Uint64 oid) {
-        return _idToObs.at(oid);
+    std::shared_ptr<Obstacle> getObstacle(Uint64 oid) const {
+        auto it = _idToSlot.find(oid);
+        return it == _idToSlot.end() ? nullptr : _slots[it->second];
     }
     
     /**
@@ -477,8 +489,9 @@ public:
      *
      * @return id for the given obstacle.
      */
-    Sint64 getObstacleId(const std::shared_ptr<Obstacle>& obs) {
-        return _obsToId.at(obs);
+    Sint64 getObstacleId(const std::shared_ptr<Obstacle>& obs) const {
+        auto it = _obsToSlot.find(obs.get());
+        return it == _obsToSlot.end() ? -1 : (Sint64)_slotIds[it->second];
     }
     
     /**
@@ -508,65 +521,202 @@ public:
     }
     
     /**
-     * Returns the map from obstacle ids to the objects
+     * Returns the map from joint ids to the objects
      *
-     * @return the map from obstacle ids to the objects
+     * @return the map from joint ids to the objects
      */
-    const std::unordered_map<Uint64, std::shared_ptr<physics2::Obstacle>>& getObstacleMap() {
-        return _idToObs;
+    const std::unordered_map<Uint64, std::shared_ptr<physics2::Joint>>& getJointMap() {
+        return _idToJnt;
     }
 
     /**
-     * Returns the map from obstacles to their ids
+     * Returns the map from joints to their ids
      *
-     * @return the map from obstacles to their ids
+     * @return the map from joints to their ids
      */
-    const std::unordered_map<std::shared_ptr<physics2::Obstacle>,Uint64>& getObstacleIds() {
-        return _obsToId;
+    const std::unordered_map<std::shared_ptr<physics2::Joint>,Uint64>& getJointIds() {
+        return _jntToId;
     }
     
     /**
-     * Returns the map of obstacles owned by this shared physics world.
+     * Returns the map of joints owned by this shared physics world.
      *
-     * The keys are the obstacle pointers, while the values are the ownership
-     * duration. If the value is 0, then this obstacle is permanently owned by
+     * The keys are the joints pointers, while the values are the ownership
+     * duration. If the value is 0, then this joint is permanently owned by
      * this copy of the world.
      *
-     * @return the map of obstacles owned by this shared physics world.
+     * @return the map of joints owned by this shared physics world.
      */
-    std::unordered_map<std::shared_ptr<physics2::Obstacle>,Uint64>& getOwnedObstacles() {
-        return _ownedObs;
+    std::unordered_map<std::shared_ptr<physics2::Joint>,Uint64>& getOwnedJoints() {
+        return _ownedJoints;
     }
     
+#pragma mark -
+#pragma mark Obstacle Table
     /**
-     * Returns the map from joint ids to the objects
+     * Returns the number of slots in the obstacle table.
      *
-     * @return the map from joint ids to the objects
+     * Every obstacle in this world is assigned a slot when it is added. The
+     * slot is stable for as long as the obstacle is in the world, and is
+     * reused once it is removed. Hence the table may contain free slots,
+     * which hold nullptr.
+     *
+     * @return the number of slots in the obstacle table.
      */
-    const std::unordered_map<Uint64, std::shared_ptr<physics2::Joint>>& getJointMap() {
-        return _idToJnt;
+    size_t getSlotCount() const { return _slots.size(); }
+    
+    /**
+     * Returns the obstacle table.
+     *
+     * The table is contiguous and indexed by slot. Free slots hold nullptr.
+     * Iterating over this table (by reference) is much faster than iterating
+     * over {@link #getObstacles}.
+     *
+     * @return the obstacle table.
+     */
+    const std::vector<std::shared_ptr<physics2::Obstacle>>& getSlots() const {
+        return _slots;
     }
-
+    
     /**
-     * Returns the map from joints to their ids
+     * Returns the obstacle in the given slot.
      *
-     * @return the map from joints to their ids
+     * This method returns nullptr if the slot is free.
+     *
+     * @param slot  The obstacle slot
+     *
+     * @return the obstacle in the given slot.
      */
-    const std::unordered_map<std::shared_ptr<physics2::Joint>,Uint64>& getJointIds() {
-        return _jntToId;
+    const std::shared_ptr<physics2::Obstacle>& getSlotObstacle(Uint32 slot) const {
+        return _slots[slot];
     }
     
     /**
-     * Returns the map of joints owned by this shared physics world.
+     * Returns the id of the obstacle in the given slot.
      *
-     * The keys are the joints pointers, while the values are the ownership
-     * duration. If the value is 0, then this joint is permanently owned by
-     * this copy of the world.
+     * The value is undefined if the slot is free.
      *
-     * @return the map of joints owned by this shared physics world.
+     * @param slot  The obstacle slot
+     *
+     * @return the id of the obstacle in the given slot.
      */
-    std::unordered_map<std::shared_ptr<physics2::Joint>,Uint64>& getOwnedJoints() {
-        return _ownedJoints;
+    Uint64 getSlotId(Uint32 slot) const { return _slotIds[slot]; }
+    
+    /**
+     * Returns the slot for the given obstacle.
+     *
+     * This method returns -1 if there is no such obstacle.
+     *
+     * @param obs   The obstacle to query
+     *
+     * @return the slot for the given obstacle.
+     */
+    Sint32 getObstacleSlot(const std::shared_ptr<Obstacle>& obs) const {
+        auto it = _obsToSlot.find(obs.get());
+        return it == _obsToSlot.end() ? -1 : (Sint32)it->second;
+    }
+    
+    /**
+     * Returns the slot for the given obstacle id.
+     *
+     * This method returns -1 if there is no such obstacle.
+     *
+     * @param oid   The obstacle id
+     *
+     * @return the slot for the given obstacle id.
+     */
+    Sint32 getObstacleSlot(Uint64 oid) const {
+        auto it = _idToSlot.find(oid);
+        return it == _idToSlot.end() ? -1 : (Sint32)it->second;
+    }
+    
+    /**
+     * Returns true if this world owns the obstacle in the given slot.
+     *
+     * @param slot  The obstacle slot
+     *
+     * @return true if this world owns the obstacle in the given slot.
+     */
+    bool isOwned(Uint32 slot) const { return _slotOwned[slot]; }
+    
+    /**
+     * Returns true if this world owns the given obstacle.
+     *
+     * @param obs   The obstacle to query
+     *
+     * @return true if this world owns the given obstacle.
+     */
+    bool isOwned(const std::shared_ptr<Obstacle>& obs) const {
+        Sint32 slot = getObstacleSlot(obs);
+        return slot >= 0 && _slotOwned[slot];
+    }
+    
+    /**
+     * Returns the remaining ownership duration of the given slot.
+     *
+     * The duration is measured in physics steps. If the value is 0, then the
+     * obstacle is permanently owned by this copy of the world (or not owned
+     * at all; see {@link #isOwned}).
+     *
+     * @param slot  The obstacle slot
+     *
+     * @return the remaining ownership duration of the given slot.
+     */
+    Uint64 getOwnership(Uint32 slot) const { return _slotDuration[slot]; }
+    
+    /**
+     * Makes this world the owner of the obstacle in the given slot.
+     *
+     * The duration is measured in physics steps. If the value is 0, then the
+     * obstacle is permanently owned by this copy of the world.
+     *
+     * @param slot      The obstacle slot
+     * @param duration  The ownership duration
+     */
+    void setOwnership(Uint32 slot, Uint64 duration) {
+        _slotOwned[slot] = 1;
+        _slotDuration[slot] = duration;
+    }
+    
+    /**
+     * Makes this world the owner of the given obstacle.
+     *
+     * The duration is measured in physics steps. If the value is 0, then the
+     * obstacle is permanently owned by this copy of the world. This method
+     * does nothing if the obstacle is not in this world.
+     *
+     * @param obs       The obstacle to own
+     * @param duration  The ownership duration
+     */
+    void setOwnership(const std::shared_ptr<Obstacle>& obs, Uint64 duration) {
+        Sint32 slot = getObstacleSlot(obs);
+        if (slot >= 0) {
+            setOwnership(slot,duration);
+        }
+    }
+    
+    /**
+     * Releases ownership of the obstacle in the given slot.
+     *
+     * @param slot  The obstacle slot
+     */
+    void clearOwnership(Uint32 slot) {
+        _slotOwned[slot] = 0;
+        _slotDuration[slot] = 0;
+    }
+    
+    /**
+     * Releases ownership of the given obstacle.
+     *
+     * This method does nothing if the obstacle is not in this world.
+     *
+     * @param obs   The obstacle to release
+     */
+    void clearOwnership(const std::shared_ptr<Obstacle>& obs) {
+        Sint32 slot = getObstacleSlot(obs);
+        if (slot >= 0) {
+            clearOwnership(slot);
+        }
     }
     
 #pragma mark -
@@ -94,7 +94,9 @@ public:
         /** A new owner acquiring this object */
         OWNER_ACQUIRE = 10,
         /** An owner releasing this object */
-        OWNER_RELEASE = 11
+        OWNER_RELEASE = 11,
+        /** An input applied to this object by a predicting peer */
+        INPUT = 12
     };
     
     /**
@@ -223,6 +225,14 @@ protected:
     /** The field for OBJ_OWNER_ACQUIRE */
     Uint64 _duration;
     
+    // Fields for EventType::INPUT
+    /** The game tick (of the sender) when the input was applied */
+    Uint64 _inputTick;
+    /** The force applied by the input */
+    Vec2 _force;
+    /** The torque applied by the input */
+    float _torque;
+    
     /** A serializer for packing data */
     LWSerializer _serializer;
     /** A deserializer for unpacking data */
@@ -436,6 +446,26 @@ public:
         _obstacleId = obsId;
     }
     
+    /**
+     * Initializes an empty event to {@link EventType::INPUT}.
+     *
+     * This event symbolizes the input applied to a predicted obstacle in a
+     * single tick. It is sent so that the owner of the obstacle can apply
+     * the same input.
+     *
+     * @param obsId     The obstacle global id
+     * @param tick      The game tick (of the sender) of the input
+     * @param force     The force applied to the center of the obstacle
+     * @param torque    The torque applied to the obstacle
+     */
+    void initInput(Uint64 obsId, Uint64 tick, const Vec2& force, float torque) {
+        _type = EventType::INPUT;
+        _obstacleId = obsId;
+        _inputTick = tick;
+        _force = force;
+        _torque = torque;
+    }
+    
     
 #pragma Event Allocators
     /**
@@ -638,6 +668,26 @@ public:
         e->initOwnerRelease(obsId);
         return e;
     }
+    
+    /**
+     * Returns a newly created {@link EventType::INPUT} event.
+     *
+     * This method is a shortcut for creating a shared object on
+     * {@link #initInput}.
+     *
+     * @param obsId     The obstacle global id
+     * @param tick      The game tick (of the sender) of the input
+     * @param force     The force applied to the center of the obstacle
+     * @param torque    The torque applied to the obstacle
+     *
+     * @return a newly created {@link EventType::INPUT} event.
+     */
+    static std::shared_ptr<PhysObstEvent> allocInput(Uint64 obsId, Uint64 tick,
+                                                     const Vec2& force, float torque) {
+        auto e = std::make_shared<PhysObstEvent>();
+        e->initInput(obsId, tick, force, torque);
+        return e;
+    }
 
 #pragma mark Attributes
     /**
@@ -801,6 +851,29 @@ public:
      * @return the mass of this physics event.
      */
     float getMass() const { return _mass; }
+    
+    /**
+     * Returns the game tick of the input in this physics event
+     *
+     * This is the tick of the sender, not the receiver.
+     *
+     * @return the game tick of the input in this physics event
+     */
+    Uint64 getInputTick() const { return _inputTick; }
+    
+    /**
+     * Returns the force of the input in this physics event
+     *
+     * @return the force of the input in this physics event
+     */
+    const Vec2 getForce() const { return _force; }
+    
+    /**
+     * Returns the torque of the input in this physics event
+     *
+     * @return the torque of the input in this physics event
+     */
+    float getTorque() const { return _torque; }
 
 #pragma mark Serialization/Deserialization
     /**
@@ -810,6 +883,22 @@ public:
      */
     std::vector<std::byte> serialize() override;
     
+    /**
+     * Serializes this event to the end of the given serializer.
+     *
+     * This writes the event in place, without an intermediate vector.
+     *
+     * @param out   the serializer to write to
+     */
+    void serializeTo(LWSerializer& out) override;
+    
+    /**
+     * Returns true if this event was reset so that it can be reused.
+     *
+     * @return true if this event was reset so that it can be reused.
+     */
+    bool recycle() override;
+    
     /**
      * Deserializes this event from a byte vector.
      *
@@ -817,6 +906,17 @@ public:
      */
     void deserialize(const std::vector<std::byte>& data) override;
     
+    /**
+     * Deserializes this event from a range of bytes.
+     *
+     * This method will set the type of the event and all relevant fields.
+     * It reads the bytes in place, without copying them.
+     *
+     * @param data  the start of the serialized bytes
+     * @param size  the number of serialized bytes
+     */
+    void deserializeBytes(const std::byte* data, size_t size) override;
+    
 };
 
         }
@@ -3,7 +3,9 @@
 //  Cornell University Game Library (CUGL)
 //
 //  This module provides events for physics synchronization, which are handled
-//  by the NetEventController internally.
+//  by the NetEventController internally. Snapshots are quantized against the
+//  world bounds and delta encoded against the previous snapshot of the same
+//  obstacle, so that a resting obstacle costs (almost) nothing to send.
 // 
 //  CUGL MIT License:
 //      This software is provided 'as-is', without any express or implied
@@ -30,11 +32,14 @@
 #ifndef __CU_PHYS_SYNC_EVENT_H__
 #define __CU_PHYS_SYNC_EVENT_H__
 
-#include <cugl/netcode/CUNetcodeSerializer.h>
+#include <cugl/core/math/CURect.h>
 #include <cugl/physics2/CUObstacle.h>
 #include <cugl/physics2/distrib/CUNetEvent.h>
+#include <cugl/physics2/distrib/CULWSerializer.h>
+#include <cugl/physics2/distrib/CULWDeserializer.h>
 #include <SDL_stdinc.h>
 #include <unordered_set>
+#include <unordered_map>
 
 namespace cugl {
 
@@ -93,18 +98,213 @@ public:
         Parameters();
     };
 
+    /**
+     * The type for a quantized snapshot on the wire.
+     *
+     * Each field of a {@link Parameters} object is quantized to an integer by
+     * a {@link Codec}. If the entry is a keyframe, the values are absolute.
+     * Otherwise they are differences from the previous snapshot of the same
+     * obstacle, and only the fields whose bits are set in the flags are
+     * present.
+     */
+    class Delta {
+    public:
+        /** The obstacle id */
+        Uint64 obsId;
+        /** The present fields (bits 0-5) and the keyframe bit */
+        Uint8 flags;
+        /** The quantized values (x, y, vx, vy, angle, vAngular) */
+        Sint32 values[6];
+        
+        /** Creates a new delta with no fields present */
+        Delta();
+    };
+    
+    /**
+     * This class quantizes and delta encodes obstacle snapshots.
+     *
+     * Positions are quantized to 2^20 steps across the largest dimension of
+     * the world bounds, and velocities to 2^14 steps per second. Angles are
+     * packed into 16 bits, and wrap around so that a full turn is never sent
+     * as a large delta. Quantization is deterministic, so the sender and the
+     * receiver must be given the same bounds.
+     *
+     * Each codec remembers the last quantized snapshot of every obstacle. The
+     * sender encodes against these baselines, and each receiver keeps one
+     * codec per sender to decode against the same baselines. As physics events
+     * travel on a reliable, ordered channel, the last snapshot sent is always
+     * the last one acknowledged, and no explicit acknowledgement is needed.
+     * Every obstacle is still resent as a keyframe once per refresh period,
+     * so a peer that joins late (or was reset) catches up on its own.
+     */
+    class Codec {
+    private:
+        /** The quantized baseline of a single obstacle */
+        class Baseline {
+        public:
+            /** The last quantized values sent (or received) */
+            Sint32 values[6];
+            /** The number of encodes since the last keyframe */
+            Uint32 age;
+        };
+        
+        /** The baselines for all obstacles seen so far */
+        std::unordered_map<Uint64, Baseline> _baselines;
+        /** The origin of the world bounds */
+        Vec2 _origin;
+        /** The size of a position step in world units */
+        float _posStep;
+        /** The size of a velocity step in world units per second */
+        float _velStep;
+        /** The number of encodes between keyframes */
+        Uint32 _refresh;
+        /** Whether to encode every changed snapshot as a keyframe */
+        bool _absolute;
+        
+        /**
+         * Quantizes the given snapshot into the array of values.
+         *
+         * @param param     The snapshot to quantize
+         * @param values    The array to store the quantized values
+         */
+        void quantize(const Parameters& param, Sint32* values) const;
+        
+        /**
+         * Restores a snapshot from the array of quantized values.
+         *
+         * @param values    The quantized values
+         * @param param     The snapshot to store the result
+         */
+        void dequantize(const Sint32* values, Parameters& param) const;
+        
+    public:
+        /**
+         * Creates a new codec with unit bounds and no baselines.
+         */
+        Codec();
+        
+        /**
+         * Sets the world bounds for quantization.
+         *
+         * This clears all baselines, as they are no longer comparable.
+         *
+         * @param bounds    The world bounds
+         */
+        void setBounds(const Rect& bounds);
+        
+        /**
+         * Returns the number of encodes between keyframes.
+         *
+         * Unchanged obstacles are skipped, but every obstacle is sent as a
+         * keyframe once this many encodes have passed.
+         *
+         * @return the number of encodes between keyframes.
+         */
+        Uint32 getRefreshRate() const { return _refresh; }
+        
+        /**
+         * Sets the number of encodes between keyframes.
+         *
+         * Unchanged obstacles are skipped, but every obstacle is sent as a
+         * keyframe once this many encodes have passed.
+         *
+         * @param rate  The number of encodes between keyframes
+         */
+        void setRefreshRate(Uint32 rate) { _refresh = rate; }
+        
+        /**
+         * Returns true if this codec encodes changed snapshots as keyframes.
+         *
+         * Deltas can only be decoded if every earlier encode was received,
+         * in order. That is not the case if snapshots are sent on an
+         * unreliable channel. In absolute mode, unchanged obstacles are
+         * still skipped, but every snapshot that is sent is a keyframe.
+         * This mode only affects encoding.
+         *
+         * @return true if this codec encodes changed snapshots as keyframes.
+         */
+        bool isAbsolute() const { return _absolute; }
+        
+        /**
+         * Sets whether this codec encodes changed snapshots as keyframes.
+         *
+         * Deltas can only be decoded if every earlier encode was received,
+         * in order. That is not the case if snapshots are sent on an
+         * unreliable channel. In absolute mode, unchanged obstacles are
+         * still skipped, but every snapshot that is sent is a keyframe.
+         * This mode only affects encoding.
+         *
+         * @param value Whether to encode changed snapshots as keyframes
+         */
+        void setAbsolute(bool value) { _absolute = value; }
+        
+        /**
+         * Forgets the baseline of the given obstacle.
+         *
+         * This should be called when an obstacle is deleted or changes owner.
+         *
+         * @param obsId The obstacle id
+         */
+        void remove(Uint64 obsId) { _baselines.erase(obsId); }
+        
+        /**
+         * Forgets all baselines, so that the next encode sends keyframes.
+         */
+        void reset() { _baselines.clear(); }
+        
+        /**
+         * Returns the approximate number of bytes to send the given snapshot.
+         *
+         * This method does not change the baselines. It returns 0 if the
+         * snapshot would be omitted by the next encode. The estimate assumes
+         * the id gap fits in a single byte.
+         *
+         * @param param The snapshot to measure
+         *
+         * @return the approximate number of bytes to send the given snapshot.
+         */
+        size_t estimate(const Parameters& param) const;
+        
+        /**
+         * Encodes the snapshots as deltas against the current baselines.
+         *
+         * The deltas are sorted by obstacle id, and unchanged obstacles are
+         * omitted (unless a keyframe is due). The baselines are updated to
+         * the new snapshots. If key is true, every snapshot is encoded as an
+         * absolute keyframe. In absolute mode, every changed snapshot is
+         * encoded as a keyframe.
+         *
+         * @param params    The snapshots to encode
+         * @param deltas    The vector to store the encoded deltas
+         * @param key       Whether to force keyframes
+         */
+        void encode(const std::vector<Parameters>& params, std::vector<Delta>& deltas, bool key);
+        
+        /**
+         * Decodes the deltas against the current baselines.
+         *
+         * The baselines are updated to the decoded snapshots. A delta for an
+         * obstacle with no baseline cannot be decoded, and is skipped.
+         *
+         * @param deltas    The deltas to decode
+         * @param params    The vector to store the decoded snapshots
+         */
+        void decode(const std::vector<Delta>& deltas, std::vector<Parameters>& params);
+    };
+
 protected:
     /** The vector of added object snapshots. */
     std::vector<Parameters> _syncList;
+    /** The vector of encoded snapshots. */
+    std::vector<Delta> _deltas;
 
 private:
     /** The set of ids of all obstacles added to be serialized. */
     std::unordered_set<Uint64> _obsSet;
-    // TODO: Is there a reason we are not using lightweights?
     /** The serializer for converting basic types to byte vectors. */
-    cugl::netcode::NetcodeSerializer _serializer;
+    LWSerializer _serializer;
     /** The deserializer for converting byte vectors to basic types. */
-    cugl::netcode::NetcodeDeserializer _deserializer;
+    LWDeserializer _deserializer;
     
 #pragma mark Constructors
 public:
@@ -157,21 +357,87 @@ public:
     void addObstacle(Uint64 id, const std::shared_ptr<physics2::Obstacle>& obs);
     
     /**
-     * Returns a byte vector serializing the current list of snapshots.
+     * Returns a reference to the encoded snapshots.
+     *
+     * @return a reference to the encoded snapshots.
+     */
+    const std::vector<Delta>& getDeltas() const {
+        return _deltas;
+    }
+    
+    /**
+     * Encodes the snapshots added so far with the given codec.
      *
-     * @return a byte vector serializing the current list of snapshots.
+     * This must be called before serialization, as only the encoded snapshots
+     * are sent. If key is true, every snapshot is sent as a keyframe.
+     *
+     * @param codec The sender codec
+     * @param key   Whether to force keyframes
+     */
+    void encode(Codec& codec, bool key) {
+        codec.encode(_syncList, _deltas, key);
+    }
+    
+    /**
+     * Decodes the received snapshots with the given codec.
+     *
+     * This must be called after deserialization, and before the sync list is
+     * accessed. The codec should be the one for the source of this event.
+     *
+     * @param codec The codec for the sender
+     */
+    void decode(Codec& codec) {
+        codec.decode(_deltas, _syncList);
+    }
+    
+    /**
+     * Returns a byte vector serializing the encoded snapshots.
+     *
+     * Snapshots that have not been encoded (see {@link #encode}) are not
+     * serialized.
+     *
+     * @return a byte vector serializing the encoded snapshots.
      */
     std::vector<std::byte> serialize() override;
     
     /**
-     * Unpacks a byte vector into a list of snapshots.
+     * Serializes the encoded snapshots to the end of the given serializer.
      *
-     * These snapshots can then be used in physics synchronizations.
+     * This writes the snapshots in place, without an intermediate vector.
+     *
+     * @param out   the serializer to write to
+     */
+    void serializeTo(LWSerializer& out) override;
+    
+    /**
+     * Returns true if this event was reset so that it can be reused.
+     *
+     * @return true if this event was reset so that it can be reused.
+     */
+    bool recycle() override;
+    
+    /**
+     * Unpacks a byte vector into a list of encoded snapshots.
+     *
+     * These snapshots must be decoded (see {@link #decode}) before they can
+     * be used in physics synchronizations.
      *
      * @param data the byte vector to deserialize
      */
     void deserialize(const std::vector<std::byte>& data) override;
     
+    /**
+     * Unpacks a range of bytes into a list of encoded snapshots.
+     *
+     * This method reads the bytes in place, without copying them. These
+     * snapshots must be decoded (see {@link #decode}) before they can be used
+     * in physics synchronizations.
+     *
+     * @param data  the start of the serialized bytes
+     * @param size  the number of serialized bytes
+     */
+    void deserializeBytes(const std::byte* data, size_t size) override;
+    
 };
 
         }
@@ -37,8 +37,10 @@
 #include "CUNetEventController.h"
 
 #include "CUNetEvent.h"
+#include "CUNetEventPool.h"
 #include "CUPhysObstEvent.h"
 #include "CUPhysSyncEvent.h"
 #include "CUGameStateEvent.h"
+#include "CUClockSyncEvent.h"
 
 #endif /* __CU_PHYSICS_DISTRIB_PKGS_H__ */
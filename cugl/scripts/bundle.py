@@ -0,0 +1,332 @@
+"""
+Script to pack CUGL assets into a bundle
+
+Loading a JSON asset directory opens every asset file separately. On mobile
+storage, the cost of opening many small files can dominate the loading time.
+This script packs the asset files into a single indexed archive (a bundle),
+which is read at runtime by AssetBundle and BundleLoader.
+
+The script packs the files referenced by the given JSON asset directories (and
+the directories themselves). If no directory is given, it packs every file in
+the asset folder. Paths in the bundle are relative to the asset folder, exactly
+as they appear in the JSON directories, so no directory needs to change. For
+example
+
+    python cugl/scripts/bundle.py NetLab/assets -d json/assets.json -o assets.bundle
+
+creates the bundle NetLab/assets/assets.bundle. The game then mounts this bundle
+before loading the directory:
+
+    assets->attach<AssetBundle>(BundleLoader::alloc()->getHook());
+    assets->load<AssetBundle>("main","assets.bundle");
+    assets->loadDirectoryAsync("json/assets.json",callback);
+
+Entries are aligned (16 bytes by default) so that they can be read in place from
+the memory-mapped bundle. With the --compress option, each entry is compressed
+with the LZ4 block format, but only if it saves at least an eighth of the size.
+Formats that are already compressed (PNG, OGG, MP3) rarely meet this bar, and so
+remain zero-copy. The lz4 package is used if it is installed. Otherwise the script
+falls back to a (slower) pure Python compressor.
+
+See CUAssetBundle.h for the format of the bundle.
+
+Author: Kidus Zegeye
+Date: March 9, 2025
+"""
+import os, os.path
+import json
+import struct
+import argparse
+
+
+# The bundle magic number
+MAGIC = b'CUBUNDLE'
+# The bundle format version
+VERSION = 1
+# The entry compression schemes
+SCHEME_NONE = 0
+SCHEME_LZ4  = 1
+
+
+#mark LZ4 COMPRESSION
+
+# The minimum match length in LZ4
+LZ4_MINMATCH = 4
+# The last match must start this many bytes before the end
+LZ4_MFLIMIT = 12
+# The last bytes must be literals
+LZ4_LASTLITERALS = 5
+# The maximum match offset
+LZ4_MAXOFFSET = 65535
+
+
+def lz4_length(out,value):
+    """
+    Appends an LZ4 length extension to the output
+
+    Lengths of 15 or more are extended by bytes of 255, followed by a final byte
+    less than 255.
+
+    :param out: The output buffer
+    :type out:  ``bytearray``
+
+    :param value: The length beyond 15
+    :type value:  ``int``
+    """
+    while value >= 255:
+        out.append(255)
+        value -= 255
+    out.append(value)
+
+
+def lz4_sequence(out,literals,offset,match):
+    """
+    Appends an LZ4 sequence to the output
+
+    A sequence is some literals followed by a match. The last sequence of a block
+    has no match, which is indicated by a match length of 0.
+
+    :param out: The output buffer
+    :type out:  ``bytearray``
+
+    :param literals: The literal bytes
+    :type literals:  ``bytes``
+
+    :param offset: The offset of the match
+    :type offset:  ``int``
+
+    :param match: The match length (0 if there is no match)
+    :type match:  ``int``
+    """
+    size = len(literals)
+    extra = match-LZ4_MINMATCH if match else 0
+    out.append((min(size,15) << 4) | min(extra,15))
+    if size >= 15:
+        lz4_length(out,size-15)
+    out += literals
+    if match:
+        out += struct.pack('<H',offset)
+        if extra >= 15:
+            lz4_length(out,extra-15)
+
+
+def lz4_compress_python(data):
+    """
+    Returns the data compressed as an LZ4 block
+
+    This is a simple greedy compressor, with a table of the last position for
+    each four byte prefix. The output is a standard LZ4 block (with no frame or
+    size header).
+
+    :param data: The data to compress
+    :type data:  ``bytes``
+
+    :return: The data compressed as an LZ4 block
+    :rtype:  ``bytes``
+    """
+    out = bytearray()
+    size = len(data)
+    table = {}
+    anchor = 0
+    pos = 0
+    limit = size-LZ4_MFLIMIT
+    while pos < limit:
+        key = data[pos:pos+LZ4_MINMATCH]
+        prev = table.get(key)
+        table[key] = pos
+        if prev is None or pos-prev > LZ4_MAXOFFSET:
+            pos += 1
+            continue
+
+        match = LZ4_MINMATCH
+        most = size-LZ4_LASTLITERALS-pos
+        while match < most and data[prev+match] == data[pos+match]:
+            match += 1
+        lz4_sequence(out,data[anchor:pos],pos-prev,match)
+        pos += match
+        anchor = pos
+
+    lz4_sequence(out,data[anchor:],0,0)
+    return bytes(out)
+
+
+def lz4_compress(data):
+    """
+    Returns the data compressed as an LZ4 block
+
+    This uses the lz4 package if it is available.
+
+    :param data: The data to compress
+    :type data:  ``bytes``
+
+    :return: The data compressed as an LZ4 block
+    :rtype:  ``bytes``
+    """
+    try:
+        import lz4.block
+        return lz4.block.compress(data,mode='high_compression',store_size=False)
+    except ImportError:
+        return lz4_compress_python(data)
+
+
+#mark ASSET COLLECTION
+
+def directory_files(root,directory):
+    """
+    Returns the asset files referenced by the given JSON asset directory
+
+    An asset is either a string (the path to the file) or an object with a "file"
+    attribute. Entries without a file (such as inline scene graphs) are ignored,
+    as are files that do not exist. The directory itself is included as well.
+
+    :param root: The asset folder
+    :type root:  ``str``
+
+    :param directory: The path to the JSON directory, relative to the asset folder
+    :type directory:  ``str``
+
+    :return: The asset files referenced by the given JSON asset directory
+    :rtype:  ``list`` of ``str``
+    """
+    with open(os.path.join(root,directory), encoding = 'utf-8') as file:
+        contents = json.load(file)
+
+    result = [directory]
+    for category in contents.values():
+        if type(category) != dict:
+            continue
+        for entry in category.values():
+            path = None
+            if type(entry) == str:
+                path = entry
+            elif type(entry) == dict and type(entry.get('file')) == str:
+                path = entry['file']
+            if path and os.path.isfile(os.path.join(root,path)):
+                result.append(path)
+    return result
+
+
+def folder_files(root,exclude):
+    """
+    Returns every file in the asset folder
+
+    Hidden files and existing bundles are skipped.
+
+    :param root: The asset folder
+    :type root:  ``str``
+
+    :param exclude: The path of the output bundle (to skip)
+    :type exclude:  ``str``
+
+    :return: Every file in the asset folder
+    :rtype:  ``list`` of ``str``
+    """
+    result = []
+    for (dirpath, dirnames, filenames) in os.walk(root):
+        dirnames[:] = [d for d in dirnames if not d.startswith('.')]
+        for name in filenames:
+            path = os.path.join(dirpath,name)
+            if name.startswith('.') or name.endswith('.bundle'):
+                continue
+            if os.path.abspath(path) == os.path.abspath(exclude):
+                continue
+            result.append(os.path.relpath(path,root))
+    return result
+
+
+#mark BUNDLE CREATION
+
+def pack(root,paths,output,compress=False,alignment=16):
+    """
+    Writes the given asset files to a bundle
+
+    :param root: The asset folder
+    :type root:  ``str``
+
+    :param paths: The asset files, relative to the asset folder
+    :type paths:  ``list`` of ``str``
+
+    :param output: The bundle file to write
+    :type output:  ``str``
+
+    :param compress: Whether to compress entries with LZ4
+    :type compress:  ``bool``
+
+    :param alignment: The alignment of each entry
+    :type alignment:  ``int``
+
+    :return: The number of bytes of the assets and of the bundle
+    :rtype:  ``tuple`` of ``int``
+    """
+    paths = sorted(set(path.replace(os.sep,'/') for path in paths))
+    records = []
+    total = 0
+    with open(output,'wb') as file:
+        file.write(bytes(40))
+        for path in paths:
+            with open(os.path.join(root,path),'rb') as source:
+                data = source.read()
+            total += len(data)
+
+            scheme = SCHEME_NONE
+            stored = data
+            if compress and data:
+                packed = lz4_compress(data)
+                if len(packed) <= len(data)-len(data)//8:
+                    scheme = SCHEME_LZ4
+                    stored = packed
+
+            offset = file.tell()
+            if offset % alignment:
+                file.write(bytes(alignment - offset % alignment))
+                offset = file.tell()
+            file.write(stored)
+
+            name = path.encode('utf-8')
+            records.append(struct.pack('<QQQIH',offset,len(stored),len(data),scheme,len(name))+name)
+
+        index = file.tell()
+        for record in records:
+            file.write(record)
+        length = file.tell()-index
+
+        file.seek(0)
+        file.write(MAGIC+struct.pack('<IIIIQQ',VERSION,alignment,len(records),0,index,length))
+
+    return (total, os.path.getsize(output))
+
+
+def main():
+    """
+    Runs the bundle packer from the command line
+    """
+    parser = argparse.ArgumentParser(description='Pack CUGL assets into a bundle.')
+    parser.add_argument('assets', type=str, help='The asset folder')
+    parser.add_argument('-d', '--directory', type=str, action='append',
+                        help='A JSON asset directory to pack (relative to the asset folder)')
+    parser.add_argument('-o', '--output', type=str, default='assets.bundle',
+                        help='The bundle file (relative to the asset folder)')
+    parser.add_argument('-z', '--compress', action='store_true',
+                        help='Compress entries with LZ4 when it helps')
+    parser.add_argument('-a', '--align', type=int, default=16,
+                        help='The alignment of each entry')
+    args = parser.parse_args()
+
+    if args.align <= 0:
+        parser.error('the alignment must be positive')
+
+    root = args.assets
+    output = os.path.join(root,args.output)
+    if args.directory:
+        paths = []
+        for directory in args.directory:
+            paths.extend(directory_files(root,directory))
+    else:
+        paths = folder_files(root,output)
+
+    (total, size) = pack(root,paths,output,args.compress,args.align)
+    print('Packed %d files (%d bytes) into %s (%d bytes)' % (len(set(paths)),total,output,size))
+
+
+if __name__ == '__main__':
+    main()
@@ -41,6 +41,7 @@
 //  Version: 7/3/24 (CUGL 3.0 reorganization)
 //
 #include <cugl/audio/CUAudioDecoder.h>
+#include <cugl/core/assets/CUAssetBundle.h>
 #include <cugl/core/util/CUDebug.h>
 
 using namespace cugl;
@@ -130,6 +131,62 @@ bool AudioDecoder::init(const std::string file, AudioType type) {
     return true;
 }
 
+/**
+ * Initializes a new decoder for a file in the given asset bundle.
+ *
+ * The decoder reads the file directly from the bundle. It does not need
+ * the bundle to remain loaded. If the audio type is not correct for this
+ * file, this initializer will fail and return false.
+ *
+ * @param bundle    the asset bundle with the source file
+ * @param file      the path of the source file in the bundle
+ * @param type      the codec type for this file
+ *
+ * @return true if the decoder was initialized successfully
+ */
+bool AudioDecoder::init(const std::shared_ptr<AssetBundle>& bundle, const std::string file, AudioType type) {
+    SDL_RWops* stream = bundle->open(file);
+    if (stream == NULL) {
+        CULogError("File %s is not in bundle %s.",file.c_str(),bundle->getFile().c_str());
+        return false;
+    }
+    
+    // The source owns the stream, which keeps the bundle data alive
+    switch(type) {
+    case AudioType::WAV_FILE:
+        _source = ATK_LoadWAV_RW(stream,1);
+        break;
+    case AudioType::MP3_FILE:
+        _source = ATK_LoadMP3_RW(stream,1);
+        break;
+    case AudioType::OGG_FILE:
+        _source = ATK_LoadVorbis_RW(stream,1);
+        break;
+    case AudioType::FLAC_FILE:
+        _source = ATK_LoadFLAC_RW(stream,1);
+        break;
+    default:
+        SDL_RWclose(stream);
+        CULogError("No decoder support for type %s", audio::typeName(type).c_str());
+        return false;
+    }
+    if (_source == NULL) {
+        CULogError("File %s is not a valid %s.",file.c_str(),audio::typeName(type).c_str());
+        return false;
+    }
+    _file = file;
+    _type = type;
+ 
+    _channels = _source->metadata.channels;
+    _rate   = _source->metadata.rate;
+    _frames = _source->metadata.frames;
+
+    _pagesize = ATK_GetSourcePageSize(_source);
+    _lastpage = ATK_GetSourceLastPage(_source);
+    _currpage = 0;
+    return true;
+}
+
 /**
  * Deletes the decoder resources and resets all attributes.
  *
@@ -50,6 +50,7 @@
 #include <cugl/audio/graph/CUAudioPlayer.h>
 #include <cugl/core/util/CUDebug.h>
 #include <cugl/core/util/CUFiletools.h>
+#include <cugl/core/assets/CUAssetBundle.h>
 
 using namespace cugl;
 using namespace cugl::audio;
@@ -109,6 +110,53 @@ bool AudioSample::init(const std::string file, bool stream) {
     return true;
 }
 
+/**
+ * Initializes a new audio sample for a file in the given asset bundle.
+ *
+ * The choice of buffered or streaming is independent of the file type.
+ * If the file is streamed, it will not be loaded into memory.  Otherwise,
+ * this initializer will allocate memory to read the asset into memory.
+ *
+ * A streamed sample keeps a reference to the bundle, as each playback
+ * opens the file again.
+ *
+ * @param bundle    The asset bundle with the source file
+ * @param file      The path of the source file in the bundle
+ * @param stream    Wether to stream the audio from the file.
+ *
+ * @return true if the sound source was initialized successfully
+ */
+bool AudioSample::init(const std::shared_ptr<AssetBundle>& bundle, const std::string file, bool stream) {
+    if (bundle == nullptr || !bundle->contains(file)) {
+        CULogError("Cannot find file %s",file.c_str());
+        return false;
+    }
+    
+    _file = file;
+    _type = audio::guessType(file);
+    _stream = stream;
+    _bundle = bundle;
+    std::shared_ptr<AudioDecoder> decoder = getDecoder();
+    if (decoder == nullptr) {
+        CULogError("Could not open '%s': %s\n", file.c_str(), SDL_GetError());
+        _bundle = nullptr;
+        return false;
+    }
+    
+    _channels = decoder->getChannels();
+    _frames = decoder->getLength();
+    _rate   = decoder->getSampleRate();
+    
+    if (!_stream) {
+        // In-memory samples do not need the bundle after decoding
+        _bundle = nullptr;
+        _buffer = (float*)SDL_malloc((size_t)(_frames*_channels*sizeof(float)));
+        Sint64 size = decoder->decode(_buffer);
+        return size >= 0;
+    }
+    return true;
+}
+
 /**
  * Initializes an empty audio sample of the given size.
  *
@@ -177,6 +225,7 @@ void AudioSample::dispose() {
         _buffer = nullptr;
     }
     _type = AudioType::UNKNOWN;
+    _bundle = nullptr;
 }
 
 #pragma mark -
@@ -191,6 +240,9 @@ void AudioSample::dispose() {
  * @return a new decoder for this audio sample
  */
 std::shared_ptr<AudioDecoder> AudioSample::getDecoder() {
+    if (_bundle != nullptr) {
+        return AudioDecoder::alloc(_bundle,_file,_type);
+    }
     return AudioDecoder::alloc(_file,_type);
 }
 
@@ -48,6 +48,7 @@
 #include <cugl/audio/CUAudioSample.h>
 #include <cugl/audio/CUAudioWaveform.h>
 #include <cugl/audio/CUSoundLoader.h>
+#include <cugl/core/assets/CUAssetBundle.h>
 #include <cugl/audio/CUSound.h>
 #include <cugl/core/CUApplication.h>
 
@@ -74,6 +75,7 @@ SoundLoader::SoundLoader() : Loader<Sound>(),
 _volume(UNKNOWN_VOLUME) {
     _jsonKey  = "sounds";
     _priority = 1;
+    _concurrent = true;
 }
 
 
@@ -138,12 +140,13 @@ bool SoundLoader::read(const std::string key, const std::string source, LoaderCa
     std::string root = Application::get()->getAssetDirectory();
     std::string path = root+source;
     
+    std::shared_ptr<AssetBundle> bundle = findBundle(source);
     bool success = false;
     if (_loader == nullptr || !async) {
         enqueue(key);
         std::shared_ptr<Sound> sound = nullptr;
         if (audio::guessType(path) != AudioType::UNKNOWN) {
-            sound = AudioSample::alloc(path);
+            sound = (bundle == nullptr ? AudioSample::alloc(path) : AudioSample::alloc(bundle,source));
         }
         success = (sound != nullptr);
         if (success) {
@@ -151,19 +154,18 @@ bool SoundLoader::read(const std::string key, const std::string source, LoaderCa
             materialize(key,sound,callback);
         }
     } else {
-        _loader->addTask([=](void) {
-            this->enqueue(key);
+        enqueue(key);
+        addTask([=](void) {
             std::shared_ptr<Sound> sound = nullptr;
             if (audio::guessType(path) != AudioType::UNKNOWN) {
-                sound = AudioSample::alloc(path);
+                sound = (bundle == nullptr ? AudioSample::alloc(path) : AudioSample::alloc(bundle,source));
             }
             if (sound != nullptr) {
                 sound->setVolume(_volume);
-                Application::get()->schedule([=](void){
-                    this->materialize(key,sound,callback);
-                    return false;
-                });
             }
+            this->defer([=](void){
+                this->materialize(key,sound,callback);
+            });
         });
     }
     
@@ -202,13 +204,17 @@ bool SoundLoader::read(const std::shared_ptr<JsonValue>& json, LoaderCallback ca
     if (_assets.find(key) != _assets.end() || _queue.find(key) != _queue.end()) {
         return false;
     }
+    
+    std::string source = json->getString("file","");
+    bool stream = json->getBool("stream",false);
+    std::shared_ptr<AssetBundle> bundle = source.empty() ? nullptr : findBundle(source);
 
     bool success = false;
     if (_loader == nullptr || !async) {
         enqueue(key);
         std::shared_ptr<Sound> sound = nullptr;
         if (type == "sample") {
-            sound = AudioSample::allocWithData(json);
+            sound = (bundle == nullptr ? AudioSample::allocWithData(json) : AudioSample::alloc(bundle,source,stream));
         } else if (type == "waveform") {
             sound = AudioWaveform::allocWithData(json);
         }
@@ -218,21 +224,20 @@ bool SoundLoader::read(const std::shared_ptr<JsonValue>& json, LoaderCallback ca
             materialize(key,sound,callback);
         }
     } else {
-        _loader->addTask([=](void) {
-            this->enqueue(key);
+        enqueue(key);
+        addTask([=](void) {
             std::shared_ptr<Sound> sound = nullptr;
             if (type == "sample") {
-                sound = AudioSample::allocWithData(json);
+                sound = (bundle == nullptr ? AudioSample::allocWithData(json) : AudioSample::alloc(bundle,source,stream));
             } else if (type == "waveform") {
                 sound = AudioWaveform::allocWithData(json);
             }
             if (sound != nullptr) {
                 sound->setVolume(volume);
-                Application::get()->schedule([=](void) {
-                    this->materialize(key,sound,callback);
-                    return false;
-                });
             }
+            this->defer([=](void) {
+                this->materialize(key,sound,callback);
+            });
         });
     }
     
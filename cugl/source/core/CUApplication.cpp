@@ -78,7 +78,6 @@ _centered(true),
 _highdpi(true),
 _fps(0),
 _vsync(true),
-_funcid(0),
 _fixstep(0),
 _fixedCounter(0),
 _fixedRemainder(0),
@@ -375,6 +374,8 @@ void Application::quit() {
  * is safe to access the OpenGL context or any low-level SDL operations.
  * It will be executed after the input has been processed, but before
  * the main {@link update} thread.
+*
+* This method may be called from any thread, and it never blocks.
  *
  * @param callback  The callback function
  * @param time      The number of milliseconds to delay the callback.
@@ -382,15 +383,7 @@ void Application::quit() {
  * @return a unique identifier to unschedule the callback
  */
 Uint32 Application::schedule(std::function<bool()> callback, Uint32 time) {
-    scheduable item;
-    item.callback = callback;
-    item.period = time;
-    item.timer  = time;
-	{
-		std::unique_lock<std::mutex> lk(_queueMutex);
-		_callbacks.emplace(_funcid++, item);
-	}
-    return _funcid-1;
+    return _scheduler.schedule(std::move(callback), time, time);
 }
 
 /**
@@ -414,6 +407,8 @@ Uint32 Application::schedule(std::function<bool()> callback, Uint32 time) {
  * is safe to access the OpenGL context or any low-level SDL operations.
  * It will be executed after the input has been processed, but before
  * the main {@link update} thread.
+*
+* This method may be called from any thread, and it never blocks.
  *
  * @param callback  The callback function
  * @param time      The number of milliseconds to delay the callback.
@@ -421,15 +416,7 @@ Uint32 Application::schedule(std::function<bool()> callback, Uint32 time) {
  * @return a unique identifier to unschedule the callback
  */
 Uint32 Application::schedule(std::function<bool()> callback, Uint32 time, Uint32 period) {
-    scheduable item;
-    item.callback = callback;
-    item.period = period;
-    item.timer  = time;
-	{
-		std::unique_lock<std::mutex> lk(_queueMutex);
-		_callbacks.emplace(_funcid++, item);
-	}
-    return _funcid-1;
+    return _scheduler.schedule(std::move(callback), time, period);
 }
 
 /**
@@ -440,15 +427,18 @@ Uint32 Application::schedule(std::function<bool()> callback, Uint32 time, Uint32
  * be executed.  Once unscheduled, a callback must be re-scheduled in
  * order to be activated again.
  *
- * The callback is identified by its function pointer. Therefore, you
- * should be careful when scheduling anonymous closures.
+ * The callback is identified by the unique identifier returned by the
+ * appropriate schedule function.  Hence this value should be saved if
+ * you ever wish to unschedule a callback.
+ *
+ * The callback is removed at the start of the next animation frame. So a
+ * callback that is unscheduled by another callback in the same frame may
+ * still be executed in that frame.
+ *
+ * @param id    The callback identifier
  */
 void Application::unschedule(Uint32 id) {
-	std::unique_lock<std::mutex> lk(_queueMutex);
-    auto it = _callbacks.find(id);
-    if (it != _callbacks.end()) {
-        _callbacks.erase(it);
-    }
+    _scheduler.unschedule(id);
 }
 
 /**
@@ -457,41 +447,13 @@ void Application::unschedule(Uint32 id) {
  * This method wakes up any sleeping callbacks that should be executed.
  * If they are a one time callback, or if they return false, they are deleted.  
  * If they are a reoccuring callback and return true, the timer is reset.
+ * Callbacks with the same deadline are executed in the order that they
+ * were scheduled.
  *
  * @param millis    The number of milliseconds since last called
  */
 void Application::processCallbacks(Uint32 millis) {
-	std::vector<Uint32> indeces;
-	std::vector<scheduable> actives;
-	{
-		std::unique_lock<std::mutex> lk(_queueMutex);
-		for (auto it = _callbacks.begin(); it != _callbacks.end(); ++it) {
-			if (it->second.timer < millis) {
-				indeces.push_back(it->first);
-				actives.push_back(it->second);
-				it->second.timer -= std::min(it->second.timer, millis);
-				it->second.timer += it->second.period;
-			} else {
-				it->second.timer -= millis;
-			}
-		}
-	}
-
-	// These can take a while, so do them outside lock
-	for (int ii = 0; ii < actives.size(); ii++) {
-		if (actives[ii].callback()) {
-			indeces[ii] = (Uint32)-1;
-		}
-	}
-
-	{
-		std::unique_lock<std::mutex> lk(_queueMutex);
-		for (auto it = indeces.begin(); it != indeces.end(); ++it) {
-			if (*it != (Uint32)-1) {
-				_callbacks.erase(*it);
-			}
-		}
-	}
+    _scheduler.update(millis);
 }
 
 
@@ -0,0 +1,824 @@
+//
+//  CUAssetBundle.cpp
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides support for asset bundles. A bundle is a single file
+//  that packs many asset files (textures, fonts, sounds, json and widgets)
+//  with an index. Opening one bundle replaces a file open for every asset,
+//  which is the dominant cost of loading many small assets on mobile storage.
+//
+//  Bundles are created with the packer in cugl/scripts/bundle.py. At runtime
+//  the bundle is memory mapped (where the platform allows it), and loaders
+//  read each asset as a view into that memory. Entries may optionally be
+//  compressed with the LZ4 block format, in which case they are decompressed
+//  when opened.
+//
+//  This class uses our standard shared-pointer architecture.
+//
+//  1. The constructor does not perform any initialization; it just sets all
+//     attributes to their defaults.
+//
+//  2. All initialization takes place via init methods, which can fail if an
+//     object is initialized more than once.
+//
+//  3. All allocation takes place via static constructors which return a shared
+//     pointer.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Kidus Zegeye
+//  Version: 3/9/25
+//
+#include <cugl/core/assets/CUAssetBundle.h>
+#include <cugl/core/assets/CUJsonValue.h>
+#include <cugl/core/util/CUFiletools.h>
+#include <cugl/core/util/CUDebug.h>
+#include <cugl/core/CUApplication.h>
+#include <cstring>
+
+#if defined (__WINDOWS__)
+    #include <windows.h>
+#elif !defined (__ANDROID__)
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+using namespace cugl;
+
+/** The magic number at the start of every bundle */
+#define BUNDLE_MAGIC    "CUBUNDLE"
+/** The size of the bundle header */
+#define HEADER_SIZE     40
+/** The size of an index record (without the path) */
+#define RECORD_SIZE     30
+
+#pragma mark -
+#pragma mark Internal Helpers
+/**
+ * Returns the little-endian Uint16 at the given position
+ *
+ * @param data  The position to read
+ *
+ * @return the little-endian Uint16 at the given position
+ */
+static Uint16 read16(const Uint8* data) {
+    Uint16 value;
+    std::memcpy(&value, data, sizeof(value));
+    return SDL_SwapLE16(value);
+}
+
+/**
+ * Returns the little-endian Uint32 at the given position
+ *
+ * @param data  The position to read
+ *
+ * @return the little-endian Uint32 at the given position
+ */
+static Uint32 read32(const Uint8* data) {
+    Uint32 value;
+    std::memcpy(&value, data, sizeof(value));
+    return SDL_SwapLE32(value);
+}
+
+/**
+ * Returns the little-endian Uint64 at the given position
+ *
+ * @param data  The position to read
+ *
+ * @return the little-endian Uint64 at the given position
+ */
+static Uint64 read64(const Uint8* data) {
+    Uint64 value;
+    std::memcpy(&value, data, sizeof(value));
+    return SDL_SwapLE64(value);
+}
+
+/**
+ * Returns the given path in the form used by the bundle index
+ *
+ * Bundle paths use / as a separator, and have no leading ./ or /.
+ *
+ * @param path  The path relative to the asset directory
+ *
+ * @return the given path in the form used by the bundle index
+ */
+static std::string bundle_path(const std::string path) {
+    std::string result = path;
+    for(auto it = result.begin(); it != result.end(); ++it) {
+        if (*it == '\\') {
+            *it = '/';
+        }
+    }
+    size_t pos = 0;
+    while (pos < result.size()) {
+        if (result.compare(pos, 2, "./") == 0) {
+            pos += 2;
+        } else if (result[pos] == '/') {
+            pos++;
+        } else {
+            break;
+        }
+    }
+    return pos == 0 ? result : result.substr(pos);
+}
+
+/**
+ * Reads the length extension of an LZ4 sequence
+ *
+ * LZ4 lengths of 15 or more continue with bytes that are added to the length
+ * until a byte is less than 255.
+ *
+ * @param pos   The position to read (updated on return)
+ * @param end   The end of the input
+ * @param len   The length to extend
+ *
+ * @return true if the length was read successfully
+ */
+static bool lz4_length(const Uint8*& pos, const Uint8* end, size_t& len) {
+    Uint8 next;
+    do {
+        if (pos >= end) {
+            return false;
+        }
+        next = *pos++;
+        len += next;
+    } while (next == 255);
+    return true;
+}
+
+/**
+ * Decompresses an LZ4 block into the given buffer
+ *
+ * The output buffer must be exactly the size of the decompressed data. This
+ * method checks every read and write, so corrupt data fails safely.
+ *
+ * @param src       The compressed block
+ * @param srclen    The size of the compressed block
+ * @param dst       The output buffer
+ * @param dstlen    The size of the decompressed data
+ *
+ * @return true if the block was decompressed successfully
+ */
+static bool lz4_decode(const Uint8* src, size_t srclen, Uint8* dst, size_t dstlen) {
+    const Uint8* ip = src;
+    const Uint8* iend = src+srclen;
+    Uint8* op = dst;
+    Uint8* oend = dst+dstlen;
+
+    while (ip < iend) {
+        Uint8 token = *ip++;
+
+        // Copy the literals
+        size_t len = token >> 4;
+        if (len == 15 && !lz4_length(ip, iend, len)) {
+            return false;
+        }
+        if ((size_t)(iend-ip) < len || (size_t)(oend-op) < len) {
+            return false;
+        }
+        std::memcpy(op, ip, len);
+        ip += len;
+        op += len;
+
+        // The last sequence has no match
+        if (ip == iend) {
+            break;
+        }
+
+        // Copy the match
+        if (iend-ip < 2) {
+            return false;
+        }
+        size_t offset = read16(ip);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op-dst)) {
+            return false;
+        }
+        len = token & 15;
+        if (len == 15 && !lz4_length(ip, iend, len)) {
+            return false;
+        }
+        len += 4;
+        if ((size_t)(oend-op) < len) {
+            return false;
+        }
+        const Uint8* match = op-offset;
+        if (offset >= len) {
+            std::memcpy(op, match, len);
+            op += len;
+        } else {
+            // Overlapping copies repeat the pattern
+            for(size_t ii = 0; ii < len; ii++) {
+                *op++ = *match++;
+            }
+        }
+    }
+    return op == oend;
+}
+
+#pragma mark -
+#pragma mark Archive Region
+/**
+ * The contents of a bundle archive.
+ *
+ * The region is shared between the bundle and any streams opened from it, so
+ * the archive stays mapped until all of them are released.
+ */
+class AssetBundle::Region {
+public:
+    /** The start of the archive */
+    const Uint8* base;
+    /** The size of the archive in bytes */
+    size_t size;
+    /** Whether the archive is memory mapped (as opposed to read) */
+    bool mapped;
+#if defined (__WINDOWS__)
+    /** The file handle for the mapping */
+    HANDLE file;
+    /** The mapping handle */
+    HANDLE mapping;
+#endif
+
+    /**
+     * Creates an empty region
+     */
+    Region() : base(nullptr), size(0), mapped(false) {
+#if defined (__WINDOWS__)
+        file = INVALID_HANDLE_VALUE;
+        mapping = NULL;
+#endif
+    }
+
+    /**
+     * Deletes this region, releasing the archive
+     */
+    ~Region() {
+        if (base == nullptr) {
+            return;
+        } else if (!mapped) {
+            SDL_free((void*)base);
+            return;
+        }
+#if defined (__WINDOWS__)
+        UnmapViewOfFile(base);
+        CloseHandle(mapping);
+        CloseHandle(file);
+#elif !defined (__ANDROID__)
+        munmap((void*)base, size);
+#endif
+    }
+
+    /**
+     * Memory maps the given archive
+     *
+     * This method fails on platforms without memory mapping, or if the file
+     * cannot be mapped.
+     *
+     * @param path  The absolute path to the archive
+     *
+     * @return true if the archive was mapped
+     */
+    bool map(const std::string path) {
+#if defined (__WINDOWS__)
+        int wlen = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, NULL, 0);
+        std::wstring wpath(wlen, 0);
+        MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wpath[0], wlen);
+        file = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER length;
+        if (!GetFileSizeEx(file, &length) || length.QuadPart == 0) {
+            CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+            return false;
+        }
+        mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL) {
+            CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+            return false;
+        }
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (view == NULL) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            mapping = NULL;
+            file = INVALID_HANDLE_VALUE;
+            return false;
+        }
+        base = (const Uint8*)view;
+        size = (size_t)length.QuadPart;
+        mapped = true;
+        return true;
+#elif defined (__ANDROID__)
+        // Assets are inside the APK
+        return false;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED) {
+            return false;
+        }
+        base = (const Uint8*)view;
+        size = (size_t)info.st_size;
+        mapped = true;
+        return true;
+#endif
+    }
+
+    /**
+     * Reads the given archive into memory
+     *
+     * This is the fallback for when the archive cannot be mapped.
+     *
+     * @param path  The absolute path to the archive
+     *
+     * @return true if the archive was read
+     */
+    bool read(const std::string path) {
+        SDL_RWops* source = SDL_RWFromFile(path.c_str(), "rb");
+        if (source == nullptr) {
+            return false;
+        }
+        Sint64 length = SDL_RWsize(source);
+        if (length <= 0) {
+            SDL_RWclose(source);
+            return false;
+        }
+        Uint8* buffer = (Uint8*)SDL_malloc((size_t)length);
+        size_t amt = buffer == nullptr ? 0 : SDL_RWread(source, buffer, 1, (size_t)length);
+        SDL_RWclose(source);
+        if (amt != (size_t)length) {
+            SDL_free(buffer);
+            return false;
+        }
+        base = buffer;
+        size = (size_t)length;
+        mapped = false;
+        return true;
+    }
+};
+
+#pragma mark -
+#pragma mark Bundle Streams
+/**
+ * The state of a stream opened from a bundle.
+ *
+ * This is a read-only memory stream (like SDL_RWFromConstMem), except that
+ * it also owns the memory it reads. That is either a reference to the
+ * archive, or the buffer for a decompressed entry.
+ */
+class BundleStream {
+public:
+    /** The archive reference, to keep the view alive */
+    std::shared_ptr<void> archive;
+    /** The decompressed buffer (nullptr if a view into the archive) */
+    Uint8* buffer;
+    /** The start of the stream */
+    const Uint8* base;
+    /** The current position of the stream */
+    const Uint8* here;
+    /** The end of the stream */
+    const Uint8* stop;
+
+    /**
+     * Deletes this stream state, releasing its memory
+     */
+    ~BundleStream() {
+        if (buffer != nullptr) {
+            SDL_free(buffer);
+        }
+    }
+};
+
+/**
+ * Returns the size of the stream
+ *
+ * @param context   The stream
+ *
+ * @return the size of the stream
+ */
+static Sint64 SDLCALL bundle_size(SDL_RWops* context) {
+    BundleStream* stream = (BundleStream*)context->hidden.unknown.data1;
+    return (Sint64)(stream->stop-stream->base);
+}
+
+/**
+ * Seeks to the given position in the stream
+ *
+ * @param context   The stream
+ * @param offset    The offset to seek
+ * @param whence    The seek origin (RW_SEEK_SET, RW_SEEK_CUR, or RW_SEEK_END)
+ *
+ * @return the new position of the stream
+ */
+static Sint64 SDLCALL bundle_seek(SDL_RWops* context, Sint64 offset, int whence) {
+    BundleStream* stream = (BundleStream*)context->hidden.unknown.data1;
+    const Uint8* origin;
+    switch (whence) {
+        case RW_SEEK_SET:
+            origin = stream->base;
+            break;
+        case RW_SEEK_CUR:
+            origin = stream->here;
+            break;
+        case RW_SEEK_END:
+            origin = stream->stop;
+            break;
+        default:
+            return SDL_SetError("Unknown value for 'whence'");
+    }
+    Sint64 limit = (Sint64)(stream->stop-stream->base);
+    Sint64 position = (Sint64)(origin-stream->base)+offset;
+    if (position < 0) {
+        position = 0;
+    } else if (position > limit) {
+        position = limit;
+    }
+    stream->here = stream->base+position;
+    return position;
+}
+
+/**
+ * Reads objects from the stream
+ *
+ * @param context   The stream
+ * @param ptr       The buffer to read into
+ * @param size      The size of each object
+ * @param maxnum    The maximum number of objects to read
+ *
+ * @return the number of objects read
+ */
+static size_t SDLCALL bundle_read(SDL_RWops* context, void* ptr, size_t size, size_t maxnum) {
+    BundleStream* stream = (BundleStream*)context->hidden.unknown.data1;
+    if (size == 0) {
+        return 0;
+    }
+    size_t avail = (size_t)(stream->stop-stream->here);
+    size_t total = (maxnum*size > avail ? avail/size : maxnum)*size;
+    std::memcpy(ptr, stream->here, total);
+    stream->here += total;
+    return total/size;
+}
+
+/**
+ * Fails to write to the stream (bundle streams are read-only)
+ *
+ * The arguments are those of SDL_RWwrite, and are all ignored.
+ *
+ * @return 0, as nothing is written
+ */
+static size_t SDLCALL bundle_write(SDL_RWops*, const void*, size_t, size_t) {
+    SDL_SetError("Asset bundle streams are read-only");
+    return 0;
+}
+
+/**
+ * Closes the stream, releasing its memory
+ *
+ * @param context   The stream
+ *
+ * @return 0 on success
+ */
+static int SDLCALL bundle_close(SDL_RWops* context) {
+    if (context != nullptr) {
+        delete (BundleStream*)context->hidden.unknown.data1;
+        SDL_FreeRW(context);
+    }
+    return 0;
+}
+
+#pragma mark -
+#pragma mark Constructors
+/**
+ * Disposes all of the resources used by this asset bundle.
+ *
+ * The archive is unmapped once every stream from {@link open} is closed.
+ * A disposed bundle can be safely reinitialized.
+ */
+void AssetBundle::dispose() {
+    _entries.clear();
+    _region = nullptr;
+    _file.clear();
+}
+
+/**
+ * Initializes an asset bundle from the given archive.
+ *
+ * A relative path is interpreted as relative to the asset directory. This
+ * method reads the index of the archive, but not the entries. It fails if
+ * the archive is missing, corrupt, or has an unsupported version.
+ *
+ * @param file  The path to the bundle archive
+ *
+ * @return true if the bundle was initialized successfully
+ */
+bool AssetBundle::init(const std::string file) {
+    if (_region != nullptr) {
+        CUAssertLog(false, "Bundle %s is already initialized", _file.c_str());
+        return false;
+    }
+
+    std::string path = file;
+    if (!filetool::is_absolute(file)) {
+        path = Application::get()->getAssetDirectory()+file;
+    }
+
+    std::shared_ptr<Region> region = std::make_shared<Region>();
+    if (!region->map(path) && !region->read(path)) {
+        CULogError("Could not open asset bundle '%s'", file.c_str());
+        return false;
+    }
+
+    // Validate the header
+    const Uint8* base = region->base;
+    if (region->size < HEADER_SIZE || std::memcmp(base, BUNDLE_MAGIC, 8) != 0) {
+        CULogError("File '%s' is not an asset bundle", file.c_str());
+        return false;
+    }
+    Uint32 version = read32(base+8);
+    if (version != VERSION) {
+        CULogError("Asset bundle '%s' has unsupported version %u", file.c_str(), version);
+        return false;
+    }
+    Uint32 count  = read32(base+16);
+    Uint64 offset = read64(base+24);
+    Uint64 length = read64(base+32);
+    if (offset < HEADER_SIZE || offset > region->size || length > region->size-offset) {
+        CULogError("Asset bundle '%s' has a corrupt index", file.c_str());
+        return false;
+    }
+
+    // Read the index
+    const Uint8* pos = base+offset;
+    const Uint8* end = pos+length;
+    _entries.reserve(count);
+    for(Uint32 ii = 0; ii < count; ii++) {
+        if (end-pos < RECORD_SIZE) {
+            _entries.clear();
+            CULogError("Asset bundle '%s' has a corrupt index", file.c_str());
+            return false;
+        }
+        Entry entry;
+        entry.offset = read64(pos);
+        entry.stored = read64(pos+8);
+        entry.length = read64(pos+16);
+        Uint32 scheme = read32(pos+24);
+        Uint16 size = read16(pos+28);
+        pos += RECORD_SIZE;
+
+        bool valid = (size_t)(end-pos) >= size && scheme <= (Uint32)Compression::LZ4;
+        valid = valid && entry.offset <= region->size && entry.stored <= region->size-entry.offset;
+        valid = valid && (scheme != (Uint32)Compression::NONE || entry.stored == entry.length);
+        if (!valid) {
+            _entries.clear();
+            CULogError("Asset bundle '%s' has a corrupt index", file.c_str());
+            return false;
+        }
+        entry.compression = (Compression)scheme;
+        _entries.emplace(std::string((const char*)pos, size), entry);
+        pos += size;
+    }
+
+    _file = file;
+    _region = region;
+    return true;
+}
+
+#pragma mark -
+#pragma mark Attributes
+/**
+ * Returns true if the archive is memory mapped.
+ *
+ * If this value is false, the archive was read into memory instead.
+ *
+ * @return true if the archive is memory mapped.
+ */
+bool AssetBundle::isMapped() const {
+    return _region != nullptr && _region->mapped;
+}
+
+/**
+ * Returns the paths of the files in this bundle
+ *
+ * @return the paths of the files in this bundle
+ */
+std::vector<std::string> AssetBundle::paths() const {
+    std::vector<std::string> result;
+    result.reserve(_entries.size());
+    for(auto it = _entries.begin(); it != _entries.end(); ++it) {
+        result.push_back(it->first);
+    }
+    return result;
+}
+
+#pragma mark -
+#pragma mark File Access
+/**
+ * Returns the entry for the given path (or nullptr if there is none)
+ *
+ * @param path  The path relative to the asset directory
+ *
+ * @return the entry for the given path (or nullptr if there is none)
+ */
+const AssetBundle::Entry* AssetBundle::find(const std::string path) const {
+    auto it = _entries.find(bundle_path(path));
+    return it == _entries.end() ? nullptr : &(it->second);
+}
+
+/**
+ * Returns a newly allocated buffer with the decompressed entry.
+ *
+ * The buffer should be freed with SDL_free. This method returns nullptr
+ * if the entry data is corrupt.
+ *
+ * @param entry The entry to decompress
+ *
+ * @return a newly allocated buffer with the decompressed entry.
+ */
+Uint8* AssetBundle::decompress(const Entry* entry) const {
+    // Always allocate something, even for an empty entry
+    Uint8* buffer = (Uint8*)SDL_malloc(entry->length > 0 ? (size_t)entry->length : 1);
+    if (buffer == nullptr) {
+        return nullptr;
+    }
+    const Uint8* source = _region->base+entry->offset;
+    if (!lz4_decode(source, (size_t)entry->stored, buffer, (size_t)entry->length)) {
+        SDL_free(buffer);
+        return nullptr;
+    }
+    return buffer;
+}
+
+/**
+ * Returns true if the given file is compressed in this bundle.
+ *
+ * @param path  The path relative to the asset directory
+ *
+ * @return true if the given file is compressed in this bundle.
+ */
+bool AssetBundle::isCompressed(const std::string path) const {
+    const Entry* entry = find(path);
+    return entry != nullptr && entry->compression != Compression::NONE;
+}
+
+/**
+ * Returns the size in bytes of the given file (0 if it is not present)
+ *
+ * This is the size of the file once decompressed.
+ *
+ * @param path  The path relative to the asset directory
+ *
+ * @return the size in bytes of the given file (0 if it is not present)
+ */
+size_t AssetBundle::length(const std::string path) const {
+    const Entry* entry = find(path);
+    return entry == nullptr ? 0 : (size_t)entry->length;
+}
+
+/**
+ * Returns a view of the contents of the given file.
+ *
+ * This view is a pointer into the archive, and is valid until the bundle
+ * is disposed. It is nullptr if the file is not present, or if the file
+ * is compressed (in which case you should use {@link open} instead).
+ *
+ * @param path  The path relative to the asset directory
+ *
+ * @return a view of the contents of the given file.
+ */
+const Uint8* AssetBundle::data(const std::string path) const {
+    const Entry* entry = find(path);
+    if (entry == nullptr || entry->compression != Compression::NONE) {
+        return nullptr;
+    }
+    return _region->base+entry->offset;
+}
+
+/**
+ * Returns a read-only stream for the given file.
+ *
+ * For an uncompressed file, the stream is a view into the archive and
+ * does not copy the file. A compressed file is decompressed into a buffer
+ * owned by the stream. Either way, the stream keeps the archive alive
+ * until it is closed, so it may outlive this bundle.
+ *
+ * The stream should be closed with SDL_RWclose (or passed to an SDL
+ * function that takes ownership of it). This method returns nullptr if
+ * the file is not present or is corrupt.
+ *
+ * @param path  The path relative to the asset directory
+ *
+ * @return a read-only stream for the given file.
+ */
+SDL_RWops* AssetBundle::open(const std::string path) const {
+    const Entry* entry = find(path);
+    if (entry == nullptr) {
+        return nullptr;
+    }
+
+    BundleStream* stream = new BundleStream();
+    stream->buffer = nullptr;
+    if (entry->compression == Compression::NONE) {
+        stream->archive = _region;
+        stream->base = _region->base+entry->offset;
+    } else {
+        stream->buffer = decompress(entry);
+        if (stream->buffer == nullptr) {
+            CULogError("Asset bundle entry '%s' is corrupt", path.c_str());
+            delete stream;
+            return nullptr;
+        }
+        stream->base = stream->buffer;
+    }
+    stream->here = stream->base;
+    stream->stop = stream->base+entry->length;
+
+    SDL_RWops* result = SDL_AllocRW();
+    if (result == nullptr) {
+        delete stream;
+        return nullptr;
+    }
+    result->type  = SDL_RWOPS_UNKNOWN;
+    result->size  = bundle_size;
+    result->seek  = bundle_seek;
+    result->read  = bundle_read;
+    result->write = bundle_write;
+    result->close = bundle_close;
+    result->hidden.unknown.data1 = stream;
+    return result;
+}
+
+/**
+ * Returns the contents of the given file as a string.
+ *
+ * The string is empty if the file is not present or is corrupt.
+ *
+ * @param path  The path relative to the asset directory
+ *
+ * @return the contents of the given file as a string.
+ */
+std::string AssetBundle::readText(const std::string path) const {
+    const Entry* entry = find(path);
+    if (entry == nullptr) {
+        return "";
+    } else if (entry->compression == Compression::NONE) {
+        return std::string((const char*)(_region->base+entry->offset), (size_t)entry->length);
+    }
+
+    Uint8* buffer = decompress(entry);
+    if (buffer == nullptr) {
+        CULogError("Asset bundle entry '%s' is corrupt", path.c_str());
+        return "";
+    }
+    std::string result((const char*)buffer, (size_t)entry->length);
+    SDL_free(buffer);
+    return result;
+}
+
+/**
+ * Returns the contents of the given file as a JSON value.
+ *
+ * This method returns nullptr if the file is not present or if it is
+ * not a valid JSON file.
+ *
+ * @param path  The path relative to the asset directory
+ *
+ * @return the contents of the given file as a JSON value.
+ */
+std::shared_ptr<JsonValue> AssetBundle::readJson(const std::string path) const {
+    if (!contains(path)) {
+        return nullptr;
+    }
+    return JsonValue::allocWithJson(readText(path));
+}
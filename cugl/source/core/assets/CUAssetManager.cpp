@@ -47,29 +47,110 @@
 //
 #include <cugl/core/assets/CUAssetManager.h>
 #include <cugl/core/io/CUJsonReader.h>
+#include <cugl/core/util/CUFiletools.h>
+#include <cugl/core/util/CUTimestamp.h>
 #include <cugl/core/CUApplication.h>
+#include <map>
 
 using namespace cugl;
 
+/**
+ * Returns the size in bytes of the asset for the given directory entry.
+ *
+ * The size of an asset is the size of its file. Entries without a file
+ * (such as inline scene graphs) have the size of their JSON. Every asset
+ * has size at least 1, so that it always counts towards the progress.
+ *
+ * @param manager   The asset manager with the mounted bundles
+ * @param json      The directory entry for the asset
+ *
+ * @return the size in bytes of the asset for the given directory entry.
+ */
+static size_t asset_bytes(const AssetManager* manager, const std::shared_ptr<JsonValue>& json) {
+    std::string path;
+    if (json->isString()) {
+        path = json->asString();
+    } else if (json->has("file")) {
+        path = json->getString("file");
+    }
+    if (path.empty()) {
+        return std::max((size_t)1, json->toString(false).size());
+    }
+    
+    std::shared_ptr<AssetBundle> bundle = manager->findBundle(path);
+    if (bundle != nullptr) {
+        return std::max((size_t)1, bundle->length(path));
+    }
+    
+    // SDL_RWsize is constant time (it does not read the file)
+    std::string root = Application::get()->getAssetDirectory();
+    SDL_RWops* rw = SDL_RWFromFile((root+path).c_str(), "rb");
+    if (rw == nullptr) {
+        return 1;
+    }
+    Sint64 size = SDL_RWsize(rw);
+    SDL_RWclose(rw);
+    return size > 0 ? (size_t)size : 1;
+}
+
+/**
+ * Returns the JSON asset directory at the given path
+ *
+ * If the directory is in the given bundle, it is read from the bundle.
+ * Otherwise it is read from the asset directory. This method returns
+ * nullptr if the directory is missing or is not valid JSON.
+ *
+ * @param bundle    The mounted bundle with the directory (may be nullptr)
+ * @param directory The path to the JSON asset directory
+ *
+ * @return the JSON asset directory at the given path
+ */
+static std::shared_ptr<JsonValue> read_directory(const std::shared_ptr<AssetBundle>& bundle,
+                                                 const std::string directory) {
+    if (bundle != nullptr) {
+        return bundle->readJson(directory);
+    }
+    std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(directory);
+    return reader == nullptr ? nullptr : reader->readJson();
+}
+
 #pragma mark -
 #pragma mark Constructors
 /**
- * Returns a newly allocated asset manager.
+ * Initializes a new asset manager.
  *
- * The asset manager has a single thread, as some of the asset loading
- * operations (particularly fonts) cannot be run in multiple threads
- * simultaneously. However, it will run in a distinct thread from the
- * main application. In addition, confining to one thread allows us to
- * handle dependencies between loaders.
+ * The asset manager has one worker thread for each core beyond the main
+ * thread (and at least one). Loaders that are not thread-safe (see
+ * {@link BaseLoader#isConcurrent}) still load one asset at a time, but
+ * they can run alongside the other loaders.
  *
- * This constructor does not attach any loaders. It simply creates an
+ * This initializer does not attach any loaders.  It simply creates an
  * object that is ready to accept loader objects.
  *
- * @return a newly allocated asset manager.
+ * @return true if the asset manager was initialized successfully
  */
 bool AssetManager::init() {
-    _workers = ThreadPool::alloc(1);
-    return true;
+    int cores = SDL_GetCPUCount();
+    return init(cores > 1 ? cores-1 : 1);
+}
+
+/**
+ * Initializes a new asset manager with the given number of threads.
+ *
+ * Loaders that are not thread-safe (see {@link BaseLoader#isConcurrent})
+ * still load one asset at a time, but they can run alongside the other
+ * loaders.
+ *
+ * This initializer does not attach any loaders.  It simply creates an
+ * object that is ready to accept loader objects.
+ *
+ * @param threads   The number of worker threads
+ *
+ * @return true if the asset manager was initialized successfully
+ */
+bool AssetManager::init(Uint32 threads) {
+    _workers = ThreadPool::alloc(threads > 0 ? (int)threads : 1);
+    return _workers != nullptr;
 }
 
 /**
@@ -80,6 +161,25 @@ bool AssetManager::init() {
  * threads) and reattach all loaders to use the asset manager again.
  */
 void AssetManager::dispose() {
+    // Stop the workers first, so that nothing new is deferred
+    if (_workers != nullptr) {
+        _workers->dispose();
+    }
+    {
+        std::unique_lock<std::mutex> lk(_deferMutex);
+        if (_updating && Application::get() != nullptr) {
+            Application::get()->unschedule(_updateKey);
+        }
+        _updating = false;
+        _deferred.clear();
+    }
+    _directories.clear();
+    {
+        std::unique_lock<std::mutex> lk(_bundleMutex);
+        _bundles.clear();
+    }
+    _totalBytes  = 0;
+    _loadedBytes = 0;
     detachAll();
     _workers = nullptr;
 }
@@ -132,45 +232,26 @@ bool AssetManager::readCategory(size_t hash, const std::shared_ptr<JsonValue>& j
 /**
  * Asynchronously reads an asset category from a JSON file
  *
- * JSON directories provide a robust way for us to load a collection of
- * assets. Instead of having to define parameters like asset key, font
- * size, or texture wrap in the code, we can specify them in a JSON file.
- * This JSON file (called the asset directory) is read by the asset manager,
- * and directs the various loaders to load in assets.
- *
- * Currently JSON loading supports five types of assets, with the following
- * names: "textures", "fonts", "music", "soundfx", and "jsons". See the
- * method {@link BaseLoader#read} in each of the individual loaders for a
- * description of the suported JSON format. A loader must still be attached
- * for the asset manager to read that type of asset. If the asset directory
- * contains an asset for which there is no attached asset manager, those
- * specific assets will not be loaded.
+ * This method is used by {@link loadDirectoryAsync} to start the assets
+ * of a category. The assets are preloaded on the worker threads, and
+ * materialized in the main thread. The callback of the directory is
+ * called each time an individual asset loads or fails to load. However,
+ * if there is no loader for the category, the callback function will be
+ * given the asset category name (e.g. "soundfx") as the asset key.
  *
- * As an asynchronous read, all asset loading will take place outside of
- * the main thread. However, assets such as fonts and textures will need
- * the OpenGL context to complete, so part of their asset loading may take
- * place in the main thread via the {@link Application#schedule} interface.
- * You may either poll this interface to determine when the assets are
- * loaded or use optional callbacks.
- *
- * The optional callback function will be called each time an individual
- * asset loads or fails to load. However, if the entire category fails
- * to load, the callback function will be given the asset category name
- * (e.g. "soundfx") as the asset key.
- *
- * @param hash      The hash of the asset type
- * @param json      The child of asset directory with these assets
- * @param callback  An optional callback after each asset is loaded
+ * @param directory The asset directory loading this category
+ * @param category  The category to read
  */
-void AssetManager::readCategory(size_t hash, const std::shared_ptr<JsonValue>& json,
-                                LoaderCallback callback) {
-    auto it = _handlers.find(hash);
-    std::shared_ptr<BaseLoader> loader = it->second;
+void AssetManager::readCategory(const std::shared_ptr<Directory>& directory,
+                                const Directory::Category& category) {
+    auto it = _handlers.find(category.hash);
+    std::shared_ptr<BaseLoader> loader = (it == _handlers.end() ? nullptr : it->second);
+    std::shared_ptr<JsonValue> json = category.json;
+    LoaderCallback callback = directory->callback;
     if (loader == nullptr) {
         if (callback) {
-            Application::get()->schedule([=] {
+            defer([=] {
                 callback(json->key(),false);
-                return false;
             });
         }
         return;
@@ -178,7 +259,14 @@ void AssetManager::readCategory(size_t hash, const std::shared_ptr<JsonValue>& j
     
     for(int ii = 0; ii < json->size(); ii++) {
         std::shared_ptr<JsonValue> child = json->get(ii);
-        loader->loadAsync(child, callback);
+        size_t bytes = category.bytes[ii];
+        loader->loadAsync(child, [=](const std::string key, bool success) {
+            directory->loaded += bytes;
+            _loadedBytes += bytes;
+            if (callback) {
+                callback(key,success);
+            }
+        });
     }
 }
 
@@ -216,29 +304,226 @@ bool AssetManager::purgeCategory(size_t hash, const std::shared_ptr<JsonValue>&
 }
 
 /**
- * Synchronizes the asset manager to wait until all assets have finished.
+ * Starts the next priority group of the given asset directory.
+ *
+ * This returns false if the directory has no more groups.
+ *
+ * @param directory The asset directory to advance
  *
- * This method is necessary for assets whose construction depends on
- * previously loaded assets (e.g. scene graphs). In the current architecture,
- * this method is only correct if the asset manager loads assets in a
- * single thread.
+ * @return true if a priority group was started
  */
-void AssetManager::sync() {
-    // This task blocks the task queue until others are complete
-    _workers->addTask([=](void) {
-        bool waiting = true;
-        while (waiting) {
-            bool complete = true;
-            for(auto it = _handlers.begin(); complete && it != _handlers.end(); ++it) {
-                complete = it->second->inFlight() == 0;
+bool AssetManager::advance(const std::shared_ptr<Directory>& directory) {
+    // Assets that failed without a callback still count as finished
+    if (directory->loaded < directory->expected) {
+        _loadedBytes += directory->expected-directory->loaded;
+        directory->loaded = directory->expected;
+    }
+    if (directory->current >= directory->tiers.size()) {
+        return false;
+    }
+    
+    const std::vector<Directory::Category>& tier = directory->tiers[directory->current++];
+    for(auto it = tier.begin(); it != tier.end(); ++it) {
+        for(auto jt = it->bytes.begin(); jt != it->bytes.end(); ++jt) {
+            directory->expected += *jt;
+        }
+    }
+    for(auto it = tier.begin(); it != tier.end(); ++it) {
+        readCategory(directory,*it);
+    }
+    return true;
+}
+
+/**
+ * Adds a materialization task for the main thread.
+ *
+ * Tasks are executed in the order they are added, as part of the update
+ * of this manager. This method is safe to call from any thread.
+ *
+ * @param task  The task to execute in the main thread
+ */
+void AssetManager::defer(std::function<void()> task) {
+    {
+        std::unique_lock<std::mutex> lk(_deferMutex);
+        _deferred.push_back(std::move(task));
+    }
+    wake();
+}
+
+/**
+ * Ensures that this manager is updated every animation frame.
+ *
+ * The update is scheduled with {@link Application#schedule}, and it stops
+ * itself once there is nothing left to do.
+ */
+void AssetManager::wake() {
+    std::unique_lock<std::mutex> lk(_deferMutex);
+    if (!_updating) {
+        _updating  = true;
+        _updateKey = Application::get()->schedule([this] {
+            return this->update();
+        });
+    }
+}
+
+/**
+ * Performs the asynchronous work of this manager for one frame.
+ *
+ * This executes the deferred materialization tasks (within the frame
+ * budget), and then starts the next priority group of any asset directory
+ * whose current group is complete.
+ *
+ * @return true if there is still work for later frames
+ */
+bool AssetManager::update() {
+    Timestamp start;
+    bool first = true;
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lk(_deferMutex);
+            if (_deferred.empty()) {
+                break;
             }
-            waiting = !complete;
+            // Always make progress, even if a single task is over budget
+            if (!first && _budget > 0 && Timestamp().ellapsedMillis(start) >= _budget) {
+                break;
+            }
+            task = std::move(_deferred.front());
+            _deferred.pop_front();
+        }
+        first = false;
+        task();
+    }
+    
+    for(auto it = _directories.begin(); it != _directories.end(); ) {
+        bool complete = true;
+        const std::vector<Directory::Category>& tier = (*it)->tiers[(*it)->current-1];
+        for(auto jt = tier.begin(); complete && jt != tier.end(); ++jt) {
+            auto loader = _handlers.find(jt->hash);
+            complete = loader == _handlers.end() || loader->second->inFlight() == 0;
+        }
+        if (complete && !advance(*it)) {
+            it = _directories.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
+    // Fall back to counting assets once every directory is done
+    if (_directories.empty()) {
+        _totalBytes  = 0;
+        _loadedBytes = 0;
+    }
+    
+    std::unique_lock<std::mutex> lk(_deferMutex);
+    if (_deferred.empty() && _directories.empty()) {
+        _updating = false;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Defers a materialization task to the main thread.
+ *
+ * If this loader is attached to an {@link AssetManager}, the task joins
+ * the materialization queue of the manager, which respects the frame
+ * budget of that manager. Otherwise, the task is scheduled with
+ * {@link Application#schedule}.
+ *
+ * This method is safe to call from any thread.
+ *
+ * @param task  The task to defer
+ */
+void BaseLoader::defer(std::function<void()> task) {
+    if (_manager != nullptr) {
+        _manager->defer(std::move(task));
+    } else {
+        Application::get()->schedule([task] {
+            task();
+            return false;
+        });
+    }
+}
 
-            // Delay a full frame
-            int delay = (int)(1000/Application::get()->getFPS());
-            ThreadPool::sleep(delay);
+#pragma mark -
+#pragma mark Asset Bundles
+/**
+ * Mounts the given asset bundle on this manager.
+ *
+ * Once a bundle is mounted, the attached loaders read any asset in the
+ * bundle from the bundle instead of the asset directory. This includes
+ * the asset directories passed to {@link loadDirectory}. If an asset is
+ * in more than one mounted bundle, the most recently mounted bundle wins.
+ *
+ * Bundles are typically mounted by {@link BundleLoader}, so that they are
+ * mounted when loaded and unmounted when unloaded. Mounting a bundle
+ * twice has no effect.
+ *
+ * @param bundle    The bundle to mount
+ */
+void AssetManager::mount(const std::shared_ptr<AssetBundle>& bundle) {
+    if (bundle == nullptr) {
+        return;
+    }
+    std::unique_lock<std::mutex> lk(_bundleMutex);
+    if (std::find(_bundles.begin(), _bundles.end(), bundle) == _bundles.end()) {
+        _bundles.insert(_bundles.begin(), bundle);
+    }
+}
+
+/**
+ * Unmounts the given asset bundle from this manager.
+ *
+ * Assets that were already loaded from the bundle are unaffected.
+ *
+ * @param bundle    The bundle to unmount
+ */
+void AssetManager::unmount(const std::shared_ptr<AssetBundle>& bundle) {
+    std::unique_lock<std::mutex> lk(_bundleMutex);
+    auto it = std::find(_bundles.begin(), _bundles.end(), bundle);
+    if (it != _bundles.end()) {
+        _bundles.erase(it);
+    }
+}
+
+/**
+ * Returns the mounted bundle with the given asset (or nullptr if none)
+ *
+ * The path is relative to the asset directory, as in a JSON directory.
+ * This method is safe to call from any thread.
+ *
+ * @param path  The path to the asset
+ *
+ * @return the mounted bundle with the given asset (or nullptr if none)
+ */
+std::shared_ptr<AssetBundle> AssetManager::findBundle(const std::string path) const {
+    std::unique_lock<std::mutex> lk(_bundleMutex);
+    for(auto it = _bundles.begin(); it != _bundles.end(); ++it) {
+        if ((*it)->contains(path)) {
+            return *it;
         }
-    });
+    }
+    return nullptr;
+}
+
+/**
+ * Returns the mounted bundle with the given asset (or nullptr if none)
+ *
+ * Bundles are mounted on the {@link AssetManager} for this loader, so
+ * this method returns nullptr if the loader is not attached. Loaders
+ * should read the asset from the bundle if there is one, and otherwise
+ * fall back to the file in the asset directory.
+ *
+ * This method is safe to call from any thread.
+ *
+ * @param source    The pathname to the asset
+ *
+ * @return the mounted bundle with the given asset (or nullptr if none)
+ */
+std::shared_ptr<AssetBundle> BaseLoader::findBundle(const std::string source) const {
+    return _manager == nullptr ? nullptr : _manager->findBundle(source);
 }
 
 #pragma mark -
@@ -361,13 +646,12 @@ bool AssetManager::loadDirectory(const std::shared_ptr<JsonValue>& json) {
  * @return true if all assets specified in the directory were successfully loaded.
  */
 bool AssetManager::loadDirectory(const std::string directory) {
-    std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(directory);
-    if (reader == nullptr) {
+    std::shared_ptr<JsonValue> json = read_directory(findBundle(directory),directory);
+    if (json == nullptr) {
         CULogError("No asset directory located at '%s'",directory.c_str());
         return false;
     }
     
-    std::shared_ptr<JsonValue> json = reader->readJson();
     return loadDirectory(json);
 }
 
@@ -402,6 +686,11 @@ bool AssetManager::loadDirectory(const std::string directory) {
  * You may either poll this interface to determine when the assets are
  * loaded or use optional callbacks.
  *
+ * Assets are preloaded by all of the worker threads at once, and a lower
+ * priority does not start until every asset of the higher priorities has
+ * been materialized. Materialization in the main thread is limited to
+ * {@link getFrameBudget} milliseconds each frame.
+ *
  * The optional callback function will be called each time an individual
  * asset loads or fails to load. However, if the entire category fails
  * to load, the callback function will be given the asset category name
@@ -411,58 +700,56 @@ bool AssetManager::loadDirectory(const std::string directory) {
  * @param callback  An optional callback after each asset is loaded
  */
 void AssetManager::loadDirectoryAsync(const std::shared_ptr<JsonValue>& json, LoaderCallback callback) {
-    size_t entries = json->size();
+    // Progress restarts once earlier directories are done
+    if (_directories.empty()) {
+        _totalBytes  = 0;
+        _loadedBytes = 0;
+    }
     
-    // First, estimate the number of things to load
+    std::shared_ptr<Directory> directory = std::make_shared<Directory>();
+    directory->callback = callback;
+
+    // Group the categories by priority, and measure every asset to load
+    std::map<Uint32,std::vector<Directory::Category>> groups;
     for(int ii = 0; ii < json->size(); ii++) {
-        JsonValue* child = json->get(ii).get();
+        std::shared_ptr<JsonValue> child = json->get(ii);
         auto hash = _jsonKeys.find(child->key());
         if (hash != _jsonKeys.end()) {
+            auto rank = _priority.find(child->key());
+            CUAssertLog(rank != _priority.end(), "AssetDirectory loaders are corrupted");
+
+            Directory::Category category;
+            category.hash = hash->second;
+            category.json = child;
+            
             size_t amt = 0;
             auto handler = _handlers[hash->second];
-            // Don't try to load anything already loaded
             for(int jj = 0; jj < child->size(); jj++) {
-                if (!handler->contains(child->get(jj)->key())) { amt++; }
+                std::shared_ptr<JsonValue> entry = child->get(jj);
+                // Don't try to load anything already loaded
+                if (handler->contains(entry->key())) {
+                    category.bytes.push_back(0);
+                } else {
+                    size_t bytes = asset_bytes(this,entry);
+                    category.bytes.push_back(bytes);
+                    _totalBytes += bytes;
+                    amt++;
+                }
             }
             handler->reserve(amt);
+            groups[rank->second].push_back(category);
+        } else {
+            CULogError("Unknown asset category '%s'",child->key().c_str());
         }
     }
     
-    // Process entries by priority
-    Uint32 curr = 0;
-    Uint32 next = 0;
-    Uint32 err  = 0;
-    while (entries > err) {
-        for(int ii = 0; ii < json->size(); ii++) {
-            std::shared_ptr<JsonValue> child = json->get(ii);
-            auto hash = _jsonKeys.find(child->key());
-            if (hash != _jsonKeys.end()) {
-                auto rank = _priority.find(child->key());
-                CUAssertLog(rank != _priority.end(), "AssetDirectory loaders are corrupted");
-                if (rank->second == curr) {
-                    readCategory(hash->second,child,callback);
-                    entries--;
-                } else if (rank->second > curr) {
-                    // We are looking for the NEXT available rank
-                    if (next == curr) {
-                        next = rank->second;
-                    } else if (rank->second < next) {
-                        next = rank->second;
-                    }
-                }
-            } else {
-                CULogError("Unknown asset category '%s'",child->key().c_str());
-                err++;
-            }
-        }
-        if (entries != err) {
-            curr = next;
-            sync();
-        }
+    for(auto it = groups.begin(); it != groups.end(); ++it) {
+        directory->tiers.push_back(std::move(it->second));
+    }
+    if (advance(directory)) {
+        _directories.push_back(directory);
+        wake();
     }
-    
-    // One last sync to ensure everything gets materialized
-    sync();
 }
 
 /**
@@ -496,6 +783,11 @@ void AssetManager::loadDirectoryAsync(const std::shared_ptr<JsonValue>& json, Lo
  * You may either poll this interface to determine when the assets are
  * loaded or use optional callbacks.
  *
+ * Assets are preloaded by all of the worker threads at once, and a lower
+ * priority does not start until every asset of the higher priorities has
+ * been materialized. Materialization in the main thread is limited to
+ * {@link getFrameBudget} milliseconds each frame.
+ *
  * The optional callback function will be called each time an individual
  * asset loads or fails to load. However, if the entire category fails
  * to load, the callback function will be given the asset category name
@@ -505,18 +797,27 @@ void AssetManager::loadDirectoryAsync(const std::shared_ptr<JsonValue>& json, Lo
  * @param callback  An optional callback after each asset is loaded
  */
 void AssetManager::loadDirectoryAsync(const std::string directory, LoaderCallback callback) {
-    _preload = true;
-    
-    std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(directory);
-    if (reader == nullptr && callback != nullptr) {
-        callback("",false);
+    std::shared_ptr<AssetBundle> bundle = findBundle(directory);
+    if (bundle == nullptr && !filetool::file_exists(directory)) {
+        CULogError("No asset directory located at '%s'",directory.c_str());
+        if (callback != nullptr) {
+            callback("",false);
+        }
         return;
     }
     
+    // Parse in a worker, but start the loaders in the main thread
+    _preload = true;
     _workers->addTask([=](void) {
-        std::shared_ptr<JsonValue> json = reader->readJson();
-        loadDirectoryAsync(json,callback);
-        _preload = false;
+        std::shared_ptr<JsonValue> json = read_directory(bundle,directory);
+        this->defer([=](void) {
+            _preload = false;
+            if (json != nullptr) {
+                loadDirectoryAsync(json,callback);
+            } else if (callback != nullptr) {
+                callback("",false);
+            }
+        });
     });
 }
 
@@ -557,13 +858,12 @@ bool AssetManager::unloadDirectory(const std::shared_ptr<JsonValue>& json) {
  * @param directory The path to the JSON asset directory
  */
 bool AssetManager::unloadDirectory(const std::string directory) {
-    std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(directory);
-    if (reader == nullptr) {
+    std::shared_ptr<JsonValue> json = read_directory(findBundle(directory),directory);
+    if (json == nullptr) {
         CULogError("No asset directory located at '%s'",directory.c_str());
         return false;
     }
     
-    std::shared_ptr<JsonValue> json = reader->readJson();
     return unloadDirectory(json);
 }
 
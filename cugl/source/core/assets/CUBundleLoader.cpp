@@ -0,0 +1,188 @@
+//
+//  CUBundleLoader.cpp
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides a specific implementation of the Loader class to load
+//  asset bundles. A bundle packs many asset files into a single archive. When
+//  this loader is attached to an asset manager, every bundle it loads is
+//  mounted on that manager, so the other loaders read their assets from the
+//  bundle instead of the asset directory.
+//
+//  As with all of our loaders, this loader is designed to be attached to an
+//  asset manager. In addition, this class uses our standard shared-pointer
+//  architecture.
+//
+//  1. The constructor does not perform any initialization; it just sets all
+//     attributes to their defaults.
+//
+//  2. All initialization takes place via init methods, which can fail if an
+//     object is initialized more than once.
+//
+//  3. All allocation takes place via static constructors which return a shared
+//     pointer.
+//
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Kidus Zegeye
+//  Version: 3/9/25
+//
+#include <cugl/core/assets/CUBundleLoader.h>
+#include <cugl/core/assets/CUAssetManager.h>
+
+using namespace cugl;
+
+/** What the source name is if we do not know it */
+#define UNKNOWN_SOURCE  "<unknown>"
+
+/**
+ * Finishes loading the bundle, cleaning up the wait queues.
+ *
+ * Reading the bundle index can be done safely in a separate thread.
+ * This method mounts the bundle on the asset manager (if any), which
+ * must take place in the main thread.
+ *
+ * This method supports an optional callback function which reports whether
+ * the asset was successfully materialized.
+ *
+ * @param key       The key to access the asset after loading
+ * @param bundle    The bundle asset fully loaded
+ * @param callback  An optional callback for asynchronous loading
+ */
+void BundleLoader::materialize(const std::string key, const std::shared_ptr<AssetBundle>& bundle,
+                               LoaderCallback callback) {
+    bool success = false;
+    if (bundle != nullptr) {
+        _assets[key] = bundle;
+        if (_manager != nullptr) {
+            _manager->mount(bundle);
+        }
+        success = true;
+    }
+
+    if (callback != nullptr) {
+        callback(key,success);
+    }
+    _queue.erase(key);
+}
+
+/**
+ * Internal method to support asset loading.
+ *
+ * This method supports either synchronous or asynchronous loading, as
+ * specified by the given parameter.  If the loading is asynchronous,
+ * the user may specify an optional callback function.
+ *
+ * This method will split the loading across the {@link AssetBundle#alloc}
+ * and the internal {@link materialize} method.  This ensures that
+ * asynchronous loading is safe.
+ *
+ * @param key       The key to access the asset after loading
+ * @param source    The pathname to the asset
+ * @param callback  An optional callback for asynchronous loading
+ * @param async     Whether the asset was loaded asynchronously
+ *
+ * @return true if the asset was successfully loaded
+ */
+bool BundleLoader::read(const std::string key, const std::string source, LoaderCallback callback, bool async) {
+    if (_assets.find(key) != _assets.end() || _queue.find(key) != _queue.end()) {
+        return false;
+    }
+
+    bool success = false;
+    if (_loader == nullptr || !async) {
+        enqueue(key);
+        std::shared_ptr<AssetBundle> bundle = AssetBundle::alloc(source);
+        success = (bundle != nullptr);
+        materialize(key,bundle,callback);
+    } else {
+        enqueue(key);
+        addTask([=](void) {
+            std::shared_ptr<AssetBundle> bundle = AssetBundle::alloc(source);
+            this->defer([=](void) {
+                this->materialize(key,bundle,callback);
+            });
+        });
+    }
+
+    return success;
+}
+
+/**
+ * Internal method to support asset loading.
+ *
+ * This method supports either synchronous or asynchronous loading, as
+ * specified by the given parameter.  If the loading is asynchronous,
+ * the user may specify an optional callback function.
+ *
+ * This method will split the loading across the {@link AssetBundle#alloc}
+ * and the internal {@link materialize} method.  This ensures that
+ * asynchronous loading is safe.
+ *
+ * This version of read provides support for JSON directories. A bundle
+ * directory entry is just a key with a string value for the path to the
+ * asset.
+ *
+ * @param json      The directory entry for the asset
+ * @param callback  An optional callback for asynchronous loading
+ * @param async     Whether the asset was loaded asynchronously
+ *
+ * @return true if the asset was successfully loaded
+ */
+bool BundleLoader::read(const std::shared_ptr<JsonValue>& json, LoaderCallback callback, bool async) {
+    return read(json->key(),json->asString(UNKNOWN_SOURCE),callback,async);
+}
+
+/**
+ * Unloads the asset for the given key
+ *
+ * The bundle is also unmounted from the asset manager. Assets already
+ * read from the bundle are unaffected.
+ *
+ * @param key   The key associated with the asset
+ *
+ * @return true if the asset was successfully unloaded
+ */
+bool BundleLoader::purgeKey(const std::string key) {
+    auto it = _assets.find(key);
+    if (it == _assets.end()) {
+        return false;
+    }
+    if (_manager != nullptr) {
+        _manager->unmount(it->second);
+    }
+    _assets.erase(it);
+    return true;
+}
+
+/**
+ * Unloads all assets present in this loader.
+ *
+ * Every bundle is also unmounted from the asset manager. Assets already
+ * read from the bundles are unaffected.
+ */
+void BundleLoader::unloadAll() {
+    if (_manager != nullptr) {
+        for(auto it = _assets.begin(); it != _assets.end(); ++it) {
+            _manager->unmount(it->second);
+        }
+    }
+    _assets.clear();
+}
@@ -43,6 +43,7 @@
 //  Version: 7/3/24 (CUGL 3.0 reorganization)
 //
 #include <cugl/core/assets/CUJsonLoader.h>
+#include <cugl/core/assets/CUAssetBundle.h>
 #include <cugl/core/io/CUJsonReader.h>
 #include <cugl/core/util/CUFiletools.h>
 #include <cugl/core/CUApplication.h>
@@ -52,6 +53,27 @@ using namespace cugl;
 /** What the source name is if we do not know it */
 #define UNKNOWN_SOURCE  "<unknown>"
 
+/**
+ * Returns the JSON value for the given asset
+ *
+ * If the asset is in a mounted bundle, it is read from the bundle. Otherwise
+ * it is read from the given file.
+ *
+ * @param bundle    The mounted bundle with the asset (may be nullptr)
+ * @param source    The pathname to the asset
+ * @param path      The file to read if the asset is not bundled
+ *
+ * @return the JSON value for the given asset
+ */
+static std::shared_ptr<JsonValue> read_json(const std::shared_ptr<AssetBundle>& bundle,
+                                            const std::string source, const std::string path) {
+    if (bundle != nullptr) {
+        return bundle->readJson(source);
+    }
+    std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(path);
+    return (reader == nullptr ? nullptr : reader->readJson());
+}
+
 /**
  * Finishes loading the Json file, cleaning up the wait queues.
  *
@@ -109,21 +131,19 @@ bool JsonLoader::read(const std::string key, const std::string source, LoaderCal
     std::string root = Application::get()->getAssetDirectory();
     std::string path = root+source;
     
+    std::shared_ptr<AssetBundle> bundle = findBundle(source);
     bool success = false;
     if (_loader == nullptr || !async) {
         enqueue(key);
-        std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(path);
-        std::shared_ptr<JsonValue> json = (reader == nullptr ? nullptr : reader->readJson());
+        std::shared_ptr<JsonValue> json = read_json(bundle,source,path);
         success = (json != nullptr);
         materialize(key,json,callback);
     } else {
-        _loader->addTask([=](void) {
-            this->enqueue(key);
-            std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(path);
-            std::shared_ptr<JsonValue> json = (reader == nullptr ? nullptr : reader->readJson());
-            Application::get()->schedule([=](void) {
+        enqueue(key);
+        addTask([=](void) {
+            std::shared_ptr<JsonValue> json = read_json(bundle,source,path);
+            this->defer([=](void) {
                 this->materialize(key,json,callback);
-                return false;
             });
         });
     }
@@ -161,21 +181,19 @@ bool JsonLoader::read(const std::shared_ptr<JsonValue>& json, LoaderCallback cal
     }
     std::string source = json->asString(UNKNOWN_SOURCE);
     
+    std::shared_ptr<AssetBundle> bundle = findBundle(source);
     bool success = false;
     if (_loader == nullptr || !async) {
         enqueue(key);
-        std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(source);
-        std::shared_ptr<JsonValue> json = (reader == nullptr ? nullptr : reader->readJson());
+        std::shared_ptr<JsonValue> json = read_json(bundle,source,source);
         success = (json != nullptr);
         materialize(key,json,callback);
     } else {
-        _loader->addTask([=](void) {
-            this->enqueue(key);
-            std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(source);
-            std::shared_ptr<JsonValue> json = (reader == nullptr ? nullptr : reader->readJson());
-            Application::get()->schedule([=](void) {
+        enqueue(key);
+        addTask([=](void) {
+            std::shared_ptr<JsonValue> json = read_json(bundle,source,source);
+            this->defer([=](void) {
                 this->materialize(key,json,callback);
-                return false;
             });
         });
     }
@@ -43,6 +43,7 @@
 //  Version: 7/3/24 (CUGL 3.0 reorganization)
 //
 #include <cugl/core/assets/CUWidgetLoader.h>
+#include <cugl/core/assets/CUAssetBundle.h>
 #include <cugl/core/io/CUJsonReader.h>
 #include <cugl/core/util/CUFiletools.h>
 #include <cugl/core/CUApplication.h>
@@ -52,6 +53,27 @@ using namespace cugl;
 /** What the source name is if we do not know it */
 #define UNKNOWN_SOURCE  "<unknown>"
 
+/**
+ * Returns the JSON value for the given asset
+ *
+ * If the asset is in a mounted bundle, it is read from the bundle. Otherwise
+ * it is read from the given file.
+ *
+ * @param bundle    The mounted bundle with the asset (may be nullptr)
+ * @param source    The pathname to the asset
+ * @param path      The file to read if the asset is not bundled
+ *
+ * @return the JSON value for the given asset
+ */
+static std::shared_ptr<JsonValue> read_json(const std::shared_ptr<AssetBundle>& bundle,
+                                            const std::string source, const std::string path) {
+    if (bundle != nullptr) {
+        return bundle->readJson(source);
+    }
+    std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(path);
+    return (reader == nullptr ? nullptr : reader->readJson());
+}
+
 /**
  * Finishes loading the widget file, cleaning up the wait queues.
  *
@@ -116,23 +138,21 @@ bool WidgetLoader::read(const std::string key, const std::string source, LoaderC
     std::string root = Application::get()->getAssetDirectory();
     std::string path = root+source;
     
+    std::shared_ptr<AssetBundle> bundle = findBundle(source);
     bool success = false;
     if (_loader == nullptr || !async) {
         enqueue(key);
-        std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(path);
-        std::shared_ptr<JsonValue> json = (reader == nullptr ? nullptr : reader->readJson());
+        std::shared_ptr<JsonValue> json = read_json(bundle,source,path);
 		std::shared_ptr<WidgetValue> widget = WidgetValue::alloc(json);
         success = (widget != nullptr);
         materialize(key,widget,callback);
     } else {
-        _loader->addTask([=](void) {
-            this->enqueue(key);
-            std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(path);
-            std::shared_ptr<JsonValue> json = (reader == nullptr ? nullptr : reader->readJson());
+        enqueue(key);
+        addTask([=](void) {
+            std::shared_ptr<JsonValue> json = read_json(bundle,source,path);
 			std::shared_ptr<WidgetValue> widget = WidgetValue::alloc(json);
-            Application::get()->schedule([=](void) {
+            this->defer([=](void) {
                 this->materialize(key,widget,callback);
-                return false;
             });
         });
     }
@@ -167,23 +187,21 @@ bool WidgetLoader::read(const std::shared_ptr<JsonValue>& json, LoaderCallback c
     }
     std::string source = json->asString(UNKNOWN_SOURCE);
     
+    std::shared_ptr<AssetBundle> bundle = findBundle(source);
     bool success = false;
     if (_loader == nullptr || !async) {
         enqueue(key);
-        std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(source);
-        std::shared_ptr<JsonValue> json = (reader == nullptr ? nullptr : reader->readJson());
+        std::shared_ptr<JsonValue> json = read_json(bundle,source,source);
 		std::shared_ptr<WidgetValue> widget = WidgetValue::alloc(json);
         success = (widget != nullptr);
         materialize(key,widget,callback);
     } else {
-        _loader->addTask([=](void) {
-            this->enqueue(key);
-            std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(source);
-            std::shared_ptr<JsonValue> json = (reader == nullptr ? nullptr : reader->readJson());
+        enqueue(key);
+        addTask([=](void) {
+            std::shared_ptr<JsonValue> json = read_json(bundle,source,source);
 			std::shared_ptr<WidgetValue> widget = WidgetValue::alloc(json);
-            Application::get()->schedule([=](void) {
+            this->defer([=](void) {
                 this->materialize(key,widget,callback);
-                return false;
             });
         });
     }
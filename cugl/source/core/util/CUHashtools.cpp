@@ -31,6 +31,9 @@
 #include <cugl/core/util/CUHashtools.h>
 #include <cugl/core/util/CUDebug.h>
 #include <random>
+#include <array>
+#include <chrono>
+#include <algorithm>
 #include <stduuid/uuid.h>
 #include <SDL_app.h>
 
@@ -187,27 +190,260 @@ std::string cugl::hashtool::b64_tostring(const std::string data) {
     return result;
 }
 
+#pragma mark -
+#pragma mark Binary UUIDs
+/** The hexadecimal digits for UUIDs */
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+/**
+ * A lookup table from characters to hexadecimal values
+ *
+ * Bit 4 marks a digit as uppercase, and 0xff marks an invalid digit.
+ */
+static const struct HexTable {
+    /** The value of each character */
+    Uint8 value[256];
+
+    /** Creates the lookup table */
+    HexTable() {
+        for(int ii = 0; ii < 256; ii++) {
+            value[ii] = 0xff;
+        }
+        for(int ii = 0; ii < 10; ii++) {
+            value['0'+ii] = (Uint8)ii;
+        }
+        for(int ii = 0; ii < 6; ii++) {
+            value['a'+ii] = (Uint8)(10+ii);
+            value['A'+ii] = (Uint8)(0x10 | (10+ii));
+        }
+    }
+} HEX_TABLE;
+
+/** The positions of the dashes in the string form of a UUID */
+static const size_t UUID_DASHES[] = { 8, 13, 18, 23 };
+
+/** The position of each byte in the string form of a UUID */
+static const size_t UUID_OFFSETS[] = {
+    0, 2, 4, 6, 9, 11, 14, 16, 19, 21, 24, 26, 28, 30, 32, 34
+};
+
+/**
+ * Returns true if the string was parsed as a UUID.
+ *
+ * The string must be 32 hexadecimal digits with dashes separating them into
+ * groups of 8-4-4-4-12. If canonical is true, the digits must also be
+ * lowercase, so that {@link toString} gives back exactly the same string.
+ * If the string cannot be parsed, this UUID is unchanged.
+ *
+ * @param str       The string to parse
+ * @param canonical Whether to only accept lowercase digits
+ *
+ * @return true if the string was parsed as a UUID.
+ */
+bool cugl::hashtool::BinaryUUID::parse(const std::string& str, bool canonical) {
+    if (str.size() != STRING_LENGTH) {
+        return false;
+    }
+    for(size_t ii = 0; ii < 4; ii++) {
+        if (str[UUID_DASHES[ii]] != '-') {
+            return false;
+        }
+    }
+
+    const Uint8 mask = canonical ? 0xf0 : 0xe0;
+    const unsigned char* chars = reinterpret_cast<const unsigned char*>(str.data());
+    Uint64 value[2] = {0, 0};
+    Uint8 flags = 0;
+    for(size_t ii = 0; ii < 16; ii++) {
+        Uint8 upper = HEX_TABLE.value[chars[UUID_OFFSETS[ii]]];
+        Uint8 lower = HEX_TABLE.value[chars[UUID_OFFSETS[ii]+1]];
+        flags |= upper | lower;
+        value[ii >> 3] = (value[ii >> 3] << 8) | ((upper & 0xf) << 4) | (lower & 0xf);
+    }
+    if (flags & mask) {
+        return false;
+    }
+    high = value[0];
+    low  = value[1];
+    return true;
+}
+
+/**
+ * Writes the string form of this UUID to the given buffer.
+ *
+ * The buffer must have room for {@link STRING_LENGTH} characters. No
+ * null terminator is written.
+ *
+ * @param buffer    The buffer to write to
+ */
+void cugl::hashtool::BinaryUUID::format(char* buffer) const {
+    for(size_t ii = 0; ii < 8; ii++) {
+        Uint8 hbyte = (Uint8)(high >> (56-8*ii));
+        Uint8 lbyte = (Uint8)(low  >> (56-8*ii));
+        char* hpos = buffer+UUID_OFFSETS[ii];
+        char* lpos = buffer+UUID_OFFSETS[ii+8];
+        hpos[0] = HEX_DIGITS[hbyte >> 4];
+        hpos[1] = HEX_DIGITS[hbyte & 0xf];
+        lpos[0] = HEX_DIGITS[lbyte >> 4];
+        lpos[1] = HEX_DIGITS[lbyte & 0xf];
+    }
+    for(size_t ii = 0; ii < 4; ii++) {
+        buffer[UUID_DASHES[ii]] = '-';
+    }
+}
+
+/**
+ * Returns the string form of this UUID.
+ *
+ * This is 32 lowercase hexadecimal digits with dashes separating them into
+ * groups of 8-4-4-4-12.
+ *
+ * @return the string form of this UUID.
+ */
+std::string cugl::hashtool::BinaryUUID::toString() const {
+    char buffer[STRING_LENGTH];
+    format(buffer);
+    return std::string(buffer,STRING_LENGTH);
+}
+
+/**
+ * Writes the 16 bytes of this UUID to the given buffer (in order)
+ *
+ * @param buffer    The buffer to write to
+ */
+void cugl::hashtool::BinaryUUID::toBytes(std::byte* buffer) const {
+    for(int ii = 0; ii < 8; ii++) {
+        buffer[ii]   = (std::byte)(high >> (56-8*ii));
+        buffer[ii+8] = (std::byte)(low  >> (56-8*ii));
+    }
+}
+
+/**
+ * Sets this UUID to the 16 bytes in the given buffer (in order)
+ *
+ * @param buffer    The buffer to read from
+ */
+void cugl::hashtool::BinaryUUID::fromBytes(const std::byte* buffer) {
+    high = 0;
+    low  = 0;
+    for(int ii = 0; ii < 8; ii++) {
+        high = (high << 8) | (Uint64)buffer[ii];
+        low  = (low  << 8) | (Uint64)buffer[ii+8];
+    }
+}
+
+#pragma mark -
+#pragma mark UUID Generation
+/**
+ * This class is the UUID generator for a single thread.
+ *
+ * Seeding a Mersenne Twister from std::random_device is expensive (it can
+ * take a system call per word), so every thread seeds its generator once and
+ * keeps it. The generator also remembers the last Version 7 timestamp, so
+ * that UUIDs from the same millisecond can be ordered by a counter.
+ */
+class UUIDGenerator {
+public:
+    /** The random number generator */
+    std::mt19937_64 engine;
+    /** The timestamp (in milliseconds) of the last Version 7 UUID */
+    Uint64 lastMillis;
+    /** The counter for Version 7 UUIDs in the same millisecond */
+    Uint64 counter;
+
+    /**
+     * Creates a generator seeded from std::random_device
+     */
+    UUIDGenerator() : lastMillis(0), counter(0) {
+        std::random_device rd;
+        std::array<std::random_device::result_type, 8> seed_data;
+        std::generate(seed_data.begin(), seed_data.end(), std::ref(rd));
+        std::seed_seq seq(seed_data.begin(), seed_data.end());
+        engine.seed(seq);
+    }
+};
+
+/**
+ * Returns the UUID generator for the calling thread
+ *
+ * @return the UUID generator for the calling thread
+ */
+static UUIDGenerator& uuid_generator() {
+    thread_local UUIDGenerator generator;
+    return generator;
+}
+
 /**
  * Returns a new randomly generated UUID
  *
- * This creates a Version 4 UUID generated by a fresh std::random_device. It
- * will be a 32 character hexadecimal string with dashes separating the
- * characters into groups of 8-4-4-4-12 (as well as supporting Version 4
- * markers).
+ * This creates a Version 4 UUID. It will be a 32 character hexadecimal string
+ * with dashes separating the characters into groups of 8-4-4-4-12 (as well as
+ * supporting Version 4 markers).
+ *
+ * This function is a formatted version of {@link generate_uuid_v4}, and it is
+ * safe to call from any thread.
  *
  * @return a new randomly generated UUID
  */
 std::string cugl::hashtool::generate_uuid() {
-    std::random_device rd;
-    auto seed_data = std::array<int, std::mt19937::state_size> {};
-    std::generate(std::begin(seed_data), std::end(seed_data), std::ref(rd));
-    std::seed_seq seq(std::begin(seed_data), std::end(seed_data));
-    std::mt19937 generator(seq);
-    uuids::uuid_random_generator uuidgen{generator};
-    
-    uuids::uuid const typeduuid = uuidgen();
-    std::string uuid = uuids::to_string(typeduuid);
-    return uuid;
+    return generate_uuid_v4().toString();
+}
+
+/**
+ * Returns a new randomly generated Version 4 UUID
+ *
+ * The random bits come from a generator local to the calling thread. The
+ * generator is seeded from std::random_device the first time a thread calls
+ * this function (or {@link generate_uuid_v7}), and never again. So this
+ * function is safe to call from any thread, and does not block on the system
+ * entropy source.
+ *
+ * @return a new randomly generated Version 4 UUID
+ */
+cugl::hashtool::BinaryUUID cugl::hashtool::generate_uuid_v4() {
+    UUIDGenerator& generator = uuid_generator();
+    Uint64 high = generator.engine();
+    Uint64 low  = generator.engine();
+    high = (high & ~0xf000ULL) | 0x4000ULL;
+    low  = (low & ~(3ULL << 62)) | (2ULL << 62);
+    return BinaryUUID(high,low);
+}
+
+/**
+ * Returns a new time-ordered Version 7 UUID
+ *
+ * A Version 7 UUID starts with the Unix time in milliseconds, followed by
+ * random bits. Hence they sort by creation time, which makes them much
+ * better keys for logs and databases than Version 4 UUIDs. UUIDs generated
+ * by the same thread in the same millisecond use a counter in place of the
+ * first 12 random bits, so they are strictly increasing.
+ *
+ * This function shares its generator with {@link generate_uuid_v4}, and is
+ * safe to call from any thread.
+ *
+ * @return a new time-ordered Version 7 UUID
+ */
+cugl::hashtool::BinaryUUID cugl::hashtool::generate_uuid_v7() {
+    UUIDGenerator& generator = uuid_generator();
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    Uint64 millis = (Uint64)std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+    Uint64 random = generator.engine();
+    if (millis > generator.lastMillis) {
+        // Start the counter in the lower half, leaving room to count up
+        generator.lastMillis = millis;
+        generator.counter = random & 0x7ff;
+    } else if (generator.counter < 0xfff) {
+        // Same millisecond (or the clock went back)
+        generator.counter++;
+    } else {
+        // Counter overflow borrows from the next millisecond
+        generator.lastMillis++;
+        generator.counter = random & 0x7ff;
+    }
+
+    Uint64 high = ((generator.lastMillis & 0xffffffffffffULL) << 16) | 0x7000ULL | generator.counter;
+    Uint64 low  = (generator.engine() & ~(3ULL << 62)) | (2ULL << 62);
+    return BinaryUUID(high,low);
 }
 
 /**
@@ -0,0 +1,564 @@
+//
+//  CUScheduler.cpp
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides the scheduler behind Application::schedule. It stores
+//  callbacks that should be executed in a future animation frame, possibly on
+//  a regular basis. Callbacks may be scheduled (or unscheduled) from any
+//  thread, but they are always executed on the thread that updates the
+//  scheduler, which is the main thread for the application.
+//
+//  Callbacks are split between three queues. Immediate callbacks run in the
+//  next frame, periodic callbacks run every frame, and delayed callbacks are
+//  stored in a hierarchical timer wheel. Requests from other threads arrive
+//  in a lock-free inbox, so scheduling a callback never blocks.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Kidus Zegeye
+//  Version: 3/9/25
+//
+#include <cugl/core/util/CUScheduler.h>
+#include <algorithm>
+
+using namespace cugl;
+
+/** The number of bits addressed by the finest level of the wheel */
+#define WHEEL_BITS  8
+/** The number of bits addressed by each coarser level of the wheel */
+#define LEVEL_BITS  6
+/** The initial size of the identifier table */
+#define MIN_TABLE   64
+
+/**
+ * Returns the hash of a callback identifier.
+ *
+ * Identifiers are sequential, so this is a Fibonacci hash that spreads them
+ * over the table.
+ *
+ * @param id    The callback identifier
+ *
+ * @return the hash of a callback identifier.
+ */
+static inline size_t hash_id(Uint32 id) {
+    return (size_t)((id*(Uint64)0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+/**
+ * Returns the number of low bits of the time spanned by one slot of a level.
+ *
+ * The finest level (0) spans a single millisecond. The overflow list acts as
+ * a level above the coarsest one.
+ *
+ * @param level The wheel level
+ *
+ * @return the number of low bits of the time spanned by one slot of a level.
+ */
+static inline Uint32 slot_bits(Sint32 level) {
+    return level == 0 ? 0 : WHEEL_BITS + LEVEL_BITS*(level-1);
+}
+
+#pragma mark -
+#pragma mark Constructors
+/**
+ * Creates an empty scheduler.
+ */
+Scheduler::Scheduler() :
+_inbox(nullptr),
+_funcid(0),
+_tick(0),
+_count(0) {
+    std::fill(_sizes, _sizes+LEVEL_COUNT+2, 0);
+}
+
+/**
+ * Removes every callback from this scheduler.
+ *
+ * This includes any requests still in the inbox. It must not be called
+ * while another thread may schedule a callback.
+ */
+void Scheduler::clear() {
+    Entry* entry = _inbox.exchange(nullptr, std::memory_order_acquire);
+    while (entry != nullptr) {
+        Entry* next = entry->inbox;
+        delete entry;
+        entry = next;
+    }
+
+    for (auto it = _table.begin(); it != _table.end(); ++it) {
+        delete *it;
+        *it = nullptr;
+    }
+    _count = 0;
+    _due.clear();
+
+    _immediate = List();
+    _periodic  = List();
+    _overflow  = List();
+    std::fill(_wheel, _wheel+WHEEL_SLOTS, List());
+    for (Uint32 ii = 0; ii < LEVEL_COUNT; ii++) {
+        std::fill(_levels[ii], _levels[ii]+LEVEL_SLOTS, List());
+    }
+    std::fill(_sizes, _sizes+LEVEL_COUNT+2, 0);
+}
+
+#pragma mark -
+#pragma mark Scheduling
+/**
+ * Schedules a reoccuring callback function time milliseconds in the future.
+ *
+ * If time is 0, the callback will be called in the next update. Otherwise,
+ * it will be called in the first update that ends more than time
+ * milliseconds in the future. If the callback returns true, it will be
+ * called again period milliseconds later (or every update if period is 0).
+ * The callback is removed once it returns false.
+ *
+ * This method is thread safe and does not block.
+ *
+ * @param callback  The callback function
+ * @param time      The number of milliseconds to delay the callback
+ * @param period    The delay until the callback is executed again
+ *
+ * @return a unique identifier for the schedule callback
+ */
+Uint32 Scheduler::schedule(std::function<bool()> callback, Uint32 time, Uint32 period) {
+    Entry* entry = new Entry();
+    entry->callback = std::move(callback);
+    entry->id = _funcid.fetch_add(1, std::memory_order_relaxed);
+    entry->delay  = time;
+    entry->period = period;
+    Uint32 id = entry->id;
+    post(entry);
+    return id;
+}
+
+/**
+ * Stops a callback function from being executed.
+ *
+ * The callback is removed at the start of the next update, so it will not
+ * be called again unless it is currently executing. Unknown identifiers
+ * (such as those of callbacks that are already removed) are ignored.
+ *
+ * This method is thread safe and does not block.
+ *
+ * @param id    The callback identifier
+ */
+void Scheduler::unschedule(Uint32 id) {
+    Entry* entry = new Entry();
+    entry->id = id;
+    post(entry);
+}
+
+/**
+ * Executes every callback that is due.
+ *
+ * This method first processes every {@link schedule} and {@link unschedule}
+ * request since the last update. It then advances the time by the given
+ * number of milliseconds, and executes every callback that was due before
+ * the new time. If no time passed, no callbacks are executed.
+ *
+ * @param millis    The number of milliseconds since last called
+ */
+void Scheduler::update(Uint32 millis) {
+    drain();
+    if (millis == 0) {
+        return;
+    }
+
+    // Everything not in the wheel is due at the start of this frame
+    Uint64 start = _tick;
+    _due.clear();
+    advance(start+millis);
+
+    // Steal the lists so that callbacks rescheduled now wait for the next frame
+    List immediate = _immediate;
+    _immediate = List();
+    for (Entry* entry = immediate.head; entry != nullptr; entry = entry->next) {
+        entry->owner = nullptr;
+    }
+    List periodic;
+
+    // Wheel entries due at the start were scheduled before anything else
+    size_t pos = 0;
+    while (pos < _due.size() && _due[pos]->deadline == start) {
+        execute(_due[pos++], periodic);
+    }
+
+    Entry* entry = _periodic.head;
+    while (entry != nullptr) {
+        Entry* next = entry->next;
+        if (!entry->callback()) {
+            unlink(entry);
+            release(entry);
+        }
+        entry = next;
+    }
+
+    entry = immediate.head;
+    while (entry != nullptr) {
+        Entry* next = entry->next;
+        entry->prev = nullptr;
+        entry->next = nullptr;
+        execute(entry, periodic);
+        entry = next;
+    }
+
+    while (pos < _due.size()) {
+        execute(_due[pos++], periodic);
+    }
+    _due.clear();
+
+    entry = periodic.head;
+    while (entry != nullptr) {
+        Entry* next = entry->next;
+        entry->prev = nullptr;
+        entry->next = nullptr;
+        append(_periodic, entry);
+        entry = next;
+    }
+}
+
+#pragma mark -
+#pragma mark Internal Helpers
+/**
+ * Pushes the given entry onto the inbox.
+ *
+ * @param entry The entry to push
+ */
+void Scheduler::post(Entry* entry) {
+    Entry* head = _inbox.load(std::memory_order_relaxed);
+    do {
+        entry->inbox = head;
+    } while (!_inbox.compare_exchange_weak(head, entry, std::memory_order_release,
+                                           std::memory_order_relaxed));
+}
+
+/**
+ * Processes every request in the inbox, in the order they were posted.
+ */
+void Scheduler::drain() {
+    // The inbox is a stack, so reverse it to recover the posting order
+    Entry* entry = _inbox.exchange(nullptr, std::memory_order_acquire);
+    Entry* order = nullptr;
+    while (entry != nullptr) {
+        Entry* next = entry->inbox;
+        entry->inbox = order;
+        order = entry;
+        entry = next;
+    }
+
+    while (order != nullptr) {
+        entry = order;
+        order = order->inbox;
+        entry->inbox = nullptr;
+        if (entry->callback) {
+            track(entry);
+            if (entry->delay == 0) {
+                entry->deadline = _tick;
+                append(_immediate, entry);
+            } else {
+                entry->deadline = _tick+entry->delay;
+                insert(entry);
+            }
+        } else {
+            Entry* target = lookup(entry->id);
+            if (target != nullptr) {
+                unlink(target);
+                release(target);
+            }
+            delete entry;
+        }
+    }
+}
+
+/**
+ * Appends the given entry to the given list.
+ *
+ * @param list  The list to append to
+ * @param entry The entry to append
+ */
+void Scheduler::append(List& list, Entry* entry) {
+    entry->owner = &list;
+    entry->prev  = list.tail;
+    entry->next  = nullptr;
+    if (list.tail == nullptr) {
+        list.head = entry;
+    } else {
+        list.tail->next = entry;
+    }
+    list.tail = entry;
+}
+
+/**
+ * Removes the given entry from its owning list.
+ *
+ * @param entry The entry to remove
+ */
+void Scheduler::unlink(Entry* entry) {
+    List* list = entry->owner;
+    if (list == nullptr) {
+        return;
+    }
+    if (entry->prev == nullptr) {
+        list->head = entry->next;
+    } else {
+        entry->prev->next = entry->next;
+    }
+    if (entry->next == nullptr) {
+        list->tail = entry->prev;
+    } else {
+        entry->next->prev = entry->prev;
+    }
+    if (entry->level >= 0) {
+        _sizes[entry->level]--;
+    }
+    entry->owner = nullptr;
+    entry->prev  = nullptr;
+    entry->next  = nullptr;
+    entry->level = -1;
+}
+
+/**
+ * Adds the given entry to the wheel according to its deadline.
+ *
+ * The deadline must be in the future.
+ *
+ * @param entry The entry to add
+ */
+void Scheduler::insert(Entry* entry) {
+    // An entry goes in the finest level that shares its high bits with now.
+    // Entries with the same deadline are then always in the same slot, which
+    // keeps them in FIFO order as they cascade down.
+    Uint64 diff = entry->deadline ^ _tick;
+    if (diff < ((Uint64)1 << WHEEL_BITS)) {
+        entry->level = 0;
+        append(_wheel[entry->deadline & (WHEEL_SLOTS-1)], entry);
+        _sizes[0]++;
+        return;
+    }
+
+    for (Sint32 level = 1; level <= (Sint32)LEVEL_COUNT; level++) {
+        Uint32 bits = slot_bits(level);
+        if (diff < ((Uint64)1 << (bits+LEVEL_BITS))) {
+            entry->level = level;
+            append(_levels[level-1][(entry->deadline >> bits) & (LEVEL_SLOTS-1)], entry);
+            _sizes[level]++;
+            return;
+        }
+    }
+
+    entry->level = LEVEL_COUNT+1;
+    append(_overflow, entry);
+    _sizes[LEVEL_COUNT+1]++;
+}
+
+/**
+ * Moves every entry in the given list back into the wheel.
+ *
+ * This is how entries work their way down to finer levels of the wheel.
+ *
+ * @param list  The list to redistribute
+ * @param level The level of the list
+ */
+void Scheduler::redistribute(List& list, Sint32 level) {
+    Entry* entry = list.head;
+    list = List();
+    while (entry != nullptr) {
+        Entry* next = entry->next;
+        _sizes[level]--;
+        insert(entry);
+        entry = next;
+    }
+}
+
+/**
+ * Cascades the coarser levels of the wheel for the current time.
+ *
+ * This must be called whenever the time lands on a slot boundary of the
+ * finest level.
+ */
+void Scheduler::cascade() {
+    // Coarsest first, so an entry can fall through several levels at once
+    for (Sint32 level = LEVEL_COUNT+1; level >= 1; level--) {
+        Uint32 bits = slot_bits(level);
+        if ((_tick & (((Uint64)1 << bits)-1)) == 0 && _sizes[level] > 0) {
+            if (level == LEVEL_COUNT+1) {
+                redistribute(_overflow, level);
+            } else {
+                redistribute(_levels[level-1][(_tick >> bits) & (LEVEL_SLOTS-1)], level);
+            }
+        }
+    }
+}
+
+/**
+ * Advances the wheel to the given time.
+ *
+ * Every entry in the wheel that is due before that time is removed from
+ * the wheel and appended to {@link #_due}, in order of deadline.
+ *
+ * @param time  The time to advance to
+ */
+void Scheduler::advance(Uint64 time) {
+    while (_tick < time) {
+        Sint32 level = 0;
+        while (level <= (Sint32)LEVEL_COUNT+1 && _sizes[level] == 0) {
+            level++;
+        }
+
+        if (level > (Sint32)LEVEL_COUNT+1) {
+            // Nothing is waiting, so no slot boundary matters
+            _tick = time;
+            return;
+        } else if (level == 0) {
+            List& slot = _wheel[_tick & (WHEEL_SLOTS-1)];
+            for (Entry* entry = slot.head; entry != nullptr; entry = entry->next) {
+                entry->owner = nullptr;
+                entry->level = -1;
+                _sizes[0]--;
+                _due.push_back(entry);
+            }
+            slot = List();
+            _tick++;
+        } else {
+            // The finer levels are empty, so skip to the next cascade
+            Uint64 span = (Uint64)1 << slot_bits(level);
+            _tick = std::min((_tick | (span-1))+1, time);
+        }
+
+        if ((_tick & (WHEEL_SLOTS-1)) == 0) {
+            cascade();
+        }
+    }
+}
+
+/**
+ * Executes the given entry, and reschedules it if it returns true.
+ *
+ * The entry should not be in any list. If it is called every frame, it is
+ * appended to the given list instead of being rescheduled right away.
+ *
+ * @param entry     The entry to execute
+ * @param periodic  The list for callbacks called every frame
+ */
+void Scheduler::execute(Entry* entry, List& periodic) {
+    entry->prev = nullptr;
+    entry->next = nullptr;
+    if (!entry->callback()) {
+        release(entry);
+    } else if (entry->period == 0) {
+        append(periodic, entry);
+    } else {
+        entry->deadline = _tick+entry->period;
+        insert(entry);
+    }
+}
+
+/**
+ * Records the identifier of the given entry.
+ *
+ * @param entry The entry to record
+ */
+void Scheduler::track(Entry* entry) {
+    // Keep the table at most half full so probes stay short
+    if (2*(_count+1) > _table.size()) {
+        std::vector<Entry*> table(std::max(_table.size()*2, (size_t)MIN_TABLE), nullptr);
+        table.swap(_table);
+        _count = 0;
+        for (auto it = table.begin(); it != table.end(); ++it) {
+            if (*it != nullptr) {
+                track(*it);
+            }
+        }
+    }
+
+    size_t mask = _table.size()-1;
+    size_t pos  = hash_id(entry->id) & mask;
+    while (_table[pos] != nullptr) {
+        pos = (pos+1) & mask;
+    }
+    _table[pos] = entry;
+    _count++;
+}
+
+/**
+ * Returns the scheduled entry for the given identifier.
+ *
+ * @param id    The callback identifier
+ *
+ * @return the scheduled entry for the given identifier (nullptr if none).
+ */
+Scheduler::Entry* Scheduler::lookup(Uint32 id) const {
+    if (_table.empty()) {
+        return nullptr;
+    }
+    size_t mask = _table.size()-1;
+    size_t pos  = hash_id(id) & mask;
+    while (_table[pos] != nullptr) {
+        if (_table[pos]->id == id) {
+            return _table[pos];
+        }
+        pos = (pos+1) & mask;
+    }
+    return nullptr;
+}
+
+/**
+ * Forgets the given identifier.
+ *
+ * @param id    The callback identifier
+ */
+void Scheduler::forget(Uint32 id) {
+    if (_table.empty()) {
+        return;
+    }
+    size_t mask = _table.size()-1;
+    size_t hole = hash_id(id) & mask;
+    while (_table[hole] != nullptr && _table[hole]->id != id) {
+        hole = (hole+1) & mask;
+    }
+    if (_table[hole] == nullptr) {
+        return;
+    }
+    _table[hole] = nullptr;
+    _count--;
+
+    // Shift back any later entry in the run that can fill the hole
+    size_t next = (hole+1) & mask;
+    while (_table[next] != nullptr) {
+        size_t home = hash_id(_table[next]->id) & mask;
+        if (((next-home) & mask) >= ((next-hole) & mask)) {
+            _table[hole] = _table[next];
+            _table[next] = nullptr;
+            hole = next;
+        }
+        next = (next+1) & mask;
+    }
+}
+
+/**
+ * Deletes the given entry and forgets its identifier.
+ *
+ * @param entry The entry to delete
+ */
+void Scheduler::release(Entry* entry) {
+    forget(entry->id);
+    delete entry;
+}
@@ -6,6 +6,11 @@
 //  task is specified by a void function.  There are no guarantees about thread
 //  safety; that is responsibility of the author of each task.
 //
+//  The pool is a work-stealing scheduler. Each worker has its own task deque,
+//  and tasks added from outside the pool go to a shared injection queue. Idle
+//  workers steal from the other deques. Tasks can also return a future, and
+//  can be grouped together so that one thread can wait on all of them.
+//
 //  This code is largely inspired from the Cocos2d file AudioEngine.cpp, from
 //  the code for asynchronous asset loading. We generalized that class added
 //  some notable safety changes.
@@ -36,6 +41,12 @@
 
 using namespace cugl;
 
+/** The number of times an idle worker yields before it sleeps */
+#define IDLE_SPINS  16
+
+/** The worker state of the current thread (nullptr if not a pool worker) */
+static thread_local void* current_worker = nullptr;
+
 #pragma mark -
 #pragma mark Constructors
 /**
@@ -47,8 +58,12 @@ using namespace cugl;
  * all the threads complete.  This destructor will block unti showndown.
  */
 void ThreadPool::dispose() {
-    stop();
-    while (!isShutdown());
+    stop();     // Joins the workers, so the pool is shut down afterwards
+    _workers.clear();
+    _states.clear();
+    _taskQueue.clear();
+    _pending = 0;
+    _complete = 0;
 }
 
 /**
@@ -63,11 +78,22 @@ void ThreadPool::dispose() {
  * @return true if the threed pool is initialized properly, false otherwise.
  */
 bool ThreadPool::init(int threads) {
+    if (!_workers.empty()) {
+        return false;
+    }
+    _stop = false;
+    _complete = 0;
+    
+    // Create all of the states before any thread can steal from them
     for (int index = 0; index < threads; ++index) {
+        _states.emplace_back(std::make_unique<Worker>(this,index));
+    }
+    for (int index = 0; index < threads; ++index) {
+        Worker* worker = _states[index].get();
 #ifdef CU_SDL_THREADS
-        _workers.emplace_back(SDL_CreateThread(ThreadPool::sdlThreadFunc,"Pool Dispatch",(void*)this));
+        _workers.emplace_back(SDL_CreateThread(ThreadPool::sdlThreadFunc,"Pool Dispatch",(void*)worker));
 #else
-        _workers.emplace_back(std::thread(std::bind(&ThreadPool::threadFunc, this)));
+        _workers.emplace_back(std::thread(&ThreadPool::threadFunc, this, worker));
 #endif
     }
     return true;
@@ -80,30 +106,36 @@ bool ThreadPool::init(int threads) {
 /**
  * The body function of a single thread.
  *
- * This function pulls tasks from the task queue.
+ * This function pulls tasks from the worker deque, the task queue, and
+ * the deques of the other workers (in that order).
  *
- * This implementation is safe to use with std::thread.
+ * @param worker    The state of this worker
  */
-void ThreadPool::threadFunc() {
+void ThreadPool::threadFunc(Worker* worker) {
+    current_worker = worker;
+    Task task;
+    int idle = 0;
     while (!_stop) {
-        std::function<void()> task = nullptr;
-        {   // Lock for save queue access
-            std::unique_lock<std::mutex> lk(_queueMutex);
-            if (_stop) {
-                break;
-            }
-            // Pull the next task off the queue
-            if (!_taskQueue.empty()) {
-                task = std::move(_taskQueue.front());
-                _taskQueue.pop();
-            } else {
-                _taskCondition.wait(lk);
-                continue;
-            }
+        if (acquire(worker,task)) {
+            // Perform the current task
+            task();
+            task.reset();
+            idle = 0;
+            continue;
+        } else if (idle++ < IDLE_SPINS) {
+            // Tasks often come in bursts, so yield a few times before sleeping
+            std::this_thread::yield();
+            continue;
         }
-        // Perform the current task
-        task();
+        
+        // Nothing to do, so wait for a new task
+        idle = 0;
+        std::unique_lock<std::mutex> lk(_sleepMutex);
+        _sleeping++;
+        _taskCondition.wait(lk, [this] { return _stop || _pending > 0; });
+        _sleeping--;
     }
+    current_worker = nullptr;
     _complete++;
 }
 
@@ -116,48 +148,119 @@ void ThreadPool::threadFunc() {
  * on Android and Windows, which have special thread requirements.
  */
 int ThreadPool::sdlThreadFunc(void* ptr) {
-    ThreadPool* self = (ThreadPool*)ptr;
-    while (!self->_stop) {
-        std::function<void()> task = nullptr;
-        {   // Lock for save queue access
-            std::unique_lock<std::mutex> lk(self->_queueMutex);
-            if (self->_stop) {
-                break;
-            }
-            // Pull the next task off the queue
-            if (!self->_taskQueue.empty()) {
-                task = std::move(self->_taskQueue.front());
-                self->_taskQueue.pop();
-            } else {
-                self->_taskCondition.wait(lk);
-                continue;
-            }
-        }
-        // Perform the current task
-        task();
-    }
-    self->_complete++;
+    Worker* worker = (Worker*)ptr;
+    worker->pool->threadFunc(worker);
     return 0;
 }
 
+/**
+ * Adds a task to the thread pool.
+ *
+ * If the calling thread is a worker of this pool, the task goes to the
+ * back of its deque. Otherwise, it goes to the task queue.
+ *
+ * @param task  the task to add
+ */
+void ThreadPool::push(Task&& task) {
+    Worker* worker = (Worker*)current_worker;
+    if (worker != nullptr && worker->pool == this) {
+        std::lock_guard<std::mutex> lk(worker->mutex);
+        worker->tasks.push_back(std::move(task));
+    } else {
+        std::lock_guard<std::mutex> lk(_queueMutex);
+        _taskQueue.push_back(std::move(task));
+    }
+    
+    // The sleeping count is raised before a worker checks for tasks, so
+    // either it sees this task, or we see that it is asleep.
+    _pending++;
+    if (_sleeping > 0) {
+        std::lock_guard<std::mutex> lk(_sleepMutex);
+        _taskCondition.notify_one();
+    }
+}
+
+/**
+ * Returns true if a task was removed for the given worker.
+ *
+ * The worker takes from the back of its own deque first, then from the
+ * task queue, and finally steals from the front of the other deques. If
+ * the worker is nullptr, only the last two are tried.
+ *
+ * @param worker    The worker taking the task (or nullptr)
+ * @param task      The task to store the result
+ *
+ * @return true if a task was removed for the given worker.
+ */
+bool ThreadPool::acquire(Worker* worker, Task& task) {
+    if (_pending == 0) {
+        return false;
+    }
+    
+    if (worker != nullptr) {
+        std::lock_guard<std::mutex> lk(worker->mutex);
+        if (!worker->tasks.empty()) {
+            task = std::move(worker->tasks.back());
+            worker->tasks.pop_back();
+            _pending--;
+            return true;
+        }
+    }
+    
+    {
+        std::lock_guard<std::mutex> lk(_queueMutex);
+        if (!_taskQueue.empty()) {
+            task = std::move(_taskQueue.front());
+            _taskQueue.pop_front();
+            _pending--;
+            return true;
+        }
+    }
+    
+    // Steal, starting from the next worker so thieves spread out
+    size_t size = _states.size();
+    size_t start = worker == nullptr ? 0 : worker->index+1;
+    for(size_t ii = 0; ii < size; ii++) {
+        Worker* victim = _states[(start+ii) % size].get();
+        if (victim == worker) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lk(victim->mutex);
+        if (!victim->tasks.empty()) {
+            task = std::move(victim->tasks.front());
+            victim->tasks.pop_front();
+            _pending--;
+            return true;
+        }
+    }
+    return false;
+}
 
 
 #pragma mark -
 #pragma mark Task Management
 /**
- * Adds a task to the thread pool.
+ * Returns true if a waiting task was run by the calling thread.
  *
- * A task is a void returning function with no parameters.  If you need
- * state in the task, you should use a method call for the state.  The task
- * will not be executed immediately, but must wait for the first available
- * worker.
+ * This method allows a thread waiting on other tasks to help with them,
+ * instead of blocking. If the calling thread is a worker of this pool, it
+ * looks at its own deque first. It then looks at the task queue, and
+ * finally steals from the workers.
  *
- * @param  task     the task function to add to the thread pool
+ * @return true if a waiting task was run by the calling thread.
  */
-void ThreadPool::addTask(const std::function<void()> &task){
-    std::unique_lock<std::mutex> lk(_queueMutex);
-    _taskQueue.emplace(task);
-    _taskCondition.notify_one();
+bool ThreadPool::runPending() {
+    Worker* worker = (Worker*)current_worker;
+    if (worker != nullptr && worker->pool != this) {
+        worker = nullptr;
+    }
+    
+    Task task;
+    if (acquire(worker,task)) {
+        task();
+        return true;
+    }
+    return false;
 }
 
 /**
@@ -165,11 +268,16 @@ void ThreadPool::addTask(const std::function<void()> &task){
  *
  * A stopped thread pool is marked for shutdown, but it shutdown has not
  * necessarily completed.  Shutdown will be complete when the current child
- * threads have finished with their tasks.
+ * threads have finished with their tasks. It is safe to call this method
+ * more than once.
  */
 void ThreadPool::stop() {
     {
-        std::unique_lock<std::mutex> lk(_queueMutex);
+        std::unique_lock<std::mutex> lk(_sleepMutex);
+        if (_stop) {
+            // The workers were already joined (e.g. dispose before the destructor)
+            return;
+        }
         _stop = true;
         _taskCondition.notify_all();
     }
@@ -200,3 +308,66 @@ void ThreadPool::sleep(Uint32 millis) {
     std::this_thread::sleep_for(std::chrono::milliseconds(millis));
 #endif
 }
+
+#pragma mark -
+#pragma mark Task Group
+/**
+ * Marks one task of this group as finished.
+ *
+ * The count is decremented under the mutex, so that a waiting thread
+ * cannot see it reach 0 (and delete the group) while this method is
+ * still using the group.
+ *
+ * @param error The exception thrown by the task (nullptr if none)
+ */
+void TaskGroup::finish(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lk(_mutex);
+    if (error != nullptr && _error == nullptr) {
+        _error = error;
+    }
+    if (--_count == 0) {
+        _done.notify_all();
+    }
+}
+
+/**
+ * Blocks until every task in this group has finished.
+ *
+ * Unlike {@link #wait}, this method does not rethrow task exceptions.
+ */
+void TaskGroup::join() {
+    while (true) {
+        if (_count > 0 && _pool->runPending()) {
+            continue;
+        }
+        
+        // Only return once we hold the lock with a count of 0. Then the last
+        // call to finish has released the lock, and the group may be deleted.
+        // Otherwise, the remaining tasks are running on other threads. Wake up
+        // now and then in case they add tasks we can help with.
+        std::unique_lock<std::mutex> lk(_mutex);
+        if (_count == 0) {
+            return;
+        }
+        _done.wait_for(lk, std::chrono::milliseconds(1), [this] { return _count == 0; });
+    }
+}
+
+/**
+ * Blocks until every task in this group has finished.
+ *
+ * The calling thread runs waiting tasks from the pool (which may or may not
+ * belong to this group) while it waits. If any task threw an exception,
+ * this method rethrows the first one once every task has finished.
+ */
+void TaskGroup::wait() {
+    join();
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lk(_mutex);
+        std::swap(error,_error);
+    }
+    if (error != nullptr) {
+        std::rethrow_exception(error);
+    }
+}
@@ -47,6 +47,7 @@
 #include <utf8/utf8.h>
 #include <cugl/core/util/CUDebug.h>
 #include <cugl/core/util/CUFiletools.h>
+#include <cugl/core/assets/CUAssetBundle.h>
 #include <cugl/core/util/CUStringTools.h>
 #include <cugl/graphics/CUTexture.h>
 #include <cugl/graphics/CUFont.h>
@@ -692,6 +693,54 @@ bool Font::init(const std::string file, Uint32 size) {
     return true;
 }
 
+/**
+ * Initializes a font of the given size from a file in the asset bundle.
+ *
+ * The font size is fixed on initialization.  It cannot be changed without
+ * disposing of the entire font.  However, all other attributes may be
+ * changed.
+ *
+ * The font reads the file directly from the bundle. It does not need the
+ * bundle to remain loaded.
+ *
+ * @param bundle    The asset bundle with the font file
+ * @param file      The path of the font file in the bundle
+ * @param size      The font size in points
+ *
+ * @return true if initialization is successful.
+ */
+bool Font::init(const std::shared_ptr<AssetBundle>& bundle, const std::string file, Uint32 size) {
+    if (_data != nullptr) {
+        CUAssertLog(false,"Font %s already loaded", _name.c_str());
+        return false;
+    }
+    // The font owns the stream, which keeps the bundle data alive
+    SDL_RWops* stream = bundle->open(file);
+    if (stream == nullptr) {
+        CUAssertLog(false, "Font %s is not in bundle %s", file.c_str(), bundle->getFile().c_str());
+        return false;
+    }
+    _data = TTF_OpenFontRW(stream, 1, size);
+    if (_data == nullptr) {
+        CUAssertLog(false, "Font initialization error: %s", TTF_GetError());
+        return false;
+    }
+    _fontSize = size;
+    const char* strng = TTF_FontFaceFamilyName(_data);
+    _name = std::string(strng);
+
+    strng = TTF_FontFaceStyleName(_data);
+    _stylename = std::string(strng);
+    
+    _fontHeight   = TTF_FontHeight(_data);
+    _fontAscent   = TTF_FontAscent(_data);
+    _fontDescent  = TTF_FontDescent(_data);
+    _fontLineSkip = TTF_FontLineSkip(_data);
+    _fixedWidth   = TTF_FontFaceIsFixedWidth(_data) != 0;
+
+    return true;
+}
+
 
 
 #pragma mark -
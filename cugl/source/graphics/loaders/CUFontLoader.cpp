@@ -44,6 +44,7 @@
 //  Version: 7/3/24 (CUGL 3.0 reorganization)
 //
 #include <cugl/graphics/loaders/CUFontLoader.h>
+#include <cugl/core/assets/CUAssetBundle.h>
 #include <cugl/core/util/CUFiletools.h>
 #include <cugl/core/CUApplication.h>
 #include <SDL_ttf.h>
@@ -85,6 +86,9 @@ _charset(UNKNOWN_CHARS) {
  * Hence this method does the maximum amount of work that can be done in
  * asynchronous font loading.
  *
+ * If the asset is in a mounted {@link AssetBundle}, it is read from the
+ * bundle instead of the asset directory.
+ *
  * @param source    The pathname to the asset
  * @param charset   The atlas character set
  * @param size      The font size
@@ -96,10 +100,15 @@ std::shared_ptr<Font> FontLoader::preload(const std::string source, const std::s
     bool absolute = cugl::filetool::is_absolute(source);
     CUAssertLog(!absolute, "This loader does not accept absolute paths for assets");
     
-    std::string root = Application::get()->getAssetDirectory();
-    std::string path = root+source;
-
-    std::shared_ptr<Font> result = Font::alloc(path.c_str(),size);
+    std::shared_ptr<Font> result = nullptr;
+    std::shared_ptr<AssetBundle> bundle = findBundle(source);
+    if (bundle != nullptr) {
+        result = Font::alloc(bundle,source,size);
+    } else {
+        std::string root = Application::get()->getAssetDirectory();
+        std::string path = root+source;
+        result = Font::alloc(path.c_str(),size);
+    }
     if (result == nullptr) {
         return result;
     }
@@ -136,6 +145,9 @@ std::shared_ptr<Font> FontLoader::preload(const std::string source, const std::s
  *      "stretch":      The font stretch limit
  *      "shrink":       The font shrink limit
  *
+ * If the asset is in a mounted {@link AssetBundle}, it is read from the
+ * bundle instead of the asset directory.
+ *
  * @param json      The directory entry for the asset
  *
  * @return the font asset with no generated atlas
@@ -164,7 +176,13 @@ std::shared_ptr<Font> FontLoader::preload(const std::shared_ptr<JsonValue>& json
     Uint32 stretch = json->getInt("stretch",0);
     Uint32 shrink  = json->getInt("shrink", 0);
 
-    std::shared_ptr<Font> result = Font::alloc(source.c_str(),size);
+    std::shared_ptr<Font> result = nullptr;
+    std::shared_ptr<AssetBundle> bundle = findBundle(source);
+    if (bundle != nullptr) {
+        result = Font::alloc(bundle,source,size);
+    } else {
+        result = Font::alloc(source.c_str(),size);
+    }
     if (result == nullptr) {
         return result;
     }
@@ -252,12 +270,11 @@ bool FontLoader::read(const std::string key, const std::string source, int size,
             _queue.erase(key);
         }
     } else {
-        _loader->addTask([=](void) {
-            this->enqueue(key);
+        enqueue(key);
+        addTask([=](void) {
             std::shared_ptr<Font> font = this->preload(source,_charset,size);
-            Application::get()->schedule([=](void){
+            this->defer([=](void){
                 this->materialize(key,font,callback);
-                return false;
             });
         });
     }
@@ -312,12 +329,11 @@ bool FontLoader::read(const std::shared_ptr<JsonValue>& json, LoaderCallback cal
             _queue.erase(key);
         }
     } else {
-        _loader->addTask([=](void) {
-            this->enqueue(key);
+        enqueue(key);
+        addTask([=](void) {
             std::shared_ptr<Font> font = this->preload(json);
-            Application::get()->schedule([=](void){
+            this->defer([=](void){
                 this->materialize(key,font,callback);
-                return false;
             });
         });
     }
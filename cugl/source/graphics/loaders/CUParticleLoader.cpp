@@ -175,12 +175,11 @@ bool ParticleLoader::read(const std::string key, const std::string source,
         }
         _queue.erase(key);
     } else {
-        _loader->addTask([=](void) {
-            this->enqueue(key);
+        enqueue(key);
+        addTask([=](void) {
             std::shared_ptr<ParticleSystem> system = this->preload(key,source);
-            Application::get()->schedule([=](void){
+            this->defer([=](void){
                 this->materialize(key,system,callback);
-                return false;
             });
         });
     }
@@ -228,12 +227,11 @@ bool ParticleLoader::read(const std::shared_ptr<JsonValue>& json,
         }
         _queue.erase(key);
     } else {
-        _loader->addTask([=](void) {
-            this->enqueue(key);
+        enqueue(key);
+        addTask([=](void) {
             std::shared_ptr<ParticleSystem> system = this->preload(json);
-            Application::get()->schedule([=](void){
+            this->defer([=](void){
                 this->materialize(key,system,callback);
-                return false;
             });
         });
     }
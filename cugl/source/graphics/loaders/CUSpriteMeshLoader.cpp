@@ -175,12 +175,11 @@ bool SpriteMeshLoader::read(const std::string key, const std::string source,
         }
         _queue.erase(key);
     } else {
-        _loader->addTask([=](void) {
-            this->enqueue(key);
+        enqueue(key);
+        addTask([=](void) {
             std::shared_ptr<SpriteMesh> mesh = this->preload(key,source);
-            Application::get()->schedule([=](void){
+            this->defer([=](void){
                 this->materialize(key,mesh,callback);
-                return false;
             });
         });
     }
@@ -227,12 +226,11 @@ bool SpriteMeshLoader::read(const std::shared_ptr<JsonValue>& json,
         }
         _queue.erase(key);
     } else {
-        _loader->addTask([=](void) {
-            this->enqueue(key);
+        enqueue(key);
+        addTask([=](void) {
             std::shared_ptr<SpriteMesh> mesh = this->preload(json);
-            Application::get()->schedule([=](void){
+            this->defer([=](void){
                 this->materialize(key,mesh,callback);
-                return false;
             });
         });
     }
@@ -44,6 +44,7 @@
 //  Version: 7/3/24 (CUGL 3.0 reorganization)
 //
 #include <cugl/graphics/loaders/CUTextureLoader.h>
+#include <cugl/core/assets/CUAssetBundle.h>
 #include <cugl/core/util/CUFiletools.h>
 #include <cugl/core/CUApplication.h>
 #include <SDL_image.h>
@@ -143,6 +144,7 @@ _wrapt(GL_CLAMP_TO_EDGE),
 _mipmaps(false) {
     _jsonKey  = "textures";
     _priority = 0;
+    _concurrent = true;
 }
 
 
@@ -156,6 +158,9 @@ _mipmaps(false) {
  * we need to create an OpenGL texture.  Hence this method does the maximum
  * amount of work that can be done in asynchronous texture loading.
  *
+ * If the asset is in a mounted {@link AssetBundle}, it is read from the
+ * bundle instead of the asset directory.
+ *
  * @param source    The pathname to the asset
  *
  * @return the SDL_Surface with the texture information
@@ -165,10 +170,19 @@ SDL_Surface* TextureLoader::preload(const std::string source) {
     bool absolute = cugl::filetool::is_absolute(source);
     CUAssertLog(!absolute, "This loader does not accept absolute paths for assets");
 
-    std::string root = Application::get()->getAssetDirectory();
-    std::string path = root+source;
-
-    SDL_Surface* surface = IMG_Load(path.c_str());
+    SDL_Surface* surface = nullptr;
+    std::shared_ptr<AssetBundle> bundle = findBundle(source);
+    if (bundle != nullptr) {
+        // Like IMG_Load, use the extension for formats without a signature
+        SDL_RWops* stream = bundle->open(source);
+        size_t pos = source.rfind('.');
+        std::string ext = pos == std::string::npos ? "" : source.substr(pos+1);
+        surface = stream == nullptr ? nullptr : IMG_LoadTyped_RW(stream, 1, ext.c_str());
+    } else {
+        std::string root = Application::get()->getAssetDirectory();
+        std::string path = root+source;
+        surface = IMG_Load(path.c_str());
+    }
     if (surface == nullptr) {
         return nullptr;
     }
@@ -201,7 +215,10 @@ SDL_Surface* TextureLoader::preload(const std::string source) {
  * @param callback  An optional callback for asynchronous loading
  */
 void TextureLoader::materialize(const std::string key, SDL_Surface* surface, LoaderCallback callback) {
-    std::shared_ptr<Texture> texture = Texture::allocWithData(surface->pixels, surface->w, surface->h, _mipmaps);
+    std::shared_ptr<Texture> texture = nullptr;
+    if (surface != nullptr) {
+        texture = Texture::allocWithData(surface->pixels, surface->w, surface->h, _mipmaps);
+    }
     
     bool success = false;
     if (texture != nullptr) {
@@ -251,7 +268,10 @@ void TextureLoader::materialize(const std::string key, SDL_Surface* surface, Loa
  * @param callback  An optional callback for asynchronous loading
  */
 void TextureLoader::materialize(const std::shared_ptr<JsonValue>& json, SDL_Surface* surface, LoaderCallback callback) {
-    std::shared_ptr<Texture> texture = Texture::allocWithData(surface->pixels, surface->w, surface->h);
+    std::shared_ptr<Texture> texture = nullptr;
+    if (surface != nullptr) {
+        texture = Texture::allocWithData(surface->pixels, surface->w, surface->h);
+    }
     std::string key = json->key();
 
     bool success = false;
@@ -308,19 +328,30 @@ bool TextureLoader::read(const std::string key, const std::string source, Loader
     bool success = false;
     if (_loader == nullptr || !async) {
         enqueue(key);
-        std::shared_ptr<Texture> texture = Texture::allocWithFile(source);
+        std::shared_ptr<Texture> texture = nullptr;
+        if (findBundle(source) != nullptr) {
+            SDL_Surface* surface = this->preload(source);
+            if (surface != nullptr) {
+                texture = Texture::allocWithData(surface->pixels, surface->w, surface->h);
+                SDL_FreeSurface(surface);
+            }
+            if (texture != nullptr) {
+                texture->setName(source);
+            }
+        } else {
+            texture = Texture::allocWithFile(source);
+        }
         success = (texture != nullptr);
         if (success) { 
 			_assets[key] = texture;
 		}
         _queue.erase(key);
     } else {
-        _loader->addTask([=](void) {
-            this->enqueue(key);
+        enqueue(key);
+        addTask([=](void) {
             SDL_Surface* surface = this->preload(source);
-            Application::get()->schedule([=](void){
+            this->defer([=](void){
                 this->materialize(key,surface,callback);
-                return false;
             });
         });
     }
@@ -378,19 +409,30 @@ bool TextureLoader::read(const std::shared_ptr<JsonValue>& json, LoaderCallback
     bool success = false;
     if (_loader == nullptr || !async) {
         enqueue(key);
-        std::shared_ptr<Texture> texture = Texture::allocWithFile(source);
+        std::shared_ptr<Texture> texture = nullptr;
+        if (findBundle(source) != nullptr) {
+            SDL_Surface* surface = this->preload(source);
+            if (surface != nullptr) {
+                texture = Texture::allocWithData(surface->pixels, surface->w, surface->h);
+                SDL_FreeSurface(surface);
+            }
+            if (texture != nullptr) {
+                texture->setName(source);
+            }
+        } else {
+            texture = Texture::allocWithFile(source);
+        }
         success = (texture != nullptr);
         if (success) { 
 			_assets[key] = texture;
 		}
         _queue.erase(key);
     } else {
-        _loader->addTask([=](void) {
-            this->enqueue(key);
+        enqueue(key);
+        addTask([=](void) {
             SDL_Surface* surface = this->preload(source);
-            Application::get()->schedule([=](void){
+            this->defer([=](void){
                 this->materialize(json,surface,callback);
-                return false;
             });
         });
     }
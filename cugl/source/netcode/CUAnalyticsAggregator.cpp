@@ -0,0 +1,485 @@
+//
+//  CUAnalyticsAggregator.cpp
+//  Cornell University Game Library (CUGL)
+//
+//  This class provides client-side sampling and aggregation for high
+//  frequency analytics actions. Games register an action "kind" with a rule,
+//  and the aggregator decides which events reach the analytics connection.
+//  Sampled events carry a weight so that totals can be estimated, while
+//  numeric events can be rolled up into a single counter or histogram action
+//  per interval. Every message is an ordinary action, so the server schema
+//  does not change.
+//
+//  This class uses our standard shared-pointer architecture.
+//
+//  1. The constructor does not perform any initialization; it just sets all
+//     attributes to their defaults.
+//
+//  2. All initialization takes place via init methods, which can fail if an
+//     object is initialized more than once.
+//
+//  3. All allocation takes place via static constructors which return a shared
+//     pointer.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Kidus Zegeye
+//  Version: 1/15/25
+//
+#include <cugl/netcode/CUAnalyticsAggregator.h>
+#include <cugl/core/CUApplication.h>
+#include <algorithm>
+
+using namespace cugl;
+using namespace cugl::netcode::analytics;
+
+/** The slot of a reservoir event that has not been drawn yet */
+#define SLOT_UNDRAWN    -2
+/** The slot of a reservoir event that is dropped */
+#define SLOT_DROPPED    -1
+
+/**
+ * Returns a deep copy of the given JSON value.
+ *
+ * JSON values cannot be shared between two trees, and the caller may modify
+ * the original after recording it. So sampled data is always copied.
+ *
+ * @param value The JSON value to copy
+ *
+ * @return a deep copy of the given JSON value.
+ */
+static std::shared_ptr<JsonValue> copy_json(const std::shared_ptr<JsonValue>& value) {
+    if (value == nullptr) {
+        return JsonValue::allocNull();
+    }
+    switch (value->type()) {
+        case JsonValue::Type::NullType:
+            return JsonValue::allocNull();
+        case JsonValue::Type::BoolType:
+            return JsonValue::alloc(value->asBool());
+        case JsonValue::Type::NumberType:
+            return JsonValue::alloc(value->asDouble());
+        case JsonValue::Type::StringType:
+            return JsonValue::alloc(value->asString());
+        case JsonValue::Type::ArrayType:
+        {
+            std::shared_ptr<JsonValue> result = JsonValue::allocArray();
+            for (size_t ii = 0; ii < value->size(); ii++) {
+                result->appendChild(copy_json(value->get((int)ii)));
+            }
+            return result;
+        }
+        case JsonValue::Type::ObjectType:
+        {
+            std::shared_ptr<JsonValue> result = JsonValue::allocObject();
+            for (size_t ii = 0; ii < value->size(); ii++) {
+                std::shared_ptr<JsonValue> child = value->get((int)ii);
+                result->appendChild(child->key(),copy_json(child));
+            }
+            return result;
+        }
+    }
+    return JsonValue::allocNull();
+}
+
+#pragma mark Constructors
+/**
+ * Creates a new, uninitialized aggregator.
+ *
+ * NEVER USE A CONSTRUCTOR WITH NEW. If you want to allocate an object on
+ * the heap, use one of the static constructors instead.
+ */
+AnalyticsAggregator::AnalyticsAggregator() :
+_connection(nullptr),
+_interval(0),
+_timerKey(0),
+_timerActive(false),
+_recorded(0),
+_forwarded(0) {
+}
+
+/**
+ * Disposes all of the resources used by this aggregator.
+ *
+ * Any pending samples and rollups are flushed to the connection first.
+ */
+void AnalyticsAggregator::dispose() {
+    if (_connection == nullptr) {
+        return;
+    }
+    if (_timerActive) {
+        Application* app = Application::get();
+        if (app != nullptr) {
+            app->unschedule(_timerKey);
+        }
+        _timerActive = false;
+    }
+    flush();
+    _kinds.clear();
+    _names.clear();
+    _connection = nullptr;
+    _interval = 0;
+}
+
+/**
+ * Initializes an aggregator for the given connection.
+ *
+ * If the interval is positive, the aggregator flushes reservoirs and
+ * rollups every interval milliseconds on the main thread. Otherwise,
+ * the application must call {@link flush} itself.
+ *
+ * @param connection    The analytics connection
+ * @param interval      The flush interval in milliseconds
+ *
+ * @return true if initialization was successful
+ */
+bool AnalyticsAggregator::init(const std::shared_ptr<AnalyticsConnection>& connection, Uint32 interval) {
+    if (_connection != nullptr) {
+        CUAssertLog(false, "Aggregator is already initialized");
+        return false;
+    } else if (connection == nullptr) {
+        return false;
+    }
+
+    _connection = connection;
+    _interval = interval;
+    _start = std::chrono::steady_clock::now();
+    _random.seed(std::random_device()());
+
+    Application* app = Application::get();
+    if (_interval > 0 && app != nullptr) {
+        // The timer may outlive this object, so never capture this directly
+        std::weak_ptr<AnalyticsAggregator> wp = weak_from_this();
+        _timerKey = app->schedule([wp]() {
+            std::shared_ptr<AnalyticsAggregator> self = wp.lock();
+            if (self == nullptr || !self->_timerActive) {
+                return false;
+            }
+            self->flush();
+            return true;
+        }, _interval, _interval);
+        _timerActive = true;
+    }
+    return true;
+}
+
+#pragma mark -
+#pragma mark Kinds
+/**
+ * Registers an action kind with the given rule.
+ *
+ * The identifier returned should be used to record events, as it avoids
+ * looking up the name on every event. This method returns
+ * {@link INVALID_KIND} if the name is already registered.
+ *
+ * @param name  The name of the kind
+ * @param rule  The aggregation rule
+ *
+ * @return the identifier of the new kind
+ */
+Uint32 AnalyticsAggregator::addKind(const std::string& name, const Rule& rule) {
+    if (_names.find(name) != _names.end()) {
+        return INVALID_KIND;
+    }
+
+    Kind kind;
+    kind.name = name;
+    kind.rule = rule;
+    kind.seen = 0;
+    kind.slot = SLOT_UNDRAWN;
+    kind.count = 0;
+    kind.sum = 0;
+    kind.min = 0;
+    kind.max = 0;
+    if (rule.mode == Mode::HISTOGRAM) {
+        std::sort(kind.rule.bounds.begin(), kind.rule.bounds.end());
+        kind.counts.resize(kind.rule.bounds.size()+1, 0);
+    } else if (rule.mode == Mode::RESERVOIR) {
+        kind.samples.reserve(rule.size);
+    }
+
+    Uint32 result = (Uint32)_kinds.size();
+    _kinds.push_back(std::move(kind));
+    _names.emplace(name,result);
+    return result;
+}
+
+/**
+ * Returns the identifier of the given kind.
+ *
+ * This method returns {@link INVALID_KIND} if the name is not registered.
+ *
+ * @param name  The name of the kind
+ *
+ * @return the identifier of the given kind.
+ */
+Uint32 AnalyticsAggregator::getKind(const std::string& name) const {
+    auto it = _names.find(name);
+    return it == _names.end() ? INVALID_KIND : it->second;
+}
+
+/**
+ * Returns true if the next event of the given kind will be sent.
+ *
+ * This is always false for rollups. For sampled kinds, the application
+ * can use this to skip building the event data, passing nullptr to
+ * {@link record} instead.
+ *
+ * @param kind  The kind identifier
+ *
+ * @return true if the next event of the given kind will be sent.
+ */
+bool AnalyticsAggregator::willSample(Uint32 kind) {
+    if (kind >= _kinds.size()) {
+        return false;
+    }
+    Kind& state = _kinds[kind];
+    switch (state.rule.mode) {
+        case Mode::EVERY_NTH:
+            return state.seen % state.rule.size == 0;
+        case Mode::RESERVOIR:
+            return drawSlot(state) != SLOT_DROPPED;
+        default:
+            return false;
+    }
+}
+
+#pragma mark -
+#pragma mark Recording
+/**
+ * Records an event of a sampled kind.
+ *
+ * The event is always counted, but only sampled events are sent. The
+ * data is copied if the event is kept for a reservoir, so the caller is
+ * free to reuse it. The data may be nullptr if {@link willSample} was
+ * false.
+ *
+ * @param kind      The kind identifier
+ * @param data      The event data
+ * @param attempts  The related task attempts
+ *
+ * @return true if the event was recorded
+ */
+bool AnalyticsAggregator::record(Uint32 kind, const std::shared_ptr<JsonValue>& data,
+                                 const std::vector<std::shared_ptr<TaskAttempt>>& attempts) {
+    if (kind >= _kinds.size()) {
+        return false;
+    }
+
+    Kind& state = _kinds[kind];
+    switch (state.rule.mode) {
+        case Mode::EVERY_NTH:
+        {
+            bool sampled = (state.seen % state.rule.size == 0);
+            state.seen++;
+            _recorded++;
+            if (sampled) {
+                forward(state, state.rule.size, data, attempts);
+            }
+            return true;
+        }
+        case Mode::RESERVOIR:
+        {
+            Sint64 slot = drawSlot(state);
+            state.slot = SLOT_UNDRAWN;
+            state.seen++;
+            _recorded++;
+            if (slot == SLOT_DROPPED) {
+                return true;
+            }
+
+            Sample sample;
+            sample.data = copy_json(data);
+            sample.attempts = attempts;
+            if ((size_t)slot < state.samples.size()) {
+                state.samples[slot] = std::move(sample);
+            } else {
+                state.samples.push_back(std::move(sample));
+            }
+            return true;
+        }
+        default:
+            // Rollups need a number
+            return false;
+    }
+}
+
+/**
+ * Records a value of a counter or histogram kind.
+ *
+ * This method does not allocate any memory.
+ *
+ * @param kind  The kind identifier
+ * @param value The value to roll up
+ *
+ * @return true if the value was recorded
+ */
+bool AnalyticsAggregator::record(Uint32 kind, double value) {
+    if (kind >= _kinds.size()) {
+        return false;
+    }
+
+    Kind& state = _kinds[kind];
+    if (state.rule.mode != Mode::COUNTER && state.rule.mode != Mode::HISTOGRAM) {
+        return false;
+    }
+
+    if (state.count == 0) {
+        state.min = value;
+        state.max = value;
+    } else {
+        state.min = std::min(state.min,value);
+        state.max = std::max(state.max,value);
+    }
+    state.count++;
+    state.sum += value;
+    _recorded++;
+
+    if (state.rule.mode == Mode::HISTOGRAM) {
+        const std::vector<double>& bounds = state.rule.bounds;
+        size_t bucket = std::lower_bound(bounds.begin(), bounds.end(), value)-bounds.begin();
+        state.counts[bucket]++;
+    }
+    return true;
+}
+
+/**
+ * Sends all pending reservoirs and rollups to the connection.
+ *
+ * This starts a new interval. It is called automatically if the
+ * aggregator has a flush interval.
+ */
+void AnalyticsAggregator::flush() {
+    auto now = std::chrono::steady_clock::now();
+    Uint64 interval = (Uint64)std::chrono::duration_cast<std::chrono::milliseconds>(now-_start).count();
+    _start = now;
+
+    for (auto it = _kinds.begin(); it != _kinds.end(); ++it) {
+        switch (it->rule.mode) {
+            case Mode::RESERVOIR:
+                if (!it->samples.empty()) {
+                    double weight = (double)it->seen/(double)it->samples.size();
+                    for (auto jt = it->samples.begin(); jt != it->samples.end(); ++jt) {
+                        forward(*it, weight, jt->data, jt->attempts);
+                    }
+                    it->samples.clear();
+                }
+                it->seen = 0;
+                it->slot = SLOT_UNDRAWN;
+                break;
+            case Mode::COUNTER:
+            case Mode::HISTOGRAM:
+                if (it->count > 0) {
+                    rollup(*it, interval);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+#pragma mark -
+#pragma mark Internal Helpers
+/**
+ * Returns the reservoir slot for the next event of the given kind.
+ *
+ * The slot is drawn once per event, so that {@link willSample} and
+ * {@link record} agree. A slot of -1 means the event is dropped.
+ *
+ * @param kind  The reservoir kind
+ *
+ * @return the reservoir slot for the next event of the given kind.
+ */
+Sint64 AnalyticsAggregator::drawSlot(Kind& kind) {
+    if (kind.slot != SLOT_UNDRAWN) {
+        return kind.slot;
+    }
+
+    // Algorithm R: the n-th event replaces a random slot with probability K/n
+    if (kind.seen < kind.rule.size) {
+        kind.slot = (Sint64)kind.seen;
+    } else {
+        std::uniform_int_distribution<Uint64> dist(0,kind.seen);
+        Uint64 index = dist(_random);
+        kind.slot = index < kind.rule.size ? (Sint64)index : SLOT_DROPPED;
+    }
+    return kind.slot;
+}
+
+/**
+ * Sends a sampled event to the connection.
+ *
+ * @param kind      The action kind
+ * @param weight    The number of events the sample represents
+ * @param data      The event data (which is not modified)
+ * @param attempts  The related task attempts
+ *
+ * @return true if the action was accepted by the connection
+ */
+bool AnalyticsAggregator::forward(const Kind& kind, double weight, const std::shared_ptr<JsonValue>& data,
+                                  const std::vector<std::shared_ptr<TaskAttempt>>& attempts) {
+    std::shared_ptr<JsonValue> action = JsonValue::allocObject();
+    action->appendValue("kind", kind.name);
+    action->appendValue("weight", weight);
+    // Reservoir samples were copied when they were recorded
+    action->appendChild("data", kind.rule.mode == Mode::RESERVOIR ? data : copy_json(data));
+    _forwarded++;
+    return _connection->recordAction(action, attempts);
+}
+
+/**
+ * Sends the rollup of the given kind, and resets it.
+ *
+ * @param kind      The counter or histogram kind
+ * @param interval  The length of the interval in milliseconds
+ */
+void AnalyticsAggregator::rollup(Kind& kind, Uint64 interval) {
+    bool histogram = kind.rule.mode == Mode::HISTOGRAM;
+    std::shared_ptr<JsonValue> action = JsonValue::allocObject();
+    action->appendValue("kind", kind.name);
+    action->appendValue("rollup", std::string(histogram ? "histogram" : "counter"));
+    action->appendValue("interval", (double)interval);
+    action->appendValue("count", (double)kind.count);
+    action->appendValue("sum", kind.sum);
+    action->appendValue("min", kind.min);
+    action->appendValue("max", kind.max);
+    if (histogram) {
+        std::shared_ptr<JsonValue> bounds = JsonValue::allocArray();
+        for (auto it = kind.rule.bounds.begin(); it != kind.rule.bounds.end(); ++it) {
+            bounds->appendValue(*it);
+        }
+        action->appendChild("bounds", bounds);
+
+        std::shared_ptr<JsonValue> counts = JsonValue::allocArray();
+        for (auto it = kind.counts.begin(); it != kind.counts.end(); ++it) {
+            counts->appendValue((double)*it);
+            *it = 0;
+        }
+        action->appendChild("counts", counts);
+    }
+
+    kind.count = 0;
+    kind.sum = 0;
+    kind.min = 0;
+    kind.max = 0;
+    _forwarded++;
+    _connection->recordAction(action);
+}
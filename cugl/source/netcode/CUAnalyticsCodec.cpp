@@ -0,0 +1,493 @@
+//
+//  CUAnalyticsCodec.cpp
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides the compact binary wire format for analytics messages.
+//  Binary messages are written with NetcodeSerializer. Repeated strings (such
+//  as task names, status values and task attempt UUIDs) are interned into a
+//  per-session dictionary, so that each message only carries a small integer
+//  reference. UUIDs are stored as 16 raw bytes instead of 36 characters.
+//
+//  The binary format is optional. It is only used once the server has agreed
+//  to it in response to the init message. The codec can translate any binary
+//  message back into JSON, which is how messages are delivered to servers
+//  that only accept JSON (and how they are stored in the offline spool).
+//
+//  This class uses our standard shared-pointer architecture.
+//
+//  1. The constructor does not perform any initialization; it just sets all
+//     attributes to their defaults.
+//
+//  2. All initialization takes place via init methods, which can fail if an
+//     object is initialized more than once.
+//
+//  3. All allocation takes place via static constructors which return a shared
+//     pointer.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Kidus Zegeye
+//  Version: 1/15/25
+//
+#include <cugl/netcode/CUAnalyticsCodec.h>
+#include <cugl/core/assets/CUJsonValue.h>
+#include <cugl/core/util/CUDebug.h>
+#include <cugl/core/util/CUHashtools.h>
+#include <exception>
+
+using namespace cugl;
+using namespace cugl::netcode;
+using namespace cugl::netcode::analytics;
+
+#pragma mark -
+#pragma mark Constructors
+/**
+ * Disposes all of the resources used by this codec.
+ *
+ * This clears the dictionary. Any message encoded before the dictionary
+ * was cleared can no longer be sent or decoded.
+ */
+void AnalyticsCodec::dispose() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _ids.clear();
+    _strings.clear();
+    _uuids.clear();
+    _limit = 0;
+}
+
+/**
+ * Initializes a codec with an empty dictionary.
+ *
+ * Once the dictionary reaches the given limit, new strings are written
+ * as literals instead of being interned.
+ *
+ * @param limit The maximum number of dictionary entries
+ *
+ * @return true if initialization was successful
+ */
+bool AnalyticsCodec::init(size_t limit) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _limit = limit;
+    return true;
+}
+
+#pragma mark -
+#pragma mark Accessors
+/**
+ * Returns the number of entries in the dictionary.
+ *
+ * @return the number of entries in the dictionary.
+ */
+size_t AnalyticsCodec::size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _strings.size();
+}
+
+#pragma mark -
+#pragma mark Encoding
+/**
+ * Writes a DICTIONARY message with the entries from the given id onwards.
+ *
+ * This method returns the new number of entries known to the receiver.
+ * If there are no entries at or after first, nothing is written.
+ *
+ * @param out   The serializer for the message
+ * @param first The first dictionary id to write
+ *
+ * @return the new number of entries known to the receiver
+ */
+size_t AnalyticsCodec::writeDictionary(NetcodeSerializer& out, size_t first) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_t last = _strings.size();
+    if (first >= last) {
+        return last;
+    }
+    writeCode(out, Code::DICTIONARY);
+    out.writeUint32((Uint32)first);
+    out.writeUint32((Uint32)(last-first));
+    for(size_t ii = first; ii < last; ii++) {
+        writeLiteral(out, _strings[ii], _uuids[ii]);
+    }
+    return last;
+}
+
+/**
+ * Writes a BATCH frame containing the given messages.
+ *
+ * Binary messages are copied into the frame as is. JSON messages are
+ * wrapped in a `JSON` message.
+ *
+ * @param messages  The messages to batch
+ * @param frame     The vector to store the frame
+ */
+void AnalyticsCodec::writeBatch(const std::vector<std::string>& messages, std::vector<std::byte>& frame) const {
+    NetcodeSerializer header;
+    writeCode(header, Code::BATCH);
+    header.writeUint32((Uint32)messages.size());
+
+    frame.clear();
+    const std::vector<std::byte>& prefix = header.serialize();
+    frame.insert(frame.end(), prefix.begin(), prefix.end());
+    for(const std::string& text : messages) {
+        const std::byte* bytes = reinterpret_cast<const std::byte*>(text.data());
+        if (isBinary(bytes, text.size())) {
+            frame.insert(frame.end(), bytes, bytes+text.size());
+        } else {
+            header.reset();
+            writeCode(header, Code::JSON);
+            header.writeString(text);
+            const std::vector<std::byte>& wrapped = header.serialize();
+            frame.insert(frame.end(), wrapped.begin(), wrapped.end());
+        }
+    }
+}
+
+#pragma mark -
+#pragma mark Decoding
+/**
+ * Writes the JSON form of the given binary message.
+ *
+ * A BATCH message becomes a JSON batch message. The JSON value is written
+ * to the given serializer (which may be in the middle of another value).
+ * This method returns false if the message is corrupt.
+ *
+ * @param message   The binary message
+ * @param out       The serializer for the JSON value
+ *
+ * @return true if the message was successfully transcoded.
+ */
+bool AnalyticsCodec::transcode(const std::vector<std::byte>& message, JsonSerializer& out) const {
+    NetcodeDeserializer in;
+    in.receive(message);
+    std::lock_guard<std::mutex> lock(_mutex);
+    try {
+        return transcodeMessage(in, out, false);
+    } catch (const std::exception& ex) {
+        CULogError("ANALYTICS ERROR: Corrupt binary message (%s)", ex.what());
+        return false;
+    }
+}
+
+/**
+ * Returns true if the given DICTIONARY message was added to the dictionary.
+ *
+ * This is the receiving half of {@link writeDictionary}, used by servers
+ * that decode binary messages. Entries are stored at the ids given in the
+ * message, so that later messages can be transcoded with {@link transcode}.
+ * This method returns false if the message is not a valid DICTIONARY
+ * message, or if it would exceed the dictionary limit.
+ *
+ * @param message   The binary message
+ *
+ * @return true if the given DICTIONARY message was added to the dictionary.
+ */
+bool AnalyticsCodec::readDictionary(const std::vector<std::byte>& message) {
+    NetcodeDeserializer in;
+    in.receive(message);
+    std::lock_guard<std::mutex> lock(_mutex);
+    try {
+        if (in.nextType() != NetcodeType::UInt32Type ||
+            static_cast<Code>(in.readUint32()) != Code::DICTIONARY ||
+            in.nextType() != NetcodeType::UInt32Type) {
+            return false;
+        }
+        size_t first = in.readUint32();
+        if (in.nextType() != NetcodeType::UInt32Type) {
+            return false;
+        }
+        size_t count = in.readUint32();
+        if (first+count > _limit) {
+            return false;
+        }
+        if (_strings.size() < first+count) {
+            _strings.resize(first+count);
+            _uuids.resize(first+count);
+        }
+        std::string value;
+        for(size_t ii = first; ii < first+count; ii++) {
+            // Entries are always literals, never references
+            NetcodeType type = in.nextType();
+            if (type == NetcodeType::UInt32Type || !readSlot(in, value)) {
+                return false;
+            }
+            _strings[ii] = value;
+            _uuids[ii] = (type == NetcodeType::UInt64Type);
+            _ids[value] = (Uint32)ii;
+        }
+        return true;
+    } catch (const std::exception& ex) {
+        CULogError("ANALYTICS ERROR: Corrupt dictionary message (%s)", ex.what());
+        return false;
+    }
+}
+
+#pragma mark -
+#pragma mark Internal Helpers
+/**
+ * Writes a slot for the given string, interning it if possible.
+ *
+ * @param out   The serializer for the message
+ * @param s     The string to write
+ * @param uuid  Whether the string should be stored as a UUID
+ */
+void AnalyticsCodec::writeSlot(NetcodeSerializer& out, const std::string& s, bool uuid) {
+    hashtool::BinaryUUID value;
+    uuid = uuid && value.parse(s, true);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _ids.find(s);
+    if (it != _ids.end()) {
+        out.writeUint32(it->second);
+        return;
+    }
+    if (_strings.size() >= _limit) {
+        writeLiteral(out, s, uuid);
+        return;
+    }
+
+    Uint32 id = (Uint32)_strings.size();
+    _ids.emplace(s, id);
+    _strings.push_back(s);
+    _uuids.push_back(uuid);
+    out.writeUint32(id);
+}
+
+/**
+ * Writes the given string as a literal.
+ *
+ * @param out   The serializer for the message
+ * @param s     The string to write
+ * @param uuid  Whether the string should be stored as a UUID
+ */
+void AnalyticsCodec::writeLiteral(NetcodeSerializer& out, const std::string& s, bool uuid) {
+    hashtool::BinaryUUID value;
+    if (uuid && value.parse(s, true)) {
+        out.writeUint64(value.high);
+        out.writeUint64(value.low);
+    } else {
+        out.writeString(s);
+    }
+}
+
+/**
+ * Returns true if the next slot was read into the given string.
+ *
+ * The mutex must be held when this method is called.
+ *
+ * @param in        The deserializer for the message
+ * @param result    The string to store the slot value
+ *
+ * @return true if the next slot was read into the given string.
+ */
+bool AnalyticsCodec::readSlot(NetcodeDeserializer& in, std::string& result) const {
+    switch (in.nextType()) {
+        case NetcodeType::UInt32Type:
+        {
+            Uint32 id = in.readUint32();
+            if (id >= _strings.size()) {
+                return false;
+            }
+            result = _strings[id];
+            return true;
+        }
+        case NetcodeType::StringType:
+            result = in.readString();
+            return true;
+        case NetcodeType::UInt64Type:
+        {
+            Uint64 high = in.readUint64();
+            if (in.nextType() != NetcodeType::UInt64Type) {
+                return false;
+            }
+            Uint64 low = in.readUint64();
+            result = hashtool::BinaryUUID(high, low).toString();
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+/**
+ * Returns true if the next message was transcoded to JSON.
+ *
+ * The mutex must be held when this method is called.
+ *
+ * @param in        The deserializer for the message
+ * @param out       The serializer for the JSON value
+ * @param nested    Whether this message is inside of a batch
+ *
+ * @return true if the next message was transcoded to JSON.
+ */
+bool AnalyticsCodec::transcodeMessage(NetcodeDeserializer& in, JsonSerializer& out, bool nested) const {
+    if (in.nextType() != NetcodeType::UInt32Type) {
+        return false;
+    }
+
+    Code code = static_cast<Code>(in.readUint32());
+    std::string value;
+    if (code == Code::JSON) {
+        if (in.nextType() != NetcodeType::StringType) {
+            return false;
+        }
+        out.writeRaw(in.readString());
+        return true;
+    } else if (code == Code::BATCH && nested) {
+        return false;
+    }
+
+    out.beginObject();
+    out.writeKey("message_type");
+    switch (code) {
+        case Code::TASK:
+            out.writeString("task");
+            out.writeKey("message_payload");
+            out.beginObject();
+            out.writeKey("task_name");
+            if (!readSlot(in, value)) {
+                return false;
+            }
+            out.writeString(value);
+            break;
+        case Code::TASK_ATTEMPT:
+        case Code::SYNC_TASK_ATTEMPT:
+            if (code == Code::TASK_ATTEMPT) {
+                out.writeString("task_attempt");
+                out.writeKey("message_payload");
+                out.beginObject();
+                out.writeKey("task_name");
+                if (!readSlot(in, value)) {
+                    return false;
+                }
+                out.writeString(value);
+            } else {
+                out.writeString("sync_task_attempt");
+                out.writeKey("message_payload");
+                out.beginObject();
+            }
+            out.writeKey("task_attempt_uuid");
+            if (!readSlot(in, value)) {
+                return false;
+            }
+            out.writeString(value);
+            out.writeKey("status");
+            if (!readSlot(in, value)) {
+                return false;
+            }
+            out.writeString(value);
+            if (in.nextType() != NetcodeType::SInt32Type) {
+                return false;
+            }
+            out.writeKey("num_failures");
+            out.writeSint64(in.readSint32());
+            if (in.nextType() != NetcodeType::JsonType) {
+                return false;
+            }
+            out.writeKey("statistics");
+            out.writeJson(in.readJson());
+            break;
+        case Code::SYNC_TASK_PATCH:
+        {
+            out.writeString("sync_task_attempt");
+            out.writeKey("message_payload");
+            out.beginObject();
+            out.writeKey("task_attempt_uuid");
+            if (!readSlot(in, value)) {
+                return false;
+            }
+            out.writeString(value);
+            out.writeKey("status");
+            if (!readSlot(in, value)) {
+                return false;
+            }
+            out.writeString(value);
+            if (in.nextType() != NetcodeType::SInt32Type) {
+                return false;
+            }
+            out.writeKey("num_failures");
+            out.writeSint64(in.readSint32());
+            if (in.nextType() != NetcodeType::UInt32Type) {
+                return false;
+            }
+            out.writeKey("version");
+            out.writeSint64(in.readUint32());
+            NetcodeType full = in.nextType();
+            if (full != NetcodeType::BooleanTrue && full != NetcodeType::BooleanFalse) {
+                return false;
+            }
+            out.writeKey(in.readBool() ? "statistics" : "patch");
+            if (in.nextType() != NetcodeType::JsonType) {
+                return false;
+            }
+            out.writeJson(in.readJson());
+            break;
+        }
+        case Code::ACTION:
+        {
+            out.writeString("action");
+            out.writeKey("message_payload");
+            out.beginObject();
+            if (in.nextType() != NetcodeType::UInt32Type) {
+                return false;
+            }
+            Uint32 count = in.readUint32();
+            out.writeKey("task_attempt_uuids");
+            out.beginArray();
+            for(Uint32 ii = 0; ii < count; ii++) {
+                if (!readSlot(in, value)) {
+                    return false;
+                }
+                out.writeString(value);
+            }
+            out.endArray();
+            if (in.nextType() != NetcodeType::JsonType) {
+                return false;
+            }
+            out.writeKey("data");
+            out.writeJson(in.readJson());
+            break;
+        }
+        case Code::BATCH:
+        {
+            out.writeString("batch");
+            out.writeKey("message_payload");
+            out.beginObject();
+            if (in.nextType() != NetcodeType::UInt32Type) {
+                return false;
+            }
+            Uint32 count = in.readUint32();
+            out.writeKey("messages");
+            out.beginArray();
+            for(Uint32 ii = 0; ii < count; ii++) {
+                if (!transcodeMessage(in, out, true)) {
+                    return false;
+                }
+            }
+            out.endArray();
+            break;
+        }
+        default:
+            // DICTIONARY messages are never stored, so they are never transcoded
+            return false;
+    }
+    out.endObject();
+    out.endObject();
+    return true;
+}
@@ -50,178 +50,1371 @@
 #include <cugl/netcode/CUAnalyticsConnection.h>
 #include <cugl/netcode/CUWebSocket.h>
 #include <cugl/core/util/CUDebug.h>
+#include <cugl/core/CUApplication.h>
 
 #include <SDL_app.h>
+#include <algorithm>
 #include <memory>
 #include <sstream>
-#include <thread>
+
+/** The fraction of the send queue that must be full to report backpressure */
+#define BACKPRESSURE_RATIO 0.75
+/** The number of eviction attempts for the DROP_OLDEST policy */
+#define EVICT_ATTEMPTS 4
+/** The time (in milliseconds) between slices of a spool replay */
+#define REPLAY_PERIOD 100
+/** The preferred segment size of the spool */
+#define SPOOL_SEGMENT 262144
+/** The minimum segment size of the spool */
+#define SPOOL_MIN_SEGMENT 1024
+/** The default time (in milliseconds) to wait for the websocket handshake */
+#define CONNECT_TIMEOUT 5000
+/** The default delay (in milliseconds) before the first reconnect */
+#define BACKOFF_MIN 500
+/** The default maximum delay (in milliseconds) between reconnects */
+#define BACKOFF_MAX 30000
+/** The maximum number of messages held in memory while disconnected */
+#define BACKLOG_LIMIT 1024
+/** The initial number of task attempts at which to remove expired attempts */
+#define ATTEMPT_LIMIT 64
 
 using namespace cugl;
 using namespace netcode;
 using namespace analytics;
 using namespace std;
 
-#pragma mark Constructors
 /**
- * Creates a degenerate websocket connection along with empty initializations for gameMetaData.
+ * Returns the given statistics, replacing nullptr with null
+ *
+ * NetcodeSerializer cannot encode a nullptr JsonValue.
+ *
+ * @param stats The task attempt statistics
+ *
+ * @return the given statistics, replacing nullptr with null
+ */
+static std::shared_ptr<JsonValue> statisticsOf(const std::shared_ptr<JsonValue> &stats)
+{
+    return stats ? stats : JsonValue::allocNull();
+}
+
+/**
+ * Returns a deep copy of the given JSON value.
+ *
+ * A JsonValue can only have one parent, so values that are shared between
+ * two trees must be copied.
+ *
+ * @param value The value to copy
+ *
+ * @return a deep copy of the given JSON value.
+ */
+static std::shared_ptr<JsonValue> copy_json(const std::shared_ptr<JsonValue>& value)
+{
+    if (value == nullptr)
+    {
+        return JsonValue::allocNull();
+    }
+    switch (value->type())
+    {
+        case JsonValue::Type::NullType:
+            return JsonValue::allocNull();
+        case JsonValue::Type::BoolType:
+            return JsonValue::alloc(value->asBool());
+        case JsonValue::Type::NumberType:
+            return JsonValue::alloc(value->asDouble());
+        case JsonValue::Type::StringType:
+            return JsonValue::alloc(value->asString());
+        case JsonValue::Type::ArrayType:
+        {
+            std::shared_ptr<JsonValue> result = JsonValue::allocArray();
+            for (size_t ii = 0; ii < value->size(); ii++)
+            {
+                result->appendChild(copy_json(value->get((int)ii)));
+            }
+            return result;
+        }
+        case JsonValue::Type::ObjectType:
+        {
+            std::shared_ptr<JsonValue> result = JsonValue::allocObject();
+            for (size_t ii = 0; ii < value->size(); ii++)
+            {
+                std::shared_ptr<JsonValue> child = value->get((int)ii);
+                result->appendChild(child->key(), copy_json(child));
+            }
+            return result;
+        }
+    }
+    return JsonValue::allocNull();
+}
+
+/**
+ * Appends the merge patch from previous to current to the given patch.
+ *
+ * The patch is appended with the given key. Nothing is appended if the values
+ * are the same. A nullptr value means the key is absent, so a removed key is
+ * patched with null. Objects are patched recursively, while every other value
+ * (including arrays) is replaced in full.
+ *
+ * @param patch     The patch object
+ * @param key       The key of the values
+ * @param current   The current value (or nullptr if absent)
+ * @param previous  The previous value (or nullptr if absent)
+ */
+static void diff_json(const std::shared_ptr<JsonValue>& patch, const std::string& key,
+                      const std::shared_ptr<JsonValue>& current,
+                      const std::shared_ptr<JsonValue>& previous)
+{
+    if (current == nullptr)
+    {
+        if (previous != nullptr)
+        {
+            patch->appendChild(key, JsonValue::allocNull());
+        }
+        return;
+    }
+    else if (previous == nullptr)
+    {
+        patch->appendChild(key, copy_json(current));
+        return;
+    }
+    else if (current->isObject() && previous->isObject())
+    {
+        std::shared_ptr<JsonValue> child = JsonValue::allocObject();
+        for (size_t ii = 0; ii < current->size(); ii++)
+        {
+            std::shared_ptr<JsonValue> value = current->get((int)ii);
+            diff_json(child, value->key(), value, previous->get(value->key()));
+        }
+        for (size_t ii = 0; ii < previous->size(); ii++)
+        {
+            std::shared_ptr<JsonValue> value = previous->get((int)ii);
+            if (!current->has(value->key()))
+            {
+                child->appendChild(value->key(), JsonValue::allocNull());
+            }
+        }
+        if (child->size() > 0)
+        {
+            patch->appendChild(key, child);
+        }
+        return;
+    }
+
+    if (current->type() != previous->type() ||
+        current->toString(false) != previous->toString(false))
+    {
+        patch->appendChild(key, copy_json(current));
+    }
+}
+
+#pragma mark TaskAttempt
+/**
+ * Marks the current statistics as synchronized with the server.
+ *
+ * This copies the statistics, so that the next sync can send only the
+ * statistics that changed.
+ */
+void TaskAttempt::markSynced()
+{
+    _syncedStatistics = _taskStatistics == nullptr ? nullptr : copy_json(_taskStatistics);
+    _dirtyKeys.clear();
+    _untracked = false;
+}
+
+/**
+ * Returns a merge patch from the last synced statistics to the current ones.
+ *
+ * The patch contains the changed keys of the dirty statistics (or of
+ * every statistic, if they may have been modified in place). Nested
+ * objects are patched recursively. The synced copy is updated to match,
+ * so the patch is only ever returned once.
+ *
+ * @return a merge patch from the last synced statistics to the current ones.
+ */
+std::shared_ptr<JsonValue> TaskAttempt::diffStatistics()
+{
+    std::shared_ptr<JsonValue> patch = JsonValue::allocObject();
+    if (_untracked)
+    {
+        for (size_t ii = 0; ii < _taskStatistics->size(); ii++)
+        {
+            _dirtyKeys.insert(_taskStatistics->get((int)ii)->key());
+        }
+        for (size_t ii = 0; ii < _syncedStatistics->size(); ii++)
+        {
+            _dirtyKeys.insert(_syncedStatistics->get((int)ii)->key());
+        }
+    }
+
+    for (const std::string& key : _dirtyKeys)
+    {
+        std::shared_ptr<JsonValue> current = _taskStatistics->get(key);
+        std::shared_ptr<JsonValue> previous = _syncedStatistics->get(key);
+        size_t before = patch->size();
+        diff_json(patch, key, current, previous);
+        if (patch->size() > before)
+        {
+            _syncedStatistics->removeChild(key);
+            if (current != nullptr)
+            {
+                _syncedStatistics->appendChild(key, copy_json(current));
+            }
+        }
+    }
+    _dirtyKeys.clear();
+    _untracked = false;
+    return patch;
+}
+
+/**
+ * Sets a top-level statistic of this TaskAttempt
+ *
+ * Only the statistics changed since the last sync are sent to the server.
+ *
+ * @param key    The statistic name
+ * @param value  The statistic value
+ */
+void TaskAttempt::setStatistic(const std::string key, long value)
+{
+    setStatistic(key, JsonValue::alloc(value));
+}
+
+/**
+ * Sets a top-level statistic of this TaskAttempt
+ *
+ * Only the statistics changed since the last sync are sent to the server.
+ *
+ * @param key    The statistic name
+ * @param value  The statistic value
+ */
+void TaskAttempt::setStatistic(const std::string key, double value)
+{
+    setStatistic(key, JsonValue::alloc(value));
+}
+
+/**
+ * Sets a top-level statistic of this TaskAttempt
+ *
+ * Only the statistics changed since the last sync are sent to the server.
+ *
+ * @param key    The statistic name
+ * @param value  The statistic value
+ */
+void TaskAttempt::setStatistic(const std::string key, bool value)
+{
+    setStatistic(key, JsonValue::alloc(value));
+}
+
+/**
+ * Sets a top-level statistic of this TaskAttempt
+ *
+ * Only the statistics changed since the last sync are sent to the server.
+ *
+ * @param key    The statistic name
+ * @param value  The statistic value
+ */
+void TaskAttempt::setStatistic(const std::string key, const std::string value)
+{
+    setStatistic(key, JsonValue::alloc(value));
+}
+
+/**
+ * Sets a top-level statistic of this TaskAttempt
+ *
+ * The value must not have a parent, as it is added to the statistics.
+ * Only the statistics changed since the last sync are sent to the server.
+ *
+ * @param key    The statistic name
+ * @param value  The statistic value
+ */
+void TaskAttempt::setStatistic(const std::string key, const std::shared_ptr<JsonValue>& value)
+{
+    if (_taskStatistics == nullptr || !_taskStatistics->isObject())
+    {
+        _taskStatistics = JsonValue::allocObject();
+        _untracked = true;
+    }
+    _taskStatistics->removeChild(key);
+    _taskStatistics->appendChild(key, value);
+    _dirtyKeys.insert(key);
+}
+
+/**
+ * Removes a top-level statistic of this TaskAttempt
+ *
+ * @param key    The statistic name
+ */
+void TaskAttempt::removeStatistic(const std::string key)
+{
+    if (_taskStatistics != nullptr && _taskStatistics->isObject())
+    {
+        _taskStatistics->removeChild(key);
+        _dirtyKeys.insert(key);
+    }
+}
+
+#pragma mark Constructors
+/**
+ * Creates a degenerate websocket connection along with empty initializations for gameMetaData.
+ *
+ * This object has not been initialized with a {@link NetcodeConfig} and cannot
+ * be used.
+ *
+ * You should NEVER USE THIS CONSTRUCTOR. All connections should be created by
+ * the static constructor {@link alloc} instead.
+ */
+AnalyticsConnection::AnalyticsConnection() : _webSocket(nullptr),
+                                             _config(nullptr),
+                                             _organization_name(""),
+                                             _game_name(""),
+                                             _version_number(""),
+                                             _vendor_id(""),
+                                             _platform(""),
+                                             _init_data_sent(false),
+                                             _attemptLimit(ATTEMPT_LIMIT),
+                                             _status(Status::DISCONNECTED),
+                                             _onStatus(nullptr),
+                                             _generation(0),
+                                             _timerKey(0),
+                                             _timerActive(false),
+                                             _reconnect(true),
+                                             _connectTimeout(CONNECT_TIMEOUT),
+                                             _backoffMin(BACKOFF_MIN),
+                                             _backoffMax(BACKOFF_MAX),
+                                             _failures(0),
+                                             _backlogSize(0),
+                                             _codec(nullptr),
+                                             _binaryReady(false),
+                                             _dictionarySent(0),
+                                             _deltaReady(false),
+                                             _queue(nullptr),
+                                             _held(0),
+                                             _flusher(nullptr),
+                                             _batching(false),
+                                             _batchSize(0),
+                                             _batchInterval(0),
+                                             _dropPolicy(DropPolicy::DROP_NEWEST),
+                                             _dropped(0),
+                                             _spool(nullptr),
+                                             _replayRate(0),
+                                             _replaying(false),
+                                             _replayKey(0) {}
+
+/**
+ * Deletes the analytics websocket connection, disposing all resources
+ */
+AnalyticsConnection::~AnalyticsConnection()
+{
+    dispose();
+}
+
+/**
+ * Initializes the AnalyticsConnection with the given websocket configuration along
+ * with the game MetaData. Starts opening the connection in order to send intialization
+ * data to the analytics server.
+ *
+ * This method does not wait for the connection to open. The initialization
+ * data is sent as soon as the websocket opens, and any messages recorded in
+ * the meantime are delivered after it.
+ *
+ * @param config The WebSocket configuration.
+ * @param organization_name The name of the organization.
+ * @param game_name The name of the game.
+ * @param version_number The version number of the game.
+ * @param debug  Whether to log debug messages from the connection
+ * @param binary Whether to offer the binary wire format to the server
+ * @return true if initialization was successful, false otherwise.
+ */
+bool AnalyticsConnection::init(const WebSocketConfig &config, const std::string &organization_name, const std::string &game_name, const std::string &version_number, const bool &debug, bool binary)
+{
+
+    InetAddress address = InetAddress(config.bindaddr, config.port);
+    _webSocket = WebSocket::alloc(address);
+    _organization_name = organization_name;
+    _game_name = game_name;
+    _version_number = version_number;
+    _vendor_id = hashtool::system_uuid();
+    _platform = APP_GetDeviceModel();
+    _config = std::make_shared<WebSocketConfig>(config);
+    _init_data_sent = false;
+    _codec = binary ? AnalyticsCodec::alloc() : nullptr;
+    _binaryReady = false;
+    _dictionarySent = 0;
+    _deltaReady = false;
+    _random.seed(std::random_device()());
+    setDebug(debug);
+
+    // The websocket may outlive this object, so never capture this directly
+    std::weak_ptr<AnalyticsConnection> wp = weak_from_this();
+    WebSocket::Dispatcher dispatcher = [wp](const std::vector<std::byte> &message, Uint64 time) {
+        std::shared_ptr<AnalyticsConnection> self = wp.lock();
+        if (self) {
+            self->onReceiptCallback(message, time);
+        }
+    };
+
+    WebSocket::StateCallback stateCallback = [wp](const WebSocket::State state) {
+        std::shared_ptr<AnalyticsConnection> self = wp.lock();
+        if (self) {
+            self->onStateChangeCallback(state);
+        }
+    };
+
+    _webSocket->onReceipt(dispatcher);
+    _webSocket->onStateChange(stateCallback);
+
+    open();
+    return true;
+}
+
+/**
+ * Disposes of the AnalyticsConnection resources.
+ *
+ * Closes the WebSocket and resets member variables to their default values.
+ * This method does not wait for the WebSocket to finish closing.
+ */
+void AnalyticsConnection::dispose()
+{
+    _onStatus = nullptr;
+    stopBatching();
+    close();
+    disableSpool();
+
+    if (_webSocket != nullptr)
+    {
+        _webSocket->onStateChange(nullptr);
+        _webSocket->onReceipt(nullptr);
+    }
+    {
+        std::lock_guard<std::mutex> lock(_backlogMutex);
+        _backlog.clear();
+        _backlogSize = 0;
+    }
+    _failures = 0;
+    _webSocket = nullptr;
+    _organization_name = "";
+    _game_name = "";
+    _version_number = "";
+    _vendor_id = "";
+    _platform = "";
+    _config = nullptr;
+    _init_data_sent = false;
+    _codec = nullptr;
+    _binaryReady = false;
+    _dictionarySent = 0;
+    _deltaReady = false;
+    _attempts.clear();
+    _attemptLimit = ATTEMPT_LIMIT;
+}
+
+#pragma mark Communication
+
+/**
+ * Starts opening the WebSocket connection.
+ *
+ * This method does not block. It starts the websocket handshake (unless it
+ * is already in progress) and returns immediately. If the handshake does not
+ * complete within the connect timeout, or the connection later fails, the
+ * connection retries with exponential backoff (see {@link setBackoff}).
+ * Use {@link getStatus} or {@link onStatusChange} to learn when the
+ * connection is open.
+ *
+ * Messages recorded before the connection opens are not lost. They are
+ * spooled (if spooling is enabled) or held in memory, and are sent after the
+ * initialization data once the connection opens.
+ *
+ * This method must be called on the main thread.
+ *
+ * @return true if a connection attempt is in progress.
+ */
+bool AnalyticsConnection::open()
+{
+    if (_webSocket == nullptr)
+    {
+        return false;
+    }
+    Status status = _status;
+    if (status == Status::CONNECTING || status == Status::CONNECTED)
+    {
+        return true;
+    }
+    // An explicit open skips any remaining backoff
+    _failures = 0;
+    connect();
+    return true;
+}
+
+/**
+ * Starts closing the WebSocket connection.
+ *
+ * This method does not block. It cancels any pending reconnect, and the
+ * connection will not reopen until {@link open} is called again.
+ *
+ * This method must be called on the main thread.
+ *
+ * @return true if the connection is closing (or was already closed).
+ */
+bool AnalyticsConnection::close()
+{
+    if (_webSocket == nullptr)
+    {
+        return false;
+    }
+    _generation++;
+    cancelTimer();
+    Status status = _status;
+    setStatus(Status::DISCONNECTED);
+    if (status == Status::CONNECTING || status == Status::CONNECTED)
+    {
+        _webSocket->close();
+        if (getDebug())
+        {
+            CULog("ANALYTICS: Websocket closing");
+        }
+    }
+    return true;
+}
+
+/**
+ * Starts a new connection attempt and arms the connect timeout.
+ */
+void AnalyticsConnection::connect()
+{
+    cancelTimer();
+    Uint32 generation = ++_generation;
+    setStatus(Status::CONNECTING);
+    try
+    {
+        _webSocket->open(_config->secure);
+    }
+    catch (const std::exception &ex)
+    {
+        CULogError("ANALYTICS ERROR: %s", ex.what());
+        retry();
+        return;
+    }
+
+    Application *app = Application::get();
+    if (app == nullptr || _connectTimeout == 0)
+    {
+        return;
+    }
+    std::weak_ptr<AnalyticsConnection> wp = weak_from_this();
+    _timerActive = true;
+    _timerKey = app->schedule([wp, generation]() {
+        std::shared_ptr<AnalyticsConnection> self = wp.lock();
+        if (self && self->_generation == generation && self->_status == Status::CONNECTING)
+        {
+            self->_timerActive = false;
+            if (self->getDebug())
+            {
+                CULog("ANALYTICS: Connection timed out");
+            }
+            self->_webSocket->close();
+            self->retry();
+        }
+        return false;
+    }, _connectTimeout);
+}
+
+/**
+ * Handles a failed connection attempt or a lost connection.
+ *
+ * If automatic reconnects are enabled, this schedules the next attempt after
+ * an exponential backoff delay. Otherwise the connection is disconnected.
+ */
+void AnalyticsConnection::retry()
+{
+    cancelTimer();
+    Uint32 generation = ++_generation;
+    Application *app = Application::get();
+    if (!_reconnect || app == nullptr)
+    {
+        setStatus(Status::DISCONNECTED);
+        return;
+    }
+
+    Uint64 delay = _backoffMin;
+    for (Uint32 ii = 0; ii < _failures && delay < _backoffMax; ii++)
+    {
+        delay *= 2;
+    }
+    delay = std::min<Uint64>(delay, _backoffMax);
+    // Equal jitter, so that clients do not reconnect in lockstep
+    std::uniform_int_distribution<Uint64> jitter(delay / 2, delay);
+    delay = jitter(_random);
+    _failures++;
+
+    if (getDebug())
+    {
+        CULog("ANALYTICS: Reconnecting in %llu ms", (unsigned long long)delay);
+    }
+    setStatus(Status::BACKOFF);
+
+    std::weak_ptr<AnalyticsConnection> wp = weak_from_this();
+    _timerActive = true;
+    _timerKey = app->schedule([wp, generation]() {
+        std::shared_ptr<AnalyticsConnection> self = wp.lock();
+        if (self && self->_generation == generation && self->_status == Status::BACKOFF)
+        {
+            self->_timerActive = false;
+            self->connect();
+        }
+        return false;
+    }, (Uint32)delay);
+}
+
+/**
+ * Cancels the pending connect timeout or reconnect (if any).
+ */
+void AnalyticsConnection::cancelTimer()
+{
+    if (_timerActive && Application::get())
+    {
+        Application::get()->unschedule(_timerKey);
+    }
+    _timerActive = false;
+}
+
+/**
+ * Sets the connection status, notifying the listener if it changed.
+ *
+ * @param status    The new connection status
+ */
+void AnalyticsConnection::setStatus(Status status)
+{
+    if (_status.exchange(status) != status && _onStatus)
+    {
+        _onStatus(status);
+    }
+}
+
+/**
+ * Advances the connection lifecycle in response to a websocket state change.
+ *
+ * This is the main thread half of {@link onStateChangeCallback}. Events from
+ * an earlier connection attempt are ignored.
+ *
+ * @param state         The new websocket state
+ * @param generation    The connection attempt at the time of the event
+ */
+void AnalyticsConnection::advance(WebSocket::State state, Uint32 generation)
+{
+    if (generation != _generation)
+    {
+        return;
+    }
+    Status status = _status;
+    switch (state)
+    {
+        case WebSocket::State::OPEN:
+            if (status == Status::CONNECTING)
+            {
+                cancelTimer();
+                _failures = 0;
+                setStatus(Status::CONNECTED);
+                scheduleReplay();
+            }
+            break;
+        case WebSocket::State::CLOSED:
+        case WebSocket::State::FAILED:
+            if (status == Status::CONNECTING || status == Status::CONNECTED)
+            {
+                retry();
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Sets the delays between reconnect attempts.
+ *
+ * The first reconnect waits about minDelay milliseconds, and every failed
+ * attempt doubles the delay, up to maxDelay. Each delay is randomized
+ * between half and all of its value so that many clients do not reconnect
+ * in lockstep after a server restart.
+ *
+ * @param minDelay  The delay (in milliseconds) before the first reconnect
+ * @param maxDelay  The maximum delay (in milliseconds) between reconnects
+ */
+void AnalyticsConnection::setBackoff(Uint32 minDelay, Uint32 maxDelay)
+{
+    _backoffMin = std::max<Uint32>(minDelay, 1);
+    _backoffMax = std::max(maxDelay, _backoffMin);
+}
+
+/**
+ * Starts encoding a new message of the given type.
+ *
+ * This writes the message envelope into the reusable encoder, leaving the
+ * `message_payload` object open. The caller should write the payload fields
+ * and then call {@link endMessage}.
+ *
+ * @param type  The message type
+ */
+void AnalyticsConnection::beginMessage(const std::string &type)
+{
+    _encoder.reset();
+    _encoder.beginObject();
+    _encoder.writeKey("message_type");
+    _encoder.writeString(type);
+    _encoder.writeKey("message_payload");
+    _encoder.beginObject();
+}
+
+/**
+ * Finishes encoding the current message and sends it.
+ *
+ * @return true if the message was successfully sent (or queued), false otherwise.
+ */
+bool AnalyticsConnection::endMessage()
+{
+    _encoder.endObject();
+    _encoder.endObject();
+    return send(_encoder.serialize());
+}
+
+/**
+ * Sends an encoded message to the WebSocket server.
+ *
+ * If batching is active, the message is queued instead. If the message
+ * cannot be sent because the connection is not open, it is deferred until
+ * the connection opens (see {@link defer}).
+ *
+ * @param message The encoded JSON message.
+ * @return true if the data was successfully sent (or deferred), false otherwise.
+ */
+bool AnalyticsConnection::send(const std::vector<std::byte> &message)
+{
+    if (_batching)
+    {
+        return enqueue(std::string(reinterpret_cast<const char *>(message.data()), message.size()));
+    }
+    if (mustDefer() || _status != Status::CONNECTED || !_webSocket->isOpen())
+    {
+        return defer(message.data(), message.size());
+    }
+    if (!sendInitialData() || !transmit(message))
+    {
+        return defer(message.data(), message.size());
+    }
+    return true;
+}
+
+/**
+ * Writes the given encoded message to the websocket.
+ *
+ * This method is shared by the synchronous path and the flusher thread. It
+ * does not consult the batching queue.
+ *
+ * A binary message is preceded by any dictionary entries the server has not
+ * seen yet. If the server has not accepted the binary format on this
+ * connection, the message is transcoded to JSON instead.
+ *
+ * @param message   The encoded (JSON or binary) message
+ * @return true if the message was successfully sent, false otherwise.
+ */
+bool AnalyticsConnection::transmit(const std::vector<std::byte> &message)
+{
+    bool binary = AnalyticsCodec::isBinary(message);
+    if (binary && !_binaryReady)
+    {
+        JsonSerializer json;
+        if (_codec == nullptr || !_codec->transcode(message, json))
+        {
+            return false;
+        }
+        return transmit(json.serialize());
+    }
+    else if (binary && !syncDictionary())
+    {
+        return false;
+    }
+
+    try
+    {
+        if (!_webSocket->send(message))
+        {
+            return false;
+        }
+    }
+    catch (const std::exception &ex)
+    {
+        CULogError("ANALYTICS ERROR: %s", ex.what());
+        _webSocket->close();
+        return false;
+    }
+    if (getDebug() && binary)
+    {
+        CULog("ANALYTICS SENT: %zu binary bytes", message.size());
+    }
+    else if (getDebug())
+    {
+        CULog("ANALYTICS SENT: %.*s", (int)message.size(), reinterpret_cast<const char *>(message.data()));
+    }
+    return true;
+}
+
+/**
+ * Sends any dictionary entries the server has not seen on this connection.
+ *
+ * @return true if the server has every dictionary entry
+ */
+bool AnalyticsConnection::syncDictionary()
+{
+    NetcodeSerializer entries;
+    size_t sent = _dictionarySent;
+    size_t known = _codec->writeDictionary(entries, sent);
+    if (known == sent)
+    {
+        return true;
+    }
+
+    try
+    {
+        if (!_webSocket->send(entries.serialize()))
+        {
+            return false;
+        }
+    }
+    catch (const std::exception &ex)
+    {
+        CULogError("ANALYTICS ERROR: %s", ex.what());
+        _webSocket->close();
+        return false;
+    }
+    // Entries are keyed by id, so a concurrent resend is harmless
+    _dictionarySent = known;
+    return true;
+}
+
+/**
+ * Returns true if the next message should be encoded in binary.
+ *
+ * If so, this method also resets the binary encoder and writes the given
+ * message code.
+ *
+ * @param code  The binary message code
+ * @return true if the next message should be encoded in binary.
+ */
+bool AnalyticsConnection::beginBinary(AnalyticsCodec::Code code)
+{
+    if (!_binaryReady)
+    {
+        return false;
+    }
+    _binaryEncoder.reset();
+    AnalyticsCodec::writeCode(_binaryEncoder, code);
+    return true;
+}
+
+#pragma mark Batching
+
+/**
+ * Starts sending analytics asynchronously in batches.
+ *
+ * Once batching starts, methods such as {@link addTaskAttempt} and
+ * {@link recordAction} no longer touch the websocket. Instead they encode
+ * the message and push it on a lock-free queue, returning immediately. A
+ * background thread coalesces the queued messages into a single `batch`
+ * frame whenever either `batchSize` messages are waiting or `interval`
+ * milliseconds have passed.
+ *
+ * If the queue is full, new messages are handled according to `policy`.
+ * In either case the method recording the message will never block. It
+ * returns false if the message was dropped.
+ *
+ * This method does nothing (and returns false) if batching is already active.
+ *
+ * @param capacity  The maximum number of queued messages
+ * @param batchSize The maximum number of messages in a single frame
+ * @param interval  The maximum time (in milliseconds) between flushes
+ * @param policy    The policy for handling a full queue
+ * @return true if batching was started
+ */
+bool AnalyticsConnection::startBatching(size_t capacity, size_t batchSize, Uint32 interval, DropPolicy policy)
+{
+    if (_batching || _webSocket == nullptr)
+    {
+        return false;
+    }
+
+    _queue = BoundedQueue<std::string>::alloc(capacity);
+    if (_queue == nullptr)
+    {
+        return false;
+    }
+    _batchSize = batchSize > 0 ? batchSize : 1;
+    _batchInterval = interval;
+    _dropPolicy = policy;
+    _dropped = 0;
+    _outgoing.clear();
+    _outgoing.reserve(_batchSize);
+    _held = 0;
+
+    _batching = true;
+    _flusher = ThreadPool::alloc(1);
+    _flusher->addTask([this]() { runFlusher(); });
+    return true;
+}
+
+/**
+ * Stops sending analytics asynchronously.
+ *
+ * This method makes one last attempt to flush the queue before stopping the
+ * background thread. Any messages that still cannot be sent are discarded,
+ * unless spooling is enabled.
+ * Afterwards, all messages are sent synchronously again.
+ */
+void AnalyticsConnection::stopBatching()
+{
+    if (!_batching)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_flushMutex);
+        _batching = false;
+    }
+    _flushCond.notify_all();
+
+    // This joins the flusher thread after its final flush
+    _flusher->dispose();
+    _flusher = nullptr;
+
+    if (getDebug() && (_held > 0 || !_queue->empty()))
+    {
+        CULog("ANALYTICS: Discarded %zu unsent messages", _held + _queue->size());
+    }
+    _outgoing.clear();
+    _held = 0;
+    _queue = nullptr;
+}
+
+/**
+ * Returns the (approximate) number of messages waiting to be sent.
  *
- * This object has not been initialized with a {@link NetcodeConfig} and cannot
- * be used.
+ * This includes messages in the queue as well as any messages that are
+ * held in memory because the socket is not open. It does not include
+ * spooled messages.
  *
- * You should NEVER USE THIS CONSTRUCTOR. All connections should be created by
- * the static constructor {@link alloc} instead.
+ * @return the (approximate) number of messages waiting to be sent.
  */
-AnalyticsConnection::AnalyticsConnection() : _webSocket(nullptr),
-                                             _config(nullptr),
-                                             _organization_name(""),
-                                             _game_name(""),
-                                             _version_number(""),
-                                             _vendor_id(""),
-                                             _platform(""),
-                                             _init_data_sent(false) {}
+size_t AnalyticsConnection::getPendingCount() const
+{
+    std::shared_ptr<BoundedQueue<std::string>> queue = _queue;
+    return (queue == nullptr ? 0 : queue->size()) + _held + _backlogSize;
+}
 
 /**
- * Deletes the analytics websocket connection, disposing all resources
+ * Returns true if the send queue is at least three quarters full.
+ *
+ * Games may use this to throttle optional analytics before messages start
+ * being dropped.
+ *
+ * @return true if the send queue is at least three quarters full.
  */
-AnalyticsConnection::~AnalyticsConnection()
+bool AnalyticsConnection::isBackpressured() const
 {
-    dispose();
+    std::shared_ptr<BoundedQueue<std::string>> queue = _queue;
+    if (queue == nullptr)
+    {
+        return false;
+    }
+    return queue->size() >= queue->capacity() * BACKPRESSURE_RATIO;
 }
 
 /**
- * Initializes the AnalyticsConnection with the given websocket configuration along
- * with the game MetaData. Opens the connection in order to send intialization data to the
- * analytics server.
+ * Adds the given encoded message to the asynchronous send queue.
  *
- * @param config The WebSocket configuration.
- * @param organization_name The name of the organization.
- * @param game_name The name of the game.
- * @param version_number The version number of the game.
- * @param debug  Whether to log debug messages from the connection
- * @return true if initialization was successful, false otherwise.
+ * If the queue is full, the message is handled according to the current
+ * {@link DropPolicy}. This method never blocks.
+ *
+ * @param text  The encoded JSON message
+ * @return true if the message was queued, false if it was dropped.
  */
-bool AnalyticsConnection::init(const WebSocketConfig &config, const std::string &organization_name, const std::string &game_name, const std::string &version_number, const bool &debug)
+bool AnalyticsConnection::enqueue(std::string &&text)
 {
+    bool queued = _queue->push(std::move(text));
+    if (!queued && _dropPolicy == DropPolicy::DROP_OLDEST)
+    {
+        std::string evicted;
+        for (int attempt = 0; !queued && attempt < EVICT_ATTEMPTS; attempt++)
+        {
+            if (_queue->pop(evicted))
+            {
+                _dropped++;
+            }
+            queued = _queue->push(std::move(text));
+        }
+    }
+    if (!queued)
+    {
+        _dropped++;
+    }
 
-    InetAddress address = InetAddress(config.bindaddr, config.port);
-    _webSocket = WebSocket::alloc(address);
-    _organization_name = organization_name;
-    _game_name = game_name;
-    _version_number = version_number;
-    _vendor_id = hashtool::system_uuid();
-    _platform = APP_GetDeviceModel();
-    _config = std::make_shared<WebSocketConfig>(config);
-    _init_data_sent = false;
-    setDebug(debug);
-
-    WebSocket::Dispatcher dispatcher = [this](const std::vector<std::byte> &message, Uint64 time) { onReceiptCallback(message, time);};
-
-    WebSocket::StateCallback stateCallback = [this](const WebSocket::State state) {onStateChangeCallback(state);};
+    // The flusher will wake up on its own at the next interval
+    if (_queue->size() >= _batchSize)
+    {
+        _flushCond.notify_one();
+    }
+    return queued;
+}
 
-    _webSocket->onReceipt(dispatcher);
-    _webSocket->onStateChange(stateCallback);
+/**
+ * Sends all messages that have been queued so far.
+ *
+ * Messages are coalesced into a single `batch` frame of at most the batch
+ * size. Messages that cannot be sent (because the socket is closed) are
+ * spooled if spooling is enabled, and are otherwise kept for the next flush.
+ * This method is only called on the flusher thread.
+ */
+void AnalyticsConnection::flush()
+{
+    std::string text;
+    while (true)
+    {
+        while (_outgoing.size() < _batchSize && _queue->pop(text))
+        {
+            _outgoing.push_back(std::move(text));
+        }
+        _held = _outgoing.size();
+        if (_outgoing.empty())
+        {
+            return;
+        }
+        // Wait for the main thread to send the initialization data (or replay the spool)
+        if (!_webSocket->isOpen() || !_init_data_sent || mustDefer())
+        {
+            spoolOutgoing();
+            if (!_outgoing.empty())
+            {
+                return;
+            }
+            continue;
+        }
 
-    open();
-    sendInitialData();
-    return true;
+        if (_outgoing.size() == 1)
+        {
+            const std::byte *bytes = reinterpret_cast<const std::byte *>(_outgoing.front().data());
+            _frame.assign(bytes, bytes + _outgoing.front().size());
+        }
+        else if (_binaryReady)
+        {
+            _codec->writeBatch(_outgoing, _frame);
+        }
+        else
+        {
+            _batchEncoder.reset();
+            _batchEncoder.beginObject();
+            _batchEncoder.writeKey("message_type");
+            _batchEncoder.writeString("batch");
+            _batchEncoder.writeKey("message_payload");
+            _batchEncoder.beginObject();
+            _batchEncoder.writeKey("messages");
+            _batchEncoder.beginArray();
+            for (const std::string &text : _outgoing)
+            {
+                const std::byte *bytes = reinterpret_cast<const std::byte *>(text.data());
+                if (!AnalyticsCodec::isBinary(bytes, text.size()))
+                {
+                    _batchEncoder.writeRaw(text);
+                    continue;
+                }
+                // Encoded before the server rejected (or lost) the binary format
+                _scratchEncoder.reset();
+                if (_codec->transcode(std::vector<std::byte>(bytes, bytes + text.size()), _scratchEncoder))
+                {
+                    _batchEncoder.writeRaw(_scratchEncoder.toString());
+                }
+            }
+            _batchEncoder.endArray();
+            _batchEncoder.endObject();
+            _batchEncoder.endObject();
+            const std::vector<std::byte> &json = _batchEncoder.serialize();
+            _frame.assign(json.begin(), json.end());
+        }
+        bool sent = transmit(_frame);
+        if (!sent)
+        {
+            spoolOutgoing();
+            if (!_outgoing.empty())
+            {
+                return;
+            }
+            continue;
+        }
+        _outgoing.clear();
+        _held = 0;
+    }
 }
 
 /**
- * Disposes of the AnalyticsConnection resources.
+ * Moves all messages held by the flusher thread into the spool.
  *
- * Closes the WebSocket and resets member variables to their default values.
+ * If spooling is disabled, the messages are kept for the next flush.
  */
-void AnalyticsConnection::dispose()
+void AnalyticsConnection::spoolOutgoing()
 {
-    close();
+    if (_spool == nullptr)
+    {
+        return;
+    }
+    for (const std::string &text : _outgoing)
+    {
+        store(reinterpret_cast<const std::byte *>(text.data()), text.size());
+    }
+    _outgoing.clear();
+    _held = 0;
+}
 
-    _webSocket = nullptr;
-    _organization_name = "";
-    _game_name = "";
-    _version_number = "";
-    _vendor_id = "";
-    _platform = "";
-    _config = nullptr;
-    _init_data_sent = false;
+/**
+ * The main loop of the flusher thread.
+ *
+ * This thread wakes up every batch interval, or sooner if the queue reaches
+ * the batch size, and flushes the queue.
+ */
+void AnalyticsConnection::runFlusher()
+{
+    while (_batching)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_flushMutex);
+            // Do not wake early if the last batch is still waiting on the socket
+            _flushCond.wait_for(lock, std::chrono::milliseconds(_batchInterval), [this]() {
+                return !_batching || (_held == 0 && _queue->size() >= _batchSize);
+            });
+        }
+        flush();
+    }
 }
 
-#pragma mark Communication
+#pragma mark Offline Spooling
 
 /**
- * Opens the WebSocket connection.
+ * Enables durable spooling of messages that cannot be sent.
  *
- * @return true if the connection was successfully opened.
+ * Once spooling is enabled, a message that cannot be delivered because the
+ * analytics server is unreachable is appended to a spool on disk instead of
+ * being lost. This includes messages held by the batching thread. The spool
+ * survives application restarts, and is replayed in order (after the
+ * initialization data) whenever the websocket opens. To avoid flooding the
+ * server after a long outage, at most `replayRate` messages are replayed per
+ * second. Messages recorded while a replay is in progress are added to the
+ * end of the spool so that the server still receives them in order. Any
+ * messages already held in memory while waiting for the connection are
+ * moved to the spool.
+ *
+ * The spool directory is relative to the application save directory unless
+ * it is an absolute path. When the spool reaches `capacity` bytes, the oldest
+ * messages are discarded.
+ *
+ * This method must be called while batching is inactive. It returns false if
+ * spooling is already enabled.
+ *
+ * @param directory     The spool directory
+ * @param capacity      The maximum number of bytes on disk
+ * @param replayRate    The maximum number of messages replayed per second
+ * @return true if spooling was enabled
  */
-bool AnalyticsConnection::open()
+bool AnalyticsConnection::enableSpool(const std::string &directory, size_t capacity, Uint32 replayRate)
 {
-    _webSocket->open(_config->secure);
+    if (_spool != nullptr || _batching || _webSocket == nullptr)
+    {
+        return false;
+    }
 
-    while (!_webSocket->isOpen())
+    size_t segment = std::max<size_t>(std::min<size_t>(SPOOL_SEGMENT, capacity / 4), SPOOL_MIN_SEGMENT);
+    _spool = AnalyticsSpool::alloc(directory, std::max(capacity, segment), segment);
+    if (_spool == nullptr)
     {
-        // Normally should be CONNECTING
-        if (_webSocket->getState() == WebSocket::State::CLOSED || _webSocket->getState() == WebSocket::State::FAILED){
-            return false;
+        return false;
+    }
+    _replayRate = std::max<Uint32>(replayRate, 1);
+    {
+        // The backlog is newer than anything already in the spool
+        std::lock_guard<std::mutex> lock(_backlogMutex);
+        for (const std::vector<std::byte> &message : _backlog)
+        {
+            store(message.data(), message.size());
         }
-            std::this_thread::sleep_for(100ms);
-
+        _backlog.clear();
+        _backlogSize = 0;
+    }
+    if (!_spool->empty() && _webSocket->isOpen())
+    {
+        scheduleReplay();
     }
     return true;
 }
 
 /**
- * Closes the WebSocket connection.
+ * Disables durable spooling of messages.
  *
- * @return true if the connection was successfully closed.
+ * Any messages already spooled remain on disk, and will be replayed the next
+ * time spooling is enabled with the same directory. This method must be called
+ * while batching is inactive.
  */
-bool AnalyticsConnection::close()
+void AnalyticsConnection::disableSpool()
+{
+    if (_batching)
+    {
+        return;
+    }
+    if (_replaying.exchange(false) && Application::get())
+    {
+        Application::get()->unschedule(_replayKey);
+    }
+    _spool = nullptr;
+}
+
+/**
+ * Stores the given encoded message in the spool for a later replay.
+ *
+ * @param data  The encoded JSON message
+ * @param size  The number of bytes in the message
+ * @return true if the message was spooled, false if spooling is disabled or failed.
+ */
+bool AnalyticsConnection::store(const std::byte *data, size_t size)
+{
+    if (_spool == nullptr)
+    {
+        return false;
+    }
+    if (!AnalyticsCodec::isBinary(data, size))
+    {
+        return _spool->append(data, size);
+    }
+
+    // The dictionary does not outlive the session, so the spool only holds JSON
+    JsonSerializer json;
+    if (_codec == nullptr || !_codec->transcode(std::vector<std::byte>(data, data + size), json))
+    {
+        return false;
+    }
+    return _spool->append(json.serialize());
+}
+
+/**
+ * Holds the given encoded message until the connection opens.
+ *
+ * If spooling is enabled, the message is spooled. Otherwise it is added to
+ * an in-memory backlog, which discards its oldest message when full.
+ *
+ * @param data  The encoded message
+ * @param size  The number of bytes in the message
+ * @return true if the message was deferred, false if it could not be stored.
+ */
+bool AnalyticsConnection::defer(const std::byte *data, size_t size)
 {
-    _webSocket->close();
-    while (!(_webSocket->getState() == WebSocket::State::CLOSED))
+    if (_spool != nullptr)
     {
-        std::this_thread::sleep_for(100ms);
+        return store(data, size);
     }
-    if (getDebug()){
-        CULog("Websocket closed");
+
+    std::lock_guard<std::mutex> lock(_backlogMutex);
+    if (_backlog.size() >= BACKLOG_LIMIT)
+    {
+        _backlog.pop_front();
+        _dropped++;
     }
+    _backlog.emplace_back(data, data + size);
+    _backlogSize = _backlog.size();
     return true;
 }
 
 /**
- * Sends data to the WebSocket server.
+ * Returns true if new messages must be deferred to preserve their order.
  *
- * @param data The JSON data to send.
- * @return true if the data was successfully sent, false otherwise.
+ * This is the case while earlier messages are still waiting in the spool
+ * or the backlog.
+ *
+ * @return true if new messages must be deferred to preserve their order.
+ */
+bool AnalyticsConnection::mustDefer() const
+{
+    return _backlogSize > 0 || (_spool != nullptr && !_spool->empty());
+}
+
+/**
+ * Schedules a replay of the deferred messages on the main thread.
+ *
+ * This is called when the websocket opens. The replay resends the
+ * initialization data (if necessary) before any deferred messages.
  */
-bool AnalyticsConnection::send(std::shared_ptr<JsonValue> &data)
+void AnalyticsConnection::scheduleReplay()
 {
-    if (!_webSocket->isOpen())
+    bool expected = false;
+    if (Application::get() == nullptr || !_replaying.compare_exchange_strong(expected, true))
     {
-        if (!open()){
-            return false;
-        }
+        return;
     }
-    // Need to encode bytes without metadata from NetcodeSerializer
-    std::vector<std::byte> bytes;
-    try
+    std::weak_ptr<AnalyticsConnection> wp = weak_from_this();
+    _replayKey = Application::get()->schedule([wp]() {
+        std::shared_ptr<AnalyticsConnection> self = wp.lock();
+        return self != nullptr && self->replay();
+    }, 0, REPLAY_PERIOD);
+}
+
+/**
+ * Replays a single slice of the deferred messages.
+ *
+ * This is the scheduled callback started by {@link scheduleReplay}. It sends
+ * at most the replay rate worth of messages, spooled messages first, and
+ * returns true if it needs to run again.
+ *
+ * @return true if there are deferred messages remaining
+ */
+bool AnalyticsConnection::replay()
+{
+    if (_webSocket == nullptr || !_webSocket->isOpen())
+    {
+        _replaying = false;
+        return false;
+    }
+    if (!sendInitialData())
     {
-        for (char &c : data->toString())
+        return true;
+    }
+
+    size_t budget = _spool != nullptr ? std::max<size_t>((size_t)_replayRate * REPLAY_PERIOD / 1000, 1) : BACKLOG_LIMIT;
+    if (_spool != nullptr)
+    {
+        AnalyticsSpool::Record record;
+        for (; budget > 0 && _spool->peek(record); budget--)
+        {
+            if (!transmit(record.message))
+            {
+                break;
+            }
+            _spool->pop();
+        }
+        _spool->commit();
+        if (!_spool->empty())
         {
-            bytes.push_back(static_cast<std::byte>(c));
+            return true;
         }
-        _webSocket->send(bytes);
     }
-    catch (const std::exception &ex)
+
+    std::lock_guard<std::mutex> lock(_backlogMutex);
+    for (; budget > 0 && !_backlog.empty(); budget--)
     {
-        CULogError("ANALYTICS ERROR: %s", ex.what());
-        _webSocket->close();
-        return false;
+        if (!transmit(_backlog.front()))
+        {
+            break;
+        }
+        _backlog.pop_front();
     }
-    if (getDebug())
+    _backlogSize = _backlog.size();
+    if (!_backlog.empty())
     {
-        CULog("ANALYTICS SENT: %s", data->toString().c_str());
+        return true;
     }
-    return true;
+    _replaying = false;
+    return false;
 }
+
 #pragma mark Callbacks
 
 /**
@@ -239,21 +1432,104 @@ void AnalyticsConnection::onReceiptCallback(const std::vector<std::byte> &messag
 
         std::shared_ptr<JsonValue> responseJSON = JsonValue::allocWithJson(disp.str());
         CULog("ANALYTICS RESPONSE: %s", responseJSON->toString().c_str());
+        if (_codec != nullptr && responseJSON->getBool("binary", false) &&
+            responseJSON->getString("message") == "Init recorded")
+        {
+            // The dictionary is resent lazily before the first binary frame
+            _dictionarySent = 0;
+            _binaryReady = true;
+        }
+        if (responseJSON->getBool("delta", false) &&
+            responseJSON->getString("message") == "Init recorded")
+        {
+            _deltaReady = true;
+        }
         if (responseJSON->has("error"))
         {
             //std::string errorMessage = responseJSON->get("error")->asString();
             //throw(errorMessage);
             CULog("%s", responseJSON->toString().c_str());
+            if (responseJSON->getBool("resync", false))
+            {
+                resync(responseJSON);
+            }
         }
     };
 
 /**
- * Callback function that logs state changes in the websocket connection
+ * Callback function that tracks state changes in the websocket connection
+ *
+ * This callback may be invoked on the network thread. It resets the session
+ * state immediately, and forwards the event to {@link advance} on the main
+ * thread.
  *
  * @param state The new websocket state
  */
 void AnalyticsConnection::onStateChangeCallback(const WebSocket::State state){
-    CULog("State change: %d", state);
+    if (getDebug())
+    {
+        CULog("ANALYTICS: State change %d", (int)state);
+    }
+    if (Application::get() != nullptr)
+    {
+        std::weak_ptr<AnalyticsConnection> wp = weak_from_this();
+        Uint32 generation = _generation;
+        Application::get()->schedule([wp, state, generation]() {
+            std::shared_ptr<AnalyticsConnection> self = wp.lock();
+            if (self)
+            {
+                self->advance(state, generation);
+            }
+            return false;
+        });
+    }
+    switch (state)
+    {
+        case WebSocket::State::CLOSED:
+        case WebSocket::State::FAILED:
+            // The server expects the initialization data again on reconnect
+            _init_data_sent = false;
+            _binaryReady = false;
+            _dictionarySent = 0;
+            _deltaReady = false;
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Resends the full statistics of a task attempt the server could not patch.
+ *
+ * The server rejects a patch whose version does not follow the last version
+ * it received. This happens when an earlier sync was lost (for example, when
+ * the backlog overflowed). Errors for patches sent before the last full sync
+ * are ignored, as that sync already repaired the statistics.
+ *
+ * @param response  The error response from the server
+ */
+void AnalyticsConnection::resync(const std::shared_ptr<JsonValue>& response)
+{
+    auto it = _attempts.find(response->getString("task_attempt_uuid"));
+    if (it == _attempts.end())
+    {
+        return;
+    }
+
+    std::shared_ptr<TaskAttempt> taskAttempt = it->second.lock();
+    if (taskAttempt == nullptr)
+    {
+        _attempts.erase(it);
+        return;
+    }
+
+    Uint32 version = (Uint32)response->getLong("version", 0);
+    if (version < taskAttempt->_fullVersion)
+    {
+        return;
+    }
+    taskAttempt->_resync = true;
+    syncTaskAttempt(taskAttempt);
 }
 
 #pragma mark Accessors
@@ -286,21 +1562,48 @@ bool AnalyticsConnection::getDebug()
 /**
 * Sends initialization data to the analytics server.
 *
+* The initialization data is never batched or spooled, as the server expects
+* it at the start of every connection. It is sent automatically whenever the
+* connection opens, so there is rarely any need to call this method. This
+* method does not open the connection.
+*
 * @return true if initialization data has been sent successfully 
 */
 bool AnalyticsConnection::sendInitialData(){
-    if (!_init_data_sent){
-        std::string initJSONString = "{\"message_type\": \"init\","
-                                    "\"message_payload\": {"
-                                        "\"organization_name\": \"" + _organization_name + "\","
-                                        "\"game_name\": \"" + _game_name + "\","
-                                        "\"version_number\": \"" + _version_number + "\","
-                                        "\"vendor_id\": \"" +  _vendor_id + "\","
-                                        "\"platform\": \"" +  _platform + "\""
-                                    "}}";
-        std::shared_ptr<JsonValue> initPayload = JsonValue::allocWithJson(initJSONString);
-        _init_data_sent = send(initPayload);
+    if (_init_data_sent){
+        return true;
     }
+    if (!_webSocket->isOpen()){
+        return false;
+    }
+
+    // This may be called while _encoder holds another message
+    JsonSerializer encoder;
+    encoder.beginObject();
+    encoder.writeKey("message_type");
+    encoder.writeString("init");
+    encoder.writeKey("message_payload");
+    encoder.beginObject();
+    encoder.writeKey("organization_name");
+    encoder.writeString(_organization_name);
+    encoder.writeKey("game_name");
+    encoder.writeString(_game_name);
+    encoder.writeKey("version_number");
+    encoder.writeString(_version_number);
+    encoder.writeKey("vendor_id");
+    encoder.writeString(_vendor_id);
+    encoder.writeKey("platform");
+    encoder.writeString(_platform);
+    if (_codec != nullptr)
+    {
+        encoder.writeKey("binary");
+        encoder.writeBool(true);
+    }
+    encoder.writeKey("delta");
+    encoder.writeBool(true);
+    encoder.endObject();
+    encoder.endObject();
+    _init_data_sent = transmit(encoder.serialize());
     return _init_data_sent;
 }
 
@@ -312,13 +1615,19 @@ bool AnalyticsConnection::sendInitialData(){
  */
 bool AnalyticsConnection::addTask(const std::shared_ptr<Task> &task)
 {
-    std::string taskString = "{\"message_type\": \"task\","
-                             "\"message_payload\": {"
-                                "\"task_name\": \"" + task->getName() + "\""
-                             "}}";
-
-    std::shared_ptr<JsonValue> taskPayload = JsonValue::allocWithJson(taskString);
-    bool success = send(taskPayload);
+    bool success;
+    if (beginBinary(AnalyticsCodec::Code::TASK))
+    {
+        _codec->writeString(_binaryEncoder, task->getName());
+        success = send(_binaryEncoder.serialize());
+    }
+    else
+    {
+        beginMessage("task");
+        _encoder.writeKey("task_name");
+        _encoder.writeString(task->getName());
+        success = endMessage();
+    }
     if (success){
         _tasks[task->getName()] = task;
     }
@@ -349,18 +1658,44 @@ bool AnalyticsConnection::addTasks(const std::vector<std::shared_ptr<Task>> &tas
  */
 bool AnalyticsConnection::addTaskAttempt(const std::shared_ptr<TaskAttempt> &taskAttempt)
 {
-    std::string taskAttemptString = "{\"message_type\": \"task_attempt\","
-                                    "\"message_payload\": {"
-                                        "\"task_name\": \"" + taskAttempt->getTask()->getName() + "\","
-                                        "\"task_attempt_uuid\": \"" + taskAttempt->getUUID() + "\"," +
-                                        "\"status\": \"" + taskAttempt->getStatusAsString() + "\","
-                                        "\"num_failures\": \"" + std::to_string(taskAttempt->getNumFailures()) + "\","
-                                        "\"statistics\": " + taskAttempt->getTaskStatistics()->toString() +
-                                    "}}";
+    // The server starts every task attempt at version 0
+    taskAttempt->markSynced();
+    taskAttempt->_version = 0;
+    taskAttempt->_fullVersion = 0;
+    taskAttempt->_resync = false;
+
+    _attempts[taskAttempt->getUUID()] = taskAttempt;
+    if (_attempts.size() >= _attemptLimit)
+    {
+        for (auto it = _attempts.begin(); it != _attempts.end();)
+        {
+            it = it->second.expired() ? _attempts.erase(it) : std::next(it);
+        }
+        _attemptLimit = std::max((size_t)ATTEMPT_LIMIT, 2 * _attempts.size());
+    }
 
-    std::shared_ptr<JsonValue> taskAttemptPayload = JsonValue::allocWithJson(taskAttemptString);
+    if (beginBinary(AnalyticsCodec::Code::TASK_ATTEMPT))
+    {
+        _codec->writeString(_binaryEncoder, taskAttempt->getTask()->getName());
+        _codec->writeUUID(_binaryEncoder, taskAttempt->getUUID());
+        _codec->writeString(_binaryEncoder, taskAttempt->getStatusAsString());
+        _binaryEncoder.writeSint32(taskAttempt->getNumFailures());
+        _binaryEncoder.writeJson(statisticsOf(taskAttempt->_taskStatistics));
+        return send(_binaryEncoder.serialize());
+    }
 
-    return send(taskAttemptPayload);
+    beginMessage("task_attempt");
+    _encoder.writeKey("task_name");
+    _encoder.writeString(taskAttempt->getTask()->getName());
+    _encoder.writeKey("task_attempt_uuid");
+    _encoder.writeString(taskAttempt->getUUID());
+    _encoder.writeKey("status");
+    _encoder.writeString(taskAttempt->getStatusAsString());
+    _encoder.writeKey("num_failures");
+    _encoder.writeSint64(taskAttempt->getNumFailures());
+    _encoder.writeKey("statistics");
+    _encoder.writeJson(taskAttempt->_taskStatistics);
+    return endMessage();
 }
 
 /**
@@ -382,22 +1717,86 @@ bool AnalyticsConnection::addTaskAttempts(const std::vector<std::shared_ptr<Task
  * Synchronizes a TaskAttempt with the analytics database. This updates the
  * data of a specific taskAttempt on the analytics server
  *
+ * If the server supports it, only the statistics changed since the last sync
+ * are sent, as a versioned merge patch. If the server reports that a patch
+ * does not follow the version it has, the full statistics are sent again
+ * automatically. The TaskAttempt must have been added with
+ * {@link addTaskAttempt} on this connection for that recovery to happen.
+ *
  * @param taskAttempt The TaskAttempt to synchronize.
  * @return true if the synchronization was successful, false otherwise.
  */
 bool AnalyticsConnection::syncTaskAttempt(const std::shared_ptr<TaskAttempt> &taskAttempt)
 {
-    std::string syncTaskAttemptString = "{\"message_type\": \"sync_task_attempt\","
-                                        "\"message_payload\": {"
-                                            "\"task_attempt_uuid\": \"" + taskAttempt->getUUID() + "\","
-                                            "\"status\": \"" + taskAttempt->getStatusAsString() + "\","
-                                            "\"num_failures\": \"" + std::to_string(taskAttempt->getNumFailures()) + "\","
-                                            "\"statistics\": " + taskAttempt->getTaskStatistics()->toString() + 
-                                        "}}";
+    if (!_deltaReady)
+    {
+        // This server may not track versions, so the next patch could not apply
+        taskAttempt->_dirtyKeys.clear();
+        taskAttempt->_untracked = false;
+        taskAttempt->_resync = true;
+        if (beginBinary(AnalyticsCodec::Code::SYNC_TASK_ATTEMPT))
+        {
+            _codec->writeUUID(_binaryEncoder, taskAttempt->getUUID());
+            _codec->writeString(_binaryEncoder, taskAttempt->getStatusAsString());
+            _binaryEncoder.writeSint32(taskAttempt->getNumFailures());
+            _binaryEncoder.writeJson(statisticsOf(taskAttempt->_taskStatistics));
+            return send(_binaryEncoder.serialize());
+        }
+
+        beginMessage("sync_task_attempt");
+        _encoder.writeKey("task_attempt_uuid");
+        _encoder.writeString(taskAttempt->getUUID());
+        _encoder.writeKey("status");
+        _encoder.writeString(taskAttempt->getStatusAsString());
+        _encoder.writeKey("num_failures");
+        _encoder.writeSint64(taskAttempt->getNumFailures());
+        _encoder.writeKey("statistics");
+        _encoder.writeJson(taskAttempt->_taskStatistics);
+        return endMessage();
+    }
+
+    bool full = !taskAttempt->canPatch();
+    std::shared_ptr<JsonValue> stats;
+    if (full)
+    {
+        taskAttempt->markSynced();
+        stats = statisticsOf(taskAttempt->_taskStatistics);
+    }
+    else
+    {
+        stats = taskAttempt->diffStatistics();
+    }
 
-    std::shared_ptr<JsonValue> syncTaskAttemptPayload = JsonValue::allocWithJson(syncTaskAttemptString);
+    Uint32 version = ++taskAttempt->_version;
+    if (full)
+    {
+        taskAttempt->_fullVersion = version;
+        taskAttempt->_resync = false;
+    }
+
+    if (beginBinary(AnalyticsCodec::Code::SYNC_TASK_PATCH))
+    {
+        _codec->writeUUID(_binaryEncoder, taskAttempt->getUUID());
+        _codec->writeString(_binaryEncoder, taskAttempt->getStatusAsString());
+        _binaryEncoder.writeSint32(taskAttempt->getNumFailures());
+        _binaryEncoder.writeUint32(version);
+        _binaryEncoder.writeBool(full);
+        _binaryEncoder.writeJson(stats);
+        return send(_binaryEncoder.serialize());
+    }
 
-    return send(syncTaskAttemptPayload);
+    beginMessage("sync_task_attempt");
+    _encoder.writeKey("task_attempt_uuid");
+    _encoder.writeString(taskAttempt->getUUID());
+    _encoder.writeKey("status");
+    _encoder.writeString(taskAttempt->getStatusAsString());
+    _encoder.writeKey("num_failures");
+    _encoder.writeSint64(taskAttempt->getNumFailures());
+    _encoder.writeKey("version");
+    _encoder.writeSint64(version);
+    _encoder.writeKey(full ? "statistics" : "patch");
+    _encoder.writeJson(stats);
+    return endMessage();
 }
 
 /**
@@ -409,17 +1808,25 @@ bool AnalyticsConnection::syncTaskAttempt(const std::shared_ptr<TaskAttempt> &ta
  */
 bool AnalyticsConnection::recordAction(const std::shared_ptr<JsonValue> &actionBlob, const std::vector<std::shared_ptr<TaskAttempt>> &relatedTaskAttempts)
 {
-    std::shared_ptr<JsonValue> taskAttemptArray = JsonValue::allocArray();
-    for (auto & ta : relatedTaskAttempts) {
-        taskAttemptArray->appendValue(ta->getUUID());
+    if (beginBinary(AnalyticsCodec::Code::ACTION))
+    {
+        _binaryEncoder.writeUint32((Uint32)relatedTaskAttempts.size());
+        for (auto &ta : relatedTaskAttempts)
+        {
+            _codec->writeUUID(_binaryEncoder, ta->getUUID());
+        }
+        _binaryEncoder.writeJson(actionBlob ? actionBlob : JsonValue::allocNull());
+        return send(_binaryEncoder.serialize());
     }
 
-    std::string actionString = "{\"message_type\": \"action\","
-                               "\"message_payload\": {"
-                                    "\"task_attempt_uuids\": " + taskAttemptArray->toString() + ","
-                                    "\"data\": " + actionBlob->toString() + 
-                                "}}";
-    std::shared_ptr<JsonValue> actionPayload = JsonValue::allocWithJson(actionString);
-
-    return send(actionPayload);
+    beginMessage("action");
+    _encoder.writeKey("task_attempt_uuids");
+    _encoder.beginArray();
+    for (auto & ta : relatedTaskAttempts) {
+        _encoder.writeString(ta->getUUID());
+    }
+    _encoder.endArray();
+    _encoder.writeKey("data");
+    _encoder.writeJson(actionBlob);
+    return endMessage();
 }
@@ -0,0 +1,509 @@
+//
+//  CUAnalyticsSpool.cpp
+//  Cornell University Game Library (CUGL)
+//
+//  This class provides durable, on-disk storage for analytics messages that
+//  could not be sent because the analytics server was unreachable. Messages
+//  are appended to a sequence of segment files in the save directory, and
+//  are replayed in order once the connection is restored.
+//
+//  Every record has a sequence number and a checksum. Each record is flushed
+//  to disk as soon as it is written, so a crash can only ever damage the last
+//  record of the newest segment. That torn record is detected (and ignored)
+//  the next time the spool is opened.
+//
+//  This class uses our standard shared-pointer architecture.
+//
+//  1. The constructor does not perform any initialization; it just sets all
+//     attributes to their defaults.
+//
+//  2. All initialization takes place via init methods, which can fail if an
+//     object is initialized more than once.
+//
+//  3. All allocation takes place via static constructors which return a shared
+//     pointer.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Kidus Zegeye
+//  Version: 1/15/25
+//
+#include <cugl/netcode/CUAnalyticsSpool.h>
+#include <cugl/core/io/CUBinaryReader.h>
+#include <cugl/core/util/CUFiletools.h>
+#include <cugl/core/util/CUDebug.h>
+#include <cugl/core/CUApplication.h>
+#include <algorithm>
+#include <cstdio>
+
+using namespace cugl;
+using namespace cugl::netcode::analytics;
+
+/** The marker at the start of every record */
+#define RECORD_MAGIC    0x43554153
+/** The marker at the start of the cursor file */
+#define CURSOR_MAGIC    0x43554143
+/** The number of bytes in a record header */
+#define RECORD_HEADER   20
+/** The prefix of every segment file */
+#define SEGMENT_PREFIX  "spool-"
+/** The suffix of every segment file */
+#define SEGMENT_SUFFIX  ".bin"
+/** The name of the cursor file */
+#define CURSOR_FILE     "cursor.bin"
+
+/**
+ * Returns the FNV-1a hash of the given bytes.
+ *
+ * This is used as a record checksum. It is not cryptographic, but it is more
+ * than enough to detect a record that was only partially written.
+ *
+ * @param data  The bytes to hash
+ * @param size  The number of bytes
+ *
+ * @return the FNV-1a hash of the given bytes.
+ */
+static Uint32 checksum(const std::byte* data, size_t size) {
+    Uint32 hash = 2166136261u;
+    for(size_t ii = 0; ii < size; ii++) {
+        hash ^= static_cast<Uint32>(data[ii]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Returns the file name of the segment starting with the given sequence number.
+ *
+ * The sequence number is written as fixed width hexadecimal, so sorting the
+ * file names also sorts the segments.
+ *
+ * @param first The sequence number of the first record
+ *
+ * @return the file name of the segment starting with the given sequence number.
+ */
+static std::string segment_name(Uint64 first) {
+    char buffer[24];
+    snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long)first);
+    return std::string(SEGMENT_PREFIX)+buffer+SEGMENT_SUFFIX;
+}
+
+#pragma mark -
+#pragma mark Constructors
+/**
+ * Creates a degenerate spool.
+ *
+ * This object has not been initialized with a directory and cannot be used.
+ *
+ * You should NEVER USE THIS CONSTRUCTOR. All spools should be created by
+ * the static constructor {@link alloc} instead.
+ */
+AnalyticsSpool::AnalyticsSpool() :
+_capacity(0),
+_segmentSize(0),
+_writer(nullptr),
+_loaded(false),
+_nextSeq(1),
+_cursor(0),
+_committed(0),
+_bytes(0),
+_count(0),
+_dropped(0) {
+}
+
+/**
+ * Disposes all of the resources used by this spool.
+ *
+ * The cursor is committed and the newest segment is closed. The files
+ * remain on disk, and will be recovered the next time a spool is opened
+ * in the same directory.
+ */
+void AnalyticsSpool::dispose() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_directory.empty()) {
+        return;
+    }
+    if (_cursor != _committed) {
+        writeCursor();
+    }
+    if (_writer != nullptr) {
+        _writer->close();
+        _writer = nullptr;
+    }
+    _segments.clear();
+    _pending.clear();
+    _directory.clear();
+    _loaded = false;
+    _nextSeq = 1;
+    _cursor = 0;
+    _committed = 0;
+    _bytes = 0;
+    _count = 0;
+    _dropped = 0;
+}
+
+/**
+ * Initializes a spool in the given directory.
+ *
+ * If the directory is a relative path, it is relative to the application
+ * save directory. The directory is created if it does not exist. Any
+ * segments already in the directory are recovered.
+ *
+ * @param directory     The spool directory
+ * @param capacity      The maximum number of bytes on disk
+ * @param segmentSize   The number of bytes at which a new segment is started
+ *
+ * @return true if initialization was successful
+ */
+bool AnalyticsSpool::init(const std::string directory, size_t capacity, size_t segmentSize) {
+    CUAssertLog(segmentSize > RECORD_HEADER, "Segment size %zu is too small", segmentSize);
+    CUAssertLog(capacity >= segmentSize, "Capacity %zu is smaller than segment size", capacity);
+    if (!_directory.empty()) {
+        CUAssertLog(false, "Spool is already initialized");
+        return false;
+    }
+
+    std::string path = directory;
+    if (!filetool::is_absolute(path)) {
+        path = filetool::join_path({Application::get()->getSaveDirectory(), path});
+    }
+    if (!filetool::file_exists(path) && !filetool::dir_create(path)) {
+        CULogError("Could not create analytics spool '%s'", path.c_str());
+        return false;
+    } else if (!filetool::is_dir(path)) {
+        CULogError("Analytics spool '%s' is not a directory", path.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _directory = path;
+    _capacity = capacity;
+    _segmentSize = segmentSize;
+
+    // Recover the cursor
+    std::string cursor = filetool::join_path({_directory, CURSOR_FILE});
+    if (filetool::file_exists(cursor)) {
+        std::shared_ptr<BinaryReader> reader = BinaryReader::alloc(cursor);
+        if (reader != nullptr && reader->ready(12) && reader->readUint32() == CURSOR_MAGIC) {
+            _cursor = reader->readUint64();
+        }
+        if (reader != nullptr) {
+            reader->close();
+        }
+    }
+    _committed = _cursor;
+
+    // Recover the segments in order
+    std::vector<std::string> files = filetool::dir_contents(_directory, [](const std::string file) {
+        std::string name = filetool::split_path(file).second;
+        size_t suffix = sizeof(SEGMENT_SUFFIX)-1;
+        return (name.rfind(SEGMENT_PREFIX,0) == 0 && name.size() > suffix &&
+                name.compare(name.size()-suffix, suffix, SEGMENT_SUFFIX) == 0);
+    });
+    std::sort(files.begin(), files.end());
+
+    Uint64 last = _cursor;
+    for(auto it = files.begin(); it != files.end(); ++it) {
+        Uint64 seqn = 0;
+        size_t amt = scan(*it, nullptr, seqn);
+        last = std::max(last, seqn);
+        if (amt == 0) {
+            filetool::file_delete(*it);
+            continue;
+        }
+
+        Segment segment;
+        segment.path = *it;
+        segment.bytes = filetool::file_size(*it);
+        segment.records = amt;
+        _segments.push_back(segment);
+        _bytes += segment.bytes;
+        _count += amt;
+    }
+    _nextSeq = last+1;
+    return true;
+}
+
+#pragma mark -
+#pragma mark Accessors
+/**
+ * Returns the number of messages waiting to be consumed.
+ *
+ * @return the number of messages waiting to be consumed.
+ */
+size_t AnalyticsSpool::size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _count;
+}
+
+/**
+ * Returns the number of bytes currently on disk.
+ *
+ * @return the number of bytes currently on disk.
+ */
+size_t AnalyticsSpool::getBytes() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _bytes;
+}
+
+/**
+ * Returns the number of messages discarded because of the size cap.
+ *
+ * @return the number of messages discarded because of the size cap.
+ */
+Uint64 AnalyticsSpool::getDropped() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _dropped;
+}
+
+#pragma mark -
+#pragma mark Spooling
+/**
+ * Appends a message to the end of the spool.
+ *
+ * The message is flushed to disk before this method returns.
+ *
+ * @param data  The message bytes
+ * @param size  The number of bytes
+ *
+ * @return true if the message was stored, false if it was dropped
+ */
+bool AnalyticsSpool::append(const std::byte* data, size_t size) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_directory.empty()) {
+        return false;
+    }
+
+    size_t total = size+RECORD_HEADER;
+    if (total > _capacity) {
+        _dropped++;
+        return false;
+    }
+
+    // Make room by discarding the oldest segments (never the one being written)
+    while (_bytes+total > _capacity && _segments.size() > (_writer ? 1 : 0)) {
+        dropSegment();
+    }
+    if (_bytes+total > _capacity) {
+        _dropped++;
+        return false;
+    }
+
+    if (_writer != nullptr && _segments.back().bytes+total > _segmentSize) {
+        closeSegment();
+    }
+    if (_writer == nullptr) {
+        Segment segment;
+        segment.path  = filetool::join_path({_directory, segment_name(_nextSeq)});
+        segment.bytes = 0;
+        segment.records = 0;
+        _writer = BinaryWriter::alloc(segment.path);
+        if (_writer == nullptr) {
+            CULogError("Could not open analytics spool segment '%s'", segment.path.c_str());
+            _dropped++;
+            return false;
+        }
+        _segments.push_back(segment);
+    }
+
+    Uint64 seqn = _nextSeq++;
+    _writer->writeUint32(RECORD_MAGIC);
+    _writer->writeUint64(seqn);
+    _writer->writeUint32((Uint32)size);
+    _writer->writeUint32(checksum(data, size));
+    _writer->write(reinterpret_cast<const char*>(data), size);
+    _writer->flush();
+
+    Segment& back = _segments.back();
+    back.bytes += total;
+    back.records++;
+    _bytes += total;
+    _count++;
+    return true;
+}
+
+/**
+ * Returns true if the oldest message was copied into the given record.
+ *
+ * The message is not consumed. Call {@link pop} once the message has been
+ * delivered.
+ *
+ * @param record    The record to store the message
+ *
+ * @return true if the oldest message was copied into the given record.
+ */
+bool AnalyticsSpool::peek(Record& record) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    while (!_loaded && !_segments.empty()) {
+        // The segment being written must be sealed before we read it
+        if (_writer != nullptr && _segments.size() == 1) {
+            closeSegment();
+        }
+        Uint64 last = 0;
+        scan(_segments.front().path, &_pending, last);
+        if (_pending.empty()) {
+            dropSegment();
+        } else {
+            _loaded = true;
+        }
+    }
+
+    if (_pending.empty()) {
+        return false;
+    }
+    record = _pending.front();
+    return true;
+}
+
+/**
+ * Consumes the oldest message.
+ *
+ * The segment containing the message is deleted once all of its messages
+ * are consumed. The new cursor is not saved until {@link commit} is called.
+ */
+void AnalyticsSpool::pop() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_pending.empty()) {
+        return;
+    }
+    _cursor = _pending.front().sequence;
+    _pending.pop_front();
+    _segments.front().records--;
+    _count--;
+    if (_pending.empty()) {
+        dropSegment();
+    }
+}
+
+/**
+ * Saves the sequence number of the last consumed message.
+ *
+ * If the application crashes before this method is called, any messages
+ * consumed since the last commit will be replayed the next time the spool
+ * is opened.
+ */
+void AnalyticsSpool::commit() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_directory.empty() && _cursor != _committed) {
+        writeCursor();
+    }
+}
+
+#pragma mark -
+#pragma mark Internal Helpers
+/**
+ * Scans the given segment, returning the valid records after the cursor.
+ *
+ * Scanning stops at the first incomplete or corrupt record.
+ *
+ * @param path      The segment path
+ * @param records   The vector to store the records (may be nullptr)
+ * @param last      The sequence number of the last valid record (output)
+ *
+ * @return the number of valid records after the cursor
+ */
+size_t AnalyticsSpool::scan(const std::string& path, std::deque<Record>* records, Uint64& last) const {
+    size_t fsize = filetool::file_size(path);
+    if (fsize < RECORD_HEADER) {
+        return 0;
+    }
+
+    // Size the buffer to hold the entire segment so bulk reads never starve
+    std::shared_ptr<BinaryReader> reader = BinaryReader::alloc(path, (unsigned int)fsize);
+    if (reader == nullptr) {
+        return 0;
+    }
+
+    size_t result = 0;
+    std::vector<std::byte> buffer;
+    while (reader->ready(RECORD_HEADER)) {
+        Uint32 magic = reader->readUint32();
+        Uint64 seqn  = reader->readUint64();
+        Uint32 size  = reader->readUint32();
+        Uint32 check = reader->readUint32();
+        if (magic != RECORD_MAGIC || seqn <= last || (size && !reader->ready(size))) {
+            break;
+        }
+
+        buffer.resize(size);
+        if (size && reader->read(reinterpret_cast<char*>(buffer.data()), size) != size) {
+            break;
+        } else if (checksum(buffer.data(), size) != check) {
+            break;
+        }
+
+        last = seqn;
+        if (seqn > _cursor) {
+            if (records != nullptr) {
+                records->push_back({seqn, buffer});
+            }
+            result++;
+        }
+    }
+    reader->close();
+    return result;
+}
+
+/**
+ * Closes the newest segment so that no more records are written to it.
+ */
+void AnalyticsSpool::closeSegment() {
+    if (_writer != nullptr) {
+        _writer->close();
+        _writer = nullptr;
+    }
+}
+
+/**
+ * Deletes the oldest segment, discarding any unconsumed records.
+ */
+void AnalyticsSpool::dropSegment() {
+    if (_segments.empty()) {
+        return;
+    }
+    if (_writer != nullptr && _segments.size() == 1) {
+        closeSegment();
+    }
+
+    Segment& front = _segments.front();
+    _dropped += front.records;
+    _count -= front.records;
+    _bytes -= front.bytes;
+    filetool::file_delete(front.path);
+    _segments.pop_front();
+    _pending.clear();
+    _loaded = false;
+}
+
+/**
+ * Writes the cursor file.
+ */
+void AnalyticsSpool::writeCursor() {
+    std::string path = filetool::join_path({_directory, CURSOR_FILE});
+    std::shared_ptr<BinaryWriter> writer = BinaryWriter::alloc(path);
+    if (writer == nullptr) {
+        CULogError("Could not save analytics spool cursor '%s'", path.c_str());
+        return;
+    }
+    writer->writeUint32(CURSOR_MAGIC);
+    writer->writeUint64(_cursor);
+    writer->close();
+    _committed = _cursor;
+}
@@ -0,0 +1,314 @@
+//
+//  CUJsonSerializer.cpp
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides support for encoding JSON text directly into a byte
+//  buffer for network transit. Unlike JsonValue::toString, it does not build
+//  an intermediate tree, and the buffer is reused from message to message.
+//  This makes it suitable for high frequency messages such as analytics.
+//
+//  This class does not QUITE use our standard shared-pointer architecture. That
+//  is because there is no non-trivial constructor patterns and so an init method
+//  is not necessary. However, we do still include an alloc method for creating
+//  shared pointers.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Kidus Zegeye
+//  Version: 1/15/25
+//
+#include <cugl/netcode/CUJsonSerializer.h>
+#include <cugl/core/assets/CUJsonValue.h>
+#include <cugl/core/util/CUDebug.h>
+#include <cmath>
+#include <cstdio>
+
+using namespace cugl;
+using namespace cugl::netcode;
+
+/** The hexadecimal digits for unicode escapes */
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+/** The largest double that is guaranteed to be an exact integer */
+#define MAX_EXACT_INTEGER 9007199254740992.0
+
+#pragma mark -
+#pragma mark Internal Helpers
+/**
+ * Appends a separating comma if one is needed before the next value.
+ */
+void JsonSerializer::separate() {
+    if (_afterKey) {
+        _afterKey = false;
+        return;
+    }
+    if (!_nonempty.empty()) {
+        if (_nonempty.back()) {
+            append(',');
+        }
+        _nonempty.back() = true;
+    }
+}
+
+/**
+ * Appends the given string to the buffer as a quoted, escaped literal.
+ *
+ * @param s     The string to append
+ */
+void JsonSerializer::appendQuoted(const std::string& s) {
+    append('"');
+    size_t start = 0;
+    for(size_t ii = 0; ii < s.size(); ii++) {
+        unsigned char c = static_cast<unsigned char>(s[ii]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        // Flush the run of safe characters
+        append(s.data()+start, ii-start);
+        start = ii+1;
+
+        append('\\');
+        switch (c) {
+            case '"':
+                append('"');
+                break;
+            case '\\':
+                append('\\');
+                break;
+            case '\b':
+                append('b');
+                break;
+            case '\f':
+                append('f');
+                break;
+            case '\n':
+                append('n');
+                break;
+            case '\r':
+                append('r');
+                break;
+            case '\t':
+                append('t');
+                break;
+            default:
+                append("u00",3);
+                append(HEX_DIGITS[c >> 4]);
+                append(HEX_DIGITS[c & 0xf]);
+                break;
+        }
+    }
+    append(s.data()+start, s.size()-start);
+    append('"');
+}
+
+#pragma mark -
+#pragma mark Structure
+/**
+ * Opens a new JSON object.
+ *
+ * All values written until the matching call to {@link #endObject} must
+ * be preceded by a call to {@link #writeKey}.
+ */
+void JsonSerializer::beginObject() {
+    separate();
+    append('{');
+    _nonempty.push_back(false);
+}
+
+/**
+ * Closes the current JSON object.
+ */
+void JsonSerializer::endObject() {
+    CUAssertLog(!_nonempty.empty(), "No open object to close");
+    _nonempty.pop_back();
+    append('}');
+}
+
+/**
+ * Opens a new JSON array.
+ */
+void JsonSerializer::beginArray() {
+    separate();
+    append('[');
+    _nonempty.push_back(false);
+}
+
+/**
+ * Closes the current JSON array.
+ */
+void JsonSerializer::endArray() {
+    CUAssertLog(!_nonempty.empty(), "No open array to close");
+    _nonempty.pop_back();
+    append(']');
+}
+
+/**
+ * Writes the key for the next value of the current object.
+ *
+ * @param key   The object key
+ */
+void JsonSerializer::writeKey(const std::string& key) {
+    separate();
+    appendQuoted(key);
+    append(':');
+    _afterKey = true;
+}
+
+#pragma mark -
+#pragma mark Values
+/**
+ * Writes a null value.
+ */
+void JsonSerializer::writeNull() {
+    separate();
+    append("null",4);
+}
+
+/**
+ * Writes a boolean value.
+ *
+ * @param b The value to write
+ */
+void JsonSerializer::writeBool(bool b) {
+    separate();
+    if (b) {
+        append("true",4);
+    } else {
+        append("false",5);
+    }
+}
+
+/**
+ * Writes an integer value.
+ *
+ * @param i The value to write
+ */
+void JsonSerializer::writeSint64(Sint64 i) {
+    separate();
+    char buffer[24];
+    int len = snprintf(buffer, sizeof(buffer), "%lld", (long long)i);
+    append(buffer, len);
+}
+
+/**
+ * Writes a floating point value.
+ *
+ * Integral values are written without a decimal point. NaN and infinite
+ * values are not representable in JSON and are written as null.
+ *
+ * @param d The value to write
+ */
+void JsonSerializer::writeDouble(double d) {
+    if (!std::isfinite(d)) {
+        writeNull();
+        return;
+    }
+    if (d == std::floor(d) && std::fabs(d) <= MAX_EXACT_INTEGER) {
+        writeSint64((Sint64)d);
+        return;
+    }
+    separate();
+    char buffer[32];
+    int len = snprintf(buffer, sizeof(buffer), "%.17g", d);
+    append(buffer, len);
+}
+
+/**
+ * Writes a string value, escaping it as necessary.
+ *
+ * @param s The value to write
+ */
+void JsonSerializer::writeString(const std::string& s) {
+    separate();
+    appendQuoted(s);
+}
+
+/**
+ * Writes the given JSON tree.
+ *
+ * The tree is encoded directly from its nodes. No intermediate string is
+ * created. A nullptr is written as null.
+ *
+ * @param j The value to write
+ */
+void JsonSerializer::writeJson(const std::shared_ptr<JsonValue>& j) {
+    if (j == nullptr) {
+        writeNull();
+        return;
+    }
+    switch (j->type()) {
+        case JsonValue::Type::NullType:
+            writeNull();
+            break;
+        case JsonValue::Type::BoolType:
+            writeBool(j->asBool());
+            break;
+        case JsonValue::Type::NumberType:
+            writeDouble(j->asDouble());
+            break;
+        case JsonValue::Type::StringType:
+            writeString(j->asString());
+            break;
+        case JsonValue::Type::ArrayType:
+            beginArray();
+            for(size_t ii = 0; ii < j->size(); ii++) {
+                writeJson(j->get((int)ii));
+            }
+            endArray();
+            break;
+        case JsonValue::Type::ObjectType:
+            beginObject();
+            for(size_t ii = 0; ii < j->size(); ii++) {
+                const std::shared_ptr<JsonValue> child = j->get((int)ii);
+                writeKey(child->key());
+                writeJson(child);
+            }
+            endObject();
+            break;
+    }
+}
+
+/**
+ * Writes a value that has already been encoded as JSON text.
+ *
+ * The text is copied as is. It is the responsibility of the caller to
+ * ensure it is a single valid JSON value.
+ *
+ * @param json  The encoded value to write
+ */
+void JsonSerializer::writeRaw(const std::string& json) {
+    separate();
+    append(json.data(), json.size());
+}
+
+#pragma mark -
+#pragma mark Output
+/**
+ * Clears the buffer.
+ *
+ * The buffer capacity is retained so that the next message can be written
+ * without allocating.
+ */
+void JsonSerializer::reset() {
+    _data.clear();
+    _nonempty.clear();
+    _afterKey = false;
+}
@@ -117,13 +117,16 @@ void NetcodeChannel::dispose() {
  * Initializes a new RTC data channel for the given label.
  *
  * This initializer assumes the peer is the offerer of the data channel.
+ * The channel is reliable and ordered unless another reliability is given.
  *
- * @param parent    The parent RTC peer connection
- * @param label     The unique label for this data channel
+ * @param parent        The parent RTC peer connection
+ * @param label         The unique label for this data channel
+ * @param reliability   The delivery guarantees of this data channel
  *
  * @return true if initialization was successful
  */
-bool NetcodeChannel::init(const std::weak_ptr<NetcodePeer>& parent, std::string label) {
+bool NetcodeChannel::init(const std::weak_ptr<NetcodePeer>& parent, std::string label,
+                          const rtc::Reliability& reliability) {
 	auto p = parent.lock();
 	if (p == nullptr) {
 		return false;
@@ -154,10 +157,12 @@ bool NetcodeChannel::init(const std::weak_ptr<NetcodePeer>& parent, std::string
         CULog("NETCODE: Offered data channel '%s' from %s",_label.c_str(),_uuid.c_str());
     }
 	try {
-		_channel = connection->createDataChannel(label);
+		rtc::DataChannelInit settings;
+		settings.reliability = reliability;
+		_channel = connection->createDataChannel(label, settings);
 		_channel->onOpen([this]() { onOpen(); });
 		_channel->onClosed([this]() { onClosed(); });
-		_channel->onMessage([this](auto data) { onMessage(data); });
+		_channel->onMessage([this](auto data) { onMessage(std::move(data)); });
 		return true;
 	} catch (const std::exception &e) {
 		CULogError("NETCODE ERROR: %s",e.what());
@@ -206,7 +211,7 @@ bool NetcodeChannel::init(const std::weak_ptr<NetcodePeer>& parent, const std::s
 	_channel = dc;
 	_channel->onOpen([this]() { onOpen(); });
 	_channel->onClosed([this]() { onClosed(); });
-	_channel->onMessage([this](auto data) { onMessage(data); });
+	_channel->onMessage([this](auto data) { onMessage(std::move(data)); });
 	return true;
 }
 
@@ -267,7 +272,7 @@ void NetcodeChannel::onMessage(rtc::message_variant data) {
 	
 	// NEVER lock upwards
 	if (grand != nullptr) {
-		grand->append(source,std::get<rtc::binary>(data));	
+		grand->append(source,std::move(std::get<rtc::binary>(data)));	
 	}
 }
 
@@ -348,3 +353,46 @@ bool NetcodeChannel::send(const std::vector<std::byte>& data) {
 	
 	return false;		
 }
+
+/**
+ * Sends a shared message along this data channel to its recipient
+ *
+ * Most users should never need  to access this method. All communication
+ * should take place using the associated {@link NetcodeConnection}. It is
+ * provided for debugging purposes only.
+ *
+ * @param message   The message to send
+ *
+ * @return true if transmission was (apparently) successful
+ */
+bool NetcodeChannel::send(const std::shared_ptr<NetcodeMessage>& message) {
+	// Critical section
+	{
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		if (_active) {
+			_channel->send(message->data(),message->size());
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+/**
+ * Returns the number of bytes queued to send on this data channel.
+ *
+ * These are bytes that have been sent by this channel, but that are still
+ * waiting to be sent over the network. This number grows when the
+ * recipient (or the network to it) cannot keep up.
+ *
+ * This method is not const because it requires a lock.
+ *
+ * @return the number of bytes queued to send on this data channel.
+ */
+size_t NetcodeChannel::getQueuedBytes() {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	if (_active) {
+		return _channel->bufferedAmount();
+	}
+	return 0;
+}
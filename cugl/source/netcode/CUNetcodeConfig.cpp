@@ -37,8 +37,35 @@
 #include <cugl/core/assets/CUJsonValue.h>
 #include <cugl/core/util/CUDebug.h>
 
+using namespace cugl;
 using namespace cugl::netcode;
 
+/**
+ * Reads the extra channel classes from a JSON configuration.
+ *
+ * Unrecognized class names are ignored, as is the reliable class (which
+ * is always open).
+ *
+ * @param prefs     The configuration settings
+ * @param channels  The vector to store the channel classes
+ */
+static void parseChannels(const std::shared_ptr<JsonValue>& prefs,
+                          std::vector<NetcodeConfig::ChannelClass>& channels) {
+    channels.clear();
+    if (!prefs->has("channels")) {
+        return;
+    }
+    auto child = prefs->get("channels");
+    for(int ii = 0; ii < child->size(); ii++) {
+        std::string name = child->get(ii)->asString("");
+        if (name == "unreliable") {
+            channels.push_back(NetcodeConfig::ChannelClass::UNRELIABLE);
+        } else if (name == "retransmit") {
+            channels.push_back(NetcodeConfig::ChannelClass::RETRANSMIT);
+        }
+    }
+}
+
 #pragma mark Constructors
 /**
  * Creates a new configuration.
@@ -56,6 +83,7 @@ NetcodeConfig::NetcodeConfig() {
     bufferSize = 0;
     maxMessage = 0;
     maxPlayers = 2;
+    maxRetransmits = 2;
     apiVersion = 0;
     uuidSeed = "";
 
@@ -76,6 +104,7 @@ NetcodeConfig::NetcodeConfig(const InetAddress& lobby) {
     bufferSize = 0;
     maxMessage = 0;
     maxPlayers = 2;
+    maxRetransmits = 2;
     apiVersion = 0;
     uuidSeed = "";
 }
@@ -96,6 +125,7 @@ NetcodeConfig::NetcodeConfig(const InetAddress& lobby, const ICEAddress& iceServ
     bufferSize = 0;
 	maxMessage = 0;
 	maxPlayers = 2;
+	maxRetransmits = 2;
 	apiVersion = 0;
     uuidSeed = "";
 }
@@ -115,6 +145,8 @@ NetcodeConfig::NetcodeConfig(const InetAddress& lobby, const ICEAddress& iceServ
  *      "buffer size":  An int respresenting the size of the message buffer
  *      "max message":  An int respresenting the maximum transmission size
  *      "max players":  An int respresenting the maximum number of players
+ *      "channels":     A list of extra channel classes ("unreliable", "retransmit")
+ *      "max retransmits": An int representing the retransmit limit
  *      "UUID seed":    A string providing a potential UUID seed
  *      "API version":  An int respresenting the API version
  *
@@ -144,6 +176,8 @@ NetcodeConfig::NetcodeConfig(const std::shared_ptr<JsonValue>& prefs) {
     bufferSize = prefs->getInt("buffer size",0);
 	maxMessage = prefs->getInt("max message",0);
 	maxPlayers = prefs->getInt("max players",2);
+	parseChannels(prefs, channels);
+	maxRetransmits = prefs->getInt("max retransmits",2);
 	apiVersion = prefs->getInt("API version",0);
     uuidSeed = prefs->getString("UUID seed","");
 }
@@ -173,6 +207,8 @@ NetcodeConfig& NetcodeConfig::set(const NetcodeConfig& src) {
     bufferSize = src.bufferSize;
 	maxMessage = src.maxMessage;
 	maxPlayers = src.maxPlayers;
+	channels = src.channels;
+	maxRetransmits = src.maxRetransmits;
 	apiVersion = src.apiVersion;
     uuidSeed = src.uuidSeed;
 	return *this;
@@ -195,6 +231,8 @@ NetcodeConfig& NetcodeConfig::set(const std::shared_ptr<NetcodeConfig>& src) {
     bufferSize = src->bufferSize;
     maxMessage = src->maxMessage;
 	maxPlayers = src->maxPlayers;
+	channels = src->channels;
+	maxRetransmits = src->maxRetransmits;
 	apiVersion = src->apiVersion;
     uuidSeed = src->uuidSeed;
 	return *this;
@@ -215,6 +253,8 @@ NetcodeConfig& NetcodeConfig::set(const std::shared_ptr<NetcodeConfig>& src) {
  *      "buffer size":  An int respresenting the size of the message buffer
  *      "max message":  An int respresenting the maximum transmission size
  *      "max players":  An int respresenting the maximum number of players
+ *      "channels":     A list of extra channel classes ("unreliable", "retransmit")
+ *      "max retransmits": An int representing the retransmit limit
  *      "UUID seed":    A string providing a potential UUID seed
  *      "API version":  An int respresenting the API version
  *
@@ -247,6 +287,8 @@ NetcodeConfig& NetcodeConfig::set(const std::shared_ptr<JsonValue>& prefs) {
     bufferSize = prefs->getInt("buffer size",0);
     maxMessage = prefs->getInt("max message",0);
     maxPlayers = prefs->getInt("max players",2);
+    parseChannels(prefs, channels);
+    maxRetransmits = prefs->getInt("max retransmits",2);
     apiVersion = prefs->getInt("API version",0);
     uuidSeed = prefs->getString("UUID seed","");
 	return *this;
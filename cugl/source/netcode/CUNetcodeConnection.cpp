@@ -122,10 +122,13 @@ NetcodeConnection::NetcodeConnection() :
 	_socket(nullptr), 
 	_ishost(false), 
 	_initialPlayers(0),
+	_dispatching(false),
+	_pumping(false),
 	_migration(0),
 	_buffsize(0),
 	_buffhead(0),
 	_bufftail(0),
+	_dropping(false),
 	_debug(false),
 	_open(false),
 	_active(false),
@@ -465,6 +468,78 @@ void NetcodeConnection::onPeerClosed(std::string id) {
     }
 }
 
+#pragma mark -
+#pragma mark Internal Communication
+/**
+ * Returns the data channel label for the given channel class.
+ *
+ * The reliable class always uses the "public" channel.
+ *
+ * @param cls   The channel class
+ *
+ * @return the data channel label for the given channel class.
+ */
+std::string NetcodeConnection::getChannelLabel(NetcodeConfig::ChannelClass cls) {
+    switch (cls) {
+        case NetcodeConfig::ChannelClass::UNRELIABLE:
+            return "unreliable";
+        case NetcodeConfig::ChannelClass::RETRANSMIT:
+            return "retransmit";
+        default:
+            return "public";
+    }
+}
+
+/**
+ * Returns true if there is another channel to open after the given one.
+ *
+ * The offerer of a peer connection opens the channels one at a time,
+ * starting with the "public" channel, and then each class in
+ * {@link NetcodeConfig#channels}. If this method returns true, the
+ * label and reliability of the next channel are stored in the given
+ * references.
+ *
+ * @param label         The label of the channel that just opened
+ * @param next          The label of the next channel to open
+ * @param reliability   The reliability of the next channel to open
+ *
+ * @return true if there is another channel to open after the given one.
+ */
+bool NetcodeConnection::nextChannel(const std::string& label, std::string& next,
+                                    rtc::Reliability& reliability) {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    const std::vector<NetcodeConfig::ChannelClass>& classes = _config.channels;
+    
+    // Find the position after the channel that just opened
+    size_t pos = 0;
+    if (label != "public") {
+        while (pos < classes.size() && getChannelLabel(classes[pos]) != label) {
+            pos++;
+        }
+        pos++;
+    }
+    
+    for(; pos < classes.size(); pos++) {
+        reliability = rtc::Reliability();
+        switch (classes[pos]) {
+            case NetcodeConfig::ChannelClass::UNRELIABLE:
+                reliability.unordered = true;
+                reliability.maxRetransmits = 0;
+                break;
+            case NetcodeConfig::ChannelClass::RETRANSMIT:
+                reliability.unordered = true;
+                reliability.maxRetransmits = _config.maxRetransmits;
+                break;
+            default:
+                // The reliable channel is already open
+                continue;
+        }
+        next = getChannelLabel(classes[pos]);
+        return true;
+    }
+    return false;
+}
+
 #pragma mark -
 #pragma mark Internal Communication
 /**
@@ -937,48 +1012,198 @@ void NetcodeConnection::handleSignal(const std::shared_ptr<JsonValue>&  json) {
  * Appends the given data to the ring buffer.
  *
  * This method is used to store an incoming message for later consumption.
+ * It takes ownership of the message data. Messages are buffered even if
+ * a dispatcher callback is set, as that callback is invoked on the whole
+ * batch once per frame.
  *
  * @param source    The message source
  * @param data      The message data
  *
  * @return if the message was successfully added to the buffer.
  */
-bool NetcodeConnection::append(const std::string source, const std::vector<std::byte>& data) {
- 	std::function<bool()> callback;
-	bool success = false;
-	
-	{
-		std::lock_guard<std::recursive_mutex> lock(_mutex);
-		if (_active) {
-			if (_onReceipt) {
-				callback = [=]() {
-					_onReceipt(source,data);
-					return false;
-				};
-			} else {
-				// Buffer it
-				if (_buffsize == _buffer.size()) {
-					// Drops the oldest message
-					_buffhead = ((_buffhead + 1) % _buffer.size());
-					_buffsize--;
-				}
-		
-				Envelope* env = &(_buffer[_bufftail]);
-				env->source  = source;
-				env->message = data;
-
-				_bufftail = ((_bufftail + 1) % _buffer.size());
-				_buffsize++;
-			}		
-			success = true;
-		}
+bool NetcodeConnection::append(const std::string& source, std::vector<std::byte>&& data) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	if (!_active || _buffer.empty()) {
+		return false;
 	}
 	
-	if (callback) {
-        Application::get()->schedule(callback);
+	makeRoom();
+	
+	Envelope* env = &(_buffer[_bufftail]);
+	env->source  = source;
+	env->message = std::move(data);
+	env->shared  = nullptr;
+	
+	_bufftail = ((_bufftail + 1) % _buffer.size());
+	_buffsize++;
+	return true;
+}
+
+/**
+ * Appends the given shared message to the ring buffer.
+ *
+ * This method is the same as {@link #append}, except that the envelope
+ * holds a reference to the message instead of the message data. It is
+ * used when this connection sends a message to itself.
+ *
+ * @param source    The message source
+ * @param message   The shared message
+ *
+ * @return if the message was successfully added to the buffer.
+ */
+bool NetcodeConnection::append(const std::string& source, const std::shared_ptr<NetcodeMessage>& message) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	if (!_active || _buffer.empty()) {
+		return false;
 	}
 	
-	return success;
+	makeRoom();
+	
+	Envelope* env = &(_buffer[_bufftail]);
+	env->source  = source;
+	env->message.clear();
+	env->shared  = message;
+	
+	_bufftail = ((_bufftail + 1) % _buffer.size());
+	_buffsize++;
+	return true;
+}
+
+/**
+ * Returns the data channel to the given peer for the given label
+ *
+ * If the peer does not have a channel with this label, this method
+ * returns the "public" channel instead. It returns nullptr if there is
+ * no route to the peer at all.
+ *
+ * This method assumes that the connection lock is held.
+ *
+ * @param dst   The UUID of the peer
+ * @param label The channel label
+ *
+ * @return the data channel to the given peer for the given label
+ */
+std::shared_ptr<NetcodeChannel> NetcodeConnection::findChannel(const std::string& dst,
+                                                                const std::string& label) {
+    auto find = _peers.find(dst);
+    if (find == _peers.end()) {
+        CUAssertLog(false,"No direct route to '%s'",dst.c_str());
+        return nullptr;
+    }
+    
+    // Locking downwards is allowed
+    auto peer = find->second;
+    std::lock_guard<std::recursive_mutex> sublock(peer->_mutex);
+    auto jt = peer->_channels.find(label);
+    if (jt == peer->_channels.end()) {
+        jt = peer->_channels.find("public");
+    }
+    if (jt != peer->_channels.end()) {
+        return jt->second;
+    }
+    return nullptr;
+}
+
+/**
+ * Makes room in the ring buffer for one more message.
+ *
+ * If the ring buffer is full and a dispatcher callback is set, the buffer
+ * doubles in size, as the dispatcher must see every message. Otherwise the
+ * oldest message is dropped (and the first drop is logged).
+ *
+ * This method assumes that the lock is held.
+ */
+void NetcodeConnection::makeRoom() {
+    if (_buffsize < _buffer.size()) {
+        return;
+    }
+    
+    if (_dispatching) {
+        // Unroll the (full) ring, so the new space comes after the tail
+        std::rotate(_buffer.begin(), _buffer.begin()+_buffhead, _buffer.end());
+        _buffhead = 0;
+        _bufftail = _buffsize;
+        _buffer.resize(2*_buffer.size());
+    } else {
+        // Drops the oldest message
+        _buffhead = ((_buffhead + 1) % _buffer.size());
+        _buffsize--;
+        if (!_dropping) {
+            _dropping = true;
+            CULogError("NETCODE: Buffer full, dropping the oldest messages");
+        }
+    }
+}
+
+/**
+ * Hands all of the buffered messages to the given dispatcher.
+ *
+ * The messages are moved out of the ring buffer while holding the lock,
+ * and are then dispatched with the lock released. If the buffer grew to
+ * hold a burst of messages, it shrinks back to its capacity.
+ *
+ * @param dispatcher    The function to process received data
+ */
+void NetcodeConnection::drain(const Dispatcher& dispatcher) {
+    if (_buffsize == 0) {
+        return;
+    }
+    
+    {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        if (_buffer.empty()) {
+            return;
+        }
+        
+        size_t limit = _buffsize;
+        for (size_t off = 0; off < limit; off++) {
+            _inbox.emplace_back(std::move(_buffer[(_buffhead+off) % _buffer.size()]));
+        }
+        _buffhead = ((_buffhead + limit) % _buffer.size());
+        _buffsize -= limit;
+        _dropping = false;
+        
+        // Release the room added for a burst of messages
+        if (_buffer.size() > _bufflimit) {
+            _buffer.resize(_bufflimit);
+            _buffhead = 0;
+            _bufftail = 0;
+        }
+    }
+    
+    // Now with lock released we can consume messages
+    for(auto it = _inbox.begin(); it != _inbox.end(); ++it) {
+        dispatcher(it->source,it->bytes());
+    }
+    _inbox.clear();
+}
+
+/**
+ * Dispatches this frame's messages to the {@link #onReceipt} callback.
+ *
+ * This method is scheduled with the {@link Application} as a recurring
+ * task when the callback is set, and so it is called once per frame on
+ * the main thread. It returns false (ending the task) once the callback
+ * is removed.
+ *
+ * @return true if the task should be invoked again next frame
+ */
+bool NetcodeConnection::pump() {
+    Dispatcher dispatcher;
+    {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        if (_onReceipt == nullptr) {
+            _pumping = false;
+            return false;
+        }
+        dispatcher = _onReceipt;
+    }
+    
+    // Never hold locks during a user callback
+    if (_open) {
+        drain(dispatcher);
+    }
+    return true;
 }
 
 #pragma mark -
@@ -1195,6 +1420,7 @@ void NetcodeConnection::open() {
 	_socket->onMessage([this](auto data) { onMessage(data); });
 	
 	_buffer.resize(_bufflimit);
+	_inbox.reserve(_bufflimit);
 	
 	// Start the connection
 	_active = true;
@@ -1261,6 +1487,28 @@ void NetcodeConnection::close() {
  * @return true if the message was (apparently) sent
  */
 bool NetcodeConnection::sendTo(const std::string dst, const std::vector<std::byte>& data) {
+    return sendTo(dst, data, NetcodeConfig::ChannelClass::RELIABLE);
+}
+
+/**
+ * Sends a byte array to the specified connection on the given channel class.
+ *
+ * This method is the same as {@link #sendTo}, except that the message is
+ * sent on the data channel for the given class. Only messages on the
+ * {@link NetcodeConfig::ChannelClass#RELIABLE} channel are guaranteed to
+ * arrive, or to arrive in order. If the channel class is not open to the
+ * destination (see {@link NetcodeConfig#channels}), the message is sent
+ * on the reliable channel instead.
+ *
+ * @param dst   The UUID of the peer to receive the message
+ * @param data  The byte array to send.
+ * @param cls   The channel class to send on
+ *
+ * @return true if the message was (apparently) sent
+ */
+bool NetcodeConnection::sendTo(const std::string dst, const std::vector<std::byte>& data,
+                               NetcodeConfig::ChannelClass cls) {
+    std::string label = getChannelLabel(cls);
 	std::shared_ptr<NetcodeChannel> channel;
     bool self = false;
 	
@@ -1270,30 +1518,14 @@ bool NetcodeConnection::sendTo(const std::string dst, const std::vector<std::byt
         if (_active && _state != State::MIGRATING) {
             self = dst == _uuid;
             if (!self) {
-                auto find = _peers.find(dst);
-                if (!_active || find == _peers.end()) {
-                    CUAssertLog(false,"No direct route to '%s'",dst.c_str());
-                    return false;
-                } else if (_state == State::MIGRATING) {
-                    return false;
-                }
-                
-                // Locking downwards is allowed
-                auto peer = find->second;
-                std::lock_guard<std::recursive_mutex> sublock(peer->_mutex);
-                for(auto jt = peer->_channels.begin();
-                    channel == nullptr && jt != peer->_channels.end(); ++jt) {
-                    if (jt->first == "public") {
-                        channel = jt->second;
-                    }
-                }
+                channel = findChannel(dst,label);
             }
         }
 	}
 	
     // Do not hold locks on send
     if (self) {
-        append(dst,data);
+        append(dst,std::vector<std::byte>(data));
     } else if (channel != nullptr) {
         channel->send(data);
     } else {
@@ -1302,6 +1534,63 @@ bool NetcodeConnection::sendTo(const std::string dst, const std::vector<std::byt
     return true;
 }
 
+/**
+ * Sends a shared message to the specified connection.
+ *
+ * This method is the same as {@link #sendTo}, except that the message is
+ * not copied. This makes it possible to send the same encoded message to
+ * many (but not all) players without a copy for each one.
+ *
+ * @param dst       The UUID of the peer to receive the message
+ * @param message   The message to send.
+ *
+ * @return true if the message was (apparently) sent
+ */
+bool NetcodeConnection::sendTo(const std::string dst, const std::shared_ptr<NetcodeMessage>& message) {
+    return sendTo(dst, message, NetcodeConfig::ChannelClass::RELIABLE);
+}
+
+/**
+ * Sends a shared message to the specified connection on the given channel class.
+ *
+ * This method is the same as {@link #sendTo}, except that the message is
+ * not copied. This makes it possible to send the same encoded message to
+ * many (but not all) players without a copy for each one.
+ *
+ * @param dst       The UUID of the peer to receive the message
+ * @param message   The message to send.
+ * @param cls       The channel class to send on
+ *
+ * @return true if the message was (apparently) sent
+ */
+bool NetcodeConnection::sendTo(const std::string dst, const std::shared_ptr<NetcodeMessage>& message,
+                               NetcodeConfig::ChannelClass cls) {
+    std::string label = getChannelLabel(cls);
+    std::shared_ptr<NetcodeChannel> channel;
+    bool self = false;
+    
+    // Critical section
+    {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        if (_active && _state != State::MIGRATING) {
+            self = dst == _uuid;
+            if (!self) {
+                channel = findChannel(dst,label);
+            }
+        }
+    }
+    
+    // Do not hold locks on send
+    if (self) {
+        append(dst,message);
+    } else if (channel != nullptr) {
+        channel->send(message);
+    } else {
+        return false;
+    }
+    return true;
+}
+
 /**
  * Sends a byte array to the host player.
  *
@@ -1326,6 +1615,26 @@ bool NetcodeConnection::sendTo(const std::string dst, const std::vector<std::byt
  * @return true if the message was (apparently) sent
  */
 bool NetcodeConnection::sendToHost(const std::vector<std::byte>& data) {
+    return sendToHost(data, NetcodeConfig::ChannelClass::RELIABLE);
+}
+
+/**
+ * Sends a byte array to the host player on the given channel class.
+ *
+ * This method is the same as {@link #sendToHost}, except that the message
+ * is sent on the data channel for the given class. Only messages on the
+ * {@link NetcodeConfig::ChannelClass#RELIABLE} channel are guaranteed to
+ * arrive, or to arrive in order. If the channel class is not open to the
+ * host (see {@link NetcodeConfig#channels}), the message is sent on the
+ * reliable channel instead.
+ *
+ * @param data  The byte array to send.
+ * @param cls   The channel class to send on
+ *
+ * @return true if the message was (apparently) sent
+ */
+bool NetcodeConnection::sendToHost(const std::vector<std::byte>& data, NetcodeConfig::ChannelClass cls) {
+    std::string label = getChannelLabel(cls);
     std::shared_ptr<NetcodeChannel> channel;
     bool self = false;
     std::string uuid;
@@ -1337,30 +1646,14 @@ bool NetcodeConnection::sendToHost(const std::vector<std::byte>& data) {
             self = _host == _uuid;
             uuid = _host;
             if (!self) {
-                auto find = _peers.find(_host);
-                if (!_active || find == _peers.end()) {
-                    CUAssertLog(false,"No direct route to '%s'",_host.c_str());
-                    return false;
-                } else if (_state == State::MIGRATING) {
-                    return false;
-                }
-                
-                // Locking downwards is allowed
-                auto peer = find->second;
-                std::lock_guard<std::recursive_mutex> sublock(peer->_mutex);
-                for(auto jt = peer->_channels.begin();
-                    channel == nullptr && jt != peer->_channels.end(); ++jt) {
-                    if (jt->first == "public") {
-                        channel = jt->second;
-                    }
-                }
+                channel = findChannel(_host,label);
             }
         }
     }
     
     // Do not hold locks on send
     if (self) {
-        append(uuid,data);
+        append(uuid,std::vector<std::byte>(data));
     } else if (channel != nullptr) {
         channel->send(data);
     } else {
@@ -1396,6 +1689,59 @@ bool NetcodeConnection::sendToHost(const std::vector<std::byte>& data) {
  * @return true if the message was (apparently) sent
  */
 bool NetcodeConnection::broadcast(const std::vector<std::byte>& data) {
+    return broadcast(data, NetcodeConfig::ChannelClass::RELIABLE);
+}
+
+/**
+ * Sends a byte array to all other players on the given channel class.
+ *
+ * This method is the same as {@link #broadcast}, except that the message
+ * is sent on the data channel for the given class. Only messages on the
+ * {@link NetcodeConfig::ChannelClass#RELIABLE} channel are guaranteed to
+ * arrive, or to arrive in order. Any player that does not have the channel
+ * class open (see {@link NetcodeConfig#channels}) is sent the message on
+ * the reliable channel instead.
+ *
+ * @param data  The byte array to send.
+ * @param cls   The channel class to send on
+ *
+ * @return true if the message was (apparently) sent
+ */
+bool NetcodeConnection::broadcast(const std::vector<std::byte>& data, NetcodeConfig::ChannelClass cls) {
+    // One copy, shared by every channel and the loopback
+    return broadcast(NetcodeMessage::alloc(data), cls);
+}
+
+/**
+ * Sends a shared message to all other players.
+ *
+ * This method is the same as {@link #broadcast}, except that the message
+ * is not copied for each player. In particular, the copy this player
+ * receives references the same bytes.
+ *
+ * @param message   The message to send.
+ *
+ * @return true if the message was (apparently) sent
+ */
+bool NetcodeConnection::broadcast(const std::shared_ptr<NetcodeMessage>& message) {
+    return broadcast(message, NetcodeConfig::ChannelClass::RELIABLE);
+}
+
+/**
+ * Sends a shared message to all other players on the given channel class.
+ *
+ * This method is the same as {@link #broadcast}, except that the message
+ * is not copied for each player. In particular, the copy this player
+ * receives references the same bytes.
+ *
+ * @param message   The message to send.
+ * @param cls       The channel class to send on
+ *
+ * @return true if the message was (apparently) sent
+ */
+bool NetcodeConnection::broadcast(const std::shared_ptr<NetcodeMessage>& message,
+                                  NetcodeConfig::ChannelClass cls) {
+    std::string label = getChannelLabel(cls);
     std::vector<std::shared_ptr<NetcodeChannel>> channels;
     bool success = true;
     std::string uuid;
@@ -1407,10 +1753,12 @@ bool NetcodeConnection::broadcast(const std::vector<std::byte>& data) {
                 // Locking downwards is allowed
                 auto peer = it->second;
                 std::lock_guard<std::recursive_mutex> sublock(peer->_mutex);
-                for(auto jt = peer->_channels.begin(); jt != peer->_channels.end(); ++jt) {
-                    if (jt->first == "public") {
-                        channels.push_back(jt->second);
-                    }
+                auto jt = peer->_channels.find(label);
+                if (jt == peer->_channels.end()) {
+                    jt = peer->_channels.find("public");
+                }
+                if (jt != peer->_channels.end()) {
+                    channels.push_back(jt->second);
                 }
             }
         } else {
@@ -1420,13 +1768,53 @@ bool NetcodeConnection::broadcast(const std::vector<std::byte>& data) {
         
     // Do not hold locks on send
     for(auto it = channels.begin(); it != channels.end(); ++it) {
-        success = (*it)->send(data) && success;
+        success = (*it)->send(message) && success;
     }
         
-    append(uuid,data);
+    append(uuid,message);
     return success;
 }
 
+/**
+ * Returns the number of bytes queued to send to the given player.
+ *
+ * This is the total over all data channels to that player. It is the
+ * data that has been sent but is still waiting for the network, and so
+ * it grows when that player cannot keep up. A host can use this to shed
+ * load, by skipping messages that will be superseded (such as state
+ * snapshots) for that player until the queue drains.
+ *
+ * This method returns 0 for this player, or for any unknown player.
+ *
+ * @param peer  The UUID of the player
+ *
+ * @return the number of bytes queued to send to the given player.
+ */
+size_t NetcodeConnection::getQueuedBytes(const std::string& peer) {
+    std::vector<std::shared_ptr<NetcodeChannel>> channels;
+    {
+        // Critical section
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        auto find = _peers.find(peer);
+        if (find == _peers.end()) {
+            return 0;
+        }
+        
+        // Locking downwards is allowed
+        auto sub = find->second;
+        std::lock_guard<std::recursive_mutex> sublock(sub->_mutex);
+        for(auto it = sub->_channels.begin(); it != sub->_channels.end(); ++it) {
+            channels.push_back(it->second);
+        }
+    }
+    
+    size_t result = 0;
+    for(auto it = channels.begin(); it != channels.end(); ++it) {
+        result += (*it)->getQueuedBytes();
+    }
+    return result;
+}
+
 /**
  * Receives incoming network messages.
  *
@@ -1439,44 +1827,17 @@ bool NetcodeConnection::broadcast(const std::vector<std::byte>& data) {
  * render frame, or even not at all.
  *
  * If a dispatcher callback has been registered with {@link #onReceipt},
- * this method will never do anything. In that case, messages are not
- * buffered and are processed as soon as they are received. However, this
+ * this method will never do anything. In that case, messages are handed
+ * to that callback at the start of each animation frame. However, this
  * method has the advantage that it can be read on a separate thread.
  *
  * @param dispatcher    The function to process received data
  */
 void NetcodeConnection::receive(const Dispatcher& dispatcher) {
-    if (dispatcher == nullptr || !_open || _buffsize == 0) {
+    if (dispatcher == nullptr || !_open || _dispatching) {
         return;
     }
-    
-    // Sigh. Dispatch is also a callback. Cannot hold a lock when we use.
-    std::vector<Envelope> messages;
-    messages.reserve(_buffsize);
-    {
-        std::lock_guard<std::recursive_mutex> lock(_mutex);
-        size_t limit = _buffsize;
-        if (_buffer.empty()) {
-            return;
-        }
-        
-        size_t off = 0;
-        for (auto it = _buffer.begin()+_buffhead; it != _buffer.end() && off < limit; off++, ++it) {
-            messages.emplace_back(std::move(*it));
-        }
-        // Wrap around ring buffer
-        for (auto it = _buffer.begin(); it != _buffer.end() && off < limit; off++, ++it) {
-            messages.emplace_back(std::move(*it));
-        }
-        
-        _buffhead = ((_buffhead + off) % _buffer.size());
-        _buffsize -= off;
-    }
-    
-    // Now with lock released we can consume messages
-    for(auto it = messages.begin(); it != messages.end(); ++it) {
-        dispatcher(it->source,it->message);
-    }
+    drain(dispatcher);
 }
 
 /**
@@ -1530,8 +1891,9 @@ void NetcodeConnection::endSession() {
  * Sets a callback function to invoke on message receipt
  *
  * This callback is alternative to the method {@link #receive}. Instead of
- * buffering messages and calling that method each frame, this callback
- * function will be invoked as soon as the message is received.
+ * calling that method each frame, the application will call this function
+ * on every message received since the previous frame. The messages are
+ * delivered as a single batch, with no per-message scheduling.
  *
  * All callback functions are guaranteed to be called on the main thread.
  * They are called at the start of an animation frame, before the method
@@ -1540,8 +1902,23 @@ void NetcodeConnection::endSession() {
  * @param callback  The dispatcher callback
  */
 void NetcodeConnection::onReceipt(Dispatcher callback) {
-    std::lock_guard<std::recursive_mutex> lock(_mutex);
-    _onReceipt = callback;
+    Application* app = Application::get();
+    bool schedule = false;
+    {
+        std::lock_guard<std::recursive_mutex> lock(_mutex);
+        _onReceipt = callback;
+        _dispatching = (callback != nullptr);
+        schedule = _dispatching && !_pumping && app != nullptr;
+        _pumping = _pumping || schedule;
+    }
+    
+    if (schedule) {
+        std::weak_ptr<NetcodeConnection> wconnection = weak_from_this();
+        app->schedule([wconnection]() {
+            auto connection = wconnection.lock();
+            return connection ? connection->pump() : false;
+        });
+    }
 }
 
 /**
@@ -389,23 +389,36 @@ void NetcodePeer::onChannelOpened(const std::string label) {
 			uuid = _uuid;
 		}
 	}
-	if (label == "public") {
+	if (parent == nullptr) {
+		return;
+	} else if (label == "public") {
 		parent->onPeerEstablished(uuid);
 	}
+	
+	// The offerer opens the remaining channel classes one at a time
+	std::string next;
+	rtc::Reliability reliability;
+	if (offered && parent->nextChannel(label, next, reliability)) {
+		createChannel(next, reliability);
+	}
 }
 
 /**
  * Creates a data channel with the given label
  *
- * There can only be one data channel of any label.
+ * There can only be one data channel of any label. The channel is
+ * reliable and ordered unless another reliability is given.
+ *
+ * @param label         The data channel label
+ * @param reliability   The delivery guarantees of the data channel
  *
  * @return true if creation was successful.
  */
-bool NetcodePeer::createChannel(const std::string label) {
+bool NetcodePeer::createChannel(const std::string label, const rtc::Reliability& reliability) {
 	std::weak_ptr<NetcodePeer> wp = shared_from_this();
     
     // DO NOT HOLD LOCK HERE
-    std::shared_ptr<NetcodeChannel> channel = NetcodeChannel::alloc(wp,label);
+    std::shared_ptr<NetcodeChannel> channel = NetcodeChannel::alloc(wp,label,reliability);
 	
 	// Critical section
 	{
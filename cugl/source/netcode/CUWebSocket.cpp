@@ -95,9 +95,12 @@ WebSocket::WebSocket() :
     _active(false),
     _path(""),
     _socket(nullptr),
-    _buffsize(0),
-    _buffhead(0),
-    _bufftail(0),
+    _dispatching(false),
+    _pumping(false),
+    _bufflimit(DEFAULT_BUFFER),
+    _dropped(0),
+    _dropping(false),
+    _overflowing(false),
     _debug(false),
     _state(State::INACTIVE) {}
 
@@ -120,11 +123,15 @@ void WebSocket::dispose() {
         std::lock_guard<std::mutex> lock(_mutex);
         _active = false;    // Prevents cycles
 
+        // Setting a callback waits on any callback in progress, so the
+        // network thread is out of the ring once this returns
+        _socket->onMessage(nullptr);
         _socket->close();
         _socket = nullptr;
 
         _path = "";
-        _buffer.clear();
+        
+        // The ring is released by the destructor (or reset by open)
         
         // Leave other settings for debugging
     }
@@ -238,54 +245,121 @@ void WebSocket::onMessage(rtc::message_variant data) {
         return;
     }
      
-    append(std::get<rtc::binary>(data),NetworkLayer::get()->getTime());
+    append(std::move(std::get<rtc::binary>(data)),NetworkLayer::get()->getTime());
 }
 
 /**
  * Appends the given data to the ring buffer.
  *
  * This method is used to store an incoming message for later consumption.
+ * It is only ever called by the network thread, and takes ownership of
+ * the message data. It does not acquire any locks unless the ring is full.
+ *
+ * If the ring is full and a dispatcher callback is set, the message is
+ * added to the overflow list instead, so that no message is lost. If the
+ * ring is full and there is no callback, the message is dropped (and the
+ * first drop is logged).
  *
  * @param data      The message data
  * @param timestamp The number of microseconds since {@link NetcodeLayer#start}
  *
  * @return if the message was successfully added to the buffer.
  */
-bool WebSocket::append(const std::vector<std::byte>& data, Uint64 timestamp) {
-    std::function<bool()> callback;
-    bool success = false;
-    {
-        std::lock_guard<std::mutex> lock(_mutex);
-        if (_active) {
-            if (_onReceipt) {
-                callback = [=]() {
-                    _onReceipt(data,timestamp);
-                    return false;
-                };
-            } else {
-                // Buffer it
-                if (_buffsize == _buffer.size()) {
-                    // Drops the oldest message
-                    _buffhead = ((_buffhead + 1) % _buffer.size());
-                    _buffsize--;
-                }
-        
-                Envelope* env = &(_buffer[_bufftail]);
-                env->timestamp = timestamp;
-                env->message = data;
+bool WebSocket::append(std::vector<std::byte>&& data, Uint64 timestamp) {
+    if (!_active) {
+        return false;
+    }
+    
+    // Buffer it, even with a callback (pump will batch them)
+    Envelope env;
+    env.timestamp = timestamp;
+    env.message = std::move(data);
+    
+    // Once a message overflows, later ones follow it to keep the order
+    bool overflowing = _overflowing.load(std::memory_order_acquire);
+    if (!overflowing && _buffer.push(std::move(env))) {
+        _dropping = false;
+        return true;
+    }
+    
+    if (overflowing || _dispatching) {
+        std::lock_guard<std::mutex> lock(_overflowMutex);
+        _overflow.push_back(std::move(env));
+        _overflowing.store(true, std::memory_order_release);
+        return true;
+    }
+    
+    _dropped++;
+    if (!_dropping) {
+        _dropping = true;
+        CULogError("WEBSOCKET: Buffer full at %s%s, dropping new messages",
+                   _address.toString().c_str(),_path.c_str());
+    }
+    return false;
+}
 
-                _bufftail = ((_bufftail + 1) % _buffer.size());
-                _buffsize++;
-            }
-            success = true;
+/**
+ * Hands all of the buffered messages to the given dispatcher.
+ *
+ * Only the messages present at the start of this method are consumed, so
+ * a busy network cannot stall the frame. If there are messages in the
+ * overflow list, the ring is emptied and then the list is consumed.
+ *
+ * @param dispatcher    The function to process received data
+ */
+void WebSocket::drain(const Dispatcher& dispatcher) {
+    Envelope env;
+    if (_overflowing.load(std::memory_order_acquire)) {
+        // The network thread is not adding to the ring, and everything in
+        // the ring is older than the overflow list
+        while (_buffer.pop(env)) {
+            dispatcher(env.message,env.timestamp);
+        }
+        
+        std::vector<Envelope> overflow;
+        {
+            std::lock_guard<std::mutex> lock(_overflowMutex);
+            overflow.swap(_overflow);
+            _overflowing.store(false, std::memory_order_release);
         }
+        for(auto it = overflow.begin(); it != overflow.end(); ++it) {
+            dispatcher(it->message,it->timestamp);
+        }
+        return;
     }
     
-    if (callback) {
-        cugl::Application::get()->schedule(callback);
+    size_t limit = _buffer.size();
+    for(size_t ii = 0; ii < limit && _buffer.pop(env); ii++) {
+        dispatcher(env.message,env.timestamp);
+    }
+}
+
+/**
+ * Dispatches this frame's messages to the {@link #onReceipt} callback.
+ *
+ * This method is scheduled with the {@link Application} as a recurring
+ * task when the callback is set, and so it is called once per frame on
+ * the main thread. It returns false (ending the task) once the callback
+ * is removed.
+ *
+ * @return true if the task should be invoked again next frame
+ */
+bool WebSocket::pump() {
+    Dispatcher dispatcher;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_onReceipt == nullptr) {
+            _pumping = false;
+            return false;
+        }
+        dispatcher = _onReceipt;
     }
     
-    return success;
+    // Never hold locks during a user callback
+    if (_active) {
+        drain(dispatcher);
+    }
+    return true;
 }
 
 #pragma mark -
@@ -332,7 +406,7 @@ WebSocket::State WebSocket::getState() {
  */
 size_t WebSocket::getCapacity() {
     std::lock_guard<std::mutex> lock(_mutex);
-    return _buffer.size();
+    return _active ? _buffer.capacity() : _bufflimit;
 }
 
 /**
@@ -341,25 +415,16 @@ size_t WebSocket::getCapacity() {
  * It is possible for this connection to recieve several messages over the
  * network before it has a chance to all {@link #receive}. This buffer stores
  * those messages to be read later. The capacity indicates the number of
- * messages that can be stored.
+ * messages that can be stored. It is rounded up to a power of two.
+ *
+ * The buffer is lock-free, so it cannot be resized while the network
+ * thread is writing to it. If this connection is active, the new capacity
+ * takes effect the next time it is opened.
  *
  * @param capacity  The new message buffer capacity.
  */
 void WebSocket::setCapacity(size_t capacity) {
     std::lock_guard<std::mutex> lock(_mutex);
-    
-    // Rotate to correct position
-    size_t pos = _buffhead;
-    if (capacity < _buffsize) {
-        pos = ((_buffhead + (_buffsize-capacity)) % _buffer.size());
-        _buffsize = capacity;
-    }
-    if (pos != 0) {
-        std::rotate(_buffer.begin(), _buffer.begin() + pos, _buffer.end());
-    }
-    _buffhead = 0;
-    _bufftail = ((_bufftail + (_buffer.size()-pos)) % _buffer.size());
-    _buffer.resize(capacity);
     _bufflimit = capacity;
 }
 
@@ -400,13 +465,24 @@ void WebSocket::open(bool secure) {
               _address.toString().c_str(),_path.c_str());
     }
 
+    // Detach any previous socket before we reset the ring. Setting the
+    // callback waits for a message in progress, so once this returns no
+    // other thread can be pushing to the ring.
+    if (_socket != nullptr) {
+        _socket->onMessage(nullptr);
+        _socket = nullptr;
+    }
+    
+    _buffer.init(_bufflimit);
+    _overflow.clear();
+    _overflowing.store(false, std::memory_order_release);
+    _dropping = false;
+    
     _socket = std::make_shared<rtc::WebSocket>();
     _socket->onOpen([this]() { onOpen(); });
     _socket->onError([this](std::string s) { onError(s); });
     _socket->onClosed([this]() { onClosed(); });
-    _socket->onMessage([this](auto data) { onMessage(data); });
-    
-    _buffer.resize(_bufflimit);
+    _socket->onMessage([this](auto data) { onMessage(std::move(data)); });
     
     // Start the connection
     _active = true;
@@ -435,16 +511,20 @@ void WebSocket::open(bool secure) {
  */
 void WebSocket::close() {
     if (_active) {
+        std::shared_ptr<rtc::WebSocket> socket;
         {
             std::lock_guard<std::mutex> lock(_mutex);
-            _socket->close();
+            socket = _socket;
             _state = WebSocket::State::CLOSING;
         }
 
         // Never hold locks on a user callback
         if (_onStateChange) {
-            _onStateChange(_state);
+            _onStateChange(WebSocket::State::CLOSING);
         }
+
+        // The socket callbacks need the lock, so close it without one
+        socket->close();
     }    
 }
 
@@ -510,43 +590,16 @@ bool WebSocket::send(std::vector<std::byte>&& data) {
  * frame, or even not at all.
  *
  * If a dispatcher callback has been registered with {@link #onReceipt},
- * this method will never do anything. In that case, messages are not
- * buffered and are processed as soon as they are received.
+ * this method will never do anything. In that case, messages are handed
+ * to that callback at the start of each animation frame.
  *
  * @param dispatcher    The function to process received data
  */
 void WebSocket::receive(const Dispatcher& dispatcher) {
-    if (dispatcher == nullptr || !_active || _buffsize == 0) {
+    if (dispatcher == nullptr || !_active || _dispatching) {
         return;
     }
-    
-    // Sigh. Dispatch is also a callback. Cannot hold a lock when we use.
-    std::vector<Envelope> messages;
-    messages.reserve(_buffsize);
-    {
-        std::lock_guard<std::mutex> lock(_mutex);
-        size_t limit = _buffsize;
-        if (_buffer.empty()) {
-            return;
-        }
-        
-        size_t off = 0;
-        for (auto it = _buffer.begin()+_buffhead; it != _buffer.end() && off < limit; off++, ++it) {
-            messages.emplace_back(std::move(*it));
-        }
-        // Wrap around ring buffer
-        for (auto it = _buffer.begin(); it != _buffer.end() && off < limit; off++, ++it) {
-            messages.emplace_back(std::move(*it));
-        }
-        
-        _buffhead = ((_buffhead + off) % _buffer.size());
-        _buffsize -= off;
-    }
-    
-    // Now with lock released we can consume messages
-    for(auto it = messages.begin(); it != messages.end(); ++it) {
-        dispatcher(it->message,it->timestamp);
-    }
+    drain(dispatcher);
 }
     
 #pragma mark -
@@ -555,8 +608,9 @@ void WebSocket::receive(const Dispatcher& dispatcher) {
  * Sets a callback function to invoke on message receipt
  *
  * This callback is alternative to the method {@link #receive}. Instead of
- * buffering messages and calling that method each frame, this callback
- * function will be invoked as soon as the message is received.
+ * calling that method each frame, the application will call this function
+ * on every message received since the previous frame. The messages are
+ * delivered as a single batch, with no per-message scheduling.
  *
  * All callback functions are guaranteed to be called on the main thread.
  * They are called at the start of an animation frame, before the method
@@ -565,8 +619,23 @@ void WebSocket::receive(const Dispatcher& dispatcher) {
  * @param callback  The dispatcher callback
  */
 void WebSocket::onReceipt(Dispatcher callback) {
-    std::lock_guard<std::mutex> lock(_mutex);
-    _onReceipt = callback;
+    Application* app = Application::get();
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _onReceipt = callback;
+        _dispatching = (callback != nullptr);
+        schedule = _dispatching && !_pumping && app != nullptr;
+        _pumping = _pumping || schedule;
+    }
+    
+    if (schedule) {
+        std::weak_ptr<WebSocket> wsocket = weak_from_this();
+        app->schedule([wsocket]() {
+            auto socket = wsocket.lock();
+            return socket ? socket->pump() : false;
+        });
+    }
 }
 
 /**
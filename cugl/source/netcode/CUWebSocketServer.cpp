@@ -141,10 +141,13 @@ public:
  * by the static constructor {@link #alloc} instead.
  */
 WebSocketServer::WebSocketServer() :
-    _bufflimit(0),
+    _dispatching(false),
+    _pumping(false),
     _buffsize(0),
+    _bufflimit(0),
     _buffhead(0),
     _bufftail(0),
+    _dropping(false),
     _debug(false),
     _active(false) {}
 
@@ -270,31 +273,33 @@ void WebSocketServer::onClient(std::shared_ptr<rtc::WebSocket> socket) {
     {
         std::lock_guard<std::mutex> lock(_mutex);
         _connections.try_emplace(key,std::make_shared<WebSocketWrapper>(key,socket));
-        
-        // In case we die before a connection
-        std::weak_ptr<WebSocketServer> wserver = shared_from_this();
-        
-        // Time to register some callbacks
-        socket->onOpen([key,wserver]() {
-            auto server = wserver.lock();
-            if (server) {
-                server->onOpen(key);
-            }
-        });
-        socket->onError([key,wserver](std::string s) {
-            auto server = wserver.lock();
-            if (server) {
-                server->onError(key,s);
-            }
-        });
-        socket->onClosed([key,wserver]() {
-            auto server = wserver.lock();
-            if (server) {
-                server->onClosed(key);
-            }
-        });
     }
     
+    // In case we die before a connection
+    std::weak_ptr<WebSocketServer> wserver = shared_from_this();
+    
+    // Time to register some callbacks. These must be registered WITHOUT
+    // the lock, as rtc invokes onOpen immediately if the socket is already
+    // open (and onOpen needs the lock).
+    socket->onOpen([key,wserver]() {
+        auto server = wserver.lock();
+        if (server) {
+            server->onOpen(key);
+        }
+    });
+    socket->onError([key,wserver](std::string s) {
+        auto server = wserver.lock();
+        if (server) {
+            server->onError(key,s);
+        }
+    });
+    socket->onClosed([key,wserver]() {
+        auto server = wserver.lock();
+        if (server) {
+            server->onClosed(key);
+        }
+    });
+    
     // JUST in case
     if (socket->isOpen()) {
         onOpen(key);
@@ -311,14 +316,19 @@ void WebSocketServer::onClient(std::shared_ptr<rtc::WebSocket> socket) {
 void WebSocketServer::onOpen(size_t key) {
     std::string addr = "UNKNOWN";
     std::string path = "/";
+    std::shared_ptr<rtc::WebSocket> socket;
 
     {
         std::lock_guard<std::mutex> lock(_mutex);
         auto it = _connections.find(key);
         if (it == _connections.end()) {
             return;
+        } else if (!it->second->address.empty()) {
+            // Already opened (rtc and the check in onClient can both fire)
+            return;
         }
         auto wrapper = it->second;
+        socket = wrapper->socket;
         
         Uint64 time = NetworkLayer::get()->getTime();
         std::string hash = strtool::to_hexstring(time);
@@ -351,20 +361,21 @@ void WebSocketServer::onOpen(size_t key) {
         }
         wrapper->neighbors->emplace(wrapper.get());
         
-        // Add the new callback
-        std::weak_ptr<WebSocketServer> wserver = shared_from_this();
-        wrapper->socket->onMessage([addr,wserver](auto data) {
-            auto server = wserver.lock();
-            if (server) {
-                server->onMessage(addr,data);
-            }
-        });
-        
         if (_debug) {
             CULog("SERVER: Client %s connected",addr.c_str());
         }
     }
     
+    // Add the new callback (outside the lock, as queued messages are
+    // delivered immediately and onMessage needs the lock)
+    std::weak_ptr<WebSocketServer> wserver = shared_from_this();
+    socket->onMessage([addr,wserver](auto data) {
+        auto server = wserver.lock();
+        if (server) {
+            server->onMessage(addr,std::move(data));
+        }
+    });
+    
     // Never hold locks during a user callback
     if (_onConnect) {
         _onConnect(addr,path);
@@ -457,13 +468,16 @@ void WebSocketServer::onMessage(const std::string client, rtc::message_variant d
         return;
     }
     
-    append(client,std::get<rtc::binary>(data),NetworkLayer::get()->getTime());
+    append(client,std::move(std::get<rtc::binary>(data)),NetworkLayer::get()->getTime());
 }
 
 /**
  * Appends the given data to the ring buffer.
  *
  * This method is used to store an incoming message for later consumption.
+ * It takes ownership of the message data. Messages are buffered even if
+ * a dispatcher callback is set, as that callback is invoked on the whole
+ * batch once per frame.
  *
  * @param client    The message client
  * @param data      The message data
@@ -471,44 +485,125 @@ void WebSocketServer::onMessage(const std::string client, rtc::message_variant d
  *
  * @return if the message was successfully added to the buffer.
  */
-bool WebSocketServer::append(const std::string client, const std::vector<std::byte>& data,
+bool WebSocketServer::append(const std::string& client, std::vector<std::byte>&& data,
                              Uint64 timestamp) {
-    std::function<bool()> callback;
-    bool success = false;
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_active || _buffer.empty()) {
+        return false;
+    }
+    
+    makeRoom();
+    
+    Envelope* env = &(_buffer[_bufftail]);
+    env->client  = client;
+    env->message = std::move(data);
+    env->timestamp = timestamp;
+    
+    _bufftail = ((_bufftail + 1) % _buffer.size());
+    _buffsize++;
+    return true;
+}
+
+/**
+ * Makes room in the ring buffer for one more message.
+ *
+ * If the ring buffer is full and a dispatcher callback is set, the buffer
+ * doubles in size, as the dispatcher must see every message. Otherwise the
+ * oldest message is dropped (and the first drop is logged).
+ *
+ * This method assumes that the lock is held.
+ */
+void WebSocketServer::makeRoom() {
+    if (_buffsize < _buffer.size()) {
+        return;
+    }
+    
+    if (_dispatching) {
+        // Unroll the (full) ring, so the new space comes after the tail
+        std::rotate(_buffer.begin(), _buffer.begin()+_buffhead, _buffer.end());
+        _buffhead = 0;
+        _bufftail = _buffsize;
+        _buffer.resize(2*_buffer.size());
+    } else {
+        // Drops the oldest message
+        _buffhead = ((_buffhead + 1) % _buffer.size());
+        _buffsize--;
+        if (!_dropping) {
+            _dropping = true;
+            CULogError("SERVER: Buffer full, dropping the oldest messages");
+        }
+    }
+}
+
+/**
+ * Hands all of the buffered messages to the given dispatcher.
+ *
+ * The messages are moved out of the ring buffer while holding the lock,
+ * and are then dispatched with the lock released. If the buffer grew to
+ * hold a burst of messages, it shrinks back to its capacity.
+ *
+ * @param dispatcher    The function to process received data
+ */
+void WebSocketServer::drain(const Dispatcher& dispatcher) {
+    if (_buffsize == 0) {
+        return;
+    }
     
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        if (_active) {
-            if (_onReceipt) {
-                callback = [=]() {
-                    _onReceipt(client,data,timestamp);
-                    return false;
-                };
-            } else {
-                // Buffer it
-                if (_buffsize == _buffer.size()) {
-                    // Drops the oldest message
-                    _buffhead = ((_buffhead + 1) % _buffer.size());
-                    _buffsize--;
-                }
+        if (_buffer.empty()) {
+            return;
+        }
         
-                Envelope* env = &(_buffer[_bufftail]);
-                env->client  = client;
-                env->message = data;
-                env->timestamp = timestamp;
-
-                _bufftail = ((_bufftail + 1) % _buffer.size());
-                _buffsize++;
-            }
-            success = true;
+        size_t limit = _buffsize;
+        for (size_t off = 0; off < limit; off++) {
+            _inbox.emplace_back(std::move(_buffer[(_buffhead+off) % _buffer.size()]));
+        }
+        _buffhead = ((_buffhead + limit) % _buffer.size());
+        _buffsize -= limit;
+        _dropping = false;
+        
+        // Release the room added for a burst of messages
+        if (_buffer.size() > _bufflimit) {
+            _buffer.resize(_bufflimit);
+            _buffhead = 0;
+            _bufftail = 0;
         }
     }
     
-    if (callback) {
-        Application::get()->schedule(callback);
+    // Now with lock released we can consume messages
+    for(auto it = _inbox.begin(); it != _inbox.end(); ++it) {
+        dispatcher(it->client,it->message,it->timestamp);
+    }
+    _inbox.clear();
+}
+
+/**
+ * Dispatches this frame's messages to the {@link #onReceipt} callback.
+ *
+ * This method is scheduled with the {@link Application} as a recurring
+ * task when the callback is set, and so it is called once per frame on
+ * the main thread. It returns false (ending the task) once the callback
+ * is removed.
+ *
+ * @return true if the task should be invoked again next frame
+ */
+bool WebSocketServer::pump() {
+    Dispatcher dispatcher;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_onReceipt == nullptr) {
+            _pumping = false;
+            return false;
+        }
+        dispatcher = _onReceipt;
     }
     
-    return success;
+    // Never hold locks during a user callback
+    if (_active) {
+        drain(dispatcher);
+    }
+    return true;
 }
 
 #pragma mark -
@@ -700,6 +795,7 @@ void WebSocketServer::start() {
     });
     
     _buffer.resize(_bufflimit);
+    _inbox.reserve(_bufflimit);
     
     // Start the connection
     _active = true;
@@ -913,6 +1009,138 @@ bool WebSocketServer::broadcast(const std::vector<std::byte>& data) {
     return success;
 }
 
+/**
+ * Sends a shared message to the specified connection.
+ *
+ * This method is the same as {@link #sendTo}, except that the message is
+ * not copied before it is handed to the socket. This makes it possible
+ * to send the same encoded message to many clients with one encoding.
+ *
+ * @param dst       The identifier of the client to send to
+ * @param message   The message to send.
+ *
+ * @return true if the message was (apparently) sent
+ */
+bool WebSocketServer::sendTo(const std::string dst, const std::shared_ptr<NetcodeMessage>& message) {
+    std::shared_ptr<rtc::WebSocket> socket;
+
+    // Critical section
+    if (_active) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _keymap.find(dst);
+        if (it == _keymap.end()) {
+            return false;
+        }
+        
+        auto wrapper = _connections.find(it->second)->second;
+        socket = wrapper->socket;
+    }
+    
+    // Do not hold locks on send
+    if (socket) {
+        socket->send(message->data(),message->size());
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Sends a shared message to all other connections on the given path.
+ *
+ * This method is the same as {@link #broadcast}, except that the message
+ * is not copied before it is handed to each socket.
+ *
+ * @param path      The path to broadcast to
+ * @param message   The message to send.
+ *
+ * @return true if the message was (apparently) sent
+ */
+bool WebSocketServer::broadcast(const std::string path,
+                                const std::shared_ptr<NetcodeMessage>& message) {
+    std::vector<std::shared_ptr<rtc::WebSocket>> sockets;
+    bool success = true;
+
+    // Critical section
+    if (_active) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _paths.find(path);
+        if (it == _paths.end()) {
+            return false;
+        }
+        
+        sockets.reserve(it->second.size());
+        for (auto jt = it->second.begin(); jt != it->second.end(); ++jt) {
+            sockets.push_back((*jt)->socket);
+        }
+    }
+        
+    // Do not hold locks on send
+    for(auto it = sockets.begin(); it != sockets.end(); ++it) {
+        success = (*it)->send(message->data(),message->size()) && success;
+    }
+        
+    return success;
+}
+
+/**
+ * Sends a shared message to all connections.
+ *
+ * This method is the same as {@link #broadcast}, except that the message
+ * is not copied before it is handed to each socket.
+ *
+ * @param message   The message to send.
+ *
+ * @return true if the message was (apparently) sent
+ */
+bool WebSocketServer::broadcast(const std::shared_ptr<NetcodeMessage>& message) {
+    std::vector<std::shared_ptr<rtc::WebSocket>> sockets;
+    bool success = true;
+
+    // Critical section
+    if (_active) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        sockets.reserve(_connections.size());
+        for (auto jt = _connections.begin(); jt != _connections.end(); ++jt) {
+            if (jt->second->socket->isOpen()) {
+                sockets.push_back(jt->second->socket);
+            }
+        }
+    }
+        
+    // Do not hold locks on send
+    for(auto it = sockets.begin(); it != sockets.end(); ++it) {
+        success = (*it)->send(message->data(),message->size()) && success;
+    }
+        
+    return success;
+}
+
+/**
+ * Returns the number of bytes queued to send to the specified connection.
+ *
+ * These are bytes that have been sent to the client, but that are still
+ * waiting for the network. This number grows when the client (or the
+ * network to it) cannot keep up, and so it can be used to shed load for
+ * that client. This method returns 0 if the client is not connected.
+ *
+ * @param dst   The identifier of the client
+ *
+ * @return the number of bytes queued to send to the specified connection.
+ */
+size_t WebSocketServer::getQueuedBytes(const std::string dst) {
+    std::shared_ptr<rtc::WebSocket> socket;
+    if (_active) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _keymap.find(dst);
+        if (it == _keymap.end()) {
+            return 0;
+        }
+        socket = _connections.find(it->second)->second->socket;
+    }
+    return socket ? socket->bufferedAmount() : 0;
+}
+
 /**
  * Receives incoming network messages.
  *
@@ -925,44 +1153,17 @@ bool WebSocketServer::broadcast(const std::vector<std::byte>& data) {
  * frame, or even not at all.
  *
  * If a dispatcher callback has been registered with {@link #onReceipt},
- * this method will never do anything. In that case, messages are not
- * buffered and are processed as soon as they are received. However, this
+ * this method will never do anything. In that case, messages are handed
+ * to that callback at the start of each animation frame. However, this
  * method has the advantage that it can be read on a separate thread.
  *
  * @param dispatcher    The function to process received data
  */
 void WebSocketServer::receive(const Dispatcher& dispatcher) {
-    if (dispatcher == nullptr || !_active || _buffsize == 0) {
+    if (dispatcher == nullptr || !_active || _dispatching) {
         return;
     }
-    
-    // Sigh. Dispatch is also a callback. Cannot hold a lock when we use.
-    std::vector<Envelope> messages;
-    messages.reserve(_buffsize);
-    {
-        std::lock_guard<std::mutex> lock(_mutex);
-        size_t limit = _buffsize;
-        if (_buffer.empty()) {
-            return;
-        }
-        
-        size_t off = 0;
-        for (auto it = _buffer.begin()+_buffhead; it != _buffer.end() && off < limit; off++, ++it) {
-            messages.emplace_back(std::move(*it));
-        }
-        // Wrap around ring buffer
-        for (auto it = _buffer.begin(); it != _buffer.end() && off < limit; off++, ++it) {
-            messages.emplace_back(std::move(*it));
-        }
-        
-        _buffhead = ((_buffhead + off) % _buffer.size());
-        _buffsize -= off;
-    }
-    
-    // Now with lock released we can consume messages
-    for(auto it = messages.begin(); it != messages.end(); ++it) {
-        dispatcher(it->client,it->message,it->timestamp);
-    }
+    drain(dispatcher);
 }
     
 #pragma mark -
@@ -970,9 +1171,10 @@ void WebSocketServer::receive(const Dispatcher& dispatcher) {
 /**
  * Sets a callback function to invoke on message receipt
  *
- * This callback is alternative to the method {@link #receive}. Instead of buffering
- * messages and calling that method each frame, this callback function will be
- * invoked as soon as the message is received.
+ * This callback is alternative to the method {@link #receive}. Instead of
+ * calling that method each frame, the application will call this function
+ * on every message received since the previous frame. The messages are
+ * delivered as a single batch, with no per-message scheduling.
  *
  * All callback functions are guaranteed to be called on the main thread. They
  * are called at the start of an animation frame, before the method
@@ -981,8 +1183,23 @@ void WebSocketServer::receive(const Dispatcher& dispatcher) {
  * @param callback  The dispatcher callback
  */
 void WebSocketServer::onReceipt(Dispatcher callback) {
-    std::lock_guard<std::mutex> lock(_mutex);
-    _onReceipt = callback;
+    Application* app = Application::get();
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _onReceipt = callback;
+        _dispatching = (callback != nullptr);
+        schedule = _dispatching && !_pumping && app != nullptr;
+        _pumping = _pumping || schedule;
+    }
+    
+    if (schedule) {
+        std::weak_ptr<WebSocketServer> wserver = weak_from_this();
+        app->schedule([wserver]() {
+            auto server = wserver.lock();
+            return server ? server->pump() : false;
+        });
+    }
 }
 
 /**
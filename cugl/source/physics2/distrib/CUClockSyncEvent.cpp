@@ -0,0 +1,117 @@
+//
+//  CUClockSyncEvent.cpp
+//  Cornell University Game Library (CUGL)
+//
+//  This module provides an event for synchronizing game clocks between peers.
+//  It is an NTP-style ping/pong exchange, and is handled by the
+//  NetEventController internally.
+//
+//  CUGL MIT License:
+//      This software is provided 'as-is', without any express or implied
+//      warranty.  In no event will the authors be held liable for any damages
+//      arising from the use of this software.
+//
+//      Permission is granted to anyone to use this software for any purpose,
+//      including commercial applications, and to alter it and redistribute it
+//      freely, subject to the following restrictions:
+//
+//      1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would be
+//      appreciated but is not required.
+//
+//      2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//      3. This notice may not be removed or altered from any source distribution.
+//
+//  Author: Barry Lyu
+//  Version: 7/3/24 (CUGL 3.0 reorganization)
+//
+#include <cugl/physics2/distrib/CUClockSyncEvent.h>
+#include <cugl/physics2/distrib/CULWDeserializer.h>
+
+using namespace cugl;
+using namespace cugl::physics2;
+using namespace cugl::physics2::distrib;
+
+/**
+ * Returns a byte vector serializing this event
+ *
+ * @return a byte vector serializing this event
+ */
+std::vector<std::byte> ClockSyncEvent::serialize() {
+    LWSerializer serializer;
+    serializeTo(serializer);
+    return serializer.serialize();
+}
+
+/**
+ * Serializes this event to the end of the given serializer.
+ *
+ * This writes the event in place, without an intermediate vector.
+ *
+ * @param out   the serializer to write to
+ */
+void ClockSyncEvent::serializeTo(LWSerializer& out) {
+    out.writeByte(std::byte(_type));
+    out.writeVarint(_origin);
+    if (_type == EventType::PONG) {
+        out.writeVarint(_receive);
+        out.writeVarint(_transmit);
+    }
+}
+
+/**
+ * Returns true if this event was reset so that it can be reused.
+ *
+ * @return true if this event was reset so that it can be reused.
+ */
+bool ClockSyncEvent::recycle() {
+    _type = EventType::PING;
+    _origin = 0;
+    _receive = 0;
+    _transmit = 0;
+    return true;
+}
+
+/**
+ * Deserializes this event from a byte vector.
+ *
+ * This method will set the type of the event and all relevant fields.
+ */
+void ClockSyncEvent::deserialize(const std::vector<std::byte>& data) {
+    deserializeBytes(data.data(), data.size());
+}
+
+/**
+ * Deserializes this event from a range of bytes.
+ *
+ * This method will set the type of the event and all relevant fields.
+ * It reads the bytes in place, without copying them.
+ *
+ * @param data  the start of the serialized bytes
+ * @param size  the number of serialized bytes
+ */
+void ClockSyncEvent::deserializeBytes(const std::byte* data, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    LWDeserializer deserializer;
+    deserializer.receive(data, size);
+    EventType flag = (EventType)deserializer.readByte();
+    switch (flag) {
+        case EventType::PING:
+            _type = EventType::PING;
+            _origin = deserializer.readVarint();
+            break;
+        case EventType::PONG:
+            _type = EventType::PONG;
+            _origin = deserializer.readVarint();
+            _receive = deserializer.readVarint();
+            _transmit = deserializer.readVarint();
+            break;
+        default:
+            CUAssertLog(false, "Deserializing invalid clock sync event type");
+    }
+}
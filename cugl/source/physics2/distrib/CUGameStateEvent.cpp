@@ -39,31 +39,44 @@ using namespace cugl::physics2::distrib;
  * @return a byte vector serializing this event
  */
 std::vector<std::byte> GameStateEvent::serialize() {
-    std::vector<std::byte> data;
+    LWSerializer serializer;
+    serializeTo(serializer);
+    return serializer.serialize();
+}
+
+/**
+ * Serializes this event to the end of the given serializer.
+ *
+ * This writes the event in place, without an intermediate vector.
+ *
+ * @param out   the serializer to write to
+ */
+void GameStateEvent::serializeTo(LWSerializer& out) {
     switch (_type) {
         case EventType::GAME_START:
-            data.push_back(std::byte(EventType::GAME_START));
-            break;
         case EventType::GAME_RESET:
-            data.push_back(std::byte(EventType::GAME_RESET));
-            break;
         case EventType::GAME_PAUSE:
-            data.push_back(std::byte(EventType::GAME_PAUSE));
-            break;
         case EventType::GAME_RESUME:
-            data.push_back(std::byte(EventType::GAME_RESUME));
-            break;
         case EventType::CLIENT_RDY:
-            data.push_back(std::byte(EventType::CLIENT_RDY));
+            out.writeByte(std::byte(_type));
             break;
         case EventType::UID_ASSIGN:
-            data.push_back(std::byte(EventType::UID_ASSIGN));
-            data.push_back(std::byte(_shortUID));
+            out.writeByte(std::byte(EventType::UID_ASSIGN));
+            out.writeByte(std::byte(_shortUID));
             break;
         default:
             CUAssertLog(false, "Serializing invalid game state event type");
     }
-    return data;
+}
+
+/**
+ * Returns true if this event was reset so that it can be reused.
+ *
+ * @return true if this event was reset so that it can be reused.
+ */
+bool GameStateEvent::recycle() {
+    _shortUID = 0;
+    return true;
 }
 
 /**
@@ -72,6 +85,22 @@ std::vector<std::byte> GameStateEvent::serialize() {
  * This method will set the type of the event and all relevant fields.
  */
 void GameStateEvent::deserialize(const std::vector<std::byte>& data) {
+    deserializeBytes(data.data(), data.size());
+}
+
+/**
+ * Deserializes this event from a range of bytes.
+ *
+ * This method will set the type of the event and all relevant fields.
+ * It reads the bytes in place, without copying them.
+ *
+ * @param data  the start of the serialized bytes
+ * @param size  the number of serialized bytes
+ */
+void GameStateEvent::deserializeBytes(const std::byte* data, size_t size) {
+    if (size == 0) {
+        return;
+    }
     EventType flag = (EventType)data[0];
     switch (flag) {
         case EventType::GAME_START:
@@ -91,7 +120,7 @@ void GameStateEvent::deserialize(const std::vector<std::byte>& data) {
             break;
         case EventType::UID_ASSIGN:
             _type = EventType::UID_ASSIGN;
-            _shortUID = (Uint8)data[1];
+            _shortUID = size > 1 ? (Uint8)data[1] : 0;
             break;
         default:
             CUAssertLog(false, "Deserializing game state event type");
@@ -49,10 +49,23 @@
 
 /** The minimum message length */
 #define MIN_MSG_LENGTH sizeof(std::byte)+sizeof(Uint64)
+/** The leading byte of a batched frame (never used as an event type) */
+#define BATCH_FRAME_TAG 0xFF
+/** The default batched frame size (to fit in a single SCTP packet) */
+#define DEFAULT_FRAME_LIMIT 1200
+/** The default number of game ticks between clock pings */
+#define DEFAULT_CLOCK_INTERVAL 60
+/** The number of recent clock samples for the offset estimate */
+#define CLOCK_SAMPLES 8
+/** The number of jitters added to the one-way delay for playout */
+#define JITTER_MULTIPLIER 4
+/** The maximum time (in microseconds) to buffer a synchronization event */
+#define MAX_PLAYOUT_DELAY 250000
 
 using namespace cugl;
 using namespace cugl::physics2;
 using namespace cugl::physics2::distrib;
+using namespace cugl::netcode;
 
 #pragma mark -
 #pragma mark Constructors
@@ -66,13 +79,23 @@ using namespace cugl::physics2::distrib;
  * the heap, use one of the static constructors instead.
  */
 NetEventController::NetEventController(void):
+_startGameTimeStamp(0),
+_startGameMicros(0),
+_status(Status::IDLE),
+_roomid(""),
 _isHost(false),
-_shortUID(0),
 _numReady(0),
-_roomid(""),
+_batching(true),
+_frameLimit(DEFAULT_FRAME_LIMIT),
+_shortUID(0),
 _physEnabled(false),
-_status(Status::IDLE),
-_startGameTimeStamp(0) {
+_syncType(NetPhysicsController::SyncType::FULL_SYNC),
+_syncChannel(NetcodeConfig::ChannelClass::RELIABLE),
+_syncQueueLimit(0),
+_shedFrames(0),
+_clockInterval(DEFAULT_CLOCK_INTERVAL),
+_nextPing(0),
+_jitterBuffered(false) {
 }
 
 /**
@@ -98,6 +121,7 @@ void NetEventController::dispose() {
 bool NetEventController::init(const std::shared_ptr<cugl::AssetManager>& assets) {
     // Attach the primitive event types for deserialization
     attachEventType<GameStateEvent>();
+    attachEventType<ClockSyncEvent>();
 
     // Configure the NetcodeConnection
     auto json = assets->get<JsonValue>("server");
@@ -179,7 +203,10 @@ void NetEventController::disconnect() {
     _physEnabled = false;
     _isHost = false;
     _startGameTimeStamp = 0;
+    _startGameMicros = 0;
     _numReady = 0;
+    _nextPing = 0;
+    _clocks.clear();
     _outEventQueue.clear();
     
     while (!_inEventQueue.empty()) {
@@ -250,19 +277,263 @@ void NetEventController::enablePhysics(std::shared_ptr<NetWorld>& world, Obstacl
     //CULog("ENABLED PHYSICS");
     attachEventType<PhysSyncEvent>();
     attachEventType<PhysObstEvent>();
+    _physController->setAbsoluteSync(isSyncSplit());
     if(_isHost) {
         _physController->ownAll();
     }
 }
 
+/**
+ * Sets the channel class for physics synchronization events.
+ *
+ * Synchronization events are superseded by the next one, so there is
+ * no need to retransmit them when they are lost. Sending them on an
+ * unreliable channel keeps a lost packet from stalling every event
+ * behind it. All other events are still sent reliably. The channel class
+ * must be listed in the {@link netcode::NetcodeConfig#channels} of every
+ * player; otherwise the reliable channel is used for that player.
+ *
+ * As deltas cannot be decoded if a snapshot is lost, any class other
+ * than the reliable one encodes snapshots as absolute values (see
+ * {@link NetPhysicsController#setAbsoluteSync}).
+ *
+ * @param cls   The channel class for physics synchronization events
+ */
+void NetEventController::setSyncChannel(NetcodeConfig::ChannelClass cls) {
+    _syncChannel = cls;
+    if (_physController) {
+        _physController->setAbsoluteSync(isSyncSplit());
+    }
+}
+
+/**
+ * Sets the queued bytes above which a peer is skipped for synchronization.
+ *
+ * When a peer falls behind, the data sent to it piles up in its send
+ * queue (see {@link netcode::NetcodeConnection#getQueuedBytes}). As every
+ * synchronization event is superseded by the next, there is no point in
+ * adding more of them to that queue. With a limit, synchronization frames
+ * are skipped for any peer with more than this many bytes queued, until
+ * its queue drains. All other events are still sent to every peer.
+ *
+ * As skipped snapshots break delta encoding, a non-zero limit encodes
+ * snapshots as absolute values (see
+ * {@link NetPhysicsController#setAbsoluteSync}).
+ *
+ * @param limit The queued bytes above which a peer is skipped (0 for none)
+ */
+void NetEventController::setSyncQueueLimit(size_t limit) {
+    _syncQueueLimit = limit;
+    if (_physController) {
+        _physController->setAbsoluteSync(isSyncSplit());
+    }
+}
+
+/**
+ * Returns the number of events allocated by the network pipeline.
+ *
+ * This includes inbound events of every type, and the physics events
+ * generated by the physics controller (if physics is enabled). Events are
+ * recycled once no one holds a reference to them, so this number stops
+ * growing once the pools cover the events in flight. A count that keeps
+ * growing in a steady-state game means that events are being leaked (or
+ * held onto) somewhere.
+ *
+ * @return the number of events allocated by the network pipeline.
+ */
+Uint64 NetEventController::getEventAllocations() const {
+    Uint64 result = 0;
+    for(auto it = _eventPools.begin(); it != _eventPools.end(); ++it) {
+        result += it->getAllocations();
+    }
+    if (_physController) {
+        result += _physController->getEventAllocations();
+    }
+    return result;
+}
+
 /**
  * Disables physics synchronization.
  */
 void NetEventController::disablePhysics() {
     _physEnabled = false;
     _physController = nullptr;
+    for(auto it = _clocks.begin(); it != _clocks.end(); ++it) {
+        it->second.pending.clear();
+    }
+}
+
+/**
+ * Sets the area of interest for the given peer.
+ *
+ * Priority synchronization favors obstacles near the area of interest of
+ * some peer, such as the region around its avatar. This setting has no
+ * effect on other synchronization types. Physics must be enabled.
+ *
+ * @param peer      The peer UUID
+ * @param center    The center of the area of interest
+ * @param radius    The radius of the area of interest
+ */
+void NetEventController::setPeerInterest(const std::string& peer, const Vec2& center, float radius) {
+    CUAssertLog(_physController, "Physics must be enabled before setting peer interests.");
+    _physController->setPeerInterest(peer, center, radius);
+}
+
+/**
+ * Sets the physics synchronization byte budget for the given peer.
+ *
+ * Priority synchronization sends at most this many bytes of obstacle
+ * snapshots per tick. As snapshots are broadcast, the smallest budget
+ * among all peers applies. This setting has no effect on other
+ * synchronization types. Physics must be enabled.
+ *
+ * @param peer      The peer UUID
+ * @param budget    The maximum bytes per tick (0 for no limit)
+ */
+void NetEventController::setPeerSyncBudget(const std::string& peer, size_t budget) {
+    CUAssertLog(_physController, "Physics must be enabled before setting peer budgets.");
+    _physController->setPeerBudget(peer, budget);
+}
+
+
+#pragma mark Clock Synchronization
+/**
+ * Returns the current playout delay.
+ *
+ * @return the current playout delay.
+ */
+Uint64 NetEventController::PeerClock::getPlayoutDelay() const {
+    double result = delay+offset+JITTER_MULTIPLIER*jitter;
+    if (result <= 0) {
+        return 0;
+    }
+    return std::min((Uint64)result, (Uint64)MAX_PLAYOUT_DELAY);
 }
 
+/**
+ * Returns the game clock in microseconds.
+ *
+ * This is the time since the game started on this device. Unlike
+ * {@link #getGameTick}, it is not quantized to the simulation timestep.
+ * It is the clock used for all clock synchronization estimates.
+ *
+ * @return the game clock in microseconds.
+ */
+Uint64 NetEventController::getGameMicros() const {
+    return Application::get()->getEllapsedMicros()-_startGameMicros;
+}
+
+/**
+ * Returns the offset of the peer game clock from this one.
+ *
+ * The value is in microseconds, and is positive if the game started
+ * earlier on the peer (so its clock is ahead). Adding the offset to
+ * {@link #getGameMicros} gives the current game clock of the peer. The
+ * value is 0 until the first pong is received from that peer.
+ *
+ * @param peer  The peer UUID
+ *
+ * @return the offset of the peer game clock from this one.
+ */
+Sint64 NetEventController::getClockOffset(const std::string& peer) const {
+    auto it = _clocks.find(peer);
+    return it == _clocks.end() ? 0 : it->second.offset;
+}
+
+/**
+ * Returns the smoothed round trip time to the given peer.
+ *
+ * The value is in microseconds, and does not include the time the peer
+ * took to answer the ping. It is 0 until the first pong is received from
+ * that peer.
+ *
+ * @param peer  The peer UUID
+ *
+ * @return the smoothed round trip time to the given peer.
+ */
+Uint64 NetEventController::getRoundTripTime(const std::string& peer) const {
+    auto it = _clocks.find(peer);
+    return it == _clocks.end() ? 0 : (Uint64)it->second.rtt;
+}
+
+/**
+ * Returns the network jitter of messages from the given peer.
+ *
+ * The value is in microseconds. It is the interarrival jitter of RFC 3550,
+ * a smoothed average of the variation in one-way delay between messages.
+ *
+ * @param peer  The peer UUID
+ *
+ * @return the network jitter of messages from the given peer.
+ */
+Uint64 NetEventController::getJitter(const std::string& peer) const {
+    auto it = _clocks.find(peer);
+    return it == _clocks.end() ? 0 : (Uint64)it->second.jitter;
+}
+
+/**
+ * Returns the playout delay of the jitter buffer for the given peer.
+ *
+ * The value is in microseconds. It is the smoothed one-way delay of
+ * messages from that peer plus four times the jitter, so that nearly all
+ * messages arrive before they are played out. It adapts as the network
+ * conditions change.
+ *
+ * @param peer  The peer UUID
+ *
+ * @return the playout delay of the jitter buffer for the given peer.
+ */
+Uint64 NetEventController::getPlayoutDelay(const std::string& peer) const {
+    auto it = _clocks.find(peer);
+    return it == _clocks.end() ? 0 : it->second.getPlayoutDelay();
+}
+
+/**
+ * Returns the number of synchronization events from the peer dropped as late.
+ *
+ * An event is late if it arrives after a more recent event from the same
+ * peer has been released by the jitter buffer. This value is always 0 if
+ * the jitter buffer is disabled.
+ *
+ * @param peer  The peer UUID
+ *
+ * @return the number of synchronization events from the peer dropped as late.
+ */
+Uint64 NetEventController::getLateDrops(const std::string& peer) const {
+    auto it = _clocks.find(peer);
+    return it == _clocks.end() ? 0 : it->second.lateDrops;
+}
+
+/**
+ * Sets whether physics synchronization events are jitter buffered.
+ *
+ * When jitter buffering is enabled, synchronization events are not
+ * applied as soon as they arrive. Instead, each event is held until its
+ * send time (translated to the local game clock) plus the playout delay
+ * (see {@link #getPlayoutDelay}). This releases snapshots at a steady
+ * pace despite variations in network delay, at the cost of a little
+ * latency. Events that arrive after a more recent one was released are
+ * dropped.
+ *
+ * Jitter buffering is disabled by default.
+ *
+ * @param value Whether physics synchronization events are jitter buffered
+ */
+void NetEventController::setJitterBuffered(bool value) {
+    if (_jitterBuffered && !value) {
+        // Do not strand anything in the buffer
+        for(auto it = _clocks.begin(); it != _clocks.end(); ++it) {
+            auto& pending = it->second.pending;
+            if (_physController) {
+                for(auto jt = pending.begin(); jt != pending.end(); ++jt) {
+                    _physController->processPhysSyncEvent(jt->second);
+                }
+            }
+            pending.clear();
+        }
+    }
+    _jitterBuffered = value;
+}
 
 #pragma mark Event Management
 /**
@@ -319,9 +590,14 @@ void NetEventController::pushOutEvent(const std::shared_ptr<NetEvent>& e) {
 void NetEventController::updateNet() {
     if(_network){
         checkConnection();
+        
+        if (_status == Status::INGAME) {
+            pingClocks();
+        }
 
         if (_status == Status::INGAME && _physEnabled) {
-            _physController->packPhysSync(NetPhysicsController::SyncType::FULL_SYNC);
+            _physController->setGameTick(getGameTick());
+            _physController->packPhysSync(_syncType);
             _physController->packPhysObj();
             _physController->updateSimulation();
             for (auto it = _physController->getOutEvents().begin(); it != _physController->getOutEvents().end(); it++) {
@@ -332,6 +608,9 @@ void NetEventController::updateNet() {
         }
         
         processReceivedData();
+        if (_status == Status::INGAME && _physEnabled && _jitterBuffered) {
+            releaseSyncEvents();
+        }
         sendQueuedOutData();
     }
 }
@@ -339,29 +618,74 @@ void NetEventController::updateNet() {
 
 #pragma mark Networking Internals
 /**
- * Unwraps the a byte vector data into a NetEvent.
+ * Unwraps the a byte vector data into one or more NetEvents.
  *
- * The controller automatically detects the type of event, spawns a new
+ * The message may either be a single wrapped event, or a batched frame
+ * of several events (see {@link #setBatching}). For each event, the
+ * controller automatically detects the type of event, spawns a new
  * empty instance of that event, and calls the event's
- * {@link NetEvent#deserialize} method. This method is only called on
- * outbound events.
+ * {@link NetEvent#deserializeBytes} method on the bytes in place. This
+ * method is only called on inbound events.
  *
- * @param byte      The message received
+ * @param data      The message received
  * @param source    The UUID of the sender
+ * @param events    The vector to append the events to
  */
-std::shared_ptr<NetEvent> NetEventController::unwrap(const std::vector<std::byte>& data, std::string source) {
-    CUAssertLog(data.size() >= MIN_MSG_LENGTH && (Uint8)data[0] < _newEventVector.size(),
-                "Unwrapping invalid event");
+void NetEventController::unwrap(const std::vector<std::byte>& data, const std::string& source,
+                                std::vector<std::shared_ptr<NetEvent>>& events) {
     LWDeserializer deserializer;
-    deserializer.receive(data);
-    Uint8 eventType = (Uint8)deserializer.readByte();
-    std::shared_ptr<NetEvent> e = _newEventVector[eventType]->newEvent();
-    Uint64 eventTimeStamp = deserializer.readUint64();
+    deserializer.receive(data.data(),data.size());
+    Uint8 tag = (Uint8)deserializer.readByte();
+    if (tag != BATCH_FRAME_TAG) {
+        CUAssertLog(data.size() >= MIN_MSG_LENGTH && tag < _newEventVector.size(),
+                    "Unwrapping invalid event");
+        Uint64 stamp = deserializer.readUint64();
+        events.push_back(unwrapEvent(tag, stamp, data.data()+MIN_MSG_LENGTH,
+                                     data.size()-MIN_MSG_LENGTH, source));
+        return;
+    }
+    
+    // A batched frame: shared timestamp, then (type, length, payload)*
+    Uint64 stamp = deserializer.readVarint();
+    while (deserializer.available()) {
+        Uint8 type = (Uint8)deserializer.readByte();
+        size_t size = (size_t)deserializer.readVarint();
+        size_t pos  = deserializer.position();
+        if (type >= _newEventVector.size() || pos+size > data.size()) {
+            CUAssertLog(false, "Unwrapping invalid event frame");
+            return;
+        }
+        events.push_back(unwrapEvent(type, stamp, data.data()+pos, size, source));
+        deserializer.receive(data.data()+pos+size, data.size()-pos-size);
+    }
+}
 
+/**
+ * Returns a NetEvent for the given serialized bytes.
+ *
+ * The bytes are read in place and are not copied. The event is taken
+ * from the pool for its type, so it is only allocated if every pooled
+ * event of that type is still in use.
+ *
+ * @param type      The event type id
+ * @param stamp     The timestamp of the event from the sender
+ * @param data      The start of the serialized event
+ * @param size      The number of serialized bytes
+ * @param source    The UUID of the sender
+ *
+ * @return a NetEvent for the given serialized bytes.
+ */
+std::shared_ptr<NetEvent> NetEventController::unwrapEvent(Uint8 type, Uint64 stamp,
+                                                          const std::byte* data, size_t size,
+                                                          const std::string& source) {
+    const std::shared_ptr<NetEvent>& proto = _newEventVector[type];
+    std::shared_ptr<NetEvent> e = _eventPools[type].acquire([&proto]() {
+        return proto->newEvent();
+    });
     Uint64 time = Application::get()->getFixedCount();
     Uint64 receiveTimeStamp = time-_startGameTimeStamp;
-    e->setMetaData(eventTimeStamp, receiveTimeStamp, source);
-    e->deserialize(std::vector(data.begin()+MIN_MSG_LENGTH,data.end()));
+    e->setMetaData(stamp, receiveTimeStamp, source);
+    e->deserializeBytes(data, size);
     return e;
 }
 
@@ -369,8 +693,8 @@ std::shared_ptr<NetEvent> NetEventController::unwrap(const std::vector<std::byte
  * Wraps a NetEvent into a byte vector.
  *
  * The controller calls the event's {@link NetEvent#serialize()} method
- * and packs the event into byte data. This method is only on inbound
- * events.
+ * and packs the event into byte data. This method is only on outbound
+ * events, and produces a message with a single event (not a batched frame).
  *
  * @param e The event to wrap
  */
@@ -381,7 +705,7 @@ const std::vector<std::byte> NetEventController::wrap(const std::shared_ptr<NetE
 
     Uint64 time = Application::get()->getFixedCount();
     serializer.writeUint64(time-_startGameTimeStamp);
-    serializer.writeByteVector(e->serialize());
+    e->serializeTo(serializer);
     return serializer.serialize();
 }
 
@@ -392,13 +716,22 @@ const std::vector<std::byte> NetEventController::wrap(const std::shared_ptr<NetE
  * {@link processReceivedEvent()}.
  */
 void NetEventController::processReceivedData(){
-    _network->receive([this](const std::string source,
+    _network->receive([&](const std::string source,
         const std::vector<std::byte>& data) {
         //if (cugl::net::NetworkLayer::get()->isDebug()) {
         //    CULog("DATA %d, CUR STATE %d, SOURCE %s", data[0], _status, source.c_str());
         //}
-        processReceivedEvent(unwrap(data, source));
+        _unwrapped.clear();
+        unwrap(data, source, _unwrapped);
+        if (_status == Status::INGAME && !_unwrapped.empty()) {
+            updateTransit(source, _unwrapped.front()->getEventTimeStamp());
+        }
+        for (auto it = _unwrapped.begin(); it != _unwrapped.end(); ++it) {
+            processReceivedEvent(*it);
+        }
     });
+    // Release our references so the events can be recycled
+    _unwrapped.clear();
 }
 
 /**
@@ -413,9 +746,15 @@ void NetEventController::processReceivedEvent(const std::shared_ptr<NetEvent>& e
     if (auto game = std::dynamic_pointer_cast<GameStateEvent>(e)) {
         processGameStateEvent(game);
     } else if (_status == Status::INGAME){
-        if (auto phys = std::dynamic_pointer_cast<PhysSyncEvent>(e)) {
-            if(_physEnabled)
+        if (auto clock = std::dynamic_pointer_cast<ClockSyncEvent>(e)) {
+            processClockSyncEvent(clock);
+        }
+        else if (auto phys = std::dynamic_pointer_cast<PhysSyncEvent>(e)) {
+            if (_physEnabled && _jitterBuffered && isRemote(e->getSourceId())) {
+                bufferSyncEvent(phys);
+            } else if (_physEnabled) {
                 _physController->processPhysSyncEvent(phys);
+            }
         }
         else if (auto phys = std::dynamic_pointer_cast<PhysObstEvent>(e)) {
             if (_physEnabled) {
@@ -428,6 +767,148 @@ void NetEventController::processReceivedEvent(const std::shared_ptr<NetEvent>& e
     }
 }
 
+/**
+ * Processes a ClockSyncEvent.
+ *
+ * This method answers pings and updates the clock offset and round trip
+ * estimates from pongs. If physics is enabled, the new offset is passed
+ * on to the physics controller (see {@link NetPhysicsController#setClockOffset}).
+ *
+ * @param e The received event
+ */
+void NetEventController::processClockSyncEvent(const std::shared_ptr<ClockSyncEvent>& e) {
+    const std::string& source = e->getSourceId();
+    if (!isRemote(source)) {
+        return;
+    }
+    
+    Uint64 now = getGameMicros();
+    if (e->getType() == ClockSyncEvent::EventType::PING) {
+        // The ping was processed as soon as it was received
+        _network->sendTo(source, wrap(ClockSyncEvent::allocPong(e->getOrigin(), now, getGameMicros())));
+        return;
+    }
+    
+    // NTP: t0 = origin, t1 = receive, t2 = transmit, t3 = now
+    Sint64 t0 = (Sint64)e->getOrigin();
+    Sint64 t1 = (Sint64)e->getReceive();
+    Sint64 t2 = (Sint64)e->getTransmit();
+    Sint64 t3 = (Sint64)now;
+    Sint64 rtt = std::max((Sint64)0, (t3-t0)-(t2-t1));
+    Sint64 offset = ((t1-t0)+(t2-t3))/2;
+    
+    PeerClock& clock = _clocks[source];
+    clock.rtt = clock.samples.empty() ? rtt : clock.rtt+(rtt-clock.rtt)/8;
+    clock.samples.emplace_back(offset,rtt);
+    if (clock.samples.size() > CLOCK_SAMPLES) {
+        clock.samples.pop_front();
+    }
+    
+    // The sample with the least round trip has the least asymmetry error
+    auto best = clock.samples.begin();
+    for(auto it = clock.samples.begin(); it != clock.samples.end(); ++it) {
+        if (it->second < best->second) {
+            best = it;
+        }
+    }
+    clock.offset = best->first;
+    
+    // The physics controller compares snapshot stamps in ticks
+    if (_physEnabled) {
+        Sint64 step = (Sint64)Application::get()->getFixedStep();
+        Sint64 ticks = (clock.offset+(clock.offset < 0 ? -step : step)/2)/step;
+        _physController->setClockOffset(source, ticks);
+    }
+}
+
+/**
+ * Updates the delay and jitter estimates for a received message.
+ *
+ * @param source    The UUID of the sender
+ * @param stamp     The timestamp of the message from the sender
+ */
+void NetEventController::updateTransit(const std::string& source, Uint64 stamp) {
+    if (!isRemote(source)) {
+        return;
+    }
+    
+    // This is not corrected by the offset, so offset updates do not disturb it
+    PeerClock& clock = _clocks[source];
+    Sint64 sent = (Sint64)(stamp*Application::get()->getFixedStep());
+    Sint64 transit = (Sint64)getGameMicros()-sent;
+    if (!clock.received) {
+        clock.delay = transit;
+        clock.received = true;
+    } else {
+        // RFC 3550 interarrival jitter
+        Sint64 diff = transit-clock.transit;
+        clock.jitter += (std::abs((double)diff)-clock.jitter)/16;
+        clock.delay  += (transit-clock.delay)/16;
+    }
+    clock.transit = transit;
+}
+
+/**
+ * Adds a synchronization event to the jitter buffer of its sender.
+ *
+ * The event is dropped (as late) if a more recent event from the same
+ * sender has already been released.
+ *
+ * @param e The received event
+ */
+void NetEventController::bufferSyncEvent(const std::shared_ptr<PhysSyncEvent>& e) {
+    PeerClock& clock = _clocks[e->getSourceId()];
+    Uint64 stamp = e->getEventTimeStamp();
+    if (clock.hasPlayed && stamp < clock.played) {
+        clock.lateDrops++;
+        return;
+    }
+    
+    // Playout at the send time plus the delay, but never hold it too long
+    Sint64 now  = (Sint64)getGameMicros();
+    Sint64 sent = (Sint64)(stamp*Application::get()->getFixedStep());
+    Sint64 playout = sent+(Sint64)(clock.delay+JITTER_MULTIPLIER*clock.jitter);
+    playout = std::max(now, std::min(playout, now+(Sint64)MAX_PLAYOUT_DELAY));
+    
+    // Keep the buffer in send order
+    auto& pending = clock.pending;
+    auto pos = pending.end();
+    while (pos != pending.begin() && (pos-1)->second->getEventTimeStamp() > stamp) {
+        --pos;
+    }
+    pending.emplace(pos, (Uint64)playout, e);
+}
+
+/**
+ * Releases all buffered synchronization events whose playout time has
+ * passed to the physics controller.
+ */
+void NetEventController::releaseSyncEvents() {
+    Uint64 now = getGameMicros();
+    for(auto it = _clocks.begin(); it != _clocks.end(); ++it) {
+        PeerClock& clock = it->second;
+        while (!clock.pending.empty() && clock.pending.front().first <= now) {
+            std::shared_ptr<PhysSyncEvent> e = clock.pending.front().second;
+            clock.pending.pop_front();
+            clock.played = e->getEventTimeStamp();
+            clock.hasPlayed = true;
+            _physController->processPhysSyncEvent(e);
+        }
+    }
+}
+
+/**
+ * Broadcasts a clock ping if the ping interval has passed.
+ */
+void NetEventController::pingClocks() {
+    Uint64 tick = getGameTick();
+    if (_clockInterval == 0 || tick < _nextPing) {
+        return;
+    }
+    _nextPing = tick+_clockInterval;
+    _network->broadcast(wrap(ClockSyncEvent::allocPing(getGameMicros())));
+}
+
 /**
  * Processes a GameStateEvent.
  *
@@ -450,6 +931,8 @@ void NetEventController::processGameStateEvent(const std::shared_ptr<GameStateEv
     if (_status == Status::READY && e->getType() == GameStateEvent::EventType::GAME_START) {
         _status = Status::INGAME;
         _startGameTimeStamp = Application::get()->getFixedCount();
+        _startGameMicros = Application::get()->getEllapsedMicros();
+        _nextPing = 0;
     }
     if (_isHost) {
         if (e->getType() == GameStateEvent::EventType::CLIENT_RDY) {
@@ -520,18 +1003,111 @@ bool NetEventController::checkConnection() {
 
 /**
  * Broadcasts all queued outbound events.
+ *
+ * If batching is enabled, the events are packed into as few frames as
+ * possible, each of which is no larger than {@link #getFrameLimit} (unless
+ * a single event is larger than that). Otherwise each event is sent as its
+ * own message. Physics synchronization events are sent on the channel
+ * class {@link #getSyncChannel}, in frames of their own if they have their
+ * own class or may be skipped for slow peers (see {@link #setSyncQueueLimit}).
  */
 void NetEventController::sendQueuedOutData(){
-    int msgCount = 0;
-    int byteCount = 0;
-    for(auto it = _outEventQueue.begin(); it != _outEventQueue.end(); it++){
-        auto e = *(it);
-        auto wrapped = wrap(e);
-        msgCount++;
-        byteCount += wrapped.size();
-        //CULog("flag: %x", (std::byte)getType(*e))
-        _network->broadcast(wrap(e));
+    if (_outEventQueue.empty()) {
+        return;
+    }
+    
+    bool split = isSyncSplit();
+    if (!_batching) {
+        for(auto it = _outEventQueue.begin(); it != _outEventQueue.end(); it++){
+            if (split && dynamic_cast<PhysSyncEvent*>(it->get()) != nullptr) {
+                sendSync(wrap(*it),_syncChannel);
+            } else {
+                _network->broadcast(wrap(*it));
+            }
+        }
+        _outEventQueue.clear();
+        return;
+    }
+    
+    // All events in this tick share a timestamp
+    Uint64 stamp = Application::get()->getFixedCount()-_startGameTimeStamp;
+    
+    // The second pass only happens if sync events have their own channel
+    for(int pass = 0; pass < (split ? 2 : 1); pass++) {
+        NetcodeConfig::ChannelClass cls = (pass ? _syncChannel : NetcodeConfig::ChannelClass::RELIABLE);
+        _frame.reset();
+        _frame.writeByte(std::byte(BATCH_FRAME_TAG));
+        _frame.writeVarint(stamp);
+        size_t header = _frame.size();
+        
+        for(auto it = _outEventQueue.begin(); it != _outEventQueue.end(); it++){
+            const std::shared_ptr<NetEvent>& e = *(it);
+            if (split && (dynamic_cast<PhysSyncEvent*>(e.get()) != nullptr) != (pass == 1)) {
+                continue;
+            }
+            _payload.reset();
+            e->serializeTo(_payload);
+            
+            // Worst case is ten bytes for the length varint
+            if (_frame.size() > header && _frame.size()+_payload.size()+11 > _frameLimit) {
+                flushFrame(header,cls,pass == 1);
+                _frame.writeByte(std::byte(BATCH_FRAME_TAG));
+                _frame.writeVarint(stamp);
+            }
+            _frame.writeByte((std::byte)getType(*e));
+            _frame.writeVarint(_payload.size());
+            _frame.writeByteVector(_payload.serialize());
+        }
+        flushFrame(header,cls,pass == 1);
     }
     _outEventQueue.clear();
 }
 
+/**
+ * Broadcasts the current batched frame (if it has any events).
+ *
+ * @param header    The size of the frame header
+ * @param cls       The channel class to broadcast on
+ * @param sync      Whether the frame only has synchronization events
+ */
+void NetEventController::flushFrame(size_t header, NetcodeConfig::ChannelClass cls, bool sync) {
+    if (_frame.size() > header) {
+        if (sync) {
+            sendSync(_frame.serialize(),cls);
+        } else {
+            _network->broadcast(_frame.serialize(),cls);
+        }
+    }
+    _frame.reset();
+}
+
+/**
+ * Broadcasts a message of synchronization events.
+ *
+ * If there is a synchronization queue limit, the message is encoded
+ * once and sent to each peer whose send queue is within the limit. All
+ * other peers are skipped. Otherwise, the message is simply broadcast.
+ *
+ * @param data  The message to send
+ * @param cls   The channel class to send on
+ */
+void NetEventController::sendSync(const std::vector<std::byte>& data, NetcodeConfig::ChannelClass cls) {
+    if (_syncQueueLimit == 0) {
+        _network->broadcast(data,cls);
+        return;
+    }
+    
+    // Synchronization events from ourself are ignored, so skip the loopback
+    std::shared_ptr<NetcodeMessage> message = NetcodeMessage::alloc(data);
+    std::string self = _network->getUUID();
+    auto players = _network->getPlayers();
+    for(auto it = players.begin(); it != players.end(); ++it) {
+        if (*it == self) {
+            continue;
+        } else if (_network->getQueuedBytes(*it) > _syncQueueLimit) {
+            _shedFrames++;
+        } else {
+            _network->sendTo(*it,message,cls);
+        }
+    }
+}
@@ -42,12 +42,22 @@
 #include <cugl/physics2/distrib/CUNetWorld.h>
 #include <cugl/physics2/distrib/CUNetPhysicsController.h>
 #include <cugl/physics2/distrib/CULWSerializer.h>
+#include <algorithm>
 
 
 using namespace cugl;
 using namespace cugl::physics2;
 using namespace cugl::physics2::distrib;
 
+/** The default byte budget for a priority sync */
+#define DEFAULT_SYNC_BUDGET 1024
+/** The smallest interest scale for obstacles far from every peer */
+#define MIN_INTEREST        0.05f
+/** The default number of ticks of prediction history */
+#define DEFAULT_HISTORY     32
+/** The default position error that triggers a rollback */
+#define DEFAULT_RECONCILE   0.05f
+
 
 #pragma mark -
 #pragma mark Constructors
@@ -73,8 +83,19 @@ _itprDebug(false),
 _itprCount(0),
 _ovrdCount(0),
 _stepSum(0),
+_rollbackCount(0),
+_rollbackSteps(0),
+_rollbackMax(0),
+_correctionCount(0),
+_correctionSum(0),
+_correctionMax(0),
+_isHost(false),
 _objRotation(0),
-_isHost(false) {
+_syncBudget(DEFAULT_SYNC_BUDGET),
+_tick(0),
+_historySize(DEFAULT_HISTORY),
+_reconcileThreshold(DEFAULT_RECONCILE),
+_replaying(false) {
 }
 
 
@@ -104,6 +125,8 @@ bool NetPhysicsController::init(std::shared_ptr<NetWorld>& world, Uint32 shortUI
     //_world->setshortUID(shortUID);
     _linkSceneToObsFunc = linkFunc;
     _isHost = isHost;
+    _encoder.setBounds(world->getBounds());
+    _decoders.clear();
     return true;
 }
 
@@ -141,12 +164,12 @@ ObstacleScene NetPhysicsController::addSharedObstacle(Uint32 factoryID,
     pair.first->setShared(true);
     Uint64 objId = _world->placeObstacle(pair.first);
     if (_isHost){
-        _world->getOwnedObstacles().insert(std::make_pair(pair.first,0));
+        _world->setOwnership(pair.first,0);
     }
     if (_linkSceneToObsFunc) {
         _linkSceneToObsFunc(pair.first, pair.second);
     }
-    _outEvents.push_back(PhysObstEvent::allocCreation(factoryID,objId,bytes));
+    queueObstEvent()->initCreation(factoryID,objId,bytes);
     return pair;
 }
 
@@ -158,10 +181,13 @@ ObstacleScene NetPhysicsController::addSharedObstacle(Uint32 factoryID,
  * @param obs   the obstacle to remove
  */
 void NetPhysicsController::removeSharedObstacle(std::shared_ptr<physics2::Obstacle> obj) {
-    auto map = _world->getObstacleIds();
-    if (map.count(obj)) {
-        Uint64 objId = map.at(obj);
-        _outEvents.push_back(PhysObstEvent::allocDeletion(objId));
+    Sint32 slot = _world->getObstacleSlot(obj);
+    if (slot >= 0) {
+        Uint64 objId = _world->getSlotId(slot);
+        queueObstEvent()->initDeletion(objId);
+        _encoder.remove(objId);
+        releaseSlot(slot);
+        _predicted.erase(obj);
         _world->removeObstacle(obj);
         if (_sharedObsToNodeMap.count(obj)) {
             _sharedObsToNodeMap.at(obj)->removeFromParent();
@@ -189,15 +215,9 @@ void NetPhysicsController::removeSharedObstacle(std::shared_ptr<physics2::Obstac
  * @param duration  number of physics steps to hold ownership
  */
 void NetPhysicsController::acquireObs(std::shared_ptr<physics2::Obstacle> obs, Uint64 duration){
-    auto owned = _world->getOwnedObstacles();
-    if(_isHost){
-        owned.insert(std::make_pair(obs, 0));
-    } else {
-        owned.insert(std::make_pair(obs,duration));
-    }
-    Uint64 id = _world->getObstacleIds().at(obs);
-    auto event = PhysObstEvent::allocOwnerAcquire(id, duration);
-    _outEvents.push_back(event);
+    _world->setOwnership(obs, _isHost ? 0 : duration);
+    Uint64 id = _world->getObstacleId(obs);
+    queueObstEvent()->initOwnerAcquire(id, duration);
 }
 
 /**
@@ -212,10 +232,9 @@ void NetPhysicsController::acquireObs(std::shared_ptr<physics2::Obstacle> obs, U
  */
 void NetPhysicsController::releaseObs(std::shared_ptr<physics2::Obstacle> obs) {
     if (!_isHost) {
-        _world->getOwnedObstacles().erase(obs);
-        Uint64 id = _world->getObstacleIds().at(obs);
-        auto event = PhysObstEvent::allocOwnerRelease(id);
-        _outEvents.push_back(event);
+        _world->clearOwnership(obs);
+        Uint64 id = _world->getObstacleId(obs);
+        queueObstEvent()->initOwnerRelease(id);
     }
 }
 
@@ -226,11 +245,11 @@ void NetPhysicsController::releaseObs(std::shared_ptr<physics2::Obstacle> obs) {
  * clients on the network.  It should be used for initial objects only.
  */
 void NetPhysicsController::ownAll() {
-    auto obstacles = _world->getObstacles();
-    auto ownership = _world->getOwnedObstacles();
-    // TODO: This really needs a better method
-    for(auto it = obstacles.begin(); it != obstacles.end(); ++it){
-        ownership.insert(std::make_pair((*it), 0));
+    const auto& slots = _world->getSlots();
+    for(Uint32 slot = 0; slot < slots.size(); slot++) {
+        if (slots[slot] != nullptr) {
+            _world->setOwnership(slot,0);
+        }
     }
 }
 
@@ -246,8 +265,17 @@ void NetPhysicsController::addSyncObject(std::shared_ptr<physics2::Obstacle> obj
                                          const std::shared_ptr<TargetParams>& param) {
     if (_itprMethod == 1) {
         return;
-    } else if (_cache.count(obj)) {
-        auto oldParam = _cache.at(obj);
+    }
+    
+    Sint32 slot = _world->getObstacleSlot(obj);
+    if (slot < 0) {
+        return;
+    } else if (slot >= (Sint32)_cache.size()) {
+        _cache.resize(_world->getSlotCount());
+    }
+    
+    auto& oldParam = _cache[slot];
+    if (oldParam != nullptr) {
         obj->setShared(false);
         // ===== BEGIN NON-SHARED BLOCK =====
         obj->setLinearVelocity(oldParam->targetVel);
@@ -256,9 +284,10 @@ void NetPhysicsController::addSyncObject(std::shared_ptr<physics2::Obstacle> obj
         obj->setShared(true);
         param->I = oldParam->I;
         param->numI = oldParam->numI;
+    } else {
+        _itprSlots.push_back(slot);
     }
-    _cache.erase(obj);
-    _cache.insert(std::make_pair(obj,param));
+    oldParam = param;
     _stepSum += param->numSteps;
     _itprCount++;
 }
@@ -274,39 +303,428 @@ float NetPhysicsController::interpolate(int stepsLeft, float target, float sourc
     return (target-source)/stepsLeft+source;
 }
 
+/**
+ * Returns a recycled obstacle event, appended to the outbound events.
+ *
+ * The event must be initialized by the caller.
+ *
+ * @return a recycled obstacle event, appended to the outbound events.
+ */
+std::shared_ptr<PhysObstEvent> NetPhysicsController::queueObstEvent() {
+    auto event = _obstPool.acquire([]() { return std::make_shared<PhysObstEvent>(); });
+    _outEvents.push_back(event);
+    return event;
+}
+
+/**
+ * Returns the priority an obstacle accrues in a single tick.
+ *
+ * This is the speed of the obstacle (plus one), scaled by the nearest
+ * peer area of interest.
+ *
+ * @param obj   The obstacle
+ *
+ * @return the priority an obstacle accrues in a single tick.
+ */
+float NetPhysicsController::accruePriority(const std::shared_ptr<physics2::Obstacle>& obj) const {
+    float result = 1+obj->getLinearVelocity().length()+std::abs(obj->getAngularVelocity());
+    
+    bool hasInterest = false;
+    float interest = MIN_INTEREST;
+    Vec2 pos = obj->getPosition();
+    for(auto it = _peers.begin(); it != _peers.end(); ++it) {
+        const PeerSync& peer = it->second;
+        if (peer.radius > 0) {
+            hasInterest = true;
+            float dist = pos.distance(peer.center);
+            interest = std::max(interest, dist <= peer.radius ? 1.0f : peer.radius/dist);
+        }
+    }
+    return hasInterest ? result*interest : result;
+}
+
+#pragma mark Priority Synchronization
+/**
+ * Sets the area of interest for the given peer.
+ *
+ * A priority sync favors obstacles near the area of interest of some
+ * peer. Obstacles inside the area accrue priority at the full rate, while
+ * those outside fall off with the distance.
+ *
+ * @param peer      The peer UUID
+ * @param center    The center of the area of interest
+ * @param radius    The radius of the area of interest
+ */
+void NetPhysicsController::setPeerInterest(const std::string& peer, const Vec2& center, float radius) {
+    PeerSync& sync = _peers[peer];
+    sync.center = center;
+    sync.radius = radius;
+}
+
+/**
+ * Sets the byte budget for the given peer.
+ *
+ * Synchronization is broadcast, so every peer receives the same stream.
+ * Hence a priority sync uses the smallest budget among all peers. A
+ * budget of 0 means the peer has no limit of its own.
+ *
+ * @param peer      The peer UUID
+ * @param budget    The maximum bytes per tick for this peer
+ */
+void NetPhysicsController::setPeerBudget(const std::string& peer, size_t budget) {
+    _peers[peer].budget = budget;
+}
+
+#pragma mark Prediction
+/**
+ * Sets whether the given obstacle is predicted.
+ *
+ * A predicted obstacle is one that this client simulates ahead of its
+ * owner, typically an avatar driven by local input. Snapshots from the
+ * owner are not interpolated. Instead they are compared against the
+ * history of the obstacle at the same tick. If the prediction was off,
+ * the obstacle is rewound to the snapshot and resimulated (with the
+ * recorded inputs) up to the current tick.
+ *
+ * Predicted obstacles should be driven with {@link #applyInput} so that
+ * their inputs can be replayed.
+ *
+ * @param obs   The obstacle
+ * @param value Whether the obstacle is predicted
+ */
+void NetPhysicsController::setPredicted(const std::shared_ptr<physics2::Obstacle>& obs, bool value) {
+    if (!value) {
+        _predicted.erase(obs);
+        return;
+    } else if (_predicted.count(obs)) {
+        return;
+    }
+    
+    Prediction& pred = _predicted[obs];
+    pred.history.resize(_historySize);
+    releaseSlot(_world->getObstacleSlot(obs));
+}
+
+/**
+ * Applies a force and torque to the given obstacle for this tick.
+ *
+ * If the obstacle is predicted, the input is recorded so that it can
+ * be replayed by a rollback. If this controller does not own the
+ * obstacle, the total input of the tick is also sent to the owner, who
+ * applies it when it arrives. Inputs should be applied before the world
+ * is updated, and {@link NetEventController#updateNet} should be called
+ * after the world is updated.
+ *
+ * @param obs       The obstacle
+ * @param force     The force to apply to the center of the obstacle
+ * @param torque    The torque to apply to the obstacle
+ */
+void NetPhysicsController::applyInput(const std::shared_ptr<physics2::Obstacle>& obs,
+                                      const Vec2& force, float torque) {
+    b2Body* body = obs->getBody();
+    if (body == nullptr) {
+        return;
+    }
+    body->ApplyForceToCenter(b2Vec2(force.x,force.y),true);
+    body->ApplyTorque(torque,true);
+    
+    auto it = _predicted.find(obs);
+    if (it != _predicted.end()) {
+        it->second.force += force;
+        it->second.torque += torque;
+    }
+}
+
+/**
+ * Sets the number of ticks of history kept for each predicted obstacle.
+ *
+ * Snapshots older than this cannot be reconciled, and are interpolated
+ * instead. This should cover the round trip time to the owner. Changing
+ * this value erases all history.
+ *
+ * @param size  The number of ticks of history kept for each predicted obstacle
+ */
+void NetPhysicsController::setHistorySize(Uint32 size) {
+    CUAssertLog(size > 0, "The history size must be positive");
+    _historySize = size;
+    for(auto it = _predicted.begin(); it != _predicted.end(); ++it) {
+        it->second.history.assign(size,HistoryFrame());
+        it->second.pending = false;
+    }
+}
+
+/**
+ * Returns the history frame for the given tick, or nullptr if there is none.
+ *
+ * @param pred  The prediction state
+ * @param tick  The game tick
+ *
+ * @return the history frame for the given tick, or nullptr if there is none.
+ */
+NetPhysicsController::HistoryFrame* NetPhysicsController::getFrame(Prediction& pred, Uint64 tick) {
+    HistoryFrame& frame = pred.history[tick % pred.history.size()];
+    return (frame.valid && frame.tick == tick) ? &frame : nullptr;
+}
+
+/**
+ * Returns the local game tick for a timestamp from the given peer.
+ *
+ * The timestamp is converted with the clock offset of the peer (see
+ * {@link #setClockOffset}). The result is never less than 0.
+ *
+ * @param peer  The peer UUID
+ * @param stamp The game tick of the peer
+ *
+ * @return the local game tick for a timestamp from the given peer.
+ */
+Uint64 NetPhysicsController::toLocalTick(const std::string& peer, Uint64 stamp) const {
+    auto it = _clockOffsets.find(peer);
+    if (it == _clockOffsets.end()) {
+        return stamp;
+    }
+    Sint64 tick = (Sint64)stamp-it->second;
+    return tick < 0 ? 0 : (Uint64)tick;
+}
+
+/**
+ * Records the current tick in the history of every predicted obstacle.
+ *
+ * The input of this tick is also sent to the owner of each predicted
+ * obstacle that this controller does not own.
+ */
+void NetPhysicsController::recordHistory() {
+    for(auto it = _predicted.begin(); it != _predicted.end(); ++it) {
+        Prediction& pred = it->second;
+        HistoryFrame& frame = pred.history[_tick % pred.history.size()];
+        
+        // The owner must see the same inputs to agree with the prediction
+        bool input = pred.force != Vec2::ZERO || pred.torque != 0;
+        Sint32 slot = _world->getObstacleSlot(it->first);
+        if (input && slot >= 0 && it->first->isShared() && !_world->isOwned(slot)) {
+            queueObstEvent()->initInput(_world->getSlotId(slot), _tick, pred.force, pred.torque);
+        }
+        
+        // Inputs accumulate if the same tick is recorded twice
+        if (!frame.valid || frame.tick != _tick) {
+            frame.force = Vec2::ZERO;
+            frame.torque = 0;
+        }
+        frame.tick = _tick;
+        frame.valid = true;
+        frame.force += pred.force;
+        frame.torque += pred.torque;
+        frame.position = it->first->getPosition();
+        frame.velocity = it->first->getLinearVelocity();
+        frame.angle = it->first->getAngle();
+        frame.angularVelocity = it->first->getAngularVelocity();
+        pred.force = Vec2::ZERO;
+        pred.torque = 0;
+    }
+}
+
+/**
+ * Sets the state of the obstacle without marking it as dirty.
+ *
+ * @param obj   The obstacle
+ * @param frame The state to assign
+ */
+static void restoreFrame(const std::shared_ptr<physics2::Obstacle>& obj,
+                         const NetPhysicsController::HistoryFrame& frame) {
+    bool shared = obj->isShared();
+    obj->setShared(false);
+    obj->setPosition(frame.position);
+    obj->setLinearVelocity(frame.velocity);
+    obj->setAngle(frame.angle);
+    obj->setAngularVelocity(frame.angularVelocity);
+    obj->setShared(shared);
+}
+
+/**
+ * Stores the state of the obstacle in the given frame.
+ *
+ * @param obj   The obstacle
+ * @param frame The frame to store the state
+ */
+static void storeFrame(const std::shared_ptr<physics2::Obstacle>& obj,
+                       NetPhysicsController::HistoryFrame& frame) {
+    frame.position = obj->getPosition();
+    frame.velocity = obj->getLinearVelocity();
+    frame.angle = obj->getAngle();
+    frame.angularVelocity = obj->getAngularVelocity();
+}
+
+/**
+ * Reconciles the pending snapshots of all predicted obstacles.
+ *
+ * Each pending snapshot is compared against the history at its tick.
+ * If any of them are off by more than the reconcile threshold, the
+ * predicted obstacles are rewound to the earliest such tick and the
+ * world is resimulated up to the current tick. All other obstacles are
+ * held in place during the resimulation: their state is restored after
+ * every step, so they act as fixed obstacles. Contact callbacks still
+ * fire during the resimulation, with {@link #isReplaying} set.
+ */
+void NetPhysicsController::reconcile() {
+    Uint64 start = _tick;
+    bool rollback = false;
+    for(auto it = _predicted.begin(); it != _predicted.end(); ++it) {
+        Prediction& pred = it->second;
+        if (!pred.pending) {
+            continue;
+        }
+        
+        HistoryFrame* frame = getFrame(pred, pred.targetTick);
+        if (frame == nullptr) {
+            // Too old to reconcile
+            pred.pending = false;
+            interpolateTo(it->first, pred.target);
+            continue;
+        }
+        
+        float error = (frame->position-Vec2(pred.target.x,pred.target.y)).length();
+        _correctionCount++;
+        _correctionSum += error;
+        _correctionMax = std::max(_correctionMax,error);
+        if (error <= _reconcileThreshold) {
+            pred.pending = false;
+        } else {
+            start = std::min(start,pred.targetTick);
+            rollback = true;
+        }
+    }
+    if (!rollback) {
+        return;
+    }
+    
+    // Hold everything else in place
+    _frozen.clear();
+    const auto& slots = _world->getSlots();
+    for(auto it = slots.begin(); it != slots.end(); ++it) {
+        const std::shared_ptr<physics2::Obstacle>& obj = *it;
+        if (obj == nullptr || obj->getBodyType() == b2_staticBody || obj->getBody() == nullptr) {
+            continue;
+        }
+        
+        auto pt = _predicted.find(obj);
+        if (pt != _predicted.end()) {
+            HistoryFrame* frame = getFrame(pt->second, start);
+            if (frame != nullptr) {
+                restoreFrame(obj, *frame);
+                continue;
+            }
+        }
+        
+        HistoryFrame state;
+        storeFrame(obj, state);
+        state.valid = obj->isAwake();
+        _frozen.push_back(std::make_pair(obj,state));
+        obj->getBody()->SetAwake(false); // Not through the obstacle, to keep it clean
+    }
+    
+    // Contact callbacks can check isReplaying to ignore these steps
+    _replaying = true;
+    b2World* world = _world->getWorld();
+    float dt = _world->getStepsize();
+    for(Uint64 tick = start; tick <= _tick; tick++) {
+        if (tick > start) {
+            for(auto it = _predicted.begin(); it != _predicted.end(); ++it) {
+                HistoryFrame* frame = getFrame(it->second, tick);
+                b2Body* body = it->first->getBody();
+                if (frame != nullptr && body != nullptr) {
+                    body->ApplyForceToCenter(b2Vec2(frame->force.x,frame->force.y),true);
+                    body->ApplyTorque(frame->torque,true);
+                }
+            }
+            world->Step(dt,_world->getVelocityIterations(),_world->getPositionIterations());
+            
+            // Undo any contact that woke (and moved) a frozen obstacle
+            for(auto jt = _frozen.begin(); jt != _frozen.end(); ++jt) {
+                b2Body* body = jt->first->getBody();
+                if (body->IsAwake()) {
+                    restoreFrame(jt->first, jt->second);
+                    body->SetAwake(false);
+                }
+            }
+        }
+        
+        // Snap to the authoritative snapshots as they come up
+        for(auto it = _predicted.begin(); it != _predicted.end(); ++it) {
+            Prediction& pred = it->second;
+            HistoryFrame* frame = getFrame(pred, tick);
+            if (frame == nullptr) {
+                continue;
+            }
+            if (pred.pending && pred.targetTick == tick) {
+                frame->position.set(pred.target.x,pred.target.y);
+                frame->velocity.set(pred.target.vx,pred.target.vy);
+                frame->angle = it->first->getAngle()+(float)std::remainder(pred.target.angle-it->first->getAngle(),2*M_PI);
+                frame->angularVelocity = pred.target.vAngular;
+                restoreFrame(it->first, *frame);
+                pred.pending = false;
+            } else if (tick > start) {
+                storeFrame(it->first, *frame);
+            }
+        }
+    }
+    
+    _replaying = false;
+    
+    for(auto it = _frozen.begin(); it != _frozen.end(); ++it) {
+        restoreFrame(it->first, it->second);
+        it->first->getBody()->SetAwake(it->second.valid);
+    }
+    _frozen.clear();
+    
+    _rollbackCount++;
+    _rollbackSteps += (long)(_tick-start);
+    _rollbackMax = std::max(_rollbackMax,_tick-start);
+    if (_itprDebug) {
+        CULog("Rollback of %llu steps", (unsigned long long)(_tick-start));
+    }
+}
+
 #pragma mark Synchronization
 /**
  * Updates the physics controller.
+ *
+ * This records the current tick in the prediction history, reconciles
+ * any pending snapshots of predicted obstacles, and then advances all
+ * ongoing interpolations.
  */
 void NetPhysicsController::updateSimulation() {
     packPhysObj();
     
     // Ownership transfer
-    std::vector<std::shared_ptr<cugl::physics2::Obstacle>> deleteCache;
-    auto ownership = _world->getOwnedObstacles();
-    for(auto it = _world->getObstacles().begin() ; it != _world->getObstacles().end(); ++it) {
-        if (ownership.count(*it)){
-            Uint64 left = ownership.at(*it);
-            if (left==1){
-                releaseObs(*it);
-            } else if (left>1) {
-                ownership[*it]=left-1;
+    const auto& slots = _world->getSlots();
+    for(Uint32 slot = 0; slot < slots.size(); slot++) {
+        if (_world->isOwned(slot)) {
+            Uint64 left = _world->getOwnership(slot);
+            if (left == 1) {
+                releaseObs(slots[slot]);
+            } else if (left > 1) {
+                _world->setOwnership(slot,left-1);
             }
         }
     }
-    for(auto it = deleteCache.begin(); it != deleteCache.end(); ++it){
-        ownership.erase((*it));
-    }
+    
+    // Rollbacks rewrite the history, so record this tick first
+    recordHistory();
+    reconcile();
 
-    for(auto it = _cache.begin(); it != _cache.end(); it++){
-        auto obj = it->first;
-        if(!obj->isShared()){
-            _deleteCache.push_back(it->first);
+    // Compact the active slots in place as interpolations finish
+    size_t active = 0;
+    for(size_t ii = 0; ii < _itprSlots.size(); ii++) {
+        Uint32 slot = _itprSlots[ii];
+        std::shared_ptr<TargetParams>& param = _cache[slot];
+        const std::shared_ptr<physics2::Obstacle>& obj = slots[slot];
+        if (param == nullptr) {
+            continue;
+        } else if (obj == nullptr || !obj->isShared()) {
+            param = nullptr;
             continue;
         }
         obj->setShared(false);
         // ===== BEGIN NON-SHARED BLOCK =====
-        std::shared_ptr<TargetParams> param = it->second;
         int stepsLeft = param->numSteps-param->curStep;
         
         if (stepsLeft <= 1){
@@ -314,8 +732,11 @@ void NetPhysicsController::updateSimulation() {
             obj->setLinearVelocity(param->targetVel);
             obj->setAngle(param->targetAngle);
             obj->setAngularVelocity(param->targetAngV);
-            _deleteCache.push_back(it->first);
+            param = nullptr;
             _ovrdCount++;
+            // ====== END NON-SHARED BLOCK ======
+            obj->setShared(true);
+            continue;
         } else{
             float t = ((float)param->curStep)/param->numSteps;
             CUAssert(t<=1.f && t>=0.f);
@@ -363,12 +784,9 @@ void NetPhysicsController::updateSimulation() {
         param->curStep++;
         // ====== END NON-SHARED BLOCK ======
         obj->setShared(true);
+        _itprSlots[active++] = slot;
     }
-
-    for(auto it = _deleteCache.begin(); it != _deleteCache.end(); it++){
-        _cache.erase(*it);
-    }
-    _deleteCache.clear();
+    _itprSlots.resize(active);
 
     if (_itprDebug) {
         CULog("%ld/%ld overriden", _itprCount-_ovrdCount,_itprCount);
@@ -397,7 +815,7 @@ void NetPhysicsController::processPhysObstEvent(const std::shared_ptr<PhysObstEv
             _sharedObsToNodeMap.insert(std::make_pair(pair.first, pair.second));
         }
         if(_isHost){
-            _world->getOwnedObstacles().insert({pair.first,0});
+            _world->setOwnership(pair.first,0);
         }
         return;
     }
@@ -410,7 +828,18 @@ void NetPhysicsController::processPhysObstEvent(const std::shared_ptr<PhysObstEv
     }
 
     if (event->getType() == PhysObstEvent::EventType::DELETION) {
-        _cache.erase(obj);
+        _encoder.remove(event->getObstacleId());
+        releaseSlot(_world->getObstacleSlot(obj));
+        for(auto it = _decoders.begin(); it != _decoders.end(); ++it) {
+            it->second.remove(event->getObstacleId());
+        }
+        for(auto it = _syncStamps.begin(); it != _syncStamps.end(); ++it) {
+            it->second.erase(event->getObstacleId());
+        }
+        for(auto it = _inputStamps.begin(); it != _inputStamps.end(); ++it) {
+            it->second.erase(event->getObstacleId());
+        }
+        _predicted.erase(obj);
         _world->removeObstacle(obj);
         if (_sharedObsToNodeMap.count(obj)) {
             _sharedObsToNodeMap.at(obj)->removeFromParent();
@@ -419,6 +848,27 @@ void NetPhysicsController::processPhysObstEvent(const std::shared_ptr<PhysObstEv
         return;
     }
 
+    if (event->getType() == PhysObstEvent::EventType::INPUT) {
+        // Only the owner applies inputs, and only the newest from each sender
+        if (!_world->isOwned(obj)) {
+            return;
+        }
+        auto& stamps = _inputStamps[event->getSourceId()];
+        auto kt = stamps.find(event->getObstacleId());
+        if (kt != stamps.end() && kt->second >= event->getInputTick()) {
+            return;
+        }
+        stamps[event->getObstacleId()] = event->getInputTick();
+        
+        // The owner cannot rewind, so the input applies to the next step
+        b2Body* body = obj->getBody();
+        if (body != nullptr) {
+            body->ApplyForceToCenter(b2Vec2(event->getForce().x,event->getForce().y),true);
+            body->ApplyTorque(event->getTorque(),true);
+        }
+        return;
+    }
+
     obj->setShared(false);
     // ===== BEGIN NON-SHARED BLOCK =====
     switch (event->getType()) {
@@ -482,12 +932,12 @@ void NetPhysicsController::processPhysObstEvent(const std::shared_ptr<PhysObstEv
             }
             break;
         case PhysObstEvent::EventType::OWNER_ACQUIRE:
-            _world->getOwnedObstacles().erase(obj);
+            _world->clearOwnership(obj);
             //CULog("Erased ownership for %llu",event->getObjId());
             break;
         case PhysObstEvent::EventType::OWNER_RELEASE:
             if (_isHost) {
-                _world->getOwnedObstacles().insert(std::make_pair(obj,0));
+                _world->setOwnership(obj,0);
                 //CULog("Regained ownership for %llu",event->getObjId());
             }
         default:
@@ -504,10 +954,33 @@ void NetPhysicsController::processPhysSyncEvent(const std::shared_ptr<PhysSyncEv
     if (event->getSourceId() == "") {
         return; // Ignore physic syncs from self.
     }
+    
+    // Each sender encodes against its own baselines
+    auto jt = _decoders.find(event->getSourceId());
+    if (jt == _decoders.end()) {
+        jt = _decoders.emplace(event->getSourceId(),PhysSyncEvent::Codec()).first;
+        jt->second.setBounds(_world->getBounds());
+    }
+    event->decode(jt->second);
+    
+    // Timestamps are only comparable for the same source
+    Uint64 stamp = event->getEventTimeStamp();
+    Uint64 local = toLocalTick(event->getSourceId(), stamp);
+    auto& stamps = _syncStamps[event->getSourceId()];
     const std::vector<PhysSyncEvent::Parameters>& params = event->getSyncList();
     for (auto it = params.begin(); it != params.end(); it++) {
         PhysSyncEvent::Parameters param = (*it);
         
+        // Unreliable channels may deliver snapshots out of order
+        auto kt = stamps.find(param.obsId);
+        if (kt == stamps.end()) {
+            stamps.emplace(param.obsId,stamp);
+        } else if (kt->second > stamp) {
+            continue;
+        } else {
+            kt->second = stamp;
+        }
+        
         auto obj = _world->getObstacle(param.obsId);
         if (obj == nullptr) {
             //CUAssertLog(obs, "Invalid PhysSyncEvent, obj %llu not found.",param.obsId);
@@ -515,32 +988,76 @@ void NetPhysicsController::processPhysSyncEvent(const std::shared_ptr<PhysSyncEv
             continue;
         }
             
-        float x = param.x;
-        float y = param.y;
-        float angle = param.angle;
-        float vAngular = param.vAngular;
-        float vx = param.vx;
-        float vy = param.vy;
-        float diff = (obj->getPosition() - Vec2(x, y)).length();
-        float angDiff = 10 * abs(obj->getAngle() - angle);
-            
-        int steps = SDL_max(1, SDL_min(30, SDL_max((int)(diff * 30), (int)angDiff)));
-
-        std::shared_ptr<TargetParams> target = std::make_shared<TargetParams>();
-        target->targetVel = Vec2(vx, vy);
-        target->targetAngle = angle;
-        target->targetAngV = vAngular;
-        target->curStep = 0;
-        target->numSteps = steps;
-        target->P0 = obj->getPosition();
-        target->P1 = obj->getPosition() + obj->getLinearVelocity() / 10.f;
-        target->P3 = Vec2(x, y);
-        target->P2 = target->P3 - target->targetVel / 10.f;
+        // Predicted obstacles are corrected by rollback instead
+        auto pt = _predicted.find(obj);
+        if (pt != _predicted.end() && local <= _tick && local+_historySize > _tick) {
+            pt->second.pending = true;
+            pt->second.targetTick = local;
+            pt->second.target = param;
+            continue;
+        }
+        
+        interpolateTo(obj, param);
+    }
+}
 
-        addSyncObject(obj, target);
+/**
+ * Clears the interpolation and priority state of the given slot.
+ *
+ * This should be called when an obstacle leaves the world (as the slot
+ * will be reused by the next obstacle added), or when it should no longer
+ * be interpolated.
+ *
+ * @param slot  The obstacle slot (ignored if negative)
+ */
+void NetPhysicsController::releaseSlot(Sint32 slot) {
+    if (slot < 0) {
+        return;
+    }
+    if (slot < (Sint32)_cache.size() && _cache[slot] != nullptr) {
+        _cache[slot] = nullptr;
+        _itprSlots.erase(std::remove(_itprSlots.begin(), _itprSlots.end(), (Uint32)slot),
+                         _itprSlots.end());
+    }
+    if (slot < (Sint32)_priority.size()) {
+        _priority[slot] = 0;
     }
 }
 
+/**
+ * Starts interpolating the obstacle towards the given snapshot.
+ *
+ * @param obj   The obstacle to interpolate
+ * @param param The snapshot to interpolate towards
+ */
+void NetPhysicsController::interpolateTo(const std::shared_ptr<physics2::Obstacle>& obj,
+                                         const PhysSyncEvent::Parameters& param) {
+    float x = param.x;
+    float y = param.y;
+    // Angles are sent modulo a full turn, so take the nearest equivalent
+    float angle = obj->getAngle()+(float)std::remainder(param.angle-obj->getAngle(),2*M_PI);
+    float vAngular = param.vAngular;
+    float vx = param.vx;
+    float vy = param.vy;
+    float diff = (obj->getPosition() - Vec2(x, y)).length();
+    float angDiff = 10 * abs(obj->getAngle() - angle);
+        
+    int steps = SDL_max(1, SDL_min(30, SDL_max((int)(diff * 30), (int)angDiff)));
+
+    std::shared_ptr<TargetParams> target = std::make_shared<TargetParams>();
+    target->targetVel = Vec2(vx, vy);
+    target->targetAngle = angle;
+    target->targetAngV = vAngular;
+    target->curStep = 0;
+    target->numSteps = steps;
+    target->P0 = obj->getPosition();
+    target->P1 = obj->getPosition() + obj->getLinearVelocity() / 10.f;
+    target->P3 = Vec2(x, y);
+    target->P2 = target->P3 - target->targetVel / 10.f;
+
+    addSyncObject(obj, target);
+}
+
 /**
  * Packs object data for synchronization.
  *
@@ -554,68 +1071,72 @@ void NetPhysicsController::processPhysSyncEvent(const std::shared_ptr<PhysSyncEv
  * @param type  the type of synchronization
  */
 void NetPhysicsController::packPhysSync(SyncType type) {
-    auto event = PhysSyncEvent::alloc();
+    auto event = _syncPool.acquire([]() { return PhysSyncEvent::alloc(); });
+    const auto& slots = _world->getSlots();
     
     switch (type) {
         case SyncType::OVERRIDE_FULL_SYNC:
-            for (auto it = _world->getObstacleMap().begin(); it != _world->getObstacleMap().end(); it++) {
-                Uint64 id = (*it).first;
-                auto obj = (*it).second;
-                if (obj->isShared()) {
-                    event->addObstacle(id,obj);
+            for (Uint32 slot = 0; slot < slots.size(); slot++) {
+                const auto& obj = slots[slot];
+                if (obj != nullptr && obj->isShared()) {
+                    event->addObstacle(_world->getSlotId(slot),obj);
                 }
             }
             break;
         case SyncType::FULL_SYNC:
-        {
-            auto ownership = _world->getOwnedObstacles();
-            for (auto it = _world->getObstacleMap().begin(); it != _world->getObstacleMap().end(); it++) {
-                Uint64 id = (*it).first;
-                auto obj = (*it).second;
-                if (obj->isShared() && ownership.count(obj))
-                    event->addObstacle(id,obj);
+            for (Uint32 slot = 0; slot < slots.size(); slot++) {
+                const auto& obj = slots[slot];
+                if (obj != nullptr && obj->isShared() && _world->isOwned(slot)) {
+                    event->addObstacle(_world->getSlotId(slot),obj);
+                }
             }
-        }
             break;
         case SyncType::PRIO_SYNC:
         {
-            std::vector<Uint64> velQueue;
-            auto objmap = _world->getObstacleMap();
-            for (auto it = objmap.begin(); it != objmap.end(); it++) {
-                Uint64 id = (*it).first;
-                auto obj = (*it).second;
-                if(obj->isShared()) {
-                    velQueue.push_back(id);
+            size_t budget = 0;
+            for(auto it = _peers.begin(); it != _peers.end(); ++it) {
+                if (it->second.budget > 0 && (budget == 0 || it->second.budget < budget)) {
+                    budget = it->second.budget;
                 }
             }
+            if (budget == 0) {
+                budget = _syncBudget;
+            }
             
-            std::sort(velQueue.begin(), velQueue.end(), [this](Uint64 const& l, Uint64 const& r) {
-                auto omap = _world->getObstacleMap();
-                return omap.at(l)->getLinearVelocity().length() > omap.at(r)->getLinearVelocity().length();
-            });
-            
-            size_t defaultPri = 60;
-            size_t numPrioObj = std::min(defaultPri,velQueue.size());
-            
-            
-            for (size_t ii = 0; ii < numPrioObj; ii++) {
-                auto obj = objmap.at(velQueue[ii]);
-                if(obj->isShared()) {
-                    event->addObstacle(velQueue[ii],obj);
+            _candidates.clear();
+            _priority.resize(slots.size(),0);
+            for (Uint32 slot = 0; slot < slots.size(); slot++) {
+                const auto& obj = slots[slot];
+                if (obj != nullptr && obj->isShared() && _world->isOwned(slot)) {
+                    float& priority = _priority[slot];
+                    priority += accruePriority(obj);
+                    _candidates.emplace_back(priority, slot);
                 }
             }
             
-            defaultPri = 20;
-            for (size_t ii = 0; ii < std::min(defaultPri,velQueue.size()); ii++) {
-                // Refactored as obstacles are no longer a vector
-                auto obj = _world->getNextObstacle();
-                event->addObstacle(_world->getObstacleId(obj),obj);
+            // Every entry costs at least two bytes, so only sort what can fit
+            size_t limit = std::min(_candidates.size(), budget/2+1);
+            auto compare = [](const std::pair<float,Uint32>& l, const std::pair<float,Uint32>& r) {
+                return l.first > r.first;
+            };
+            std::nth_element(_candidates.begin(), _candidates.begin()+limit, _candidates.end(), compare);
+            std::sort(_candidates.begin(), _candidates.begin()+limit, compare);
+            
+            size_t used = 0;
+            for (size_t ii = 0; ii < limit && used < budget; ii++) {
+                Uint32 slot = _candidates[ii].second;
+                event->addObstacle(_world->getSlotId(slot),slots[slot]);
+                used += _encoder.estimate(event->getSyncList().back());
+                _priority[slot] = 0;
             }
         }
             break;
     }
     
-    _outEvents.push_back(event);
+    event->encode(_encoder, type == SyncType::OVERRIDE_FULL_SYNC);
+    if (!event->getDeltas().empty()) {
+        _outEvents.push_back(event);
+    }
 }
 
 /**
@@ -628,25 +1149,25 @@ void NetPhysicsController::packPhysSync(SyncType type) {
  */
 
 void NetPhysicsController::packPhysObj() {
-    auto objs = _world->getObstacles();
-    for (auto it = objs.begin(); it != objs.end(); it++) {
-        auto obj = (*it);
-        Uint64 id = _world->getObstacleIds().at(obj);
-        if (obj->isShared()) {
+    const auto& slots = _world->getSlots();
+    for (Uint32 slot = 0; slot < slots.size(); slot++) {
+        const auto& obj = slots[slot];
+        if (obj != nullptr && obj->isShared() && obj->hasDirtySharing()) {
+            Uint64 id = _world->getSlotId(slot);
             if (obj->hasDirtyPosition()) {
-                _outEvents.push_back(PhysObstEvent::allocPos(id,obj->getPosition()));
+                queueObstEvent()->initPos(id,obj->getPosition());
             }
             if (obj->hasDirtyAngle()) {
-				_outEvents.push_back(PhysObstEvent::allocAngle(id,obj->getAngle()));
+				queueObstEvent()->initAngle(id,obj->getAngle());
 			}
             if (obj->hasDirtyVelocity()) {
-				_outEvents.push_back(PhysObstEvent::allocVel(id,obj->getLinearVelocity()));
+				queueObstEvent()->initVel(id,obj->getLinearVelocity());
 			}
             if (obj->hasDirtyAngularVelocity()) {
-				_outEvents.push_back(PhysObstEvent::allocAngularVel(id,obj->getAngularVelocity()));
+				queueObstEvent()->initAngularVel(id,obj->getAngularVelocity());
 			}
             if (obj->hasDirtyType()) {
-                _outEvents.push_back(PhysObstEvent::allocBodyType(id,obj->getBodyType()));
+                queueObstEvent()->initBodyType(id,obj->getBodyType());
             }
             if (obj->hasDirtyBool()) {
                 PhysObstEvent::BoolConsts values;
@@ -656,7 +1177,7 @@ void NetPhysicsController::packPhysObj() {
                 values.isFixedRotation = obj->isFixedRotation();
                 values.isBullet = obj->isBullet();
                 values.isSensor = obj->isSensor();
-				_outEvents.push_back(PhysObstEvent::allocBoolConsts(id,values));
+				queueObstEvent()->initBoolConsts(id,values);
 			}
             if (obj->hasDirtyFloat()) {
                 PhysObstEvent::FloatConsts values;
@@ -669,7 +1190,7 @@ void NetPhysicsController::packPhysObj() {
                 values.mass = obj->getMass();
                 values.inertia = obj->getInertia();
                 values.centroid = obj->getCentroid();
-                _outEvents.push_back(PhysObstEvent::allocFloatConsts(id,values));
+                queueObstEvent()->initFloatConsts(id,values);
             }
             obj->clearSharingDirtyBits();
         }
@@ -685,7 +1206,23 @@ void NetPhysicsController::reset() {
     _stepSum = 0;
     _cache.clear();
     _objRotation = 0;
-    _deleteCache.clear();
+    _itprSlots.clear();
     _outEvents.clear();
     _sharedObsToNodeMap.clear();
+    _encoder.reset();
+    _decoders.clear();
+    _syncStamps.clear();
+    _inputStamps.clear();
+    _clockOffsets.clear();
+    _priority.clear();
+    _predicted.clear();
+    _frozen.clear();
+    _replaying = false;
+    _tick = 0;
+    _rollbackCount = 0;
+    _rollbackSteps = 0;
+    _rollbackMax = 0;
+    _correctionCount = 0;
+    _correctionSum = 0;
+    _correctionMax = 0;
 }
@@ -59,6 +59,7 @@ using namespace cugl::physics2::distrib;
  * the heap, use one of the static constructors instead.
  */
 NetWorld::NetWorld() : ObstacleWorld(),
+_nextSlot(0),
 _nextInitObj(0),
 _nextSharedObj(0),
 _nextInitJoint(0),
@@ -76,9 +77,14 @@ _nextSharedJoint(0) {
  * object owns them.
  */
 void NetWorld::dispose() {
-    _obsToId.clear();
-    _idToObs.clear();
-    _ownedObs.clear();
+    _slots.clear();
+    _slotIds.clear();
+    _slotOwned.clear();
+    _slotDuration.clear();
+    _freeSlots.clear();
+    _idToSlot.clear();
+    _obsToSlot.clear();
+    _nextSlot = 0;
     _jntToId.clear();
     _idToJnt.clear();
     _ownedJoints.clear();
@@ -141,17 +147,21 @@ bool NetWorld::initWithUUID(const Rect bounds, const Vec2 gravity, std::string u
 /**
  * Returns the next obstacle for synchronization
  *
- * This goes around the obstacle set in a round-robin fashion.
+ * This goes around the obstacle table in a round-robin fashion. It
+ * returns nullptr once it reaches the end of the table, and starts over
+ * on the next call.
  *
  * @return the next obstacle for synchronization
  */
 std::shared_ptr<Obstacle> NetWorld::getNextObstacle() {
-    if (_nextObstacle == _obstacles.end()) {
-        return nullptr;
+    while (_nextSlot < _slots.size()) {
+        const std::shared_ptr<Obstacle>& obs = _slots[_nextSlot++];
+        if (obs != nullptr) {
+            return obs;
+        }
     }
-    std::shared_ptr<Obstacle> obs = *_nextObstacle;
-    _nextObstacle++;
-    return obs;
+    _nextSlot = 0;
+    return nullptr;
 }
 
 
@@ -171,12 +181,28 @@ std::shared_ptr<Obstacle> NetWorld::getNextObstacle() {
  */
 void NetWorld::activateObstacle(Uint64 oid, const std::shared_ptr<Obstacle>& obj) {
     CUAssertLog(inBounds(obj.get()), "Obstacle is not in bounds");
-    CUAssertLog(!_idToObs.count(oid), "Duplicate obstacle ids are not allowed");
+    CUAssertLog(!_idToSlot.count(oid), "Duplicate obstacle ids are not allowed");
     _obstacles.emplace(obj);
     obj->activatePhysics(*_world);
-    _idToObs[oid] = obj;
-    _obsToId[obj] = oid;
-    _nextObstacle = _obstacles.find(obj);
+    
+    // Reuse a free slot before growing the table
+    Uint32 slot;
+    if (_freeSlots.empty()) {
+        slot = (Uint32)_slots.size();
+        _slots.push_back(obj);
+        _slotIds.push_back(oid);
+        _slotOwned.push_back(0);
+        _slotDuration.push_back(0);
+    } else {
+        slot = _freeSlots.back();
+        _freeSlots.pop_back();
+        _slots[slot] = obj;
+        _slotIds[slot] = oid;
+        _slotOwned[slot] = 0;
+        _slotDuration[slot] = 0;
+    }
+    _idToSlot[oid] = slot;
+    _obsToSlot[obj.get()] = slot;
 }
 
 /**
@@ -255,13 +281,15 @@ void NetWorld::addObstacle(const std::shared_ptr<Obstacle>& obj) {
  * @param obj The obstacle to remove
  */
 void NetWorld::removeObstacle(const std::shared_ptr<Obstacle>& obj) {
-    auto pos = _obsToId.find(obj);
-    if (pos != _obsToId.end()) {
-        Uint64 oid = pos->second;
-        _obsToId.erase(pos);
-        _idToObs.erase(oid);
-        _ownedObs.erase(obj);
-        _nextObstacle = _obstacles.begin();
+    auto pos = _obsToSlot.find(obj.get());
+    if (pos != _obsToSlot.end()) {
+        Uint32 slot = pos->second;
+        _obsToSlot.erase(pos);
+        _idToSlot.erase(_slotIds[slot]);
+        _slots[slot] = nullptr;
+        _slotOwned[slot] = 0;
+        _slotDuration[slot] = 0;
+        _freeSlots.push_back(slot);
         ObstacleWorld::removeObstacle(obj);
     }
 }
@@ -64,61 +64,88 @@ PhysObstEvent::FloatConsts::FloatConsts() {
  */
 std::vector<std::byte> PhysObstEvent::serialize() {
     _serializer.reset();
-    _serializer.writeUint32((uint32)_type);
-    _serializer.writeUint64(_obstacleId);
+    serializeTo(_serializer);
+    return _serializer.serialize();
+}
+
+/**
+ * Serializes this event to the end of the given serializer.
+ *
+ * This writes the event in place, without an intermediate vector.
+ *
+ * @param out   the serializer to write to
+ */
+void PhysObstEvent::serializeTo(LWSerializer& out) {
+    out.writeUint32((uint32)_type);
+    out.writeUint64(_obstacleId);
     switch (_type) {
         case PhysObstEvent::EventType::CREATION:
-            _serializer.writeUint32(_factoryId);
-            _serializer.writeByteVector(*_packedParam);
+            out.writeUint32(_factoryId);
+            out.writeByteVector(*_packedParam);
             break;
         case PhysObstEvent::EventType::DELETION:
             break;
         case PhysObstEvent::EventType::BODY_TYPE:
-            _serializer.writeUint32(_bodyType);
+            out.writeUint32(_bodyType);
             break;
         case PhysObstEvent::EventType::POSITION:
-            _serializer.writeFloat(_pos.x);
-            _serializer.writeFloat(_pos.y);
+            out.writeFloat(_pos.x);
+            out.writeFloat(_pos.y);
             break;
         case PhysObstEvent::EventType::VELOCITY:
-            _serializer.writeFloat(_vel.x);
-            _serializer.writeFloat(_vel.y);
+            out.writeFloat(_vel.x);
+            out.writeFloat(_vel.y);
             break;
         case PhysObstEvent::EventType::ANGLE:
-            _serializer.writeFloat(_angle);
+            out.writeFloat(_angle);
             break;
         case PhysObstEvent::EventType::ANGULAR_VEL:
-            _serializer.writeFloat(_angularVel);
+            out.writeFloat(_angularVel);
             break;
         case PhysObstEvent::EventType::BOOL_CONSTS:
-            _serializer.writeBool(_isEnabled);
-            _serializer.writeBool(_isAwake);
-            _serializer.writeBool(_isSleepingAllowed);
-            _serializer.writeBool(_isFixedRotation);
-            _serializer.writeBool(_isBullet);
-            _serializer.writeBool(_isSensor);
+            out.writeBool(_isEnabled);
+            out.writeBool(_isAwake);
+            out.writeBool(_isSleepingAllowed);
+            out.writeBool(_isFixedRotation);
+            out.writeBool(_isBullet);
+            out.writeBool(_isSensor);
             break;
         case PhysObstEvent::EventType::FLOAT_CONSTS:
-            _serializer.writeFloat(_density);
-            _serializer.writeFloat(_friction);
-            _serializer.writeFloat(_restitution);
-            _serializer.writeFloat(_linearDamping);
-            _serializer.writeFloat(_angularDamping);
-            _serializer.writeFloat(_gravityScale);
-            _serializer.writeFloat(_mass);
-            _serializer.writeFloat(_inertia);
-            _serializer.writeFloat(_centroid.x);
-            _serializer.writeFloat(_centroid.y);
+            out.writeFloat(_density);
+            out.writeFloat(_friction);
+            out.writeFloat(_restitution);
+            out.writeFloat(_linearDamping);
+            out.writeFloat(_angularDamping);
+            out.writeFloat(_gravityScale);
+            out.writeFloat(_mass);
+            out.writeFloat(_inertia);
+            out.writeFloat(_centroid.x);
+            out.writeFloat(_centroid.y);
             break;
         case PhysObstEvent::EventType::OWNER_ACQUIRE:
-            _serializer.writeUint64(_duration);
+            out.writeUint64(_duration);
             break;
         case PhysObstEvent::EventType::OWNER_RELEASE:
             break;
+        case PhysObstEvent::EventType::INPUT:
+            out.writeUint64(_inputTick);
+            out.writeFloat(_force.x);
+            out.writeFloat(_force.y);
+            out.writeFloat(_torque);
+            break;
         default:
             CUAssertLog(false, "Serializing invalid obstacle event type");
     }
-    return _serializer.serialize();
+}
+
+/**
+ * Returns true if this event was reset so that it can be reused.
+ *
+ * @return true if this event was reset so that it can be reused.
+ */
+bool PhysObstEvent::recycle() {
+    _packedParam = nullptr;
+    return true;
 }
 
 /**
@@ -127,16 +154,32 @@ std::vector<std::byte> PhysObstEvent::serialize() {
  * This method will set the type of the event and all relevant fields.
  */
 void PhysObstEvent::deserialize(const std::vector<std::byte>& data) {
-    if (data.size() < sizeof(Uint32) + sizeof(Uint64))
+    deserializeBytes(data.data(), data.size());
+}
+
+/**
+ * Deserializes this event from a range of bytes.
+ *
+ * This method will set the type of the event and all relevant fields.
+ * It reads the bytes in place, without copying them.
+ *
+ * @param data  the start of the serialized bytes
+ * @param size  the number of serialized bytes
+ */
+void PhysObstEvent::deserializeBytes(const std::byte* data, size_t size) {
+    if (size < sizeof(Uint32) + sizeof(Uint64))
         return;
     _deserializer.reset();
-    _deserializer.receive(data);
+    _deserializer.receive(data, size);
     _type = (EventType)_deserializer.readUint32();
     _obstacleId = _deserializer.readUint64();
     switch (_type) {
         case PhysObstEvent::EventType::CREATION:
             _factoryId = _deserializer.readUint32();
-            _packedParam = std::make_shared<std::vector<std::byte>>(data.begin() + 2 * sizeof(Uint32) + sizeof(Uint64), data.end());
+            _packedParam = std::make_shared<std::vector<std::byte>>();
+            if (size > 2 * sizeof(Uint32) + sizeof(Uint64)) {
+                _packedParam->assign(data + 2 * sizeof(Uint32) + sizeof(Uint64), data + size);
+            }
             break;
         case PhysObstEvent::EventType::DELETION:
             break;
@@ -182,6 +225,12 @@ void PhysObstEvent::deserialize(const std::vector<std::byte>& data) {
             break;
         case PhysObstEvent::EventType::OWNER_RELEASE:
             break;
+        case PhysObstEvent::EventType::INPUT:
+            _inputTick = _deserializer.readUint64();
+            _force.x = _deserializer.readFloat();
+            _force.y = _deserializer.readFloat();
+            _torque = _deserializer.readFloat();
+            break;
         default:
             CUAssertLog(false, "Deserializing invalid obstacle event type");
     }
@@ -3,7 +3,9 @@
 //  Cornell University Game Library (CUGL)
 //
 //  This module provides events for physics synchronization, which are handled
-//  by the NetEventController internally.
+//  by the NetEventController internally. Snapshots are quantized against the
+//  world bounds and delta encoded against the previous snapshot of the same
+//  obstacle, so that a resting obstacle costs (almost) nothing to send.
 //
 //  CUGL MIT License:
 //      This software is provided 'as-is', without any express or implied
@@ -28,11 +30,87 @@
 //  Version: 7/3/24 (CUGL 3.0 reorganization)
 //
 #include <cugl/physics2/distrib/CUPhysSyncEvent.h>
+#include <algorithm>
+#include <cmath>
 
 using namespace cugl;
 using namespace cugl::physics2;
 using namespace cugl::physics2::distrib;
 
+/** The flag marking a delta as an absolute keyframe */
+#define KEY_FLAG        0x80
+/** The flags for a delta with all fields present */
+#define ALL_FIELDS      0x3F
+/** The number of quantized fields in a snapshot */
+#define NUM_FIELDS      6
+/** The index of the angle field */
+#define ANGLE_FIELD     4
+/** The number of position steps across the world */
+#define POS_STEPS       (1 << 20)
+/** The number of velocity steps per second across the world */
+#define VEL_STEPS       (1 << 14)
+/** The number of angle steps in a full turn */
+#define ANGLE_STEPS     (1 << 16)
+/** The number of angular velocity steps per turn per second */
+#define SPIN_STEPS      (1 << 12)
+/** The default number of encodes between keyframes */
+#define DEFAULT_REFRESH 30
+/** A full turn in radians */
+#define TWO_PI          6.28318530717958647692f
+
+/**
+ * Returns the zigzag encoding of a signed value.
+ *
+ * Zigzag encoding interleaves negative and positive values so that values
+ * of small magnitude become small unsigned varints.
+ *
+ * @param value The signed value
+ *
+ * @return the zigzag encoding of a signed value.
+ */
+static Uint32 zigzag(Sint32 value) {
+    return ((Uint32)value << 1) ^ (Uint32)(value >> 31);
+}
+
+/**
+ * Returns the signed value of a zigzag encoding.
+ *
+ * @param value The zigzag encoding
+ *
+ * @return the signed value of a zigzag encoding.
+ */
+static Sint32 unzigzag(Uint32 value) {
+    return (Sint32)(value >> 1) ^ -(Sint32)(value & 1);
+}
+
+/**
+ * Returns the number of bytes in the varint encoding of a value.
+ *
+ * @param value The unsigned value
+ *
+ * @return the number of bytes in the varint encoding of a value.
+ */
+static size_t varintSize(Uint32 value) {
+    size_t result = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        result++;
+    }
+    return result;
+}
+
+/**
+ * Returns the value rounded to the nearest step.
+ *
+ * @param value The value to quantize
+ * @param step  The step size
+ *
+ * @return the value rounded to the nearest step.
+ */
+static Sint32 quantizeValue(float value, float step) {
+    return (Sint32)std::lround(value/step);
+}
+
 /** Creates a new parameter set with default values */
 PhysSyncEvent::Parameters::Parameters() {
     obsId = 0;
@@ -44,6 +122,223 @@ PhysSyncEvent::Parameters::Parameters() {
     vAngular = 0;
 }
 
+/** Creates a new delta with no fields present */
+PhysSyncEvent::Delta::Delta() {
+    obsId = 0;
+    flags = 0;
+    std::fill(values, values+NUM_FIELDS, 0);
+}
+
+#pragma mark -
+#pragma mark Codec
+/**
+ * Creates a new codec with unit bounds and no baselines.
+ */
+PhysSyncEvent::Codec::Codec() :
+_posStep(1.0f/POS_STEPS),
+_velStep(1.0f/VEL_STEPS),
+_refresh(DEFAULT_REFRESH),
+_absolute(false) {
+}
+
+/**
+ * Sets the world bounds for quantization.
+ *
+ * This clears all baselines, as they are no longer comparable.
+ *
+ * @param bounds    The world bounds
+ */
+void PhysSyncEvent::Codec::setBounds(const Rect& bounds) {
+    float extent = std::max(bounds.size.width,bounds.size.height);
+    if (extent <= 0) {
+        extent = 1;
+    }
+    _origin = bounds.origin;
+    _posStep = extent/POS_STEPS;
+    _velStep = extent/VEL_STEPS;
+    _baselines.clear();
+}
+
+/**
+ * Quantizes the given snapshot into the array of values.
+ *
+ * @param param     The snapshot to quantize
+ * @param values    The array to store the quantized values
+ */
+void PhysSyncEvent::Codec::quantize(const Parameters& param, Sint32* values) const {
+    values[0] = quantizeValue(param.x-_origin.x, _posStep);
+    values[1] = quantizeValue(param.y-_origin.y, _posStep);
+    values[2] = quantizeValue(param.vx, _velStep);
+    values[3] = quantizeValue(param.vy, _velStep);
+    values[4] = quantizeValue(param.angle, TWO_PI/ANGLE_STEPS) & (ANGLE_STEPS-1);
+    values[5] = quantizeValue(param.vAngular, TWO_PI/SPIN_STEPS);
+}
+
+/**
+ * Restores a snapshot from the array of quantized values.
+ *
+ * @param values    The quantized values
+ * @param param     The snapshot to store the result
+ */
+void PhysSyncEvent::Codec::dequantize(const Sint32* values, Parameters& param) const {
+    param.x = values[0]*_posStep+_origin.x;
+    param.y = values[1]*_posStep+_origin.y;
+    param.vx = values[2]*_velStep;
+    param.vy = values[3]*_velStep;
+    param.angle = values[4]*(TWO_PI/ANGLE_STEPS);
+    param.vAngular = values[5]*(TWO_PI/SPIN_STEPS);
+}
+
+/**
+ * Returns the approximate number of bytes to send the given snapshot.
+ *
+ * This method does not change the baselines. It returns 0 if the
+ * snapshot would be omitted by the next encode. The estimate assumes
+ * the id gap fits in a single byte.
+ *
+ * @param param The snapshot to measure
+ *
+ * @return the approximate number of bytes to send the given snapshot.
+ */
+size_t PhysSyncEvent::Codec::estimate(const Parameters& param) const {
+    Sint32 values[NUM_FIELDS];
+    quantize(param, values);
+    
+    // The id gap and the flags
+    size_t result = 2;
+    auto jt = _baselines.find(param.obsId);
+    if (jt == _baselines.end() || jt->second.age+1 >= _refresh) {
+        for(int ii = 0; ii < NUM_FIELDS; ii++) {
+            result += varintSize(zigzag(values[ii]));
+        }
+        return result;
+    }
+    
+    bool changed = false;
+    size_t absolute = result;
+    for(int ii = 0; ii < NUM_FIELDS; ii++) {
+        Sint32 diff = values[ii]-jt->second.values[ii];
+        if (ii == ANGLE_FIELD) {
+            diff = (Sint16)diff;
+        }
+        if (diff != 0) {
+            result += varintSize(zigzag(diff));
+            changed = true;
+        }
+        absolute += varintSize(zigzag(values[ii]));
+    }
+    if (!changed) {
+        return 0;
+    }
+    return _absolute ? absolute : result;
+}
+
+/**
+ * Encodes the snapshots as deltas against the current baselines.
+ *
+ * The deltas are sorted by obstacle id, and unchanged obstacles are
+ * omitted (unless a keyframe is due). The baselines are updated to
+ * the new snapshots. If key is true, every snapshot is encoded as an
+ * absolute keyframe. In absolute mode, every changed snapshot is encoded
+ * as a keyframe.
+ *
+ * @param params    The snapshots to encode
+ * @param deltas    The vector to store the encoded deltas
+ * @param key       Whether to force keyframes
+ */
+void PhysSyncEvent::Codec::encode(const std::vector<Parameters>& params,
+                                  std::vector<Delta>& deltas, bool key) {
+    deltas.clear();
+    deltas.reserve(params.size());
+    for (auto it = params.begin(); it != params.end(); it++) {
+        Delta delta;
+        delta.obsId = it->obsId;
+        Sint32 values[NUM_FIELDS];
+        quantize(*it, values);
+        
+        bool keyframe = key;
+        auto jt = _baselines.find(it->obsId);
+        if (jt == _baselines.end()) {
+            // Stagger the keyframes so they do not all land on one tick
+            jt = _baselines.emplace(it->obsId, Baseline()).first;
+            jt->second.age = (Uint32)(it->obsId % std::max(_refresh,1u));
+            keyframe = true;
+        } else if (++jt->second.age >= _refresh) {
+            jt->second.age = 0;
+            keyframe = true;
+        }
+        
+        Baseline& base = jt->second;
+        if (keyframe) {
+            delta.flags = KEY_FLAG | ALL_FIELDS;
+            std::copy(values, values+NUM_FIELDS, delta.values);
+        } else {
+            for(int ii = 0; ii < NUM_FIELDS; ii++) {
+                Sint32 diff = values[ii]-base.values[ii];
+                if (ii == ANGLE_FIELD) {
+                    diff = (Sint16)diff;
+                }
+                if (diff != 0) {
+                    delta.flags |= (1 << ii);
+                    delta.values[ii] = diff;
+                }
+            }
+            if (delta.flags == 0) {
+                continue;
+            } else if (_absolute) {
+                delta.flags = KEY_FLAG | ALL_FIELDS;
+                std::copy(values, values+NUM_FIELDS, delta.values);
+            }
+        }
+        std::copy(values, values+NUM_FIELDS, base.values);
+        deltas.push_back(delta);
+    }
+    std::sort(deltas.begin(), deltas.end(), [](const Delta& a, const Delta& b) {
+        return a.obsId < b.obsId;
+    });
+}
+
+/**
+ * Decodes the deltas against the current baselines.
+ *
+ * The baselines are updated to the decoded snapshots. A delta for an
+ * obstacle with no baseline cannot be decoded, and is skipped.
+ *
+ * @param deltas    The deltas to decode
+ * @param params    The vector to store the decoded snapshots
+ */
+void PhysSyncEvent::Codec::decode(const std::vector<Delta>& deltas,
+                                  std::vector<Parameters>& params) {
+    params.clear();
+    params.reserve(deltas.size());
+    for (auto it = deltas.begin(); it != deltas.end(); it++) {
+        Baseline* base = nullptr;
+        if (it->flags & KEY_FLAG) {
+            base = &_baselines[it->obsId];
+            std::copy(it->values, it->values+NUM_FIELDS, base->values);
+        } else {
+            auto jt = _baselines.find(it->obsId);
+            if (jt == _baselines.end()) {
+                continue;
+            }
+            base = &(jt->second);
+            for(int ii = 0; ii < NUM_FIELDS; ii++) {
+                if (it->flags & (1 << ii)) {
+                    base->values[ii] += it->values[ii];
+                }
+            }
+            base->values[ANGLE_FIELD] &= (ANGLE_STEPS-1);
+        }
+        
+        Parameters param;
+        param.obsId = it->obsId;
+        dequantize(base->values, param);
+        params.push_back(param);
+    }
+}
+
+#pragma mark -
+#pragma mark PhysSyncEvent
 /**
  * Snapshots an obstacle's current position and velocity.
  *
@@ -69,49 +364,96 @@ void PhysSyncEvent::addObstacle(Uint64 id, const std::shared_ptr<physics2::Obsta
 }
 
 /**
- * Returns a byte vector serializing the current list of snapshots.
+ * Returns a byte vector serializing the encoded snapshots.
  *
- * @return a byte vector serializing the current list of snapshots.
+ * Snapshots that have not been encoded (see {@link #encode}) are not
+ * serialized.
+ *
+ * @return a byte vector serializing the encoded snapshots.
  */
 std::vector<std::byte> PhysSyncEvent::serialize() {
     _serializer.reset();
-    _serializer.writeUint64((Uint64)_syncList.size());
-    for (auto it = _syncList.begin(); it != _syncList.end(); it++) {
-        Parameters& obj = (*it);
-        _serializer.writeUint64(obj.obsId);
-        _serializer.writeFloat(obj.x);
-        _serializer.writeFloat(obj.y);
-        _serializer.writeFloat(obj.vx);
-        _serializer.writeFloat(obj.vy);
-        _serializer.writeFloat(obj.angle);
-        _serializer.writeFloat(obj.vAngular);
-    }
+    serializeTo(_serializer);
     return _serializer.serialize();
 }
 
 /**
- * Unpacks a byte vector into a list of snapshots.
+ * Serializes the encoded snapshots to the end of the given serializer.
+ *
+ * This writes the snapshots in place, without an intermediate vector.
+ *
+ * @param out   the serializer to write to
+ */
+void PhysSyncEvent::serializeTo(LWSerializer& out) {
+    out.writeVarint((Uint64)_deltas.size());
+    Uint64 prev = 0;
+    for (auto it = _deltas.begin(); it != _deltas.end(); it++) {
+        // Deltas are sorted, so ids are sent as (small) gaps
+        out.writeVarint(it->obsId-prev);
+        out.writeByte(std::byte(it->flags));
+        for(int ii = 0; ii < NUM_FIELDS; ii++) {
+            if (it->flags & (1 << ii)) {
+                out.writeVarint(zigzag(it->values[ii]));
+            }
+        }
+        prev = it->obsId;
+    }
+}
+
+/**
+ * Returns true if this event was reset so that it can be reused.
  *
- * These snapshots can then be used in physics synchronizations.
+ * @return true if this event was reset so that it can be reused.
+ */
+bool PhysSyncEvent::recycle() {
+    _syncList.clear();
+    _deltas.clear();
+    _obsSet.clear();
+    return true;
+}
+
+/**
+ * Unpacks a byte vector into a list of encoded snapshots.
+ *
+ * These snapshots must be decoded (see {@link #decode}) before they can
+ * be used in physics synchronizations.
  *
  * @param data the byte vector to deserialize
  */
 void PhysSyncEvent::deserialize(const std::vector<std::byte>& data) {
-    if (data.size() < 4)
+    deserializeBytes(data.data(), data.size());
+}
+
+/**
+ * Unpacks a range of bytes into a list of encoded snapshots.
+ *
+ * This method reads the bytes in place, without copying them. These
+ * snapshots must be decoded (see {@link #decode}) before they can be used
+ * in physics synchronizations.
+ *
+ * @param data  the start of the serialized bytes
+ * @param size  the number of serialized bytes
+ */
+void PhysSyncEvent::deserializeBytes(const std::byte* data, size_t size) {
+    if (size == 0)
         return;
     
     _deserializer.reset();
-    _deserializer.receive(data);
-    Uint64 numObjs = _deserializer.readUint64();
-    for (size_t i = 0; i < numObjs; i++) {
-        Parameters param;
-        param.obsId = _deserializer.readUint64();
-        param.x = _deserializer.readFloat();
-        param.y = _deserializer.readFloat();
-        param.vx = _deserializer.readFloat();
-        param.vy = _deserializer.readFloat();
-        param.angle = _deserializer.readFloat();
-        param.vAngular = _deserializer.readFloat();
-        _syncList.push_back(param);
+    _deserializer.receive(data, size);
+    Uint64 numObjs = _deserializer.readVarint();
+    // Every delta takes at least two bytes
+    _deltas.reserve(std::min((size_t)numObjs,size/2));
+    Uint64 prev = 0;
+    for (size_t i = 0; i < numObjs && _deserializer.available(); i++) {
+        Delta delta;
+        delta.obsId = prev+_deserializer.readVarint();
+        delta.flags = (Uint8)_deserializer.readByte();
+        for(int ii = 0; ii < NUM_FIELDS; ii++) {
+            if (delta.flags & (1 << ii)) {
+                delta.values[ii] = unzigzag((Uint32)_deserializer.readVarint());
+            }
+        }
+        prev = delta.obsId;
+        _deltas.push_back(delta);
     }
 }
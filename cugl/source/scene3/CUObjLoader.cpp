@@ -516,12 +516,11 @@ bool ObjLoader::read(const std::string key, const std::string source,
         }
         _queue.erase(key);
     } else {
-        _loader->addTask([=](void) {
-            this->enqueue(key);
+        enqueue(key);
+        addTask([=](void) {
             std::shared_ptr<ObjModel> model = this->preload(key,source);
-            Application::get()->schedule([=](void){
+            this->defer([=](void){
                 this->materialize(key,model,callback);
-                return false;
             });
         });
     }
@@ -592,12 +591,11 @@ bool ObjLoader::read(const std::shared_ptr<JsonValue>& json,
         }
         _queue.erase(key);
     } else {
-        _loader->addTask([=](void) {
-            this->enqueue(key);
+        enqueue(key);
+        addTask([=](void) {
             std::shared_ptr<ObjModel> model = this->preload(json);
-            Application::get()->schedule([=](void){
+            this->defer([=](void){
                 this->materialize(key,model,callback);
-                return false;
             });
         });
     }
@@ -233,14 +233,13 @@ bool Scene3Loader::read(const std::string key, const std::string source,
             _queue.erase(key);
         }
     } else {
-        _loader->addTask([=](void) {
-            this->enqueue(key);
+        enqueue(key);
+        addTask([=](void) {
             std::shared_ptr<JsonReader> reader = JsonReader::allocWithAsset(path);
             std::shared_ptr<JsonValue> json = (reader == nullptr ? nullptr : reader->readJson());
             std::shared_ptr<scene3::SceneNode> node = build(key,json);
-            Application::get()->schedule([=](void) {
+            this->defer([=](void) {
                 this->materialize(node,callback);
-                return false;
             });
         });
     }
@@ -291,12 +290,11 @@ bool Scene3Loader::read(const std::shared_ptr<JsonValue>& json, LoaderCallback c
             _queue.erase(key);
         }
     } else {
-        _loader->addTask([=](void) {
-            this->enqueue(key);
+        enqueue(key);
+        addTask([=](void) {
             std::shared_ptr<scene3::SceneNode> node = build(key,json);
-            Application::get()->schedule([=](void) {
+            this->defer([=](void) {
                 this->materialize(node,callback);
-                return false;
             });
         });
     }
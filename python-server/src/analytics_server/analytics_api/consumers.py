@@ -9,6 +9,7 @@ Version: 12/21/24
 import json
 from analytics_server.analytics_api.models import Organization, Game, User, Session, Task, TaskAttempt, Action
 from analytics_server.analytics_api.serializers import OrganizationSerializer, GameSerializer, UserSerializer, SessionSerializer, TaskSerializer, TaskAttemptSerializer, ActionSerializer
+from analytics_server.analytics_api.wire import Decoder, WireError, is_binary
 from channels.generic.websocket import WebsocketConsumer
 from django.utils.timezone import now
 import logging
@@ -17,6 +18,30 @@ import logging
 logger = logging.getLogger('django')
 
 
+def merge_patch(target, patch):
+    """
+    Returns the result of applying a JSON merge patch (RFC 7396) to target
+
+    :param target:      The JSON value to patch
+    :type target:       ``any``
+
+    :param patch:       The merge patch
+    :type patch:        ``any``
+
+    :return:            The patched JSON value
+    :rtype:             ``any``
+    """
+    if not isinstance(patch, dict):
+        return patch
+    result = dict(target) if isinstance(target, dict) else {}
+    for key, value in patch.items():
+        if value is None:
+            result.pop(key, None)
+        else:
+            result[key] = merge_patch(result.get(key), value)
+    return result
+
+
 class MainConsumer(WebsocketConsumer):
     """
     The main consumer class that handles all websocket connections
@@ -32,6 +57,7 @@ class MainConsumer(WebsocketConsumer):
         self.game = None
         self.user = None
         self.session = None
+        self.decoder = Decoder()
 
     def disconnect(self, close_code):
         """
@@ -64,11 +90,13 @@ class MainConsumer(WebsocketConsumer):
 
         Messages can be received in text or bytes form. The message should be
         formatted with the following fields, along with specific fields for
-        the chosen message type which is defined in later functions.
+        the chosen message type which is defined in later functions. If the
+        client requested it in its `init` message, bytes may also use the
+        binary wire format (see wire.py), which decodes to the same fields.
 
         Message format:
         {
-            "message_type" : <init|task|task_attempt|sync_task_attempt|action>,
+            "message_type" : <init|task|task_attempt|sync_task_attempt|action|batch>,
             "message_payload": {
                 <message_type specific fields>
             }
@@ -83,10 +111,29 @@ class MainConsumer(WebsocketConsumer):
         if text_data:
             self.is_bytes = False
             payload = json.loads(text_data)
+        elif is_binary(bytes_data):
+            self.is_bytes = True
+            try:
+                payload = self.decoder.decode(bytes_data)
+            except (WireError, UnicodeDecodeError, ValueError) as error:
+                self.send_formatted(text_data=json.dumps({"error": f"Invalid binary message: {error}. Not processing request."}))
+                return
+            if payload is None:
+                # Dictionary updates have no response
+                return
         else:
             self.is_bytes = True
             payload = json.loads(bytes_data.decode("utf-8").strip())
         logger.info(payload)
+        self.dispatch_message(payload)
+
+    def dispatch_message(self, payload):
+        """
+        Routes a single decoded message to the handler for its type
+
+        :param payload:     Dictionary with the message_type and message_payload fields
+        :type payload:      ``dict``
+        """
         missing_fields, fields = self.check_fields(payload, ["message_type", "message_payload"])
         if missing_fields:
             self.send_formatted(text_data=json.dumps({"error": f"Missing fields: {fields}. Not processing request."}))
@@ -103,6 +150,8 @@ class MainConsumer(WebsocketConsumer):
                 self.handle_sync_task_attempt(payload["message_payload"])
             case "action":
                 self.handle_action(payload["message_payload"])
+            case "batch":
+                self.handle_batch(payload["message_payload"])
 
     def handle_init(self, payload):
         """
@@ -112,13 +161,24 @@ class MainConsumer(WebsocketConsumer):
         in the database. It is fully idempotent, so it is safe to
         send this message on every game startup.
 
+        If the optional `binary` field is true, the response also has
+        `"binary": true`, telling the client that it may send the binary
+        wire format on this connection. Older clients omit the field and
+        only ever send JSON.
+
+        Similarly, if the optional `delta` field is true, the response also
+        has `"delta": true`, telling the client that it may send statistics
+        patches in `sync_task_attempt` messages.
+
         Payload format:
         {
             "organization_name": str,
             "game_name": str,
             "verison_number": str,
             "vendor_id": str,
-            "platform": str
+            "platform": str,
+            "binary": bool (optional),
+            "delta": bool (optional)
         }
 
         :param payload:     Dictionary with init-specific fields
@@ -155,14 +215,19 @@ class MainConsumer(WebsocketConsumer):
         self.organization = organization
         self.game = game
         self.user = user
-        self.send_formatted(text_data=json.dumps({"message": "Init recorded",
-                                                  "data": {
-                                                        "organization": serialized_organization,
-                                                        "game": serialized_game,
-                                                        "user": serialized_user,
-                                                        "session": serialized_session
-                                                        }
-                                                  }))
+        response = {"message": "Init recorded",
+                    "data": {
+                        "organization": serialized_organization,
+                        "game": serialized_game,
+                        "user": serialized_user,
+                        "session": serialized_session
+                        }
+                    }
+        if payload.get("binary") is True:
+            response["binary"] = True
+        if payload.get("delta") is True:
+            response["delta"] = True
+        self.send_formatted(text_data=json.dumps(response))
 
     def handle_task(self, payload):
         """
@@ -255,18 +320,31 @@ class MainConsumer(WebsocketConsumer):
         allow updating the state if the state is terminal. This method is useful
         for updating aggregate statistics, num_failures, and task_attempt states.
 
+        Instead of the full statistics, a message may have a `patch`, which is
+        a JSON merge patch (RFC 7396) to the stored statistics. A patch must
+        have the version that follows the stored statistics version. Otherwise
+        an earlier sync was lost, and the error response has `"resync": true`
+        so that the client sends the full statistics again. Messages with the
+        full statistics set the version if they have one.
+
         Payload format:
         {
             "task_attempt_uuid": str,
             "status": <"not_started" | "pending" | "suceeded" | "failed" | "preempted">,
-            "statistics": <json_blob>,
-            "num_failures": int
+            "statistics": <json_blob> (or "patch": <json_blob>),
+            "num_failures": int,
+            "version": int (optional, required for a patch)
         }
 
         :param payload:     Dictionary with task_attempt-specific fields
         :type payload:      ``dict``
         """
-        missing_fields, fields = self.check_fields(payload, ["task_attempt_uuid", "status", "statistics", "num_failures"])
+        required = ["task_attempt_uuid", "status", "num_failures"]
+        if "patch" in payload:
+            required += ["patch", "version"]
+        else:
+            required.append("statistics")
+        missing_fields, fields = self.check_fields(payload, required)
         if missing_fields:
             self.send_formatted(text_data=json.dumps({"error": f"Missing fields: {fields}. Not processing request."}))
             return
@@ -283,8 +361,20 @@ class MainConsumer(WebsocketConsumer):
             self.send_formatted(text_data=json.dumps({"error": f"Can not change already ended Task Attempt status: {task_attempt.status} != {payload['status']}. Not processing request."}))
             return
 
+        if "patch" in payload:
+            if payload["version"] != task_attempt.statistics_version + 1:
+                self.send_formatted(text_data=json.dumps({"error": f"Task Attempt version gap: {task_attempt.statistics_version} + 1 != {payload['version']}. Not processing request.",
+                                                          "resync": True,
+                                                          "task_attempt_uuid": payload["task_attempt_uuid"],
+                                                          "version": payload["version"]}))
+                return
+            task_attempt.statistics = merge_patch(task_attempt.statistics, payload["patch"])
+        else:
+            task_attempt.statistics = payload["statistics"]
+        if "version" in payload:
+            task_attempt.statistics_version = payload["version"]
+
         task_attempt.status = payload["status"]
-        task_attempt.statistics = payload["statistics"]
         task_attempt.num_failures = payload["num_failures"]
         if payload["status"] in ["succeeded", "failed", "preempted"]:
             task_attempt.ended_at = now()
@@ -336,6 +426,34 @@ class MainConsumer(WebsocketConsumer):
         serialized_action = dict(ActionSerializer(action).data)
         self.send_formatted(text_data=json.dumps({"message": "Action recorded", "data": serialized_action}))
 
+    def handle_batch(self, payload):
+        """
+        Helper function for handling `batch` messages
+
+        These messages are sent by clients that coalesce several messages
+        into a single websocket frame. Each element of the list is a complete
+        message (with its own message_type and message_payload), and they are
+        processed in order. Batches may not be nested.
+
+        Payload format:
+        {
+            "messages": [<message>]
+        }
+
+        :param payload:     Dictionary with batch-specific fields
+        :type payload:      ``dict``
+        """
+        missing_fields, fields = self.check_fields(payload, ["messages"])
+        if missing_fields:
+            self.send_formatted(text_data=json.dumps({"error": f"Missing fields: {fields}. Not processing request."}))
+            return
+
+        for message in payload["messages"]:
+            if not isinstance(message, dict) or message.get("message_type") == "batch":
+                self.send_formatted(text_data=json.dumps({"error": "Invalid batched message. Not processing message."}))
+                continue
+            self.dispatch_message(message)
+
     def check_fields(self, payload, fields):
         """
         Checks that the given payload has all of the required fields
@@ -0,0 +1,18 @@
+# Generated by Django 4.2.16 on 2025-01-15 12:00
+
+from django.db import migrations, models
+
+
+class Migration(migrations.Migration):
+
+    dependencies = [
+        ('analytics_api', '0001_initial'),
+    ]
+
+    operations = [
+        migrations.AddField(
+            model_name='taskattempt',
+            name='statistics_version',
+            field=models.IntegerField(default=0),
+        ),
+    ]
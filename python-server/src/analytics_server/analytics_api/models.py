@@ -208,6 +208,9 @@ class TaskAttempt(models.Model):
     # A JSON blob of miscellaneous data recorded during the task attempt
     statistics = models.JSONField(default=dict)
 
+    # The version of the statistics (incremented by every versioned sync)
+    statistics_version = models.IntegerField(default=0)
+
 
 class Action(models.Model):
     """
@@ -0,0 +1,285 @@
+"""
+Decoder for the binary analytics wire format
+
+Binary messages are written by the CUGL NetcodeSerializer. Every value is
+prefixed by a one byte type tag and numbers are in network (big-endian)
+order. Repeated strings are sent as references into a per-connection
+dictionary, which the client fills with `dictionary` messages before
+they are used. See AnalyticsCodec in CUGL for the encoder.
+
+Author:  Kidus Zegeye
+Version: 1/15/25
+"""
+import json
+import struct
+
+# NetcodeSerializer type tags
+NONE_TYPE = 0
+BOOLEAN_TRUE = 1
+BOOLEAN_FALSE = 2
+FLOAT_TYPE = 3
+DOUBLE_TYPE = 4
+UINT32_TYPE = 5
+SINT32_TYPE = 6
+UINT64_TYPE = 7
+SINT64_TYPE = 8
+STRING_TYPE = 9
+JSON_TYPE = 10
+ARRAY_TYPE = 127
+
+# Analytics message codes
+CODE_TASK = 1
+CODE_TASK_ATTEMPT = 2
+CODE_SYNC_TASK_ATTEMPT = 3
+CODE_ACTION = 4
+CODE_BATCH = 5
+CODE_DICTIONARY = 6
+CODE_JSON = 7
+CODE_SYNC_TASK_PATCH = 8
+
+# The largest dictionary a client may create
+MAX_DICTIONARY = 65536
+
+
+def is_binary(data):
+    """
+    Returns true if the given frame is a binary analytics message
+
+    JSON messages always start with an open brace, while binary messages
+    start with the type tag of their message code.
+
+    :param data:    The received frame
+    :type data:     ``bytes``
+
+    :return:        True if the given frame is a binary analytics message
+    :rtype:         ``bool``
+    """
+    return len(data) > 0 and data[0] == UINT32_TYPE
+
+
+class WireError(ValueError):
+    """
+    The error raised when a binary message is corrupt
+    """
+    pass
+
+
+class Decoder:
+    """
+    Decodes binary messages into the same dictionaries as the JSON format
+
+    A decoder holds the dictionary for a single connection, so there
+    should be one decoder per websocket.
+    """
+    def __init__(self):
+        self.strings = []
+        self.data = b""
+        self.pos = 0
+
+    def decode(self, data):
+        """
+        Decodes a single binary frame
+
+        `dictionary` messages only update the decoder, and return None.
+        Every other message returns a dictionary with the message_type
+        and message_payload fields.
+
+        :param data:    The received frame
+        :type data:     ``bytes``
+
+        :return:        The decoded message, or None
+        :rtype:         ``dict``
+        """
+        self.data = data
+        self.pos = 0
+        result = self.read_message(nested=False)
+        if self.pos != len(self.data):
+            raise WireError("Trailing bytes after message")
+        return result
+
+    def tag(self):
+        """
+        Returns the type tag of the next value
+        """
+        if self.pos >= len(self.data):
+            raise WireError("Message ended early")
+        return self.data[self.pos]
+
+    def expect(self, tag):
+        """
+        Consumes the type tag of the next value, checking that it matches
+        """
+        if self.tag() != tag:
+            raise WireError(f"Expected type {tag}, found {self.tag()}")
+        self.pos += 1
+
+    def unpack(self, fmt, size):
+        """
+        Consumes and returns a fixed size value in network order
+        """
+        if self.pos + size > len(self.data):
+            raise WireError("Message ended early")
+        value = struct.unpack_from(fmt, self.data, self.pos)[0]
+        self.pos += size
+        return value
+
+    def read_bool(self):
+        """
+        Reads a boolean (encoded entirely in its type tag)
+        """
+        tag = self.tag()
+        if tag != BOOLEAN_TRUE and tag != BOOLEAN_FALSE:
+            raise WireError(f"Expected a boolean, found {tag}")
+        self.pos += 1
+        return tag == BOOLEAN_TRUE
+
+    def read_uint32(self):
+        """
+        Reads an unsigned 32 bit integer
+        """
+        self.expect(UINT32_TYPE)
+        return self.unpack(">I", 4)
+
+    def read_sint32(self):
+        """
+        Reads a signed 32 bit integer
+        """
+        self.expect(SINT32_TYPE)
+        return self.unpack(">i", 4)
+
+    def read_uint64(self):
+        """
+        Reads an unsigned 64 bit integer
+        """
+        self.expect(UINT64_TYPE)
+        return self.unpack(">Q", 8)
+
+    def read_string(self):
+        """
+        Reads a UTF-8 string
+        """
+        self.expect(STRING_TYPE)
+        size = self.read_uint64()
+        if self.pos + size > len(self.data):
+            raise WireError("Message ended early")
+        value = self.data[self.pos:self.pos + size].decode("utf-8")
+        self.pos += size
+        return value
+
+    def read_uuid(self):
+        """
+        Reads a UUID stored as 16 raw bytes, returning its canonical string form
+        """
+        high = self.read_uint64()
+        low = self.read_uint64()
+        text = f"{high:016x}{low:016x}"
+        return f"{text[0:8]}-{text[8:12]}-{text[12:16]}-{text[16:20]}-{text[20:32]}"
+
+    def read_literal(self):
+        """
+        Reads a string or UUID literal
+        """
+        if self.tag() == UINT64_TYPE:
+            return self.read_uuid()
+        return self.read_string()
+
+    def read_slot(self):
+        """
+        Reads a dictionary reference or a literal
+        """
+        if self.tag() == UINT32_TYPE:
+            ident = self.read_uint32()
+            if ident >= len(self.strings) or self.strings[ident] is None:
+                raise WireError(f"Unknown dictionary entry {ident}")
+            return self.strings[ident]
+        return self.read_literal()
+
+    def read_json(self):
+        """
+        Reads a JSON value in NetcodeSerializer form
+        """
+        self.expect(JSON_TYPE)
+        kind = self.tag()
+        if kind == NONE_TYPE:
+            self.pos += 1
+            return None
+        elif kind == BOOLEAN_TRUE:
+            self.pos += 1
+            return True
+        elif kind == BOOLEAN_FALSE:
+            self.pos += 1
+            return False
+        elif kind == DOUBLE_TYPE:
+            self.pos += 1
+            value = self.unpack(">d", 8)
+            return int(value) if value.is_integer() else value
+        elif kind == STRING_TYPE:
+            return self.read_string()
+        elif kind == ARRAY_TYPE:
+            self.pos += 1
+            size = self.read_uint64()
+            return [self.read_json() for _ in range(size)]
+        elif kind == JSON_TYPE:
+            self.pos += 1
+            size = self.read_uint64()
+            result = {}
+            for _ in range(size):
+                key = self.read_string()
+                result[key] = self.read_json()
+            return result
+        raise WireError(f"Invalid json type {kind}")
+
+    def read_dictionary(self):
+        """
+        Reads the body of a `dictionary` message into the dictionary
+        """
+        first = self.read_uint32()
+        count = self.read_uint32()
+        if first + count > MAX_DICTIONARY:
+            raise WireError("Dictionary is too large")
+        if len(self.strings) < first + count:
+            self.strings.extend([None] * (first + count - len(self.strings)))
+        for index in range(first, first + count):
+            self.strings[index] = self.read_literal()
+
+    def read_message(self, nested):
+        """
+        Reads a single message (batches may not be nested)
+        """
+        code = self.read_uint32()
+        if code == CODE_DICTIONARY and not nested:
+            self.read_dictionary()
+            return None
+        elif code == CODE_TASK:
+            return {"message_type": "task",
+                    "message_payload": {"task_name": self.read_slot()}}
+        elif code == CODE_TASK_ATTEMPT or code == CODE_SYNC_TASK_ATTEMPT:
+            payload = {}
+            if code == CODE_TASK_ATTEMPT:
+                payload["task_name"] = self.read_slot()
+            payload["task_attempt_uuid"] = self.read_slot()
+            payload["status"] = self.read_slot()
+            payload["num_failures"] = self.read_sint32()
+            payload["statistics"] = self.read_json()
+            kind = "task_attempt" if code == CODE_TASK_ATTEMPT else "sync_task_attempt"
+            return {"message_type": kind, "message_payload": payload}
+        elif code == CODE_SYNC_TASK_PATCH:
+            payload = {"task_attempt_uuid": self.read_slot(),
+                       "status": self.read_slot(),
+                       "num_failures": self.read_sint32(),
+                       "version": self.read_uint32()}
+            key = "statistics" if self.read_bool() else "patch"
+            payload[key] = self.read_json()
+            return {"message_type": "sync_task_attempt", "message_payload": payload}
+        elif code == CODE_ACTION:
+            count = self.read_uint32()
+            uuids = [self.read_slot() for _ in range(count)]
+            return {"message_type": "action",
+                    "message_payload": {"task_attempt_uuids": uuids, "data": self.read_json()}}
+        elif code == CODE_BATCH and not nested:
+            count = self.read_uint32()
+            messages = [self.read_message(nested=True) for _ in range(count)]
+            return {"message_type": "batch", "message_payload": {"messages": messages}}
+        elif code == CODE_JSON and nested:
+            return json.loads(self.read_string())
+        raise WireError(f"Invalid message code {code}")